@@ -11,6 +11,7 @@ This project is licensed under the terms of the MIT license.
 #include "ConsoleCommands/Console.hpp"
 #include "ConsoleCommands/ConVar.hpp"
 #include "Network/Network.hpp"
+#include "Network/State.hpp"
 
 #ifdef _WIN32
     // #define WIN32_LEAN_AND_MEAN
@@ -62,6 +63,8 @@ ClientStateConnectingT::ClientStateConnectingT(ClientT& Client_)
     OutData.WriteByte(CS0_Connect);
     OutData.WriteString(Options_PlayerName.GetValueString());
     OutData.WriteString(Options_PlayerModelName.GetValueString());
+    OutData.WriteByte(cf::Network::StateT::DELTA_FIELDS);  // The most recent delta message format that we can decode.
+    OutData.WriteByte(PROTOCOL_VERSION);
 
     try
     {
@@ -175,7 +178,7 @@ void ClientStateConnectingT::MainLoop(float FrameTime)
             NetDataT    InData;
             NetAddressT SenderAddress=InData.Receive(Client.Socket);
 
-            if (GameProtocol1T::IsIncomingMessageOutOfBand(InData))
+            if (GameProtocol2T::IsIncomingMessageOutOfBand(InData))
             {
                 // It's well possible that we receive connection-less messages,
                 // e.g. in reply to the connection-less messages that we have sent.
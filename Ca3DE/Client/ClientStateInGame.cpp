@@ -23,6 +23,7 @@ This project is licensed under the terms of the MIT license.
 #include "MainWindow/MainWindow.hpp"
 #include "Math3D/Angles.hpp"
 #include "Math3D/Matrix.hpp"
+#include "Models/ModelManager.hpp"
 #include "Network/Network.hpp"
 #include "OpenGL/OpenGLWindow.hpp"
 #include "ConsoleCommands/Console.hpp"
@@ -134,6 +135,29 @@ int ClientStateInGameT::ConFunc_recordPath_Callback(lua_State* LuaState)
 static ConFuncT ConFunc_recordPath("recordPath", ClientStateInGameT::ConFunc_recordPath_Callback, ConFuncT::FLAG_MAIN_EXE, "Records the players path into a pointfile (load into CaWE to view).");
 
 
+static ConVarT UsePoseCache("cl_poseCache", true, ConVarT::FLAG_MAIN_EXE, "Toggles whether entities that show the same model in the same pose share the pose data (joint matrices, skinned meshes).");
+static ConVarT PoseCacheFrameStep("cl_poseCacheFrameStep", 0.0, ConVarT::FLAG_MAIN_EXE, "The step that animation frame numbers are rounded to for sharing the pose data, 0.0 for sharing exactly equal poses only.", 0.0, 10.0);
+
+
+int ClientStateInGameT::ConFunc_poseCacheStats_Callback(lua_State* LuaState)
+{
+    if (!ClientIGSPtr) return 0;
+
+    PoseCacheT&         PoseCache=ClientIGSPtr->Client.m_ModelMan.GetPoseCache();
+    const unsigned long NumHits  =PoseCache.GetNumHits();
+    const unsigned long NumMisses=PoseCache.GetNumMisses();
+
+    Console->Print(cf::va("Pose cache %s, %lu entries.\n", PoseCache.IsEnabled() ? "enabled" : "disabled", PoseCache.GetNumEntries()));
+    Console->Print(cf::va("    Since the last call: %lu hits, %lu misses (%.1f%% hits).\n", NumHits, NumMisses,
+        NumHits+NumMisses>0 ? 100.0*NumHits/(NumHits+NumMisses) : 0.0));
+
+    PoseCache.ResetCounters();
+    return 0;
+}
+
+static ConFuncT ConFunc_poseCacheStats("poseCacheStats", ClientStateInGameT::ConFunc_poseCacheStats_Callback, ConFuncT::FLAG_MAIN_EXE, "Prints the hits and misses of the pose cache since the last call (see cl_poseCache).");
+
+
 ClientStateInGameT::ClientStateInGameT(ClientT& Client_)
     : Client(Client_),
       Font_v("Fonts/Arial"),
@@ -409,6 +433,13 @@ void ClientStateInGameT::Render(float FrameTime)
 
     if (World)
     {
+        // Begin a new frame in the pose cache, which drops the poses that have not been used in the last frame.
+        PoseCacheT& PoseCache=Client.m_ModelMan.GetPoseCache();
+
+        PoseCache.SetEnabled(UsePoseCache.GetValueBool());
+        PoseCache.SetFrameStep(float(PoseCacheFrameStep.GetValueDouble()));
+        PoseCache.AdvanceFrame();
+
         IntrusivePtrT<const cf::GameSys::ComponentTransformT> CameraTrafo = World->OurEntity_GetCamera();
 
         if (CameraTrafo != NULL)
@@ -849,7 +880,7 @@ void ClientStateInGameT::MainLoop(float FrameTime)
             NetDataT    InData;
             NetAddressT SenderAddress=InData.Receive(Client.Socket);
 
-            if (GameProtocol1T::IsIncomingMessageOutOfBand(InData))
+            if (GameProtocol2T::IsIncomingMessageOutOfBand(InData))
             {
                 // It's well possible that we receive connection-less messages,
                 // e.g. in reply to the connection-less messages that we have sent.
@@ -931,9 +962,8 @@ void ClientStateInGameT::MainLoop(float FrameTime)
     {
         GameProtocol.GetTransmitData(ReliableDatas, UnreliableData.Data).Send(Client.Socket, Client.ServerAddress);
     }
-    catch (const GameProtocol1T::MaxMsgSizeExceeded& /*E*/) { EnqueueString("FATAL WARNING: caught a GameProtocol1T::MaxMsgSizeExceeded exception!\n"); }
-    catch (const NetDataT::WinSockAPIError&            E  ) { EnqueueString("FATAL WARNING: caught a NetDataT::WinSockAPIError exception (error %u)!\n", E.Error); }
-    catch (const NetDataT::MessageLength&              E  ) { EnqueueString("FATAL WARNING: caught a NetDataT::MessageLength exception (wanted %u, actual %u)!\n", E.Wanted, E.Actual); }
+    catch (const NetDataT::WinSockAPIError& E) { EnqueueString("FATAL WARNING: caught a NetDataT::WinSockAPIError exception (error %u)!\n", E.Error); }
+    catch (const NetDataT::MessageLength&   E) { EnqueueString("FATAL WARNING: caught a NetDataT::MessageLength exception (wanted %u, actual %u)!\n", E.Wanted, E.Actual); }
 
     ReliableDatas.Clear();
     UnreliableData=NetDataT();
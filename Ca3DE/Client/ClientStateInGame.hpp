@@ -43,6 +43,7 @@ class ClientStateInGameT : public ClientStateT
     static int ConFunc_chatPrint_Callback(lua_State* LuaState);
     static int ConFunc_showPath_Callback(lua_State* LuaState);
     static int ConFunc_recordPath_Callback(lua_State* LuaState);
+    static int ConFunc_poseCacheStats_Callback(lua_State* LuaState);
 
 
     private:
@@ -57,7 +58,7 @@ class ClientStateInGameT : public ClientStateT
 
     ClientT&               Client;
 
-    GameProtocol1T         GameProtocol;
+    GameProtocol2T         GameProtocol;
     ArrayT< ArrayT<char> > ReliableDatas;
     NetDataT               UnreliableData;
 
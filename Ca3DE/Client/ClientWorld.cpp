@@ -11,12 +11,15 @@ This project is licensed under the terms of the MIT license.
 #include "ClipSys/CollisionModelMan.hpp"
 #include "ConsoleCommands/ConVar.hpp"
 #include "GameSys/CompLightPoint.hpp"
+#include "GameSys/CompModel.hpp"
 #include "GameSys/CompPlayerPhysics.hpp"
 #include "GameSys/Entity.hpp"
 #include "GameSys/EntityCreateParams.hpp"
 #include "GameSys/Interpolator.hpp"
 #include "GameSys/World.hpp"
+#include "MaterialSystem/RecordingRenderer.hpp"
 #include "MaterialSystem/Renderer.hpp"
+#include "Models/AnimPose.hpp"
 #include "Math3D/Matrix.hpp"
 #include "Math3D/Matrix3x3.hpp"
 #include "Network/Network.hpp"
@@ -32,13 +35,19 @@ This project is licensed under the terms of the MIT license.
 #include <cassert>
 
 
+static ConVarT ClientNumThreads("cl_numThreads", 1, ConVarT::FLAG_MAIN_EXE, "The number of threads that prepare the entities for drawing (0 for one per hardware thread).", 0, 64);
+static ConVarT ClientBatchAmbient("cl_batchAmbient", false, ConVarT::FLAG_MAIN_EXE, "Whether the meshes of the ambient pass are sorted by material and merged before they are rendered.");
+
+
 CaClientWorldT::CaClientWorldT(const char* FileName, ModelManagerT& ModelMan, cf::GuiSys::GuiResourcesT& GuiRes, WorldT::ProgressFunctionT ProgressFunction, unsigned long OurEntityID_) /*throw (WorldT::LoadErrorT)*/
     : Ca3DEWorldT(FileName, ModelMan, GuiRes, true, ProgressFunction),
       OurEntityID(OurEntityID_),
       m_FrameInfos(),
       m_ServerFrameNr(0xDEADBEEF),
       m_PlayerCommands(),
-      m_PlayerCommandNr(0)
+      m_PlayerCommandNr(0),
+      m_Workers(1),
+      m_AmbientCommands()
 {
     ProgressFunction(-1.0f, "InitDrawing()");
 
@@ -154,6 +163,9 @@ unsigned long CaClientWorldT::ReadServerFrameMessage(NetDataT& InData)
                                                            else DeltaFrameEntityID=DeltaFrame->EntityIDsInPVS[DeltaFrameIndex];
     }
 
+    // The delta messages of all entities are read into the same array, so that its memory is reused.
+    ArrayT<uint8_t> DeltaMessage;
+
     // Read all 'SC1_EntityUpdate' and 'SC1_EntityRemove' messages.
     while (true)
     {
@@ -205,7 +217,7 @@ unsigned long CaClientWorldT::ReadServerFrameMessage(NetDataT& InData)
 
         if (DeltaFrameEntityID==NewEntityID)
         {
-            const ArrayT<uint8_t> DeltaMessage=InData.ReadDMsg();
+            InData.ReadDMsg(DeltaMessage);
 
             // Der Entity vom DeltaFrame kommt auch im CurrentFrame vor, Änderungen ergeben sich aus der Delta-Dekompression bzgl. des DeltaFrame
             CurrentFrame.EntityIDsInPVS.PushBack(NewEntityID);
@@ -221,7 +233,7 @@ unsigned long CaClientWorldT::ReadServerFrameMessage(NetDataT& InData)
 
         if (DeltaFrameEntityID>NewEntityID)
         {
-            const ArrayT<uint8_t> DeltaMessage=InData.ReadDMsg();
+            InData.ReadDMsg(DeltaMessage);
 
             // Der Entity kommt im CurrentFrame neu dazu, delta'en bzgl. der BaseLine
             CurrentFrame.EntityIDsInPVS.PushBack(NewEntityID);
@@ -459,14 +471,19 @@ void CaClientWorldT::Draw(float FrameTime) const
     IntrusivePtrT<const cf::GameSys::ComponentTransformT> CameraTrafo = OurEnt->GetChildren()[0]->GetTransform();
 
 
-    // Set up the entity state for rendering the video frame:
-    //   - advance the interpolations,
-    //   - actually set the interpolated values and
-    //   - advance and apply and client-side effects.
-    for (unsigned int i = 0; i < CurrentFrame.EntityIDsInPVS.Size(); i++)
+    // Set up the entity state for rendering the video frame.
+    // This "prepare" stage is completed before any calls to the renderer are made:
+    //   - advance the interpolations and actually set the interpolated values,
+    //   - advance and apply any client-side effects and
+    //   - compute the poses of the models as needed for drawing.
+    // The interpolations of each entity only modify the values of its own components, and
+    // are thus done for all entities in parallel. The client-side effects run script code,
+    // and are therefore applied in the main thread.
+    m_Workers.SetNumThreads(ClientNumThreads.GetValueInt());
+    m_Workers.ParallelFor(CurrentFrame.EntityIDsInPVS.Size(), [this, &CurrentFrame, FrameTime](unsigned int i)
     {
-        const unsigned int                  ID  = CurrentFrame.EntityIDsInPVS[i];
-        IntrusivePtrT<cf::GameSys::EntityT> Ent = m_EngineEntities[ID]->GetEntity();
+        const unsigned int          ID  = CurrentFrame.EntityIDsInPVS[i];
+        const cf::GameSys::EntityT* Ent = m_EngineEntities[ID]->GetEntity().get();
 
         // Note that no effort is made to inform components that their values may have changed.
         // For example, ComponentCollisionModelT components are not informed if the origin or
@@ -484,10 +501,18 @@ void CaClientWorldT::Draw(float FrameTime) const
                 Comp->GetInterpolators()[i]->SetCurrentValue();
             }
         }
+    }, "AdvanceInterpolators");
+
+    for (unsigned int i = 0; i < CurrentFrame.EntityIDsInPVS.Size(); i++)
+    {
+        const unsigned int                  ID  = CurrentFrame.EntityIDsInPVS[i];
+        IntrusivePtrT<cf::GameSys::EntityT> Ent = m_EngineEntities[ID]->GetEntity();
 
         Ent->OnClientFrame(FrameTime);
     }
 
+    PrepareModels(OurEntityID, CameraTrafo->GetOriginWS().AsVectorOfDouble(), CurrentFrame.EntityIDsInPVS);
+
 
     // Update the sound system listener.
     {
@@ -549,12 +574,28 @@ void CaClientWorldT::Draw(float FrameTime) const
     MatSys::Renderer->SetCurrentEyePosition(float(DrawOrigin.x), float(DrawOrigin.y), float(DrawOrigin.z)+EyeOffsetZ);    // Also required in some ambient shaders.
 
 
+    // If batching is enabled, record the meshes of the ambient pass in order to render them sorted by material.
+    MatSys::RendererI* const   TargetRenderer = MatSys::Renderer;
+    MatSys::RecordingRendererT RecordingRenderer(*TargetRenderer, m_AmbientCommands);
+
+    if (ClientBatchAmbient.GetValueBool())
+        MatSys::Renderer = &RecordingRenderer;
+
     const cf::SceneGraph::BspTreeNodeT* BspTree = m_World->m_StaticEntityData[0]->m_BspTree;
     BspTree->DrawAmbientContrib(DrawOrigin);
 
     // Draw the ambient contribution of the entities.
     DrawEntities(OurEntityID, false, DrawOrigin, CurrentFrame.EntityIDsInPVS);
 
+    if (MatSys::Renderer == &RecordingRenderer)
+    {
+        MatSys::Renderer = TargetRenderer;
+
+        m_AmbientCommands.Optimize(*TargetRenderer);
+        m_AmbientCommands.Replay(*TargetRenderer);
+        m_AmbientCommands.Clear();
+    }
+
 
     // Render the contribution of the point light sources (shadows, normal-maps, specular-maps).
     int LightSourceCount=0;
@@ -723,6 +764,46 @@ bool CaClientWorldT::GetLightSourceInfo(unsigned long EntityID, unsigned long& D
 }
 
 
+void CaClientWorldT::PrepareModels(unsigned long OurEntityID, const VectorT& ViewerPos, const ArrayT<unsigned long>& EntityIDs) const
+{
+    // Collect the poses whose data must be computed. This accesses the anim expression pools
+    // of the models and the pose cache, and is thus done in the main thread.
+    ArrayT<const AnimPoseT*> Poses;
+
+    for (unsigned long IDNr = 0; IDNr < EntityIDs.Size(); IDNr++)
+    {
+        const unsigned long EntityID = EntityIDs[IDNr];
+
+        if (EntityID >= m_EngineEntities.Size()) continue;
+        if (m_EngineEntities[EntityID] == NULL) continue;
+
+        IntrusivePtrT<cf::GameSys::EntityT> Ent = m_EngineEntities[EntityID]->GetEntity();
+
+        if (Ent->GetID() == 0) continue;    // Skip the world, as in DrawEntities().
+
+        // The same parameters as in DrawEntities(), so that the poses are computed for the actually drawn level-of-detail.
+        const bool FirstPersonView = (EntityID == OurEntityID) ||
+            (Ent->GetParent() != NULL && Ent->GetParent()->GetID() == OurEntityID);
+
+        const float LodDist = length(ViewerPos.AsVectorOfFloat() - Ent->GetTransform()->GetOriginWS());
+
+        for (unsigned int CompNr = 0; CompNr < Ent->GetComponents().Size(); CompNr++)
+        {
+            IntrusivePtrT<const cf::GameSys::ComponentModelT> ModelComp = dynamic_pointer_cast<cf::GameSys::ComponentModelT>(Ent->GetComponents()[CompNr]);
+
+            if (ModelComp == NULL) continue;
+
+            const AnimPoseT* Pose = ModelComp->PrepareRender(FirstPersonView, LodDist);
+
+            // PrepareRender() returns each pose at most once, even if its data is shared by several models.
+            if (Pose) Poses.PushBack(Pose);
+        }
+    }
+
+    m_Workers.ParallelFor(Poses.Size(), [&Poses](unsigned int i) { Poses[i]->ComputeCache(); }, "ComputeModelPoses");
+}
+
+
 void CaClientWorldT::DrawEntities(unsigned long OurEntityID, bool SkipOurEntity, const VectorT& ViewerPos, const ArrayT<unsigned long>& EntityIDs) const
 {
     for (unsigned long IDNr = 0; IDNr < EntityIDs.Size(); IDNr++)
@@ -9,6 +9,8 @@ This project is licensed under the terms of the MIT license.
 
 #include "../Ca3DEWorld.hpp"
 #include "GameSys/CompTransform.hpp"
+#include "Jobs/JobSystem.hpp"
+#include "MaterialSystem/RenderCommandList.hpp"
 
 #if defined(_WIN32) && _MSC_VER<1600
 #include "pstdint.h"            // Paul Hsieh's portable implementation of the stdint.h header.
@@ -75,6 +77,11 @@ class CaClientWorldT : public Ca3DEWorldT
     // Please see the corresponding function in EngineEntityT for documentation.
     bool GetLightSourceInfo(unsigned long EntityID, unsigned long& DiffuseColor, unsigned long& SpecularColor, VectorT& Position, float& Radius, bool& CastsShadows) const;
 
+    // Computes the poses of the models of all entities whose ID is contained in the 'EntityIDs' array, as they are needed
+    // for drawing the entities from the given viewer position. The parameters are as for DrawEntities().
+    // The poses are computed in parallel, so that the subsequent calls to DrawEntities() find them up-to-date.
+    void PrepareModels(unsigned long OurEntityID, const VectorT& ViewerPos, const ArrayT<unsigned long>& EntityIDs) const;
+
     // Draws all entities whose ID is contained in the 'EntityIDs' array.
     // The entity with ID 'OurEntityID' specifies "our" entity.
     // (Everything else is drawn from the viewpoint from this entity, and it is necessary to let the
@@ -99,6 +106,9 @@ class CaClientWorldT : public Ca3DEWorldT
     ArrayT<PlayerCommandT> m_PlayerCommands;    ///< The last player commands, kept for the reprediction that is applied after each frame update from the server.
     unsigned int           m_PlayerCommandNr;   ///< The number of the latest player command in m_PlayerCommands.
 
+    mutable cf::Jobs::JobSystemT m_Workers;     ///< The threads that prepare the entities for drawing in parallel, see ConVar `cl_numThreads`.
+    mutable MatSys::RenderCommandListT m_AmbientCommands;   ///< The meshes of the ambient pass, sorted by material before they are rendered, see ConVar `cl_batchAmbient`.
+
     ArrayT<unsigned long>  BFS_Tree;
     ArrayT<VectorT>        BFS_TreePoints;
     unsigned long          BFS_EndLeafNr;
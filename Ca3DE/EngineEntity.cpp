@@ -25,6 +25,10 @@ namespace
     ConVarT clientApproxNPCs("clientApproxNPCs", true, ConVarT::FLAG_MAIN_EXE,
         "Toggles whether origins and other values are interpolated over client "
         "frames in order to bridge the larger intervals between server frames.");
+
+    ConVarT StateFloatPrecision("sv_stateFloatPrecision", 23, ConVarT::FLAG_MAIN_EXE,
+        "The number of mantissa bits of the floating-point values in the entity states that the server "
+        "sends to clients. Less than 23 (full precision) means less accuracy but smaller updates.", 10, 23);
 }
 
 
@@ -33,14 +37,12 @@ namespace
 /******************/
 
 
-cf::Network::StateT EngineEntityT::GetState() const
+void EngineEntityT::GetState(cf::Network::StateT& State, unsigned int FloatMantissaBits) const
 {
-    cf::Network::StateT     State;
     cf::Network::OutStreamT Stream(State);
 
+    Stream.SetFloatPrecision(FloatMantissaBits);
     m_Entity->Serialize(Stream);
-
-    return State;
 }
 
 
@@ -82,12 +84,23 @@ EngineEntityT::EngineEntityT(IntrusivePtrT<cf::GameSys::EntityT> Ent, unsigned l
       EntityStateFrameNr(CreationFrameNr),
       m_BaseLine(),
       m_BaseLineFrameNr(CreationFrameNr),
-      m_OldStates()
+      m_OldStates(),
+      m_CurrentState(),
+      m_CurrentStateFrameNr(0),
+      m_CurrentStateChangeNr(0),
+      m_CurrentStatePrecision(0),
+      m_SpareStates(),
+      m_DeltaCache()
 {
-    m_BaseLine=GetState();
+    // The baseline is always serialized with full precision, because the client computes
+    // the baselines of the entities in the map file itself (and must get the same result).
+    GetState(m_BaseLine);
+
+    // All old states are the baseline, so they all share a single copy of it.
+    const IntrusivePtrT<SharedStateT> BaseLine(new SharedStateT(m_BaseLine));
 
     for (unsigned long OldStateNr=0; OldStateNr<16 /*MUST be a power of 2*/; OldStateNr++)
-        m_OldStates.PushBack(m_BaseLine);
+        m_OldStates.PushBack(BaseLine);
 }
 
 
@@ -103,7 +116,23 @@ void EngineEntityT::PreThink(unsigned long ServerFrameNr)
     // `m_BaseLine != m_OldStates[m_BaseLineFrameNr]`.)
     if (m_BaseLineFrameNr >= ServerFrameNr) return;
 
-    m_OldStates[(ServerFrameNr-1) & (m_OldStates.Size()-1)] = GetState();
+    // If the state of the previous frame has been sent to clients, it must be recorded exactly as it was sent,
+    // because the clients will use it as the reference for the delta messages of subsequent frames.
+    // UpdateCurrentState() makes sure that m_CurrentState is the state of the previous frame (and only
+    // serializes the entity if it has not been serialized in the previous frame and has changed since).
+    assert(EntityStateFrameNr == ServerFrameNr-1);
+    UpdateCurrentState();
+
+    IntrusivePtrT<SharedStateT>& OldState = m_OldStates[(ServerFrameNr-1) & (m_OldStates.Size()-1)];
+
+    if (OldState != m_CurrentState)
+    {
+        // If no other frame shares the state that is about to be dropped, keep it for reuse.
+        if (OldState->GetRefCount() == 1)
+            m_SpareStates.PushBack(OldState);
+
+        OldState = m_CurrentState;
+    }
 }
 
 
@@ -136,7 +165,70 @@ void EngineEntityT::WriteNewBaseLine(unsigned long SentClientBaseLineFrameNr, Ar
 }
 
 
-bool EngineEntityT::WriteDeltaEntity(bool SendFromBaseLine, unsigned long ClientFrameNr, NetDataT& OutData, bool ForceInfo) const
+IntrusivePtrT<EngineEntityT::SharedStateT> EngineEntityT::GetSpareState() const
+{
+    if (m_SpareStates.Size() == 0)
+        return new SharedStateT();
+
+    const IntrusivePtrT<SharedStateT> State = m_SpareStates[m_SpareStates.Size() - 1];
+
+    m_SpareStates.DeleteBack();
+    return State;
+}
+
+
+void EngineEntityT::UpdateCurrentState() const
+{
+    // EntityStateFrameNr is set in Think() and is the number of the current server frame.
+    // When it has changed since the cache was filled, the cache is stale: start over.
+    if (m_CurrentStateFrameNr == EntityStateFrameNr) return;
+
+    const uint64_t ChangeNr  = m_Entity->GetChangeNr();
+    const int      Precision = StateFloatPrecision.GetValueInt();
+
+    // Most entities are idle most of the time: only serialize the entity if it has changed since
+    // m_CurrentState was serialized. Otherwise, m_CurrentState is still the current state.
+    if (m_CurrentState.IsNull() || ChangeNr != m_CurrentStateChangeNr || Precision != m_CurrentStatePrecision)
+    {
+        // The states in m_OldStates must not change, so if m_CurrentState is shared with them, get another one.
+        if (m_CurrentState.IsNull() || m_CurrentState->GetRefCount() > 1)
+            m_CurrentState = GetSpareState();
+
+        GetState(m_CurrentState->State, Precision);
+        m_CurrentStateChangeNr  = ChangeNr;
+        m_CurrentStatePrecision = Precision;
+    }
+
+    m_CurrentStateFrameNr = EntityStateFrameNr;
+    m_DeltaCache.Overwrite();
+}
+
+
+const ArrayT<uint8_t>& EngineEntityT::GetCachedDeltaMessage(unsigned long DeltaFrameNr, cf::Network::StateT::DeltaFormatT DeltaFormat) const
+{
+    UpdateCurrentState();
+
+    // Most clients have acknowledged one of the same few recent frames, so a linear search is fine.
+    for (unsigned int EntryNr = 0; EntryNr < m_DeltaCache.Size(); EntryNr++)
+        if (m_DeltaCache[EntryNr].DeltaFrameNr == DeltaFrameNr && m_DeltaCache[EntryNr].DeltaFormat == DeltaFormat)
+            return m_DeltaCache[EntryNr].DeltaMsg;
+
+    // m_DeltaCache is only overwritten when the frame changes, so the new entry is usually one of
+    // an earlier frame, and the delta message is written into the memory of its old delta message.
+    m_DeltaCache.PushBackEmpty();
+
+    DeltaCacheEntryT& Entry = m_DeltaCache[m_DeltaCache.Size() - 1];
+
+    Entry.DeltaFrameNr = DeltaFrameNr;
+    Entry.DeltaFormat  = DeltaFormat;
+    m_CurrentState->State.GetDeltaMessage(DeltaFrameNr == 0 ? m_BaseLine : m_OldStates[DeltaFrameNr & (m_OldStates.Size()-1)]->State, Entry.DeltaMsg, DeltaFormat);
+
+    return Entry.DeltaMsg;
+}
+
+
+bool EngineEntityT::WriteDeltaEntity(bool SendFromBaseLine, unsigned long ClientFrameNr, NetDataT& OutData, bool ForceInfo,
+                                     cf::Network::StateT::DeltaFormatT DeltaFormat) const
 {
     // Prüfe, ob die Voraussetzungen für die Parameter (insb. 'ClientFrameNr') eingehalten werden.
     if (!SendFromBaseLine)
@@ -149,8 +241,11 @@ bool EngineEntityT::WriteDeltaEntity(bool SendFromBaseLine, unsigned long Client
     }
 
 
-    const cf::Network::StateT CurrentState = GetState();
-    const ArrayT<uint8_t>     DeltaMsg     = CurrentState.GetDeltaMessage(SendFromBaseLine ? m_BaseLine : m_OldStates[ClientFrameNr & (m_OldStates.Size()-1)]);
+    // The lock is held until the delta message has been copied into OutData, because other
+    // threads may add entries to m_DeltaCache (and thus reallocate it) in the meanwhile.
+    std::lock_guard<std::mutex> Lock(m_DeltaCacheMutex);
+
+    const ArrayT<uint8_t>& DeltaMsg = GetCachedDeltaMessage(SendFromBaseLine ? 0 : ClientFrameNr, DeltaFormat);
 
     if (cf::Network::StateT::IsDeltaMessageEmpty(DeltaMsg) && !ForceInfo) return true;
 
@@ -175,7 +270,13 @@ EngineEntityT::EngineEntityT(IntrusivePtrT<cf::GameSys::EntityT> Ent, NetDataT&
       EntityStateFrameNr(0),
       m_BaseLine(),
       m_BaseLineFrameNr(1234),    // The m_BaseLineFrameNr is unused on the client.
-      m_OldStates()
+      m_OldStates(),
+      m_CurrentState(),
+      m_CurrentStateFrameNr(0),
+      m_CurrentStateChangeNr(0),
+      m_CurrentStatePrecision(0),
+      m_SpareStates(),
+      m_DeltaCache()
 {
     const cf::Network::StateT CurrentState(cf::Network::StateT() /*::ALL_ZEROS*/, InData.ReadDMsg());
 
@@ -183,8 +284,9 @@ EngineEntityT::EngineEntityT(IntrusivePtrT<cf::GameSys::EntityT> Ent, NetDataT&
     // This is done in order to have it not wrongly process the event counters.
     SetState(CurrentState, true);
 
+    // The client overwrites its old states in place, so each must have its own copy.
     for (unsigned long OldStateNr=0; OldStateNr<32 /*MUST be a power of 2*/; OldStateNr++)
-        m_OldStates.PushBack(CurrentState);
+        m_OldStates.PushBack(new SharedStateT(CurrentState));
 
     m_BaseLine=CurrentState;
 }
@@ -228,7 +330,7 @@ bool EngineEntityT::ParseServerDeltaUpdateMessage(unsigned long DeltaFrameNr, un
             return false;
         }
 
-        DeltaState = &m_OldStates[DeltaFrameNr & (m_OldStates.Size()-1)];
+        DeltaState = &m_OldStates[DeltaFrameNr & (m_OldStates.Size()-1)]->State;
     }
     else
     {
@@ -240,7 +342,7 @@ bool EngineEntityT::ParseServerDeltaUpdateMessage(unsigned long DeltaFrameNr, un
 
     const cf::Network::StateT NewState = DeltaMessage ? cf::Network::StateT(*DeltaState, *DeltaMessage) : *DeltaState;
 
-    m_OldStates[EntityStateFrameNr & (m_OldStates.Size()-1)] = NewState;
+    m_OldStates[EntityStateFrameNr & (m_OldStates.Size()-1)]->State = NewState;
     SetState(NewState, DeltaFrameNr == 0);  // Don't process events and don't interpolate if we're delta'ing from the baseline (e.g. when re-entering the PVS).
     return true;
 }
@@ -12,6 +12,8 @@ This project is licensed under the terms of the MIT license.
 #include "Network/State.hpp"
 #include "Templates/Pointer.hpp"
 
+#include <mutex>
+
 
 class NetDataT;
 namespace cf { namespace GameSys { class EntityT; } }
@@ -66,7 +68,19 @@ class EngineEntityT
     // Gibt 'true' bei Erfolg zurück, sonst 'false'. Der einzige Möglichkeit, weswegen diese Funktion scheitern kann ('false'),
     // ist 'SendFromBaseLine==false' und eine zu kleine 'ClientFrameNr' (verlangt eine Komprimierung gegen etwas, was wir nicht (mehr) haben).
     // Im Falle des Scheiterns bleibt 'OutData' unberührt.
-    bool WriteDeltaEntity(bool SendFromBaseLine, unsigned long ClientFrameNr, NetDataT& OutData, bool ForceInfo) const;
+    // The current state and the delta messages are computed at most once per server frame and shared among all clients:
+    // callers must not modify the entity between the first and the last call to this method in a frame.
+    // This method can be called for several clients concurrently, provided that UpdateCurrentState() was called first.
+    // The DeltaFormat is the format of the delta message that has been agreed upon with the client.
+    bool WriteDeltaEntity(bool SendFromBaseLine, unsigned long ClientFrameNr, NetDataT& OutData, bool ForceInfo,
+                          cf::Network::StateT::DeltaFormatT DeltaFormat=cf::Network::StateT::DELTA_XOR_RLE) const;
+
+    /// Serializes the current state of the entity for use in WriteDeltaEntity(), unless this has been done in this server frame already.
+    /// If the entity has not changed since its state was last serialized (see cf::GameSys::EntityT::GetChangeNr()),
+    /// the previous state is kept and the entity is not serialized again.
+    /// As serializing accesses the GameSys entity, this must be called in the main thread before WriteDeltaEntity()
+    /// is called for several clients concurrently.
+    void UpdateCurrentState() const;
 
 
     /*******************/
@@ -94,11 +108,25 @@ class EngineEntityT
 
     private:
 
+    /// A serialized state that can be shared among the frames in m_OldStates and m_CurrentState, so that the
+    /// state of an entity that doesn't change is kept only once. A state that is shared (`GetRefCount() > 1`)
+    /// is never modified.
+    struct SharedStateT : public RefCountedT
+    {
+        SharedStateT() { }
+        SharedStateT(const cf::Network::StateT& State_) : State(State_) { }
+
+        cf::Network::StateT State;
+    };
+
     EngineEntityT(const EngineEntityT&);            ///< Use of the Copy    Constructor is not allowed.
     void operator = (const EngineEntityT&);         ///< Use of the Assignment Operator is not allowed.
 
-    /// Returns the serialized state of our Entity.
-    cf::Network::StateT GetState() const;
+    /// Serializes the state of our Entity into the given State.
+    /// The previous contents of State are overwritten, but its memory is reused.
+    /// @param State               Receives the serialized state of our Entity.
+    /// @param FloatMantissaBits   The precision of the serialized `float` values, see cf::Network::OutStreamT::SetFloatPrecision() for details.
+    void GetState(cf::Network::StateT& State, unsigned int FloatMantissaBits=23) const;
 
     /// Sets the state of our Entity to the given State.
     /// @param State       The state to assign to the entity.
@@ -107,6 +135,25 @@ class EngineEntityT
     ///     the event counters or to interpolate from stale values.
     void SetState(const cf::Network::StateT& State, bool IsIniting=false) const;
 
+    /// Returns the delta message in the given format from the state at `DeltaFrameNr` (0 for the baseline) to the current state.
+    /// The result is cached for the rest of the current server frame, so that all clients that have
+    /// acknowledged the same frame share the same serialization and compression work.
+    /// The caller must hold the lock on m_DeltaCacheMutex.
+    const ArrayT<uint8_t>& GetCachedDeltaMessage(unsigned long DeltaFrameNr, cf::Network::StateT::DeltaFormatT DeltaFormat) const;
+
+
+    /// Returns a state that is not shared and thus can be overwritten, reusing one of the m_SpareStates if possible.
+    IntrusivePtrT<SharedStateT> GetSpareState() const;
+
+
+    /// An entry in the per-frame cache of delta messages, see GetCachedDeltaMessage() for details.
+    struct DeltaCacheEntryT
+    {
+        unsigned long                     DeltaFrameNr;   ///< The frame number that the delta message is relative to, 0 for the baseline.
+        cf::Network::StateT::DeltaFormatT DeltaFormat;    ///< The format of the delta message.
+        ArrayT<uint8_t>                   DeltaMsg;       ///< The delta message from the state at DeltaFrameNr to the current state.
+    };
+
 
     IntrusivePtrT<cf::GameSys::EntityT> m_Entity;           ///< The game entity. On the client, it is in the most recent state as received from the server, *plus* any extrapolations (NPCs) and predictions (local human player) that are applied until the next update arrives.
 
@@ -114,7 +161,15 @@ class EngineEntityT
 
     cf::Network::StateT                 m_BaseLine;         ///< State of the entity immediately after it was created.
     const unsigned long                 m_BaseLineFrameNr;  ///< Frame number on which the entity was created. Only used on the server, unused on the client.
-    ArrayT<cf::Network::StateT>         m_OldStates;        ///< States of the last n (server) frames, kept on both client and server side for delta compression.
+    ArrayT< IntrusivePtrT<SharedStateT> > m_OldStates;      ///< States of the last n (server) frames, kept on both client and server side for delta compression. On the server, consecutive frames in which the entity didn't change share the same state.
+
+    mutable IntrusivePtrT<SharedStateT> m_CurrentState;         ///< Server only: The state at m_CurrentStateFrameNr, serialized at most once per frame and shared by all clients.
+    mutable unsigned long               m_CurrentStateFrameNr;  ///< Server only: The frame number that m_CurrentState and m_DeltaCache refer to, 0 if they are invalid.
+    mutable uint64_t                    m_CurrentStateChangeNr; ///< Server only: The change number of m_Entity when m_CurrentState was serialized.
+    mutable int                         m_CurrentStatePrecision;    ///< Server only: The float precision that m_CurrentState was serialized with.
+    mutable ArrayT< IntrusivePtrT<SharedStateT> > m_SpareStates;    ///< Server only: States that are no longer used, kept so that their memory can be reused.
+    mutable ArrayT<DeltaCacheEntryT>    m_DeltaCache;           ///< Server only: The delta messages from older states to m_CurrentState that were requested in this frame.
+    mutable std::mutex                  m_DeltaCacheMutex;      ///< Server only: Protects m_DeltaCache when the delta messages for several clients are written concurrently.
 };
 
 #endif
@@ -12,6 +12,10 @@ This project is licensed under the terms of the MIT license.
 // Dieses Header-File definiert die Konstanten für die Kommunikation zwischen Server und Client.
 // Die 0 wurde absichtlich freigehalten, um sie später evtl. als ErrorFlag verwenden zu können.
 
+// The version of the network protocol that the client and the server use for in-game communication (GameProtocol2T).
+// The client sends it in the CS0_Connect message, and the server denies clients with a different version.
+const char PROTOCOL_VERSION=2;
+
 // 'connection-less' Message-Types vom Client zum Server
 const char CS0_NoOperation         =1;
 const char CS0_Ping                =2;
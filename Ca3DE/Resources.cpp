@@ -74,6 +74,7 @@ ResourcesT::ResourcesT(cf::CompositeConsoleT& CC, const std::string& ConsoleText
 {
     extern ConVarT Options_ClientDesiredRenderer;
     extern ConVarT Options_ClientTextureDetail;
+    extern ConVarT Options_ClientBgTextureLoading;
     extern ConVarT Options_ClientDesiredSoundSystem;
 
     // Obtain the specified MatSys renderer (or if none is specified, automatically find the "best").
@@ -109,6 +110,8 @@ ResourcesT::ResourcesT(cf::CompositeConsoleT& CC, const std::string& ConsoleText
         case 2: MatSys::TextureMapManager->SetMaxTextureSize(128); break;
     }
 
+    MatSys::TextureMapManager->SetBackgroundLoading(Options_ClientBgTextureLoading.GetValueBool());
+
 
     // Initialize the model manager and the GUI resources.
     m_ModelManager=new ModelManagerT();
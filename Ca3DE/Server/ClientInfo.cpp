@@ -13,6 +13,7 @@ ClientInfoT::ClientInfoT(const NetAddressT& ClientAddress_, const std::string& P
       ReliableDatas(),
       TimeSinceLastMessage(0.0),
       TimeSinceLastUpdate(0.0),
+      DeltaFormat(cf::Network::StateT::DELTA_XOR_RLE),
       ClientState(Wait4MapInfoACK),
       PlayerName(PlayerName_),
       ModelName(ModelName_),
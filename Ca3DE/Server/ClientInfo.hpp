@@ -8,6 +8,7 @@ This project is licensed under the terms of the MIT license.
 #define CAFU_CLIENTINFO_HPP_INCLUDED
 
 #include "Network/Network.hpp"
+#include "Network/State.hpp"
 #include "../PlayerCommand.hpp"
 
 
@@ -22,10 +23,11 @@ struct ClientInfoT
 
     // Connection-related data
     NetAddressT                     ClientAddress;          ///< IP+Port of the client.
-    GameProtocol1T                  GameProtocol;           ///< The network protocol instance we use for communication with the client.
+    GameProtocol2T                  GameProtocol;           ///< The network protocol instance we use for communication with the client.
     ArrayT< ArrayT<char> >          ReliableDatas;          ///< Puffer für wichtige, zu bestätigende Messages an den Client.
     float                           TimeSinceLastMessage;   ///< Time that passed since the last message arrived (for time-outs and zombies).
     float                           TimeSinceLastUpdate;
+    cf::Network::StateT::DeltaFormatT DeltaFormat;          ///< The format of the delta messages of entity updates that was agreed upon with the client at connection time.
 
     // Client-related data
     ClientStateT                    ClientState;            ///< Online, Wait4MapInfoACK, Zombie, Download, ...
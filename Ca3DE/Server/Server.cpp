@@ -47,6 +47,8 @@ static ServerT*      ServerPtr=NULL;
 
 
 static ConVarT ServerRCPassword("sv_rc_password", "", ConVarT::FLAG_MAIN_EXE, "The password the server requires for remote console access.");
+static ConVarT ServerFieldDeltas("sv_fieldDeltas", true, ConVarT::FLAG_MAIN_EXE, "Whether entity updates are sent as field-level delta messages to clients that support them (takes effect for newly connecting clients).");
+static ConVarT ServerNumThreads("sv_numThreads", 1, ConVarT::FLAG_MAIN_EXE, "The number of threads that build the per-client update messages (0 for one per hardware thread).", 0, 64);
 
 
 int ServerT::ConFunc_changeLevel_Callback(lua_State* LuaState)
@@ -144,7 +146,10 @@ ServerT::ServerT(const GameInfoT& GameInfo, const GuiCallbackI& GuiCallback_, Mo
       World(NULL),
       GuiCallback(GuiCallback_),
       m_ModelMan(ModelMan),
-      m_GuiRes(GuiRes)
+      m_GuiRes(GuiRes),
+      m_Workers(1),
+      m_NetBatch(ServerSocket),
+      m_UnreliableDatas()
 {
     if (ServerSocket==INVALID_SOCKET) throw InitErrorT(cf::va("Unable to obtain UDP socket on port %i.", Options_ServerPortNr.GetValueInt()));
 
@@ -207,69 +212,38 @@ void ServerT::MainLoop()
 
 
     // Warte, bis wir neue Packets bekommen oder das Frame zu Ende geht
-    fd_set  ReadabilitySocketSet;
-    timeval TimeOut;
+    bool HavePackets=false;
 
-    TimeOut.tv_sec =0;
-    TimeOut.tv_usec=10*1000;
-
-    #if defined(_WIN32) && defined(__WATCOMC__)
-    #pragma warning 555 9;
-    #endif
-    FD_ZERO(&ReadabilitySocketSet);
-    FD_SET(ServerSocket, &ReadabilitySocketSet);
-    #if defined(_WIN32) && defined(__WATCOMC__)
-    #pragma warning 555 4;
-    #endif
-
-    // select() bricht mit der Anzahl der lesbar gewordenen Sockets ab, 0 bei TimeOut oder SOCKET_ERROR im Fehlerfall.
-    const int Result=select(int(ServerSocket+1), &ReadabilitySocketSet, NULL, NULL, &TimeOut);
-
-    if (Result==SOCKET_ERROR)
+    try
     {
-        Console->Print(cf::va("ERROR: select() returned WSA fail code %u\n", WSAGetLastError()));
+        HavePackets=m_NetBatch.WaitForPackets(10);
     }
-    else if (Result!=0)
+    catch (const NetDataT::WinSockAPIError& E)
+    {
+        Console->Print(cf::va("ERROR: waiting for packets returned WSA fail code %u\n", E.Error));
+    }
+
+    if (HavePackets)
     {
         // In dieser Schleife werden solange die Packets der Clients abgeholt, bis keine mehr da sind (would block).
-        unsigned long MaxPacketsCount=20;
+        // Where supported, each call to m_NetBatch.Receive() gets all available packets (up to the limit) at once.
+        ArrayT<NetDataT>    InDatas;
+        ArrayT<NetAddressT> SenderAddresses;
+        unsigned long       MaxPacketsCount=20;
 
-        while (MaxPacketsCount--)
+        while (MaxPacketsCount>0)
         {
             try
             {
-                NetDataT    InData;
-                NetAddressT SenderAddress=InData.Receive(ServerSocket);
-
-                if (GameProtocol1T::IsIncomingMessageOutOfBand(InData))
-                {
-                    ProcessConnectionLessPacket(InData, SenderAddress);
-                }
-                else
-                {
-                    // ClientNr des Absenders heraussuchen
-                    unsigned long ClientNr;
-
-                    for (ClientNr=0; ClientNr<ClientInfos.Size(); ClientNr++)
-                        if (SenderAddress==ClientInfos[ClientNr]->ClientAddress) break;
+                const unsigned long NumPackets=m_NetBatch.Receive(InDatas, SenderAddresses, MaxPacketsCount);
 
-                    // Prüfe ClientNr
-                    if (ClientNr>=ClientInfos.Size())
-                    {
-                        Console->Warning(cf::va("Client %s is not connected! Packet ignored!\n", SenderAddress.ToString()));
-                        // Hier evtl. ein bad / disconnect / kick packet schicken?
-                        continue;
-                    }
+                // Break the while-loop, there is no point in trying to receive further messages right now.
+                if (NumPackets==0) break;
 
-                    // Was Zombies senden, interessiert uns nicht mehr
-                    if (ClientInfos[ClientNr]->ClientState==ClientInfoT::Zombie) continue;
+                MaxPacketsCount-=NumPackets;
 
-                    // Es ist eine gültige Nachricht (eines Online- oder Wait4MapInfoACK-Client) - bearbeite sie!
-                    GlobalClientNr=ClientNr;
-                    assert(ServerPtr==this);
-                    ClientInfos[ClientNr]->TimeSinceLastMessage=0.0;    // Do not time-out
-                    ClientInfos[ClientNr]->GameProtocol.ProcessIncomingMessage(InData, ProcessInGamePacketHelper);
-                }
+                for (unsigned long PacketNr=0; PacketNr<NumPackets; PacketNr++)
+                    ProcessPacket(InDatas[PacketNr], SenderAddresses[PacketNr]);
             }
             catch (const NetDataT::WinSockAPIError& E)
             {
@@ -280,6 +254,9 @@ void ServerT::MainLoop()
                     break;
                 }
 
+                // Count the failed attempt like a packet, so that a persistent error cannot keep us in this loop.
+                MaxPacketsCount--;
+
                 // Deal with other errors that don't have to break the while-loop above.
                 switch (E.Error)
                 {
@@ -427,46 +404,114 @@ void ServerT::MainLoop()
             // Note that after this, no further entities can be added to the world in the
             // *current* frame, but only in the next!
             CI->BaseLineFrameNr = World->WriteClientNewBaseLines(CI->BaseLineFrameNr, CI->ReliableDatas);
-
-            // Update the client's frame info corresponding to the the current server frame.
-            World->UpdateFrameInfo(*CI);
         }
+
+        // Update the clients' frame infos corresponding to the the current server frame.
+        // This only reads the world state, and thus is done for all clients in parallel.
+        m_Workers.SetNumThreads(ServerNumThreads.GetValueInt());
+        World->PrepareFrameInfos();
+        m_Workers.ParallelFor(ClientInfos.Size(), [this](unsigned int ClientNr) { World->UpdateFrameInfo(*ClientInfos[ClientNr]); }, "UpdateFrameInfo");
     }
 
 
-    // Sende die aufgestauten ReliableData und die hier "dynamisch" erzeugten UnreliableData
-    // (bestehend aus den Delta-Update-Messages (FrameInfo+EntityUpdates)) an die für sie bestimmten Empfänger.
+    // Determine the clients that are due for an update.
+    ArrayT<unsigned long> UpdateClientNrs;
+
     for (unsigned long ClientNr = 0; ClientNr < ClientInfos.Size(); ClientNr++)
     {
-        ClientInfoT* CI = ClientInfos[ClientNr];
-
         ClientInfos[ClientNr]->TimeSinceLastUpdate+=FrameTime;
 
         // Only send something after a minimum interval.
-        if (CI->TimeSinceLastUpdate < 0.05) continue;
+        if (ClientInfos[ClientNr]->TimeSinceLastUpdate < 0.05) continue;
 
-        NetDataT UnreliableData;
+        UpdateClientNrs.PushBack(ClientNr);
+    }
 
-        if (World && CI->ClientState != ClientInfoT::Zombie)
-        {
-            World->WriteClientDeltaUpdateMessages(*CI, UnreliableData);
-        }
+    // Build the delta update messages (FrameInfo+EntityUpdates) for these clients.
+    // The entity states are serialized in the main thread, then the messages of all clients are built in parallel.
+    // The messages are written into the buffers of the previous frames, which are large enough after a few frames.
+    while (m_UnreliableDatas.Size() < UpdateClientNrs.Size())
+        m_UnreliableDatas.PushBackEmpty();
 
-        try
-        {
-            // Note that we intentionally also send to clients in Wait4MapInfoACK and Zombie
-            // states, in order to keep the handling (with possible re-transfers) of reliable
-            // data going.
-            // TODO: Für Zombies statt rel.+unrel. Data nur leere Buffer übergeben! VORHER aber die DropMsg in ServerT::DropClient SENDEN!
-            CI->GameProtocol.GetTransmitData(CI->ReliableDatas, UnreliableData.Data).Send(ServerSocket, CI->ClientAddress);
-        }
-        catch (const GameProtocol1T::MaxMsgSizeExceeded& /*E*/) { Console->Warning(cf::va("(ClientNr==%u, EntityID==%u) caught a GameProtocol1T::MaxMsgSizeExceeded exception!", ClientNr, CI->EntityID)); }
-        catch (const NetDataT::WinSockAPIError&            E  ) { Console->Warning(cf::va("caught a NetDataT::WinSockAPIError exception (error %u)!", E.Error)); }
-        catch (const NetDataT::MessageLength&              E  ) { Console->Warning(cf::va("caught a NetDataT::MessageLength exception (wanted %u, actual %u)!", E.Wanted, E.Actual)); }
+    for (unsigned int i = 0; i < UpdateClientNrs.Size(); i++)
+    {
+        m_UnreliableDatas[i].Data.Overwrite();
+        m_UnreliableDatas[i].ReadBegin();
+    }
+
+    if (World)
+    {
+        ArrayT<ClientInfoT*> DeltaClients;
+        ArrayT<NetDataT*>    DeltaDatas;
+
+        for (unsigned int i = 0; i < UpdateClientNrs.Size(); i++)
+            if (ClientInfos[UpdateClientNrs[i]]->ClientState != ClientInfoT::Zombie)
+            {
+                DeltaClients.PushBack(ClientInfos[UpdateClientNrs[i]]);
+                DeltaDatas.PushBack(&m_UnreliableDatas[i]);
+            }
+
+        World->PrepareDeltaUpdateMessages(DeltaClients);
+        m_Workers.ParallelFor(DeltaClients.Size(), [&](unsigned int i) { World->WriteClientDeltaUpdateMessages(*DeltaClients[i], *DeltaDatas[i]); }, "WriteClientDeltaUpdateMessages");
+    }
+
+    // Sende die aufgestauten ReliableData und die hier "dynamisch" erzeugten UnreliableData an die für sie bestimmten Empfänger.
+    for (unsigned int i = 0; i < UpdateClientNrs.Size(); i++)
+    {
+        const unsigned long ClientNr       = UpdateClientNrs[i];
+        ClientInfoT*        CI             = ClientInfos[ClientNr];
+        const NetDataT&     UnreliableData = m_UnreliableDatas[i];
+
+        // Note that we intentionally also send to clients in Wait4MapInfoACK and Zombie
+        // states, in order to keep the handling (with possible re-transfers) of reliable
+        // data going.
+        // TODO: Für Zombies statt rel.+unrel. Data nur leere Buffer übergeben! VORHER aber die DropMsg in ServerT::DropClient SENDEN!
+        m_NetBatch.QueueSend(CI->GameProtocol.GetTransmitData(CI->ReliableDatas, UnreliableData.Data), CI->ClientAddress);
 
         CI->ReliableDatas.Clear();
         CI->TimeSinceLastUpdate = 0;
     }
+
+    // Send the packets of all clients at once.
+    try
+    {
+        m_NetBatch.Flush();
+    }
+    catch (const NetDataT::WinSockAPIError& E) { Console->Warning(cf::va("caught a NetDataT::WinSockAPIError exception (error %u, %s)!", E.Error, E.Address.ToString())); }
+    catch (const NetDataT::MessageLength&   E) { Console->Warning(cf::va("caught a NetDataT::MessageLength exception (wanted %u, actual %u)!", E.Wanted, E.Actual)); }
+}
+
+
+void ServerT::ProcessPacket(NetDataT& InData, const NetAddressT& SenderAddress)
+{
+    if (GameProtocol2T::IsIncomingMessageOutOfBand(InData))
+    {
+        ProcessConnectionLessPacket(InData, SenderAddress);
+        return;
+    }
+
+    // ClientNr des Absenders heraussuchen
+    unsigned long ClientNr;
+
+    for (ClientNr=0; ClientNr<ClientInfos.Size(); ClientNr++)
+        if (SenderAddress==ClientInfos[ClientNr]->ClientAddress) break;
+
+    // Prüfe ClientNr
+    if (ClientNr>=ClientInfos.Size())
+    {
+        Console->Warning(cf::va("Client %s is not connected! Packet ignored!\n", SenderAddress.ToString()));
+        // Hier evtl. ein bad / disconnect / kick packet schicken?
+        return;
+    }
+
+    // Was Zombies senden, interessiert uns nicht mehr
+    if (ClientInfos[ClientNr]->ClientState==ClientInfoT::Zombie) return;
+
+    // Es ist eine gültige Nachricht (eines Online- oder Wait4MapInfoACK-Client) - bearbeite sie!
+    GlobalClientNr=ClientNr;
+    assert(ServerPtr==this);
+    ClientInfos[ClientNr]->TimeSinceLastMessage=0.0;    // Do not time-out
+    ClientInfos[ClientNr]->GameProtocol.ProcessIncomingMessage(InData, ProcessInGamePacketHelper);
 }
 
 
@@ -584,9 +629,26 @@ void ServerT::ProcessConnectionLessPacket(NetDataT& InData, const NetAddressT& S
                     break;
                 }
 
+                // The player and model names are followed by the most recent delta message format that the client can decode
+                // and the version of the network protocol. Older clients send neither, and use the (incompatible) GameProtocol1T.
+                const char ClientDeltaFormat    =InData.ReadByte();
+                const char ClientProtocolVersion=InData.ReadByte();
+
+                if (InData.ReadOfl || ClientProtocolVersion!=PROTOCOL_VERSION)
+                {
+                    Console->Print("Client uses a different network protocol version.\n");
+                    OutData.WriteByte(SC0_NACK);
+                    OutData.WriteString("Client and server use different network protocol versions.");
+                    OutData.Send(ServerSocket, SenderAddress);
+                    break;
+                }
+
                 ClientInfoT* CI = new ClientInfoT(SenderAddress, PlayerName, ModelName);
                 ClientInfos.PushBack(CI);
 
+                if (ClientDeltaFormat>=cf::Network::StateT::DELTA_FIELDS && ServerFieldDeltas.GetValueBool())
+                    CI->DeltaFormat=cf::Network::StateT::DELTA_FIELDS;
+
                 // A player entity will be assigned and the SC1_WorldInfo message be sent in the main loop.
                 // Dem Client bestätigen, daß er im Spiel ist und ab sofort in-game Packets zu erwarten hat.
                 OutData.WriteByte(SC0_ACK);
@@ -7,6 +7,7 @@ This project is licensed under the terms of the MIT license.
 #ifndef CAFU_SERVER_HPP_INCLUDED
 #define CAFU_SERVER_HPP_INCLUDED
 
+#include "Jobs/JobSystem.hpp"
 #include "Network/Network.hpp"
 #include "Util/Util.hpp"
 
@@ -67,6 +68,7 @@ class ServerT
     void operator = (const ServerT&);           ///< Use of the Assignment Operator is not allowed.
 
     void        DropClient(unsigned long ClientNr, const char* Reason);
+    void        ProcessPacket(NetDataT& InData, const NetAddressT& SenderAddress);
     void        ProcessConnectionLessPacket(NetDataT& InData, const NetAddressT& SenderAddress);
     void        ProcessInGamePacket      (NetDataT& InData);
     static void ProcessInGamePacketHelper(NetDataT& InData, unsigned long LastIncomingSequenceNr);
@@ -81,6 +83,9 @@ class ServerT
     const GuiCallbackI&        GuiCallback;
     ModelManagerT&             m_ModelMan;
     cf::GuiSys::GuiResourcesT& m_GuiRes;
+    cf::Jobs::JobSystemT       m_Workers;       ///< The threads that build the per-client update messages in parallel, see ConVar `sv_numThreads`.
+    NetBatchT                  m_NetBatch;      ///< Receives and sends the packets of all clients in batches.
+    ArrayT<NetDataT>           m_UnreliableDatas;   ///< The update messages for the clients in the current frame, kept across frames so that their memory is reused.
 };
 
 
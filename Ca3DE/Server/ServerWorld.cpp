@@ -17,6 +17,9 @@ This project is licensed under the terms of the MIT license.
 #include "../NetConst.hpp"
 #include "../Common/CompGameEntity.hpp"
 
+#include <algorithm>
+#include <mutex>
+
 
 CaServerWorldT::CaServerWorldT(const char* FileName, ModelManagerT& ModelMan, cf::GuiSys::GuiResourcesT& GuiRes)
     : Ca3DEWorldT(FileName, ModelMan, GuiRes, false, NULL),
@@ -264,44 +267,145 @@ unsigned long CaServerWorldT::WriteClientNewBaseLines(unsigned long OldBaseLineF
 }
 
 
+void CaServerWorldT::PrepareFrameInfos()
+{
+    const cf::SceneGraph::BspTreeNodeT* BspTree = m_World->m_StaticEntityData[0]->m_BspTree;
+
+    while (m_LeafEntities.Size() < BspTree->Leaves.Size())
+        m_LeafEntities.PushBackEmpty();
+
+    while (m_EntityPvsBBs.Size() < m_EngineEntities.Size())
+    {
+        m_EntityPvsBBs.PushBack(BoundingBox3dT());
+        m_EntityOrigins.PushBack(Vector3dT());
+        m_EntityLeaves.PushBackEmpty();
+    }
+
+    for (unsigned long EntityNr = 0; EntityNr < m_EngineEntities.Size(); EntityNr++)
+    {
+        if (m_EngineEntities[EntityNr] == NULL)
+        {
+            // The entity has been deleted.
+            if (m_EntityLeaves[EntityNr].Size() > 0)
+            {
+                UnlinkEntityFromLeaves(EntityNr);
+                m_EntityPvsBBs[EntityNr] = BoundingBox3dT();
+            }
+
+            continue;
+        }
+
+        IntrusivePtrT<cf::GameSys::EntityT> Ent = m_EngineEntities[EntityNr]->GetEntity();
+        BoundingBox3dT                      EntityBB = Ent->GetCullingBB(true /*WorldSpace*/).AsBoxOfDouble();
+
+        m_EntityOrigins[EntityNr] = Ent->GetTransform()->GetOriginWS().AsVectorOfDouble();
+
+        if (!EntityBB.IsInited())
+        {
+            // If the entity has no visual representation, add its origin point in order to "compensate" this.
+            // At this time, accounting for such "invisible" entities is useful, because e.g. we have no explicit
+            // "potentially audible set" for sound sources. This will also cover entities that the client *really*
+            // cannot see, e.g. player starting points and other purely informational entities, but that's ok for now.
+            EntityBB += m_EntityOrigins[EntityNr];
+        }
+
+        // Most entities don't move in most frames: only re-link those whose bounding-box has changed.
+        // (WhatLeaves() always finds at least one leaf, so an empty m_EntityLeaves means "not yet linked".)
+        const BoundingBox3dT& OldBB = m_EntityPvsBBs[EntityNr];
+
+        if (m_EntityLeaves[EntityNr].Size() > 0 && EntityBB.Min == OldBB.Min && EntityBB.Max == OldBB.Max)
+            continue;
+
+        UnlinkEntityFromLeaves(EntityNr);
+
+        m_EntityPvsBBs[EntityNr] = EntityBB;
+        BspTree->WhatLeaves(m_EntityLeaves[EntityNr], EntityBB);
+
+        for (unsigned int i = 0; i < m_EntityLeaves[EntityNr].Size(); i++)
+            m_LeafEntities[m_EntityLeaves[EntityNr][i]].PushBack(EntityNr);
+    }
+}
+
+
+void CaServerWorldT::UnlinkEntityFromLeaves(unsigned long EntityNr)
+{
+    ArrayT<unsigned long>& EntityLeaves = m_EntityLeaves[EntityNr];
+
+    for (unsigned int i = 0; i < EntityLeaves.Size(); i++)
+    {
+        ArrayT<unsigned long>& LeafEntities = m_LeafEntities[EntityLeaves[i]];
+        const int              Index        = LeafEntities.Find(EntityNr);
+
+        assert(Index >= 0);
+        LeafEntities.RemoveAt(Index);
+    }
+
+    EntityLeaves.Overwrite();
+}
+
+
 void CaServerWorldT::UpdateFrameInfo(ClientInfoT& ClientInfo) const
 {
     const EngineEntityT* EE = m_EngineEntities[ClientInfo.EntityID];
 
     if (!EE) return;
 
+    // Note that this method must not access the GameSys entities, see PrepareFrameInfos() for details.
+    assert(m_EntityPvsBBs.Size() == m_EngineEntities.Size());
+
     const cf::SceneGraph::BspTreeNodeT* BspTree = m_World->m_StaticEntityData[0]->m_BspTree;
     ArrayT<unsigned long>& NewStatePVSEntityIDs = ClientInfo.OldStatesPVSEntityIDs[m_ServerFrameNr & (ClientInfo.OldStatesPVSEntityIDs.Size() - 1)];
-    const unsigned long    ClientLeafNr         = BspTree->WhatLeaf(EE->GetEntity()->GetTransform()->GetOriginWS().AsVectorOfDouble());
+    const unsigned long    ClientLeafNr         = BspTree->WhatLeaf(m_EntityOrigins[ClientInfo.EntityID]);
 
     NewStatePVSEntityIDs.Overwrite();
 
-    // Determine all entities that are relevant for (in the PVS of) this client.
-    for (unsigned long EntityNr = 0; EntityNr < m_EngineEntities.Size(); EntityNr++)
-        if (m_EngineEntities[EntityNr] != NULL)
-        {
-            BoundingBox3dT EntityBB = m_EngineEntities[EntityNr]->GetEntity()->GetCullingBB(true /*WorldSpace*/).AsBoxOfDouble();
+    // Determine all entities that are relevant for (in the PVS of) this client:
+    // these are the entities that touch at least one leaf in the PVS of the client's leaf.
+    // This is equivalent to testing each entity's bounding-box with BspTree->IsInPVS(),
+    // but its cost depends on the number of entities that are actually visible.
+    for (unsigned long LeafNr = 0; LeafNr < m_LeafEntities.Size(); LeafNr++)
+    {
+        const ArrayT<unsigned long>& LeafEntities = m_LeafEntities[LeafNr];
 
-            if (!EntityBB.IsInited())
-            {
-                // If the entity has no visual representation, add its origin point in order to "compensate" this.
-                // At this time, accounting for such "invisible" entities is useful, because e.g. we have no explicit
-                // "potentially audible set" for sound sources. This will also cover entities that the client *really*
-                // cannot see, e.g. player starting points and other purely informational entities, but that's ok for now.
-                EntityBB += m_EngineEntities[EntityNr]->GetEntity()->GetTransform()->GetOriginWS().AsVectorOfDouble();
-            }
+        if (LeafEntities.Size() == 0) continue;
+        if (!BspTree->IsInPVS(LeafNr, ClientLeafNr)) continue;
 
-            if (BspTree->IsInPVS(EntityBB, ClientLeafNr)) NewStatePVSEntityIDs.PushBack(EntityNr);
-        }
+        for (unsigned int i = 0; i < LeafEntities.Size(); i++)
+            NewStatePVSEntityIDs.PushBack(LeafEntities[i]);
+    }
+
+    // Entities that touch several visible leaves have been added several times.
+    // Note that ArrayT::QuickSort() is not used here, because it is not thread-safe.
+    if (NewStatePVSEntityIDs.Size() > 1)
+    {
+        unsigned long* First = &NewStatePVSEntityIDs[0];
+        unsigned long* Last  = First + NewStatePVSEntityIDs.Size();
 
-    // Make sure that NewStatePVSEntityIDs is in sorted order. At the time of this writing, this is trivially the
-    // case, but it is also easy to foresee changes to the above loop that unintentionally break this rule, which is
-    // an important requirement for the code below and whose violations may cause hard to diagnose problems.
+        std::sort(First, Last);
+        NewStatePVSEntityIDs.DeleteBack(Last - std::unique(First, Last));
+    }
+
+    // Make sure that NewStatePVSEntityIDs is in sorted order. This is an important requirement for the code in
+    // WriteClientDeltaUpdateMessages(), and its violations may cause hard to diagnose problems.
     for (unsigned int i = 1; i < NewStatePVSEntityIDs.Size(); i++)
         assert(NewStatePVSEntityIDs[i - 1] < NewStatePVSEntityIDs[i]);
 }
 
 
+void CaServerWorldT::PrepareDeltaUpdateMessages(const ArrayT<ClientInfoT*>& ClientInfos) const
+{
+    for (unsigned int ClientNr = 0; ClientNr < ClientInfos.Size(); ClientNr++)
+    {
+        const ClientInfoT&           CI                   = *ClientInfos[ClientNr];
+        const ArrayT<unsigned long>& NewStatePVSEntityIDs = CI.OldStatesPVSEntityIDs[m_ServerFrameNr & (CI.OldStatesPVSEntityIDs.Size() - 1)];
+
+        // Entities that are in the PVS of several clients are serialized only once.
+        for (unsigned int i = 0; i < NewStatePVSEntityIDs.Size(); i++)
+            m_EngineEntities[NewStatePVSEntityIDs[i]]->UpdateCurrentState();
+    }
+}
+
+
 void CaServerWorldT::WriteClientDeltaUpdateMessages(const ClientInfoT& ClientInfo, NetDataT& OutData) const
 {
     const unsigned long ClientFrameNr = ClientInfo.LastKnownFrameReceived;
@@ -359,7 +463,7 @@ void CaServerWorldT::WriteClientDeltaUpdateMessages(const ClientInfoT& ClientInf
         // It seems that the only reasonable solution is to omit update messages of "other" entities:
         // Better risk not-updated fields of other entities, than getting stuck with the own entity!
         // In order to achieve this, the introduction of the 'SkipEntity' variable is the best solution I could think of.
-        // (Also see constant GameProtocol1T::MAX_MSG_SIZE that defines the maximum package size.)
+        // (Also see constant GameProtocol2T::MAX_MSG_SIZE that defines the maximum package size.)
         const bool SkipEntity = OutData.Data.Size() > 4096 && NewEntityID != ClientInfo.EntityID;
 
         if (OldEntityID == NewEntityID)
@@ -373,8 +477,14 @@ void CaServerWorldT::WriteClientDeltaUpdateMessages(const ClientInfoT& ClientInf
             // Mit anderen Worten: Der folgende Aufruf sollte NIEMALS scheitern, falls doch, ist das ein fataler Fehler, der intensives Debugging erfordert.
             // Dennoch ist es wahrscheinlich (??) nicht notwendig, den Client bei Auftreten dieses Fehler zu disconnecten.
             if (!SkipEntity)
-                if (!m_EngineEntities[NewEntityID]->WriteDeltaEntity(false /* send from baseline? */, ClientFrameNr, OutData, false))
+                if (!m_EngineEntities[NewEntityID]->WriteDeltaEntity(false /* send from baseline? */, ClientFrameNr, OutData, false, ClientInfo.DeltaFormat))
+                {
+                    // This method may run in several threads concurrently (one per client), but EnqueueString() is not thread-safe.
+                    static std::mutex EnqueueStringMutex;
+                    std::lock_guard<std::mutex> Lock(EnqueueStringMutex);
+
                     EnqueueString("SERVER ERROR: %s, L %u: NewEntityID %u, ServerFrameNr %u, ClientFrameNr %u\n", __FILE__, __LINE__, NewEntityID, m_ServerFrameNr, ClientFrameNr);
+                }
 
             OldIndex++;
             NewIndex++;
@@ -386,7 +496,7 @@ void CaServerWorldT::WriteClientDeltaUpdateMessages(const ClientInfoT& ClientInf
             // Dies ist ein neuer Entity, sende ihn von der BaseLine aus.
             // Deswegen kann der folgende Aufruf (gemäß der Spezifikation von WriteDeltaEntity()) auch nicht scheitern!
             if (!SkipEntity)
-                m_EngineEntities[NewEntityID]->WriteDeltaEntity(true /* send from baseline? */, 0, OutData, true);
+                m_EngineEntities[NewEntityID]->WriteDeltaEntity(true /* send from baseline? */, 0, OutData, true, ClientInfo.DeltaFormat);
 
             NewIndex++;
             continue;
@@ -42,6 +42,13 @@ class CaServerWorldT : public Ca3DEWorldT
     // (d.h. für solche, deren 'BaseLineFrameNr' größer (d.h. jünger) als die 'SentClientBaseLineFrameNr' ist).
     unsigned long WriteClientNewBaseLines(unsigned long OldBaseLineFrameNr, ArrayT< ArrayT<char> >& OutDatas) const;
 
+    /// Prepares the per-entity data that UpdateFrameInfo() needs.
+    /// This method must be called once after Think() and InsertHumanPlayerEntity() and before any call to UpdateFrameInfo().
+    /// It computes the world-space culling bounding-boxes of all entities once for all clients, so that
+    /// UpdateFrameInfo() does not access the GameSys entities and can be called for several clients concurrently.
+    /// The entities whose bounding-box has changed since the last call are re-linked to the BSP leaves that they touch.
+    void PrepareFrameInfos();
+
     /// This method *must* be called after Think() for each client:
     /// It updates the client's frame info corresponding to the the new/current server frame.
     ///
@@ -51,6 +58,12 @@ class CaServerWorldT : public Ca3DEWorldT
     /// (the list of entities that are relevant for the client in the new frame) accordingly.
     void UpdateFrameInfo(ClientInfoT& ClientInfo) const;
 
+    /// Prepares the entity states that WriteClientDeltaUpdateMessages() needs for the given clients.
+    /// This method must be called after UpdateFrameInfo() and before WriteClientDeltaUpdateMessages().
+    /// It serializes all entities that are in the PVS of any of the given clients (once), so that
+    /// WriteClientDeltaUpdateMessages() can be called for these clients concurrently.
+    void PrepareDeltaUpdateMessages(const ArrayT<ClientInfoT*>& ClientInfos) const;
+
     /// This method writes a delta update message for the given client into the given `OutData`.
     /// Note that this method must only be called *after* UpdateFrameInfo() has been called,
     /// because it relies on the client's frame info being up-to-date for the current frame!
@@ -66,7 +79,14 @@ class CaServerWorldT : public Ca3DEWorldT
     CaServerWorldT(const CaServerWorldT&);      ///< Use of the Copy Constructor    is not allowed.
     void operator = (const CaServerWorldT&);    ///< Use of the Assignment Operator is not allowed.
 
-    unsigned long m_ServerFrameNr;  ///< Nummer des aktuellen Frames/Zustands
+    /// Removes the entity with the given ID from all leaves in m_LeafEntities.
+    void UnlinkEntityFromLeaves(unsigned long EntityNr);
+
+    unsigned long                   m_ServerFrameNr;    ///< Nummer des aktuellen Frames/Zustands
+    ArrayT<BoundingBox3dT>          m_EntityPvsBBs;     ///< The world-space bounding-boxes that are tested against the PVS, one per entity in m_EngineEntities, as computed by PrepareFrameInfos().
+    ArrayT<Vector3dT>               m_EntityOrigins;    ///< The world-space origins of the entities in m_EngineEntities, as computed by PrepareFrameInfos().
+    ArrayT< ArrayT<unsigned long> > m_EntityLeaves;     ///< For each entity in m_EngineEntities, the BSP leaves that its m_EntityPvsBBs touches.
+    ArrayT< ArrayT<unsigned long> > m_LeafEntities;     ///< For each BSP leaf, the (unordered) IDs of the entities whose m_EntityPvsBBs touch it. This is the inverse of m_EntityLeaves.
 };
 
 #endif
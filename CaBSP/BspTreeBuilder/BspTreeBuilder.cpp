@@ -9,12 +9,17 @@ This project is licensed under the terms of the MIT license.
 #include <string.h>
 #include <stdarg.h>
 #include <algorithm>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <vector>
 
 #include "../../Common/World.hpp"   // SHOULD *NOT* BE HERE, only needed for some MapT::xy stuff!
 #include "BspTreeBuilder.hpp"
 #include "ConsoleCommands/Console.hpp"
+#include "Jobs/JobSystem.hpp"
 #include "MaterialSystem/Material.hpp"
+#include "Math3D/VertexWelder.hpp"
 #include "SceneGraph/Node.hpp"
 #include "SceneGraph/BspTreeNode.hpp"
 #include "SceneGraph/FaceNode.hpp"
@@ -67,7 +72,7 @@ static void Error(const char* ErrorText, ...)
 }
 
 
-BspTreeBuilderT::BspTreeBuilderT(cf::SceneGraph::BspTreeNodeT* BspTree_, bool MostSimpleTree, bool BspSplitFaces, bool ChopUpFaces)
+BspTreeBuilderT::BspTreeBuilderT(cf::SceneGraph::BspTreeNodeT* BspTree_, bool MostSimpleTree, bool BspSplitFaces, bool ChopUpFaces, cf::Jobs::JobSystemT& ThreadPool)
     : BspTree             (BspTree_                    ),
    // Nodes               (BspTree_->Nodes             ),
    // Leaves              (BspTree_->Leaves            ),
@@ -77,7 +82,10 @@ BspTreeBuilderT::BspTreeBuilderT(cf::SceneGraph::BspTreeNodeT* BspTree_, bool Mo
       GlobalDrawVertices  (BspTree_->GlobalDrawVertices),
       m_Option_MostSimpleTree(MostSimpleTree),
       m_Option_BspSplitFaces(BspSplitFaces),
-      m_Option_ChopUpFaces(ChopUpFaces)
+      m_Option_ChopUpFaces(ChopUpFaces),
+      m_ThreadPool(ThreadPool),
+      m_ParallelDepth(0),
+      m_ProgressCounter(0)
 {
 }
 
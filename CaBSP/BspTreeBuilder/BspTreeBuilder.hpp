@@ -11,6 +11,8 @@ This project is licensed under the terms of the MIT license.
 #include "Math3D/Polygon.hpp"
 #include "Math3D/Vector3.hpp"
 
+#include <atomic>
+
 #if defined(_WIN32) && _MSC_VER<1600
 #include "pstdint.h"            // Paul Hsieh's portable implementation of the stdint.h header.
 #else
@@ -22,6 +24,7 @@ class MaterialT;
 namespace cf { namespace SceneGraph { class BspTreeNodeT; } }
 namespace cf { namespace SceneGraph { class FaceNodeT; } }
 namespace cf { namespace SceneGraph { class GenericNodeT; } }
+namespace cf { namespace Jobs { class JobSystemT; } }
 
 
 class BspTreeBuilderT
@@ -37,7 +40,9 @@ class BspTreeBuilderT
     ArrayT<VectorT>&                             GlobalDrawVertices;
 
 
-    BspTreeBuilderT(cf::SceneGraph::BspTreeNodeT* BspTree_, bool MostSimpleTree, bool BspSplitFaces, bool ChopUpFaces);
+    /// The constructor.
+    /// The ThreadPool is used to build the BSP trees in parallel. The resulting trees are the same for any number of threads.
+    BspTreeBuilderT(cf::SceneGraph::BspTreeNodeT* BspTree_, bool MostSimpleTree, bool BspSplitFaces, bool ChopUpFaces, cf::Jobs::JobSystemT& ThreadPool);
 
     void Build(bool IsWorldspawn,
                const ArrayT<Vector3dT>& FloodFillSources_,
@@ -115,9 +120,13 @@ class BspTreeBuilderT
 
     private:
 
-    Plane3T<double> ChooseSplitPlane(const ArrayT<unsigned long>& FaceSet) const;
-    void BuildBSPTree_SplitFaces(const ArrayT<unsigned long>& FaceSet);
-    void BuildBSPTree_NeverSplit(const ArrayT<unsigned long>& FaceSet, const ArrayT<cf::SceneGraph::FaceNodeT*>& SplitFaces);
+    struct BuildFaceT;
+    struct BuildNodeT;
+    struct SubtreeT;
+
+    Plane3T<double> ChooseSplitPlane(const ArrayT<BuildFaceT>& FaceSet, bool Parallel) const;
+    BuildNodeT* BuildBSPTree_Recursive(const ArrayT<BuildFaceT>& FaceSet, unsigned int Depth, ArrayT<SubtreeT>* Subtrees);
+    void FlattenBSPTree(const BuildNodeT* BuildNode);
     void FillBSPLeaves(unsigned long NodeNr, const ArrayT<cf::SceneGraph::FaceNodeT*>& Face2, const ArrayT<unsigned long>& FaceSet, const BoundingBox3T<double>& BB);
     void CreateLeafPortals(unsigned long LeafNr, const ArrayT< Plane3T<double> >& NodeList);
     void BuildBSPPortals(unsigned long NodeNr, ArrayT< Plane3T<double> >& NodeList);
@@ -129,6 +138,10 @@ class BspTreeBuilderT
     const bool m_Option_MostSimpleTree;
     const bool m_Option_BspSplitFaces;
     const bool m_Option_ChopUpFaces;
+
+    cf::Jobs::JobSystemT&      m_ThreadPool;        ///< The threads that build the BSP trees.
+    unsigned int               m_ParallelDepth;     ///< The depth at which the subtrees of the BSP tree are built in parallel, 0 for not at all.
+    std::atomic<unsigned long> m_ProgressCounter;   ///< The number of faces that have been assigned to nodes so far.
 };
 
 #endif
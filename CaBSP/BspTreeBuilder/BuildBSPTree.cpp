@@ -5,22 +5,161 @@ This project is licensed under the terms of the MIT license.
 */
 
 
+/// A polygon along with its bounding box and bounding sphere, which allow to quickly classify it against planes.
+struct BoundedPolygonT
+{
+    const Polygon3T<double>* Polygon;   ///< The polygon.
+    Vector3dT                Min;       ///< The minimum coordinates of the vertices of the polygon.
+    Vector3dT                Max;       ///< The maximum coordinates of the vertices of the polygon.
+    Vector3dT                Center;    ///< The center of the bounding box of the polygon.
+    double                   Radius;    ///< The radius of the sphere around Center that contains all vertices of the polygon.
+    double                   Area;      ///< The area of the polygon.
+
+    BoundedPolygonT() : Polygon(NULL), Radius(0.0), Area(0.0) { }
+
+    BoundedPolygonT(const Polygon3T<double>& Polygon_)
+        : Polygon(&Polygon_), Radius(0.0), Area(Polygon_.GetArea())
+    {
+        const ArrayT<VectorT>& Vertices=Polygon->Vertices;
+
+        Min=Vertices[0];
+        Max=Vertices[0];
+
+        for (unsigned long VertexNr=1; VertexNr<Vertices.Size(); VertexNr++)
+            for (unsigned int i=0; i<3; i++)
+            {
+                if (Vertices[VertexNr][i]<Min[i]) Min[i]=Vertices[VertexNr][i];
+                if (Vertices[VertexNr][i]>Max[i]) Max[i]=Vertices[VertexNr][i];
+            }
+
+        Center=(Min+Max)*0.5;
+
+        for (unsigned long VertexNr=0; VertexNr<Vertices.Size(); VertexNr++)
+            Radius=std::max(Radius, length(Vertices[VertexNr]-Center));
+    }
+
+    /// Returns exactly the same result as Polygon->WhatSide(P, MapT::RoundEpsilon), but decides the
+    /// common cases that the polygon is entirely in front of or behind P without looking at its vertices.
+    /// @param P      The plane to classify the polygon against.
+    /// @param Axis   The result of GetAxis(P).
+    Polygon3T<double>::SideT WhatSide(const Plane3T<double>& P, int Axis) const
+    {
+        const double Eps=MapT::RoundEpsilon;
+
+        if (Axis>=0)
+        {
+            // The normal of P is a coordinate axis, so P.GetDistance() computes exactly the coordinate of a vertex
+            // (or its negation) minus P.Dist. The extreme coordinates thus tell exactly whether all vertices are
+            // in front of or behind P, because rounding the difference is monotonic.
+            const unsigned int a=Axis % 3;
+
+            if (Axis<3)
+            {
+                if (Min[a]-P.Dist> Eps) return Polygon3T<double>::Front;
+                if (Max[a]-P.Dist<-Eps) return Polygon3T<double>::Back;
+            }
+            else
+            {
+                if (-Max[a]-P.Dist> Eps) return Polygon3T<double>::Front;
+                if (-Min[a]-P.Dist<-Eps) return Polygon3T<double>::Back;
+            }
+        }
+        else
+        {
+            // Slack generously covers the rounding errors in the computation of Center, Radius and the distances.
+            const double Slack=1.0e-6;
+            const double Dist =P.GetDistance(Center);
+
+            if (Dist-Radius> Eps+Slack) return Polygon3T<double>::Front;
+            if (Dist+Radius<-Eps-Slack) return Polygon3T<double>::Back;
+        }
+
+        return Polygon->WhatSide(P, Eps);
+    }
+
+    /// Returns 0, 1 or 2 if the normal of P is the positive x-, y- or z-axis, 3, 4 or 5 if it is the negative x-, y- or z-axis,
+    /// and -1 otherwise.
+    static int GetAxis(const Plane3T<double>& P)
+    {
+        for (unsigned int a=0; a<3; a++)
+            if (P.Normal[(a+1) % 3]==0.0 && P.Normal[(a+2) % 3]==0.0)
+            {
+                if (P.Normal[a]== 1.0) return a;
+                if (P.Normal[a]==-1.0) return a+3;
+            }
+
+        return -1;
+    }
+};
+
+
+/// A face in the face set of a node while the BSP tree is built.
+struct BspTreeBuilderT::BuildFaceT
+{
+    cf::SceneGraph::FaceNodeT* Face;        ///< The face. This is the face as a whole that ChooseSplitPlane() considers.
+    cf::SceneGraph::FaceNodeT* Fragment;    ///< The part of the face that is relevant at this node: the face itself if faces are split, a temporary fragment otherwise.
+    BoundedPolygonT            FacePoly;    ///< The polygon of Face.
+    BoundedPolygonT            FragPoly;    ///< The polygon of Fragment.
+
+    BuildFaceT() : Face(NULL), Fragment(NULL) { }
+
+    BuildFaceT(cf::SceneGraph::FaceNodeT* Face_)
+        : Face(Face_), Fragment(Face_), FacePoly(Face_->Polygon), FragPoly(FacePoly) { }
+
+    BuildFaceT(const BuildFaceT& Whole, cf::SceneGraph::FaceNodeT* Fragment_)
+        : Face(Whole.Face), Fragment(Fragment_), FacePoly(Whole.FacePoly), FragPoly(Fragment_->Polygon) { }
+};
+
+
+/// A node of the BSP tree while it is built. The nodes are only turned into BspTree->Nodes and BspTree->Leaves
+/// when the entire tree is complete, so that their numbering doesn't depend on the order in which the subtrees are built.
+struct BspTreeBuilderT::BuildNodeT
+{
+    Plane3T<double>                    Plane;       ///< The split plane of this node.
+    BuildNodeT*                        Front;       ///< The front child of this node, or NULL if it is a leaf.
+    BuildNodeT*                        Back;        ///< The back child of this node, or NULL if it is a leaf.
+    ArrayT<cf::SceneGraph::FaceNodeT*> NewFaces;    ///< The faces that splits at this node created, to be appended to FaceChildren.
+    ArrayT<cf::SceneGraph::FaceNodeT*> Fragments;   ///< The temporary fragments of faces that are never split, to be deleted when the children are built.
+
+    BuildNodeT() : Front(NULL), Back(NULL) { }
+
+    ~BuildNodeT()
+    {
+        for (unsigned long FaceNr=0; FaceNr<Fragments.Size(); FaceNr++)
+            delete Fragments[FaceNr];
+
+        delete Front;
+        delete Back;
+    }
+};
+
+
+/// A subtree whose building has been deferred, so that it can be built in parallel with the other deferred subtrees.
+struct BspTreeBuilderT::SubtreeT
+{
+    BuildNodeT**       Node;        ///< Where the root node of the subtree is to be stored when it has been built.
+    ArrayT<BuildFaceT> FaceSet;     ///< The faces to build the subtree of.
+};
+
+
 // Für g++ darf diese Struktur nicht lokal in 'ChooseSplitPlane()' definiert sein,
 // da sie ansonsten nicht als Template-Argument verwendet werden kann.
 struct PlaneInfoT
 {
     Plane3T<double> Plane;
+    int             Axis;            // see BoundedPolygonT::GetAxis()
     double          TotalArea;
     int             Balance;
     double          NrOfSplits;      // unsigned long
     double          AxisAligned;     // bool
 
-    PlaneInfoT() : TotalArea(0), Balance(0), NrOfSplits(0), AxisAligned(0) { }
+    PlaneInfoT() : Axis(-1), TotalArea(0), Balance(0), NrOfSplits(0), AxisAligned(0) { }
 };
 
 
 // Subroutine zu BuildBSPTree. Sucht unter den Faces des FaceSet die beste Splitplane aus.
-Plane3T<double> BspTreeBuilderT::ChooseSplitPlane(const ArrayT<unsigned long>& FaceSet) const
+// If Parallel is true, the planes are rated on all threads of the thread pool.
+Plane3T<double> BspTreeBuilderT::ChooseSplitPlane(const ArrayT<BuildFaceT>& FaceSet, bool Parallel) const
 {
     // Im FaceSet können mehrere Faces in einer Plane liegen. Daher zuerst ein PlaneSet bilden!
     ArrayT<PlaneInfoT> PlaneSet;
@@ -31,7 +170,7 @@ Plane3T<double> BspTreeBuilderT::ChooseSplitPlane(const ArrayT<unsigned long>& F
 
         for (PlaneNr=0; PlaneNr<PlaneSet.Size(); PlaneNr++)
         {
-            Polygon3T<double>::SideT Side=FaceChildren[FaceSet[FaceNr]]->Polygon.WhatSide(PlaneSet[PlaneNr].Plane, MapT::RoundEpsilon);
+            Polygon3T<double>::SideT Side=FaceSet[FaceNr].FacePoly.WhatSide(PlaneSet[PlaneNr].Plane, PlaneSet[PlaneNr].Axis);
 
             if (Side==Polygon3T<double>::InIdentical || Side==Polygon3T<double>::InMirrored) break;
         }
@@ -39,47 +178,65 @@ Plane3T<double> BspTreeBuilderT::ChooseSplitPlane(const ArrayT<unsigned long>& F
         if (PlaneNr<PlaneSet.Size()) continue;
 
         PlaneSet.PushBackEmpty();
-        PlaneSet[PlaneSet.Size()-1].Plane=FaceChildren[FaceSet[FaceNr]]->Polygon.Plane;
+        PlaneSet[PlaneSet.Size()-1].Plane=FaceSet[FaceNr].Face->Polygon.Plane;
+        PlaneSet[PlaneSet.Size()-1].Axis =BoundedPolygonT::GetAxis(PlaneSet[PlaneSet.Size()-1].Plane);
     }
 
 
-    double MaxTotalArea =1; // Wenn man hier überall 0 einträgt, könnte es unten zu einer Division
-    int    WorstBalance =1; // durch Null kommen. Das wird durch diese Manipulation vermieden, und
-    double MaxNrOfSplits=1; // am Endergebnis ändert sich dadurch ja nichts!
-
-    for (unsigned long PlaneNr=0; PlaneNr<PlaneSet.Size(); PlaneNr++)
+    // Rate each plane. The planes are independent of each other, so they can be rated in parallel.
+    const std::function<void (unsigned int)> RatePlane=[&FaceSet, &PlaneSet](unsigned int PlaneNr)
     {
+        PlaneInfoT& PI=PlaneSet[PlaneNr];
+
         for (unsigned long FaceNr=0; FaceNr<FaceSet.Size(); FaceNr++)
         {
-            switch (FaceChildren[FaceSet[FaceNr]]->Polygon.WhatSide(PlaneSet[PlaneNr].Plane, MapT::RoundEpsilon))
+            switch (FaceSet[FaceNr].FacePoly.WhatSide(PI.Plane, PI.Axis))
             {
                 case Polygon3T<double>::Back:
                 case Polygon3T<double>::BackAndOn:
-                    PlaneSet[PlaneNr].Balance--;
+                    PI.Balance--;
                     break;
 
                 case Polygon3T<double>::Front:
                 case Polygon3T<double>::FrontAndOn:
-                    PlaneSet[PlaneNr].Balance++;
+                    PI.Balance++;
                     break;
 
                 case Polygon3T<double>::Both:
                 case Polygon3T<double>::BothAndOn:
-                    PlaneSet[PlaneNr].NrOfSplits++;
+                    PI.NrOfSplits++;
                     break;
 
                 default:
-                    PlaneSet[PlaneNr].TotalArea+=FaceChildren[FaceSet[FaceNr]]->Polygon.GetArea();
+                    PI.TotalArea+=FaceSet[FaceNr].FacePoly.Area;
                     break;
             }
         }
 
-        PlaneSet[PlaneNr].Balance=abs(PlaneSet[PlaneNr].Balance);
+        PI.Balance=abs(PI.Balance);
 
-        if (fabs(PlaneSet[PlaneNr].Plane.Normal.x)==1 ||
-            fabs(PlaneSet[PlaneNr].Plane.Normal.y)==1 ||
-            fabs(PlaneSet[PlaneNr].Plane.Normal.z)==1) PlaneSet[PlaneNr].AxisAligned=1;
+        if (fabs(PI.Plane.Normal.x)==1 ||
+            fabs(PI.Plane.Normal.y)==1 ||
+            fabs(PI.Plane.Normal.z)==1) PI.AxisAligned=1;
+    };
 
+    if (Parallel && double(PlaneSet.Size())*FaceSet.Size()>100000.0)
+    {
+        m_ThreadPool.ParallelFor(PlaneSet.Size(), RatePlane, "RatePlanes");
+    }
+    else
+    {
+        for (unsigned long PlaneNr=0; PlaneNr<PlaneSet.Size(); PlaneNr++)
+            RatePlane(PlaneNr);
+    }
+
+
+    double MaxTotalArea =1; // Wenn man hier überall 0 einträgt, könnte es unten zu einer Division
+    int    WorstBalance =1; // durch Null kommen. Das wird durch diese Manipulation vermieden, und
+    double MaxNrOfSplits=1; // am Endergebnis ändert sich dadurch ja nichts!
+
+    for (unsigned long PlaneNr=0; PlaneNr<PlaneSet.Size(); PlaneNr++)
+    {
         if (PlaneSet[PlaneNr].TotalArea >MaxTotalArea ) MaxTotalArea =PlaneSet[PlaneNr].TotalArea;
         if (PlaneSet[PlaneNr].Balance   >WorstBalance ) WorstBalance =PlaneSet[PlaneNr].Balance;
         if (PlaneSet[PlaneNr].NrOfSplits>MaxNrOfSplits) MaxNrOfSplits=PlaneSet[PlaneNr].NrOfSplits;
@@ -108,10 +265,10 @@ Plane3T<double> BspTreeBuilderT::ChooseSplitPlane(const ArrayT<unsigned long>& F
 }
 
 
-/// Recursively creates a BSP tree from the given faces, splitting the input faces as necessary.
+/// Recursively creates a BSP tree from the given faces.
 ///
-/// When a chosen split plane intersects some of the other faces, this method "physically" splits
-/// the origial input faces. Some notable properties of this approach:
+/// If m_Option_BspSplitFaces is set and a chosen split plane intersects some of the other faces,
+/// this method "physically" splits the origial input faces. Some notable properties of this approach:
 ///
 ///   - The case of face 4 in the diagram in file `BuildBSPTree.dia` is naturally handled,
 ///     no special-case considerations required.
@@ -123,35 +280,55 @@ Plane3T<double> BspTreeBuilderT::ChooseSplitPlane(const ArrayT<unsigned long>& F
 ///   - Each face (possibly a split result) is associated with exactly one node, but even with
 ///     this method, possibly with multiple leaves, e.g. face 1 in `BuildBSPTree.dia`.
 ///
-///   - IMPORTANT: In the implementation below, it is NOT possible to assign one face index to
-///     both FrontFS and BackFS, because our recursing into and processing of the FrontFS may
-///     split the face and replace the face at the index with one of its fragments, leaving the
-///     subsequent processing of the BackFS to find there something entirely unexpected!
+///   - IMPORTANT: It is NOT possible to assign one face to both FrontFS and BackFS, because
+///     our recursing into and processing of the FrontFS may split the face and modify it,
+///     leaving the subsequent processing of the BackFS to find there something entirely unexpected!
+///
+/// Otherwise, this method has the front and back sides reference temporary fragments of the
+/// original intersecting faces, but does not modify the faces in any way.
+/// Some notable properties of this approach:
+///
+///   - Guaranteed to not introduce any new rounding errors.
+///
+///   - Having a face being referenced on the front and back sides of a node is only possible
+///     because the faces are not modified.
+///
+///   - However it *is* necessary to temporarily track physically split faces while the tree is
+///     created. See the case of face 4 in the diagram in file `BuildBSPTree.dia` for an example.
+///
+/// In either case, the face sets of the front and back subtrees never share a face that is modified,
+/// so the subtrees can be built in parallel.
 ///
 /// @param FaceSet
-///     The indices (into FaceChildren) of the faces to create this BSP subtree of.
+///     The faces to create this BSP subtree of.
+///
+/// @param Depth
+///     The depth of this subtree in the BSP tree.
+///
+/// @param Subtrees
+///     If non-NULL, the subtrees at depth m_ParallelDepth are not built, but added to this array,
+///     so that the caller can build them in parallel. Also, the split planes are chosen in parallel.
 ///
-void BspTreeBuilderT::BuildBSPTree_SplitFaces(const ArrayT<unsigned long>& FaceSet)
+/// @returns the root node of the new BSP subtree.
+///
+BspTreeBuilderT::BuildNodeT* BspTreeBuilderT::BuildBSPTree_Recursive(const ArrayT<BuildFaceT>& FaceSet, unsigned int Depth, ArrayT<SubtreeT>* Subtrees)
 {
-    ArrayT<cf::SceneGraph::BspTreeNodeT::NodeT>& Nodes =BspTree->Nodes;
-    ArrayT<cf::SceneGraph::BspTreeNodeT::LeafT>& Leaves=BspTree->Leaves;
-
-    static unsigned long ProgressCounter;
-    if (FaceSet.Size()==FaceChildren.Size()) ProgressCounter=0;
-
-    Console->Print(cf::va("%5.1f%%\r", (double)ProgressCounter/FaceChildren.Size()*100.0));
+    // Only the thread that builds the upper levels of the tree reports the progress, see BuildBSPTree().
+    if (Subtrees || m_ParallelDepth==0) Console->Print(cf::va("%5.1f%%\r", (double)m_ProgressCounter/FaceChildren.Size()*100.0));
     // fflush(stdout);      // The stdout console auto-flushes the output.
 
-    Nodes.PushBackEmpty();
-    const unsigned long NodeNr=Nodes.Size()-1;
-    Nodes[NodeNr].Plane=ChooseSplitPlane(FaceSet);
+    BuildNodeT* Node=new BuildNodeT();
+    Node->Plane=ChooseSplitPlane(FaceSet, Subtrees!=NULL);
 
-    ArrayT<unsigned long> FrontFS;
-    ArrayT<unsigned long> BackFS;
+    const int          Axis=BoundedPolygonT::GetAxis(Node->Plane);
+    ArrayT<BuildFaceT> FrontFS;
+    ArrayT<BuildFaceT> BackFS;
 
     for (unsigned long FaceNr=0; FaceNr<FaceSet.Size(); FaceNr++)
     {
-        switch (FaceChildren[FaceSet[FaceNr]]->Polygon.WhatSide(Nodes[NodeNr].Plane, MapT::RoundEpsilon))
+        cf::SceneGraph::FaceNodeT* Face=FaceSet[FaceNr].Fragment;
+
+        switch (FaceSet[FaceNr].FragPoly.WhatSide(Node->Plane, Axis))
         {
             case Polygon3T<double>::Front:
             case Polygon3T<double>::FrontAndOn:
@@ -166,201 +343,134 @@ void BspTreeBuilderT::BuildBSPTree_SplitFaces(const ArrayT<unsigned long>& FaceS
             case Polygon3T<double>::Both:
             case Polygon3T<double>::BothAndOn:
             {
-                const ArrayT< Polygon3T<double> > SplitResult = FaceChildren[FaceSet[FaceNr]]->Polygon.GetSplits(Nodes[NodeNr].Plane, MapT::RoundEpsilon);
+                const ArrayT< Polygon3T<double> > SplitResult = Face->Polygon.GetSplits(Node->Plane, MapT::RoundEpsilon);
 
-                if (SplitResult[0].IsValid(MapT::RoundEpsilon, MapT::MinVertexDist) &&
-                    SplitResult[1].IsValid(MapT::RoundEpsilon, MapT::MinVertexDist))     // Prüfe insb. auf zusammenfallende Vertices.
+                if (m_Option_BspSplitFaces)
                 {
-                    // Keine zusammenfallenden Vertices -- alles OK.
-                    FaceChildren.PushBack(new cf::SceneGraph::FaceNodeT(*FaceChildren[FaceSet[FaceNr]]));
-
-                    FaceChildren[FaceSet[FaceNr]      ]->Polygon = SplitResult[0];
-                    FaceChildren[FaceChildren.Size()-1]->Polygon = SplitResult[1];
+                    cf::SceneGraph::FaceNodeT* NewFace=new cf::SceneGraph::FaceNodeT(*Face);
+
+                    if (SplitResult[0].IsValid(MapT::RoundEpsilon, MapT::MinVertexDist) &&
+                        SplitResult[1].IsValid(MapT::RoundEpsilon, MapT::MinVertexDist))     // Prüfe insb. auf zusammenfallende Vertices.
+                    {
+                        // Keine zusammenfallenden Vertices -- alles OK.
+                        Face   ->Polygon = SplitResult[0];
+                        NewFace->Polygon = SplitResult[1];
+                    }
+                    else
+                    {
+                        // Wir haben den problematischen Fall des spitzen Keils gefunden. Was tun?
+                        // Es scheint am sinnvollsten zu sein, die Face zu verdoppeln und sie dann sowohl dem FrontFS als auch dem BackFS
+                        // zuzuordnen. Die negativen Konsequenzen aller anderen Alternativen sind nicht überschaubar.
+                        // Divergenz dürfte trotz der Verdopplung nicht eintreten können (gültige Faces vorausgesetzt)!
+                        //    Haken: Die Face wird in der Engine idR zweimal gerendert werden, weil wir hier eine echte Kopie machen,
+                        // und Kopie und Original danach nichts mehr voneinander wissen.
+                        // Sowohl FrontFS als auch BackFS dieselbe Face zuzuordnen geht natürlich auch nicht,
+                        // weil später in der Rekursion ja ein weiterer Split dieser Face entstehen könnte, z.B. auf der
+                        // Vorderseite der Node->Plane, wodurch die weiteren Berechnungen auf der Rückseite eine
+                        // "faule" Face vorfinden.
+                        //    Lösung 1: Splitte niemals, genau wie Doom3 (siehe !m_Option_BspSplitFaces).
+                        //    Lösung 2: Wähle ein FS, und ordene die Face dort zu. Wenn z.B. die FrontFace valid und die BackFace
+                        // invalid ist, ordne die Face dem FrontFS zu, und umgekehrt. Sind beide ungültig, wähle z.B. gemäß
+                        // dem größeren Flächeninhalt, oder einfach beliebig.
+                    }
+
+                    // The new face is appended to FaceChildren only when the whole tree is complete, see FlattenBSPTree().
+                    Node->NewFaces.PushBack(NewFace);
+
+                    FrontFS.PushBack(BuildFaceT(Face));
+                    BackFS .PushBack(BuildFaceT(NewFace));
                 }
                 else
                 {
-                    // Wir haben den problematischen Fall des spitzen Keils gefunden. Was tun?
-                    // Es scheint am sinnvollsten zu sein, die Face zu verdoppeln und sie dann sowohl dem FrontFS als auch dem BackFS
-                    // zuzuordnen. Die negativen Konsequenzen aller anderen Alternativen sind nicht überschaubar.
-                    // Divergenz dürfte trotz der Verdopplung nicht eintreten können (gültige Faces vorausgesetzt)!
-                    //    Haken: Die Face wird in der Engine idR zweimal gerendert werden, weil wir hier eine echte Kopie machen,
-                    // und Kopie und Original danach nichts mehr voneinander wissen.
-                    // Sowohl FrontFS als auch BackFS die FaceSet[FaceNr] Nummer zuzuordnen geht natürlich auch nicht,
-                    // weil später in der Rekursion ja ein weiterer Split dieser Face entstehen könnte, z.B. auf der
-                    // Vorderseite der Nodes[NodeNr].Plane, wodurch die weiteren Berechnungen auf der Rückseite eine
-                    // "faule" Face vorfinden.
-                    //    Lösung 1: Splitte niemals, genau wie Doom3. Das Faces Array bleibt dadurch konstant, und wir können doch
-                    // sowohl dem FrontFS als auch BackFS die FaceSet[FaceNr] Nummer zuzuordnen. Ausprobieren!
-                    //    Lösung 2: Wähle ein FS, und ordene die Face dort zu. Wenn z.B. die FrontFace valid und die BackFace
-                    // invalid ist, ordne die Face dem FrontFS zu, und umgekehrt. Sind beide ungültig, wähle z.B. gemäß
-                    // dem größeren Flächeninhalt, oder einfach beliebig.
-                    FaceChildren.PushBack(new cf::SceneGraph::FaceNodeT(*FaceChildren[FaceSet[FaceNr]]));
+                    // Unfortunately, a check (e.g. for collapsing vertices) such as
+                    //
+                    //     if (SplitResult[0].IsValid(MapT::RoundEpsilon, MapT::MinVertexDist) &&
+                    //         SplitResult[1].IsValid(MapT::RoundEpsilon, MapT::MinVertexDist)) ...;
+                    //
+                    // can still fail, leaving us in a difficult situation. Fortunately, like in FillBSPLeaves()
+                    // there is no need for this check here, because the split results are not propagated to
+                    // any outside code and we have no "dangerous" operations on them here. We only need them
+                    // to handle cases like that of face 4 in `BuildBSPTree.dia`.
+                    //
+                    // First copy the face, then replace its Polygon member.
+                    // This makes sure that *other* members in the FaceNodeT are preserved.
+                    cf::SceneGraph::FaceNodeT* FrontFace = new cf::SceneGraph::FaceNodeT(*Face); FrontFace->Polygon = SplitResult[0];
+                    cf::SceneGraph::FaceNodeT* BackFace  = new cf::SceneGraph::FaceNodeT(*Face); BackFace ->Polygon = SplitResult[1];
+
+                    Node->Fragments.PushBack(FrontFace);
+                    Node->Fragments.PushBack(BackFace);
+
+                    FrontFS.PushBack(BuildFaceT(FaceSet[FaceNr], FrontFace));
+                    BackFS .PushBack(BuildFaceT(FaceSet[FaceNr], BackFace));
                 }
-
-                FrontFS.PushBack(FaceSet[FaceNr]);
-                BackFS .PushBack(FaceChildren.Size()-1);
                 break;
             }
 
             default:
-                ProgressCounter++;
+                m_ProgressCounter++;
                 break;
         }
     }
 
 
-    if (FrontFS.Size())
+    if (Subtrees && Depth+1>=m_ParallelDepth)
     {
-        Nodes[NodeNr].FrontChild=Nodes.Size();
-        Nodes[NodeNr].FrontIsLeaf=false;
+        // Defer building the children, so that the caller can build them in parallel.
+        // The fragments are kept until Node is deleted.
+        if (FrontFS.Size())
+        {
+            Subtrees->PushBackEmpty();
+            Subtrees->operator[](Subtrees->Size()-1).Node=&Node->Front;
+            Subtrees->operator[](Subtrees->Size()-1).FaceSet=FrontFS;
+        }
 
-        BuildBSPTree_SplitFaces(FrontFS);
-    }
-    else
-    {
-        Leaves.PushBackEmpty();
+        if (BackFS.Size())
+        {
+            Subtrees->PushBackEmpty();
+            Subtrees->operator[](Subtrees->Size()-1).Node=&Node->Back;
+            Subtrees->operator[](Subtrees->Size()-1).FaceSet=BackFS;
+        }
 
-        Nodes[NodeNr].FrontChild=Leaves.Size()-1;
-        Nodes[NodeNr].FrontIsLeaf=true;
+        return Node;
     }
 
-    if (BackFS.Size())
-    {
-        Nodes[NodeNr].BackChild=Nodes.Size();
-        Nodes[NodeNr].BackIsLeaf=false;
+    if (FrontFS.Size()) Node->Front=BuildBSPTree_Recursive(FrontFS, Depth+1, Subtrees);
+    if (BackFS .Size()) Node->Back =BuildBSPTree_Recursive(BackFS,  Depth+1, Subtrees);
 
-        BuildBSPTree_SplitFaces(BackFS);
-    }
-    else
+    if (!Subtrees)
     {
-        Leaves.PushBackEmpty();
+        // The children are complete, so the fragments are not needed any longer.
+        for (unsigned long FaceNr=0; FaceNr<Node->Fragments.Size(); FaceNr++)
+            delete Node->Fragments[FaceNr];
 
-        Nodes[NodeNr].BackChild=Leaves.Size()-1;
-        Nodes[NodeNr].BackIsLeaf=true;
+        Node->Fragments.Clear();
     }
+
+    return Node;
 }
 
 
-/// Recursively creates a BSP tree from the given faces, never splitting the original input faces.
-///
-/// When a chosen split plane intersects some of the other faces, this method has the front and
-/// back sides reference the original intersecting faces, but does not modify them in any way.
-/// Some notable properties of this approach:
-///
-///   - Guaranteed to not introduce any new rounding errors.
-///
-///   - Having a face being referenced on the front and back sides of a node is only possible
-///     because the faces are not modified. See the code below for details.
-///
-///   - However it *is* necessary to temporarily track physically split faces while the tree is
-///     created. See the case of face 4 in the diagram in file `BuildBSPTree.dia` for an example.
-///
-///   - We don't need access to the FaceChildren array at all. Thus, it would be possible to
-///     turn this method and ChooseSplitPlane() into "static" functions that operate on the
-///     input parameters only.
-///
-/// @param FaceSet
-///     The indices (into FaceChildren) of the faces to create this BSP subtree of.
-///
-/// @param SplitFaces
-///     Paralleling the FaceSet array, SplitFaces[i] is the currently relevant "fragment"
-///     of FaceChildren[FaceSet[i]].
-///     See the diagram in file `BuildBSPTree.dia` for additional details.
-///
-void BspTreeBuilderT::BuildBSPTree_NeverSplit(const ArrayT<unsigned long>& FaceSet, const ArrayT<cf::SceneGraph::FaceNodeT*>& SplitFaces)
+/// Turns the given BSP subtree into BspTree->Nodes and BspTree->Leaves, and appends the faces that were created by
+/// splits to FaceChildren. The nodes, leaves and faces are numbered in depth-first order, front before back,
+/// which is the order in which a serial, depth-first recursion creates them.
+void BspTreeBuilderT::FlattenBSPTree(const BuildNodeT* BuildNode)
 {
     ArrayT<cf::SceneGraph::BspTreeNodeT::NodeT>& Nodes =BspTree->Nodes;
     ArrayT<cf::SceneGraph::BspTreeNodeT::LeafT>& Leaves=BspTree->Leaves;
 
-    static unsigned long ProgressCounter;
-    if (FaceSet.Size()==FaceChildren.Size()) ProgressCounter=0;
-
-    Console->Print(cf::va("%5.1f%%\r", (double)ProgressCounter/FaceChildren.Size()*100.0));
-    // fflush(stdout);      // The stdout console auto-flushes the output.
-
     Nodes.PushBackEmpty();
     const unsigned long NodeNr=Nodes.Size()-1;
-    Nodes[NodeNr].Plane=ChooseSplitPlane(FaceSet);
+    Nodes[NodeNr].Plane=BuildNode->Plane;
 
-    ArrayT<cf::SceneGraph::FaceNodeT*> DeleteList;
-    assert(FaceSet.Size() == SplitFaces.Size());
+    for (unsigned long FaceNr=0; FaceNr<BuildNode->NewFaces.Size(); FaceNr++)
+        FaceChildren.PushBack(BuildNode->NewFaces[FaceNr]);
 
-    ArrayT<unsigned long>              FrontFS;
-    ArrayT<cf::SceneGraph::FaceNodeT*> FrontFaces;
-
-    ArrayT<unsigned long>              BackFS;
-    ArrayT<cf::SceneGraph::FaceNodeT*> BackFaces;
-
-    for (unsigned long FaceNr = 0; FaceNr < SplitFaces.Size(); FaceNr++)
-    {
-        switch (SplitFaces[FaceNr]->Polygon.WhatSide(Nodes[NodeNr].Plane, MapT::RoundEpsilon))
-        {
-            case Polygon3T<double>::Front:
-            case Polygon3T<double>::FrontAndOn:
-                FrontFS.PushBack(FaceSet[FaceNr]);
-                FrontFaces.PushBack(SplitFaces[FaceNr]);
-                break;
-
-            case Polygon3T<double>::Back:
-            case Polygon3T<double>::BackAndOn:
-                BackFS.PushBack(FaceSet[FaceNr]);
-                BackFaces.PushBack(SplitFaces[FaceNr]);
-                break;
-
-            case Polygon3T<double>::Both:
-            case Polygon3T<double>::BothAndOn:
-            {
-                // Polygon.WhatSide() already has determined that the face is on both sides of the plane.
-                // Logically, this implies that the call to GetSplits() "must" succeed, as WhatSide()
-                // and GetSplits() are quasi "atomic".
-                // TODO: Are we able to get rid of WhatSide() in favour if GetSplits()?
-                //
-                // Unfortunately, a check (e.g. for collapsing vertices) such as
-                //
-                //     if (SplitResult[0].IsValid(MapT::RoundEpsilon, MapT::MinVertexDist) &&
-                //         SplitResult[1].IsValid(MapT::RoundEpsilon, MapT::MinVertexDist)) ...;
-                //
-                // can still fail, leaving us in a difficult situation. Fortunately, like in FillBSPLeaves()
-                // there is no need for this check here, because the split results are not propagated to
-                // any outside code and we have no "dangerous" operations on them here. We only need them
-                // to handle cases like that of face 4 in `BuildBSPTree.dia`.
-                const ArrayT< Polygon3T<double> > SplitResult = SplitFaces[FaceNr]->Polygon.GetSplits(Nodes[NodeNr].Plane, MapT::RoundEpsilon);
-
-                // First copy SplitFaces[FaceNr], then replace its Polygon member.
-                // This makes sure that *other* members in the FaceNodeT are preserved.
-                cf::SceneGraph::FaceNodeT* FrontFace = new cf::SceneGraph::FaceNodeT(*SplitFaces[FaceNr]); FrontFace->Polygon = SplitResult[0];
-                cf::SceneGraph::FaceNodeT* BackFace  = new cf::SceneGraph::FaceNodeT(*SplitFaces[FaceNr]); BackFace ->Polygon = SplitResult[1];
-
-                // FaceSet[FaceNr] is added both to the FrontFS and the BackFS, so that eventually
-                // multiple leaves will refer to this face.
-                //
-                // IMPORTANT: This is only possible because we NEVER modify the FaceChildren input array
-                // while we recurse within this method! If our recursing into and processing of the FrontFS
-                // would split the face and place at FaceSet[FaceNr] one of its fragments, the subsequent
-                // processing of the BackFS might find there something entirely unexpected!
-                FrontFS.PushBack(FaceSet[FaceNr]);
-                FrontFaces.PushBack(FrontFace);
-                DeleteList.PushBack(FrontFace);
-
-                BackFS.PushBack(FaceSet[FaceNr]);
-                BackFaces.PushBack(BackFace);
-                DeleteList.PushBack(BackFace);
-                break;
-            }
-
-            default:
-                ProgressCounter++;
-                break;
-        }
-    }
-
-
-    if (FrontFS.Size())
+    if (BuildNode->Front)
     {
         Nodes[NodeNr].FrontChild=Nodes.Size();
         Nodes[NodeNr].FrontIsLeaf=false;
 
-        BuildBSPTree_NeverSplit(FrontFS, FrontFaces);
+        FlattenBSPTree(BuildNode->Front);
     }
     else
     {
@@ -370,12 +480,12 @@ void BspTreeBuilderT::BuildBSPTree_NeverSplit(const ArrayT<unsigned long>& FaceS
         Nodes[NodeNr].FrontIsLeaf=true;
     }
 
-    if (BackFS.Size())
+    if (BuildNode->Back)
     {
         Nodes[NodeNr].BackChild=Nodes.Size();
         Nodes[NodeNr].BackIsLeaf=false;
 
-        BuildBSPTree_NeverSplit(BackFS, BackFaces);
+        FlattenBSPTree(BuildNode->Back);
     }
     else
     {
@@ -384,10 +494,6 @@ void BspTreeBuilderT::BuildBSPTree_NeverSplit(const ArrayT<unsigned long>& FaceS
         Nodes[NodeNr].BackChild=Leaves.Size()-1;
         Nodes[NodeNr].BackIsLeaf=true;
     }
-
-
-    for (unsigned long FaceNr = 0; FaceNr < DeleteList.Size(); FaceNr++)
-        delete DeleteList[FaceNr];
 }
 
 
@@ -499,26 +605,63 @@ void BspTreeBuilderT::BuildBSPTree()
     // If there are no faces at all (as can happen with many entity classes ("point entities")), the BSP tree has zero nodes.
     if (FaceChildren.Size()==0) return;
 
-    // Start with all face numbers in a big list.
-    ArrayT<unsigned long> AllFaces;
+    // PHASE I
+    {
+        ArrayT<BuildFaceT> AllFaces;
 
-    for (unsigned long FaceNr=0; FaceNr<FaceChildren.Size(); FaceNr++)
-        AllFaces.PushBack(FaceNr);
+        for (unsigned long FaceNr=0; FaceNr<FaceChildren.Size(); FaceNr++)
+            AllFaces.PushBack(BuildFaceT(FaceChildren[FaceNr]));
 
+        m_ProgressCounter=0;
+        m_ParallelDepth  =0;
 
-    // PHASE I
-    if (m_Option_BspSplitFaces)
-    {
-        BuildBSPTree_SplitFaces(AllFaces);
-    }
-    else
-    {
-        BuildBSPTree_NeverSplit(AllFaces, FaceChildren);
+        if (m_ThreadPool.GetNumThreads()>1)
+        {
+            // Defer the subtrees at a depth where there are (in a balanced tree) about eight subtrees per thread.
+            while ((1ul << m_ParallelDepth) < 8ul*m_ThreadPool.GetNumThreads()) m_ParallelDepth++;
+        }
+
+        // Build the upper levels of the tree in this thread, and the subtrees below them in parallel.
+        // With a single thread, this builds the entire tree in a plain depth-first recursion.
+        ArrayT<SubtreeT> Subtrees;
+        BuildNodeT*      Root=BuildBSPTree_Recursive(AllFaces, 0, m_ParallelDepth>0 ? &Subtrees : NULL);
+
+        if (Subtrees.Size()>0)
+        {
+            // Start with the largest subtrees, so that the threads are kept busy until the end.
+            // The order doesn't affect the result, because the tree is only numbered in FlattenBSPTree().
+            std::vector<unsigned long> Order;
+            std::mutex                 ProgressMutex;
+
+            for (unsigned long SubtreeNr=0; SubtreeNr<Subtrees.Size(); SubtreeNr++)
+                Order.push_back(SubtreeNr);
+
+            std::stable_sort(Order.begin(), Order.end(), [&Subtrees](unsigned long a, unsigned long b)
+            {
+                return Subtrees[a].FaceSet.Size() > Subtrees[b].FaceSet.Size();
+            });
+
+            m_ThreadPool.ParallelFor(Subtrees.Size(), [this, &Subtrees, &Order, &ProgressMutex](unsigned int i)
+            {
+                SubtreeT& Subtree=Subtrees[Order[i]];
+
+                *Subtree.Node=BuildBSPTree_Recursive(Subtree.FaceSet, m_ParallelDepth, NULL);
+
+                std::lock_guard<std::mutex> Lock(ProgressMutex);
+                Console->Print(cf::va("%5.1f%%\r", (double)m_ProgressCounter/FaceChildren.Size()*100.0));
+            }, "BuildBSPTree");
+        }
+
+        FlattenBSPTree(Root);
+        delete Root;
     }
 
 
-    // Complete the list, in order to account for face splits during tree creation.
-    for (unsigned long FaceNr=AllFaces.Size(); FaceNr<FaceChildren.Size(); FaceNr++) AllFaces.PushBack(FaceNr);
+    // Start with all face numbers in a big list, including the faces that were created by splits.
+    ArrayT<unsigned long> AllFaces;
+
+    for (unsigned long FaceNr=0; FaceNr<FaceChildren.Size(); FaceNr++)
+        AllFaces.PushBack(FaceNr);
 
     // Create a bounding box that contains the entire world (all 'Faces').
     BoundingBox3dT WorldBB(FaceChildren[0]->Polygon.Vertices);
@@ -9,23 +9,6 @@ This project is licensed under the terms of the MIT license.
 /***********************************/
 
 
-// Determines at what index number the vertex 'A' is in 'Vertices'.
-// If 'A' is not found at all, it is inserted into the 'Vertices' array.
-unsigned long FindVertexIndex(ArrayT<VectorT>& Vertices, const VectorT& A)
-{
-    // Existiert schon so ein Vertex?
-    unsigned long VertexNr;
-
-    for (VertexNr=0; VertexNr<Vertices.Size(); VertexNr++)
-        if (Vertices[VertexNr].IsEqual(A, MapT::RoundEpsilon)) break;
-
-    // Falls nicht, einen neuen Vertex 'A' anhängen.
-    if (VertexNr==Vertices.Size()) Vertices.PushBack(A);
-
-    return VertexNr;
-}
-
-
 void BspTreeBuilderT::ComputeDrawStructures()
 {
     Console->Print(cf::va("\n%-50s %s\n", "*** Compute Draw Structures ***", GetTimeSinceProgramStart()));
@@ -52,12 +35,15 @@ void BspTreeBuilderT::ComputeDrawStructures()
     // Nun erstelle daraus die 'GlobalDrawVertices' und 'FacesDrawIndices' Arrays.
     GlobalDrawVertices.Clear();
 
+    // The welder finds the index of each vertex in GlobalDrawVertices, inserting the vertex if it is not yet there.
+    VertexWelderT<double> Welder(GlobalDrawVertices, MapT::RoundEpsilon);
+
     for (unsigned long FaceNr=0; FaceNr<DrawFaces.Size(); FaceNr++)
     {
         FaceChildren[FaceNr]->GetDrawIndices().Clear();
 
         for (unsigned long VertexNr=0; VertexNr<DrawFaces[FaceNr].Vertices.Size(); VertexNr++)
-            FaceChildren[FaceNr]->GetDrawIndices().PushBack(FindVertexIndex(GlobalDrawVertices, DrawFaces[FaceNr].Vertices[VertexNr]));
+            FaceChildren[FaceNr]->GetDrawIndices().PushBack(Welder.FindOrInsert(DrawFaces[FaceNr].Vertices[VertexNr]));
     }
 
     Console->Print("Draw structures     :       done\n");
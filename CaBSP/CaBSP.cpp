@@ -40,6 +40,8 @@ This project is licensed under the terms of the MIT license.
 #include "ClipSys/CollisionModelMan_impl.hpp"
 #include "SoundSystem/SoundShaderManagerImpl.hpp"
 #include "SoundSystem/SoundSys.hpp"
+#include "Jobs/JobSystem.hpp"
+#include "Jobs/Trace.hpp"
 
 #include "BspTreeBuilder/BspTreeBuilder.hpp"
 
@@ -67,6 +69,9 @@ SoundShaderManagerI* SoundShaderManager = &s_SSM;
 
 SoundSysI* SoundSystem = NULL;
 
+static cf::Jobs::JobSystemT s_ThreadPool;           // The threads that build the BSP trees, see the "--threads" option.
+static cf::Jobs::TraceT     s_Trace;                // The timings of the jobs of s_ThreadPool, see the "--trace" option.
+
 
 const time_t ProgramStartTime = time(NULL);
 
@@ -155,6 +160,15 @@ void Usage()
     Console->Print("USAGE: CaBSP InFile.cmap OutFile.cw [OPTIONS]\n");
     Console->Print("\n");
     Console->Print("Please note that all file names must include their paths and suffixes!\n");
+    Console->Print("\n");
+    Console->Print("OPTIONS:\n");
+    Console->Print("--most-simple-tree    (-mst)  : Build the most simple BSP tree.\n");
+    Console->Print("--bsp-split-faces     (-bsf)  : Split the faces when building the BSP tree.\n");
+    Console->Print("--dont-chop-up-faces  (-dcuf) : Don't chop up interpenetrating faces.\n");
+    Console->Print("--threads n           (-t n)  : The number of threads to use. The default 0 uses one thread\n");
+    Console->Print("                                per hardware thread. The result is the same for any number.\n");
+    Console->Print("--trace file                  : Saves the timings of all jobs to the given file, in the JSON\n");
+    Console->Print("                                format of chrome://tracing.\n");
 
     // The most simple tree means that there is no leak detection and no attempt to fill the world.
     exit(1);
@@ -171,9 +185,11 @@ int main(int ArgC, const char* ArgV[])
     cf::GameSys::GetGameSysEntityTIM().Init();  // The one-time init of the GameSys entity type info manager.
     cf::GameSys::GetWorldTIM().Init();          // The one-time init of the GameSys world type info manager.
 
-    bool Option_MostSimpleTree = false;
-    bool Option_BspSplitFaces  = false;     // Don't split faces when creating a BSP tree.
-    bool Option_ChopUpFaces    = true;      // Chop up interpenetrating faces.
+    bool        Option_MostSimpleTree = false;
+    bool        Option_BspSplitFaces  = false;     // Don't split faces when creating a BSP tree.
+    bool        Option_ChopUpFaces    = true;      // Chop up interpenetrating faces.
+    int         Option_NumThreads     = 0;         // Use one thread per hardware thread.
+    std::string Option_TraceFile      = "";        // Don't save a trace of the jobs.
 
     Console->Print(cf::va("\n*** Cafu Binary Space Partitioning Utility, Version 12 (%s) ***\n\n", __DATE__));
 
@@ -203,6 +219,23 @@ int main(int ArgC, const char* ArgV[])
         {
             Option_ChopUpFaces = false;
         }
+        else if (!_stricmp(ArgV[ArgNr], "--threads") || !_stricmp(ArgV[ArgNr], "-t"))
+        {
+            ArgNr++;
+            if (ArgNr >= ArgC) Usage();
+
+            const int NumThreads = atoi(ArgV[ArgNr]);
+            if (NumThreads < 0 || NumThreads > 256) Error("The number of threads must be in range 0..256.");
+
+            Option_NumThreads = NumThreads;
+        }
+        else if (!_stricmp(ArgV[ArgNr], "--trace"))
+        {
+            ArgNr++;
+            if (ArgNr >= ArgC) Usage();
+
+            Option_TraceFile = ArgV[ArgNr];
+        }
         else if (ArgV[ArgNr][0] == 0)
         {
             // The argument is "", the empty string.
@@ -216,6 +249,12 @@ int main(int ArgC, const char* ArgV[])
     }
 
 
+    s_ThreadPool.SetNumThreads((unsigned int)Option_NumThreads);
+    Console->Print(cf::va("Using %u threads.\n", s_ThreadPool.GetNumThreads()));
+
+    if (Option_TraceFile != "") s_ThreadPool.SetTrace(&s_Trace);
+
+
     std::string GameDirectory=ArgV[2];
 
     // Determine the game directory, cleverly assuming that the destination file is in "Worlds".
@@ -273,7 +312,7 @@ int main(int ArgC, const char* ArgV[])
     // What we need:
     // For each entity: The BspTree itself, OutsidePointSamples, FloodFillSources.
     // One common instance, shared for all: LeakDetectMat
-    BspTreeBuilderT BspTreeBuilder(World.m_StaticEntityData[0]->m_BspTree, Option_MostSimpleTree, Option_BspSplitFaces, Option_ChopUpFaces);
+    BspTreeBuilderT BspTreeBuilder(World.m_StaticEntityData[0]->m_BspTree, Option_MostSimpleTree, Option_BspSplitFaces, Option_ChopUpFaces, s_ThreadPool);
 
     BspTreeBuilder.Build(true /*yes, this is the worldspawn entity*/, FloodFillSources, DrawWorldOutsidePointSamples, ArgV[1]);
 
@@ -288,5 +327,13 @@ int main(int ArgC, const char* ArgV[])
     }
     catch (const WorldT::SaveErrorT& E) { Error(E.Msg); }
 
+    if (Option_TraceFile != "")
+    {
+        s_ThreadPool.SetTrace(NULL);
+
+        if (!s_Trace.Save(Option_TraceFile))
+            Console->Warning("Could not save the trace to \"" + Option_TraceFile + "\".\n");
+    }
+
     return 0;
 }
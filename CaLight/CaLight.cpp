@@ -64,6 +64,8 @@ This project is licensed under the terms of the MIT license.
 #include "SoundSystem/SoundShaderManagerImpl.hpp"
 #include "SoundSystem/SoundSys.hpp"
 #include "ClipSys/CollisionModelMan_impl.hpp"
+#include "Jobs/JobSystem.hpp"
+#include "Jobs/Trace.hpp"
 #include "String.hpp"
 
 #include "CaLightWorld.hpp"
@@ -262,6 +264,7 @@ const double REFLECTIVITY=0.3;  // Gleiche Reflektivität für alle Faces und f
 
 
 ArrayT<cf::PatchMeshT> PatchMeshes; // The patch meshes that we should consider for radiosity lighting.
+cf::Jobs::JobSystemT   ThreadPool;  // The threads that run the parallel parts of the lighting computations, see the "-threads" option.
 
 #include "Init2.cpp"    // void InitializePatches      (const cf::SceneGraph::BspTreeNodeT& Map, const SkyDomeT& SkyDome) { ... }
 
@@ -277,25 +280,57 @@ DiagMatrixT PatchMeshesPVS;     // The matrix that determines which patch meshes
 static unsigned long Count_AllCalls=0;
 static unsigned long Count_DivgWarnCalls=0;
 
-// Strahlt die Energie der Patches im n*n Quadrat ab, dessen linke obere Ecke bei (s_i, t_i) liegt
-void RadiateEnergy(const CaLightWorldT& CaLightWorld, unsigned long PM_i, unsigned long s_i, unsigned long t_i, char n)
+
+/// The energy that a shooting block radiates onto a single patch P_j.
+struct ReceivedEnergyT
+{
+    unsigned long PM_j;             ///< The patch mesh of P_j.
+    unsigned long Patch_j;          ///< The index of P_j in the patches of its patch mesh.
+    VectorT       DeltaRadiosity;   ///< The energy that P_j receives.
+    VectorT       Dir_ij;           ///< The unit vector from the shooting block to P_j.
+};
+
+
+/// A block of n*n patches that radiates its unradiated energy into the environment.
+///
+/// Shooting is split into three steps: GatherShot() collects the unradiated energy of the block,
+/// ComputeShot() determines the energy that each other patch receives, and ApplyShot() adds it to the patches.
+/// As ComputeShot() only reads the patch meshes, the shots of several blocks can be computed concurrently.
+/// The shots are always gathered and applied in the same order, so that the result does not depend on
+/// the number of threads or their scheduling.
+struct ShotT
 {
-    cf::PatchMeshT& PatchMesh_i=PatchMeshes[PM_i];
+    unsigned long           PM_i;           ///< The patch mesh of the block.
+    unsigned long           s_i;            ///< The s-coordinate of the upper left corner of the block.
+    unsigned long           t_i;            ///< The t-coordinate of the upper left corner of the block.
+
+    cf::PatchT              Big_P_i;        ///< The patches of the block combined into a single "big" patch.
+    unsigned long           Big_P_i_Count;  ///< The number of patches that Big_P_i combines.
+    ArrayT<ReceivedEnergyT> Received;       ///< The energy that the other patches receive from Big_P_i.
+    bool                    DivgWarning;    ///< Whether shooting Big_P_i caused a potential divergency event.
+};
+
 
-    cf::PatchT    Big_P_i;
-    unsigned long Big_P_i_Count=0;
+// Bilde den Positions-Durchschnitt bzw. die UnradiatedEnergy-Summe aller Patches im n*n Quadrat,
+// wobei (s_i, t_i) die linke obere Ecke ist und nur Patches innerhalb des Patch Meshes (InsideFace) berücksichtigt werden.
+// The UnradiatedEnergy of these patches is reset to 0, as it is now held by Big_P_i.
+static void GatherShot(ShotT& Shot, char n)
+{
+    cf::PatchMeshT& PatchMesh_i=PatchMeshes[Shot.PM_i];
+    cf::PatchT&     Big_P_i    =Shot.Big_P_i;
 
-    // A cf::PatchT has no explicit constructor. While its Vector3T<T> components are implicitly 0'ed,
-    // make sure that the Area members starts at 0, too.
-    Big_P_i.Area=0;
+    // A cf::PatchT has no explicit constructor. Make sure that all members that we sum up below start at 0.
+    Big_P_i.Coord           =VectorT(0, 0, 0);
+    Big_P_i.Normal          =VectorT(0, 0, 0);
+    Big_P_i.Area            =0;
+    Big_P_i.UnradiatedEnergy=VectorT(0, 0, 0);
+    Shot.Big_P_i_Count      =0;
 
-    // Bilde den Positions-Durchschnitt bzw. die UnradiatedEnergy-Summe aller Patches im n*n Quadrat,
-    // wobei (s_i, t_i) die linke obere Ecke ist und nur Patches innerhalb des Patch Meshes (InsideFace) berücksichtigt werden.
     for (char y=0; y<n; y++)
         for (char x=0; x<n; x++)
         {
-            unsigned long s_=s_i+x;
-            unsigned long t_=t_i+y;
+            unsigned long s_=Shot.s_i+x;
+            unsigned long t_=Shot.t_i+y;
 
             if (PatchMesh_i.WrapsHorz && s_>=PatchMesh_i.Width ) s_-=PatchMesh_i.Width;
             if (PatchMesh_i.WrapsVert && t_>=PatchMesh_i.Height) t_-=PatchMesh_i.Height;
@@ -306,7 +341,7 @@ void RadiateEnergy(const CaLightWorldT& CaLightWorld, unsigned long PM_i, unsign
             cf::PatchT& P_i=PatchMesh_i.GetPatch(s_, t_);
             if (!P_i.InsideFace) continue;
 
-            Big_P_i_Count++;
+            Shot.Big_P_i_Count++;
             Big_P_i.Coord           +=P_i.Coord;
             Big_P_i.Normal          +=P_i.Normal;
             Big_P_i.Area            +=P_i.Area;
@@ -315,7 +350,7 @@ void RadiateEnergy(const CaLightWorldT& CaLightWorld, unsigned long PM_i, unsign
             P_i.UnradiatedEnergy=VectorT(0, 0, 0);
         }
 
-    if (!Big_P_i_Count) return;
+    if (!Shot.Big_P_i_Count) return;
 
     const double NormalLen=length(Big_P_i.Normal);
 
@@ -329,10 +364,23 @@ void RadiateEnergy(const CaLightWorldT& CaLightWorld, unsigned long PM_i, unsign
     // Note that independent of that, with Big_P_i we have the choice to either average its UnradiatedEnergy or its Area, thus thinking about
     // it the one way or the other -- the net result in DeltaRadiosity below is the same. For historical reasons, I've chosen to keep the
     // UnradiatedEnergy and average the Area.
-    Big_P_i.Coord*=1.0/Big_P_i_Count;   // TODO! Sollte   Big_P_i.Coord=P_i.Coord;   setzen, wobei P_i derjenige Patch ist der der Durchschnittsposition am nächsten kommt. Nur so kommen wir auch mit gekrümmten, twosided PatchMeshes wirklich klar!
+    Big_P_i.Coord*=1.0/Shot.Big_P_i_Count;  // TODO! Sollte   Big_P_i.Coord=P_i.Coord;   setzen, wobei P_i derjenige Patch ist der der Durchschnittsposition am nächsten kommt. Nur so kommen wir auch mit gekrümmten, twosided PatchMeshes wirklich klar!
     Big_P_i.Normal=(NormalLen>0.000001) ? Big_P_i.Normal/NormalLen : Vector3dT(0, 0, 1);
-    Big_P_i.Area/=Big_P_i_Count;
-    // printf("%f %lu blocksize=%i^2 %f\n", Big_P_i.Area, Big_P_i_Count, n, PATCH_SIZE*PATCH_SIZE);
+    Big_P_i.Area/=Shot.Big_P_i_Count;
+    // printf("%f %lu blocksize=%i^2 %f\n", Big_P_i.Area, Shot.Big_P_i_Count, n, PATCH_SIZE*PATCH_SIZE);
+}
+
+
+// Computes the energy that the other patches receive from Big_P_i.
+// This function only reads the patch meshes, and thus can be called for several shots concurrently.
+static void ComputeShot(const CaLightWorldT& CaLightWorld, ShotT& Shot)
+{
+    const cf::PatchT& Big_P_i=Shot.Big_P_i;
+
+    Shot.Received.Overwrite();
+    Shot.DivgWarning=false;
+
+    if (!Shot.Big_P_i_Count) return;
 
     // It doesn't matter if we take the total or the average Big_P_i.Area here - the division cancels itself out below.
     const double MinRayLength=sqrt(Big_P_i.Area);
@@ -355,8 +403,6 @@ void RadiateEnergy(const CaLightWorldT& CaLightWorld, unsigned long PM_i, unsign
     const double DIVG_MARGIN=2.1;
     VectorT EnergyBudget=Big_P_i.UnradiatedEnergy*(REFLECTIVITY*DIVG_MARGIN);
 
-    Count_AllCalls++;
-
 
     // Betrachte alle Patches aller Patch Meshes im PVS des Patch Meshes PM_i.
     for (unsigned long PM_j=0; PM_j<PatchMeshes.Size(); PM_j++)
@@ -366,9 +412,9 @@ void RadiateEnergy(const CaLightWorldT& CaLightWorld, unsigned long PM_i, unsign
         // von PM_i liegt und insb. für die PM_i==PM_j gilt. Für nichtplanare PM muß all das aber nicht unbedingt gelten
         // (z.B. Terrains und manche Bezier Patches beleuchten sich selbst)!
         // Vgl. die Erstellung und Optimierung der PatchMeshesPVS-Matrix!
-        if (PatchMeshesPVS.GetValue(PM_i, PM_j)==NO_VISIBILITY) continue;
+        if (PatchMeshesPVS.GetValue(Shot.PM_i, PM_j)==NO_VISIBILITY) continue;
 
-        cf::PatchMeshT& PatchMesh_j=PatchMeshes[PM_j];
+        const cf::PatchMeshT& PatchMesh_j=PatchMeshes[PM_j];
 
 #if 1
         // It would be interesting to know how fast dynamic_cast really is.
@@ -379,7 +425,7 @@ void RadiateEnergy(const CaLightWorldT& CaLightWorld, unsigned long PM_i, unsign
 
         for (unsigned long Patch_j=0; Patch_j<PatchMesh_j.Patches.Size(); Patch_j++)
         {
-            cf::PatchT& P_j=PatchMesh_j.Patches[Patch_j];
+            const cf::PatchT& P_j=PatchMesh_j.Patches[Patch_j];
             if (!P_j.InsideFace) continue;
 
 
@@ -418,23 +464,73 @@ void RadiateEnergy(const CaLightWorldT& CaLightWorld, unsigned long PM_i, unsign
             EnergyBudget-=DeltaRadiosity;
             if (EnergyBudget.x<0.0 || EnergyBudget.y<0.0 || EnergyBudget.z<0.0)
             {
-                static unsigned long Count_LastWarn=0;
-
-                if (Count_LastWarn!=Count_AllCalls)
-                {
-                    Count_DivgWarnCalls++;
-                    // printf("\nDivergency warning for patch mesh %lu. Total divergency warning count: %lu.\n", PM_i, Count_DivgWarnCalls);
-                    Count_LastWarn=Count_AllCalls;      // The last divergency warning was generated in this call.
-                }
+                // printf("\nDivergency warning for patch mesh %lu.\n", Shot.PM_i);
+                Shot.DivgWarning=true;
 
                 // return;      // Note that this *aborts* the radiation of the energy of this patch.
             }
 
-            P_j.UnradiatedEnergy+=DeltaRadiosity;
-            P_j.TotalEnergy     +=DeltaRadiosity;
-            P_j.EnergyFromDir   -=Dir_ij*Max3(DeltaRadiosity);  // The -= instead of += is intentional, as we want the direction from j to i.
+            Shot.Received.PushBackEmpty();
+
+            ReceivedEnergyT& RE=Shot.Received[Shot.Received.Size()-1];
+
+            RE.PM_j          =PM_j;
+            RE.Patch_j       =Patch_j;
+            RE.DeltaRadiosity=DeltaRadiosity;
+            RE.Dir_ij        =Dir_ij;
+        }
+    }
+}
+
+
+// Adds the energy that was computed in ComputeShot() to the receiving patches.
+static void ApplyShot(const ShotT& Shot)
+{
+    if (!Shot.Big_P_i_Count) return;
+
+    Count_AllCalls++;
+    if (Shot.DivgWarning) Count_DivgWarnCalls++;
+
+    for (unsigned long RecNr=0; RecNr<Shot.Received.Size(); RecNr++)
+    {
+        const ReceivedEnergyT& RE =Shot.Received[RecNr];
+        cf::PatchT&            P_j=PatchMeshes[RE.PM_j].Patches[RE.Patch_j];
+
+        P_j.UnradiatedEnergy+=RE.DeltaRadiosity;
+        P_j.TotalEnergy     +=RE.DeltaRadiosity;
+        P_j.EnergyFromDir   -=RE.Dir_ij*Max3(RE.DeltaRadiosity);     // The -= instead of += is intentional, as we want the direction from j to i.
+    }
+}
+
+
+// Strahlt die Energie der Patches in den n*n Quadraten der Shots ab.
+// With several threads, the shots are gathered first and then computed concurrently, so that a shot does not gather
+// the energy that a preceding shot of the same call radiates onto its block (e.g. in patch meshes that light themselves).
+// With a single thread, each shot is gathered, computed and applied in turn, exactly as in the original serial code.
+void RadiateEnergy(const CaLightWorldT& CaLightWorld, ArrayT<ShotT>& Shots, char n)
+{
+    if (ThreadPool.GetNumThreads()<2)
+    {
+        for (unsigned long ShotNr=0; ShotNr<Shots.Size(); ShotNr++)
+        {
+            GatherShot(Shots[ShotNr], n);
+            ComputeShot(CaLightWorld, Shots[ShotNr]);
+            ApplyShot(Shots[ShotNr]);
         }
+
+        return;
     }
+
+    for (unsigned long ShotNr=0; ShotNr<Shots.Size(); ShotNr++)
+        GatherShot(Shots[ShotNr], n);
+
+    ThreadPool.ParallelFor(Shots.Size(), [&CaLightWorld, &Shots](unsigned int ShotNr)
+    {
+        ComputeShot(CaLightWorld, Shots[ShotNr]);
+    }, "ComputeShot");
+
+    for (unsigned long ShotNr=0; ShotNr<Shots.Size(); ShotNr++)
+        ApplyShot(Shots[ShotNr]);
 }
 
 
@@ -473,6 +569,7 @@ void DirectLighting(const CaLightWorldT& CaLightWorld, const ArrayT< IntrusivePt
     // A patch mesh is an area light source if it has a material for which a radiant exitance value has been defined.
     // Here we assign such patch meshes their initial radiating power and also make them radiate it off into the environment.
     unsigned long LightSourceCount=0;
+    ArrayT<ShotT> Shots;
 
     for (unsigned long PatchMeshNr=0; PatchMeshNr<PatchMeshes.Size(); PatchMeshNr++)
     {
@@ -521,9 +618,21 @@ void DirectLighting(const CaLightWorldT& CaLightWorld, const ArrayT< IntrusivePt
 
         // Die Patches dürfen auch gleich einmal strahlen.
         // Könnte man hier auch weglassen, aber so ist es eigentlich im Sinne von 'direct lighting'.
+        Shots.Overwrite();
+
         for (unsigned long t=0; t<PM.Height; t+=BLOCK_SIZE)
             for (unsigned long s=0; s<PM.Width; s+=BLOCK_SIZE)
-                RadiateEnergy(CaLightWorld, PatchMeshNr, s, t, BLOCK_SIZE);
+            {
+                Shots.PushBackEmpty();
+
+                ShotT& Shot=Shots[Shots.Size()-1];
+
+                Shot.PM_i=PatchMeshNr;
+                Shot.s_i =s;
+                Shot.t_i =t;
+            }
+
+        RadiateEnergy(CaLightWorld, Shots, BLOCK_SIZE);
     }
     printf("1. # area  light sources: %6lu\n", LightSourceCount);
 
@@ -585,9 +694,10 @@ void DirectLighting(const CaLightWorldT& CaLightWorld, const ArrayT< IntrusivePt
         }
 
 
-        for (unsigned long PatchMeshNr=0; PatchMeshNr<PatchMeshes.Size(); PatchMeshNr++)
+        // Each patch mesh only receives energy from the point light, so that the patch meshes can be processed concurrently.
+        ThreadPool.ParallelFor(PatchMeshes.Size(), [&](unsigned int PatchMeshNr)
         {
-            if (!PatchMeshIsInPVS[PatchMeshNr]) continue;
+            if (!PatchMeshIsInPVS[PatchMeshNr]) return;
 
             cf::PatchMeshT& PM=PatchMeshes[PatchMeshNr];
 
@@ -595,7 +705,7 @@ void DirectLighting(const CaLightWorldT& CaLightWorld, const ArrayT< IntrusivePt
             // It would be interesting to know how fast dynamic_cast really is.
             // May it be faster to disable this "abbreviation" code after all??
             const cf::SceneGraph::FaceNodeT* FaceNode=dynamic_cast<const cf::SceneGraph::FaceNodeT*>(PM.Node);
-            if (FaceNode!=NULL && FaceNode->Polygon.Plane.GetDistance(PL_Origin)<0.1) continue;
+            if (FaceNode!=NULL && FaceNode->Polygon.Plane.GetDistance(PL_Origin)<0.1) return;
 #endif
 
             for (unsigned long t=0; t<PM.Height; t++)
@@ -656,7 +766,7 @@ void DirectLighting(const CaLightWorldT& CaLightWorld, const ArrayT< IntrusivePt
                         Patch.EnergyFromDir   -=LightRayDir*Max3(DeltaEnergy);  // The -= is intentional, as we want the direction from the patch to the PL.
                     }
                 }
-        }
+        }, "DirectLighting");
     }
     printf("2. # point light sources: %6u\n", RL_Count);
 }
@@ -1059,6 +1169,37 @@ void PostProcessBorders(const CaLightWorldT& CaLightWorld)
 }
 
 
+/// A block of patches with a large amount of unradiated energy, a candidate for shooting in BounceLighting().
+struct BlockT
+{
+    unsigned long PM_i;
+    unsigned long s_i;
+    unsigned long t_i;
+    double        UE;       ///< The average unradiated energy of the patches in the block.
+};
+
+
+// Inserts Block into Blocks, which is sorted by decreasing UE and holds at most MaxBlocks blocks.
+static void InsertBlock(ArrayT<BlockT>& Blocks, unsigned long MaxBlocks, const BlockT& Block)
+{
+    // The random sampling in BounceLighting() may find the same block several times.
+    for (unsigned long BlockNr=0; BlockNr<Blocks.Size(); BlockNr++)
+        if (Blocks[BlockNr].PM_i==Block.PM_i && Blocks[BlockNr].s_i==Block.s_i && Blocks[BlockNr].t_i==Block.t_i) return;
+
+    if (Blocks.Size()>=MaxBlocks)
+    {
+        if (Block.UE<=Blocks[Blocks.Size()-1].UE) return;
+        Blocks.DeleteBack();
+    }
+
+    unsigned long Pos=Blocks.Size();
+
+    while (Pos>0 && Blocks[Pos-1].UE<Block.UE) Pos--;
+
+    Blocks.InsertAt(Pos, Block);
+}
+
+
 unsigned long BounceLighting(const CaLightWorldT& CaLightWorld, const char BLOCK_SIZE, double& StopUE, const bool AskForMore, const char* WorldName)
 {
     printf("\n%-50s %s\n", "*** PHASE II - performing bounce lighting ***", GetTimeSinceProgramStart());
@@ -1066,6 +1207,14 @@ unsigned long BounceLighting(const CaLightWorldT& CaLightWorld, const char BLOCK
     unsigned long IterationCount =0;
     unsigned long FullSearchCount=0;
 
+    // With several threads, we shoot the energy of several blocks in each iteration, one per thread.
+    // The blocks receive none of each other's energy in the same iteration, but get it in a later one,
+    // so that the result differs from that of a single thread only by the amount of energy that is left
+    // unradiated anyway (StopUE).
+    const unsigned long MaxShots=ThreadPool.GetNumThreads();
+    ArrayT<BlockT>      Blocks;
+    ArrayT<ShotT>       Shots;
+
     while (true)
     {
         unsigned long PM_i  =0;
@@ -1073,6 +1222,8 @@ unsigned long BounceLighting(const CaLightWorldT& CaLightWorld, const char BLOCK
         unsigned long t_i   =0;
         double        BestUE=0;     // Best unradiated energy amount found
 
+        Blocks.Overwrite();
+
         // Finde ein PatchMesh mit einem Patch mit einer großen UnradiatedEnergy (nicht notwendigerweise die größte, damit es schnell geht).
         for (unsigned long PatchMeshNr=0; PatchMeshNr<PatchMeshes.Size(); PatchMeshNr++)
         {
@@ -1113,16 +1264,23 @@ unsigned long BounceLighting(const CaLightWorldT& CaLightWorld, const char BLOCK
                 if (!Count) continue;
                 ThisUE/=double(Count);
 
-                if (ThisUE>BestUE)
+                if (ThisUE>0)
                 {
-                    PM_i  =PatchMeshNr;
-                    s_i   =s;
-                    t_i   =t;
-                    BestUE=ThisUE;
+                    const BlockT Block={ PatchMeshNr, s, t, ThisUE };
+
+                    InsertBlock(Blocks, MaxShots, Block);
                 }
             }
         }
 
+        if (Blocks.Size()>0)
+        {
+            PM_i  =Blocks[0].PM_i;
+            s_i   =Blocks[0].s_i;
+            t_i   =Blocks[0].t_i;
+            BestUE=Blocks[0].UE;
+        }
+
         // Sollte die BestUE unter StopUE sein, wird hier nach einem besseren Wert gesucht.
         // Beim erstbesseren Wert wird dieser genommen und abgebrochen, ansonsten gesucht bis zum Schluß.
         // Wenn alle Faces nach dem besten Wert durchsucht werden sollen, muß "&& BestUE<StopUE" auskommentiert werden.
@@ -1153,6 +1311,12 @@ unsigned long BounceLighting(const CaLightWorldT& CaLightWorld, const char BLOCK
                         }
                     }
             }
+
+            // The full search only looks for a single block.
+            const BlockT Block={ PM_i, s_i, t_i, BestUE };
+
+            Blocks.Overwrite();
+            Blocks.PushBack(Block);
         }
 
         printf("Iteration%6lu, BestUE %6.2f, PM_i%6lu, FullSearch%4lu (%5.1f%%)\r", IterationCount, BestUE, PM_i, FullSearchCount, 100.0*float(FullSearchCount)/float(IterationCount+1));
@@ -1181,8 +1345,24 @@ unsigned long BounceLighting(const CaLightWorldT& CaLightWorld, const char BLOCK
             StopUE/=10.0;
         }
 
-        RadiateEnergy(CaLightWorld, PM_i, s_i, t_i, BLOCK_SIZE);
-        IterationCount++;
+        // Shoot the best block, and all other blocks whose energy is still above StopUE.
+        Shots.Overwrite();
+
+        for (unsigned long BlockNr=0; BlockNr<Blocks.Size(); BlockNr++)
+        {
+            if (BlockNr>0 && Blocks[BlockNr].UE<StopUE) break;
+
+            Shots.PushBackEmpty();
+
+            ShotT& Shot=Shots[Shots.Size()-1];
+
+            Shot.PM_i=Blocks[BlockNr].PM_i;
+            Shot.s_i =Blocks[BlockNr].s_i;
+            Shot.t_i =Blocks[BlockNr].t_i;
+        }
+
+        RadiateEnergy(CaLightWorld, Shots, BLOCK_SIZE);
+        IterationCount+=Shots.Size();
 
 #ifdef _WIN32
         // TODO: Ein (sinnvolles!) 'kbhit()' Äquivalent für Linux muß erst noch gefunden werden...
@@ -1253,6 +1433,11 @@ void Usage()
     printf("               Use this to use the same value as for bounce lighting.\n");
     printf("-onlyEnts      Process entities only (not the world).\n");
     printf("-fast          Same as \"-BlockSize 5 -UseBS4DL\".\n");
+    printf("-threads n     The number of threads to use, 0 for one per CPU core. Default is 1.\n");
+    printf("               With more than one thread, bounce lighting shoots n blocks at\n");
+    printf("               once, which slightly varies the result (within StopUE).\n");
+    printf("-trace file    Saves the timings of all jobs to the given file, in the JSON\n");
+    printf("               format of chrome://tracing.\n");
     printf("\n");
     printf("\n");
     printf("EXAMPLES:\n");
@@ -1338,8 +1523,10 @@ int main(int ArgC, const char* ArgV[])
         bool        AskForMore;
         bool        UseBlockSizeForDirectL;
         bool        EntitiesOnly;
+        int         NumThreads;
+        std::string TraceFileName;
 
-        CaLightOptionsT() : GameDirName("."), BlockSize(3), StopUE(1.0), AskForMore(false), UseBlockSizeForDirectL(false), EntitiesOnly(false) {}
+        CaLightOptionsT() : GameDirName("."), BlockSize(3), StopUE(1.0), AskForMore(false), UseBlockSizeForDirectL(false), EntitiesOnly(false), NumThreads(1), TraceFileName("") {}
     } CaLightOptions;
 
 
@@ -1403,6 +1590,19 @@ int main(int ArgC, const char* ArgV[])
             CaLightOptions.BlockSize=5;
             CaLightOptions.UseBlockSizeForDirectL=true;
         }
+        else if (!_stricmp(ArgV[CurrentArg], "-threads"))
+        {
+            if (CurrentArg+1==ArgC) Error("I can't find a number after \"-threads\"!");
+            CurrentArg++;
+            CaLightOptions.NumThreads=atoi(ArgV[CurrentArg]);
+            if (CaLightOptions.NumThreads<0 || CaLightOptions.NumThreads>256) Error("The number of threads must be in range 0..256.");
+        }
+        else if (!_stricmp(ArgV[CurrentArg], "-trace"))
+        {
+            if (CurrentArg+1==ArgC) Error("I can't find a file name after \"-trace\"!");
+            CurrentArg++;
+            CaLightOptions.TraceFileName=ArgV[CurrentArg];
+        }
         else if (ArgV[CurrentArg][0]==0)
         {
             // The argument is "", the empty string.
@@ -1473,6 +1673,13 @@ int main(int ArgC, const char* ArgV[])
             printf("- I will %s you for more.\n", CaLightOptions.AskForMore ? "ASK" : "NOT ask");
             printf("- BlockSize for direct lighting is %ux%u.\n", BlockSize4DirectLighting, BlockSize4DirectLighting);
 
+            ThreadPool.SetNumThreads(CaLightOptions.NumThreads);
+            printf("- Using %u thread(s).\n", ThreadPool.GetNumThreads());
+
+            cf::Jobs::TraceT Trace;
+
+            if (CaLightOptions.TraceFileName!="") ThreadPool.SetTrace(&Trace);
+
             // Initialize
             InitializePatches(CaLightWorld);                // Init2.cpp
 
@@ -1505,6 +1712,14 @@ int main(int ArgC, const char* ArgV[])
             printf("Info: %lu calls to RadiateEnergy() caused %lu potential divergency events.\n", Count_AllCalls, Count_DivgWarnCalls);
 
 
+            if (CaLightOptions.TraceFileName!="")
+            {
+                ThreadPool.SetTrace(NULL);
+
+                if (!Trace.Save(CaLightOptions.TraceFileName))
+                    printf("Could not save the trace to \"%s\".\n", CaLightOptions.TraceFileName.c_str());
+            }
+
             ToneReproduction(CaLightWorld);                                     // Ward97.cpp
             PostProcessBorders(CaLightWorld);
 
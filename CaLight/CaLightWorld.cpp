@@ -36,6 +36,27 @@ double CaLightWorldT::TraceRay(const Vector3dT& Start, const Vector3dT& Ray) con
 }
 
 
+void CaLightWorldT::TraceRays(const ArrayT<Vector3dT>& Starts, const ArrayT<Vector3dT>& Rays, ArrayT<double>& Fractions) const
+{
+    assert(Starts.Size() == Rays.Size());
+
+    ArrayT<cf::ClipSys::TraceResultT> Results;
+
+    Results.PushBackEmptyExact(Rays.Size());
+
+    for (unsigned long RayNr = 0; RayNr < Results.Size(); RayNr++)
+        Results[RayNr] = cf::ClipSys::TraceResultT(1.0);
+
+    if (Results.Size() > 0)
+        m_CollModel->TraceRays(Rays.Size(), &Starts[0], &Rays[0], MaterialT::Clip_Radiance, &Results[0]);
+
+    Fractions.Overwrite();
+
+    for (unsigned long RayNr = 0; RayNr < Results.Size(); RayNr++)
+        Fractions.PushBack(Results[RayNr].Fraction);
+}
+
+
 void CaLightWorldT::SaveToDisk(const char* FileName) const
 {
     m_World.SaveToDisk(FileName);
@@ -86,6 +107,11 @@ void CaLightWorldT::CreateLightMapsForEnts(const ArrayT< IntrusivePtrT<cf::GameS
 
 
         // Fill patch meshes with color.
+        ArrayT<Vector3dT>     RayStarts;
+        ArrayT<Vector3dT>     Rays;
+        ArrayT<unsigned long> RaySampleNrs;
+        ArrayT<double>        HitFracs;
+
         for (unsigned long PatchMeshNr=0; PatchMeshNr<PatchMeshes.Size(); PatchMeshNr++)
         {
             cf::PatchMeshT& PM=PatchMeshes[PatchMeshNr];
@@ -101,20 +127,37 @@ void CaLightWorldT::CreateLightMapsForEnts(const ArrayT< IntrusivePtrT<cf::GameS
                     if (!Patch.InsideFace) continue;
 
 
+                    // Trace all sample dirs (but those against the normal) from the patch in a single batch.
+                    const Vector3dT RayOrigin = AllEnts[EntNr]->GetTransform()->GetOriginWS().AsVectorOfDouble() + Patch.Coord;
+                    const double    RayLength = 50000.0;    // 50 meters max.
+
+                    RayStarts.Overwrite();
+                    Rays.Overwrite();
+                    RaySampleNrs.Overwrite();
+
+                    for (unsigned long SampleNr=0; SampleNr<SampleDirs.Size(); SampleNr++)
+                    {
+                        if (dot(Patch.Normal, SampleDirs[SampleNr])<0) continue;    // Don't try sample dirs against the normal.
+
+                        RayStarts.PushBack(RayOrigin);
+                        Rays.PushBack(SampleDirs[SampleNr] * RayLength);
+                        RaySampleNrs.PushBack(SampleNr);
+                    }
+
+                    TraceRays(RayStarts, Rays, HitFracs);
+
+
                     // Gather the averages.
                     double        AvgWeightsSum=0.0;
                     Vector3dT     AvgColorsSum;     // Sum of weighted colors.
                     Vector3dT     AvgDirsSum;       // Sum of weighted directions.
 
-                    for (unsigned long SampleNr=0; SampleNr<SampleDirs.Size(); SampleNr++)
+                    for (unsigned long RayNr=0; RayNr<Rays.Size(); RayNr++)
                     {
-                        // printf("Mesh %lu, st %lu %lu: coord %s, normal %s, SampleDir %s \n", PatchMeshNr, s, t, convertToString(Patch.Coord).c_str(), convertToString(Patch.Normal).c_str(), convertToString(SampleDirs[SampleNr]).c_str());
+                        const unsigned long SampleNr = RaySampleNrs[RayNr];
+                        const double        HitFrac  = HitFracs[RayNr];
 
-                        if (dot(Patch.Normal, SampleDirs[SampleNr])<0) continue;    // Don't try sample dirs against the normal.
-
-                        const Vector3dT RayOrigin = AllEnts[EntNr]->GetTransform()->GetOriginWS().AsVectorOfDouble() + Patch.Coord;
-                        const double    RayLength = 50000.0;    // 50 meters max.
-                        const double    HitFrac   = TraceRay(RayOrigin, SampleDirs[SampleNr] * RayLength);
+                        // printf("Mesh %lu, st %lu %lu: coord %s, normal %s, SampleDir %s \n", PatchMeshNr, s, t, convertToString(Patch.Coord).c_str(), convertToString(Patch.Normal).c_str(), convertToString(SampleDirs[SampleNr]).c_str());
 
                         if (HitFrac==0.0) continue;     // Probably immediately stuck in solid.
                         if (HitFrac==1.0) continue;     // Ray did not hit anything.
@@ -19,8 +19,14 @@ class CaLightWorldT
 
     const cf::SceneGraph::BspTreeNodeT& GetBspTree() const { return *m_BspTree; }
 
+    /// Traces a ray against the world and returns the fraction of Ray at which it hit a radiance-blocking surface.
+    /// This method can be called by several threads concurrently.
     double TraceRay(const Vector3dT& Start, const Vector3dT& Ray) const;
 
+    /// Like TraceRay(), but traces a batch of rays at once, which is much faster if the rays are coherent.
+    /// The fractions at which the rays hit a radiance-blocking surface are returned in Fractions.
+    void TraceRays(const ArrayT<Vector3dT>& Starts, const ArrayT<Vector3dT>& Rays, ArrayT<double>& Fractions) const;
+
     /// Creates (fake) lightmaps for (brush or bezier patch based) entities.
     /// The generated lightmaps are only "fakes", i.e. they are not a result of the true Radiosity computations of CaLight.
     /// Instead, they are obtained by sampling the environment (the world entity) and interpolating the obtained values.
@@ -112,9 +112,11 @@ void InitializePatches(const CaLightWorldT& CaLightWorld)
 
     // Create the patch meshes.
     {
-        unsigned long PatchMeshNr=0;
         unsigned long PatchesCount=0;
 
+        // The sample coordinates of the patches of each patch mesh, kept until the sunlight has been computed.
+        ArrayT< ArrayT< ArrayT<Vector3dT> > > AllSampleCoords;
+
         for (unsigned long FaceNr=0; FaceNr<Map.FaceChildren.Size(); FaceNr++)
         {
             printf("%5.1f%% (f)\r", (double)FaceNr/(Map.FaceChildren.Size()+Map.OtherChildren.Size())*100.0);
@@ -123,14 +125,7 @@ void InitializePatches(const CaLightWorldT& CaLightWorld)
             ArrayT< ArrayT< ArrayT<Vector3dT> > > SampleCoords;
 
             Map.FaceChildren[FaceNr]->CreatePatchMeshes(PatchMeshes, SampleCoords, Map.GetLightMapPatchSize());
-
-            for (unsigned long SampleCoordsNr=0; SampleCoordsNr<SampleCoords.Size(); SampleCoordsNr++)
-            {
-                InitSunlight(PatchMeshes[PatchMeshNr], SampleCoords[SampleCoordsNr], Suns, SkyFaces, CaLightWorld);
-
-                PatchesCount+=PatchMeshes[PatchMeshNr].Patches.Size();
-                PatchMeshNr++;
-            }
+            AllSampleCoords.PushBack(SampleCoords);
         }
 
         for (unsigned long OtherNr=0; OtherNr<Map.OtherChildren.Size(); OtherNr++)
@@ -141,15 +136,19 @@ void InitializePatches(const CaLightWorldT& CaLightWorld)
             ArrayT< ArrayT< ArrayT<Vector3dT> > > SampleCoords;
 
             Map.OtherChildren[OtherNr]->CreatePatchMeshes(PatchMeshes, SampleCoords, Map.GetLightMapPatchSize());
+            AllSampleCoords.PushBack(SampleCoords);
+        }
 
-            for (unsigned long SampleCoordsNr=0; SampleCoordsNr<SampleCoords.Size(); SampleCoordsNr++)
-            {
-                InitSunlight(PatchMeshes[PatchMeshNr], SampleCoords[SampleCoordsNr], Suns, SkyFaces, CaLightWorld);
+        assert(AllSampleCoords.Size()==PatchMeshes.Size());
 
-                PatchesCount+=PatchMeshes[PatchMeshNr].Patches.Size();
-                PatchMeshNr++;
-            }
-        }
+        // InitSunlight() only modifies the patch mesh that it is given, so that the patch meshes can be processed concurrently.
+        ThreadPool.ParallelFor(PatchMeshes.Size(), [&](unsigned int PatchMeshNr)
+        {
+            InitSunlight(PatchMeshes[PatchMeshNr], AllSampleCoords[PatchMeshNr], Suns, SkyFaces, CaLightWorld);
+        }, "InitSunlight");
+
+        for (unsigned long PatchMeshNr=0; PatchMeshNr<PatchMeshes.Size(); PatchMeshNr++)
+            PatchesCount+=PatchMeshes[PatchMeshNr].Patches.Size();
 
 // THIS WAS REMOVED, BECAUSE:
 // I'm in the progress to introduce a Scene Graph for Cafu.
@@ -302,7 +301,7 @@ void InitializePatches(const CaLightWorldT& CaLightWorld)
     // 3. Trotz der vielen SamplePoints für jeden Patch kann das Sonnenlicht ziemlich eckig wirken.
     //    Deshalb filtern wir es hier vorsichtig nach, indem wir für jeden Patch das gewichtete Mittel mit den acht umliegenden Patches bilden.
     //    Die vier unmittelbar anliegenden Patches werden mit 1/4 gewichtet, die vier Ecken mit 1/16.
-    for (unsigned long PatchMeshNr=0; PatchMeshNr<PatchMeshes.Size(); PatchMeshNr++)
+    ThreadPool.ParallelFor(PatchMeshes.Size(), [](unsigned int PatchMeshNr)
     {
         cf::PatchMeshT& PM=PatchMeshes[PatchMeshNr];
 
@@ -375,6 +374,6 @@ void InitializePatches(const CaLightWorldT& CaLightWorld)
                 Patch.TotalEnergy     =scale(TotalAverage, 1.0/CoveredArea);
                 Patch.EnergyFromDir   =scale(FrDirAverage, 1.0/CoveredArea);
             }
-    }
+    }, "FilterSunlight");
     printf("Sunlight smoothed.\n");
 }
@@ -32,6 +32,10 @@ This project is licensed under the terms of the MIT license.
 
 #include <time.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
 
 #include "CaPVSWorld.hpp"
 #include "ConsoleCommands/Console.hpp"
@@ -43,6 +47,9 @@ This project is licensed under the terms of the MIT license.
 #include "MaterialSystem/MaterialManagerImpl.hpp"
 #include "Models/ModelManager.hpp"
 #include "ClipSys/CollisionModelMan_impl.hpp"
+#include "Jobs/JobSystem.hpp"
+#include "Jobs/Trace.hpp"
+#include "String.hpp"
 
 
 static cf::ConsoleStdoutT ConsoleStdout;
@@ -76,9 +83,11 @@ static const char* GetTimeSinceProgramStart()
 }
 
 
-ArrayT<SuperLeafT>              SuperLeaves;
-ArrayT< BoundingBox3T<double> > SuperLeavesBBs;
-ArrayT<unsigned long>           SuperLeavesPVS;
+ArrayT<SuperLeafT>                   SuperLeaves;
+ArrayT< BoundingBox3T<double> >      SuperLeavesBBs;
+std::vector< std::atomic<uint32_t> > SuperLeavesPVS;    // The visibility bit matrix. As bits are only ever set, never cleared, the threads can share it without locks.
+std::vector< std::atomic<bool> >     SuperLeavesDone;   // SuperLeavesDone[SL] is true when BuildPVS() has completed the PVS of 'SL' in its role as the 'MasterSL'.
+cf::Jobs::JobSystemT                 ThreadPool;        // The threads that BuildPVS() uses, see the "-threads" option.
 
 
 // Records in 'SuperLeavesPVS' that we can see from 'FromSL' to 'ToSL'.
@@ -86,9 +95,12 @@ inline void FlagVisible(unsigned long FromSL, unsigned long ToSL)
 {
     const unsigned long PVSTotalBitNr=FromSL*SuperLeaves.Size()+ToSL;
     const unsigned long PVS_W32_Nr   =PVSTotalBitNr >> 5;
-    const unsigned long PVSBitMask   =1 << (PVSTotalBitNr & 31);
+    const uint32_t      PVSBitMask   =uint32_t(1) << (PVSTotalBitNr & 31);
 
-    SuperLeavesPVS[PVS_W32_Nr]|=PVSBitMask;
+    // Avoid the (comparatively expensive) atomic read-modify-write if the bit is already set.
+    if (SuperLeavesPVS[PVS_W32_Nr].load() & PVSBitMask) return;
+
+    SuperLeavesPVS[PVS_W32_Nr].fetch_or(PVSBitMask);
 }
 
 
@@ -97,7 +109,14 @@ inline bool IsVisible(unsigned long FromSL, unsigned long ToSL)
 {
     const unsigned long PVSTotalBitNr=FromSL*SuperLeaves.Size()+ToSL;
 
-    return bool((SuperLeavesPVS[PVSTotalBitNr >> 5] >> (PVSTotalBitNr & 31)) & 1);
+    return bool((SuperLeavesPVS[PVSTotalBitNr >> 5].load() >> (PVSTotalBitNr & 31)) & 1);
+}
+
+
+// Returns 'true' if we know that 'TargetSL' is not visible from 'SL', which requires that the PVS of 'SL' has been completed.
+inline bool IsKnownInvisible(unsigned long SL, unsigned long TargetSL)
+{
+    return SuperLeavesDone[SL].load() && !IsVisible(SL, TargetSL);
 }
 
 
@@ -507,7 +526,7 @@ bool DetermineVisibility(unsigned long CurrentSL, const Polygon3T<double>& Enter
         Polygon3T<double>   NextPortal=SuperLeaves[CurrentSL].Neighbours[NeighbourNr].SubPortal;
 
         // Wenn für das 'NextSL' schon festgestellt wurde, daß das 'TargetSL' von dort aus nicht zu sehen ist, können wir direkt weitermachen.
-        if (NextSL<AncestorSLs[0]/*MasterSL*/ && !IsVisible(NextSL, TargetSL)) continue;
+        if (NextSL<AncestorSLs[0]/*MasterSL*/ && IsKnownInvisible(NextSL, TargetSL)) continue;
 
         // Abkürzung: Gleiche Ebene? Dann weiter mit dem nächsten Portal!
         {
@@ -527,7 +546,7 @@ bool DetermineVisibility(unsigned long CurrentSL, const Polygon3T<double>& Enter
         if (FrustumNr<Frustum.Size()) continue;
 
         // Bestimme das Frustum "EnteringPortal --> NextPortal".
-        static ArrayT< Plane3T<double> > Frustum2;
+        static thread_local ArrayT< Plane3T<double> > Frustum2;
         FindFrustum(EnteringPortal, NextPortal, Frustum2);
 
         if (Frustum2.Size()==0)
@@ -557,7 +576,7 @@ bool DetermineVisibility(unsigned long CurrentSL, const Polygon3T<double>& Enter
 
 
 // This functions determines if we can see from 'MasterSL' to 'TargetSL', that is, if 'TargetSL' is visible from 'MasterSL'.
-// ATTENTION 1: IT IS ASSUMED THAT THE PVS FOR ALL SUPERLEAVES IN RANGE '0..MasterSL-1' HAS ALREADY BEEN ESTABLISHED!
+// ATTENTION 1: THE PVS OF THE SUPERLEAVES IN RANGE '0..MasterSL-1' IS ONLY USED FOR PRUNING WHEN IT HAS BEEN COMPLETED (see 'SuperLeavesDone')!
 // ATTENTION 2: THIS FUNCTION DOES NOT WORK IF 'MasterSL==TargetSL', OR 'TargetSL' IS AN IMMEDIATE NEIGHBOUR OF 'MasterSL'!
 // If mutual visibility could be established, the result is recorded in 'SuperLeavesPVS', for both "from A to B" and "from B to A".
 bool CanSeeFromAToB(unsigned long MasterSL, unsigned long TargetSL)
@@ -579,7 +598,7 @@ bool CanSeeFromAToB(unsigned long MasterSL, unsigned long TargetSL)
 
         // Wenn für das 'NeighbourSL' schon festgestellt wurde, daß das 'TargetSL' von dort aus nicht zu sehen ist,
         // sparen wir uns die Mühe, es trotzdem zu versuchen, und machen direkt weiter.
-        if (NeighbourSL<MasterSL && !IsVisible(NeighbourSL, TargetSL)) continue;
+        if (NeighbourSL<MasterSL && IsKnownInvisible(NeighbourSL, TargetSL)) continue;
 
         AncestorSLs[0]=MasterSL;
         AncestorSLs[1]=NeighbourSL;
@@ -597,7 +616,7 @@ bool CanSeeFromAToB(unsigned long MasterSL, unsigned long TargetSL)
 
             // Wenn für das 'NeighboursNeighbourSL' schon festgestellt wurde, daß das 'TargetSL' von dort aus nicht zu sehen ist,
             // sparen wir uns die Mühe, es trotzdem zu versuchen, und machen direkt weiter.
-            if (NeighboursNeighbourSL<MasterSL && !IsVisible(NeighboursNeighbourSL, TargetSL)) continue;
+            if (NeighboursNeighbourSL<MasterSL && IsKnownInvisible(NeighboursNeighbourSL, TargetSL)) continue;
 
             // Das TOLLE: Sobald wir festgestellt haben, daß "irgendeine" Sichtbarkeit von 'MasterSL' nach 'TargetSL' existiert,
             // können wir sofort AUFHÖREN(!!!) und mit dem nächsten SuperLeaves-Paar weitermachen!
@@ -609,9 +628,199 @@ bool CanSeeFromAToB(unsigned long MasterSL, unsigned long TargetSL)
 }
 
 
+// Initializes the 'AV' and 'PV' lists of 'MasterSL' (see BuildPVSForMasterSL()), keeping the 'NV' list.
+static void InitVisibilityLists(unsigned long MasterSL, ArrayT<bool>& AV, ArrayT<bool>& PV, const ArrayT<bool>& NV)
+{
+    // Done[SL] is true for the SuperLeaves with lower numbers than 'MasterSL' whose PVS has been completed.
+    // With several threads, the PVS of the other lower SuperLeaves may still be in progress in other jobs.
+    // The visibility bits are only ever set, never cleared, so a set bit can always be trusted, but a cleared bit
+    // only means "not visible" for the SuperLeaves whose PVS has been completed: for the others it means "not yet known".
+    // The flags are copied once, so that 'AV' and 'PV' are consistent even if other jobs complete meanwhile.
+    ArrayT<bool>  Done;
+    unsigned long SL;
+
+    for (SL=0; SL<SuperLeaves.Size(); SL++)
+    {
+        AV[SL]=false;
+        PV[SL]=false;
+        Done.PushBack(SL<MasterSL && SuperLeavesDone[SL].load());
+    }
+
+    // Bestimme, welche SuperLeaves wir von 'MasterSL' aus schon sehen können.
+    for (SL=0; SL<SuperLeaves.Size(); SL++)
+        if (IsVisible(MasterSL, SL)) AV[SL]=true;
+
+    // Bilde eine Liste 'PV' aller SuperLeaves, die von 'MasterSL' aus "potentially visible" sind.
+    // Dies sind zunächst *alle* Nachbarn aller SuperLeaves in der 'AV' Liste, außer denjenigen,
+    // die bereits in der 'AV' oder 'NV' Liste sind, oder deren Index-Nummern 'NeighbourSL' kleiner/gleich 'MasterSL' sind.
+    // Der Grund für letzteres: Wenn früher schon festgestellt wurde, daß wir nicht von 'NeighbourSL' nach 'MasterSL' sehen können,
+    // können wir uns jetzt den Test, ob wir von 'MasterSL' nach 'NeighbourSL' sehen können, sparen.
+    // Wäre der frühere Test dagegen positiv gewesen, wäre 'AV[NeighbourSL]==true', was auch keinen 'PV'-Eintrag verursacht.
+    // The earlier test only exists for the lower SuperLeaves whose PVS has been completed: The others are added to 'PV'
+    // (unless they are already in 'AV', which includes all SuperLeaves whose visibility bit has been set by any job).
+    for (SL=0; SL<SuperLeaves.Size(); SL++)
+        if (AV[SL])
+            for (unsigned long NeighbourNr=0; NeighbourNr<SuperLeaves[SL].Neighbours.Size(); NeighbourNr++)
+            {
+                const unsigned long NeighbourSL=SuperLeaves[SL].Neighbours[NeighbourNr].SuperLeafNr;
+
+                if (!AV[NeighbourSL] && !NV[NeighbourSL] && NeighbourSL!=MasterSL && !Done[NeighbourSL]) PV[NeighbourSL]=true;
+            }
+}
+
+
+// Analytically computes the PVS of 'MasterSL', that is, determines which SuperLeaves with higher numbers are visible from it.
+// This function can be called for several 'MasterSL's concurrently. The visibility of the lower SuperLeaves whose PVS
+// is not yet complete is determined as well.
+static void BuildPVSForMasterSL(unsigned long MasterSL)
+{
+    // Initialisiere die Hilfsarrays für das 'MasterSL'.
+    ArrayT<bool> AV;    // List of "Already     Visible" SuperLeaves from 'MasterSL'.
+    ArrayT<bool> PV;    // List of "Potentially Visible" SuperLeaves from 'MasterSL'.
+    ArrayT<bool> NV;    // List of "Not         Visible" SuperLeaves from 'MasterSL'.
+
+    unsigned long SL;
+
+    for (SL=0; SL<SuperLeaves.Size(); SL++)
+    {
+        AV.PushBack(false);
+        PV.PushBack(false);
+        NV.PushBack(false);
+    }
+
+    InitVisibilityLists(MasterSL, AV, PV, NV);
+
+    // For each 'TargetSL' in 'PV': Determine if 'TargetSL' is visible from 'MasterSL'.
+    while (true)
+    {
+        unsigned long TargetSL;
+
+        for (TargetSL=0; TargetSL<PV.Size(); TargetSL++) if (PV[TargetSL]) break;
+        if (TargetSL>=PV.Size()) break;
+
+        if (CanSeeFromAToB(MasterSL, TargetSL))
+        {
+            // Redo the init (but 'NV' is possibly not empty anymore).
+            InitVisibilityLists(MasterSL, AV, PV, NV);
+        }
+        else
+        {
+            PV[TargetSL]=false;     // Delete 'TargetSL' from PV list.
+            NV[TargetSL]=true;      // Add    'TargetSL' to   NV list.
+        }
+    }
+}
+
+
+const uint32_t CHECKPOINT_MAGIC  =0x53565043;  // "CPVS"
+const uint32_t CHECKPOINT_VERSION=1;
+
+
+// Returns a checksum over the SuperLeaves and their adjacency graph.
+// It is used to detect checkpoint files that were written for another world or with other SuperLeaves options.
+static uint32_t GetSuperLeavesChecksum()
+{
+    uint32_t Sum=uint32_t(SuperLeaves.Size());
+
+    for (unsigned long SL=0; SL<SuperLeaves.Size(); SL++)
+    {
+        Sum=Sum*31+uint32_t(SuperLeaves[SL].LeafSet.Size());
+
+        for (unsigned long LeafSetNr=0; LeafSetNr<SuperLeaves[SL].LeafSet.Size(); LeafSetNr++)
+            Sum=Sum*31+uint32_t(SuperLeaves[SL].LeafSet[LeafSetNr]);
+
+        for (unsigned long NeighbourNr=0; NeighbourNr<SuperLeaves[SL].Neighbours.Size(); NeighbourNr++)
+            Sum=Sum*31+uint32_t(SuperLeaves[SL].Neighbours[NeighbourNr].SuperLeafNr);
+    }
+
+    return Sum;
+}
+
+
+// Saves the 'SuperLeavesDone' flags and the 'SuperLeavesPVS' into the given file, so that an interrupted run can be resumed later.
+// This function can be called while other threads are still working on the PVS.
+static bool SaveCheckpoint(const std::string& FileName)
+{
+    // Copy the flags before the bits: The PVS of a SuperLeaf is complete before it is flagged as done,
+    // so that the copied bits are complete for all SuperLeaves that are flagged as done in the copy.
+    ArrayT<uint8_t>  Done;
+    ArrayT<uint32_t> Bits;
+
+    for (unsigned long SL=0; SL<SuperLeavesDone.size(); SL++) Done.PushBack(SuperLeavesDone[SL].load() ? 1 : 0);
+    for (unsigned long Nr=0; Nr<SuperLeavesPVS.size(); Nr++) Bits.PushBack(SuperLeavesPVS[Nr].load());
+
+    // Write to a temporary file first, so that an interruption while writing doesn't destroy the previous checkpoint.
+    const std::string TempName=FileName+".tmp";
+    FILE*             File    =fopen(TempName.c_str(), "wb");
+
+    if (!File) return false;
+
+    const uint32_t Header[4]={ CHECKPOINT_MAGIC, CHECKPOINT_VERSION, uint32_t(SuperLeaves.Size()), GetSuperLeavesChecksum() };
+    bool           Ok       =fwrite(Header, sizeof(Header), 1, File)==1;
+
+    if (Ok && Done.Size()>0) Ok=fwrite(&Done[0], sizeof(uint8_t ), Done.Size(), File)==Done.Size();
+    if (Ok && Bits.Size()>0) Ok=fwrite(&Bits[0], sizeof(uint32_t), Bits.Size(), File)==Bits.Size();
+    if (fclose(File)!=0) Ok=false;
+
+    if (!Ok)
+    {
+        remove(TempName.c_str());
+        return false;
+    }
+
+    remove(FileName.c_str());   // Under Windows, rename() fails if the destination file exists.
+    return rename(TempName.c_str(), FileName.c_str())==0;
+}
+
+
+// Loads the checkpoint file that was written by SaveCheckpoint() into the 'SuperLeavesDone' flags and the 'SuperLeavesPVS'.
+// Returns the number of SuperLeaves whose PVS is complete, or 0 if there is no checkpoint file that matches the current SuperLeaves.
+static unsigned long LoadCheckpoint(const std::string& FileName)
+{
+    FILE* File=fopen(FileName.c_str(), "rb");
+
+    if (!File) return 0;
+
+    uint32_t         Header[4];
+    ArrayT<uint8_t>  Done;
+    ArrayT<uint32_t> Bits;
+
+    Done.PushBackEmptyExact(SuperLeavesDone.size());
+    Bits.PushBackEmptyExact(SuperLeavesPVS.size());
+
+    bool Ok=fread(Header, sizeof(Header), 1, File)==1 &&
+            Header[0]==CHECKPOINT_MAGIC && Header[1]==CHECKPOINT_VERSION &&
+            Header[2]==SuperLeaves.Size() && Header[3]==GetSuperLeavesChecksum();
+
+    if (Ok && Done.Size()>0) Ok=fread(&Done[0], sizeof(uint8_t ), Done.Size(), File)==Done.Size();
+    if (Ok && Bits.Size()>0) Ok=fread(&Bits[0], sizeof(uint32_t), Bits.Size(), File)==Bits.Size();
+    fclose(File);
+
+    if (!Ok)
+    {
+        printf("WARNING: The checkpoint file \"%s\" does not match this world, ignoring it.\n", FileName.c_str());
+        return 0;
+    }
+
+    unsigned long DoneCount=0;
+
+    for (unsigned long SL=0; SL<Done.Size(); SL++)
+    {
+        SuperLeavesDone[SL]=(Done[SL]!=0);
+        if (Done[SL]) DoneCount++;
+    }
+
+    for (unsigned long Nr=0; Nr<Bits.Size(); Nr++)
+        SuperLeavesPVS[Nr].fetch_or(Bits[Nr]);
+
+    return DoneCount;
+}
+
+
 // Analytically computes the 'SuperLeavesPVS'.
 // A prior call to 'DetermineTrivialVisibility()' is assumed.
-void BuildPVS()
+// If 'CheckpointName' is not empty, the intermediate results are saved to this file every 'CheckpointInterval' seconds.
+void BuildPVS(const std::string& CheckpointName, unsigned long CheckpointInterval)
 {
     /* // Der komplette alte, aber einfache Code. Evtl. nützlich für Debugging-Zwecke.
     for (unsigned long MasterSL=0; MasterSL+1<SuperLeaves.Size(); MasterSL++)
@@ -640,87 +849,40 @@ void BuildPVS()
 
 
     // Für jedes SuperLeaf das PVS bestimmen.
-    for (unsigned long MasterSL=0; MasterSL<SuperLeaves.Size(); MasterSL++)
-    {
-        printf("%5.1f%%\r", (double)MasterSL/SuperLeaves.Size()*100.0);
-        fflush(stdout);
+    // The 'MasterSL's are handed out to the threads in increasing order, so that the PVS of the SuperLeaves with lower
+    // numbers is mostly complete when it is needed for pruning in CanSeeFromAToB() (see IsKnownInvisible()).
+    std::atomic<unsigned long> DoneCount(0);
+    std::mutex                 CheckpointMutex;
+    time_t                     LastCheckpoint=time(NULL);   // Protected by 'CheckpointMutex'.
 
-        // Initialisiere die Hilfsarrays für das 'MasterSL'.
-        ArrayT<bool> AV;    // List of "Already     Visible" SuperLeaves from 'MasterSL'.
-        ArrayT<bool> PV;    // List of "Potentially Visible" SuperLeaves from 'MasterSL'.
-        ArrayT<bool> NV;    // List of "Not         Visible" SuperLeaves from 'MasterSL'.
+    for (unsigned long SL=0; SL<SuperLeavesDone.size(); SL++)
+        if (SuperLeavesDone[SL].load()) DoneCount++;
 
-        unsigned long SL;
+    ThreadPool.ParallelFor(SuperLeaves.Size(), [&](unsigned int MasterSL)
+    {
+        // The PVS of this SuperLeaf may already have been loaded from the checkpoint file.
+        if (SuperLeavesDone[MasterSL].load()) return;
 
-        for (SL=0; SL<SuperLeaves.Size(); SL++)
-        {
-            AV.PushBack(false);
-            PV.PushBack(false);
-            NV.PushBack(false);
-        }
+        BuildPVSForMasterSL(MasterSL);
+        SuperLeavesDone[MasterSL]=true;
 
-        // Bestimme, welche SuperLeaves wir von 'MasterSL' aus schon sehen können.
-        for (SL=0; SL<SuperLeaves.Size(); SL++)
-            if (IsVisible(MasterSL, SL)) AV[SL]=true;
-
-        // Bilde eine Liste 'PV' aller SuperLeaves, die von 'MasterSL' aus "potentially visible" sind.
-        // Dies sind zunächst *alle* Nachbarn aller SuperLeaves in der 'AV' Liste, außer denjenigen,
-        // die bereits in der 'AV' oder 'NV' Liste sind, oder deren Index-Nummern 'NeighbourSL' kleiner/gleich 'MasterSL' sind.
-        // Der Grund für letzteres: Wenn früher schon festgestellt wurde, daß wir nicht von 'NeighbourSL' nach 'MasterSL' sehen können,
-        // können wir uns jetzt den Test, ob wir von 'MasterSL' nach 'NeighbourSL' sehen können, sparen.
-        // Wäre der frühere Test dagegen positiv gewesen, wäre 'AV[NeighbourSL]==true', was auch keinen 'PV'-Eintrag verursacht.
-        for (SL=0; SL<SuperLeaves.Size(); SL++)
-            if (AV[SL])
-                for (unsigned long NeighbourNr=0; NeighbourNr<SuperLeaves[SL].Neighbours.Size(); NeighbourNr++)
-                {
-                    const unsigned long NeighbourSL=SuperLeaves[SL].Neighbours[NeighbourNr].SuperLeafNr;
+        printf("%5.1f%%\r", (double)(++DoneCount)/SuperLeaves.Size()*100.0);
+        fflush(stdout);
 
-                    if (!AV[NeighbourSL] && !NV[NeighbourSL] && NeighbourSL>MasterSL) PV[NeighbourSL]=true;
-                }
+        if (CheckpointName.empty()) return;
 
-        // For each 'TargetSL' in 'PV': Determine if 'TargetSL' is visible from 'MasterSL'.
-        while (true)
-        {
-            unsigned long TargetSL;
+        // Only one thread writes the checkpoint, the others don't wait for it.
+        std::unique_lock<std::mutex> Lock(CheckpointMutex, std::try_to_lock);
 
-            for (TargetSL=0; TargetSL<PV.Size(); TargetSL++) if (PV[TargetSL]) break;
-            if (TargetSL>=PV.Size()) break;
+        if (!Lock.owns_lock()) return;
+        if (difftime(time(NULL), LastCheckpoint)<CheckpointInterval) return;
 
-            if (CanSeeFromAToB(MasterSL, TargetSL))
-            {
-                // Redo the init (but 'NV' is possibly not empty anymore).
-                for (SL=0; SL<SuperLeaves.Size(); SL++)
-                {
-                    AV[SL]=false;
-                    PV[SL]=false;
-                }
+        if (!SaveCheckpoint(CheckpointName))
+            printf("WARNING: Could not write the checkpoint file \"%s\".\n", CheckpointName.c_str());
+
+        LastCheckpoint=time(NULL);
+    }, "BuildPVS");
 
-                // Bestimme, welche SuperLeaves wir von 'MasterSL' aus schon sehen können.
-                for (SL=0; SL<SuperLeaves.Size(); SL++)
-                    if (IsVisible(MasterSL, SL)) AV[SL]=true;
-
-                // Bilde eine Liste 'PV' aller SuperLeaves, die von 'MasterSL' aus "potentially visible" sind.
-                // Dies sind zunächst *alle* Nachbarn aller SuperLeaves in der 'AV' Liste, außer denjenigen,
-                // die bereits in der 'AV' oder 'NV' Liste sind, oder deren Index-Nummern 'NeighbourSL' kleiner/gleich 'MasterSL' sind.
-                // Der Grund für letzteres: Wenn früher schon festgestellt wurde, daß wir nicht von 'NeighbourSL' nach 'MasterSL' sehen können,
-                // können wir uns jetzt den Test, ob wir von 'MasterSL' nach 'NeighbourSL' sehen können, sparen.
-                // Wäre der frühere Test dagegen positiv gewesen, wäre 'AV[NeighbourSL]==true', was auch keinen 'PV'-Eintrag verursacht.
-                for (SL=0; SL<SuperLeaves.Size(); SL++)
-                    if (AV[SL])
-                        for (unsigned long NeighbourNr=0; NeighbourNr<SuperLeaves[SL].Neighbours.Size(); NeighbourNr++)
-                        {
-                            const unsigned long NeighbourSL=SuperLeaves[SL].Neighbours[NeighbourNr].SuperLeafNr;
-
-                            if (!AV[NeighbourSL] && !NV[NeighbourSL] && NeighbourSL>MasterSL) PV[NeighbourSL]=true;
-                        }
-            }
-            else
-            {
-                PV[TargetSL]=false;     // Delete 'TargetSL' from PV list.
-                NV[TargetSL]=true;      // Add    'TargetSL' to   NV list.
-            }
-        }
-    }
 
     printf("Final Avg Visibility: %10.5f\n", GetAverageVisibility());
 }
@@ -785,6 +947,13 @@ void Usage()
     printf("-onlySLs         : Do not compute the PVS, just print out how many SuperLeaves\n");
     printf("                   would be created. Used for estimating the above parameter\n");
     printf("                   values (speed vs. quality).\n");
+    printf("-threads n       : The number of threads to use, 0 for one per CPU core.\n");
+    printf("                   Default is 1.\n");
+    printf("-checkpoint s    : Saves the intermediate results every s seconds (default 300)\n");
+    printf("                   into a checkpoint file next to the world file. If CaPVS is\n");
+    printf("                   interrupted, the next run resumes from there. 0 disables.\n");
+    printf("-trace file      : Saves the timings of all jobs to the given file, in the JSON\n");
+    printf("                   format of chrome://tracing.\n");
     printf("\n");
 
     exit(1);
@@ -797,9 +966,12 @@ int main(int ArgC, const char* ArgV[])
     // cf::GameSys::GetGameSysEntityTIM().Init();  // The one-time init of the GameSys entity type info manager.
     // cf::GameSys::GetWorldTIM().Init();          // The one-time init of the GameSys world type info manager.
 
-    unsigned long MaxRecDepthSL  =0xFFFFFFFF;
-    double        MinAreaSL      =0.0;
-    bool          OnlySuperLeaves=false;
+    unsigned long MaxRecDepthSL     =0xFFFFFFFF;
+    double        MinAreaSL         =0.0;
+    bool          OnlySuperLeaves   =false;
+    int           NumThreads        =1;
+    unsigned long CheckpointInterval=300;
+    std::string   TraceFileName     ="";
 
     printf("\n*** Cafu Potentially Visibility Set Utility, Version 05 (%s) ***\n\n\n", __DATE__);
 
@@ -836,6 +1008,33 @@ int main(int ArgC, const char* ArgV[])
         {
             OnlySuperLeaves=true;
         }
+        else if (!_stricmp(ArgV[ArgNr], "-threads"))
+        {
+            ArgNr++;
+            if (ArgNr>=ArgC) Usage();
+
+            NumThreads=atoi(ArgV[ArgNr]);
+            if (NumThreads<0 || NumThreads>256)
+            {
+                printf("The number of threads must be in range 0..256.\n");
+                Usage();
+            }
+        }
+        else if (!_stricmp(ArgV[ArgNr], "-checkpoint"))
+        {
+            ArgNr++;
+            if (ArgNr>=ArgC) Usage();
+
+            CheckpointInterval=strtoul(ArgV[ArgNr], NULL, 10);
+            printf("checkpoint    == %lu s\n", CheckpointInterval);
+        }
+        else if (!_stricmp(ArgV[ArgNr], "-trace"))
+        {
+            ArgNr++;
+            if (ArgNr>=ArgC) Usage();
+
+            TraceFileName=ArgV[ArgNr];
+        }
         else if (ArgV[ArgNr][0]==0)
         {
             // The argument is "", the empty string.
@@ -898,23 +1097,51 @@ int main(int ArgC, const char* ArgV[])
         ComputeSuperLeavesBBs();
 
         // 5. Create and initialize the 'SuperLeavesPVS' (reset to complete blindness (all 0s)).
-        SuperLeavesPVS.PushBackEmpty((SuperLeaves.Size()*SuperLeaves.Size()+31)/32);
-        for (unsigned long Vis=0; Vis<SuperLeavesPVS.Size(); Vis++) SuperLeavesPVS[Vis]=0;
+        {
+            std::vector< std::atomic<uint32_t> > PVS((SuperLeaves.Size()*SuperLeaves.Size()+31)/32);
+            std::vector< std::atomic<bool> >     Done(SuperLeaves.Size());
+
+            SuperLeavesPVS.swap(PVS);
+            SuperLeavesDone.swap(Done);
+        }
+        for (unsigned long Vis=0; Vis<SuperLeavesPVS.size(); Vis++) SuperLeavesPVS[Vis]=0;
+        for (unsigned long SL=0; SL<SuperLeavesDone.size(); SL++) SuperLeavesDone[SL]=false;
 
         // 6. For each SuperLeaf, flag itself and the immediate neighbours as visible.
         DetermineTrivialVisibility();
 
-        // 7. Do some simple ray tests in order to quickly obtain a good estimation of the actual PVS.
-        //    Note that calling this function is ENTIRELY OPTIONAL, and the call can be omitted without danger!
+        // 7. Resume from the checkpoint file of a previous, interrupted run, if there is one.
+        //    Otherwise, do some simple ray tests in order to quickly obtain a good estimation of the actual PVS.
+        //    Note that calling DetermineRayPresampledVisibility() is ENTIRELY OPTIONAL, and the call can be omitted without danger!
         //    (The latter might e.g. be useful for debugging.)
-        DetermineRayPresampledVisibility(CaPVSWorld);
+        const std::string   CheckpointName=CheckpointInterval>0 ? cf::String::StripExt(ArgV[1])+".pvs_checkpoint" : "";
+        const unsigned long ResumeCount   =CheckpointInterval>0 ? LoadCheckpoint(CheckpointName) : 0;
+
+        if (ResumeCount>0)
+        {
+            printf("Resuming from checkpoint file \"%s\", %lu of %lu SuperLeaves done.\n", CheckpointName.c_str(), ResumeCount, SuperLeaves.Size());
+        }
+        else DetermineRayPresampledVisibility(CaPVSWorld);
 
         // 8. Finally calculate the 'SuperLeavesPVS' using analytical methods.
         printf("\n%-50s %s\n", "*** Potentially Visibility Set ***", GetTimeSinceProgramStart());
-        BuildPVS();
+        ThreadPool.SetNumThreads(NumThreads);
+        printf("Using %u thread(s).\n", ThreadPool.GetNumThreads());
+
+        cf::Jobs::TraceT Trace;
+
+        if (TraceFileName!="") ThreadPool.SetTrace(&Trace);
+        BuildPVS(CheckpointName, CheckpointInterval);
+        ThreadPool.SetTrace(NULL);
+
+        if (TraceFileName!="" && !Trace.Save(TraceFileName))
+            printf("Could not save the trace to \"%s\".\n", TraceFileName.c_str());
 
         // 9. Carry the information in 'SuperLeavesPVS' into the PVS of the 'CaPVSWorld'.
-        CaPVSWorld->StorePVS(SuperLeaves, SuperLeavesPVS);
+        ArrayT<unsigned long> SuperLeavesPVSWords;
+
+        for (unsigned long Vis=0; Vis<SuperLeavesPVS.size(); Vis++) SuperLeavesPVSWords.PushBack(SuperLeavesPVS[Vis].load());
+        CaPVSWorld->StorePVS(SuperLeaves, SuperLeavesPVSWords);
 
         // 10. Print some statistics and obtain a checksum.
         unsigned long CheckSum=CaPVSWorld->GetChecksumAndPrintStats();
@@ -925,6 +1152,7 @@ int main(int ArgC, const char* ArgV[])
         CaPVSWorld->SaveToDisk(ArgV[1]);
 
         // 12. Clean-up and write log file entry.
+        if (!CheckpointName.empty()) remove(CheckpointName.c_str());
         delete CaPVSWorld;
         WriteLogFileEntry(ArgV[1], CheckSum);
         printf("\n%-50s %s\n", "COMPLETED.", GetTimeSinceProgramStart());
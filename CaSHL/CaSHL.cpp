@@ -64,6 +64,7 @@ This project is licensed under the terms of the MIT license.
 #include "SceneGraph/BspTreeNode.hpp"
 #include "SceneGraph/FaceNode.hpp"
 #include "ClipSys/CollisionModelMan_impl.hpp"
+#include "Jobs/JobSystem.hpp"
 
 #include "CaSHLWorld.hpp"
 
@@ -141,6 +142,7 @@ const double Pi          =3.14159265358979323846;
 enum FaceVis { NO_VISIBILITY, PARTIAL_VISIBILITY, FULL_VISIBILITY };
 ArrayT< ArrayT<FaceVis> > FacePVS;  // The set of faces each face can see (see InitializeFacePVSMatrix() for a description!)
 ArrayT< ArrayT<PatchT > > Patches;  // Each face gets a set of patches, PatchT is declared in CaSHLWorld.hpp
+cf::Jobs::JobSystemT      ThreadPool;  // The threads that run the parallel parts of the lighting computations, see the "-threads" option.
 
 
 #include "Init1.cpp"    // void InitializeFacePVSMatrix(const cf::SceneGraph::BspTreeNodeT& Map                         ) { ... }
@@ -198,13 +200,14 @@ void RadiateTransfer(const CaSHLWorldT& CaSHLWorld, unsigned long Face_i, unsign
 
 
     // Betrachte alle Patches aller Faces im PVS der Face Face_i.
-    for (unsigned long Face_j=0; Face_j<Map.FaceChildren.Size(); Face_j++)
+    // Each face only receives transfer from Big_P_i, so that the faces can be processed concurrently.
+    ThreadPool.ParallelFor(Map.FaceChildren.Size(), [&](unsigned int Face_j)
     {
         // Vermeide alle unnötigen und evtl. rundungsfehlergefährdeten Berechnungen.
         // Die folgende Zeile fängt auch alle Fälle ab, in denen Face_j in der Ebene von Face_i liegt
         // und insb. für die Face_i==Face_j gilt. Vgl. die Erstellung und Optimierung der FacePVS-Matrix!
-        if (FacePVS[Face_i][Face_j]==NO_VISIBILITY) continue;
-        if (Map.FaceChildren[Face_j]->Polygon.Plane.GetDistance(Big_P_i_Coord)<0.1) continue;
+        if (FacePVS[Face_i][Face_j]==NO_VISIBILITY) return;
+        if (Map.FaceChildren[Face_j]->Polygon.Plane.GetDistance(Big_P_i_Coord)<0.1) return;
 
         bool ExplicitTestRequired=(FacePVS[Face_i][Face_j]!=FULL_VISIBILITY);
 
@@ -267,7 +270,7 @@ void RadiateTransfer(const CaSHLWorldT& CaSHLWorld, unsigned long Face_i, unsign
                 P_j.SHCoeffs_TotalTransfer     [CoeffNr]+=DeltaTransfer;
             }
         }
-    }
+    }, "RadiateTransfer");
 }
 
 
@@ -408,7 +411,8 @@ void DirectLighting(const CaSHLWorldT& CaSHLWorld, const unsigned long SqrtNrOfS
     }
 
 
-    for (FaceNr=0; FaceNr<Map.FaceChildren.Size(); FaceNr++)
+    // Each face only modifies its own patches, so that the faces can be processed concurrently.
+    ThreadPool.ParallelFor(Map.FaceChildren.Size(), [&](unsigned int FaceNr)
     {
         const cf::SceneGraph::FaceNodeT::SHLMapInfoT& SMI=Map.FaceChildren[FaceNr]->SHLMapInfo;
 
@@ -476,7 +480,7 @@ void DirectLighting(const CaSHLWorldT& CaSHLWorld, const unsigned long SqrtNrOfS
                     Patch.SHCoeffs_UnradiatedTransfer[CoeffNr]=Patch.SHCoeffs_TotalTransfer[CoeffNr];
                 }
             }
-    }
+    }, "DirectLighting");
 }
 
 
@@ -1028,6 +1032,8 @@ void Usage()
     printf("-fast          Same as \"-BlockSize 5 -NoFullVis\".\n");
     printf("-Reps n        Number of representative SH vectors used for compression.\n");
     printf("               Default is %u. 0 means no compression.\n", cf::SceneGraph::SHLMapManT::NrOfRepres);
+    printf("-threads n     The number of threads to use, 0 for one per CPU core. Default is 1.\n");
+    printf("               The result does not depend on the number of threads.\n");
     printf("\n");
     printf("\n");
     printf("EXAMPLES:\n");
@@ -1110,8 +1116,9 @@ int main(int ArgC, const char* ArgV[])
         bool          UseFullVis;
         unsigned long SqrtNrOfSamples;
         bool          SkipBL;
+        int           NumThreads;
 
-        CaSHLOptionsT() : BlockSize(3), StopUT(0.1), AskForMore(false), UseFullVis(true), SqrtNrOfSamples(100), SkipBL(false) {}
+        CaSHLOptionsT() : BlockSize(3), StopUT(0.1), AskForMore(false), UseFullVis(true), SqrtNrOfSamples(100), SkipBL(false), NumThreads(1) {}
     } CaSHLOptions;
 
     cf::SceneGraph::SHLMapManT::NrOfBands=4;
@@ -1207,6 +1214,13 @@ int main(int ArgC, const char* ArgV[])
             cf::SceneGraph::SHLMapManT::NrOfRepres=atoi(ArgV[CurrentArg]);
             if (cf::SceneGraph::SHLMapManT::NrOfRepres>65536) Error("Reps must be in range 0..65536.");
         }
+        else if (!_stricmp(ArgV[CurrentArg], "-threads"))
+        {
+            if (CurrentArg+1==ArgC) Error("I can't find a number after \"-threads\"!");
+            CurrentArg++;
+            CaSHLOptions.NumThreads=atoi(ArgV[CurrentArg]);
+            if (CaSHLOptions.NumThreads<0 || CaSHLOptions.NumThreads>256) Error("The number of threads must be in range 0..256.");
+        }
         else if (ArgV[CurrentArg][0]==0)
         {
             // The argument is "", the empty string.
@@ -1279,6 +1293,9 @@ int main(int ArgC, const char* ArgV[])
             printf("  The look-up texture of representatives in the engine will have size %lu x 256 (%.1f%% unused).\n", Width, 100.0-100.0*double(cf::SceneGraph::SHLMapManT::NrOfRepres*NrOfPixelsPerVector)/double(256*Width));
         }
 
+        ThreadPool.SetNumThreads(CaSHLOptions.NumThreads);
+        printf("- Using %u thread(s).\n", ThreadPool.GetNumThreads());
+
         // Initialize
         InitializeFacePVSMatrix(CaSHLWorld, CaSHLOptions.UseFullVis);   // Init1.cpp
         InitializePatches(CaSHLWorld.GetBspTree());                     // Init2.cpp
@@ -163,7 +163,13 @@ void InitializeFacePVSMatrix(const CaSHLWorldT& CaSHLWorld, const bool UseFullVi
     for (unsigned long Face1Nr=0; Face1Nr<Map.FaceChildren.Size(); Face1Nr++)
         FaceBBs.PushBack(BoundingBox3T<double>(Map.FaceChildren[Face1Nr]->Polygon.Vertices));
 
-    for (unsigned long Face1Nr=UseFullVis ? 0 : Map.FaceChildren.Size(); Face1Nr<Map.FaceChildren.Size(); Face1Nr++)
+    // The faces that each face can completely see are only entered into the FacePVS matrix after all faces have been
+    // processed, so that the faces can be processed concurrently while the matrix is only read.
+    ArrayT< ArrayT<unsigned long> > FullVisFaces;
+
+    FullVisFaces.PushBackEmpty(Map.FaceChildren.Size());
+
+    ThreadPool.ParallelFor(UseFullVis ? Map.FaceChildren.Size() : 0, [&](unsigned int Face1Nr)
     {
         printf("%5.1f%%\r", (double)Face1Nr/Map.FaceChildren.Size()*100.0);
         fflush(stdout);
@@ -276,10 +282,18 @@ void InitializeFacePVSMatrix(const CaSHLWorldT& CaSHLWorld, const bool UseFullVi
             if (Occluders.Size()) continue;
 
             // Die Faces Face1Nr und Face2Nr können sich gegenseitig komplett sehen!
+            FullVisFaces[Face1Nr].PushBack(Face2Nr);
+        }
+    }, "InitFullVis");
+
+    for (unsigned long Face1Nr=0; Face1Nr<FullVisFaces.Size(); Face1Nr++)
+        for (unsigned long i=0; i<FullVisFaces[Face1Nr].Size(); i++)
+        {
+            const unsigned long Face2Nr=FullVisFaces[Face1Nr][i];
+
             FacePVS[Face1Nr][Face2Nr]=FULL_VISIBILITY;
             FacePVS[Face2Nr][Face1Nr]=FULL_VISIBILITY;
         }
-    }
 
 
     // 10. Zähle die Anzahl der FULL_VISIBILITY-Elemente in der FacePVS-Matrix.
@@ -0,0 +1,267 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/**********************************/
+/*** Cafu Texture Cache Builder ***/
+/**********************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+    #include <sys/types.h>
+#endif
+
+#include "ConsoleCommands/Console.hpp"
+#include "ConsoleCommands/ConsoleStdout.hpp"
+#include "FileSys/FileManImpl.hpp"
+#include "Jobs/JobSystem.hpp"
+#include "Jobs/Trace.hpp"
+#include "MaterialSystem/MapComposition.hpp"
+#include "MaterialSystem/Material.hpp"
+#include "MaterialSystem/MaterialManager.hpp"
+#include "MaterialSystem/MaterialManagerImpl.hpp"
+#include "MaterialSystem/Common/TextureCache.hpp"
+#include "Templates/Array.hpp"
+
+#include "tclap/CmdLine.h"
+#include "tclap/StdOutput.h"
+
+
+static cf::ConsoleStdoutT ConsoleStdout;
+cf::ConsoleI* Console=&ConsoleStdout;
+
+static cf::FileSys::FileManImplT FileManImpl;
+cf::FileSys::FileManI* cf::FileSys::FileMan=&FileManImpl;
+
+MaterialManagerI* MaterialManager=NULL;
+
+
+/// A texture whose images are to be baked into a texture cache file.
+struct TextureT
+{
+    ArrayT<MapCompositionT> Images;         ///< The images of the texture: one for 2D textures, six for cube maps.
+    std::string             Key;            ///< The key of the texture, see TextureCacheT::GetKey().
+    bool                    NoCompression;  ///< Whether the texture must not be block-compressed.
+    std::string             Result;         ///< The result of baking the texture, for the report.
+};
+
+
+// Adds the texture with the given images to Textures, unless it cannot be cached or is already there.
+static void AddTexture(std::map<std::string, TextureT>& Textures, const ArrayT<MapCompositionT>& Images, bool NoCompression)
+{
+    const std::string Key=TextureCacheT::GetKey(Images);
+
+    if (Key=="") return;
+
+    TextureT& Texture=Textures[TextureCacheT::GetFileName(Images, Key)];
+
+    Texture.Images       =Images;
+    Texture.Key          =Key;
+    Texture.NoCompression=NoCompression;
+}
+
+
+static void Add2DTexture(std::map<std::string, TextureT>& Textures, const MapCompositionT& MapComp)
+{
+    if (MapComp.IsEmpty()) return;
+
+    ArrayT<MapCompositionT> Images;
+
+    Images.PushBack(MapComp);
+    AddTexture(Textures, Images, MapComp.GetNoCompression());
+}
+
+
+// The images of cube maps are composed exactly as in TextureMapCubeT::GetLoadJob() of the renderers,
+// because otherwise the keys of the baked textures would not match the keys of the textures at run-time.
+static void AddCubeTexture(std::map<std::string, TextureT>& Textures, const MapCompositionT& MapComp)
+{
+    static const char* CubeSuffixes[6]={ "_px", "_py", "_pz", "_nx", "_ny", "_nz" };
+
+    if (MapComp.IsEmpty()) return;
+
+    ArrayT<MapCompositionT> Images;
+
+    for (unsigned long SideNr=0; SideNr<6; SideNr++)
+    {
+        std::string SideString=MapComp.GetString();
+
+        for (std::string::size_type i=SideString.find("#"); i!=std::string::npos; i=SideString.find("#"))
+            SideString.replace(i, 1, CubeSuffixes[SideNr]);
+
+        TextParserT TP(SideString.c_str(), "({[]}),", false);
+        Images.PushBack(MapCompositionT(TP, MapComp.GetBaseDir()));
+    }
+
+    AddTexture(Textures, Images, MapComp.GetNoCompression());
+}
+
+
+static bool MakeDirectory(const std::string& DirName)
+{
+#ifdef _WIN32
+    return _mkdir(DirName.c_str())==0 || errno==EEXIST;
+#else
+    return mkdir(DirName.c_str(), 0755)==0 || errno==EEXIST;
+#endif
+}
+
+
+int main(int ArgC, char* ArgV[])
+{
+    // Initialize the FileMan by mounting the default file system.
+    // Note that specifying "./" (instead of "") as the file system description effectively prevents the use of
+    // absolute paths like "D:\abc\someDir\someFile.xy" or "/usr/bin/xy". This however should be fine for this application.
+    cf::FileSys::FileMan->MountFileSystem(cf::FileSys::FS_TYPE_LOCAL_PATH, "./", "");
+
+    // Process the command line options.
+    TCLAP::StdOutput stdOutput(std::cout, std::cerr);
+    TCLAP::CmdLine cmd("Cafu Engine Texture Cache Builder. Bakes the textures of all materials of a game, with their mipmaps, into the \"TexCache\" directory of the game.", stdOutput, ' ', "1.0");
+
+    const TCLAP::ValueArg<std::string>  BaseDirName("d", "base-dir", "Name of the base directory to search for material scripts.", false, "Games/DeathMatch", "string", cmd);
+    const TCLAP::SwitchArg              Compress("c", "compress", "Block-compress (DXT1/DXT5) the textures that don't have the \"noCompression\" option.", cmd, false);
+    const TCLAP::SwitchArg              Force("f", "force", "Rebuild all cache files, even those that are up-to-date.", cmd, false);
+    const TCLAP::ValueArg<unsigned int> NumThreads("j", "jobs", "The number of threads to use, 0 for one per hardware thread.", false, 0, "number", cmd);
+    const TCLAP::ValueArg<std::string>  TraceFile("", "trace", "Saves the timings of all jobs to the given file, in the JSON format of chrome://tracing.", false, "", "file", cmd);
+
+    TCLAP::VersionVisitor vv(&cmd, stdOutput);
+    const TCLAP::SwitchArg argVersion("",  "version", "Displays version information and exits.", cmd, false, &vv);
+
+    TCLAP::HelpVisitor hv(&cmd, stdOutput);
+    const TCLAP::SwitchArg argHelp("h", "help", "Displays usage information and exits.", cmd, false, &hv);
+
+    try
+    {
+        cmd.parse(ArgC, ArgV);
+    }
+    catch (const TCLAP::ExitException& ee)
+    {
+        //  ExitException is thrown after --help or --version was handled.
+        return ee.getExitStatus();
+    }
+    catch (const TCLAP::ArgException& e)
+    {
+        cmd.getOutput().failure(cmd, e, true);
+        return -1;
+    }
+
+    // Setup the global Material Manager pointer.
+    static MaterialManagerImplT MatManImpl;
+
+    MaterialManager=&MatManImpl;
+
+    // Register the material script files with the material manager.
+    if (MaterialManager->RegisterMaterialScriptsInDir(BaseDirName.getValue() + "/Materials", BaseDirName.getValue() + "/").Size()==0)
+    {
+        printf("No materials found in scripts in \"%s/Materials\".\n", BaseDirName.getValue().c_str());
+        return 1;
+    }
+
+    // Collect the textures of all materials. Textures that are shared by several materials are only collected once.
+    std::map<std::string, TextureT> Textures;
+
+    const std::map<std::string, MaterialT*>& Materials=MaterialManager->GetAllMaterials();
+
+    for (std::map<std::string, MaterialT*>::const_iterator It=Materials.begin(); It!=Materials.end(); ++It)
+    {
+        const MaterialT* Mat=It->second;
+
+        Add2DTexture(Textures, Mat->DiffMapComp);
+        Add2DTexture(Textures, Mat->NormMapComp);
+        Add2DTexture(Textures, Mat->SpecMapComp);
+        Add2DTexture(Textures, Mat->LumaMapComp);
+        Add2DTexture(Textures, Mat->LightMapComp);
+        Add2DTexture(Textures, Mat->SHLMapComp);
+
+        for (unsigned long ParamNr=0; ParamNr<Mat->ShaderParamMapC.Size(); ParamNr++)
+            Add2DTexture(Textures, Mat->ShaderParamMapC[ParamNr]);
+
+        AddCubeTexture(Textures, Mat->CubeMap1Comp);
+        AddCubeTexture(Textures, Mat->CubeMap2Comp);
+    }
+
+    // Create the cache directories.
+    for (std::map<std::string, TextureT>::const_iterator It=Textures.begin(); It!=Textures.end(); ++It)
+    {
+        const std::string DirName=It->second.Images[0].GetBaseDir() + "TexCache";
+
+        if (!MakeDirectory(DirName))
+        {
+            printf("Could not create directory \"%s\".\n", DirName.c_str());
+            return 1;
+        }
+    }
+
+    printf("Baking %lu textures of %lu materials...\n", (unsigned long)Textures.size(), (unsigned long)Materials.size());
+
+    // Bake the textures in parallel.
+    std::vector<std::string> FileNames;
+    std::vector<TextureT*>   Jobs;
+
+    for (std::map<std::string, TextureT>::iterator It=Textures.begin(); It!=Textures.end(); ++It)
+    {
+        FileNames.push_back(It->first);
+        Jobs.push_back(&It->second);
+    }
+
+    cf::Jobs::JobSystemT ThreadPool(NumThreads.getValue());
+    cf::Jobs::TraceT     Trace;
+
+    if (TraceFile.getValue()!="") ThreadPool.SetTrace(&Trace);
+
+    ThreadPool.ParallelFor((unsigned int)Jobs.size(), [&](unsigned int JobNr)
+    {
+        TextureT& Texture=*Jobs[JobNr];
+
+        if (!Force.getValue() && TextureCacheT::IsUpToDate(FileNames[JobNr], Texture.Key))
+        {
+            Texture.Result="up-to-date";
+            return;
+        }
+
+        TextureCacheT Cache;
+        std::string   Warnings;
+
+        Cache.Build(Texture.Images, Texture.Key, Compress.getValue() && !Texture.NoCompression, &Warnings);
+
+        if (!Cache.Save(FileNames[JobNr]))
+        {
+            Texture.Result="ERROR: could not write the file";
+            return;
+        }
+
+        Texture.Result=Cache.GetFormat()==TextureCacheT::DXT1 ? "baked (DXT1)" :
+                       Cache.GetFormat()==TextureCacheT::DXT5 ? "baked (DXT5)" : "baked";
+
+        if (Warnings!="") Texture.Result+=", WARNINGS:\n" + Warnings;
+    }, "BakeTexture");
+
+    ThreadPool.SetTrace(NULL);
+
+    if (TraceFile.getValue()!="" && !Trace.Save(TraceFile.getValue()))
+        printf("Could not save the trace to \"%s\".\n", TraceFile.getValue().c_str());
+
+    // Print the report.
+    unsigned long NumErrors=0;
+
+    for (unsigned long JobNr=0; JobNr<Jobs.size(); JobNr++)
+    {
+        printf("%s  %s  %s\n", FileNames[JobNr].c_str(), Jobs[JobNr]->Images[0].GetString().c_str(), Jobs[JobNr]->Result.c_str());
+
+        if (Jobs[JobNr]->Result.compare(0, 5, "ERROR")==0) NumErrors++;
+    }
+
+    printf("Done, %lu errors.\n", NumErrors);
+    return NumErrors>0 ? 1 : 0;
+}
@@ -19,10 +19,12 @@ This project is licensed under the terms of the MIT license.
 #include "SceneGraph/Node.hpp"
 #include "SceneGraph/BspTreeNode.hpp"
 #include "String.hpp"
+#include "Util/MappedFile.hpp"
 
 #include <cassert>
 #include <cstring>
 #include <fstream>
+#include <memory>
 
 
 /************/
@@ -164,7 +166,60 @@ void StaticEntityDataT::WriteTo(std::ostream& OutFile, cf::SceneGraph::aux::Pool
 /*** WorldT ***/
 /**************/
 
+/*
+ * The .cw world file consists of a header, a table of sections, and the sections themselves:
+ *
+ *   - the header is the string "CAFU WORLD BSP FILE." (padded with zeros to 32 bytes),
+ *     followed by the uint16 file version, the uint16 number of sections and four reserved bytes,
+ *   - the table has a SectionHeaderT for each section,
+ *   - each section starts at a multiple of SECTION_ALIGN bytes from the beginning of the file.
+ *
+ * Thus, the arrays in the sections (e.g. the lightmap texels) are properly aligned when the
+ * file is mapped into memory, and sections that are not needed are never even paged in.
+ * As everywhere else in the .cw file, all values are stored in little-endian byte order.
+ */
+namespace
+{
+    const unsigned short CW_FILE_VERSION = 31;
+    const size_t         CW_HEADER_SIZE  = 32 + 2 + 2 + 4;
+    const size_t         SECTION_ALIGN   = 16;
+
+    struct SectionHeaderT
+    {
+        char     Id[4];     ///< The identifier of the section, e.g. "ENTS".
+        uint32_t Reserved;
+        uint64_t Offset;    ///< The offset of the section from the beginning of the file.
+        uint64_t Size;      ///< The size of the section in bytes.
+    };
+
+    const char SECTION_ENTITIES [4] = { 'E', 'N', 'T', 'S' };  ///< The static entity data (terrains, BSP trees and collision models).
+    const char SECTION_LIGHTMAPS[4] = { 'L', 'M', 'A', 'P' };  ///< The lightmaps, see LightMapManT::WriteBitmaps().
+    const char SECTION_SHLMAPS  [4] = { 'S', 'H', 'L', 'M' };  ///< The SHL maps, see SHLMapManT::WriteSHLMaps().
+
+
+    // Pads the file to the next multiple of SECTION_ALIGN and starts a new section there.
+    void BeginSection(std::ostream& OutFile, SectionHeaderT& Section, const char Id[4])
+    {
+        const char Padding[SECTION_ALIGN] = { 0 };
+
+        OutFile.write(Padding, (SECTION_ALIGN - size_t(OutFile.tellp()) % SECTION_ALIGN) % SECTION_ALIGN);
+
+        memcpy(Section.Id, Id, 4);
+        Section.Reserved = 0;
+        Section.Offset   = uint64_t(OutFile.tellp());
+        Section.Size     = 0;
+    }
+
+
+    void EndSection(std::ostream& OutFile, SectionHeaderT& Section)
+    {
+        Section.Size = uint64_t(OutFile.tellp()) - Section.Offset;
+    }
+}
+
+
 WorldT::WorldT()
+    : m_File(NULL)
 {
 }
 
@@ -173,6 +228,8 @@ WorldT::~WorldT()
 {
     for (unsigned int EntNr = 0; EntNr < m_StaticEntityData.Size(); EntNr++)
         delete m_StaticEntityData[EntNr];
+
+    delete m_File;
 }
 
 
@@ -194,78 +251,157 @@ static std::string GetModDir(const char* FileName)
 }
 
 
-WorldT::WorldT(const char* FileName, ModelManagerT& ModelMan, cf::GuiSys::GuiResourcesT& GuiRes, ProgressFunctionT ProgressFunction) /*throw (LoadErrorT)*/
+WorldT::WorldT(const char* FileName, ModelManagerT& ModelMan, cf::GuiSys::GuiResourcesT& GuiRes, ProgressFunctionT ProgressFunction, bool LoadRenderData) /*throw (LoadErrorT)*/
+    : m_File(NULL)
 {
     // Set the plant descriptions manager mod directory to the one from the world to load.
     PlantDescrMan.SetModDir(GetModDir(FileName));
 
-    std::ifstream InFile(FileName, std::ios::in | std::ios::binary);
-    if (InFile.bad()) throw LoadErrorT("Unable to open Cafu world file.");
+    std::unique_ptr<cf::MappedFileT> File(new cf::MappedFileT(FileName));
+    if (!File->IsOpen()) throw LoadErrorT("Unable to open Cafu world file.");
 
-    // Determine the size of the input file.
-    InFile.seekg(0, std::ios::end);
-    const std::streampos InFileSize=InFile.tellg();
-    InFile.seekg(0, std::ios::beg);
-    if (ProgressFunction) ProgressFunction(float(InFile.tellg())/float(InFileSize), "Opening file.");
+    const char*  FileData = File->GetData();
+    const size_t FileSize = File->GetSize();
 
-    char FileHeader[32];
-    InFile.read(FileHeader, 32);
-    if (strcmp(FileHeader, "CAFU WORLD BSP FILE.")) throw LoadErrorT("Invalid file header. Not a Cafu world file.");
+    if (ProgressFunction) ProgressFunction(0.0f, "Opening file.");
+
+    if (FileSize < CW_HEADER_SIZE || memcmp(FileData, "CAFU WORLD BSP FILE.", 21) != 0) throw LoadErrorT("Invalid file header. Not a Cafu world file.");
 
     unsigned short FileVersion;
-    InFile.read((char*)&FileVersion, sizeof(FileVersion));
-    if (FileVersion != 30) throw LoadErrorT("Invalid file version. Current version is 30.");
+    unsigned short NumSections;
 
-    cf::SceneGraph::aux::PoolT Pool;
+    memcpy(&FileVersion, FileData + 32, sizeof(FileVersion));
+    memcpy(&NumSections, FileData + 34, sizeof(NumSections));
+
+    if (FileVersion != CW_FILE_VERSION) throw LoadErrorT("Invalid file version. Current version is 31.");
+    if (FileSize < CW_HEADER_SIZE + NumSections * sizeof(SectionHeaderT)) throw LoadErrorT("Invalid section table in Cafu world file.");
+
+    // Read the table of sections.
+    SectionT EntitiesSection;
+    bool     HaveEntities = false;
+
+    assert(sizeof(SectionHeaderT) == 24);
+
+    for (unsigned int SectionNr = 0; SectionNr < NumSections; SectionNr++)
+    {
+        SectionHeaderT Header;
+
+        memcpy(&Header, FileData + CW_HEADER_SIZE + SectionNr * sizeof(SectionHeaderT), sizeof(Header));
+
+        if (Header.Offset > FileSize || Header.Size > FileSize - Header.Offset) throw LoadErrorT("Invalid section table in Cafu world file.");
+
+        SectionT Section;
 
+        Section.Offset = size_t(Header.Offset);
+        Section.Size   = size_t(Header.Size);
 
-    // 1.3. Read global SHL map data.
-    InFile.read((char*)&cf::SceneGraph::SHLMapManT::NrOfBands,  sizeof(cf::SceneGraph::SHLMapManT::NrOfBands ));
-    InFile.read((char*)&cf::SceneGraph::SHLMapManT::NrOfRepres, sizeof(cf::SceneGraph::SHLMapManT::NrOfRepres));
+        // Sections with unknown identifiers are skipped, so that later versions can add more.
+             if (memcmp(Header.Id, SECTION_ENTITIES,  4) == 0) { EntitiesSection    = Section; HaveEntities = true; }
+        else if (memcmp(Header.Id, SECTION_LIGHTMAPS, 4) == 0) m_LightMapsSection = Section;
+        else if (memcmp(Header.Id, SECTION_SHLMAPS,   4) == 0) m_SHLMapsSection   = Section;
+    }
+
+    if (!HaveEntities) throw LoadErrorT("The Cafu world file has no entities section.");
 
-    // Read the lookup-table the indices are referring to (nothing is written when FaceT::SHLMapInfoT::NrOfRepres==0 (uncompressed data)).
-    SHLMapMan.ReadSHLCoeffsTable(InFile);
 
+    // Read the static entity data.
+    if (ProgressFunction) ProgressFunction(float(EntitiesSection.Offset) / float(FileSize), "Reading Game Entities.");
 
-    // 5. Read GameEntities
-    if (ProgressFunction) ProgressFunction(float(InFile.tellg())/float(InFileSize), "Reading Game Entities.");
+    cf::MemoryInStreamT        InFile(FileData + EntitiesSection.Offset, EntitiesSection.Size);
+    cf::SceneGraph::aux::PoolT Pool;
 
     const unsigned int NumGameEnts = cf::SceneGraph::aux::ReadUInt32(InFile);
 
     for (unsigned int EntNr = 0; EntNr < NumGameEnts; EntNr++)
     {
         m_StaticEntityData.PushBack(new StaticEntityDataT(InFile, Pool, ModelMan, LightMapMan, SHLMapMan, PlantDescrMan));
+
+        if (InFile.fail()) throw LoadErrorT("Unexpected end of the entities section in Cafu world file.");
+    }
+
+
+    // Read the render data now, or keep the file for reading it later.
+    m_File = File.release();
+
+    if (LoadRenderData)
+    {
+        if (ProgressFunction) ProgressFunction(float(m_LightMapsSection.Offset) / float(FileSize), "Reading lightmaps.");
+
+        this->LoadRenderData();
     }
 
     if (ProgressFunction) ProgressFunction(1.0f, "World file loaded.");
 }
 
 
+void WorldT::LoadRenderData() /*throw (LoadErrorT)*/
+{
+    if (m_File == NULL) return;
+
+    // If reading fails, m_File is kept and eventually freed in the destructor.
+    const char* FileData = m_File->GetData();
+
+    if (m_LightMapsSection.Size > 0)
+        if (!LightMapMan.ReadBitmaps(FileData + m_LightMapsSection.Offset, m_LightMapsSection.Size))
+            throw LoadErrorT("Invalid lightmaps section in Cafu world file.");
+
+    if (m_SHLMapsSection.Size > 0)
+        if (!SHLMapMan.ReadSHLMaps(FileData + m_SHLMapsSection.Offset, m_SHLMapsSection.Size))
+            throw LoadErrorT("Invalid SHL maps section in Cafu world file.");
+
+    delete m_File;
+    m_File = NULL;
+}
+
+
 void WorldT::SaveToDisk(const char* FileName) const /*throw (SaveErrorT)*/
 {
+    if (m_File != NULL) throw SaveErrorT("The lightmaps of the world have not been loaded.");
+
     std::ofstream OutFile(FileName, std::ios::out | std::ios::binary);
     if (OutFile.bad()) throw SaveErrorT("Unable to open world BSP file.");
 
-    cf::SceneGraph::aux::PoolT Pool;
+    // Write the header and a placeholder for the table of sections, which is filled in at the end.
+    SectionHeaderT Sections[3];
+    memset(Sections, 0, sizeof(Sections));
 
     char           FileHeader[32] = "CAFU WORLD BSP FILE."; OutFile.write(FileHeader, 32);
-    unsigned short FileVersion    = 30;                     OutFile.write((char*)&FileVersion, sizeof(FileVersion));
-
+    unsigned short FileVersion    = CW_FILE_VERSION;        OutFile.write((char*)&FileVersion, sizeof(FileVersion));
+    unsigned short NumSections    = 3;                      OutFile.write((char*)&NumSections, sizeof(NumSections));
+    uint32_t       Reserved       = 0;                      OutFile.write((char*)&Reserved, sizeof(Reserved));
 
-    // 1.3. Write global SHL map data.
-    OutFile.write((char*)&cf::SceneGraph::SHLMapManT::NrOfBands , sizeof(cf::SceneGraph::SHLMapManT::NrOfBands ));
-    OutFile.write((char*)&cf::SceneGraph::SHLMapManT::NrOfRepres, sizeof(cf::SceneGraph::SHLMapManT::NrOfRepres));
+    const std::streampos TablePos = OutFile.tellp();
+    OutFile.write((char*)Sections, sizeof(Sections));
 
-    // Write the lookup-table the indices are referring to (nothing is written when cf::SceneGraph::SHLMapManT::NrOfRepres==0 (uncompressed data)).
-    // This writes a total of cf::SceneGraph::SHLMapManT::NrOfRepres*NR_OF_SH_COEFFS coefficients.
-    SHLMapMan.WriteSHLCoeffsTable(OutFile);
 
+    // Write the static entity data.
+    BeginSection(OutFile, Sections[0], SECTION_ENTITIES);
+    {
+        cf::SceneGraph::aux::PoolT Pool;
 
-    // 5. Write GameEntities
-    cf::SceneGraph::aux::Write(OutFile, cf::SceneGraph::aux::cnc_ui32(m_StaticEntityData.Size()));
+        cf::SceneGraph::aux::Write(OutFile, cf::SceneGraph::aux::cnc_ui32(m_StaticEntityData.Size()));
 
-    for (unsigned int EntNr = 0; EntNr < m_StaticEntityData.Size(); EntNr++)
-    {
-        m_StaticEntityData[EntNr]->WriteTo(OutFile, Pool);
+        for (unsigned int EntNr = 0; EntNr < m_StaticEntityData.Size(); EntNr++)
+        {
+            m_StaticEntityData[EntNr]->WriteTo(OutFile, Pool);
+        }
     }
+    EndSection(OutFile, Sections[0]);
+
+    // Write the lightmaps.
+    BeginSection(OutFile, Sections[1], SECTION_LIGHTMAPS);
+    LightMapMan.WriteBitmaps(OutFile);
+    EndSection(OutFile, Sections[1]);
+
+    // Write the SHL maps, including the global SHL map data and the lookup-table the indices are referring to.
+    BeginSection(OutFile, Sections[2], SECTION_SHLMAPS);
+    SHLMapMan.WriteSHLMaps(OutFile);
+    EndSection(OutFile, Sections[2]);
+
+
+    // Fill in the table of sections.
+    OutFile.seekp(TablePos);
+    OutFile.write((char*)Sections, sizeof(Sections));
+
+    if (OutFile.fail()) throw SaveErrorT("Could not write world BSP file.");
 }
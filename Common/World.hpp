@@ -24,6 +24,7 @@ This project is licensed under the terms of the MIT license.
 #include <string>
 
 
+namespace cf { class MappedFileT; }
 namespace cf { namespace SceneGraph { class BspTreeNodeT; } }
 namespace cf { namespace ClipSys    { class CollisionModelStaticT; } }
 namespace cf { namespace GameSys    { class WorldT; } }
@@ -96,12 +97,23 @@ class WorldT
     WorldT();
 
     /// Constructor for creating a world from a .cw file.
-    WorldT(const char* FileName, ModelManagerT& ModelMan, cf::GuiSys::GuiResourcesT& GuiRes, ProgressFunctionT ProgressFunction=NULL) /*throw (LoadErrorT)*/;
+    /// @param FileName           The name of the .cw file to load the world from.
+    /// @param ModelMan           The model manager for the models in the world.
+    /// @param GuiRes             The GUI resources for the GUIs in the world.
+    /// @param ProgressFunction   If not NULL, this function is called to report the progress of loading.
+    /// @param LoadRenderData     Whether the data that is only needed for rendering (the lightmaps and SHL maps) is loaded, too.
+    ///     If false, the file is kept mapped into memory and the render data is only loaded by LoadRenderData(),
+    ///     so that dedicated servers never spend the time and memory for it.
+    WorldT(const char* FileName, ModelManagerT& ModelMan, cf::GuiSys::GuiResourcesT& GuiRes, ProgressFunctionT ProgressFunction=NULL, bool LoadRenderData=true) /*throw (LoadErrorT)*/;
 
     /// Destructor.
     ~WorldT();
 
+    /// Loads the lightmaps and SHL maps if this has not been done in the constructor already.
+    void LoadRenderData() /*throw (LoadErrorT)*/;
+
     /// Saves the world to disk.
+    /// The render data must have been loaded, see LoadRenderData().
     void SaveToDisk(const char* FileName) const /*throw (SaveErrorT)*/;
 
 
@@ -113,8 +125,21 @@ class WorldT
 
     private:
 
+    /// The location of a section in the world file.
+    struct SectionT
+    {
+        SectionT() : Offset(0), Size(0) { }
+
+        size_t Offset;
+        size_t Size;
+    };
+
     WorldT(const WorldT&);              // Use of the Copy    Constructor is not allowed.
     void operator = (const WorldT&);    // Use of the Assignment Operator is not allowed.
+
+    cf::MappedFileT* m_File;            ///< The world file until the render data has been loaded from it, NULL afterwards.
+    SectionT         m_LightMapsSection;
+    SectionT         m_SHLMapsSection;
 };
 
 #endif
@@ -17,15 +17,20 @@ const WorldT* WorldManT::LoadWorld(const char* FileName, ModelManagerT& ModelMan
         if (WI.FileName==FileName)
         {
             assert(WI.RefCount>0);
-            WI.RefCount++;
+
+            // This can throw if the render data of the world cannot be loaded.
             if (InitForGraphics && !WI.Init4Gfx) InitWorldForGfx(WI);
+
+            WI.RefCount++;
             return WI.WorldPtr;
         }
     }
 
 
     // FileName not found in cache, create a new instance.
-    WorldT* NewWorld=new WorldT(FileName, ModelMan, GuiRes, ProgressFunction);  // Must do this here in case WorldT::WorldT() throws.
+    // Must do this here in case WorldT::WorldT() throws.
+    // The render data is only loaded if needed, so that dedicated servers don't waste time and memory on it.
+    WorldT* NewWorld=new WorldT(FileName, ModelMan, GuiRes, ProgressFunction, InitForGraphics);
 
     Worlds.PushBackEmpty();
     WorldInfoT& WI=Worlds[Worlds.Size()-1];
@@ -78,6 +83,9 @@ void WorldManT::InitWorldForGfx(WorldInfoT& WI)
     // Assert that this is done only once for any world instance.
     assert(!WI.Init4Gfx);
 
+    // Load the lightmaps and SHL maps if the world was first loaded for a dedicated server.
+    WI.WorldPtr->LoadRenderData();
+
 #if SHL_ENABLED
     WI.WorldPtr->SHLMapMan.InitTextures();
 #endif
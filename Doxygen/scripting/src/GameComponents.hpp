@@ -385,9 +385,13 @@ class ComponentHumanPlayerT : public ComponentBaseT
     /// scattered (used to simulate inaccurate human aiming) by the given parameter `Random`.
     /// If an entity is hit, its TakeDamage() method is called with the human player as the originator and
     /// the amount of damage as given by parameter `Damage`.
-    /// @param Damage   The damage to inflict to a possibly hit entity.
-    /// @param Random   The maximum amount of random scatter to apply to the traced ray.
-    FireRay(number Damage, number Random = 0.0);
+    /// Weapons that fire several pellets at once, such as shotguns, can pass the number of rays in `NumRays`.
+    /// Each ray is scattered individually, and the rays are traced together, which is faster than calling
+    /// this method once for each of them.
+    /// @param Damage    The damage to inflict to a possibly hit entity (per ray).
+    /// @param Random    The maximum amount of random scatter to apply to the traced ray.
+    /// @param NumRays   The number of rays to trace.
+    FireRay(number Damage, number Random = 0.0, number NumRays = 1);
 
     /// Returns a pseudo-random number.
     ///
@@ -142,9 +142,7 @@ function Shotgun:FirePrimary(ThinkingOnServerSide)
         Model1stPerson:set("Animation", ANIM_SHOOT1)
 
         if ThinkingOnServerSide then
-            for i = 1, 8 do
-                HumanPlayer:FireRay(3.0, 0.08748866)    -- ca. 5°
-            end
+            HumanPlayer:FireRay(3.0, 0.08748866, 8)    -- ca. 5°, 8 pellets
         end
     end
 end
@@ -166,9 +164,7 @@ function Shotgun:FireSecondary(ThinkingOnServerSide)
         Model1stPerson:set("Animation", ANIM_SHOOT2)
 
         if ThinkingOnServerSide then
-            for i = 1, 16 do
-                HumanPlayer:FireRay(3.0, 0.08748866)    -- ca. 5°
-            end
+            HumanPlayer:FireRay(3.0, 0.08748866, 16)    -- ca. 5°, 16 pellets
         end
     end
 end
@@ -22,6 +22,13 @@ extern "C"
 #define _stricmp strcasecmp
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define CAFU_BITMAP_SSE2 1
+#else
+#define CAFU_BITMAP_SSE2 0
+#endif
+
 
 // This method is defined in ./jdatasrc.cpp
 void jpeg_FileSys_src(j_decompress_ptr cinfo, cf::FileSys::InFileI* JpegFile_);
@@ -99,7 +106,7 @@ static uint32_t ReadTgaPixel(cf::FileSys::InFileI* TgaFile, char ImagePixelSize)
 }
 
 
-BitmapT::BitmapT(const char* FileName) /*throw (LoadErrorT)*/ : SizeX(0), SizeY(0)
+BitmapT::BitmapT(const char* FileName, std::string* Warnings) /*throw (LoadErrorT)*/ : SizeX(0), SizeY(0)
 {
     if (FileName==NULL) throw LoadErrorT();
 
@@ -111,7 +118,7 @@ BitmapT::BitmapT(const char* FileName) /*throw (LoadErrorT)*/ : SizeX(0), SizeY(
     if (_stricmp(&FileName[FileNameLength-4], ".bmp")==0)
     {
         // It is a BMP (Windows Bitmap) file.
-        cf::FileSys::InFileI* BmpFile=cf::FileSys::FileMan->OpenRead(FileName);
+        cf::FileSys::InFileI* BmpFile=cf::FileSys::FileMan->OpenRead(FileName, Warnings);
         if (BmpFile==NULL) throw LoadErrorT();
 
         uint16_t Data2;
@@ -143,9 +150,10 @@ BitmapT::BitmapT(const char* FileName) /*throw (LoadErrorT)*/ : SizeX(0), SizeY(
         {
             for (unsigned int PosX=0; PosX<SizeX; PosX++)
             {
-                char Blue;  BmpFile->Read(&Blue , 1);
-                char Green; BmpFile->Read(&Green, 1);
-                char Red;   BmpFile->Read(&Red  , 1);
+                // The channels must be unsigned, or values of 128 and above would be sign-extended into the other channels.
+                unsigned char Blue;  BmpFile->Read((char*)&Blue , 1);
+                unsigned char Green; BmpFile->Read((char*)&Green, 1);
+                unsigned char Red;   BmpFile->Read((char*)&Red  , 1);
 
                 const uint32_t r=Red;
                 const uint32_t g=Green;
@@ -164,7 +172,7 @@ BitmapT::BitmapT(const char* FileName) /*throw (LoadErrorT)*/ : SizeX(0), SizeY(
     else if (_stricmp(&FileName[FileNameLength-4], ".tga")==0)
     {
         // It is a TGA (TrueVision Targa) file.
-        cf::FileSys::InFileI* TgaFile=cf::FileSys::FileMan->OpenRead(FileName);
+        cf::FileSys::InFileI* TgaFile=cf::FileSys::FileMan->OpenRead(FileName, Warnings);
         if (TgaFile==NULL) throw LoadErrorT();
 
         char SizeOfIDField; TgaFile->Read(&SizeOfIDField, sizeof(SizeOfIDField));
@@ -266,7 +274,7 @@ BitmapT::BitmapT(const char* FileName) /*throw (LoadErrorT)*/ : SizeX(0), SizeY(
     else if (_stricmp(&FileName[FileNameLength-4], ".png")==0)
     {
         // It is a PNG (Portable Network Graphics) file.
-        cf::FileSys::InFileI* PngFile=cf::FileSys::FileMan->OpenRead(FileName);
+        cf::FileSys::InFileI* PngFile=cf::FileSys::FileMan->OpenRead(FileName, Warnings);
         if (PngFile==NULL) throw LoadErrorT();
 
         const char    NUM_OF_SIGNATURE_BYTES=8;
@@ -370,7 +378,7 @@ BitmapT::BitmapT(const char* FileName) /*throw (LoadErrorT)*/ : SizeX(0), SizeY(
     else if (_stricmp(&FileName[FileNameLength-4], ".jpg")==0 || _stricmp(&FileName[FileNameLength-5], ".jpeg")==0)
     {
         // It is a jpg/jpeg file.
-        cf::FileSys::InFileI* JpegFile=cf::FileSys::FileMan->OpenRead(FileName);
+        cf::FileSys::InFileI* JpegFile=cf::FileSys::FileMan->OpenRead(FileName, Warnings);
         if (JpegFile==NULL) throw LoadErrorT();
 
         jpeg_decompress_struct CompressInfo;
@@ -572,7 +580,7 @@ void BitmapT::SetPixel(unsigned int x, unsigned int y, float r, float g, float b
 
 void BitmapT::ApplyGamma(float Gamma)
 {
-    char GammaLookup[256];
+    unsigned char GammaLookup[256];
 
     for (unsigned int ValueNr=0; ValueNr<256; ValueNr++)
     {
@@ -581,155 +589,549 @@ void BitmapT::ApplyGamma(float Gamma)
         if (Value<  0.0f) Value=  0.0f;
         if (Value>255.0f) Value=255.0f;
 
-        GammaLookup[ValueNr]=char(Value+0.49f);
+        GammaLookup[ValueNr]=(unsigned char)(Value+0.49f);
     }
 
+    // Note that the channels must be looked up as *unsigned* bytes, because values of 128 and above
+    // would otherwise index the table with negative numbers and spill their sign into the other channels.
     for (unsigned long i=0; i<Data.Size(); i++)
     {
-        char Alpha=char(Data[i] >> 24);
-        char Blue =char(Data[i] >> 16);
-        char Green=char(Data[i] >>  8);
-        char Red  =char(Data[i] >>  0);
+        const uint32_t RGBA=Data[i];
+
+        Data[i]=(RGBA & 0xFF000000) |
+                (uint32_t(GammaLookup[(RGBA >> 16) & 0xFF]) << 16) |
+                (uint32_t(GammaLookup[(RGBA >>  8) & 0xFF]) <<  8) |
+                (uint32_t(GammaLookup[(RGBA >>  0) & 0xFF]) <<  0);
+    }
+}
+
+
+namespace
+{
+    /// The old pixels (columns or rows) that contribute to a pixel (column or row) of the scaled bitmap, see ComputeScaleTaps().
+    struct ScaleTapsT
+    {
+        unsigned int First;         ///< The first contributing old pixel.
+        unsigned int Count;         ///< The number of contributing old pixels.
+        unsigned int FirstWeight;   ///< The index of the weight of the first contributing old pixel in the array of weights.
+    };
+
+
+    // This is my very own algorithm. Is this what they usually call "bilinear"?
+    // Please note that rounding errors in combination with floor() and ceil() can bomb the entire algorithm,
+    // and this is why I'm computing the floors and ceils with exact(!) integer arithmetic, which solves the problem entirely!
+    // The non-integer stuff is only needed for the weights, and I guess we could get rid even of those...!
+    //
+    // The taps and weights only depend on the old and new sizes along an axis, not on the pixels,
+    // so they are computed once per axis here rather than once per pixel in the loops of BitmapT::Scale().
+    void ComputeScaleTaps(unsigned int OldSize, unsigned int NewSize, ArrayT<ScaleTapsT>& Taps, ArrayT<double>& Weights)
+    {
+        for (unsigned int n=0; n<NewSize; n++)
+        {
+            // The n-th pixel in the new bitmap spans in the old bitmap the pixels from o1 to o2.
+            const double       Ratio   =double(OldSize)/double(NewSize);
+            const double       o1      =double(n  )*Ratio;
+            const double       o2      =double(n+1)*Ratio;
+            const unsigned int o1_floor=  n   *OldSize             /NewSize;    // =floor(o1);
+            const unsigned int o2_ceil =((n+1)*OldSize+(NewSize-1))/NewSize;    // =ceil (o2);     // The "+(NewSize-1)" is to get the ceil!
+            const double       o1_frac =o1-o1_floor;
+            const double       o2_frac =o2-(o2_ceil-1);
+
+            ScaleTapsT T;
+
+            T.First      =o1_floor;
+            T.Count      =o2_ceil-o1_floor;
+            T.FirstWeight=Weights.Size();
 
-        const uint32_t NewAlpha=Alpha;
-        const uint32_t NewBlue =GammaLookup[Blue ];
-        const uint32_t NewGreen=GammaLookup[Green];
-        const uint32_t NewRed  =GammaLookup[Red  ];
+            Taps.PushBack(T);
 
-        Data[i]=(NewAlpha << 24)+(NewBlue << 16)+(NewGreen << 8)+NewRed;
+            for (unsigned int o=o1_floor; o<o2_ceil; o++)
+            {
+                if (o1_floor!=o2_ceil-1)
+                {
+                    // The "new" pixel covers at least two old pixels.
+                         if (o==o1_floor ) Weights.PushBack((1.0-o1_frac)/Ratio);   // The first pixel.
+                    else if (o==o2_ceil-1) Weights.PushBack(o2_frac/Ratio);         // The last pixel.
+                    else                   Weights.PushBack(1.0/Ratio);             // One of the middle pixels.
+                }
+                else Weights.PushBack(1.0);     // =Ratio/Ratio;    // This is the only old pixel, and the "new" pixel is entirely in the "old" pixel.
+            }
+        }
+    }
+
+
+#if CAFU_BITMAP_SSE2
+    // Adds the channels of Pixel, weighted by Weight, to Sums[0...3] (red, green, blue, alpha).
+    inline void AddWeightedPixel(double* Sums, uint32_t Pixel, double Weight)
+    {
+        const __m128i Zero=_mm_setzero_si128();
+        const __m128i RGBA=_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(int(Pixel)), Zero), Zero);
+        const __m128d W   =_mm_set1_pd(Weight);
+
+        _mm_storeu_pd(Sums+0, _mm_add_pd(_mm_loadu_pd(Sums+0), _mm_mul_pd(_mm_cvtepi32_pd(RGBA), W)));
+        _mm_storeu_pd(Sums+2, _mm_add_pd(_mm_loadu_pd(Sums+2), _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(RGBA, RGBA)), W)));
     }
+
+    // Rounds the channel sums Sums[0...3] and packs them into a pixel, clamping each channel as BitmapT::SetPixel() does.
+    inline uint32_t PackSums(const double* Sums)
+    {
+        const __m128d Half=_mm_set1_pd(0.49);
+        const __m128i RG  =_mm_cvttpd_epi32(_mm_add_pd(_mm_loadu_pd(Sums+0), Half));
+        const __m128i BA  =_mm_cvttpd_epi32(_mm_add_pd(_mm_loadu_pd(Sums+2), Half));
+        const __m128i RGBA=_mm_packs_epi32(_mm_unpacklo_epi64(RG, BA), _mm_setzero_si128());
+
+        return uint32_t(_mm_cvtsi128_si32(_mm_packus_epi16(RGBA, RGBA)));
+    }
+#else
+    // Adds the channels of Pixel, weighted by Weight, to Sums[0...3] (red, green, blue, alpha).
+    inline void AddWeightedPixel(double* Sums, uint32_t Pixel, double Weight)
+    {
+        for (unsigned int c=0; c<4; c++)
+            Sums[c]+=int((Pixel >> (8*c)) & 0xFF)*Weight;
+    }
+
+    // Rounds the channel sums Sums[0...3] and packs them into a pixel, clamping each channel as BitmapT::SetPixel() does.
+    inline uint32_t PackSums(const double* Sums)
+    {
+        uint32_t RGBA=0;
+
+        for (unsigned int c=0; c<4; c++)
+        {
+            int Value=int(Sums[c]+0.49);
+
+            if (Value<  0) Value=  0;
+            if (Value>255) Value=255;
+
+            RGBA|=uint32_t(Value) << (8*c);
+        }
+
+        return RGBA;
+    }
+#endif
 }
 
 
-// This is my very own algorithm. Is this what they usually call "bilinear"?
-// Please note that rounding errors in combination with floor() and ceil() can bomb the entire algorithm,
-// and this is why I'm computing the floors and ceils with exact(!) integer arithmetic, which solves the problem entirely!
-// The non-integer stuff is only needed for the weights, and I guess we could get rid even of those...!
+// The weights are accumulated in exactly the same order as in the original per-pixel implementation
+// (old pixels in ascending order, each channel in double precision), so that the results are bit-identical to it.
 void BitmapT::Scale(unsigned int NewSizeX, unsigned int NewSizeY)
 {
     if (NewSizeX>=1 && NewSizeX!=SizeX)
     {
         // Scale in x-axis direction.
-        BitmapT NewBitmap;
+        ArrayT<ScaleTapsT> Taps;
+        ArrayT<double>     Weights;
+        ArrayT<uint32_t>   NewData;
 
-        NewBitmap.SizeX=NewSizeX;
-        NewBitmap.SizeY=SizeY;
-        NewBitmap.Data.PushBackEmpty(NewSizeX*SizeY);
+        ComputeScaleTaps(SizeX, NewSizeX, Taps, Weights);
+        NewData.PushBackEmptyExact(NewSizeX*SizeY);
 
-        for (unsigned int nx=0; nx<NewSizeX; nx++)
+        for (unsigned int oy=0; oy<SizeY; oy++)
         {
-            // The nx-th column in the new bitmap spans in the old bitmap the columns from ox1 to ox2.
-            const double       Ratio    =double(SizeX)/double(NewSizeX);
-            const double       ox1      =double(nx  )*Ratio;
-            const double       ox2      =double(nx+1)*Ratio;
-            const unsigned int ox1_floor=  nx   *SizeX              /NewSizeX;     // =floor(ox1);
-            const unsigned int ox2_ceil =((nx+1)*SizeX+(NewSizeX-1))/NewSizeX;     // =ceil (ox2);     // The "+(NewSizeX-1)" is to get the ceil!
-            const double       ox1_frac =ox1-ox1_floor;
-            const double       ox2_frac =ox2-(ox2_ceil-1);
-
-            for (unsigned int oy=0; oy<SizeY; oy++)
-            {
-                double TotalR=0.0;
-                double TotalG=0.0;
-                double TotalB=0.0;
-                double TotalA=0.0;
-             // double TotalW=0.0;
-
-                for (unsigned int ox=ox1_floor; ox<ox2_ceil; ox++)
-                {
-                    double Weight;
-
-                    if (ox1_floor!=ox2_ceil-1)
-                    {
-                        // The "new" pixel covers at least two columns.
-                             if (ox==ox1_floor ) Weight=(1.0-ox1_frac)/Ratio;   // The first column.
-                        else if (ox==ox2_ceil-1) Weight=ox2_frac/Ratio;         // The last column.
-                        else                     Weight=1.0/Ratio;              // One of the middle columns.
-                    }
-                    else Weight=1.0;    // =Ratio/Ratio;    // This is the only iteration of this loop, and the "new" pixel is entirely in the "old" pixel.
+            const uint32_t* Row   =&Data[0]+oy*SizeX;
+            uint32_t*       NewRow=&NewData[0]+oy*NewSizeX;
 
-                    int r, g, b, a;
-                    GetPixel(ox, oy, r, g, b, a);
+            for (unsigned int nx=0; nx<NewSizeX; nx++)
+            {
+                const ScaleTapsT& T      =Taps[nx];
+                double            Sums[4]={ 0.0, 0.0, 0.0, 0.0 };
 
-                    TotalR+=r*Weight;
-                    TotalG+=g*Weight;
-                    TotalB+=b*Weight;
-                    TotalA+=a*Weight;
-                 // TotalW+=Weight;
-                }
+                for (unsigned int i=0; i<T.Count; i++)
+                    AddWeightedPixel(Sums, Row[T.First+i], Weights[T.FirstWeight+i]);
 
-             // if (fabs(TotalW-1.0)>0.0000001) printf("WARNING: TotalW!=1.0: %.15f  %.10f %.10f %.10f %.10f  %lu %lu\n", TotalW, ox1, ox2, ox1_frac, ox2_frac, ox1_floor, ox2_ceil);
-                NewBitmap.SetPixel(nx, oy, int(TotalR+0.49), int(TotalG+0.49), int(TotalB+0.49), int(TotalA+0.49));
+                NewRow[nx]=PackSums(Sums);
             }
         }
 
-        // Copy the scaled bitmap into this bitmap.
-        SizeX=NewBitmap.SizeX;
-        SizeY=NewBitmap.SizeY;
-        Data =NewBitmap.Data;
+        SizeX=NewSizeX;
+        Data =NewData;
     }
 
     if (NewSizeY>=1 && NewSizeY!=SizeY)
     {
         // Scale in y-axis direction.
-        BitmapT NewBitmap;
+        // Whole rows are accumulated at a time, so that the old bitmap is read row by row rather than column by column.
+        ArrayT<ScaleTapsT> Taps;
+        ArrayT<double>     Weights;
+        ArrayT<uint32_t>   NewData;
+        ArrayT<double>     Sums;
 
-        NewBitmap.SizeX=SizeX;
-        NewBitmap.SizeY=NewSizeY;
-        NewBitmap.Data.PushBackEmpty(SizeX*NewSizeY);
+        ComputeScaleTaps(SizeY, NewSizeY, Taps, Weights);
+        NewData.PushBackEmptyExact(SizeX*NewSizeY);
+        Sums.PushBackEmptyExact(4*SizeX);
 
         for (unsigned int ny=0; ny<NewSizeY; ny++)
         {
-            // The ny-th row in the new bitmap spans in the old bitmap the rows from oy1 to oy2.
-            const double       Ratio    =double(SizeY)/double(NewSizeY);
-            const double       oy1      =double(ny  )*Ratio;
-            const double       oy2      =double(ny+1)*Ratio;
-            const unsigned int oy1_floor=  ny   *SizeY              /NewSizeY;     // =floor(oy1);
-            const unsigned int oy2_ceil =((ny+1)*SizeY+(NewSizeY-1))/NewSizeY;     // =ceil (oy2);     // The "+(NewSizeY-1)" is to get the ceil!
-            const double       oy1_frac =oy1-oy1_floor;
-            const double       oy2_frac =oy2-(oy2_ceil-1);
+            const ScaleTapsT& T=Taps[ny];
 
-            for (unsigned int ox=0; ox<SizeX; ox++)
+            for (unsigned long i=0; i<Sums.Size(); i++)
+                Sums[i]=0.0;
+
+            for (unsigned int i=0; i<T.Count; i++)
             {
-                double TotalR=0.0;
-                double TotalG=0.0;
-                double TotalB=0.0;
-                double TotalA=0.0;
-             // double TotalW=0.0;
+                const uint32_t* Row   =&Data[0]+(T.First+i)*SizeX;
+                const double    Weight=Weights[T.FirstWeight+i];
 
-                for (unsigned int oy=oy1_floor; oy<oy2_ceil; oy++)
-                {
-                    double Weight;
+                for (unsigned int ox=0; ox<SizeX; ox++)
+                    AddWeightedPixel(&Sums[0]+4*ox, Row[ox], Weight);
+            }
 
-                    if (oy1_floor!=oy2_ceil-1)
-                    {
-                        // The "new" pixel covers at least two rows.
-                             if (oy==oy1_floor ) Weight=(1.0-oy1_frac)/Ratio;   // The first row.
-                        else if (oy==oy2_ceil-1) Weight=oy2_frac/Ratio;         // The last row.
-                        else                     Weight=1.0/Ratio;              // One of the middle rows.
-                    }
-                    else Weight=1.0;    // =Ratio/Ratio;    // This is the only iteration of this loop, and the "new" pixel is entirely in the "old" pixel.
+            uint32_t* NewRow=&NewData[0]+ny*SizeX;
+
+            for (unsigned int ox=0; ox<SizeX; ox++)
+                NewRow[ox]=PackSums(&Sums[0]+4*ox);
+        }
+
+        SizeY=NewSizeY;
+        Data =NewData;
+    }
+}
 
-                    int r, g, b, a;
-                    GetPixel(ox, oy, r, g, b, a);
 
-                    TotalR+=r*Weight;
-                    TotalG+=g*Weight;
-                    TotalB+=b*Weight;
-                    TotalA+=a*Weight;
-                 // TotalW+=Weight;
-                }
+void BitmapT::HalveSize()
+{
+    if (SizeX<=1 && SizeY<=1) return;
+
+    const unsigned int NewSizeX=SizeX>1 ? SizeX/2 : 1;
+    const unsigned int NewSizeY=SizeY>1 ? SizeY/2 : 1;
+    ArrayT<uint32_t>   NewData;
+
+    NewData.PushBackEmptyExact(NewSizeX*NewSizeY);
+
+    for (unsigned int ny=0; ny<NewSizeY; ny++)
+    {
+        // If the size in a direction is odd, the last row or column of the old bitmap is dropped.
+        const uint32_t* Row1  =&Data[(2*ny)*SizeX];
+        const uint32_t* Row2  =SizeY>1 ? Row1+SizeX : Row1;
+        uint32_t*       NewRow=&NewData[ny*NewSizeX];
+        unsigned int    nx    =0;
+
+#if CAFU_BITMAP_SSE2
+        // Compute four new pixels at a time from eight old pixels of each row.
+        if (SizeX>1)
+        {
+            const __m128i Zero=_mm_setzero_si128();
+            const __m128i Two =_mm_set1_epi16(2);
+
+            for (; nx+4<=NewSizeX; nx+=4)
+            {
+                const __m128i a=_mm_loadu_si128((const __m128i*)(Row1+2*nx+0));
+                const __m128i b=_mm_loadu_si128((const __m128i*)(Row1+2*nx+4));
+                const __m128i c=_mm_loadu_si128((const __m128i*)(Row2+2*nx+0));
+                const __m128i d=_mm_loadu_si128((const __m128i*)(Row2+2*nx+4));
+
+                // Add the rows, with 16 bits per channel, then add the pairs of adjacent pixels.
+                const __m128i s0=_mm_add_epi16(_mm_unpacklo_epi8(a, Zero), _mm_unpacklo_epi8(c, Zero));
+                const __m128i s1=_mm_add_epi16(_mm_unpackhi_epi8(a, Zero), _mm_unpackhi_epi8(c, Zero));
+                const __m128i s2=_mm_add_epi16(_mm_unpacklo_epi8(b, Zero), _mm_unpacklo_epi8(d, Zero));
+                const __m128i s3=_mm_add_epi16(_mm_unpackhi_epi8(b, Zero), _mm_unpackhi_epi8(d, Zero));
+
+                const __m128i Lo=_mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+                const __m128i Hi=_mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+
+                _mm_storeu_si128((__m128i*)(NewRow+nx), _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(Lo, Two), 2),
+                                                                         _mm_srli_epi16(_mm_add_epi16(Hi, Two), 2)));
+            }
+        }
+#endif
+
+        for (; nx<NewSizeX; nx++)
+        {
+            const unsigned int ox1=2*nx;
+            const unsigned int ox2=SizeX>1 ? ox1+1 : ox1;
+            const uint32_t     p[4]={ Row1[ox1], Row1[ox2], Row2[ox1], Row2[ox2] };
+            uint32_t           RGBA=0;
 
-             // if (fabs(TotalW-1.0)>0.0000001) printf("WARNING: TotalW!=1.0:  %.15f\n", TotalW);
-                NewBitmap.SetPixel(ox, ny, int(TotalR+0.49), int(TotalG+0.49), int(TotalB+0.49), int(TotalA+0.49));
+            // Average each of the four channels separately, rounding to the nearest value.
+            for (unsigned int Shift=0; Shift<32; Shift+=8)
+            {
+                const uint32_t Sum=((p[0] >> Shift) & 0xFF) + ((p[1] >> Shift) & 0xFF) + ((p[2] >> Shift) & 0xFF) + ((p[3] >> Shift) & 0xFF);
+
+                RGBA|=((Sum+2)/4) << Shift;
             }
+
+            NewRow[nx]=RGBA;
         }
+    }
+
+    SizeX=NewSizeX;
+    SizeY=NewSizeY;
+    Data =NewData;
+}
+
+
+namespace
+{
+#if CAFU_BITMAP_SSE2
+    /// Four float values, one for each of four pixels that are processed together.
+    struct Float4T
+    {
+        Float4T(__m128 v_) : v(v_) { }
+        Float4T(float f) : v(_mm_set1_ps(f)) { }
+
+        __m128 v;
+    };
+
+    inline Float4T operator - (const Float4T& a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+    inline Float4T operator + (const Float4T& a, const Float4T& b) { return _mm_add_ps(a.v, b.v); }
+    inline Float4T operator - (const Float4T& a, const Float4T& b) { return _mm_sub_ps(a.v, b.v); }
+    inline Float4T operator * (const Float4T& a, const Float4T& b) { return _mm_mul_ps(a.v, b.v); }
+    inline Float4T operator / (const Float4T& a, const Float4T& b) { return _mm_div_ps(a.v, b.v); }
+    inline Float4T Sqrt(const Float4T& a) { return _mm_sqrt_ps(a.v); }
 
-        // Copy the scaled bitmap into this bitmap.
-        SizeX=NewBitmap.SizeX;
-        SizeY=NewBitmap.SizeY;
-        Data =NewBitmap.Data;
+    // Returns a, but with 1.0 in place of the elements that are 0.0, so that a can be divided by.
+    inline Float4T NonZero(const Float4T& a)
+    {
+        const __m128 IsZero=_mm_cmpeq_ps(a.v, _mm_setzero_ps());
+
+        return _mm_or_ps(_mm_andnot_ps(IsZero, a.v), _mm_and_ps(IsZero, _mm_set1_ps(1.0f)));
+    }
+
+    // Returns the channel at bit position Shift of the four pixels as values between 0.0 and 1.0, as BitmapT::GetPixel() does.
+    inline Float4T GetChannel(const uint32_t* Pixels, unsigned int Shift)
+    {
+        const __m128i c=_mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)Pixels), _mm_cvtsi32_si128(int(Shift))), _mm_set1_epi32(0xFF));
+
+        return _mm_div_ps(_mm_cvtepi32_ps(c), _mm_set1_ps(255.0f));
     }
+
+    // Sets the channel at bit position Shift of the four pixels to the given values, clamping and converting them as BitmapT::SetPixel() does.
+    inline void SetChannel(uint32_t* Pixels, unsigned int Shift, const Float4T& a)
+    {
+        const __m128  Clamped=_mm_min_ps(_mm_max_ps(a.v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        const __m128d Scale  =_mm_set1_pd(255.0);
+        const __m128i Lo     =_mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtps_pd(Clamped), Scale));
+        const __m128i Hi     =_mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(Clamped, Clamped)), Scale));
+        const __m128i c      =_mm_sll_epi32(_mm_unpacklo_epi64(Lo, Hi), _mm_cvtsi32_si128(int(Shift)));
+        const __m128i Mask   =_mm_set1_epi32(int(0xFFu << Shift));
+
+        _mm_storeu_si128((__m128i*)Pixels, _mm_or_si128(_mm_andnot_si128(Mask, _mm_loadu_si128((const __m128i*)Pixels)), c));
+    }
+#else
+    /// Four float values, one for each of four pixels that are processed together.
+    struct Float4T
+    {
+        Float4T() { }
+        Float4T(float f) { v[0]=v[1]=v[2]=v[3]=f; }
+
+        float v[4];
+    };
+
+    inline Float4T operator - (const Float4T& a) { Float4T r; for (unsigned int i=0; i<4; i++) r.v[i]=-a.v[i]; return r; }
+    inline Float4T operator + (const Float4T& a, const Float4T& b) { Float4T r; for (unsigned int i=0; i<4; i++) r.v[i]=a.v[i]+b.v[i]; return r; }
+    inline Float4T operator - (const Float4T& a, const Float4T& b) { Float4T r; for (unsigned int i=0; i<4; i++) r.v[i]=a.v[i]-b.v[i]; return r; }
+    inline Float4T operator * (const Float4T& a, const Float4T& b) { Float4T r; for (unsigned int i=0; i<4; i++) r.v[i]=a.v[i]*b.v[i]; return r; }
+    inline Float4T operator / (const Float4T& a, const Float4T& b) { Float4T r; for (unsigned int i=0; i<4; i++) r.v[i]=a.v[i]/b.v[i]; return r; }
+    inline Float4T Sqrt(const Float4T& a) { Float4T r; for (unsigned int i=0; i<4; i++) r.v[i]=float(sqrt(a.v[i])); return r; }
+
+    // Returns a, but with 1.0 in place of the elements that are 0.0, so that a can be divided by.
+    inline Float4T NonZero(const Float4T& a) { Float4T r; for (unsigned int i=0; i<4; i++) r.v[i]=a.v[i]!=0.0f ? a.v[i] : 1.0f; return r; }
+
+    // Returns the channel at bit position Shift of the four pixels as values between 0.0 and 1.0, as BitmapT::GetPixel() does.
+    inline Float4T GetChannel(const uint32_t* Pixels, unsigned int Shift)
+    {
+        Float4T r;
+
+        for (unsigned int i=0; i<4; i++)
+            r.v[i]=((Pixels[i] >> Shift) & 0xFF)/255.0f;
+
+        return r;
+    }
+
+    // Sets the channel at bit position Shift of the four pixels to the given values, clamping and converting them as BitmapT::SetPixel() does.
+    inline void SetChannel(uint32_t* Pixels, unsigned int Shift, const Float4T& a)
+    {
+        for (unsigned int i=0; i<4; i++)
+        {
+            float c=a.v[i];
+
+            if (c<0.0) c=0.0;
+            if (c>1.0) c=1.0;
+
+            Pixels[i]=(Pixels[i] & ~(0xFFu << Shift)) | ((uint32_t)(c*255.0) << Shift);
+        }
+    }
+#endif
+
+
+    // Copies Num (at most four) pixels into Block, padding the rest of Block with zeros.
+    inline void LoadBlock(uint32_t Block[4], const uint32_t* Pixels, unsigned long Num)
+    {
+        for (unsigned long i=0; i<4; i++)
+            Block[i]=i<Num ? Pixels[i] : 0;
+    }
+
+    // Copies the first Num (at most four) pixels of Block back.
+    inline void StoreBlock(const uint32_t Block[4], uint32_t* Pixels, unsigned long Num)
+    {
+        for (unsigned long i=0; i<Num; i++)
+            Pixels[i]=Block[i];
+    }
+
+    // Normalizes the vector (x, y, z) unless it is zero, and stores it as a normal in the red, green and blue channels of Block.
+    inline void StoreNormals(uint32_t Block[4], Float4T x, Float4T y, Float4T z)
+    {
+        const Float4T Length=NonZero(Sqrt(x*x + y*y + z*z));
+
+        SetChannel(Block,  0, (x/Length+1.0f)/2.0f);
+        SetChannel(Block,  8, (y/Length+1.0f)/2.0f);
+        SetChannel(Block, 16, (z/Length+1.0f)/2.0f);
+    }
+}
+
+
+void BitmapT::Add(const BitmapT& Other)
+{
+    const unsigned long Num=Data.Size();
+    unsigned long       i  =0;
+
+#if CAFU_BITMAP_SSE2
+    for (; i+4<=Num; i+=4)
+    {
+        const __m128i a=_mm_loadu_si128((const __m128i*)&Data[i]);
+        const __m128i b=_mm_loadu_si128((const __m128i*)&Other.Data[i]);
+
+        _mm_storeu_si128((__m128i*)&Data[i], _mm_adds_epu8(a, b));
+    }
+#endif
+
+    for (; i<Num; i++)
+    {
+        uint32_t RGBA=0;
+
+        for (unsigned int Shift=0; Shift<32; Shift+=8)
+        {
+            const uint32_t Sum=((Data[i] >> Shift) & 0xFF) + ((Other.Data[i] >> Shift) & 0xFF);
+
+            RGBA|=(Sum<255 ? Sum : 255) << Shift;
+        }
+
+        Data[i]=RGBA;
+    }
+}
+
+
+// Each channel is computed as a*b/255, rounded down, which yields exactly the same results
+// as computing (a/255.0f)*(b/255.0f) in floating point and converting back as SetPixel() does.
+void BitmapT::Mul(const BitmapT& Other)
+{
+    const unsigned long Num=Data.Size();
+    unsigned long       i  =0;
+
+#if CAFU_BITMAP_SSE2
+    const __m128i Zero=_mm_setzero_si128();
+    const __m128i One =_mm_set1_epi16(1);
+
+    for (; i+4<=Num; i+=4)
+    {
+        const __m128i a=_mm_loadu_si128((const __m128i*)&Data[i]);
+        const __m128i b=_mm_loadu_si128((const __m128i*)&Other.Data[i]);
+
+        // t=a*b fits into 16 bits, and (t+1+(t>>8))>>8 == t/255 for all such products.
+        const __m128i tLo=_mm_mullo_epi16(_mm_unpacklo_epi8(a, Zero), _mm_unpacklo_epi8(b, Zero));
+        const __m128i tHi=_mm_mullo_epi16(_mm_unpackhi_epi8(a, Zero), _mm_unpackhi_epi8(b, Zero));
+        const __m128i rLo=_mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(tLo, One), _mm_srli_epi16(tLo, 8)), 8);
+        const __m128i rHi=_mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(tHi, One), _mm_srli_epi16(tHi, 8)), 8);
+
+        _mm_storeu_si128((__m128i*)&Data[i], _mm_packus_epi16(rLo, rHi));
+    }
+#endif
+
+    for (; i<Num; i++)
+    {
+        uint32_t RGBA=0;
+
+        for (unsigned int Shift=0; Shift<32; Shift+=8)
+            RGBA|=(((Data[i] >> Shift) & 0xFF) * ((Other.Data[i] >> Shift) & 0xFF) / 255) << Shift;
+
+        Data[i]=RGBA;
+    }
+}
+
+
+// See the Cafu Tech Archive ("Adding two normal-maps properly", 2004-06-19) for a detailed explanation!
+void BitmapT::CombineNormals(const BitmapT& Other)
+{
+    for (unsigned long i=0; i<Data.Size(); i+=4)
+    {
+        const unsigned long Num=Data.Size()-i<4 ? Data.Size()-i : 4;
+        uint32_t            Block1[4];
+        uint32_t            Block2[4];
+
+        LoadBlock(Block1, &Data[i], Num);
+        LoadBlock(Block2, &Other.Data[i], Num);
+
+        const Float4T x1=GetChannel(Block1,  0)*2.0f-1.0f;
+        const Float4T y1=GetChannel(Block1,  8)*2.0f-1.0f;
+        const Float4T z1=GetChannel(Block1, 16)*2.0f-1.0f;
+
+        const Float4T x2=GetChannel(Block2,  0)*2.0f-1.0f;
+        const Float4T y2=GetChannel(Block2,  8)*2.0f-1.0f;
+        const Float4T z2=GetChannel(Block2, 16)*2.0f-1.0f;
+
+        StoreNormals(Block1, x1*z2+x2*z1, y1*z2+y2*z1, z1*z2);
+        StoreBlock(Block1, &Data[i], Num);
+    }
+}
+
+
+void BitmapT::ReNormalize()
+{
+    for (unsigned long i=0; i<Data.Size(); i+=4)
+    {
+        const unsigned long Num=Data.Size()-i<4 ? Data.Size()-i : 4;
+        uint32_t            Block[4];
+
+        LoadBlock(Block, &Data[i], Num);
+
+        const Float4T nx=GetChannel(Block,  0)*2.0f-1.0f;
+        const Float4T ny=GetChannel(Block,  8)*2.0f-1.0f;
+        const Float4T nz=GetChannel(Block, 16)*2.0f-1.0f;
+
+        StoreNormals(Block, nx, ny, nz);
+        StoreBlock(Block, &Data[i], Num);
+    }
+}
+
+
+void BitmapT::HeightMapToNormalMap(float HeightScale)
+{
+    const ArrayT<uint32_t> HeightMap(Data);
+
+    for (unsigned int y=0; y<SizeY; y++)
+        for (unsigned int x=0; x<SizeX; x+=4)
+        {
+            const unsigned long Num=SizeX-x<4 ? SizeX-x : 4;
+            uint32_t            Block[4];
+            uint32_t            Block01[4];
+            uint32_t            Block10[4];
+
+            LoadBlock(Block, &Data[x+y*SizeX], Num);
+
+            // The heights at (x, y) are taken from Block, their neighbours at (x, y+1) and (x+1, y) from the other blocks.
+            for (unsigned long i=0; i<4; i++)
+            {
+                Block01[i]=i<Num ? HeightMap[ (x+i)           +((y+1) % SizeY)*SizeX] : 0;
+                Block10[i]=i<Num ? HeightMap[((x+i+1) % SizeX)+  y            *SizeX] : 0;
+            }
+
+            const Float4T h00=GetChannel(Block,   0);
+            const Float4T h01=GetChannel(Block01, 0);
+            const Float4T h10=GetChannel(Block10, 0);
+
+            // The normal is the cross product of the tangent vectors (1, 0, dx) and (0, 1, dy).
+            const Float4T dx=(h10-h00)*HeightScale;
+            const Float4T dy=(h01-h00)*HeightScale;
+
+            StoreNormals(Block, -dx, -dy, 1.0f);
+            StoreBlock(Block, &Data[x+y*SizeX], Num);
+        }
+}
+
+
+void BitmapT::FlipNormalMapYAxis()
+{
+    for (unsigned long i=0; i<Data.Size(); i++)
+        Data[i]^=0x0000FF00;
 }
 
 
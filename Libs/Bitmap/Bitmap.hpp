@@ -15,6 +15,8 @@ This project is licensed under the terms of the MIT license.
 #include <stdint.h>
 #endif
 
+#include <string>
+
 
 /// This class represents a RGBA bitmap.
 struct BitmapT
@@ -37,7 +39,9 @@ struct BitmapT
     ///
     /// Note that the Cafu file system (cf::FileSys) is used to load the image!
     /// That means that an appropriate file system must be mounted in order to be able to create/load an image.
-    BitmapT(const char* FileName) /*throw (LoadErrorT)*/;
+    /// If \c Warnings is non-NULL, the warnings of the file system are appended to it rather than printed to the console,
+    /// which is required when the bitmap is loaded in another thread than the main thread.
+    BitmapT(const char* FileName, std::string* Warnings=NULL) /*throw (LoadErrorT)*/;
 
     /// Constructor that creates a bitmap from the memory pointed to by 'Buffer'.
     BitmapT(unsigned int Width, unsigned int Height, const uint32_t* Buffer=NULL);
@@ -68,6 +72,32 @@ struct BitmapT
     /// You may specify 0 for NewSizeX or NewSizeY in order to keep that direction unchanged.
     void Scale(unsigned int NewSizeX, unsigned int NewSizeY);
 
+    /// Scales the bitmap down to half its size in each direction (but not below 1), averaging each block of 2x2 pixels.
+    /// This is the box filter that is used for computing the next smaller level of a mipmap chain.
+    void HalveSize();
+
+    /// Adds the given bitmap to this bitmap, clamping each channel at 255.
+    /// The given bitmap must have the same size as this bitmap.
+    void Add(const BitmapT& Other);
+
+    /// Multiplies this bitmap with the given bitmap, each channel interpreted as a value between 0.0 and 1.0.
+    /// The given bitmap must have the same size as this bitmap.
+    void Mul(const BitmapT& Other);
+
+    /// Interprets this bitmap and the given bitmap as normal maps and replaces the normals of this bitmap with their combination.
+    /// The given bitmap must have the same size as this bitmap. The alpha channel of this bitmap is kept.
+    void CombineNormals(const BitmapT& Other);
+
+    /// Interprets this bitmap as a normal map and normalizes its normals. The alpha channel is kept.
+    void ReNormalize();
+
+    /// Interprets the red channel of this bitmap as a height map and replaces it with the normal map that is derived from it.
+    /// The heights are scaled by HeightScale, and the alpha channel is kept.
+    void HeightMapToNormalMap(float HeightScale);
+
+    /// Interprets this bitmap as a normal map and negates the y-components of its normals.
+    void FlipNormalMapYAxis();
+
     /// This functions computes a paletted (8 BPP) image from this bitmap,
     /// using the NeuQuant Neural-Net quantization algorithm (c) by Anthony Dekker, 1994.
     /// See "Kohonen neural networks for optimal colour quantization"
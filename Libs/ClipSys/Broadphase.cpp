@@ -0,0 +1,585 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+#include "Broadphase.hpp"
+#include "ConsoleCommands/Console.hpp"
+#include "Templates/Pool.hpp"
+
+#include <algorithm>
+
+
+using namespace cf::ClipSys;
+
+
+namespace cf
+{
+    namespace ClipSys
+    {
+        class ClipLinkT
+        {
+            public:
+
+            unsigned long Proxy;                ///< The clip model of this proxy is...
+            ClipSectorT*  ClipSector;           ///<    ...in this clip sector (the model can be in more sectors and the sector can have more models).
+            ClipLinkT*    PrevModelInSector;    ///< The previous model that is in the same sector.
+            ClipLinkT*    NextModelInSector;    ///< The next     model that is in the same sector.
+            ClipLinkT*    NextSectorOfModel;    ///< The next sector of the same model.
+        };
+
+
+        class ClipSectorT
+        {
+            public:
+
+            /// The constructor.
+            ClipSectorT() : ModelContents(0), ListOfModels(NULL) { }
+
+            unsigned long ModelContents;    ///< The combined (or'ed) contents of the models in ListOfModels.
+            ClipLinkT*    ListOfModels;     ///< The list of all clip models that are in this sector.
+        };
+    }
+}
+
+
+static cf::PoolSingleT<ClipLinkT> ClipLinkPool(512);
+
+
+/********************************/
+/*** SectorGridBroadphaseT ***/
+/********************************/
+
+SectorGridBroadphaseT::SectorGridBroadphaseT(const BoundingBox3dT& WorldBB, unsigned long SectorSubdivs)
+    : m_WorldBB(WorldBB),
+      m_SectorSubdivs(SectorSubdivs),
+      m_SectorSideLen((WorldBB.Max - WorldBB.Min) / double(SectorSubdivs)),
+      m_Sectors(new ClipSectorT[SectorSubdivs * SectorSubdivs]),
+      m_Proxies(),
+      m_FreeProxies()
+{
+}
+
+
+SectorGridBroadphaseT::~SectorGridBroadphaseT()
+{
+#ifdef DEBUG
+    // Make sure that all sectors are empty (that is, all clip models have been removed already).
+    for (unsigned long SectorNr = 0; SectorNr < m_SectorSubdivs * m_SectorSubdivs; SectorNr++)
+    {
+        // Don't inline this into the assert() statement. If the assertion triggers,
+        // it is convenient to have CS readily available in the debugger.
+        const ClipSectorT& CS = m_Sectors[SectorNr];
+
+        assert(CS.ListOfModels == NULL);
+    }
+#endif
+
+    delete[] m_Sectors;
+}
+
+
+unsigned long SectorGridBroadphaseT::Insert(ClipModelT* ClipModel, const BoundingBox3dT& BB, unsigned long Contents)
+{
+    unsigned long Proxy;
+
+    if (m_FreeProxies.Size() > 0)
+    {
+        Proxy = m_FreeProxies[m_FreeProxies.Size() - 1];
+        m_FreeProxies.DeleteBack();
+    }
+    else
+    {
+        Proxy = m_Proxies.Size();
+        m_Proxies.PushBackEmpty();
+    }
+
+    m_Proxies[Proxy].ClipModel     = ClipModel;
+    m_Proxies[Proxy].ListOfSectors = NULL;
+
+    Link(Proxy, BB, Contents);
+    return Proxy;
+}
+
+
+unsigned long SectorGridBroadphaseT::Update(unsigned long Proxy, const BoundingBox3dT& BB, unsigned long Contents)
+{
+    Unlink(Proxy);
+    Link(Proxy, BB, Contents);
+    return Proxy;
+}
+
+
+void SectorGridBroadphaseT::Remove(unsigned long Proxy)
+{
+    Unlink(Proxy);
+
+    m_Proxies[Proxy].ClipModel = NULL;
+    m_FreeProxies.PushBack(Proxy);
+}
+
+
+void SectorGridBroadphaseT::Query(const BoundingBox3dT& BB, unsigned long ContentMask, ArrayT<ClipModelT*>& ClipModels) const
+{
+    // A clip model is usually in several sectors, but must be reported only once. The check counts that keep track of
+    // the clip models that have already been reported are kept per thread, so that several threads can query concurrently.
+    // They are shared by all broadphases of the thread, which works because each query begins with a new check count.
+    static thread_local ArrayT<unsigned long> CheckCounts;
+    static thread_local unsigned long         CheckCount = 0;
+
+    while (CheckCounts.Size() < m_Proxies.Size()) CheckCounts.PushBack(0);
+
+    CheckCount++;
+
+    if (CheckCount == 0)
+    {
+        // Only when the check count wraps around, the check counts of the proxies must explicitly be reset.
+        for (unsigned long ProxyNr = 0; ProxyNr < CheckCounts.Size(); ProxyNr++)
+            CheckCounts[ProxyNr] = 0;
+
+        CheckCount = 1;
+    }
+
+    unsigned long GridRect[4];
+
+    GetGridRectFromBB(GridRect, BB);
+
+    for (unsigned long x = GridRect[0]; x < GridRect[2]; x++)
+        for (unsigned long y = GridRect[1]; y < GridRect[3]; y++)
+        {
+            const ClipSectorT& Sector = m_Sectors[y*m_SectorSubdivs + x];  // The sector at (x, y).
+
+            if ((Sector.ModelContents & ContentMask) == 0) continue;
+
+            for (ClipLinkT* Link = Sector.ListOfModels; Link != NULL; Link = Link->NextModelInSector)
+            {
+                if (CheckCounts[Link->Proxy] == CheckCount) continue;
+                CheckCounts[Link->Proxy] = CheckCount;
+
+                ClipModels.PushBack(m_Proxies[Link->Proxy].ClipModel);
+            }
+        }
+}
+
+
+void SectorGridBroadphaseT::GetGridRectFromBB(unsigned long GridRect[], const BoundingBox3dT& BB) const
+{
+    assert(((unsigned long)(3.9)) == 3);    // Assert that doubles are cast to unsigned longs as expected.
+
+    GridRect[0] = (unsigned long)((BB.Min.x - m_WorldBB.Min.x) / m_SectorSideLen.x);
+    GridRect[1] = (unsigned long)((BB.Min.y - m_WorldBB.Min.y) / m_SectorSideLen.y);
+    GridRect[2] = (unsigned long)((BB.Max.x - m_WorldBB.Min.x) / m_SectorSideLen.x);
+    GridRect[3] = (unsigned long)((BB.Max.y - m_WorldBB.Min.y) / m_SectorSideLen.y);
+
+    for (unsigned long CheckNr = 0; CheckNr < 4; CheckNr++)
+    {
+        // Hmmm. I think it *is* possible to have situations where this assertion is violated...
+        // so I rather reduce it to a developer warning instead of having assert abort the program.
+        // assert(GridRect[i]<m_SectorSubdivs);
+        if (GridRect[CheckNr] >= m_SectorSubdivs) Console->DevWarning(cf::va("%s(%lu): CheckNr==%lu, %lu>=%lu\n", __FILE__, __LINE__, CheckNr, GridRect[CheckNr], m_SectorSubdivs));
+
+        if (int(GridRect[CheckNr]) < 0          ) GridRect[CheckNr] = 0;
+        if (GridRect[CheckNr] >= m_SectorSubdivs) GridRect[CheckNr] = m_SectorSubdivs - 1;
+    }
+
+    GridRect[2]++;
+    GridRect[3]++;
+}
+
+
+void SectorGridBroadphaseT::Link(unsigned long Proxy, const BoundingBox3dT& BB, unsigned long Contents)
+{
+    ProxyT& P = m_Proxies[Proxy];
+
+    assert(P.ListOfSectors == NULL);
+
+    // Determine which sectors this model covers.
+    unsigned long GridRect[4];
+    GetGridRectFromBB(GridRect, BB);
+
+    // Create a link for each sector covered by this model.
+    for (unsigned long x = GridRect[0]; x < GridRect[2]; x++)
+        for (unsigned long y = GridRect[1]; y < GridRect[3]; y++)
+        {
+            ClipSectorT& Sector = m_Sectors[y * m_SectorSubdivs + x];   // The sector at (x, y).
+            ClipLinkT*   Link   = ClipLinkPool.Alloc();                 // Note: Link is *not* initialized (zeroed)!
+
+            Sector.ModelContents |= Contents;
+
+            Link->Proxy      = Proxy;
+            Link->ClipSector = &Sector;
+
+            Link->NextModelInSector = Sector.ListOfModels;
+            Link->PrevModelInSector = NULL;
+            if (Sector.ListOfModels != NULL)
+            {
+                assert(Sector.ListOfModels->PrevModelInSector == NULL);
+                Sector.ListOfModels->PrevModelInSector = Link;
+            }
+            Sector.ListOfModels = Link;
+
+            Link->NextSectorOfModel = P.ListOfSectors;
+            P.ListOfSectors         = Link;
+        }
+}
+
+
+void SectorGridBroadphaseT::Unlink(unsigned long Proxy)
+{
+    ProxyT& P = m_Proxies[Proxy];
+
+    // Iterate over all sectors of this model.
+    // In each sector, remove us from the list of models in that sector.
+    for (ClipLinkT* Link = P.ListOfSectors; Link != NULL; Link = P.ListOfSectors)
+    {
+        P.ListOfSectors = Link->NextSectorOfModel;
+
+        assert(Link->Proxy == Proxy);
+
+        if (Link->PrevModelInSector != NULL)
+        {
+            assert(Link->PrevModelInSector->NextModelInSector == Link);
+
+            Link->PrevModelInSector->NextModelInSector = Link->NextModelInSector;
+        }
+        else
+        {
+            assert(Link->ClipSector != NULL);
+            assert(Link->ClipSector->ListOfModels == Link);
+
+            Link->ClipSector->ListOfModels = Link->NextModelInSector;
+        }
+
+        if (Link->NextModelInSector != NULL)
+        {
+            assert(Link->NextModelInSector->PrevModelInSector == Link);
+
+            Link->NextModelInSector->PrevModelInSector = Link->PrevModelInSector;
+        }
+
+        ClipLinkPool.Free(Link);
+    }
+}
+
+
+/******************************/
+/*** AabbTreeBroadphaseT ***/
+/******************************/
+
+namespace
+{
+    // Returns half the surface area of the given box, which is the cost metric for building the tree.
+    double GetCost(const BoundingBox3dT& BB)
+    {
+        const Vector3dT d = BB.Max - BB.Min;
+
+        return d.x*d.y + d.y*d.z + d.z*d.x;
+    }
+
+    // Returns whether Outer completely encloses Inner.
+    bool Encloses(const BoundingBox3dT& Outer, const BoundingBox3dT& Inner)
+    {
+        return Outer.Min.x <= Inner.Min.x && Outer.Min.y <= Inner.Min.y && Outer.Min.z <= Inner.Min.z &&
+               Outer.Max.x >= Inner.Max.x && Outer.Max.y >= Inner.Max.y && Outer.Max.z >= Inner.Max.z;
+    }
+}
+
+
+AabbTreeBroadphaseT::AabbTreeBroadphaseT(double Margin)
+    : m_Margin(Margin),
+      m_Nodes(),
+      m_Root(NO_PROXY),
+      m_FreeList(NO_PROXY)
+{
+}
+
+
+unsigned long AabbTreeBroadphaseT::Insert(ClipModelT* ClipModel, const BoundingBox3dT& BB, unsigned long Contents)
+{
+    const unsigned long LeafNr = AllocNode();
+    NodeT&              Leaf   = m_Nodes[LeafNr];
+
+    Leaf.BB        = BB.GetEpsilonBox(m_Margin);
+    Leaf.Contents  = Contents;
+    Leaf.ClipModel = ClipModel;
+
+    InsertLeaf(LeafNr);
+    return LeafNr;
+}
+
+
+unsigned long AabbTreeBroadphaseT::Update(unsigned long Proxy, const BoundingBox3dT& BB, unsigned long Contents)
+{
+    NodeT& Leaf = m_Nodes[Proxy];
+
+    assert(Leaf.IsLeaf() && Leaf.ClipModel != NULL);
+
+    // As long as the clip model stays within its enlarged box, the tree doesn't change.
+    if (Leaf.Contents == Contents && Encloses(Leaf.BB, BB)) return Proxy;
+
+    RemoveLeaf(Proxy);
+
+    Leaf.BB       = BB.GetEpsilonBox(m_Margin);
+    Leaf.Contents = Contents;
+
+    InsertLeaf(Proxy);
+    return Proxy;
+}
+
+
+void AabbTreeBroadphaseT::Remove(unsigned long Proxy)
+{
+    assert(m_Nodes[Proxy].IsLeaf() && m_Nodes[Proxy].ClipModel != NULL);
+
+    RemoveLeaf(Proxy);
+    FreeNode(Proxy);
+}
+
+
+void AabbTreeBroadphaseT::Query(const BoundingBox3dT& BB, unsigned long ContentMask, ArrayT<ClipModelT*>& ClipModels) const
+{
+    if (m_Root == NO_PROXY) return;
+
+    // The stack never holds more than one node per level of the tree, plus one.
+    // As the tree is balanced, its height is logarithmic in the number of clip models, so a fixed-size stack is enough.
+    unsigned long NodeStack[128];
+    unsigned int  StackSize = 0;
+
+    assert(m_Nodes[m_Root].Height < 128);
+    NodeStack[StackSize++] = m_Root;
+
+    while (StackSize > 0)
+    {
+        const NodeT& Node = m_Nodes[NodeStack[--StackSize]];
+
+        if ((Node.Contents & ContentMask) == 0) continue;
+        if (!Node.BB.IntersectsOrTouches(BB)) continue;
+
+        if (Node.IsLeaf())
+        {
+            ClipModels.PushBack(Node.ClipModel);
+        }
+        else
+        {
+            NodeStack[StackSize++] = Node.Children[0];
+            NodeStack[StackSize++] = Node.Children[1];
+        }
+    }
+}
+
+
+unsigned long AabbTreeBroadphaseT::AllocNode()
+{
+    unsigned long NodeNr;
+
+    if (m_FreeList != NO_PROXY)
+    {
+        NodeNr     = m_FreeList;
+        m_FreeList = m_Nodes[NodeNr].Parent;
+    }
+    else
+    {
+        NodeNr = m_Nodes.Size();
+        m_Nodes.PushBackEmpty();
+    }
+
+    NodeT& Node = m_Nodes[NodeNr];
+
+    Node.Contents    = 0;
+    Node.ClipModel   = NULL;
+    Node.Parent      = NO_PROXY;
+    Node.Children[0] = NO_PROXY;
+    Node.Children[1] = NO_PROXY;
+    Node.Height      = 0;
+
+    return NodeNr;
+}
+
+
+void AabbTreeBroadphaseT::FreeNode(unsigned long NodeNr)
+{
+    NodeT& Node = m_Nodes[NodeNr];
+
+    Node.ClipModel = NULL;
+    Node.Parent    = m_FreeList;
+    Node.Height    = -1;
+
+    m_FreeList = NodeNr;
+}
+
+
+void AabbTreeBroadphaseT::InsertLeaf(unsigned long LeafNr)
+{
+    if (m_Root == NO_PROXY)
+    {
+        m_Root = LeafNr;
+        m_Nodes[LeafNr].Parent = NO_PROXY;
+        return;
+    }
+
+    // Find the best sibling for the new leaf, descending into the child that is cheapest to enlarge.
+    const BoundingBox3dT LeafBB = m_Nodes[LeafNr].BB;
+    unsigned long        NodeNr = m_Root;
+
+    while (!m_Nodes[NodeNr].IsLeaf())
+    {
+        const NodeT&   Node     = m_Nodes[NodeNr];
+        BoundingBox3dT Combined = Node.BB;
+
+        Combined.Insert(LeafBB);
+
+        // The cost of creating a new parent for this node and the new leaf,
+        // and the minimum cost of pushing the leaf further down the tree.
+        const double Cost            = 2.0 * GetCost(Combined);
+        const double InheritanceCost = 2.0 * (GetCost(Combined) - GetCost(Node.BB));
+
+        // The costs of descending into each child.
+        double ChildCost[2];
+
+        for (unsigned int ChildNr = 0; ChildNr < 2; ChildNr++)
+        {
+            const NodeT&   Child = m_Nodes[Node.Children[ChildNr]];
+            BoundingBox3dT U     = Child.BB;
+
+            U.Insert(LeafBB);
+
+            ChildCost[ChildNr] = Child.IsLeaf() ? GetCost(U) + InheritanceCost
+                                                : GetCost(U) - GetCost(Child.BB) + InheritanceCost;
+        }
+
+        if (Cost < ChildCost[0] && Cost < ChildCost[1]) break;
+
+        NodeNr = ChildCost[0] < ChildCost[1] ? Node.Children[0] : Node.Children[1];
+    }
+
+    // Create a new parent for the sibling and the new leaf.
+    const unsigned long SiblingNr   = NodeNr;
+    const unsigned long NewParentNr = AllocNode();      // Note that this can reallocate m_Nodes.
+    const unsigned long OldParentNr = m_Nodes[SiblingNr].Parent;
+
+    m_Nodes[NewParentNr].Parent      = OldParentNr;
+    m_Nodes[NewParentNr].Children[0] = SiblingNr;
+    m_Nodes[NewParentNr].Children[1] = LeafNr;
+
+    if (OldParentNr != NO_PROXY)
+    {
+        NodeT& OldParent = m_Nodes[OldParentNr];
+
+        OldParent.Children[OldParent.Children[0] == SiblingNr ? 0 : 1] = NewParentNr;
+    }
+    else
+    {
+        m_Root = NewParentNr;
+    }
+
+    m_Nodes[SiblingNr].Parent = NewParentNr;
+    m_Nodes[LeafNr   ].Parent = NewParentNr;
+
+    Refit(NewParentNr);
+}
+
+
+void AabbTreeBroadphaseT::RemoveLeaf(unsigned long LeafNr)
+{
+    if (LeafNr == m_Root)
+    {
+        m_Root = NO_PROXY;
+        return;
+    }
+
+    const unsigned long ParentNr      = m_Nodes[LeafNr].Parent;
+    const unsigned long GrandParentNr = m_Nodes[ParentNr].Parent;
+    const unsigned long SiblingNr     = m_Nodes[ParentNr].Children[m_Nodes[ParentNr].Children[0] == LeafNr ? 1 : 0];
+
+    // Replace the parent by the sibling.
+    m_Nodes[SiblingNr].Parent = GrandParentNr;
+
+    if (GrandParentNr != NO_PROXY)
+    {
+        NodeT& GrandParent = m_Nodes[GrandParentNr];
+
+        GrandParent.Children[GrandParent.Children[0] == ParentNr ? 0 : 1] = SiblingNr;
+    }
+    else
+    {
+        m_Root = SiblingNr;
+    }
+
+    FreeNode(ParentNr);
+    m_Nodes[LeafNr].Parent = NO_PROXY;
+
+    Refit(GrandParentNr);
+}
+
+
+unsigned long AabbTreeBroadphaseT::Balance(unsigned long ANr)
+{
+    // If the sub-tree at A is unbalanced, rotate its higher child up, so that it becomes the new root of the sub-tree.
+    NodeT& A = m_Nodes[ANr];
+
+    if (A.IsLeaf()) return ANr;
+
+    const int Skew = m_Nodes[A.Children[1]].Height - m_Nodes[A.Children[0]].Height;
+
+    if (Skew >= -1 && Skew <= 1) return ANr;
+
+    // Rotate the higher child U up. Its higher child stays with U, its lower child is moved to A.
+    const unsigned int  UPos = Skew > 1 ? 1 : 0;
+    const unsigned long UNr  = A.Children[UPos];
+    NodeT&              U    = m_Nodes[UNr];
+    const unsigned long FNr  = U.Children[0];
+    const unsigned long GNr  = U.Children[1];
+    const bool          FHigher = m_Nodes[FNr].Height > m_Nodes[GNr].Height;
+
+    U.Children[0] = ANr;
+    U.Parent      = A.Parent;
+    A.Parent      = UNr;
+
+    if (U.Parent != NO_PROXY)
+    {
+        NodeT& Parent = m_Nodes[U.Parent];
+
+        Parent.Children[Parent.Children[0] == ANr ? 0 : 1] = UNr;
+    }
+    else
+    {
+        m_Root = UNr;
+    }
+
+    U.Children[1]    = FHigher ? FNr : GNr;
+    A.Children[UPos] = FHigher ? GNr : FNr;
+    m_Nodes[A.Children[UPos]].Parent = ANr;
+
+    UpdateFromChildren(ANr);
+    UpdateFromChildren(UNr);
+
+    return UNr;
+}
+
+
+void AabbTreeBroadphaseT::UpdateFromChildren(unsigned long NodeNr)
+{
+    NodeT&       Node   = m_Nodes[NodeNr];
+    const NodeT& Child0 = m_Nodes[Node.Children[0]];
+    const NodeT& Child1 = m_Nodes[Node.Children[1]];
+
+    Node.BB = Child0.BB;
+    Node.BB.Insert(Child1.BB);
+
+    Node.Contents = Child0.Contents | Child1.Contents;
+    Node.Height   = 1 + std::max(Child0.Height, Child1.Height);
+}
+
+
+void AabbTreeBroadphaseT::Refit(unsigned long NodeNr)
+{
+    // Walk up the tree, re-balancing it and fixing the bounding boxes, contents and heights of the nodes on the way.
+    while (NodeNr != NO_PROXY)
+    {
+        NodeNr = Balance(NodeNr);
+
+        UpdateFromChildren(NodeNr);
+        NodeNr = m_Nodes[NodeNr].Parent;
+    }
+}
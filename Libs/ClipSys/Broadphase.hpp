@@ -0,0 +1,168 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+#ifndef CAFU_CLIPSYS_BROADPHASE_HPP_INCLUDED
+#define CAFU_CLIPSYS_BROADPHASE_HPP_INCLUDED
+
+#include "Math3D/BoundingBox.hpp"
+#include "Templates/Array.hpp"
+
+
+namespace cf
+{
+    namespace ClipSys
+    {
+        class ClipModelT;
+        class ClipLinkT;
+        class ClipSectorT;
+
+
+        /// The broadphase of a ClipWorldT keeps track of the world-space bounding boxes of all clip models
+        /// that are registered with the clip world, and quickly determines those that are near a given box.
+        ///
+        /// A clip model that is inserted into the broadphase is represented by a "proxy", an opaque handle
+        /// that the clip model keeps and hands back into the broadphase for updating or removing it.
+        ///
+        /// There are several implementations with different performance characteristics, and the clip world
+        /// can use any of them (see the `clip_broadphase` console variable).
+        class BroadphaseT
+        {
+            public:
+
+            /// The proxy value that stands for "no proxy".
+            static const unsigned long NO_PROXY = 0xFFFFFFFF;
+
+            /// The (virtual) destructor.
+            virtual ~BroadphaseT() { }
+
+            /// Returns the name of this broadphase, for diagnostic purposes.
+            virtual const char* GetName() const = 0;
+
+            /// Inserts the given clip model into the broadphase.
+            /// @param ClipModel   The clip model to insert.
+            /// @param BB          The world-space bounding box of the clip model.
+            /// @param Contents    The contents of the clip model.
+            /// @returns the proxy that represents the clip model in the broadphase.
+            virtual unsigned long Insert(ClipModelT* ClipModel, const BoundingBox3dT& BB, unsigned long Contents) = 0;
+
+            /// Updates the bounding box and the contents of the clip model that is represented by the given proxy.
+            /// This is normally much cheaper than removing and re-inserting the clip model, especially when the
+            /// clip model has moved only a little.
+            /// @returns the (possibly new) proxy that represents the clip model in the broadphase.
+            virtual unsigned long Update(unsigned long Proxy, const BoundingBox3dT& BB, unsigned long Contents) = 0;
+
+            /// Removes the clip model that is represented by the given proxy from the broadphase.
+            virtual void Remove(unsigned long Proxy) = 0;
+
+            /// Appends all clip models whose bounding box intersects the given bounding box and whose contents
+            /// match the given mask to ClipModels. Each clip model is appended at most once.
+            /// The result can contain a few extra candidates that don't actually meet these criteria,
+            /// so the caller must check them with the clip models' exact bounding boxes and contents.
+            virtual void Query(const BoundingBox3dT& BB, unsigned long ContentMask, ArrayT<ClipModelT*>& ClipModels) const = 0;
+        };
+
+
+        /// This broadphase covers the world with a uniform 2D grid of sectors in the xy-plane, and keeps a list
+        /// of the clip models in each sector. Clip models outside of the grid are kept in the border sectors.
+        ///
+        /// It is simple and fast for maps that are mostly flat, but on maps with many storeys or with large
+        /// terrains, the sectors become very unevenly filled.
+        class SectorGridBroadphaseT : public BroadphaseT
+        {
+            public:
+
+            /// The constructor.
+            /// @param WorldBB         The bounding box of the world.
+            /// @param SectorSubdivs   The number of sectors along each side of the grid.
+            SectorGridBroadphaseT(const BoundingBox3dT& WorldBB, unsigned long SectorSubdivs);
+
+            /// The destructor.
+            ~SectorGridBroadphaseT();
+
+            // The BroadphaseT interface.
+            const char* GetName() const override { return "grid"; }
+            unsigned long Insert(ClipModelT* ClipModel, const BoundingBox3dT& BB, unsigned long Contents) override;
+            unsigned long Update(unsigned long Proxy, const BoundingBox3dT& BB, unsigned long Contents) override;
+            void Remove(unsigned long Proxy) override;
+            void Query(const BoundingBox3dT& BB, unsigned long ContentMask, ArrayT<ClipModelT*>& ClipModels) const override;
+
+
+            private:
+
+            struct ProxyT
+            {
+                ClipModelT*           ClipModel;        ///< The clip model of this proxy, or NULL if this proxy is unused.
+                ClipLinkT*            ListOfSectors;    ///< The list of sectors that the clip model is in.
+            };
+
+            SectorGridBroadphaseT(const SectorGridBroadphaseT&);    ///< Use of the Copy Constructor    is not allowed.
+            void operator = (const SectorGridBroadphaseT&);         ///< Use of the Assignment Operator is not allowed.
+
+            void GetGridRectFromBB(unsigned long GridRect[], const BoundingBox3dT& BB) const;
+            void Link(unsigned long Proxy, const BoundingBox3dT& BB, unsigned long Contents);
+            void Unlink(unsigned long Proxy);
+
+            const BoundingBox3dT  m_WorldBB;        ///< The absolute dimensions of the world.
+            const unsigned long   m_SectorSubdivs;  ///< The number of clip sectors along each side of the uniform grid.
+            const Vector3dT       m_SectorSideLen;  ///< The side lengths of each sector.
+            ClipSectorT*          m_Sectors;        ///< The clip sectors that cover the world (as a uniform grid of m_SectorSubdivs*m_SectorSubdivs cells).
+            ArrayT<ProxyT>        m_Proxies;        ///< The proxies of the clip models.
+            ArrayT<unsigned long> m_FreeProxies;    ///< The indices of the unused elements in m_Proxies.
+        };
+
+
+        /// This broadphase keeps the clip models in a dynamic, balanced bounding volume hierarchy (an AABB tree).
+        ///
+        /// The leaves of the tree hold the bounding boxes of the clip models, enlarged by a small margin.
+        /// As long as a clip model moves within its enlarged box, updating it doesn't change the tree at all.
+        /// Queries run in logarithmic time, independent of how the clip models are distributed in the world.
+        class AabbTreeBroadphaseT : public BroadphaseT
+        {
+            public:
+
+            /// The constructor.
+            /// @param Margin   The margin by which the bounding boxes of the clip models are enlarged in the leaves of the tree.
+            AabbTreeBroadphaseT(double Margin = 8.0);
+
+            // The BroadphaseT interface.
+            const char* GetName() const override { return "tree"; }
+            unsigned long Insert(ClipModelT* ClipModel, const BoundingBox3dT& BB, unsigned long Contents) override;
+            unsigned long Update(unsigned long Proxy, const BoundingBox3dT& BB, unsigned long Contents) override;
+            void Remove(unsigned long Proxy) override;
+            void Query(const BoundingBox3dT& BB, unsigned long ContentMask, ArrayT<ClipModelT*>& ClipModels) const override;
+
+
+            private:
+
+            struct NodeT
+            {
+                bool IsLeaf() const { return Children[0] == NO_PROXY; }
+
+                BoundingBox3dT BB;          ///< The (enlarged) bounding box of the clip model in a leaf, or the union of the bounding boxes of the children.
+                unsigned long  Contents;    ///< The contents of the clip model in a leaf, or the union of the contents of the children.
+                ClipModelT*    ClipModel;   ///< The clip model in a leaf, NULL otherwise.
+                unsigned long  Parent;      ///< The parent of this node, NO_PROXY for the root. For unused nodes, the next node in the free list.
+                unsigned long  Children[2]; ///< The children of this node, NO_PROXY for leaves.
+                int            Height;      ///< The height of the sub-tree at this node, 0 for leaves, -1 for unused nodes.
+            };
+
+            unsigned long AllocNode();
+            void          FreeNode(unsigned long NodeNr);
+            void          InsertLeaf(unsigned long LeafNr);
+            void          RemoveLeaf(unsigned long LeafNr);
+            unsigned long Balance(unsigned long NodeNr);
+            void          UpdateFromChildren(unsigned long NodeNr);
+            void          Refit(unsigned long NodeNr);
+
+            const double          m_Margin;     ///< The margin by which the bounding boxes in the leaves are enlarged.
+            ArrayT<NodeT>         m_Nodes;      ///< The nodes of the tree. The proxy of a clip model is the index of its leaf.
+            unsigned long         m_Root;       ///< The root node of the tree, NO_PROXY if the tree is empty.
+            unsigned long         m_FreeList;   ///< The first unused node in m_Nodes, NO_PROXY if there is none.
+        };
+    }
+}
+
+#endif
@@ -20,7 +20,6 @@ namespace cf
     namespace ClipSys
     {
         class  CollisionModelT;
-        class  ClipLinkT;
         class  ClipWorldT;
         struct TraceResultT;
         class  TraceSolidT;
@@ -57,6 +56,8 @@ namespace cf
             /// Sets a new origin for this clip model.
             /// Unregisters the model from the clip world before updating the origin, but does *not* re-register it!
             /// It is up to the user to call Register() again to re-register to model in the clip world.
+            /// (The model keeps its proxy in the broadphase of the clip world meanwhile, so that re-registering
+            /// only has to update it, which is much cheaper than a complete re-insertion.)
             void SetOrigin(const Vector3dT& NewOrigin);
 
             /// Returns the orientation (axes, rotation matrix) for this clip model.
@@ -119,9 +120,9 @@ namespace cf
             math::Matrix3x3T<double> Orientation;   ///< The local axes  of the collision model that positions it in world space. Origin and Orientation together form a matrix M that transforms a point from model to world space.
             GameSys::ComponentBaseT* m_Owner;       ///< The component that "owns" this clip model, i.e. this clip model belongs to and is a member of this component.
             BoundingBox3dT           AbsoluteBB;    ///< The world-space bounding box of the collision model, i.e. with Transformation applied.
-            ClipLinkT*               ListOfSectors; ///< The list of sectors that this model is in.
-            bool                     IsEnabled;     ///< Whether this model is enabled for clipping or not. When disabled, the model is not taken into account even while being registered with the clip world.
-            bool                     AlreadyChecked;///< For sole use by the ClipWorldT::GetClipModelsFromBB() method only, should always be false outside of that method.
+            unsigned long            BroadphaseProxy;   ///< The proxy of this model in the broadphase of the clip world, BroadphaseT::NO_PROXY if there is none.
+            bool                     IsRegistered;      ///< Whether this model is registered with the clip world, i.e. whether BroadphaseProxy is up-to-date.
+            bool                     IsEnabled;         ///< Whether this model is enabled for clipping or not. When disabled, the model is not taken into account even while being registered with the clip world.
         };
     }
 }
@@ -5,43 +5,38 @@ This project is licensed under the terms of the MIT license.
 */
 
 #include "ClipWorld.hpp"
-#include "ClipWorld_private.hpp"
+#include "Broadphase.hpp"
 #include "ClipModel.hpp"
 #include "CollisionModel_base.hpp"
 #include "TraceResult.hpp"
 #include "TraceSolid.hpp"
 #include "ConsoleCommands/Console.hpp"
+#include "ConsoleCommands/ConVar.hpp"
 
 
 using namespace cf::ClipSys;
 using namespace cf::math;
 
 
+static const char* BroadphaseNames[] = { "tree", "grid", NULL };
+static ConVarT clip_broadphase("clip_broadphase", "tree", ConVarT::FLAG_MAIN_EXE, "The broadphase of the clip worlds that are created from now on: \"tree\" (dynamic AABB tree) or \"grid\" (2D sector grid).", BroadphaseNames);
+
+
 ClipWorldT::ClipWorldT(const CollisionModelT* WorldCollMdl_)
     : WorldCollMdl(WorldCollMdl_),
-      WorldBB(WorldCollMdl->GetBoundingBox()),
-      SectorSubdivs(64),
-      SectorSideLen((WorldBB.Max - WorldBB.Min) / double(SectorSubdivs)),
-      Sectors(new ClipSectorT[SectorSubdivs * SectorSubdivs])
+      m_Broadphase(NULL)
 {
+    if (clip_broadphase.GetValueString() == "grid")
+        m_Broadphase = new SectorGridBroadphaseT(WorldCollMdl->GetBoundingBox(), 64);
+    else
+        m_Broadphase = new AabbTreeBroadphaseT();
 }
 
 
 ClipWorldT::~ClipWorldT()
 {
-#ifdef DEBUG
-    // Make sure that all sectors are empty (that is, all clip models have been destructed already).
-    for (unsigned long SectorNr = 0; SectorNr < SectorSubdivs * SectorSubdivs; SectorNr++)
-    {
-        // Don't inline this into the assert() statement. If the assertion triggers,
-        // it is convenient to have CS readily available in the debugger.
-        const ClipSectorT& CS = Sectors[SectorNr];
-
-        assert(CS.ListOfModels == NULL);
-    }
-#endif
-
-    delete[] Sectors;
+    // All clip models must have been destructed (unregistered) already.
+    delete m_Broadphase;
 }
 
 
@@ -50,7 +45,8 @@ void ClipWorldT::TraceConvexSolid(const TraceSolidT& TraceSolid, const Vector3dT
 {
     if (HitClipModel) *HitClipModel = NULL;
 
-    static ArrayT<WorldTraceResultT> Results;
+    // Each thread has its own array, so that several threads can trace through the clip world concurrently.
+    static thread_local ArrayT<WorldTraceResultT> Results;
     // Results.Overwrite();     // Done in Trace().
 
     Trace(TraceSolid, Start, Ray, ClipMask, Ignore, Results);
@@ -65,28 +61,61 @@ void ClipWorldT::TraceConvexSolid(const TraceSolidT& TraceSolid, const Vector3dT
 }
 
 
-void ClipWorldT::GetGridRectFromBB(unsigned long GridRect[], const BoundingBox3dT& BB) const
+void ClipWorldT::TraceRays(unsigned long NumRays, const Vector3dT* Starts, const Vector3dT* Rays,
+                           unsigned long ClipMask, const ClipModelT* Ignore, TraceResultT* Results, ClipModelT** HitClipModels) const
 {
-    assert(((unsigned long)(3.9)) == 3);    // Assert that doubles are cast to unsigned longs as expected.
+    if (NumRays == 0) return;
+
+    // First trace all rays together against the WorldCollMdl.
+    // As in Trace(), each trace starts with a fresh TraceResultT.
+    ArrayT<TraceResultT> WorldResults;
+
+    WorldResults.PushBackEmptyExact(NumRays);
 
-    GridRect[0] = (unsigned long)((BB.Min.x - WorldBB.Min.x) / SectorSideLen.x);
-    GridRect[1] = (unsigned long)((BB.Min.y - WorldBB.Min.y) / SectorSideLen.y);
-    GridRect[2] = (unsigned long)((BB.Max.x - WorldBB.Min.x) / SectorSideLen.x);
-    GridRect[3] = (unsigned long)((BB.Max.y - WorldBB.Min.y) / SectorSideLen.y);
+    for (unsigned long RayNr = 0; RayNr < NumRays; RayNr++)
+        WorldResults[RayNr] = TraceResultT();
 
-    for (unsigned long CheckNr = 0; CheckNr < 4; CheckNr++)
+    WorldCollMdl->TraceRays(NumRays, Starts, Rays, ClipMask, &WorldResults[0]);
+
+    // Now trace each ray against the entity clip models, and keep the result that Trace() would have sorted first.
+    const TracePointT   Point;
+    ArrayT<ClipModelT*> ClipModels;
+
+    for (unsigned long RayNr = 0; RayNr < NumRays; RayNr++)
     {
-        // Hmmm. I think it *is* possible to have situations where this assertion is violated...
-        // so I rather reduce it to a developer warning instead of having assert abort the program.
-        // assert(GridRect[i]<SectorSubdivs);
-        if (GridRect[CheckNr] >= SectorSubdivs) Console->DevWarning(cf::va("%s(%lu): CheckNr==%lu, %lu>=%lu\n", __FILE__, __LINE__, CheckNr, GridRect[CheckNr], SectorSubdivs));
+        TraceResultT Best          = WorldResults[RayNr];
+        ClipModelT*  BestClipModel = NULL;
 
-        if (int(GridRect[CheckNr]) < 0        ) GridRect[CheckNr] = 0;
-        if (GridRect[CheckNr] >= SectorSubdivs) GridRect[CheckNr] = SectorSubdivs - 1;
-    }
+        ClipModels.Overwrite();
+        GetClipModelsFromBB(ClipModels, ClipMask, Point.GetBB().GetOverallTranslationBox(Starts[RayNr], Starts[RayNr] + Rays[RayNr]));
+
+        for (unsigned int ModelNr = 0; ModelNr < ClipModels.Size(); ModelNr++)
+        {
+            ClipModelT* ClipModel = ClipModels[ModelNr];
+
+            if (ClipModel == Ignore) continue;
+
+            TraceResultT EntityResult;
+
+            ClipModel->TraceConvexSolid(Point, Starts[RayNr], Rays[RayNr], ClipMask, EntityResult);
+
+            if (EntityResult.Fraction == 1.0) continue;
 
-    GridRect[2]++;
-    GridRect[3]++;
+            // Like in Trace(), prefer results that started in solid, then those with the smaller Fraction.
+            const bool IsBetter = (EntityResult.StartSolid == Best.StartSolid) ? EntityResult.Fraction < Best.Fraction : EntityResult.StartSolid;
+
+            if (Best.Fraction == 1.0 || IsBetter)
+            {
+                Best          = EntityResult;
+                BestClipModel = ClipModel;
+            }
+        }
+
+        // Each result is set even if its ray hit nothing, so that no stale hit from an earlier use of Results is left behind.
+        Results[RayNr] = Best;
+
+        if (HitClipModels) HitClipModels[RayNr] = BestClipModel;
+    }
 }
 
 
@@ -94,38 +123,26 @@ void ClipWorldT::GetGridRectFromBB(unsigned long GridRect[], const BoundingBox3d
 void ClipWorldT::GetClipModelsFromBB(ArrayT<ClipModelT*>& ClipModels, unsigned long ContentMask, const BoundingBox3dT& BB) const
 {
     const BoundingBox3dT ExpandedBB = BB.GetEpsilonBox(1.0);
-    unsigned long GridRect[4];
-
-    GetGridRectFromBB(GridRect, BB);
-
-#ifdef DEBUG
-    // TODO: Can we assert that for all clip models CM in the world,
-    // assert(!CM->AlreadyChecked)  holds?
-#endif
+    const unsigned long  FirstNr    = ClipModels.Size();
 
-    for (unsigned long x = GridRect[0]; x < GridRect[2]; x++)
-        for (unsigned long y = GridRect[1]; y < GridRect[3]; y++)
-        {
-            const ClipSectorT& Sector = Sectors[y*SectorSubdivs + x];   // The sector at (x, y).
+    m_Broadphase->Query(ExpandedBB, ContentMask, ClipModels);
 
-            if ((Sector.ModelContents & ContentMask) == 0) continue;
+    // The broadphase returns candidates only, so check them now with their exact bounding box and contents.
+    unsigned long NumModels = FirstNr;
 
-            for (ClipLinkT* Link = Sector.ListOfModels; Link != NULL; Link = Link->NextModelInSector)
-            {
-                ClipModelT* ClipModel = Link->ClipModel;
+    for (unsigned long ModelNr = FirstNr; ModelNr < ClipModels.Size(); ModelNr++)
+    {
+        ClipModelT* ClipModel = ClipModels[ModelNr];
 
-                if (ClipModel->AlreadyChecked) continue;
-                if (!ClipModel->IsEnabled) continue;
-                if ((ClipModel->GetContents() & ContentMask) == 0) continue;
-                if (!ClipModel->GetAbsoluteBB().Intersects(ExpandedBB)) continue;
+        if (!ClipModel->IsRegistered) continue;
+        if (!ClipModel->IsEnabled) continue;
+        if ((ClipModel->GetContents() & ContentMask) == 0) continue;
+        if (!ClipModel->GetAbsoluteBB().Intersects(ExpandedBB)) continue;
 
-                ClipModel->AlreadyChecked = true;
-                ClipModels.PushBack(ClipModel);
-            }
-        }
+        ClipModels[NumModels++] = ClipModel;
+    }
 
-    for (unsigned long ModelNr = 0; ModelNr < ClipModels.Size(); ModelNr++)
-        ClipModels[ModelNr]->AlreadyChecked = false;
+    ClipModels.DeleteBack(ClipModels.Size() - NumModels);
 }
 
 
@@ -146,7 +163,7 @@ void ClipWorldT::Trace(const TraceSolidT& TraceSolid, const Vector3dT& Start, co
     }
 
     // Now trace against all entity clip models.
-    static ArrayT<ClipModelT*> ClipModels;
+    static thread_local ArrayT<ClipModelT*> ClipModels;
     ClipModels.Overwrite();
 
     const BoundingBox3dT OverallBB = TraceSolid.GetBB().GetOverallTranslationBox(Start, Start + Ray);
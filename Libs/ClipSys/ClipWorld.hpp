@@ -14,8 +14,8 @@ namespace cf
 {
     namespace ClipSys
     {
+        class  BroadphaseT;
         class  ClipModelT;
-        class  ClipSectorT;
         class  CollisionModelT;
         struct TraceResultT;
         struct WorldTraceResultT;
@@ -50,6 +50,22 @@ namespace cf
             void TraceConvexSolid(const TraceSolidT& TraceSolid, const Vector3dT& Start, const Vector3dT& Ray,
                                   unsigned long ClipMask, const ClipModelT* Ignore, TraceResultT& Result, ClipModelT** HitClipModel = NULL) const;
 
+            /// Traces a batch of rays through the clip world.
+            /// The result for each ray is essentially the same as if TraceConvexSolid() was called with a TracePointT for it
+            /// (see CollisionModelT::TraceRays() for the details), but the rays are traced through the world collision model
+            /// together, which is much faster when they are coherent (e.g. when they have a common start point, as for the
+            /// pellets of a shotgun).
+            /// @param NumRays         The number of rays in the batch.
+            /// @param Starts          The start points in world space where the traces begin.
+            /// @param Rays            The rays along which the traces are performed.
+            /// @param ClipMask        Only surfaces whose clip flags match this mask participate in the test.
+            /// @param Ignore          A clip model that is to be ignored during the traces, even if the content mask matches.
+            /// @param Results         The results of the traces. Unlike with TraceConvexSolid(), the input values are ignored: Each element is
+            ///                        set to the result of its trace, that is, to a default TraceResultT (Fraction 1.0) if the trace hit nothing.
+            /// @param HitClipModels   If not NULL, returns for each ray the clip model with which the reported collision occurred, or NULL if there was no collision with a clip model.
+            void TraceRays(unsigned long NumRays, const Vector3dT* Starts, const Vector3dT* Rays,
+                           unsigned long ClipMask, const ClipModelT* Ignore, TraceResultT* Results, ClipModelT** HitClipModels = NULL) const;
+
             /// Determines the set of clip models that touch a given bounding-box and meet a given contents mask.
             ///
             /// @note The return list is always exclusive the world, that is, the world clip model is *never*
@@ -69,22 +85,19 @@ namespace cf
             void Trace(const TraceSolidT& TraceSolid, const Vector3dT& Start, const Vector3dT& Ray,
                        unsigned long ClipMask, const ClipModelT* Ignore, ArrayT<WorldTraceResultT>& Results) const;
 
+            /// Returns the broadphase that this clip world uses for finding the clip models near a given box.
+            const BroadphaseT& GetBroadphase() const { return *m_Broadphase; }
+
 
             private:
 
             friend class ClipModelT;
 
-            // Private interface (also for use by ClipModelT friend class).
-            void GetGridRectFromBB(unsigned long GridRect[], const BoundingBox3dT& BB) const;
-
             ClipWorldT(const ClipWorldT&);          ///< Use of the Copy Constructor    is not allowed.
             void operator = (const ClipWorldT&);    ///< Use of the Assignment Operator is not allowed.
 
-            const CollisionModelT* WorldCollMdl;    ///< The collision model for the world. Never explicitly kept in the Sectors! Should probably be of type ClipModelT though!
-            const BoundingBox3dT   WorldBB;         ///< The absolute dimensions of the world.
-            const unsigned long    SectorSubdivs;   ///< The number of clip sectors along each side of the uniform grid.
-            const Vector3dT        SectorSideLen;   ///< The side lengths of each sector.
-            ClipSectorT*           Sectors;         ///< The clip sectors that cover the world (as a uniform grid of SectorSubdivs*SectorSubdivs cells).
+            const CollisionModelT* WorldCollMdl;    ///< The collision model for the world. Never explicitly kept in the broadphase! Should probably be of type ClipModelT though!
+            BroadphaseT*           m_Broadphase;    ///< The broadphase that keeps track of the clip models (for use by the ClipModelT friend class).
         };
     }
 }
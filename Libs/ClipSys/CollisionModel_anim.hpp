@@ -33,6 +33,7 @@ namespace cf
             unsigned long GetContents() const override;
             void SaveToFile(std::ostream& OutFile, SceneGraph::aux::PoolT& Pool) const override;
             void TraceConvexSolid(const TraceSolidT& TraceSolid, const Vector3dT& Start, const Vector3dT& Ray, unsigned long ClipMask, TraceResultT& Result) const override;
+            void TraceRays(unsigned long NumRays, const Vector3dT* Starts, const Vector3dT* Rays, unsigned long ClipMask, TraceResultT* Results) const override;
             unsigned long GetContents(const Vector3dT& Point, double BoxRadius, unsigned long ContMask) const override;
             btCollisionShape* GetBulletAdapter() const override;
 
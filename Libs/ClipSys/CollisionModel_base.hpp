@@ -68,6 +68,25 @@ namespace cf
             /// @see TraceResultT
             virtual void TraceConvexSolid(const TraceSolidT& TraceSolid, const Vector3dT& Start, const Vector3dT& Ray, unsigned long ClipMask, TraceResultT& Result) const = 0;
 
+            /// Traces a batch of rays through the collision model.
+            /// The result for each ray is essentially the same as if TraceConvexSolid() was called with a TracePointT for it,
+            /// but implementations can process several rays together, which is much faster when the rays are coherent
+            /// (e.g. when they have a common start point, as in lightmap baking or for the pellets of a shotgun).
+            ///
+            /// Note that the objects of the model may be visited in a different order than by TraceConvexSolid().
+            /// As a hit is pulled back by a small epsilon from the surface of the hit object, the order matters
+            /// when a ray hits two objects at almost the same distance: the reported Fraction (and ImpactNormal and
+            /// Material) can then differ from that of TraceConvexSolid() by the amount of the pull-back.
+            ///
+            /// @param NumRays    The number of rays in the batch.
+            /// @param Starts     The start points of the rays in model space.
+            /// @param Rays       The rays along which the traces are performed.
+            /// @param ClipMask   Only surfaces whose clip flags match this mask participate in the test.
+            /// @param Results    The start values of Fraction are input via this array, and the results of the traces returned.
+            ///
+            /// @see TraceConvexSolid()
+            virtual void TraceRays(unsigned long NumRays, const Vector3dT* Starts, const Vector3dT* Rays, unsigned long ClipMask, TraceResultT* Results) const = 0;
+
             /// Determines the volume contents of the model at the given point / in the given box.
             /// The function considers all brush volumes in the collision model that contain the given point or intersect the given box,
             /// and returns their combined ("or'ed") contents.
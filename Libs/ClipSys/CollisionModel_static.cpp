@@ -21,6 +21,15 @@ This project is licensed under the terms of the MIT license.
 #include "MapFile.hpp"
 
 #include <algorithm>
+#include <memory>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define CAFU_CLIPSYS_SSE2 1
+#else
+#define CAFU_CLIPSYS_SSE2 0
+#endif
 
 #if defined(_WIN32) && defined(_MSC_VER)
     // Turn off warning C4355: 'this' : used in base member initializer list.
@@ -31,9 +40,6 @@ This project is licensed under the terms of the MIT license.
 using namespace cf::ClipSys;
 
 
-unsigned long CollisionModelStaticT::s_CheckCount = 0;
-
-
 /// This representation of a TraceSolidT is used in the implementation of CollisionModelStaticT
 /// as a performance optimization, allowing it to shortcut the frequent and expensive access to
 /// the TraceSolidT's virtual methods.
@@ -79,14 +85,15 @@ class CollisionModelStaticT::TraceParamsT
 {
     public:
 
-    TraceParamsT(const bool GenericBrushes_, const TraceSolidT& TraceSolid_, const Vector3dT& Start_, const Vector3dT& Ray_, unsigned long ClipMask_, TraceResultT& Result_)
+    TraceParamsT(const bool GenericBrushes_, const TraceSolidT& TraceSolid_, const Vector3dT& Start_, const Vector3dT& Ray_, unsigned long ClipMask_, TraceResultT& Result_, VisitedSetT& Visited_)
         : GenericBrushes(GenericBrushes_),
           TraceSolid(TraceSolid_),
           TraceBB(TraceSolid_.GetBB()),
           Start(Start_),
           Ray(Ray_),
           ClipMask(ClipMask_),
-          Result(Result_)
+          Result(Result_),
+          Visited(Visited_)
     {
     }
 
@@ -98,13 +105,107 @@ class CollisionModelStaticT::TraceParamsT
     const Vector3dT&     Ray;
     const unsigned long  ClipMask;
     TraceResultT&        Result;
+    VisitedSetT&         Visited;
+};
+
+
+/// A packet of rays that are traced together through a CollisionModelStaticT.
+/// The start points and rays are (also) kept in structure-of-arrays layout, so that the loops over the rays
+/// of a packet can use SIMD instructions, e.g. the plane tests in BrushT::TraceRays().
+/// With doubles, SIZE == 4 fills two SSE2 registers (or an AVX register).
+class CollisionModelStaticT::RayPacketT
+{
+    public:
+
+    static const unsigned int SIZE = 4;
+
+    RayPacketT(const Vector3dT* Starts_, const Vector3dT* Rays_, unsigned int NumRays_, unsigned long ClipMask_)
+        : NumRays(NumRays_),
+          ClipMask(ClipMask_),
+          Starts(Starts_),
+          Rays(Rays_)
+    {
+        assert(NumRays > 0 && NumRays <= SIZE);
+
+        for (unsigned int RayNr = 0; RayNr < SIZE; RayNr++)
+        {
+            // Unused slots repeat the first ray, so that the loops over the packet never need to check NumRays.
+            const unsigned int Nr = RayNr < NumRays ? RayNr : 0;
+
+            StartX[RayNr] = Starts[Nr].x;
+            StartY[RayNr] = Starts[Nr].y;
+            StartZ[RayNr] = Starts[Nr].z;
+
+            RayX[RayNr] = Rays[Nr].x;
+            RayY[RayNr] = Rays[Nr].y;
+            RayZ[RayNr] = Rays[Nr].z;
+        }
+    }
+
+
+    const unsigned int  NumRays;    ///< The number of rays in this packet, at most SIZE.
+    const unsigned long ClipMask;
+    const Vector3dT*    Starts;     ///< The NumRays start points of the rays.
+    const Vector3dT*    Rays;       ///< The NumRays rays.
+
+    // The start points and rays in structure-of-arrays layout.
+    double StartX[SIZE];
+    double StartY[SIZE];
+    double StartZ[SIZE];
+    double RayX[SIZE];
+    double RayY[SIZE];
+    double RayZ[SIZE];
 };
 
 
+CollisionModelStaticT::VisitedSetT::VisitedSetT(const CollisionModelStaticT& Model)
+    : m_Model(Model),
+      m_Scratch(NULL)
+{
+    // Each thread has its own pool, and nested queries in the same thread use different elements.
+    // The elements are individually allocated, so that growing the pool doesn't move them.
+    static thread_local std::vector< std::unique_ptr<ScratchT> > Pool;
+
+    for (unsigned long ScratchNr = 0; ScratchNr < Pool.size() && !m_Scratch; ScratchNr++)
+        if (!Pool[ScratchNr]->InUse) m_Scratch = Pool[ScratchNr].get();
+
+    if (!m_Scratch)
+    {
+        Pool.push_back(std::unique_ptr<ScratchT>(new ScratchT));
+        m_Scratch = Pool.back().get();
+    }
+
+    m_Scratch->InUse = true;
+
+    // Make sure that there is a stamp for each object of the model.
+    ArrayT<unsigned int>& Stamps  = m_Scratch->Stamps;
+    const unsigned long   NumObjs = Model.m_Polygons.Size() + Model.m_Brushes.Size() + Model.m_Terrains.Size();
+
+    while (Stamps.Size() < NumObjs) Stamps.PushBack(0);
+
+    // Begin a new generation, which implicitly removes all objects from the set.
+    // Only when the generation counter wraps around, the stamps must explicitly be reset.
+    m_Scratch->Generation++;
+
+    if (m_Scratch->Generation == 0)
+    {
+        for (unsigned long StampNr = 0; StampNr < Stamps.Size(); StampNr++)
+            Stamps[StampNr] = 0;
+
+        m_Scratch->Generation = 1;
+    }
+}
+
+
+CollisionModelStaticT::VisitedSetT::~VisitedSetT()
+{
+    m_Scratch->InUse = false;
+}
+
+
 CollisionModelStaticT::PolygonT::PolygonT()
     : Parent(NULL),
-      Material(NULL),
-      CheckCount(0)
+      Material(NULL)
 {
     Vertices[0] = 0;
     Vertices[1] = 0;
@@ -116,8 +217,7 @@ CollisionModelStaticT::PolygonT::PolygonT()
 CollisionModelStaticT::PolygonT::PolygonT(CollisionModelStaticT* Parent_, MaterialT* Material_,
         unsigned long A, unsigned long B, unsigned long C, unsigned long D)
     : Parent(Parent_),
-      Material(Material_),
-      CheckCount(0)
+      Material(Material_)
 {
     Vertices[0] = A;
     Vertices[1] = B;
@@ -177,10 +277,10 @@ void CollisionModelStaticT::PolygonT::TraceConvexSolid(
         // Assemble a brush from the polygon, then trace the solid against that brush.
         // Brushes are - by nature - solid and "unsided"... PolyBrushSides[1] can NOT be omitted,
         // even if the polygon is one-sided, or otherwise we had some polygon with infinite extent.
-        static BrushT        PolyBrush;
-        static BrushT::SideT PolyBrushSides[2];
-        static unsigned long ReverseVIs[4];
-        static BrushT::EdgeT PolyBrushEdges[4];
+        BrushT               PolyBrush;
+        BrushT::SideT        PolyBrushSides[2];
+        unsigned long        ReverseVIs[4];
+        BrushT::EdgeT        PolyBrushEdges[4];
         const unsigned long  NUM_VERTS = IsTriangle() ? 3 : 4;
 
         // Setup the PolyBrush.
@@ -189,7 +289,6 @@ void CollisionModelStaticT::PolygonT::TraceConvexSolid(
         PolyBrush.NrOfSides     = 2;
      // PolyBrush.BB            = GetBB();    // Not needed here.
         PolyBrush.Contents      = Material->ClipFlags;
-     // PolyBrush.CheckCount    = 0;          // Not needed here.
 
         PolyBrush.HullVerts     = const_cast<unsigned long*>(Vertices);   // Note that both BrushT as well as PolygonT vertex indices are assumed to point into Parent->m_Vertices!
         PolyBrush.NrOfHullVerts = NUM_VERTS;
@@ -327,7 +426,6 @@ CollisionModelStaticT::BrushT::BrushT()
       NrOfSides(0),
       BB(),
       Contents(0),
-      CheckCount(0),
       HullVerts(NULL),
       NrOfHullVerts(0),
       HullEdges(NULL),
@@ -347,11 +445,11 @@ CollisionModelStaticT::BrushT::BrushT()
 // }
 
 
-void CollisionModelStaticT::BrushT::CacheHullVerts() const
+void CollisionModelStaticT::BrushT::CacheHullVerts()
 {
     assert(HullVerts == NULL);  // Don't call this method more than once.
 
-    static ArrayT<unsigned long> Verts;
+    static thread_local ArrayT<unsigned long> Verts;
     Verts.Overwrite();
 
     for (unsigned long SideNr = 0; SideNr < NrOfSides; SideNr++)
@@ -372,11 +470,11 @@ void CollisionModelStaticT::BrushT::CacheHullVerts() const
 }
 
 
-void CollisionModelStaticT::BrushT::CacheHullEdges() const
+void CollisionModelStaticT::BrushT::CacheHullEdges()
 {
     assert(HullEdges == NULL);  // Don't call this method more than once.
 
-    static ArrayT<BrushT::EdgeT> Edges;
+    static thread_local ArrayT<BrushT::EdgeT> Edges;
     Edges.Overwrite();
 
     for (unsigned long SideNr = 0; SideNr < NrOfSides; SideNr++)
@@ -453,8 +551,8 @@ void CollisionModelStaticT::BrushT::TraceConvexSolid(
     //   a) the planes of this brush,
     //   b) the (mirrored) planes of the trace solid,
     //   c) the "bevel" planes generated by sweeping the edges of the trace solid along the edges of the brush.
-    static ArrayT<const Plane3dT*> AllPlanes;
-    static ArrayT<Plane3dT>        BevelPlanes;
+    static thread_local ArrayT<const Plane3dT*> AllPlanes;
+    static thread_local ArrayT<Plane3dT>        BevelPlanes;
 
     AllPlanes.Overwrite();
     BevelPlanes.Overwrite();
@@ -464,7 +562,7 @@ void CollisionModelStaticT::BrushT::TraceConvexSolid(
         AllPlanes.PushBack(&Sides[PlaneNr].Plane);
 
     // Case b), add the (mirrored) planes of the trace solid.
-    if (HullVerts == NULL) CacheHullVerts();
+    assert(HullVerts != NULL);  // Computed in CollisionModelStaticT::CacheBrushHulls().
 
     BevelPlanes.PushBackEmpty(TraceSolid.NumPlanes);
 
@@ -484,7 +582,7 @@ void CollisionModelStaticT::BrushT::TraceConvexSolid(
     }
 
     // Case c), add the planes obtained by sweeping the edges of the trace solid along the edges of the brush.
-    if (HullEdges == NULL) CacheHullEdges();
+    assert(HullEdges != NULL);  // Computed in CollisionModelStaticT::CacheBrushHulls().
 
     for (unsigned long BrushEdgeNr = 0; BrushEdgeNr < NrOfHullEdges; BrushEdgeNr++)
     {
@@ -565,7 +663,7 @@ void CollisionModelStaticT::BrushT::TraceConvexSolid(
     // For a given brush plane P that offset is the (negative) distance between planes Po and Pv,
     // where Po is a plane parallel to P through the origin of the convex polyhedron defined by HullVerts,
     // and   Pv is a plane parallel to P through the "outmost" vertex of the convex polyhedron in direction of the normal vector.
-    static ArrayT<double> BloatDistanceOffsets;
+    static thread_local ArrayT<double> BloatDistanceOffsets;
 
     while (BloatDistanceOffsets.Size() < AllPlanes.Size()) BloatDistanceOffsets.PushBack(0.0);
 
@@ -732,6 +830,131 @@ void CollisionModelStaticT::BrushT::TraceRay(
 }
 
 
+void CollisionModelStaticT::BrushT::TraceRays(const RayPacketT& Packet, TraceResultT* Results) const
+{
+    const unsigned int SIZE = RayPacketT::SIZE;
+
+    // If the contents of this brush doesn't match the ContMask, it doesn't interfere with the traces.
+    if ((Contents & Packet.ClipMask) == 0) return;
+
+    // For all sides of the brush and all rays of the packet, compute the distances of the start points from
+    // the side planes and the denominators of the ray/plane intersections.
+    static thread_local ArrayT<double> Dists;
+    static thread_local ArrayT<double> Denoms;
+
+    while (Dists .Size() < NrOfSides * SIZE) Dists .PushBack(0.0);
+    while (Denoms.Size() < NrOfSides * SIZE) Denoms.PushBack(0.0);
+
+    unsigned int IsOutside[SIZE];
+
+#if CAFU_CLIPSYS_SSE2
+    // Each SSE2 register holds the values of two rays. The operations are the same as in the loop below,
+    // in the same order, so that the results are exactly the same.
+    static_assert(SIZE % 2 == 0, "The rays of a packet must fill the SSE2 registers.");
+
+    const __m128d Zero        = _mm_setzero_pd();
+    int           OutsideBits = 0;
+
+    for (unsigned long SideNr = 0; SideNr < NrOfSides; SideNr++)
+    {
+        const Plane3dT& P  = Sides[SideNr].Plane;
+        const __m128d   NX = _mm_set1_pd(P.Normal.x);
+        const __m128d   NY = _mm_set1_pd(P.Normal.y);
+        const __m128d   NZ = _mm_set1_pd(P.Normal.z);
+        const __m128d   PD = _mm_set1_pd(P.Dist);
+
+        for (unsigned int RayNr = 0; RayNr < SIZE; RayNr += 2)
+        {
+            const __m128d D = _mm_sub_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(NX, _mm_loadu_pd(Packet.StartX + RayNr)),
+                                                               _mm_mul_pd(NY, _mm_loadu_pd(Packet.StartY + RayNr))),
+                                                    _mm_mul_pd(NZ, _mm_loadu_pd(Packet.StartZ + RayNr))), PD);
+            const __m128d N = _mm_add_pd(_mm_add_pd(_mm_mul_pd(NX, _mm_loadu_pd(Packet.RayX + RayNr)),
+                                                    _mm_mul_pd(NY, _mm_loadu_pd(Packet.RayY + RayNr))),
+                                         _mm_mul_pd(NZ, _mm_loadu_pd(Packet.RayZ + RayNr)));
+
+            _mm_storeu_pd(&Dists [SideNr * SIZE + RayNr], D);
+            _mm_storeu_pd(&Denoms[SideNr * SIZE + RayNr], N);
+
+            OutsideBits |= _mm_movemask_pd(_mm_cmpge_pd(D, Zero)) << RayNr;
+        }
+    }
+
+    for (unsigned int RayNr = 0; RayNr < SIZE; RayNr++)
+        IsOutside[RayNr] = (OutsideBits >> RayNr) & 1;
+#else
+    // The inner loop is over the rays, without any branches, so that the compiler can vectorize it.
+    for (unsigned int RayNr = 0; RayNr < SIZE; RayNr++)
+        IsOutside[RayNr] = 0;
+
+    for (unsigned long SideNr = 0; SideNr < NrOfSides; SideNr++)
+    {
+        const Plane3dT& P = Sides[SideNr].Plane;
+        double*         D = &Dists [SideNr * SIZE];
+        double*         N = &Denoms[SideNr * SIZE];
+
+        for (unsigned int RayNr = 0; RayNr < SIZE; RayNr++)
+        {
+            D[RayNr] = P.Normal.x * Packet.StartX[RayNr] + P.Normal.y * Packet.StartY[RayNr] + P.Normal.z * Packet.StartZ[RayNr] - P.Dist;
+            N[RayNr] = P.Normal.x * Packet.RayX  [RayNr] + P.Normal.y * Packet.RayY  [RayNr] + P.Normal.z * Packet.RayZ  [RayNr];
+
+            IsOutside[RayNr] |= (D[RayNr] >= 0);
+        }
+    }
+#endif
+
+    // With the above, complete each trace exactly as in TraceRay().
+    for (unsigned int RayNr = 0; RayNr < Packet.NumRays; RayNr++)
+    {
+        TraceResultT& Result = Results[RayNr];
+
+        if (Result.StartSolid) continue;
+
+        // If the start point is inside the (solid) brush, we're stuck.
+        if (!IsOutside[RayNr])
+        {
+            Result.StartSolid = true;
+            Result.Fraction   = 0;
+            continue;
+        }
+
+        for (unsigned long SideNr = 0; SideNr < NrOfSides; SideNr++)
+        {
+            assert(Sides[SideNr].Material != NULL || !Parent->m_GenericBrushes);  // Assert that Material!=NULL or the brush is with precomputed bevels.
+            if (Sides[SideNr].Material == NULL) continue;
+
+            const double Nenner = Denoms[SideNr * SIZE + RayNr];
+
+            if (Nenner >= 0) continue;
+
+            const double Dist = Dists[SideNr * SIZE + RayNr];
+            double       F    = -Dist / Nenner;
+
+            if (F < 0 || F >= Result.Fraction) continue;
+
+            // Check if the intersection point is really on the brush.
+            const Vector3dT HitPos = Packet.Starts[RayNr] + Packet.Rays[RayNr] * F;
+            unsigned long SNr;
+
+            for (SNr = 0; SNr < NrOfSides; SNr++)
+                if (SNr != SideNr && Sides[SNr].Plane.GetDistance(HitPos) > 0.01) break;
+
+            if (SNr < NrOfSides) continue;
+
+            // This is the entry point, pulled back to 0.03125 units in front of the plane (see TraceRay() for details).
+            F = -(Dist - 0.03125) / Nenner;
+
+            if (F < 0              ) F = 0;
+            if (F > Result.Fraction) F = Result.Fraction;   // Pro forma.
+
+            Result.Fraction     = F;
+            Result.ImpactNormal = Sides[SideNr].Plane.Normal;
+            Result.Material     = Sides[SideNr].Material;
+            break;
+        }
+    }
+}
+
+
 void CollisionModelStaticT::BrushT::TraceBevelBB(
     const BoundingBox3dT& TraceBB, const Vector3dT& Start, const Vector3dT& Ray, unsigned long ClipMask, TraceResultT& Result) const
 {
@@ -745,7 +968,7 @@ void CollisionModelStaticT::BrushT::TraceBevelBB(
     // if (!OverallBB.Intersects(BB)) return;
 
 
-    static ArrayT<double> BloatDistanceOffsets;
+    static thread_local ArrayT<double> BloatDistanceOffsets;
 
     // Bloat-Distance-Offsets für alle Planes dieses Brushs bestimmen.
     while (BloatDistanceOffsets.Size() < NrOfSides) BloatDistanceOffsets.PushBack(0.0);
@@ -829,8 +1052,7 @@ void CollisionModelStaticT::BrushT::TraceBevelBB(
 CollisionModelStaticT::TerrainRefT::TerrainRefT()
     : Terrain(NULL),
       Material(NULL),
-      BB(),
-      CheckCount(0)
+      BB()
 {
 }
 
@@ -838,8 +1060,7 @@ CollisionModelStaticT::TerrainRefT::TerrainRefT()
 CollisionModelStaticT::TerrainRefT::TerrainRefT(const TerrainT* Terrain_, MaterialT* Material_, const BoundingBox3dT& BB_)
     : Terrain(Terrain_),
       Material(Material_),
-      BB(BB_),
-      CheckCount(0)
+      BB(BB_)
 {
 }
 
@@ -1073,8 +1294,7 @@ void CollisionModelStaticT::NodeT::Trace(const Vector3dT& A, const Vector3dT& B,
     {
         const BrushT* Brush = Brushes[BrushNr];
 
-        if (Brush->CheckCount == s_CheckCount) continue;
-        Brush->CheckCount = s_CheckCount;
+        if (!Params.Visited.Insert(Brush)) continue;
 
         if (Params.TraceSolid.NumVerts == 1)    // Also checked by BrushT::TraceConvexSolid(), but not by BrushT::TraceBevelBB(), thus anticipate it here.
         {
@@ -1096,8 +1316,7 @@ void CollisionModelStaticT::NodeT::Trace(const Vector3dT& A, const Vector3dT& B,
     {
         const PolygonT* Poly = Polygons[PolyNr];
 
-        if (Poly->CheckCount == s_CheckCount) continue;
-        Poly->CheckCount = s_CheckCount;
+        if (!Params.Visited.Insert(Poly)) continue;
 
         if (Params.TraceSolid.NumVerts == 1)    // Also checked by PolygonT::TraceConvexSolid(), but checking it here saves another function call there.
         {
@@ -1117,8 +1336,7 @@ void CollisionModelStaticT::NodeT::Trace(const Vector3dT& A, const Vector3dT& B,
     {
         const TerrainRefT* Terrain = Terrains[TerrainNr];
 
-        if (Terrain->CheckCount == s_CheckCount) continue;
-        Terrain->CheckCount = s_CheckCount;
+        if (!Params.Visited.Insert(Terrain)) continue;
 
         // If the ClipFlags of this terrain don't match the ClipMask, it doesn't interfere with the trace.
         if (!Terrain->Material) continue;
@@ -1205,6 +1423,112 @@ void CollisionModelStaticT::NodeT::Trace(const Vector3dT& A, const Vector3dT& B,
 }
 
 
+void CollisionModelStaticT::NodeT::TraceRays(const RayPacketT& Packet, TraceResultT* Results, VisitedSetT& Visited) const
+{
+    // If all rays got stuck in solid or already hit something nearer, there is no need to check this node.
+    // This is a bit more permissive than the corresponding check in Trace(), as we don't clip the rays to the node.
+    unsigned int RayNr;
+
+    for (RayNr = 0; RayNr < Packet.NumRays; RayNr++)
+        if (!Results[RayNr].StartSolid && Results[RayNr].Fraction > 0) break;
+
+    if (RayNr == Packet.NumRays) return;
+
+    // Trace against all the brushes of this node.
+    for (unsigned long BrushNr = 0; BrushNr < Brushes.Size(); BrushNr++)
+    {
+        const BrushT* Brush = Brushes[BrushNr];
+
+        if (!Visited.Insert(Brush)) continue;
+
+        Brush->TraceRays(Packet, Results);
+    }
+
+    // Trace against all the polygons of this node.
+    for (unsigned long PolyNr = 0; PolyNr < Polygons.Size(); PolyNr++)
+    {
+        const PolygonT* Poly = Polygons[PolyNr];
+
+        if (!Visited.Insert(Poly)) continue;
+
+        for (RayNr = 0; RayNr < Packet.NumRays; RayNr++)
+            if (!Results[RayNr].StartSolid)
+                Poly->TraceRay(Packet.Starts[RayNr], Packet.Rays[RayNr], Packet.ClipMask, Results[RayNr]);
+    }
+
+    // Trace against all the terrains of this node.
+    for (unsigned long TerrainNr = 0; TerrainNr < Terrains.Size(); TerrainNr++)
+    {
+        const TerrainRefT* Terrain = Terrains[TerrainNr];
+
+        if (!Visited.Insert(Terrain)) continue;
+
+        // If the ClipFlags of this terrain don't match the ClipMask, it doesn't interfere with the traces.
+        if (!Terrain->Material) continue;
+        if ((Terrain->Material->ClipFlags & Packet.ClipMask) == 0) continue;
+
+        for (RayNr = 0; RayNr < Packet.NumRays; RayNr++)
+        {
+            TraceResultT& Result = Results[RayNr];
+
+            if (Result.StartSolid) continue;
+
+            const double       OldFrac = Result.Fraction;
+            VB_Trace3T<double> LocalResult(Result.Fraction);
+
+            LocalResult.StartSolid   = Result.StartSolid;
+            LocalResult.ImpactNormal = Result.ImpactNormal;
+
+            Terrain->Terrain->TraceBoundingBox(BoundingBox3dT(Vector3dT(0, 0, 0)), Packet.Starts[RayNr], Packet.Rays[RayNr], LocalResult);
+
+            Result.Fraction     = LocalResult.Fraction;
+            Result.StartSolid   = LocalResult.StartSolid;
+            Result.ImpactNormal = LocalResult.ImpactNormal;
+
+            if (Result.Fraction < OldFrac)
+            {
+                Result.Material = Terrain->Material;
+            }
+        }
+    }
+
+    // If this is a leaf node, we're done.
+    if (PlaneType == NodeT::NONE) return;
+
+
+    // Determine the children that are touched by at least one ray, using the same bloated node plane as Trace() for points.
+    const double BloatOffset = 1.0;
+    bool         TouchFront  = false;
+    bool         TouchBack   = false;
+    bool         BackToFront = false;
+
+    for (RayNr = 0; RayNr < Packet.NumRays; RayNr++)
+    {
+        if (Results[RayNr].StartSolid) continue;
+
+        const double DistA = Packet.Starts[RayNr][PlaneType] - PlaneDist;
+        const double DistB = DistA + Packet.Rays[RayNr][PlaneType] * Results[RayNr].Fraction;
+
+        if (!TouchFront && !TouchBack) BackToFront = DistA < DistB;
+
+        if (DistA >= -BloatOffset || DistB >= -BloatOffset) TouchFront = true;
+        if (DistA <   BloatOffset || DistB <   BloatOffset) TouchBack  = true;
+    }
+
+    // Recurse into the "near" sub-tree first, then the "far", as seen by the first ray.
+    if (BackToFront)
+    {
+        if (TouchBack ) Children[1]->TraceRays(Packet, Results, Visited);
+        if (TouchFront) Children[0]->TraceRays(Packet, Results, Visited);
+    }
+    else
+    {
+        if (TouchFront) Children[0]->TraceRays(Packet, Results, Visited);
+        if (TouchBack ) Children[1]->TraceRays(Packet, Results, Visited);
+    }
+}
+
+
 void CollisionModelStaticT::NodeT::Insert(const PolygonT* Poly)
 {
     NodeT*               Node   = this;
@@ -1433,8 +1757,6 @@ CollisionModelStaticT::CollisionModelStaticT(std::istream& InFile, cf::SceneGrap
         for (unsigned long SideNr = 0; SideNr < Brush.NrOfSides; SideNr++)
             if (Brush.Sides[SideNr].Material)   // Material is NULL if this is a precomputed "bevel" side.
                 Brush.Contents |= Brush.Sides[SideNr].Material->ClipFlags;
-
-        Brush.CheckCount = 0;
     }
 
 
@@ -1450,8 +1772,7 @@ CollisionModelStaticT::CollisionModelStaticT(std::istream& InFile, cf::SceneGrap
         for (unsigned long VertexNr = 0; VertexNr < 4; VertexNr++)
             Polygon.Vertices[VertexNr] = aux::ReadUInt32(InFile);
 
-        Polygon.Material   = MaterialManager->GetMaterial(Pool.ReadString(InFile));
-        Polygon.CheckCount = 0;
+        Polygon.Material = MaterialManager->GetMaterial(Pool.ReadString(InFile));
     }
 
 
@@ -1499,6 +1820,8 @@ CollisionModelStaticT::CollisionModelStaticT(std::istream& InFile, cf::SceneGrap
     // Finish loading.
     m_BB       = m_RootNode->GetBB();         // Buffer bounding box for entire shape.
     m_Contents = m_RootNode->GetContents();   // Buffer contents     for entire shape.
+
+    CacheBrushHulls();
 }
 
 
@@ -1895,6 +2218,8 @@ CollisionModelStaticT::CollisionModelStaticT(const cf::MapFileEntityT& Entity, c
     for (unsigned long TerrainNr = 0; TerrainNr < m_Terrains.Size(); TerrainNr++)
         m_RootNode->Terrains.PushBack(&m_Terrains[TerrainNr]);
 
+    CacheBrushHulls();
+
 
     // Finish the collision shape.
     m_BB       = m_RootNode->GetBB();         // Buffer bounding box for entire shape.
@@ -2172,20 +2497,31 @@ void CollisionModelStaticT::SaveToFile(std::ostream& OutFile, cf::SceneGraph::au
 void CollisionModelStaticT::TraceConvexSolid(
     const TraceSolidT& TraceSolid, const Vector3dT& Start, const Vector3dT& Ray, unsigned long ClipMask, TraceResultT& Result) const
 {
-    CollisionModelStaticT::s_CheckCount++;
-
-    TraceParamsT Params(m_GenericBrushes, TraceSolid, Start, Ray, ClipMask, Result);
+    VisitedSetT  Visited(*this);
+    TraceParamsT Params(m_GenericBrushes, TraceSolid, Start, Ray, ClipMask, Result, Visited);
 
     m_RootNode->Trace(Start, Start + Ray * Result.Fraction, 0, Result.Fraction, Params);
 }
 
 
-unsigned long CollisionModelStaticT::GetContents(const Vector3dT& Point, double BoxRadius, unsigned long ContMask) const
+void CollisionModelStaticT::TraceRays(unsigned long NumRays, const Vector3dT* Starts, const Vector3dT* Rays, unsigned long ClipMask, TraceResultT* Results) const
 {
-    static ArrayT<NodeT*> NodeStack;    // It's static for better performance, giving up thread safety.
-    unsigned long         Contents = 0;
+    for (unsigned long FirstRayNr = 0; FirstRayNr < NumRays; FirstRayNr += RayPacketT::SIZE)
+    {
+        const unsigned int PacketSize = (unsigned int)std::min<unsigned long>(NumRays - FirstRayNr, RayPacketT::SIZE);
+        const RayPacketT   Packet(Starts + FirstRayNr, Rays + FirstRayNr, PacketSize, ClipMask);
+        VisitedSetT        Visited(*this);
 
-    CollisionModelStaticT::s_CheckCount++;
+        m_RootNode->TraceRays(Packet, Results + FirstRayNr, Visited);
+    }
+}
+
+
+unsigned long CollisionModelStaticT::GetContents(const Vector3dT& Point, double BoxRadius, unsigned long ContMask) const
+{
+    static thread_local ArrayT<NodeT*> NodeStack;   // It's static for better performance, and thread-local for thread safety.
+    unsigned long                      Contents = 0;
+    VisitedSetT                        Visited(*this);
 
     assert(NodeStack.Size() == 0);
     NodeStack.Overwrite();
@@ -2201,8 +2537,7 @@ unsigned long CollisionModelStaticT::GetContents(const Vector3dT& Point, double
             const BrushT* Brush = Node->Brushes[BrushNr];
 
             // Tested this brush already?
-            if (Brush->CheckCount == s_CheckCount) continue;
-            Brush->CheckCount = s_CheckCount;
+            if (!Visited.Insert(Brush)) continue;
 
             // Does the ContMask match?
             if ((Brush->Contents & ContMask) == 0) continue;
@@ -2314,3 +2649,16 @@ void CollisionModelStaticT::BuildAxialBSPTree(NodeT* Node, const BoundingBox3dT&
     BuildAxialBSPTree(FrontNode, FrontBB, MIN_NODE_SIZE);
     BuildAxialBSPTree(BackNode,  BackBB, MIN_NODE_SIZE);
 }
+
+
+void CollisionModelStaticT::CacheBrushHulls()
+{
+    // Brushes with precomputed bevel planes are only traced with BrushT::TraceBevelBB(), which doesn't need the hulls.
+    if (!m_GenericBrushes) return;
+
+    for (unsigned long BrushNr = 0; BrushNr < m_Brushes.Size(); BrushNr++)
+    {
+        m_Brushes[BrushNr].CacheHullVerts();
+        m_Brushes[BrushNr].CacheHullEdges();
+    }
+}
@@ -28,6 +28,8 @@ namespace cf
 
             class InternalTraceSolidT;
             class TraceParamsT;
+            class RayPacketT;
+            class VisitedSetT;
 
 
             class PolygonT
@@ -53,7 +55,6 @@ namespace cf
                 CollisionModelStaticT* Parent;
                 unsigned long          Vertices[4]; ///< The indices of the vertices that define the triangle or quad, respectively, referring into the m_Vertices list.
                 MaterialT*             Material;    ///< The material on the surface of this polygon.
-                mutable unsigned long  CheckCount;  ///< Used in order to avoid processing things twice.
             };
 
 
@@ -62,7 +63,7 @@ namespace cf
             ///
             /// Brushes participate in traces (collision tests) and are exclusively used for volume contents tests.
             ///
-            /// Note that most members (all but CheckCount) could and should be declared "const" - if not for the
+            /// Note that most members could and should be declared "const" - if not for the
             /// assignment operator that is required when storing elements of this class in ArrayT<>s.
             class BrushT
             {
@@ -86,8 +87,8 @@ namespace cf
                 /// The default constructor.
                 BrushT();
 
-                void CacheHullVerts() const;
-                void CacheHullEdges() const;
+                void CacheHullVerts();
+                void CacheHullEdges();
 
                 /// Traces the given convex polyhedron from Start along Ray (up to the input value of Result.Fraction)
                 /// through the brush, and reports the first collision, if any.
@@ -98,6 +99,10 @@ namespace cf
 
                 void TraceRay(const Vector3dT& Start, const Vector3dT& Ray, unsigned long ClipMask, TraceResultT& Result) const;
 
+                /// Traces all rays of the given packet through the brush, exactly as TraceRay() does for each individual ray.
+                /// The plane tests are run for all rays of the packet at once.
+                void TraceRays(const RayPacketT& Packet, TraceResultT* Results) const;
+
                 void TraceBevelBB(const BoundingBox3dT& TraceBB, const Vector3dT& Start, const Vector3dT& Ray, unsigned long ClipMask, TraceResultT& Result) const;
 
 
@@ -107,14 +112,14 @@ namespace cf
 
                 BoundingBox3dT         BB;              ///< The bounding box (of the vertices) of this brush.
                 unsigned long          Contents;        ///< The contents of this brush.
-                mutable unsigned long  CheckCount;      ///< Used in order to avoid processing things twice.
 
-                // Dependent information that is allocated and computed only *on demand*.
+                // Dependent information that is computed by the constructors of the collision model (for generic brushes only),
+                // so that traces never modify a brush and can run concurrently.
                 // The "Hull" prefix is not to be taken literally, we could have used "Unique" as well.
-                mutable unsigned long* HullVerts;       ///< The union of the vertex indices of the sides of this brush (i.e. the unique vertices whose convex hull forms the brush), referring into the m_Vertices list.
-                mutable unsigned long  NrOfHullVerts;   ///< The number of unique vertices (or rather, vertex indices).
-                mutable EdgeT*         HullEdges;       ///< The unique edges of this brush (e.g. edge <A, B> is not stored again as edge <B, A>).
-                mutable unsigned long  NrOfHullEdges;   ///< The number of unique edges (or rather, edge indices).
+                unsigned long*         HullVerts;       ///< The union of the vertex indices of the sides of this brush (i.e. the unique vertices whose convex hull forms the brush), referring into the m_Vertices list.
+                unsigned long          NrOfHullVerts;   ///< The number of unique vertices (or rather, vertex indices).
+                EdgeT*                 HullEdges;       ///< The unique edges of this brush (e.g. edge <A, B> is not stored again as edge <B, A>).
+                unsigned long          NrOfHullEdges;   ///< The number of unique edges (or rather, edge indices).
             };
 
 
@@ -129,7 +134,58 @@ namespace cf
                 const TerrainT*        Terrain;         ///< The pointer to the actual terrain instance this class is referring to. The instances are kept "outside", as they are shared with the graphics world (scene graph).
                 MaterialT*             Material;        ///< The material on the surface of this terrain.
                 BoundingBox3dT         BB;              ///< The bounding box of this terrain.
-                mutable unsigned long  CheckCount;      ///< Used in order to avoid processing things twice.
+            };
+
+
+            /// The set of the polygons, brushes and terrains that a single query (a trace or a contents test)
+            /// has already visited. As these objects are often referenced by several nodes, this makes sure
+            /// that each object is processed only once per query.
+            ///
+            /// Each query has its own set, so that queries can run concurrently in several threads.
+            /// The memory of the sets is recycled from a thread-local pool of generation-stamped arrays,
+            /// so that starting a new query costs (almost) nothing.
+            class VisitedSetT
+            {
+                public:
+
+                /// The constructor. Starts a new, empty set for the objects of the given model.
+                VisitedSetT(const CollisionModelStaticT& Model);
+
+                /// The destructor. Returns the memory of this set to the thread-local pool.
+                ~VisitedSetT();
+
+                /// Inserts the given object into the set.
+                /// @returns true if the object has been inserted, false if it was in the set before (that is, if it has already been visited).
+                bool Insert(const PolygonT*    Poly   ) { return Insert(Poly - &m_Model.m_Polygons[0]); }
+                bool Insert(const BrushT*      Brush  ) { return Insert(m_Model.m_Polygons.Size() + (Brush - &m_Model.m_Brushes[0])); }
+                bool Insert(const TerrainRefT* Terrain) { return Insert(m_Model.m_Polygons.Size() + m_Model.m_Brushes.Size() + (Terrain - &m_Model.m_Terrains[0])); }
+
+
+                private:
+
+                struct ScratchT
+                {
+                    ScratchT() : Stamps(), Generation(0), InUse(false) { }
+
+                    ArrayT<unsigned int> Stamps;        ///< For each object, the generation of the set that has last visited it.
+                    unsigned int         Generation;    ///< The generation of the set that currently uses this scratch memory.
+                    bool                 InUse;         ///< Whether a set currently uses this scratch memory.
+                };
+
+                VisitedSetT(const VisitedSetT&);        ///< Use of the Copy Constructor    is not allowed.
+                void operator = (const VisitedSetT&);   ///< Use of the Assignment Operator is not allowed.
+
+                bool Insert(unsigned long Index)
+                {
+                    unsigned int& Stamp = m_Scratch->Stamps[Index];
+
+                    if (Stamp == m_Scratch->Generation) return false;
+                    Stamp = m_Scratch->Generation;
+                    return true;
+                }
+
+                const CollisionModelStaticT& m_Model;   ///< The model whose objects are in this set.
+                ScratchT*                    m_Scratch; ///< The scratch memory from the thread-local pool that this set is using.
             };
 
 
@@ -189,6 +245,11 @@ namespace cf
                 ///     Trace(Start, End, 0, 1, Params);
                 void Trace(const Vector3dT& A, const Vector3dT& B, double FracA, double FracB, const TraceParamsT& Params) const;
 
+                /// Traces all rays of the given packet together through the tree that is rooted at this node.
+                /// The packet descends into every child that is touched by at least one of its rays, and each object
+                /// is traced with all rays of the packet when it is visited for the first time.
+                void TraceRays(const RayPacketT& Packet, TraceResultT* Results, VisitedSetT& Visited) const;
+
                 /// Recursively inserts the given polygon into the (sub-)tree at and below this node.
                 void Insert(const PolygonT* Poly);
 
@@ -248,6 +309,7 @@ namespace cf
             unsigned long GetContents() const override;
             void SaveToFile(std::ostream& OutFile, SceneGraph::aux::PoolT& Pool) const override;
             void TraceConvexSolid(const TraceSolidT& TraceSolid, const Vector3dT& Start, const Vector3dT& Ray, unsigned long ClipMask, TraceResultT& Result) const override;
+            void TraceRays(unsigned long NumRays, const Vector3dT* Starts, const Vector3dT* Rays, unsigned long ClipMask, TraceResultT* Results) const override;
             unsigned long GetContents(const Vector3dT& Point, double BoxRadius, unsigned long ContMask) const override;
             btCollisionShape* GetBulletAdapter() const override;
 
@@ -257,14 +319,16 @@ namespace cf
             // Forward-declaration of an adapter class that allows the Bullet Physics Library to use this class as a btConcaveShape.
             class BulletAdapterT;
 
-            static unsigned long s_CheckCount;      ///< Used in order to avoid checking things more than once.
-
             CollisionModelStaticT(const CollisionModelStaticT&);    ///< Use of the Copy Constructor    is not allowed.
             void operator = (const CollisionModelStaticT&);         ///< Use of the Assignment Operator is not allowed.
 
             /// Auxiliary method for constructing a CollisionModelStaticT instance (called by the constructors).
             void BuildAxialBSPTree(NodeT* Node, const BoundingBox3dT& NodeBB, const double MIN_NODE_SIZE);
 
+            /// Auxiliary method for constructing a CollisionModelStaticT instance (called by the constructors).
+            /// Computes the HullVerts and HullEdges of all brushes, which are needed for tracing generic brushes.
+            void CacheBrushHulls();
+
             // Memory pools from which we allocate our objects.
             // Memory pools allow the *quick* allocation of unknown many but large quantities of *individual* objects.
             cf::PoolNoFreeT<NodeT>         m_NodesPool;     ///< All the nodes of the orthogonal BSP tree of this model.
@@ -58,14 +58,14 @@ void CollisionModelStaticT::BulletAdapterT::processAllTriangles(btTriangleCallba
 
     if (ProcBB.Intersects(m_CollMdl.m_BB))
     {
-        CollisionModelStaticT::s_CheckCount++;
+        VisitedSetT Visited(m_CollMdl);
 
-        ProcessTriangles(m_CollMdl.m_RootNode, callback, ProcBB);
+        ProcessTriangles(m_CollMdl.m_RootNode, callback, ProcBB, Visited);
     }
 }
 
 
-void CollisionModelStaticT::BulletAdapterT::ProcessTriangles(NodeT* Node, btTriangleCallback* callback, const BoundingBox3dT& ProcBB) const
+void CollisionModelStaticT::BulletAdapterT::ProcessTriangles(NodeT* Node, btTriangleCallback* callback, const BoundingBox3dT& ProcBB, VisitedSetT& Visited) const
 {
     btVector3 Triangle[3];
 
@@ -76,8 +76,7 @@ void CollisionModelStaticT::BulletAdapterT::ProcessTriangles(NodeT* Node, btTria
             const PolygonT* Poly = Node->Polygons[PolyNr];
 
             // Processed this polygon already?
-            if (Poly->CheckCount == s_CheckCount) continue;
-            Poly->CheckCount = s_CheckCount;
+            if (!Visited.Insert(Poly)) continue;
 
             assert(Poly->Parent == &m_CollMdl);
 
@@ -103,8 +102,7 @@ void CollisionModelStaticT::BulletAdapterT::ProcessTriangles(NodeT* Node, btTria
             const BrushT* Brush = Node->Brushes[BrushNr];
 
             // Processed this brush already?
-            if (Brush->CheckCount == s_CheckCount) continue;
-            Brush->CheckCount = s_CheckCount;
+            if (!Visited.Insert(Brush)) continue;
 
             assert(Brush->Parent == &m_CollMdl);
 
@@ -135,8 +133,7 @@ void CollisionModelStaticT::BulletAdapterT::ProcessTriangles(NodeT* Node, btTria
             const TerrainRefT* Terrain = Node->Terrains[TerrainNr];
 
             // Processed this terrain already?
-            if (Terrain->CheckCount == s_CheckCount) continue;
-            Terrain->CheckCount = s_CheckCount;
+            if (!Visited.Insert(Terrain)) continue;
 
             if (!ProcBB.Intersects(Terrain->BB)) continue;
 
@@ -183,7 +180,7 @@ void CollisionModelStaticT::BulletAdapterT::ProcessTriangles(NodeT* Node, btTria
         }
         else
         {
-            ProcessTriangles(Node->Children[1], callback, ProcBB);
+            ProcessTriangles(Node->Children[1], callback, ProcBB, Visited);
             Node = Node->Children[0];
         }
     }
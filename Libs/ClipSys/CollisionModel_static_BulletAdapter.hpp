@@ -45,7 +45,7 @@ namespace cf
 
             btVector3 conv(const Vector3dT& v) const { return btVector3(btScalar(v.x), btScalar(v.y), btScalar(v.z)); }   ///< Inline conversion from Vector3dT to btVector3.
             btVector3 conv(const Vector3fT& v) const { return btVector3(btScalar(v.x), btScalar(v.y), btScalar(v.z)); }   ///< Inline conversion from Vector3fT to btVector3.
-            void      ProcessTriangles(NodeT* Node, btTriangleCallback* callback, const BoundingBox3dT& BB) const;
+            void      ProcessTriangles(NodeT* Node, btTriangleCallback* callback, const BoundingBox3dT& BB, VisitedSetT& Visited) const;
 
             const CollisionModelStaticT& m_CollMdl;     ///< The static collision model (our "parent") we provide an adapter for.
             btVector3                    m_LocalScale;  ///< A member required in order to implement the btCollisionShape interface (this class does not actually support local scaling).
@@ -57,8 +57,11 @@ namespace cf
             /// Opens the file with the given name for reading.
             /// The registered file systems are probed in opposite order in which they have been registered for opening the file.
             /// @param FileName   The name of the file to be opened within one of the previously registered file systems.
+            /// @param Warnings   If non-NULL, warnings are appended to this string rather than printed to the console.
+            ///                   Callers on other threads than the main thread must pass a string here, because the console is not thread-safe.
+            /// This method can be called from several threads concurrently.
             /// @returns The pointer to the file or NULL if the file could not be opened.
-            virtual InFileI* OpenRead(const std::string& FileName)=0;
+            virtual InFileI* OpenRead(const std::string& FileName, std::string* Warnings=NULL)=0;
 
             /// Closes the given file.
             virtual void Close(FileI* File)=0;
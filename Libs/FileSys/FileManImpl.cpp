@@ -28,6 +28,8 @@ FileManImplT::~FileManImplT()
 
 FileSystemT* FileManImplT::MountFileSystem(FileSystemTypeT Type, const std::string& Descr, const std::string& MountPoint, const std::string& Password)
 {
+    std::lock_guard<std::mutex> Lock(Mutex);
+
     try
     {
         switch (Type)
@@ -83,6 +85,8 @@ FileSystemT* FileManImplT::MountFileSystem(FileSystemTypeT Type, const std::stri
 
 void FileManImplT::Unmount(FileSystemT* FileSystem)
 {
+    std::lock_guard<std::mutex> Lock(Mutex);
+
     if (FileSystem==NULL) return;
 
     if (FileSystems.Size()==0)
@@ -111,8 +115,10 @@ void FileManImplT::Unmount(FileSystemT* FileSystem)
 }
 
 
-InFileI* FileManImplT::OpenRead(const std::string& FileName)
+InFileI* FileManImplT::OpenRead(const std::string& FileName, std::string* Warnings)
 {
+    std::lock_guard<std::mutex> Lock(Mutex);
+
     // Try to load the file from the local file system first.
     // This way, the user is not required to register any file system at all before using the file manager,
     // and the behavior is just as expected (principle of "least surprise").
@@ -126,7 +132,7 @@ InFileI* FileManImplT::OpenRead(const std::string& FileName)
     // Now try the registered file systems in turn.
     for (unsigned long FileSysNr=0; FileSysNr<FileSystems.Size(); FileSysNr++)
     {
-        InFileI* InFile=FileSystems[FileSystems.Size()-1-FileSysNr]->OpenRead(FileName);
+        InFileI* InFile=FileSystems[FileSystems.Size()-1-FileSysNr]->OpenRead(FileName, Warnings);
 
         if (InFile!=NULL) return InFile;
     }
@@ -10,6 +10,8 @@ This project is licensed under the terms of the MIT license.
 #include "FileMan.hpp"
 #include "Templates/Array.hpp"
 
+#include <mutex>
+
 
 namespace cf
 {
@@ -30,7 +32,7 @@ namespace cf
             // Implement all the (pure) virtual methods of the FileManI interface.
             FileSystemT* MountFileSystem(FileSystemTypeT Type, const std::string& Descr, const std::string& MountPoint, const std::string& Password="");
             void         Unmount(FileSystemT* FileSystem);
-            InFileI*     OpenRead(const std::string& FileName);
+            InFileI*     OpenRead(const std::string& FileName, std::string* Warnings=NULL);
             void         Close(FileI* File);
 
 
@@ -40,6 +42,7 @@ namespace cf
             void operator = (const FileManImplT&);      ///< Use of the Assignment Operator is not allowed.
 
             ArrayT<FileSystemT*> FileSystems;   ///< The stack of file systems (local paths, archives, ...) where files are loaded from (and saved to).
+            std::mutex           Mutex;         ///< Serializes the access to the file systems, so that files can be opened from several threads (e.g. for loading textures in the background).
         };
     }
 }
@@ -48,8 +48,9 @@ namespace cf
 
             /// Opens the file with the given name for reading.
             /// @param FileName   The name of the file to be opened within this file system.
+            /// @param Warnings   If non-NULL, warnings are appended to this string rather than printed to the console.
             /// @returns The pointer to the file or NULL if the file could not be opened.
-            virtual InFileI* OpenRead(const std::string& FileName)=0;
+            virtual InFileI* OpenRead(const std::string& FileName, std::string* Warnings)=0;
         };
     }
 }
@@ -18,7 +18,7 @@ FileSystemLocalPathT::FileSystemLocalPathT(const std::string& LocalPath_, const
 }
 
 
-InFileI* FileSystemLocalPathT::OpenRead(const std::string& FileName)
+InFileI* FileSystemLocalPathT::OpenRead(const std::string& FileName, std::string* /*Warnings*/)
 {
     // Remove the MountPoint portion from FileName.
     if (FileName.compare(0, MountPointLen, MountPoint)!=0) return NULL;     // See if FileName begins with MountPoint.
@@ -26,7 +26,7 @@ namespace cf
          // ~FileSystemLocalPathT();
 
             // Implement all the (pure) virtual methods of the FileSystemT class.
-            InFileI* OpenRead(const std::string& FileName);
+            InFileI* OpenRead(const std::string& FileName, std::string* Warnings);
 
 
             private:
@@ -65,7 +65,7 @@ FileSystemZipArchiveAST::~FileSystemZipArchiveAST()
 }
 
 
-InFileI* FileSystemZipArchiveAST::OpenRead(const std::string& FileName)
+InFileI* FileSystemZipArchiveAST::OpenRead(const std::string& FileName, std::string* Warnings)
 {
     // Remove the MountPoint portion from FileName.
     if (FileName.compare(0, MountPointLen, MountPoint)!=0) return NULL;     // See if FileName begins with MountPoint.
@@ -108,7 +108,11 @@ InFileI* FileSystemZipArchiveAST::OpenRead(const std::string& FileName)
     }
     catch (CZipException& ZipEx)
     {
-        Console->Warning(ArchiveName+"/"+RelFileName+": "+ZipEx.GetErrorDescription()+"\n");
+        const std::string Msg=ArchiveName+"/"+RelFileName+": "+ZipEx.GetErrorDescription()+"\n";
+
+        if (Warnings!=NULL) *Warnings+=Msg;
+                       else Console->Warning(Msg);
+
         Archive.CloseFile(NULL, true);
         delete InFile;
         return NULL;
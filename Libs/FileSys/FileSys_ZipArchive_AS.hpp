@@ -35,7 +35,7 @@ namespace cf
             ~FileSystemZipArchiveAST();
 
             // Implement all the (pure) virtual methods of the FileSystemT class.
-            InFileI* OpenRead(const std::string& FileName);
+            InFileI* OpenRead(const std::string& FileName, std::string* Warnings);
 
 
             private:
@@ -11,6 +11,14 @@ This project is licensed under the terms of the MIT license.
 using namespace cf::FileSys;
 
 
+// Appends Msg to Warnings, or prints it to the console if Warnings is NULL.
+static void Warning(std::string* Warnings, const std::string& Msg)
+{
+    if (Warnings!=NULL) *Warnings+=Msg;
+                   else Console->Warning(Msg);
+}
+
+
 FileSystemZipArchiveGVT::FileSystemZipArchiveGVT(const std::string& ArchiveName, const std::string& MountPoint, const std::string& Password)
     : m_ArchiveName(ArchiveName),
       m_ArchivePassword(Password),
@@ -68,7 +76,7 @@ FileSystemZipArchiveGVT::~FileSystemZipArchiveGVT()
 }
 
 
-InFileI* FileSystemZipArchiveGVT::OpenRead(const std::string& FileName)
+InFileI* FileSystemZipArchiveGVT::OpenRead(const std::string& FileName, std::string* Warnings)
 {
     // Remove the m_MountPoint portion from FileName.
     if (FileName.compare(0, m_MountPointLen, m_MountPoint)!=0) return NULL;     // Determine if FileName begins with m_MountPoint.
@@ -83,27 +91,27 @@ InFileI* FileSystemZipArchiveGVT::OpenRead(const std::string& FileName)
     std::map<std::string, unz_file_pos>::const_iterator It=m_NameToFilePos.find(RelFileName);
     if (It==m_NameToFilePos.end())
     {
-        Console->Warning(RelFileName+" not found in "+m_ArchiveName+"\n");
+        Warning(Warnings, RelFileName+" not found in "+m_ArchiveName+"\n");
         return NULL;
     }
 
     unz_file_pos FilePos=It->second;
     if (unzGoToFilePos(m_ArchiveHandle, &FilePos)!=UNZ_OK)
     {
-        Console->Warning("unzGoToFilePos() failed for "+RelFileName+" in "+m_ArchiveName+"\n");
+        Warning(Warnings, "unzGoToFilePos() failed for "+RelFileName+" in "+m_ArchiveName+"\n");
         return NULL;
     }
 
     unz_file_info FileInfo;
     if (unzGetCurrentFileInfo(m_ArchiveHandle, &FileInfo, NULL, 0, NULL, 0, NULL, 0)!=UNZ_OK)
     {
-        Console->Warning("Could not get file info for "+RelFileName+" in "+m_ArchiveName+"\n");
+        Warning(Warnings, "Could not get file info for "+RelFileName+" in "+m_ArchiveName+"\n");
         return NULL;
     }
 
     if (unzOpenCurrentFilePassword(m_ArchiveHandle, m_ArchivePassword!="" ? m_ArchivePassword.c_str() : NULL)!=UNZ_OK)
     {
-        Console->Warning("Could not open "+RelFileName+" for reading from "+m_ArchiveName+"\n");
+        Warning(Warnings, "Could not open "+RelFileName+" for reading from "+m_ArchiveName+"\n");
         return NULL;
     }
 
@@ -117,7 +125,7 @@ InFileI* FileSystemZipArchiveGVT::OpenRead(const std::string& FileName)
 
     if (ReadResult!=int(Buffer.Size()))
     {
-        Console->Warning("Couldn't read "+m_ArchiveName+"/"+RelFileName+cf::va(" (%i)", ReadResult)+"\n");
+        Warning(Warnings, "Couldn't read "+m_ArchiveName+"/"+RelFileName+cf::va(" (%i)", ReadResult)+"\n");
         delete InFile;
         InFile=NULL;
     }
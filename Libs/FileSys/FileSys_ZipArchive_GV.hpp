@@ -30,7 +30,7 @@ namespace cf
             ~FileSystemZipArchiveGVT();
 
             // Implement all the (pure) virtual methods of the FileSystemT class.
-            InFileI* OpenRead(const std::string& FileName);
+            InFileI* OpenRead(const std::string& FileName, std::string* Warnings);
 
 
             private:
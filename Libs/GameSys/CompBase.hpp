@@ -83,6 +83,11 @@ namespace cf
             /// providing a simple kind of "reflection" or "type introspection" feature.
             TypeSys::VarManT& GetMemberVars() { return m_MemberVars; }
 
+            /// Returns a number that is renewed whenever the state that Serialize() writes may have changed.
+            /// See TypeSys::VarManT::GetChangeNr() for details. Derived classes that write additional data
+            /// in DoSerialize() call `GetMemberVars().MarkChanged()` whenever that data changes.
+            uint64_t GetChangeNr() const { return m_MemberVars.GetChangeNr(); }
+
             /// Sets the member variable with the given name to the given value.
             /// The purpose of this method is to allow C++ code an easier access to the `m_MemberVars`,
             /// especially when initializing newly created components (e.g. in the Map Editor).
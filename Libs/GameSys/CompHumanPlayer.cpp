@@ -328,6 +328,48 @@ bool ComponentHumanPlayerT::TraceCameraRay(const Vector3dT& Dir, Vector3dT& HitP
 }
 
 
+bool ComponentHumanPlayerT::TraceCameraRays(const ArrayT<Vector3dT>& Dirs, ArrayT<ComponentBaseT*>& HitComps) const
+{
+    if (!GetEntity())
+        return false;
+
+    const Vector3dT   Start = GetCameraOriginWS();
+    ArrayT<Vector3dT> Starts;
+    ArrayT<Vector3dT> Rays;
+
+    for (unsigned int RayNr = 0; RayNr < Dirs.Size(); RayNr++)
+    {
+        Starts.PushBack(Start);
+        Rays.PushBack(Dirs[RayNr] * 9999.0);
+    }
+
+    IntrusivePtrT<ComponentCollisionModelT> IgnoreCollMdl =
+        dynamic_pointer_cast<ComponentCollisionModelT>(GetEntity()->GetComponent("CollisionModel"));
+
+    ArrayT<cf::ClipSys::TraceResultT> Results;
+    ArrayT<cf::ClipSys::ClipModelT*>  HitClipModels;
+
+    Results.PushBackEmptyExact(Dirs.Size());
+    HitClipModels.PushBackEmptyExact(Dirs.Size());
+
+    GetEntity()->GetWorld().GetClipWorld()->TraceRays(
+        Dirs.Size(),
+        &Starts[0],
+        &Rays[0],
+        MaterialT::Clip_BlkButUtils,
+        IgnoreCollMdl != NULL ? IgnoreCollMdl->GetClipModel() : NULL,
+        &Results[0],
+        &HitClipModels[0]);
+
+    HitComps.Overwrite();
+
+    for (unsigned int RayNr = 0; RayNr < Dirs.Size(); RayNr++)
+        HitComps.PushBack(!Results[RayNr].StartSolid && HitClipModels[RayNr] ? HitClipModels[RayNr]->GetOwner() : NULL);
+
+    return true;
+}
+
+
 ComponentHumanPlayerT* ComponentHumanPlayerT::Clone() const
 {
     return new ComponentHumanPlayerT(*this);
@@ -1092,9 +1134,13 @@ static const cf::TypeSys::MethsDocT META_FireRay =
     "scattered (used to simulate inaccurate human aiming) by the given parameter `Random`.\n"
     "If an entity is hit, its TakeDamage() method is called with the human player as the originator and\n"
     "the amount of damage as given by parameter `Damage`.\n"
-    "@param Damage   The damage to inflict to a possibly hit entity.\n"
-    "@param Random   The maximum amount of random scatter to apply to the traced ray.",
-    "", "(number Damage, number Random = 0.0)"
+    "Weapons that fire several pellets at once, such as shotguns, can pass the number of rays in `NumRays`.\n"
+    "Each ray is scattered individually, and the rays are traced together, which is faster than calling\n"
+    "this method once for each of them.\n"
+    "@param Damage    The damage to inflict to a possibly hit entity (per ray).\n"
+    "@param Random    The maximum amount of random scatter to apply to the traced ray.\n"
+    "@param NumRays   The number of rays to trace.",
+    "", "(number Damage, number Random = 0.0, number NumRays = 1)"
 };
 
 int ComponentHumanPlayerT::FireRay(lua_State* LuaState)
@@ -1102,30 +1148,41 @@ int ComponentHumanPlayerT::FireRay(lua_State* LuaState)
     ScriptBinderT Binder(LuaState);
     IntrusivePtrT<ComponentHumanPlayerT> Comp = Binder.GetCheckedObjectParam< IntrusivePtrT<ComponentHumanPlayerT> >(1);
 
-    const float     Damage  = float(luaL_checknumber(LuaState, 2));
-    const double    Random  = lua_tonumber(LuaState, 3);
-    const Vector3dT ViewDir = Comp->GetCameraViewDirWS(Random);
+    const float  Damage  = float(luaL_checknumber(LuaState, 2));
+    const double Random  = lua_tonumber(LuaState, 3);
+    const int    NumRays = luaL_optint(LuaState, 4, 1);
+
+    if (NumRays < 1) return 0;
 
-    Vector3dT       HitPoint;
-    ComponentBaseT* HitComp;
+    ArrayT<Vector3dT>       ViewDirs;
+    ArrayT<ComponentBaseT*> HitComps;
 
-    if (!Comp->TraceCameraRay(ViewDir, HitPoint, HitComp)) return 0;
-    if (!HitComp) return 0;
+    for (int RayNr = 0; RayNr < NumRays; RayNr++)
+        ViewDirs.PushBack(Comp->GetCameraViewDirWS(Random));
 
-    EntityT* OtherEnt = HitComp->GetEntity();
+    if (!Comp->TraceCameraRays(ViewDirs, HitComps)) return 0;
+
+    for (unsigned int RayNr = 0; RayNr < HitComps.Size(); RayNr++)
+    {
+        if (!HitComps[RayNr]) continue;
 
-    if (!OtherEnt) return 0;
+        EntityT* OtherEnt = HitComps[RayNr]->GetEntity();
 
-    IntrusivePtrT<ComponentScriptT> OtherScript =
-        dynamic_pointer_cast<ComponentScriptT>(OtherEnt->GetComponent("Script"));
+        if (!OtherEnt) continue;
 
-    if (OtherScript == NULL) return 0;
+        IntrusivePtrT<ComponentScriptT> OtherScript =
+            dynamic_pointer_cast<ComponentScriptT>(OtherEnt->GetComponent("Script"));
 
-    IntrusivePtrT<EntityT> This = Comp->GetEntity();
-    ScriptBinderT OtherBinder(OtherEnt->GetWorld().GetScriptState().GetLuaState());
+        if (OtherScript == NULL) continue;
+
+        IntrusivePtrT<EntityT> This = Comp->GetEntity();
+        ScriptBinderT OtherBinder(OtherEnt->GetWorld().GetScriptState().GetLuaState());
+        const Vector3dT& ViewDir = ViewDirs[RayNr];
+
+        OtherBinder.Push(This);     // Don't pass the raw `EntityT*` pointer!
+        OtherScript->CallLuaMethod("TakeDamage", 1, "ffff", Damage, ViewDir.x, ViewDir.y, ViewDir.z);
+    }
 
-    OtherBinder.Push(This);     // Don't pass the raw `EntityT*` pointer!
-    OtherScript->CallLuaMethod("TakeDamage", 1, "ffff", Damage, ViewDir.x, ViewDir.y, ViewDir.z);
     return 0;
 }
 
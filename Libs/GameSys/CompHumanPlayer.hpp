@@ -50,6 +50,10 @@ namespace cf
             /// Traces a ray that originates at the player camera's origin in the given direction through the world.
             bool TraceCameraRay(const Vector3dT& Dir, Vector3dT& HitPoint, ComponentBaseT*& HitComp) const;
 
+            /// Like TraceCameraRay(), but traces several rays together, which is faster than tracing them one by one.
+            /// For each ray that hits a component, the component is returned in HitComps, otherwise NULL.
+            bool TraceCameraRays(const ArrayT<Vector3dT>& Dirs, ArrayT<ComponentBaseT*>& HitComps) const;
+
             /// A helper function for Think().
             bool CheckGUIs(const PlayerCommandT& PrevPC, const PlayerCommandT& PC, bool ThinkingOnServerSide) const;
 
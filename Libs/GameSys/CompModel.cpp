@@ -369,6 +369,11 @@ AnimPoseT* ComponentModelT::GetPose() const
         IntrusivePtrT<AnimExprStandardT> StdAE = m_Model->GetAnimExprPool().GetStandard(m_ModelAnimNr.Get(), 0.0f);
 
         m_Pose = new AnimPoseT(*m_Model, StdAE);
+
+        // In the client, share the pose data with the other entities that show the same model in the same pose.
+        // (Elsewhere, the world's model manager has no user that advances the frames of the pose cache.)
+        if (GetEntity() && GetEntity()->GetWorld().GetRealm() == WorldT::RealmClient)
+            m_Pose->SetPoseCache(&GetEntity()->GetWorld().GetModelMan().GetPoseCache());
     }
 
     return m_Pose;
@@ -575,6 +580,17 @@ BoundingBox3fT ComponentModelT::GetCullingBB() const
 }
 
 
+const AnimPoseT* ComponentModelT::PrepareRender(bool FirstPersonView, float LodDist) const
+{
+    if (!m_ModelShow.Get()) return NULL;
+    if (m_Is1stPerson.Get() != FirstPersonView) return NULL;
+    if (m_IsSubmodel.Get()) return NULL;
+    if (!GetPose()) return NULL;
+
+    return GetPose()->PrepareRecache(LodDist);
+}
+
+
 bool ComponentModelT::Render(bool FirstPersonView, float LodDist) const
 {
     if (!m_ModelShow.Get()) return false;
@@ -678,6 +694,10 @@ void ComponentModelT::DoServerFrame(float t)
     if (GetGui() != NULL)
     {
         GetGui()->DistributeClockTickEvents(t);
+
+        // The state of the GUI is serialized in DoSerialize(), but we don't track its changes in detail.
+        // As the GUI's clock ticks in every frame, just assume that its state changes in every frame, too.
+        GetMemberVars().MarkChanged();
     }
 
     // Advance the time of anim expressions on the server-side, too, so that
@@ -41,6 +41,11 @@ namespace cf
             /// Returns the current pose of this model (or `NULL` if there is no pose (yet)).
             AnimPoseT* GetPose() const;
 
+            /// Returns the pose whose data must be computed before this model is rendered with the given parameters,
+            /// or `NULL` if there is nothing to compute. See AnimPoseT::PrepareRecache() for details.
+            /// The pose of a submodel is not prepared, as it depends on the pose of its super model.
+            const AnimPoseT* PrepareRender(bool FirstPersonView, float LodDist) const;
+
             /// Returns the GUI instance of this model, if it has one (or `NULL` otherwise).
             IntrusivePtrT<cf::GuiSys::GuiImplT> GetGui() const;
 
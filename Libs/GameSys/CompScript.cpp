@@ -79,6 +79,7 @@ void ComponentScriptT::PostEvent(unsigned int EventType)
     // script method InitEventTypes() has been called.
     // See `PostEvent(lua_State* LuaState)` below for further details.
     m_EventsCount[EventType - 1]++;
+    GetMemberVars().MarkChanged();   // The event counters are serialized in DoSerialize().
 }
 
 
@@ -223,6 +224,7 @@ int ComponentScriptT::InitEventTypes(lua_State* LuaState)
         Comp->m_EventsRef  [i] = 0;
     }
 
+    Comp->GetMemberVars().MarkChanged();
     return 0;
 }
 
@@ -252,6 +254,7 @@ int ComponentScriptT::PostEvent(lua_State* LuaState)
         luaL_argerror(LuaState, 2, "Unknown event type. Did you use InitEventTypes()?");
 
     Comp->m_EventsCount[EventType - 1]++;
+    Comp->GetMemberVars().MarkChanged();   // The event counters are serialized in DoSerialize().
     return 0;
 }
 
@@ -60,7 +60,8 @@ EntityT::EntityT(const EntityCreateParamsT& Params)
       m_App(NULL),
       m_Basics(new ComponentBasicsT()),
       m_Transform(new ComponentTransformT()),
-      m_Components()
+      m_Components(),
+      m_ChangeNr(cf::TypeSys::VarManT::GetNextChangeNr())
 {
     m_Basics->UpdateDependencies(this);
     m_Transform->UpdateDependencies(this);
@@ -77,7 +78,8 @@ EntityT::EntityT(const EntityT& Entity, bool Recursive)
       m_App(NULL),
       m_Basics(Entity.GetBasics()->Clone()),
       m_Transform(Entity.GetTransform()->Clone()),
-      m_Components()
+      m_Components(),
+      m_ChangeNr(cf::TypeSys::VarManT::GetNextChangeNr())
 {
     // Copy-create all components first.
     if (Entity.GetApp() != NULL)
@@ -393,6 +395,20 @@ BoundingBox3fT EntityT::GetCullingBB(bool WorldSpace) const
 }
 
 
+uint64_t EntityT::GetChangeNr() const
+{
+    uint64_t ChangeNr = std::max(m_ChangeNr, std::max(m_Basics->GetChangeNr(), m_Transform->GetChangeNr()));
+
+    if (m_App != NULL)
+        ChangeNr = std::max(ChangeNr, m_App->GetChangeNr());
+
+    for (unsigned int CompNr = 0; CompNr < m_Components.Size(); CompNr++)
+        ChangeNr = std::max(ChangeNr, m_Components[CompNr]->GetChangeNr());
+
+    return ChangeNr;
+}
+
+
 // Note that this method is the twin of Deserialize(), whose implementation it must match.
 void EntityT::Serialize(cf::Network::OutStreamT& Stream, bool WithChildren) const
 {
@@ -587,6 +603,9 @@ bool EntityT::CallLuaMethod(const char* MethodName, int NumExtraArgs, const char
 
 void EntityT::UpdateAllDependencies()
 {
+    // This is called whenever the set of components has changed.
+    m_ChangeNr = cf::TypeSys::VarManT::GetNextChangeNr();
+
     if (m_App != NULL)
         m_App->UpdateDependencies(this);
 
@@ -225,6 +225,12 @@ namespace cf
             ///   Should the children be recursively serialized as well?
             void Serialize(cf::Network::OutStreamT& Stream, bool WithChildren=false) const;
 
+            /// Returns a number that is renewed whenever the state that Serialize() writes (without the children)
+            /// may have changed, that is, when any component has changed or components have been added or removed.
+            /// As long as the number stays the same, a previously serialized state can be reused instead of
+            /// serializing the entity again. See TypeSys::VarManT::GetChangeNr() for details.
+            uint64_t GetChangeNr() const;
+
             /// Reads the state of this entity from the given stream, and updates the entity accordingly.
             /// This method is called after the state of the entity has been received over the network,
             /// has been loaded from disk, has been read from the clipboard, or must be "reset" for the purpose
@@ -316,6 +322,7 @@ namespace cf
             IntrusivePtrT<ComponentBasicsT>         m_Basics;       ///< The component that defines the name and the "show" flag of this entity.
             IntrusivePtrT<ComponentTransformT>      m_Transform;    ///< The component that defines the position and orientation of this entity.
             ArrayT< IntrusivePtrT<ComponentBaseT> > m_Components;   ///< The components that this entity is composed of.
+            uint64_t                                m_ChangeNr;     ///< Renewed whenever components are added or removed, see GetChangeNr().
         };
     }
 }
@@ -85,6 +85,8 @@ void ComponentInventoryT::DoDeserialize(cf::Network::InStreamT& Stream, bool IsI
         Stream >> ItemName;
         Stream >> m_Items[ItemName];
     }
+
+    GetMemberVars().MarkChanged();
 }
 
 
@@ -135,6 +137,7 @@ int ComponentInventoryT::Set(lua_State* LuaState)
     const int   ItemCount = luaL_checkint(LuaState, 3);
 
     Comp->m_Items[ItemName] = ItemCount;
+    Comp->GetMemberVars().MarkChanged();   // m_Items is serialized in DoSerialize().
     return 0;
 }
 
@@ -161,6 +164,9 @@ int ComponentInventoryT::Add(lua_State* LuaState)
     const char* ItemName  = luaL_checkstring(LuaState, 2);
     const int   ItemCount = Comp->m_Items[ItemName] + luaL_checkint(LuaState, 3);
 
+    // Each of the cases below sets the count of the item in m_Items, which is serialized in DoSerialize().
+    Comp->GetMemberVars().MarkChanged();
+
     if (ItemCount < 0)
     {
         Comp->m_Items[ItemName] = 0;
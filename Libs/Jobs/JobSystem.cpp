@@ -0,0 +1,467 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+#include "JobSystem.hpp"
+#include "Trace.hpp"
+
+#include <cassert>
+#include <stdint.h>
+
+using namespace cf::Jobs;
+
+
+namespace
+{
+    // The job system that the calling thread is a worker of (if any), and the number of its queue.
+    thread_local JobSystemT*  s_WorkerOf = NULL;
+    thread_local unsigned int s_WorkerNr = 0;
+
+    const size_t MIN_SCRATCH_BLOCK_SIZE = 64 * 1024;
+}
+
+
+/************/
+/*** JobT ***/
+/************/
+
+JobT::JobT(const char* Name, const std::function<void ()>& Func)
+    : m_Name(Name),
+      m_Func(Func),
+      m_NumBlockers(1),
+      m_Mutex(),
+      m_Successors(),
+      m_IsDone(false),
+      m_Exception()
+{
+}
+
+
+/*********************/
+/*** ScratchArenaT ***/
+/*********************/
+
+ScratchArenaT::ScratchArenaT()
+    : m_Blocks(),
+      m_BlockNr(0),
+      m_Used(0)
+{
+}
+
+
+ScratchArenaT::~ScratchArenaT()
+{
+    for (unsigned long BlockNr = 0; BlockNr < m_Blocks.Size(); BlockNr++)
+        delete[] m_Blocks[BlockNr].Data;
+}
+
+
+void* ScratchArenaT::Alloc(size_t Size, size_t Align)
+{
+    assert(Align > 0 && (Align & (Align - 1)) == 0);
+
+    while (true)
+    {
+        if (m_BlockNr < m_Blocks.Size())
+        {
+            const BlockT&   Block = m_Blocks[m_BlockNr];
+            const uintptr_t Base  = uintptr_t(Block.Data);
+            const size_t    Start = size_t(((Base + m_Used + Align - 1) & ~uintptr_t(Align - 1)) - Base);
+
+            if (Start + Size <= Block.Size)
+            {
+                m_Used = Start + Size;
+                return Block.Data + Start;
+            }
+
+            // The memory doesn't fit into this block, continue with the next.
+            m_BlockNr++;
+            m_Used = 0;
+            continue;
+        }
+
+        BlockT Block;
+
+        Block.Size = std::max(MIN_SCRATCH_BLOCK_SIZE, Size + Align);
+        if (m_Blocks.Size() > 0) Block.Size = std::max(Block.Size, 2 * m_Blocks[m_Blocks.Size() - 1].Size);
+        Block.Data = new char[Block.Size];
+
+        m_Blocks.PushBack(Block);
+    }
+}
+
+
+ScratchArenaT::MarkT ScratchArenaT::GetMark() const
+{
+    MarkT Mark;
+
+    Mark.BlockNr = m_BlockNr;
+    Mark.Used    = m_Used;
+
+    return Mark;
+}
+
+
+void ScratchArenaT::Release(const MarkT& Mark)
+{
+    m_BlockNr = Mark.BlockNr;
+    m_Used    = Mark.Used;
+}
+
+
+ScratchArenaT& cf::Jobs::GetScratch()
+{
+    static thread_local ScratchArenaT Scratch;
+
+    return Scratch;
+}
+
+
+/******************/
+/*** JobSystemT ***/
+/******************/
+
+JobSystemT::JobSystemT(unsigned int NumThreads)
+    : m_Workers(),
+      m_Queues(),
+      m_NumQueued(0),
+      m_NumWaiting(0),
+      m_SleepMutex(),
+      m_WakeUp(),
+      m_Quit(false),
+      m_Trace(NULL)
+{
+    if (NumThreads == 0) NumThreads = GetNumHardwareThreads();
+
+    StartThreads(NumThreads - 1);
+}
+
+
+JobSystemT::~JobSystemT()
+{
+    StopThreads();
+}
+
+
+void JobSystemT::SetNumThreads(unsigned int NumThreads)
+{
+    if (NumThreads == 0) NumThreads = GetNumHardwareThreads();
+    if (NumThreads == GetNumThreads()) return;
+
+    StopThreads();
+    StartThreads(NumThreads - 1);
+}
+
+
+JobPtrT JobSystemT::Submit(const char* Name, const std::function<void ()>& Func, const ArrayT<JobPtrT>& Dependencies)
+{
+    JobPtrT Job(new JobT(Name, Func));
+
+    // Job->m_NumBlockers is 1 while we are here, so that the job cannot be started by the
+    // completion of one of its dependencies before it has been registered with all of them.
+    for (unsigned long DepNr = 0; DepNr < Dependencies.Size(); DepNr++)
+    {
+        JobT& Dep = *Dependencies[DepNr];
+        std::lock_guard<std::mutex> Lock(Dep.m_Mutex);
+
+        if (Dep.m_IsDone) continue;
+
+        Dep.m_Successors.push_back(Job);
+        Job->m_NumBlockers++;
+    }
+
+    if (--Job->m_NumBlockers == 0)
+        Enqueue(Job);
+
+    return Job;
+}
+
+
+void JobSystemT::Wait(const JobPtrT& Job)
+{
+    while (!Job->IsDone())
+    {
+        JobPtrT Other = TakeJob();
+
+        if (Other)
+        {
+            Run(Other);
+            continue;
+        }
+
+        // There is nothing that we could help with, so sleep until the job is done or another job is queued.
+        // m_NumWaiting must be incremented before Job->m_IsDone is checked, see Run().
+        m_NumWaiting++;
+        {
+            std::unique_lock<std::mutex> Lock(m_SleepMutex);
+
+            while (!Job->IsDone() && m_NumQueued == 0)
+                m_WakeUp.wait(Lock);
+        }
+        m_NumWaiting--;
+    }
+
+    if (Job->m_Exception)
+        std::rethrow_exception(Job->m_Exception);
+}
+
+
+void JobSystemT::ParallelFor(unsigned int Count, const std::function<void (unsigned int)>& Func, const char* Name)
+{
+    if (m_Workers.empty() || Count < 2)
+    {
+        const TraceT::ClockT::time_point Start = TraceT::ClockT::now();
+        std::exception_ptr               Exception;
+
+        // As with several threads, the remaining calls are still made if a call throws.
+        for (unsigned int i = 0; i < Count; i++)
+        {
+            try
+            {
+                Func(i);
+            }
+            catch (...)
+            {
+                if (!Exception)
+                    Exception = std::current_exception();
+            }
+        }
+
+        if (m_Trace && Count > 0)
+            m_Trace->Add(Name, s_WorkerOf == this ? s_WorkerNr + 1 : 0, Start, TraceT::ClockT::now());
+
+        if (Exception)
+            std::rethrow_exception(Exception);
+
+        return;
+    }
+
+    std::atomic<unsigned int> NextIndex(0);
+    std::mutex                ExceptionMutex;
+    std::exception_ptr        Exception;
+
+    const std::function<void ()> RunIterations = [&]()
+    {
+        while (true)
+        {
+            const unsigned int i = NextIndex++;
+
+            if (i >= Count) break;
+
+            try
+            {
+                Func(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> Lock(ExceptionMutex);
+
+                if (!Exception)
+                    Exception = std::current_exception();
+            }
+        }
+    };
+
+    // Start a job for each worker (but not more than there are iterations left for them),
+    // and take part in the work in the calling thread as well.
+    const unsigned int NumJobs = std::min(Count - 1, (unsigned int)m_Workers.size());
+    ArrayT<JobPtrT>    Jobs;
+
+    for (unsigned int JobNr = 0; JobNr < NumJobs; JobNr++)
+        Jobs.PushBack(Submit(Name, RunIterations));
+
+    Run(JobPtrT(new JobT(Name, RunIterations)));
+
+    for (unsigned long JobNr = 0; JobNr < Jobs.Size(); JobNr++)
+        Wait(Jobs[JobNr]);
+
+    if (Exception)
+        std::rethrow_exception(Exception);
+}
+
+
+/*static*/ unsigned int JobSystemT::GetNumHardwareThreads()
+{
+    const unsigned int n = std::thread::hardware_concurrency();
+
+    return n > 0 ? n : 1;
+}
+
+
+void JobSystemT::StartThreads(unsigned int NumWorkers)
+{
+    assert(m_Workers.empty());
+
+    // One queue per worker, plus the shared queue for the jobs that are submitted by other threads.
+    m_Queues.clear();
+
+    for (unsigned int QueueNr = 0; QueueNr < NumWorkers + 1; QueueNr++)
+        m_Queues.push_back(std::unique_ptr<QueueT>(new QueueT));
+
+    for (unsigned int WorkerNr = 0; WorkerNr < NumWorkers; WorkerNr++)
+        m_Workers.push_back(std::thread(&JobSystemT::WorkerMain, this, WorkerNr));
+}
+
+
+void JobSystemT::StopThreads()
+{
+    assert(m_NumQueued == 0);
+
+    {
+        std::lock_guard<std::mutex> Lock(m_SleepMutex);
+        m_Quit = true;
+    }
+
+    m_WakeUp.notify_all();
+
+    for (unsigned int WorkerNr = 0; WorkerNr < m_Workers.size(); WorkerNr++)
+        m_Workers[WorkerNr].join();
+
+    m_Workers.clear();
+    m_Quit = false;
+}
+
+
+void JobSystemT::WorkerMain(unsigned int WorkerNr)
+{
+    s_WorkerOf = this;
+    s_WorkerNr = WorkerNr;
+
+    while (true)
+    {
+        JobPtrT Job = TakeJob();
+
+        if (Job)
+        {
+            Run(Job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> Lock(m_SleepMutex);
+
+        while (!m_Quit && m_NumQueued == 0)
+            m_WakeUp.wait(Lock);
+
+        if (m_Quit) break;
+    }
+
+    s_WorkerOf = NULL;
+}
+
+
+void JobSystemT::Enqueue(const JobPtrT& Job)
+{
+    QueueT& Queue = *m_Queues[s_WorkerOf == this ? s_WorkerNr : m_Queues.size() - 1];
+
+    {
+        std::lock_guard<std::mutex> Lock(Queue.Mutex);
+        Queue.Jobs.push_back(Job);
+    }
+
+    // Increment the counter only after the job has been queued, so that it can be taken by the thread that
+    // is woken up. Locking the mutex makes sure that a thread that is about to sleep doesn't miss the wake-up.
+    m_NumQueued++;
+
+    {
+        std::lock_guard<std::mutex> Lock(m_SleepMutex);
+    }
+
+    m_WakeUp.notify_one();
+}
+
+
+JobPtrT JobSystemT::TakeJob()
+{
+    const size_t NumQueues = m_Queues.size();
+    const size_t Shared    = NumQueues - 1;
+    JobPtrT      Job;
+
+    if (m_NumQueued == 0) return Job;
+
+    // A worker first takes the newest job from its own queue, whose data is most likely still in its cache.
+    if (s_WorkerOf == this)
+    {
+        QueueT& Own = *m_Queues[s_WorkerNr];
+        std::lock_guard<std::mutex> Lock(Own.Mutex);
+
+        if (!Own.Jobs.empty())
+        {
+            Job = Own.Jobs.back();
+            Own.Jobs.pop_back();
+        }
+    }
+
+    // Then the oldest jobs are taken from the shared queue and from the queues of the other workers.
+    const size_t First = s_WorkerOf == this ? s_WorkerNr + 1 : 0;
+
+    for (size_t i = 0; !Job && i < NumQueues; i++)
+    {
+        const size_t QueueNr = i == 0 ? Shared : (First + i - 1) % Shared;
+
+        if (s_WorkerOf == this && QueueNr == s_WorkerNr) continue;
+
+        QueueT& Queue = *m_Queues[QueueNr];
+        std::lock_guard<std::mutex> Lock(Queue.Mutex);
+
+        if (!Queue.Jobs.empty())
+        {
+            Job = Queue.Jobs.front();
+            Queue.Jobs.pop_front();
+        }
+    }
+
+    if (Job) m_NumQueued--;
+    return Job;
+}
+
+
+void JobSystemT::Run(const JobPtrT& Job)
+{
+    ScratchArenaT&                    Scratch = GetScratch();
+    const ScratchArenaT::MarkT        Mark    = Scratch.GetMark();
+    const TraceT::ClockT::time_point  Start   = m_Trace ? TraceT::ClockT::now() : TraceT::ClockT::time_point();
+
+    try
+    {
+        Job->m_Func();
+    }
+    catch (...)
+    {
+        Job->m_Exception = std::current_exception();
+    }
+
+    Scratch.Release(Mark);
+
+    if (m_Trace)
+        m_Trace->Add(Job->m_Name, s_WorkerOf == this ? s_WorkerNr + 1 : 0, Start, TraceT::ClockT::now());
+
+    // Free the resources that the function holds, e.g. in the captures of a lambda.
+    Job->m_Func = nullptr;
+
+    std::vector<JobPtrT> Successors;
+
+    {
+        std::lock_guard<std::mutex> Lock(Job->m_Mutex);
+
+        Job->m_IsDone = true;
+        std::swap(Successors, Job->m_Successors);
+    }
+
+    for (size_t SuccNr = 0; SuccNr < Successors.size(); SuccNr++)
+        if (--Successors[SuccNr]->m_NumBlockers == 0)
+            Enqueue(Successors[SuccNr]);
+
+    // Wake up the threads that wait for a job to complete. As Wait() increments m_NumWaiting before it checks
+    // whether the job is done, and we check m_NumWaiting after the job has been marked as done, either Wait()
+    // sees that the job is done, or we see that there is a waiting thread.
+    if (m_NumWaiting > 0)
+    {
+        {
+            std::lock_guard<std::mutex> Lock(m_SleepMutex);
+        }
+
+        m_WakeUp.notify_all();
+    }
+}
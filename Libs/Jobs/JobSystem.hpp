@@ -0,0 +1,246 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+#ifndef CAFU_JOBS_JOB_SYSTEM_HPP_INCLUDED
+#define CAFU_JOBS_JOB_SYSTEM_HPP_INCLUDED
+
+#include "Templates/Array.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace cf
+{
+    namespace Jobs
+    {
+        class TraceT;
+        class JobT;
+        class JobSystemT;
+
+        typedef std::shared_ptr<JobT> JobPtrT;
+
+
+        /// A job is a function that a JobSystemT runs in one of its threads, as soon as all the jobs that it depends on are done.
+        /// Jobs are created by JobSystemT::Submit() and are referred to by JobPtrTs, which keep them alive as long as needed.
+        class JobT
+        {
+            public:
+
+            /// Returns whether the job has completed, i.e. whether its function has returned or thrown.
+            bool IsDone() const { return m_IsDone; }
+
+
+            private:
+
+            friend class JobSystemT;
+
+            JobT(const char* Name, const std::function<void ()>& Func);
+
+            JobT(const JobT&);                  ///< Use of the Copy Constructor    is not allowed.
+            void operator = (const JobT&);      ///< Use of the Assignment Operator is not allowed.
+
+            const char*               m_Name;           ///< The name of the job, for the trace. Must be a string literal or otherwise outlive the job.
+            std::function<void ()>    m_Func;           ///< The function of the job.
+            std::atomic<unsigned int> m_NumBlockers;    ///< The number of unfinished jobs that this job depends on, plus one while it is being submitted.
+            std::mutex                m_Mutex;          ///< Protects m_Successors and the transition of m_IsDone to true.
+            std::vector<JobPtrT>      m_Successors;     ///< The jobs that depend on this job.
+            std::atomic<bool>         m_IsDone;         ///< Whether the job has completed.
+            std::exception_ptr        m_Exception;      ///< The exception that the function of the job has thrown, if any.
+        };
+
+
+        /// A linear allocator for temporary memory that a job needs while it runs.
+        /// Each thread has its own scratch arena, see GetScratch(), so allocating from it needs no locking.
+        /// The job system resets the arena of a thread to its previous state whenever a job has run in that thread,
+        /// so the memory that a job allocates is valid until the job returns, and must not be freed explicitly.
+        /// Only objects of trivially destructible types should be kept in the arena, as no destructors are run.
+        class ScratchArenaT
+        {
+            public:
+
+            /// The state of an arena that it can be reset to, see GetMark() and Release().
+            struct MarkT
+            {
+                unsigned long BlockNr;
+                size_t        Used;
+            };
+
+
+            /// The constructor.
+            ScratchArenaT();
+
+            /// The destructor.
+            ~ScratchArenaT();
+
+            /// Returns Size bytes of memory that are aligned to Align bytes (a power of two).
+            void* Alloc(size_t Size, size_t Align=16);
+
+            /// Returns memory for Count elements of type T.
+            template<class T> T* AllocArray(size_t Count) { return static_cast<T*>(Alloc(Count*sizeof(T), alignof(T))); }
+
+            /// Returns the current state of the arena.
+            MarkT GetMark() const;
+
+            /// Resets the arena to the given state, making all memory that was allocated after it was obtained available again.
+            void Release(const MarkT& Mark);
+
+
+            private:
+
+            ScratchArenaT(const ScratchArenaT&);        ///< Use of the Copy Constructor    is not allowed.
+            void operator = (const ScratchArenaT&);     ///< Use of the Assignment Operator is not allowed.
+
+            struct BlockT
+            {
+                char*  Data;
+                size_t Size;
+            };
+
+            ArrayT<BlockT> m_Blocks;    ///< The memory blocks of this arena. Blocks are never freed before the arena is destroyed.
+            unsigned long  m_BlockNr;   ///< The block that memory is currently allocated from.
+            size_t         m_Used;      ///< The number of bytes that are used in block m_BlockNr.
+        };
+
+
+        /// Returns the scratch arena of the calling thread.
+        ScratchArenaT& GetScratch();
+
+
+        /// A pool of worker threads that runs jobs, with dependencies between them, and the iterations of parallel loops.
+        ///
+        /// Each worker thread keeps its own queue of jobs: the jobs that it submits are added to and taken from the back of
+        /// the queue, and workers that run out of jobs steal from the front of the queues of the others. Jobs that are
+        /// submitted by other threads go into a shared queue.
+        ///
+        /// The calling thread always takes part in the work: a job system with `n` threads keeps `n - 1` worker threads around,
+        /// and Wait() and ParallelFor() run other jobs while they wait. A job system with a single thread runs all jobs in the
+        /// calling thread, at the time they are waited for.
+        class JobSystemT
+        {
+            public:
+
+            /// The constructor.
+            /// @param NumThreads   The number of threads to use, including the calling thread.
+            ///                     0 means to use one thread per hardware thread.
+            JobSystemT(unsigned int NumThreads=1);
+
+            /// The destructor. Terminates and joins all worker threads.
+            /// All jobs must have been waited for before the job system is destroyed.
+            ~JobSystemT();
+
+            /// Returns the number of threads of this job system, including the calling thread.
+            unsigned int GetNumThreads() const { return (unsigned int)m_Workers.size() + 1; }
+
+            /// Sets the number of threads of this job system, including the calling thread.
+            /// 0 means to use one thread per hardware thread.
+            /// Must not be called while jobs are pending or running.
+            void SetNumThreads(unsigned int NumThreads);
+
+            /// Sets the trace that the timings of all jobs are recorded in, or NULL to record no timings.
+            /// The trace must outlive the job system or be reset before it is destroyed.
+            void SetTrace(TraceT* Trace) { m_Trace = Trace; }
+
+            /// Creates a new job that runs Func as soon as all the given jobs are done.
+            /// @param Name           The name of the job in the trace. Must be a string literal or otherwise outlive the job.
+            /// @param Func           The function that the job runs.
+            /// @param Dependencies   The jobs that must be done before the new job can run.
+            JobPtrT Submit(const char* Name, const std::function<void ()>& Func, const ArrayT<JobPtrT>& Dependencies=ArrayT<JobPtrT>());
+
+            /// Returns when the given job is done, running other jobs in the calling thread in the meanwhile.
+            /// If the function of the job has thrown an exception, it is re-thrown here.
+            void Wait(const JobPtrT& Job);
+
+            /// Calls `Func(i)` for each `i` in `[0, Count)`, distributing the calls over all threads
+            /// of the job system, and returns when all calls have completed.
+            /// `Func` must be safe to be called concurrently for different `i`.
+            /// If a call throws an exception, the remaining calls are still made, and the first
+            /// exception is re-thrown in the calling thread.
+            /// ParallelFor() can also be called from within jobs, including from the iterations of other loops.
+            void ParallelFor(unsigned int Count, const std::function<void (unsigned int)>& Func, const char* Name="ParallelFor");
+
+            /// Returns the number of hardware threads of this system (at least 1).
+            static unsigned int GetNumHardwareThreads();
+
+
+            private:
+
+            JobSystemT(const JobSystemT&);          ///< Use of the Copy Constructor    is not allowed.
+            void operator = (const JobSystemT&);    ///< Use of the Assignment Operator is not allowed.
+
+            /// The queue of jobs of a worker thread.
+            struct QueueT
+            {
+                std::mutex          Mutex;
+                std::deque<JobPtrT> Jobs;
+            };
+
+            void    StartThreads(unsigned int NumWorkers);
+            void    StopThreads();
+            void    WorkerMain(unsigned int WorkerNr);
+            void    Enqueue(const JobPtrT& Job);
+            JobPtrT TakeJob();
+            void    Run(const JobPtrT& Job);
+
+            std::vector<std::thread>                m_Workers;      ///< The worker threads.
+            std::vector< std::unique_ptr<QueueT> >  m_Queues;       ///< The queues of the worker threads, and (as the last element) the shared queue.
+            std::atomic<unsigned int>               m_NumQueued;    ///< The number of jobs in the queues.
+            std::atomic<unsigned int>               m_NumWaiting;   ///< The number of threads that are blocked in Wait().
+            std::mutex                              m_SleepMutex;   ///< Protects the sleeping on m_WakeUp.
+            std::condition_variable                 m_WakeUp;       ///< Signals that a job has been queued or completed, or that the workers should quit.
+            bool                                    m_Quit;         ///< Tells the workers to terminate.
+            TraceT*                                 m_Trace;        ///< The trace that the timings of the jobs are recorded in, if any.
+        };
+
+
+        /// Calls `Func(Array[i], i)` for each element of the given array, distributing the calls over all threads of the job system.
+        template<class T, class FuncT>
+        void ParallelFor(JobSystemT& Jobs, ArrayT<T>& Array, const FuncT& Func, const char* Name="ParallelFor")
+        {
+            Jobs.ParallelFor((unsigned int)Array.Size(), [&Array, &Func](unsigned int i) { Func(Array[i], i); }, Name);
+        }
+
+        /// Combines `Map(Array[i])` of all elements of the given array with `Combine`, distributing the work over all threads of the job system.
+        /// The array is split into chunks of GrainSize elements. The elements of each chunk are combined in order, starting with
+        /// Identity, and the results of the chunks are then combined in order as well. Thus, the result is the same for any number
+        /// of threads, even if Combine is not associative (like floating-point addition).
+        template<class T, class ResultT, class MapT, class CombineT>
+        ResultT ParallelReduce(JobSystemT& Jobs, const ArrayT<T>& Array, const ResultT& Identity, const MapT& Map, const CombineT& Combine,
+                               unsigned long GrainSize=256, const char* Name="ParallelReduce")
+        {
+            if (GrainSize == 0) GrainSize = 1;
+
+            const unsigned long  NumChunks = (Array.Size() + GrainSize - 1) / GrainSize;
+            std::vector<ResultT> Results(NumChunks, Identity);
+
+            Jobs.ParallelFor((unsigned int)NumChunks, [&](unsigned int ChunkNr)
+            {
+                const unsigned long End = std::min((ChunkNr + 1) * GrainSize, Array.Size());
+                ResultT& Result = Results[ChunkNr];
+
+                for (unsigned long i = ChunkNr * GrainSize; i < End; i++)
+                    Result = Combine(Result, Map(Array[i]));
+            }, Name);
+
+            ResultT Result = Identity;
+
+            for (unsigned long ChunkNr = 0; ChunkNr < NumChunks; ChunkNr++)
+                Result = Combine(Result, Results[ChunkNr]);
+
+            return Result;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+#include "Trace.hpp"
+
+#include <stdio.h>
+
+using namespace cf::Jobs;
+
+
+TraceT::TraceT()
+    : m_Origin(ClockT::now()),
+      m_Mutex(),
+      m_Events()
+{
+}
+
+
+void TraceT::Add(const char* Name, unsigned int ThreadNr, const ClockT::time_point& Start, const ClockT::time_point& End)
+{
+    EventT Event;
+
+    Event.Name     = Name;
+    Event.ThreadNr = ThreadNr;
+    Event.Start    = std::chrono::duration<double, std::micro>(Start - m_Origin).count();
+    Event.Duration = std::chrono::duration<double, std::micro>(End - Start).count();
+
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_Events.push_back(Event);
+}
+
+
+unsigned long TraceT::GetNumEvents() const
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+
+    return (unsigned long)m_Events.size();
+}
+
+
+bool TraceT::Save(const std::string& FileName) const
+{
+    FILE* File = fopen(FileName.c_str(), "w");
+
+    if (!File) return false;
+
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+
+    fprintf(File, "{\"traceEvents\":[\n");
+
+    for (size_t EventNr = 0; EventNr < m_Events.size(); EventNr++)
+    {
+        const EventT& Event = m_Events[EventNr];
+        std::string   Name;
+
+        for (const char* c = Event.Name; *c; c++)
+        {
+            if (*c == '"' || *c == '\\') Name += '\\';
+            if ((unsigned char)*c >= 0x20) Name += *c;
+        }
+
+        fprintf(File, "{\"name\":\"%s\",\"cat\":\"job\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}%s\n",
+            Name.c_str(), Event.Start, Event.Duration, Event.ThreadNr, EventNr + 1 < m_Events.size() ? "," : "");
+    }
+
+    fprintf(File, "]}\n");
+
+    const bool Ok = !ferror(File);
+
+    return fclose(File) == 0 && Ok;
+}
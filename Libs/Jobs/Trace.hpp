@@ -0,0 +1,66 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+#ifndef CAFU_JOBS_TRACE_HPP_INCLUDED
+#define CAFU_JOBS_TRACE_HPP_INCLUDED
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace cf
+{
+    namespace Jobs
+    {
+        /// A trace records when and in which thread the jobs of a JobSystemT have run.
+        /// It can be saved as a JSON file in the "Trace Event Format" that is understood by the Chrome browser
+        /// (open `chrome://tracing` and load the file), so that the timings of all jobs can be inspected visually.
+        class TraceT
+        {
+            public:
+
+            typedef std::chrono::steady_clock ClockT;
+
+
+            /// The constructor. The times of all events are relative to the time of the construction of the trace.
+            TraceT();
+
+            /// Records that the job with the given name has run from Start to End in the thread with the given number.
+            /// This method is thread-safe.
+            /// @param Name       The name of the job. Must be a string literal or otherwise outlive the trace.
+            /// @param ThreadNr   The number of the thread: 0 for the threads that are not workers of a job system, 1 and up for the workers.
+            /// @param Start      The time at which the job was started.
+            /// @param End        The time at which the job was completed.
+            void Add(const char* Name, unsigned int ThreadNr, const ClockT::time_point& Start, const ClockT::time_point& End);
+
+            /// Returns the number of recorded events.
+            unsigned long GetNumEvents() const;
+
+            /// Saves the trace to the file with the given name.
+            /// @returns true on success, false otherwise.
+            bool Save(const std::string& FileName) const;
+
+
+            private:
+
+            struct EventT
+            {
+                const char*  Name;
+                unsigned int ThreadNr;
+                double       Start;     ///< In microseconds since m_Origin.
+                double       Duration;  ///< In microseconds.
+            };
+
+            const ClockT::time_point m_Origin;  ///< The time at which the trace was started.
+            mutable std::mutex       m_Mutex;   ///< Protects m_Events.
+            std::vector<EventT>      m_Events;  ///< The recorded events.
+        };
+    }
+}
+
+#endif
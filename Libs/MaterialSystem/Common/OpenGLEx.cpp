@@ -27,6 +27,7 @@ This project is licensed under the terms of the MIT license.
 bool cf::GL_ARB_multitexture_AVAIL               =false;
 bool cf::GL_ARB_texture_cube_map_AVAIL           =false;
 bool cf::GL_ARB_texture_compression_AVAIL        =false;
+bool cf::GL_EXT_texture_compression_s3tc_AVAIL   =false;
 bool cf::GL_ATI_Radeon8500Shaders_AVAIL          =false;
 bool cf::GL_EXT_stencil_wrap_AVAIL               =false;
 bool cf::GL_EXT_stencil_two_side_AVAIL           =false;
@@ -167,6 +168,13 @@ void cf::Init_GL_ARB_texture_compression()
 }
 
 
+void cf::Init_GL_EXT_texture_compression_s3tc()
+{
+    // The DXT formats are uploaded with glCompressedTexImage2DARB(), so GL_ARB_texture_compression must be available, too.
+    cf::GL_EXT_texture_compression_s3tc_AVAIL=cf::GL_ARB_texture_compression_AVAIL && IsExtensionAvailable("GL_EXT_texture_compression_s3tc");
+}
+
+
 PFNGLGENFRAGMENTSHADERSATIPROC        cf::glGenFragmentShadersATI       =NULL;  // Extension "GL_ATI_fragment_shader"
 PFNGLBINDFRAGMENTSHADERATIPROC        cf::glBindFragmentShaderATI       =NULL;
 PFNGLDELETEFRAGMENTSHADERATIPROC      cf::glDeleteFragmentShaderATI     =NULL;
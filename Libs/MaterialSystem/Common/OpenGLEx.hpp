@@ -36,6 +36,7 @@ namespace cf
     extern bool GL_ARB_multitexture_AVAIL;
     extern bool GL_ARB_texture_cube_map_AVAIL;
     extern bool GL_ARB_texture_compression_AVAIL;
+    extern bool GL_EXT_texture_compression_s3tc_AVAIL;
     extern bool GL_ATI_Radeon8500Shaders_AVAIL;
     extern bool GL_EXT_stencil_wrap_AVAIL;
     extern bool GL_EXT_stencil_two_side_AVAIL;
@@ -45,6 +46,7 @@ namespace cf
     void Init_GL_ARB_multitexture();
     void Init_GL_ARB_texture_cube_map();
     void Init_GL_ARB_texture_compression();
+    void Init_GL_EXT_texture_compression_s3tc();
     void Init_ATI_Radeon8500Shaders();
     void Init_GL_EXT_stencil_wrap();
     void Init_GL_EXT_stencil_two_side();
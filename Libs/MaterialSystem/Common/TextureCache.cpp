@@ -0,0 +1,520 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/*********************/
+/*** Texture Cache ***/
+/*********************/
+
+#include "TextureCache.hpp"
+#include "TextureLoader.hpp"
+#include "Bitmap/Bitmap.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+
+/*
+ * A texture cache file consists of a header, the key, and the mipmap chains of the images:
+ *
+ *   - the header is the string "CAFUTEXC", followed by the uint16 file version, the uint16 format,
+ *     the uint16 number of images, two reserved bytes, the uint32 width and height of the first image
+ *     before it was scaled, and the uint32 length of the key,
+ *   - the key is stored as plain characters (without a terminating zero),
+ *   - for each image, the uint32 number of its levels is followed by the levels, largest first,
+ *     where each level is the uint32 width, height and data size, followed by the data.
+ *
+ * All values are stored in little-endian byte order.
+ */
+namespace
+{
+    const char           CACHE_FILE_MAGIC[8] = { 'C', 'A', 'F', 'U', 'T', 'E', 'X', 'C' };
+    const unsigned short CACHE_FILE_VERSION  = 2;     // Version 2: The color end points follow the correlation of the channels.
+
+
+    template<class T> void Write(std::ostream& OutFile, T Value)
+    {
+        OutFile.write((const char*)&Value, sizeof(Value));
+    }
+
+
+    template<class T> T Read(std::istream& InFile)
+    {
+        T Value = 0;
+
+        InFile.read((char*)&Value, sizeof(Value));
+        return Value;
+    }
+
+
+    // Reads the header of the cache file and checks it against the given key.
+    bool ReadHeader(std::istream& InFile, const std::string& Key, unsigned short& Format, unsigned short& NumImages, unsigned int& SizeX, unsigned int& SizeY)
+    {
+        char Magic[8];
+
+        InFile.read(Magic, 8);
+        if (!InFile.good() || memcmp(Magic, CACHE_FILE_MAGIC, 8) != 0) return false;
+        if (Read<uint16_t>(InFile) != CACHE_FILE_VERSION) return false;
+
+        Format    = Read<uint16_t>(InFile);
+        NumImages = Read<uint16_t>(InFile);
+        Read<uint16_t>(InFile);
+        SizeX     = Read<uint32_t>(InFile);
+        SizeY     = Read<uint32_t>(InFile);
+
+        if (Format > TextureCacheT::DXT5) return false;
+        if (Read<uint32_t>(InFile) != Key.length()) return false;
+
+        std::string FileKey(Key.length(), ' ');
+
+        if (Key.length() > 0) InFile.read(&FileKey[0], Key.length());
+        return InFile.good() && FileKey == Key;
+    }
+
+
+    // The 64-bit FNV-1a hash of the given string.
+    uint64_t GetHash(const std::string& s)
+    {
+        uint64_t Hash = 14695981039346656037ull;
+
+        for (size_t i = 0; i < s.length(); i++)
+        {
+            Hash ^= (unsigned char)s[i];
+            Hash *= 1099511628211ull;
+        }
+
+        return Hash;
+    }
+
+
+    unsigned int ToRGB565(const unsigned char* c)
+    {
+        return ((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3);
+    }
+
+
+    void FromRGB565(unsigned int c565, int* c)
+    {
+        const int r = (c565 >> 11) & 0x1F;
+        const int g = (c565 >>  5) & 0x3F;
+        const int b =  c565        & 0x1F;
+
+        c[0] = (r << 3) | (r >> 2);
+        c[1] = (g << 2) | (g >> 4);
+        c[2] = (b << 3) | (b >> 2);
+    }
+
+
+    // Writes the eight bytes of the color part of a DXT1 or DXT5 block, always in four-color mode.
+    // The end points are the ends of a diagonal of the bounding box of the colors, inset by 1/16 of its size.
+    // Of the four diagonals of the box, the one that matches the correlation of the color channels is used.
+    void CompressColorBlock(const unsigned char* Pixels, unsigned char* Block)
+    {
+        unsigned char Min[3] = { 255, 255, 255 };
+        unsigned char Max[3] = {   0,   0,   0 };
+        int           Sum[3] = {   0,   0,   0 };
+
+        for (unsigned int i = 0; i < 16; i++)
+            for (unsigned int c = 0; c < 3; c++)
+            {
+                Min[c] = std::min(Min[c], Pixels[i*4 + c]);
+                Max[c] = std::max(Max[c], Pixels[i*4 + c]);
+                Sum[c] += Pixels[i*4 + c];
+            }
+
+        for (unsigned int c = 0; c < 3; c++)
+        {
+            const unsigned char Inset = (Max[c] - Min[c]) >> 4;
+
+            Min[c] += Inset;
+            Max[c] -= Inset;
+        }
+
+        // The channel with the largest range is the reference. If another channel decreases where the reference
+        // increases (i.e. their covariance is negative), its end point values are swapped.
+        unsigned int Ref = 0;
+
+        for (unsigned int c = 1; c < 3; c++)
+            if (Max[c] - Min[c] > Max[Ref] - Min[Ref]) Ref = c;
+
+        for (unsigned int c = 0; c < 3; c++)
+        {
+            if (c == Ref) continue;
+
+            int Cov = 0;
+
+            for (unsigned int i = 0; i < 16; i++)
+                Cov += (16*Pixels[i*4 + c] - Sum[c]) * (16*Pixels[i*4 + Ref] - Sum[Ref]) / 256;
+
+            if (Cov < 0) std::swap(Min[c], Max[c]);
+        }
+
+        unsigned int c0 = ToRGB565(Max);
+        unsigned int c1 = ToRGB565(Min);
+
+        // The four-color mode requires c0 > c1.
+        if (c0 < c1) std::swap(c0, c1);
+
+        int Palette[4][3];
+
+        FromRGB565(c0, Palette[0]);
+        FromRGB565(c1, Palette[1]);
+
+        for (unsigned int c = 0; c < 3; c++)
+        {
+            Palette[2][c] = (2*Palette[0][c] +   Palette[1][c]) / 3;
+            Palette[3][c] = (  Palette[0][c] + 2*Palette[1][c]) / 3;
+        }
+
+        uint32_t Indices = 0;
+
+        // If c0 == c1, the block is in three-color mode, but all indices are 0 then.
+        if (c0 != c1)
+        {
+            for (unsigned int i = 0; i < 16; i++)
+            {
+                unsigned int BestIndex = 0;
+                int          BestDist  = std::numeric_limits<int>::max();
+
+                for (unsigned int Index = 0; Index < 4; Index++)
+                {
+                    const int dr = Pixels[i*4 + 0] - Palette[Index][0];
+                    const int dg = Pixels[i*4 + 1] - Palette[Index][1];
+                    const int db = Pixels[i*4 + 2] - Palette[Index][2];
+                    const int Dist = dr*dr + dg*dg + db*db;
+
+                    if (Dist < BestDist) { BestDist = Dist; BestIndex = Index; }
+                }
+
+                Indices |= BestIndex << (2*i);
+            }
+        }
+
+        Block[0] = (unsigned char)(c0 & 0xFF);
+        Block[1] = (unsigned char)(c0 >> 8);
+        Block[2] = (unsigned char)(c1 & 0xFF);
+        Block[3] = (unsigned char)(c1 >> 8);
+        Block[4] = (unsigned char)( Indices        & 0xFF);
+        Block[5] = (unsigned char)((Indices >>  8) & 0xFF);
+        Block[6] = (unsigned char)((Indices >> 16) & 0xFF);
+        Block[7] = (unsigned char)( Indices >> 24);
+    }
+
+
+    // Writes the eight bytes of the alpha part of a DXT5 block, always in eight-alpha mode.
+    void CompressAlphaBlock(const unsigned char* Pixels, unsigned char* Block)
+    {
+        int a0 = 0;
+        int a1 = 255;
+
+        for (unsigned int i = 0; i < 16; i++)
+        {
+            a0 = std::max(a0, int(Pixels[i*4 + 3]));
+            a1 = std::min(a1, int(Pixels[i*4 + 3]));
+        }
+
+        int Palette[8] = { a0, a1 };
+
+        for (int Index = 2; Index < 8; Index++)
+            Palette[Index] = ((8-Index)*a0 + (Index-1)*a1) / 7;
+
+        uint64_t Indices = 0;
+
+        // If a0 == a1, the block is in six-alpha mode, but all indices are 0 then.
+        if (a0 != a1)
+        {
+            for (unsigned int i = 0; i < 16; i++)
+            {
+                unsigned int BestIndex = 0;
+                int          BestDist  = 256;
+
+                for (unsigned int Index = 0; Index < 8; Index++)
+                {
+                    const int Dist = std::abs(Pixels[i*4 + 3] - Palette[Index]);
+
+                    if (Dist < BestDist) { BestDist = Dist; BestIndex = Index; }
+                }
+
+                Indices |= uint64_t(BestIndex) << (3*i);
+            }
+        }
+
+        Block[0] = (unsigned char)a0;
+        Block[1] = (unsigned char)a1;
+
+        for (unsigned int i = 0; i < 6; i++)
+            Block[2 + i] = (unsigned char)((Indices >> (8*i)) & 0xFF);
+    }
+}
+
+
+TextureCacheT::TextureCacheT()
+    : m_Key(),
+      m_Format(RGBA),
+      m_SizeX(0),
+      m_SizeY(0),
+      m_MipMaps()
+{
+}
+
+
+/*static*/ std::string TextureCacheT::GetKey(const ArrayT<MapCompositionT>& Images)
+{
+    std::ostringstream  Key;
+    ArrayT<std::string> SourceFiles;
+
+    for (unsigned long ImageNr = 0; ImageNr < Images.Size(); ImageNr++)
+    {
+        Key << Images[ImageNr].GetBaseDir() << "|" << Images[ImageNr].GetString() << "\n";
+        Images[ImageNr].GetSourceFiles(SourceFiles);
+    }
+
+    // Images without any source files (e.g. empty ones) are not worth caching.
+    if (SourceFiles.Size() == 0) return "";
+
+    for (unsigned long FileNr = 0; FileNr < SourceFiles.Size(); FileNr++)
+    {
+        struct stat FileStat;
+
+        if (stat(SourceFiles[FileNr].c_str(), &FileStat) != 0) return "";
+        if ((FileStat.st_mode & S_IFMT) != S_IFREG) return "";
+
+        Key << SourceFiles[FileNr] << "|" << (unsigned long long)FileStat.st_size << "|" << (long long)FileStat.st_mtime << "\n";
+    }
+
+    return Key.str();
+}
+
+
+/*static*/ std::string TextureCacheT::GetFileName(const ArrayT<MapCompositionT>& Images, const std::string& Key)
+{
+    char Hash[20];
+
+    sprintf(Hash, "%016llx", (unsigned long long)GetHash(Key));
+
+    return Images[0].GetBaseDir() + "TexCache/" + Hash + ".ctex";
+}
+
+
+/*static*/ bool TextureCacheT::IsUpToDate(const std::string& FileName, const std::string& Key)
+{
+    std::ifstream  InFile(FileName.c_str(), std::ios::in | std::ios::binary);
+    unsigned short Format;
+    unsigned short NumImages;
+    unsigned int   SizeX;
+    unsigned int   SizeY;
+
+    return InFile.is_open() && ReadHeader(InFile, Key, Format, NumImages, SizeX, SizeY);
+}
+
+
+bool TextureCacheT::Load(const std::string& FileName, const std::string& Key, unsigned long MaxSize, bool NoScaleDown, bool MipMaps)
+{
+    std::ifstream  InFile(FileName.c_str(), std::ios::in | std::ios::binary);
+    unsigned short Format;
+    unsigned short NumImages;
+
+    m_MipMaps.Clear();
+
+    if (!InFile.is_open()) return false;
+    if (!ReadHeader(InFile, Key, Format, NumImages, m_SizeX, m_SizeY)) return false;
+
+    m_Key    = Key;
+    m_Format = FormatT(Format);
+
+    for (unsigned long ImageNr = 0; ImageNr < NumImages; ImageNr++)
+    {
+        const unsigned long NumLevels = Read<uint32_t>(InFile);
+
+        if (!InFile.good() || NumLevels == 0 || NumLevels > 32) return false;
+        m_MipMaps.PushBackEmpty();
+
+        for (unsigned long LevelNr = 0; LevelNr < NumLevels; LevelNr++)
+        {
+            const unsigned int  SizeX    = Read<uint32_t>(InFile);
+            const unsigned int  SizeY    = Read<uint32_t>(InFile);
+            const unsigned long DataSize = Read<uint32_t>(InFile);
+
+            if (!InFile.good() || SizeX == 0 || SizeY == 0 || SizeX > 65536 || SizeY > 65536) return false;
+            if (DataSize != GetDataSize(m_Format, SizeX, SizeY)) return false;
+
+            // Skip the levels that the image would have been scaled down from (see TextureLoadJobT::MakeMipMaps()),
+            // and all levels after the first if no mipmaps are wanted.
+            const bool IsAboveMaxSize = !NoScaleDown && SizeX > 1 && SizeY > 1 && SizeX > MaxSize && SizeY > MaxSize && LevelNr+1 < NumLevels;
+            const bool IsUnwanted     = !MipMaps && m_MipMaps[ImageNr].Size() > 0;
+
+            if (IsAboveMaxSize || IsUnwanted)
+            {
+                InFile.seekg(DataSize, std::ios::cur);
+                continue;
+            }
+
+            m_MipMaps[ImageNr].PushBackEmpty();
+
+            LevelT& Level = m_MipMaps[ImageNr][m_MipMaps[ImageNr].Size()-1];
+
+            Level.SizeX = SizeX;
+            Level.SizeY = SizeY;
+            Level.Data.PushBackEmptyExact(DataSize);
+
+            InFile.read((char*)&Level.Data[0], DataSize);
+        }
+    }
+
+    if (!InFile.good())
+    {
+        m_MipMaps.Clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+void TextureCacheT::Build(const ArrayT<MapCompositionT>& Images, const std::string& Key, bool Compress, std::string* Warnings)
+{
+    ArrayT< ArrayT<BitmapT*> > Bitmaps;
+    bool                       IsOpaque = true;
+
+    m_Key = Key;
+    m_MipMaps.Clear();
+
+    for (unsigned long ImageNr = 0; ImageNr < Images.Size(); ImageNr++)
+    {
+        BitmapT* Bitmap = Images[ImageNr].GetBitmap(Warnings);
+
+        if (ImageNr == 0)
+        {
+            m_SizeX = Bitmap->SizeX;
+            m_SizeY = Bitmap->SizeY;
+        }
+
+        Bitmaps.PushBackEmpty();
+        TextureLoadJobT::MakeMipMaps(Bitmap, std::numeric_limits<unsigned long>::max(), true, true, Bitmaps[ImageNr]);
+
+        const unsigned char* Pixels = (const unsigned char*)&Bitmap->Data[0];
+
+        for (unsigned long i = 0; i < Bitmap->Data.Size() && IsOpaque; i++)
+            if (Pixels[i*4 + 3] != 255) IsOpaque = false;
+    }
+
+    m_Format = !Compress ? RGBA : (IsOpaque ? DXT1 : DXT5);
+
+    for (unsigned long ImageNr = 0; ImageNr < Bitmaps.Size(); ImageNr++)
+    {
+        m_MipMaps.PushBackEmpty();
+
+        for (unsigned long LevelNr = 0; LevelNr < Bitmaps[ImageNr].Size(); LevelNr++)
+        {
+            const BitmapT*       Bitmap = Bitmaps[ImageNr][LevelNr];
+            const unsigned char* Pixels = (const unsigned char*)&Bitmap->Data[0];
+
+            m_MipMaps[ImageNr].PushBackEmpty();
+
+            LevelT& Level = m_MipMaps[ImageNr][LevelNr];
+
+            Level.SizeX = Bitmap->SizeX;
+            Level.SizeY = Bitmap->SizeY;
+
+            if (m_Format == RGBA)
+            {
+                Level.Data.PushBack(Pixels, Bitmap->Data.Size()*4);
+            }
+            else
+            {
+                const unsigned long BlockSize = m_Format == DXT1 ? 8 : 16;
+                unsigned char       Block[16*4];
+
+                Level.Data.PushBackEmptyExact(GetDataSize(m_Format, Level.SizeX, Level.SizeY));
+
+                for (unsigned int by = 0; by < (Level.SizeY+3)/4; by++)
+                    for (unsigned int bx = 0; bx < (Level.SizeX+3)/4; bx++)
+                    {
+                        // Levels that are smaller than a block repeat their last row and column.
+                        for (unsigned int y = 0; y < 4; y++)
+                            for (unsigned int x = 0; x < 4; x++)
+                            {
+                                const unsigned int px = std::min(bx*4 + x, Level.SizeX-1);
+                                const unsigned int py = std::min(by*4 + y, Level.SizeY-1);
+
+                                memcpy(&Block[(y*4 + x)*4], &Pixels[(py*Level.SizeX + px)*4], 4);
+                            }
+
+                        CompressBlock(Block, m_Format, &Level.Data[(by*((Level.SizeX+3)/4) + bx)*BlockSize]);
+                    }
+            }
+
+            delete Bitmaps[ImageNr][LevelNr];
+        }
+    }
+}
+
+
+bool TextureCacheT::Save(const std::string& FileName) const
+{
+    std::ofstream OutFile(FileName.c_str(), std::ios::out | std::ios::binary);
+
+    if (!OutFile.is_open()) return false;
+
+    OutFile.write(CACHE_FILE_MAGIC, 8);
+    Write<uint16_t>(OutFile, CACHE_FILE_VERSION);
+    Write<uint16_t>(OutFile, uint16_t(m_Format));
+    Write<uint16_t>(OutFile, uint16_t(m_MipMaps.Size()));
+    Write<uint16_t>(OutFile, 0);
+    Write<uint32_t>(OutFile, m_SizeX);
+    Write<uint32_t>(OutFile, m_SizeY);
+    Write<uint32_t>(OutFile, uint32_t(m_Key.length()));
+    OutFile.write(m_Key.c_str(), m_Key.length());
+
+    for (unsigned long ImageNr = 0; ImageNr < m_MipMaps.Size(); ImageNr++)
+    {
+        Write<uint32_t>(OutFile, uint32_t(m_MipMaps[ImageNr].Size()));
+
+        for (unsigned long LevelNr = 0; LevelNr < m_MipMaps[ImageNr].Size(); LevelNr++)
+        {
+            const LevelT& Level = m_MipMaps[ImageNr][LevelNr];
+
+            Write<uint32_t>(OutFile, Level.SizeX);
+            Write<uint32_t>(OutFile, Level.SizeY);
+            Write<uint32_t>(OutFile, uint32_t(Level.Data.Size()));
+            OutFile.write((const char*)&Level.Data[0], Level.Data.Size());
+        }
+    }
+
+    return OutFile.good();
+}
+
+
+/*static*/ unsigned long TextureCacheT::GetDataSize(FormatT Format, unsigned int SizeX, unsigned int SizeY)
+{
+    switch (Format)
+    {
+        case RGBA: return (unsigned long)SizeX*SizeY*4;
+        case DXT1: return (unsigned long)((SizeX+3)/4)*((SizeY+3)/4)*8;
+        case DXT5: return (unsigned long)((SizeX+3)/4)*((SizeY+3)/4)*16;
+    }
+
+    return 0;
+}
+
+
+/*static*/ void TextureCacheT::CompressBlock(const unsigned char Pixels[16*4], FormatT Format, unsigned char* Block)
+{
+    if (Format == DXT5)
+    {
+        CompressAlphaBlock(Pixels, Block);
+        Block += 8;
+    }
+
+    CompressColorBlock(Pixels, Block);
+}
@@ -0,0 +1,115 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/*********************/
+/*** Texture Cache ***/
+/*********************/
+
+#ifndef CAFU_MATSYS_TEXTURE_CACHE_HPP_INCLUDED
+#define CAFU_MATSYS_TEXTURE_CACHE_HPP_INCLUDED
+
+#include "../MapComposition.hpp"
+
+#include <stdint.h>
+#include <string>
+
+
+/// A texture cache file keeps the images of a texture with their complete mipmap chains, optionally block-compressed,
+/// so that the renderers can upload them without loading, composing, scaling and mipmapping the source images first.
+/// The files are baked offline by the MakeTexCache tool and kept in the "TexCache" subdirectory of the base dir of the texture.
+///
+/// A cache file is identified by its key: a string that describes the map compositions of the texture,
+/// and the sizes and modification times of their source files. The file name is derived from a hash of the key,
+/// and the key itself is stored in the file, so that a file is only used as long as it matches its sources exactly.
+class TextureCacheT
+{
+    public:
+
+    /// The formats of the mipmap levels in a cache file.
+    enum FormatT
+    {
+        RGBA,   ///< Uncompressed, four bytes per pixel as in BitmapT::Data.
+        DXT1,   ///< Eight bytes per block of 4x4 pixels (BC1), used for opaque images.
+        DXT5    ///< Sixteen bytes per block of 4x4 pixels (BC3), used for images with alpha.
+    };
+
+    /// A single mipmap level of an image.
+    struct LevelT
+    {
+        unsigned int          SizeX;    ///< The width  of this level in pixels.
+        unsigned int          SizeY;    ///< The height of this level in pixels.
+        ArrayT<unsigned char> Data;     ///< The pixels or blocks of this level, according to the format of the cache.
+    };
+
+
+    /// The constructor. Creates an empty cache object that is filled by either Load() or Build().
+    TextureCacheT();
+
+    /// Returns the key for the texture that is composed of the given images (one for 2D textures, six for cube maps).
+    /// The returned string is empty if the texture cannot be cached, e.g. because one of its source files does not
+    /// exist in the local file system (but only in an archive), so that its modification time is not known.
+    static std::string GetKey(const ArrayT<MapCompositionT>& Images);
+
+    /// Returns the name of the cache file for the given images and key.
+    static std::string GetFileName(const ArrayT<MapCompositionT>& Images, const std::string& Key);
+
+    /// Returns whether the cache file with the given name exists and was baked for the given key.
+    /// Only the header of the file is read.
+    static bool IsUpToDate(const std::string& FileName, const std::string& Key);
+
+    /// Loads the cache file with the given name.
+    /// Only the levels that are actually needed are read: the top levels are skipped just as far as
+    /// TextureLoadJobT::MakeMipMaps() would scale the images down to MaxSize (unless NoScaleDown is set),
+    /// and if MipMaps is false, only the first of the remaining levels is read.
+    /// @returns true on success, false if the file does not exist, is invalid, or was baked for another key than the given one.
+    bool Load(const std::string& FileName, const std::string& Key, unsigned long MaxSize, bool NoScaleDown, bool MipMaps);
+
+    /// Composes the given images and computes their complete mipmap chains.
+    /// The images are scaled to the next smaller powers of two, but never down to a max. texture size:
+    /// the top levels of the chain are simply skipped when the cache is loaded for a smaller max. texture size.
+    /// @param Images     The map compositions of the images of the texture.
+    /// @param Key        The key of the texture as returned by GetKey().
+    /// @param Compress   Whether the levels are block-compressed (DXT1 if all images are opaque, DXT5 otherwise).
+    /// @param Warnings   If non-NULL, warnings about source images that could not be loaded are appended to it.
+    void Build(const ArrayT<MapCompositionT>& Images, const std::string& Key, bool Compress, std::string* Warnings=NULL);
+
+    /// Saves this cache object to the file with the given name. The directory of the file must exist.
+    /// @returns true on success, false otherwise.
+    bool Save(const std::string& FileName) const;
+
+    /// Returns the format of the mipmap levels.
+    FormatT GetFormat() const { return m_Format; }
+
+    /// Returns the width of the first image as it was composed, i.e. before it was scaled.
+    unsigned int GetSizeX() const { return m_SizeX; }
+
+    /// Returns the height of the first image as it was composed, i.e. before it was scaled.
+    unsigned int GetSizeY() const { return m_SizeY; }
+
+    /// Returns the number of images, i.e. 1 for 2D textures and 6 for cube maps.
+    unsigned long GetNumImages() const { return m_MipMaps.Size(); }
+
+    /// Returns the mipmap chain of the image with the given number: all levels down to 1x1 after Build(),
+    /// the levels that were actually read after Load().
+    const ArrayT<LevelT>& GetMipMaps(unsigned long ImageNr) const { return m_MipMaps[ImageNr]; }
+
+    /// Returns the number of bytes of a level with the given size in the given format.
+    static unsigned long GetDataSize(FormatT Format, unsigned int SizeX, unsigned int SizeY);
+
+    /// Compresses a block of 4x4 RGBA pixels to a DXT1 block (eight bytes) or a DXT5 block (sixteen bytes).
+    static void CompressBlock(const unsigned char Pixels[16*4], FormatT Format, unsigned char* Block);
+
+
+    private:
+
+    std::string               m_Key;        ///< The key that the levels were built for.
+    FormatT                   m_Format;     ///< The format of the levels.
+    unsigned int              m_SizeX;      ///< The width  of the first image before it was scaled.
+    unsigned int              m_SizeY;      ///< The height of the first image before it was scaled.
+    ArrayT< ArrayT<LevelT> >  m_MipMaps;    ///< The mipmap chains of the images.
+};
+
+#endif
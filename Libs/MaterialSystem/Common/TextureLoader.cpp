@@ -0,0 +1,222 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/**********************/
+/*** Texture Loader ***/
+/**********************/
+
+#include "TextureLoader.hpp"
+#include "TextureCache.hpp"
+#include "Bitmap/Bitmap.hpp"
+
+#include <algorithm>
+
+
+static bool IsPowerOf2(unsigned long i)
+{
+    return i>0 && (i & (i-1))==0;
+}
+
+
+/***********************/
+/*** TextureLoadJobT ***/
+/***********************/
+
+TextureLoadJobT::TextureLoadJobT(const ArrayT<MapCompositionT>& Images, unsigned long MaxSize, bool NoScaleDown, bool MipMaps, bool AllowCompressed)
+    : m_Images(Images),
+      m_MaxSize(MaxSize),
+      m_NoScaleDown(NoScaleDown),
+      m_WantMipMaps(MipMaps),
+      m_AllowCompressed(AllowCompressed),
+      m_Cache(NULL),
+      m_SizeX(0),
+      m_SizeY(0),
+      m_MipMaps(),
+      m_Warnings(),
+      m_IsDone(false)
+{
+}
+
+
+TextureLoadJobT::~TextureLoadJobT()
+{
+    for (unsigned long ImageNr=0; ImageNr<m_MipMaps.Size(); ImageNr++)
+        for (unsigned long Level=0; Level<m_MipMaps[ImageNr].Size(); Level++)
+            delete m_MipMaps[ImageNr][Level];
+
+    delete m_Cache;
+}
+
+
+void TextureLoadJobT::Run()
+{
+    if (m_IsDone) return;
+
+    const std::string Key=TextureCacheT::GetKey(m_Images);
+
+    if (Key!="")
+    {
+        TextureCacheT* Cache=new TextureCacheT();
+
+        if (Cache->Load(TextureCacheT::GetFileName(m_Images, Key), Key, m_MaxSize, m_NoScaleDown, m_WantMipMaps) &&
+            Cache->GetNumImages()==m_Images.Size() && (Cache->GetFormat()==TextureCacheT::RGBA || m_AllowCompressed))
+        {
+            m_SizeX=Cache->GetSizeX();
+            m_SizeY=Cache->GetSizeY();
+            m_Cache=Cache;
+            m_IsDone=true;
+            return;
+        }
+
+        delete Cache;
+    }
+
+    for (unsigned long ImageNr=0; ImageNr<m_Images.Size(); ImageNr++)
+    {
+        BitmapT* Bitmap=m_Images[ImageNr].GetBitmap(&m_Warnings);
+
+        if (ImageNr==0)
+        {
+            m_SizeX=Bitmap->SizeX;
+            m_SizeY=Bitmap->SizeY;
+        }
+
+        m_MipMaps.PushBackEmpty();
+        MakeMipMaps(Bitmap, m_MaxSize, m_NoScaleDown, m_WantMipMaps, m_MipMaps[ImageNr]);
+    }
+
+    m_IsDone=true;
+}
+
+
+std::string TextureLoadJobT::TakeWarnings()
+{
+    std::string Warnings;
+
+    std::swap(Warnings, m_Warnings);
+    return Warnings;
+}
+
+
+/*static*/ void TextureLoadJobT::MakeMipMaps(BitmapT* Bitmap, unsigned long MaxSize, bool NoScaleDown, bool MipMaps, ArrayT<BitmapT*>& Levels)
+{
+    // Scale to next smaller power of 2 and to or below the max. texture size.
+    if (!IsPowerOf2(Bitmap->SizeX) || !IsPowerOf2(Bitmap->SizeY) || Bitmap->SizeX>MaxSize || Bitmap->SizeY>MaxSize)
+    {
+        unsigned long NewX=1; while (2*NewX<=Bitmap->SizeX) NewX*=2;
+        unsigned long NewY=1; while (2*NewY<=Bitmap->SizeY) NewY*=2;
+
+        if (!NoScaleDown)
+        {
+            // Note that NewX and NewY are now NOT treated independently of each other.
+            while (NewX>1 && NewY>1 && NewX>MaxSize && NewY>MaxSize)
+            {
+                NewX/=2;
+                NewY/=2;
+            }
+        }
+
+        Bitmap->Scale(NewX, NewY);
+    }
+
+    Levels.PushBack(Bitmap);
+
+    if (!MipMaps) return;
+
+    while (Bitmap->SizeX>1 || Bitmap->SizeY>1)
+    {
+        Bitmap=new BitmapT(*Bitmap);
+        Bitmap->HalveSize();
+
+        Levels.PushBack(Bitmap);
+    }
+}
+
+
+/**********************/
+/*** TextureLoaderT ***/
+/**********************/
+
+TextureLoaderT::TextureLoaderT(unsigned int MaxThreads)
+    : m_Jobs(MaxThreads>0 ? MaxThreads+1 : std::max(cf::Jobs::JobSystemT::GetNumHardwareThreads(), 2u))
+{
+    // The job system counts the calling thread as one of its threads, but as the calling thread
+    // only takes part in the work when it waits for a job, the number of threads is one more
+    // than the number of worker threads.
+}
+
+
+TextureLoaderT::~TextureLoaderT()
+{
+    for (std::map<TextureLoadJobT*, EntryT>::iterator It=m_Entries.begin(); It!=m_Entries.end(); ++It)
+    {
+        // Drop the job if no worker thread has started it yet.
+        It->second.IsClaimed->exchange(true);
+        m_Dropped.PushBack(It->second.Job);
+    }
+
+    // All jobs must have been waited for before the job system is destroyed.
+    for (unsigned long JobNr=0; JobNr<m_Dropped.Size(); JobNr++)
+        m_Jobs.Wait(m_Dropped[JobNr]);
+}
+
+
+void TextureLoaderT::Add(TextureLoadJobT* Job)
+{
+    RemoveDoneJobs();
+
+    EntryT Entry;
+
+    Entry.IsClaimed=std::make_shared< std::atomic<bool> >(false);
+
+    // Note that the function must not refer to the entry, but only to what it needs to run the job.
+    std::shared_ptr< std::atomic<bool> > IsClaimed=Entry.IsClaimed;
+
+    Entry.Job=m_Jobs.Submit("TextureLoadJob", [IsClaimed, Job]()
+    {
+        if (!IsClaimed->exchange(true)) Job->Run();
+    });
+
+    m_Entries[Job]=Entry;
+}
+
+
+void TextureLoaderT::Finish(TextureLoadJobT* Job)
+{
+    // Remove the job from the loader, so that it is neither pending nor running any more.
+    Cancel(Job);
+
+    // If it is not yet done, run it here.
+    Job->Run();
+}
+
+
+void TextureLoaderT::Cancel(TextureLoadJobT* Job)
+{
+    std::map<TextureLoadJobT*, EntryT>::iterator It=m_Entries.find(Job);
+
+    if (It==m_Entries.end()) return;
+
+    // If a worker thread is running the job, wait for it to complete,
+    // otherwise keep the (now no-op) job system job until it has been run.
+    if (It->second.IsClaimed->exchange(true))
+        m_Jobs.Wait(It->second.Job);
+    else
+        m_Dropped.PushBack(It->second.Job);
+
+    m_Entries.erase(It);
+}
+
+
+void TextureLoaderT::RemoveDoneJobs()
+{
+    for (unsigned long JobNr=0; JobNr<m_Dropped.Size(); JobNr++)
+        if (m_Dropped[JobNr]->IsDone())
+        {
+            m_Dropped.RemoveAt(JobNr);
+            JobNr--;
+        }
+}
@@ -0,0 +1,148 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/**********************/
+/*** Texture Loader ***/
+/**********************/
+
+#ifndef CAFU_MATSYS_TEXTURE_LOADER_HPP_INCLUDED
+#define CAFU_MATSYS_TEXTURE_LOADER_HPP_INCLUDED
+
+#include "../MapComposition.hpp"
+#include "Jobs/JobSystem.hpp"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+
+
+struct BitmapT;
+class TextureCacheT;
+
+
+/// This class represents the CPU-side work that is required for a texture map before it can be uploaded:
+/// loading and compositing the images of the texture, scaling them to powers of two, and computing their mipmaps.
+/// If there is an up-to-date texture cache file for the images, the job reads the mipmaps from the file instead.
+/// The work doesn't involve the renderer at all and can run in any thread, normally in a worker thread of a TextureLoaderT.
+class TextureLoadJobT
+{
+    public:
+
+    /// The constructor.
+    /// @param Images            The map compositions of the images of the texture: one for 2D textures, six for cube maps.
+    /// @param MaxSize           The maximum side length that the images are scaled down to.
+    /// @param NoScaleDown       If true, the images are only scaled to powers of two, but not to MaxSize.
+    /// @param MipMaps           Whether the mipmaps of the images are to be computed.
+    /// @param AllowCompressed   Whether a texture cache file with block-compressed mipmaps may be used.
+    TextureLoadJobT(const ArrayT<MapCompositionT>& Images, unsigned long MaxSize, bool NoScaleDown, bool MipMaps, bool AllowCompressed);
+
+    /// The destructor.
+    ~TextureLoadJobT();
+
+    /// Loads the mipmaps of the images from the texture cache, or loads and composes the images and computes their mipmaps.
+    /// This is the expensive part of the job, and it is safe to call it from any thread.
+    void Run();
+
+    /// Returns whether Run() has completed. Only then the methods below may be called.
+    bool IsDone() const { return m_IsDone; }
+
+    /// Returns the maximum side length that this job scales the images down to.
+    unsigned long GetMaxSize() const { return m_MaxSize; }
+
+    /// Returns the width of the first image as it was composed, i.e. before it was scaled.
+    unsigned int GetSizeX() const { return m_SizeX; }
+
+    /// Returns the height of the first image as it was composed, i.e. before it was scaled.
+    unsigned int GetSizeY() const { return m_SizeY; }
+
+    /// Returns the texture cache that the mipmaps were loaded from, or NULL if the images were composed from their source files.
+    /// The mipmaps are available from the texture cache in the former case, and from GetMipMaps() in the latter.
+    const TextureCacheT* GetCache() const { return m_Cache; }
+
+    /// Returns the mipmap chain of the image with the given number. Element 0 is the image itself,
+    /// each further element is half the size of the previous one, down to 1x1.
+    /// If the job was created without mipmaps, the chain only has element 0.
+    const ArrayT<BitmapT*>& GetMipMaps(unsigned long ImageNr) const { return m_MipMaps[ImageNr]; }
+
+    /// Returns the warnings about images that could not be loaded, and clears them, so that they are only reported once.
+    std::string TakeWarnings();
+
+    /// Scales the given bitmap to the next smaller powers of two and to or below MaxSize (unless NoScaleDown is set),
+    /// and appends it and (if MipMaps is true) all of its mipmaps to Levels.
+    /// Levels becomes the owner of Bitmap and of the mipmaps, so the caller must eventually delete all of its elements.
+    static void MakeMipMaps(BitmapT* Bitmap, unsigned long MaxSize, bool NoScaleDown, bool MipMaps, ArrayT<BitmapT*>& Levels);
+
+
+    private:
+
+    TextureLoadJobT(const TextureLoadJobT&);        ///< Use of the Copy Constructor    is not allowed.
+    void operator = (const TextureLoadJobT&);       ///< Use of the Assignment Operator is not allowed.
+
+    const ArrayT<MapCompositionT> m_Images;             ///< The map compositions of the images of the texture.
+    const unsigned long           m_MaxSize;            ///< The maximum side length that the images are scaled down to.
+    const bool                    m_NoScaleDown;        ///< Whether the images are scaled to powers of two only, but not to m_MaxSize.
+    const bool                    m_WantMipMaps;        ///< Whether the mipmaps of the images are computed.
+    const bool                    m_AllowCompressed;    ///< Whether a texture cache file with block-compressed mipmaps may be used.
+    TextureCacheT*                m_Cache;              ///< The texture cache that the mipmaps were loaded from, if any.
+    unsigned int                  m_SizeX;              ///< The width  of the first image before it was scaled.
+    unsigned int                  m_SizeY;              ///< The height of the first image before it was scaled.
+    ArrayT< ArrayT<BitmapT*> >    m_MipMaps;            ///< The mipmap chains of the images.
+    std::string                   m_Warnings;           ///< The warnings that were issued while the images were loaded.
+    std::atomic<bool>             m_IsDone;             ///< Whether Run() has completed.
+};
+
+
+/// The texture loader runs TextureLoadJobTs in the background, so that the render thread is only left
+/// with uploading the results. The jobs are run by the worker threads of a cf::Jobs::JobSystemT.
+/// The methods of the texture loader must all be called from the same thread, normally the render thread.
+class TextureLoaderT
+{
+    public:
+
+    /// The constructor.
+    /// @param MaxThreads   The number of worker threads. 0 means to use one thread less than
+    ///                     there are hardware threads (but at least one), leaving one for rendering.
+    TextureLoaderT(unsigned int MaxThreads=0);
+
+    /// The destructor. Drops all pending jobs and waits for the running ones to complete.
+    ~TextureLoaderT();
+
+    /// Adds the given job to the job system, to be run in one of the worker threads.
+    /// The caller remains the owner of the job, but must not delete it before it has been passed to Finish() or Cancel().
+    void Add(TextureLoadJobT* Job);
+
+    /// Makes sure that the given job is done when this method returns.
+    /// If no worker thread has started the job yet (or it was never added), it is run in the calling thread.
+    /// If a worker thread is running it, this method waits for it to complete.
+    void Finish(TextureLoadJobT* Job);
+
+    /// Removes the given job from the loader: if no worker thread has started it yet, it is dropped,
+    /// and if a worker thread is running it, this method waits for it to complete.
+    /// Afterwards, the caller can delete the job.
+    void Cancel(TextureLoadJobT* Job);
+
+
+    private:
+
+    TextureLoaderT(const TextureLoaderT&);          ///< Use of the Copy Constructor    is not allowed.
+    void operator = (const TextureLoaderT&);        ///< Use of the Assignment Operator is not allowed.
+
+    /// A TextureLoadJobT that has been added to the job system.
+    struct EntryT
+    {
+        cf::Jobs::JobPtrT                    Job;       ///< The job in the job system that runs the TextureLoadJobT.
+        std::shared_ptr< std::atomic<bool> > IsClaimed; ///< Whether a worker thread has started to run the TextureLoadJobT, or the job was dropped.
+    };
+
+    void RemoveDoneJobs();
+
+    cf::Jobs::JobSystemT               m_Jobs;      ///< The worker threads.
+    std::map<TextureLoadJobT*, EntryT> m_Entries;   ///< The jobs that have been added and not yet been finished or cancelled.
+    ArrayT<cf::Jobs::JobPtrT>          m_Dropped;   ///< The jobs of dropped entries, kept until the job system has run them (as no-ops).
+};
+
+#endif
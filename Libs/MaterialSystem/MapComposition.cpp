@@ -331,7 +331,7 @@ bool MapCompositionT::operator == (const MapCompositionT& rhs) const
 // This function loads all image source files from disk (at BaseDir+FileName), and combines them (according to this MapCompositionT)
 // into a single resulting BitmapT. On any error with the participating bitmaps (ie. file not found, file unreadable, ...),
 // a default texture is substituted for the missing participant, and a warning is printed out. Thus, the function never fails.
-BitmapT* MapCompositionT::GetBitmap() const
+BitmapT* MapCompositionT::GetBitmap(std::string* Warnings) const
 {
     switch (Type)
     {
@@ -343,35 +343,29 @@ BitmapT* MapCompositionT::GetBitmap() const
         {
             try
             {
-                return new BitmapT((*BaseDir+FileName).c_str());
+                return new BitmapT((*BaseDir+FileName).c_str(), Warnings);
             }
             catch (const BitmapT::LoadErrorT&)
             {
-                Console->Warning(std::string("Could not load the bitmap at \"")+(*BaseDir)+FileName+"\".\n");
+                const std::string Msg=std::string("Could not load the bitmap at \"")+(*BaseDir)+FileName+"\".\n";
+
+                if (Warnings!=NULL) *Warnings+=Msg;
+                               else Console->Warning(Msg);
+
                 return new BitmapT(BitmapT::GetBuiltInFileNotFoundBitmap());
             }
         }
 
         case Add:
         {
-            BitmapT* B1=Child1->GetBitmap();
-            BitmapT* B2=Child2->GetBitmap();
+            BitmapT* B1=Child1->GetBitmap(Warnings);
+            BitmapT* B2=Child2->GetBitmap(Warnings);
 
             // Make sure that B2 has the same size as B1.
             B2->Scale(B1->SizeX, B1->SizeY);
 
             // Add the two bitmaps.
-            for (unsigned int y=0; y<B1->SizeY; y++)
-                for (unsigned int x=0; x<B1->SizeX; x++)
-                {
-                    int r1, g1, b1, a1;
-                    int r2, g2, b2, a2;
-
-                    B1->GetPixel(x, y, r1, g1, b1, a1);
-                    B2->GetPixel(x, y, r2, g2, b2, a2);
-
-                    B1->SetPixel(x, y, r1+r2, g1+g2, b1+b2, a1+a2);
-                }
+            B1->Add(*B2);
 
             delete B2;
             return B1;
@@ -379,24 +373,14 @@ BitmapT* MapCompositionT::GetBitmap() const
 
         case Mul:
         {
-            BitmapT* B1=Child1->GetBitmap();
-            BitmapT* B2=Child2->GetBitmap();
+            BitmapT* B1=Child1->GetBitmap(Warnings);
+            BitmapT* B2=Child2->GetBitmap(Warnings);
 
             // Make sure that B2 has the same size as B1.
             B2->Scale(B1->SizeX, B1->SizeY);
 
-            // Add the two bitmaps.
-            for (unsigned int y=0; y<B1->SizeY; y++)
-                for (unsigned int x=0; x<B1->SizeX; x++)
-                {
-                    float r1, g1, b1, a1;
-                    float r2, g2, b2, a2;
-
-                    B1->GetPixel(x, y, r1, g1, b1, a1);
-                    B2->GetPixel(x, y, r2, g2, b2, a2);
-
-                    B1->SetPixel(x, y, r1*r2, g1*g2, b1*b2, a1*a2);
-                }
+            // Multiply the two bitmaps.
+            B1->Mul(*B2);
 
             delete B2;
             return B1;
@@ -404,150 +388,48 @@ BitmapT* MapCompositionT::GetBitmap() const
 
         case CombineNormals:
         {
-            BitmapT* NormalMap1=Child1->GetBitmap();
-            BitmapT* NormalMap2=Child2->GetBitmap();
+            BitmapT* NormalMap1=Child1->GetBitmap(Warnings);
+            BitmapT* NormalMap2=Child2->GetBitmap(Warnings);
 
             // Make sure that NormalMap2 has the same size as NormalMap1.
             NormalMap2->Scale(NormalMap1->SizeX, NormalMap1->SizeY);
 
-            // Initially create the combined normal-map from NormalMap1, in order to get the dimensions right.
-            // The actual contents is overwritten below.
-            BitmapT* CombinedNormalMap=new BitmapT(*NormalMap1);
-
             // Combine the two normal maps.
-            for (unsigned int y=0; y<NormalMap1->SizeY; y++)
-                for (unsigned int x=0; x<NormalMap1->SizeX; x++)
-                {
-                    float x1, y1, z1;
-                    float x2, y2, z2;
-
-                    NormalMap1->GetPixel(x, y, x1, y1, z1);
-                    NormalMap2->GetPixel(x, y, x2, y2, z2);
-
-                    x1=x1*2.0f-1.0f;
-                    y1=y1*2.0f-1.0f;
-                    z1=z1*2.0f-1.0f;
+            NormalMap1->CombineNormals(*NormalMap2);
 
-                    x2=x2*2.0f-1.0f;
-                    y2=y2*2.0f-1.0f;
-                    z2=z2*2.0f-1.0f;
-
-                    // See the Cafu Tech Archive ("Adding two normal-maps properly", 2004-06-19) for a detailed explanation!
-                    float x_=x1*z2+x2*z1;
-                    float y_=y1*z2+y2*z1;
-                    float z_=z1*z2;
-
-                    // Renormalize.
-                    const float Length=float(sqrt(x_*x_ + y_*y_ + z_*z_));
-
-                    if (Length!=0.0)
-                    {
-                        x_/=Length;
-                        y_/=Length;
-                        z_/=Length;
-                    }
-
-                    CombinedNormalMap->SetPixel(x, y, (x_+1.0f)/2.0f, (y_+1.0f)/2.0f, (z_+1.0f)/2.0f);
-                }
-
-            delete NormalMap1;
             delete NormalMap2;
-
-            return CombinedNormalMap;
+            return NormalMap1;
         }
 
         case HeightMapToNormalMap:
         {
-            BitmapT* HeightMap=Child1->GetBitmap();
-
-            // Initially create the normal-map from HeightMap, in order to get the dimensions right.
-            // The actual contents is overwritten below.
-            BitmapT* NormalMap=new BitmapT(*HeightMap);
+            BitmapT* HeightMap=Child1->GetBitmap(Warnings);
 
             // Turn HeightMap into NormalMap.
-            // Combine the two normal maps.
-            for (unsigned int y=0; y<HeightMap->SizeY; y++)
-                for (unsigned int x=0; x<HeightMap->SizeX; x++)
-                {
-                    float h00, h01, h10, g, b, a;
-
-                    HeightMap->GetPixel( x                      ,  y                      , h00, g, b, a);
-                    HeightMap->GetPixel( x                      , (y+1) % HeightMap->SizeY, h01, g, b, a);
-                    HeightMap->GetPixel((x+1) % HeightMap->SizeX,  y                      , h10, g, b, a);
-
-                    const float VecX[3]={ 1.0f, 0.0f, (h10-h00)*HeightScale };
-                    const float VecY[3]={ 0.0f, 1.0f, (h01-h00)*HeightScale };
+            HeightMap->HeightMapToNormalMap(HeightScale);
 
-                    // Normal=VectorCross(VecX, VecY);
-                    float Normal[3]={ VecX[1]*VecY[2]-VecX[2]*VecY[1], VecX[2]*VecY[0]-VecX[0]*VecY[2], VecX[0]*VecY[1]-VecX[1]*VecY[0] };
-
-                    // Normalize Normal.
-                    float Length=float(sqrt(Normal[0]*Normal[0] + Normal[1]*Normal[1] + Normal[2]*Normal[2]));
-
-                    if (Length!=0.0)
-                    {
-                        Normal[0]/=Length;
-                        Normal[1]/=Length;
-                        Normal[2]/=Length;
-                    }
-
-                    NormalMap->SetPixel(x, y, (Normal[0]+1.0f)/2.0f, (Normal[1]+1.0f)/2.0f, (Normal[2]+1.0f)/2.0f);
-                }
-
-            delete HeightMap;
-            return NormalMap;
+            return HeightMap;
         }
 
         case FlipNormalMapYAxis:
         {
-            BitmapT* NormalMap=Child1->GetBitmap();
-
-            for (unsigned int y=0; y<NormalMap->SizeY; y++)
-                for (unsigned int x=0; x<NormalMap->SizeX; x++)
-                {
-                    int nx, ny, nz;
-
-                    NormalMap->GetPixel(x, y, nx,     ny, nz);
-                    NormalMap->SetPixel(x, y, nx, 255-ny, nz);
-                }
+            BitmapT* NormalMap=Child1->GetBitmap(Warnings);
 
+            NormalMap->FlipNormalMapYAxis();
             return NormalMap;
         }
 
         case ReNormalize:
         {
-            BitmapT* NormalMap=Child1->GetBitmap();
-
-            for (unsigned int y=0; y<NormalMap->SizeY; y++)
-                for (unsigned int x=0; x<NormalMap->SizeX; x++)
-                {
-                    float nx, ny, nz;
-
-                    NormalMap->GetPixel(x, y, nx, ny, nz);
-
-                    nx=nx*2.0f-1.0f;
-                    ny=ny*2.0f-1.0f;
-                    nz=nz*2.0f-1.0f;
-
-                    // Renormalize.
-                    const float Length=float(sqrt(nx*nx + ny*ny + nz*nz));
-
-                    if (Length!=0.0)
-                    {
-                        nx/=Length;
-                        ny/=Length;
-                        nz/=Length;
-                    }
-
-                    NormalMap->SetPixel(x, y, (nx+1.0f)/2.0f, (ny+1.0f)/2.0f, (nz+1.0f)/2.0f);
-                }
+            BitmapT* NormalMap=Child1->GetBitmap(Warnings);
 
+            NormalMap->ReNormalize();
             return NormalMap;
         }
 
         case BlueToAlpha:
         {
-            BitmapT*      Bitmap  =Child1->GetBitmap();
+            BitmapT*      Bitmap  =Child1->GetBitmap(Warnings);
             const BitmapT Original=*Bitmap;
 
             for (unsigned int y=0; y<Original.SizeY; y++)
@@ -780,3 +662,16 @@ std::string MapCompositionT::GetBaseDir() const
 {
     return (BaseDir==NULL) ? "" : *BaseDir;
 }
+
+
+void MapCompositionT::GetSourceFiles(ArrayT<std::string>& FileNames) const
+{
+    if (Type==Map)
+    {
+        FileNames.PushBack(*BaseDir+FileName);
+        return;
+    }
+
+    if (Child1!=NULL) Child1->GetSourceFiles(FileNames);
+    if (Child2!=NULL) Child2->GetSourceFiles(FileNames);
+}
@@ -72,7 +72,9 @@ class MapCompositionT
     /// into a single resulting BitmapT. On any error with the participating bitmaps (ie. file not found, file unreadable, ...),
     /// a default texture is substituted for the missing participant, and a warning is printed out. Thus, the function never fails.
     /// The caller becomes the owner of the returned pointer (i.e. its the callers responsibility to delete it.)
-    BitmapT* GetBitmap() const;
+    /// If Warnings is non-NULL, the warnings are appended to it rather than printed to the console,
+    /// which is required when this method is called from a thread other than the main thread.
+    BitmapT* GetBitmap(std::string* Warnings=NULL) const;
 
     /// Returns a string description of this MapCompositionT (quasi the counter-piece to the constructor).
     std::string GetString() const;
@@ -83,6 +85,10 @@ class MapCompositionT
     /// Returns the base dir of this MapCompositionT. Can be the empty string for empty map compositions.
     std::string GetBaseDir() const;
 
+    /// Appends the names of all image source files of this MapCompositionT (including those of its children) to FileNames,
+    /// with the base dir prepended, that is, exactly as GetBitmap() loads them.
+    void GetSourceFiles(ArrayT<std::string>& FileNames) const;
+
 
     private:
 
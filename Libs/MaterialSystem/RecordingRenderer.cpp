@@ -0,0 +1,454 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/**************************/
+/*** Recording Renderer ***/
+/**************************/
+
+#include "RecordingRenderer.hpp"
+
+
+using namespace MatSys;
+
+
+RecordingRendererT::RecordingRendererT(RendererI& Target, RenderCommandListT& List)
+    : m_Target(Target),
+      m_List(List),
+      m_Textures()
+{
+}
+
+
+bool RecordingRendererT::IsSupported() const
+{
+    return m_Target.IsSupported();
+}
+
+
+bool RecordingRendererT::DoesSupportCompressedSHL() const
+{
+    return m_Target.DoesSupportCompressedSHL();
+}
+
+
+bool RecordingRendererT::DoesSupportUncompressedSHL() const
+{
+    return m_Target.DoesSupportUncompressedSHL();
+}
+
+
+int RecordingRendererT::GetPreferenceNr() const
+{
+    return m_Target.GetPreferenceNr();
+}
+
+
+void RecordingRendererT::Initialize()
+{
+    m_Target.Initialize();
+}
+
+
+void RecordingRendererT::Release()
+{
+    m_Target.Release();
+}
+
+
+const char* RecordingRendererT::GetDescription() const
+{
+    return m_Target.GetDescription();
+}
+
+
+RenderMaterialT* RecordingRendererT::RegisterMaterial(const MaterialT* Material) const
+{
+    return m_Target.RegisterMaterial(Material);
+}
+
+
+const MaterialT* RecordingRendererT::GetMaterialFromRM(RenderMaterialT* RenderMaterial) const
+{
+    return m_Target.GetMaterialFromRM(RenderMaterial);
+}
+
+
+unsigned long RecordingRendererT::GetAmbientShaderIDFromRM(RenderMaterialT* RenderMaterial) const
+{
+    return m_Target.GetAmbientShaderIDFromRM(RenderMaterial);
+}
+
+
+unsigned long RecordingRendererT::GetLightShaderIDFromRM(RenderMaterialT* RenderMaterial) const
+{
+    return m_Target.GetLightShaderIDFromRM(RenderMaterial);
+}
+
+
+void RecordingRendererT::FreeMaterial(RenderMaterialT* RenderMaterial)
+{
+    m_Target.FreeMaterial(RenderMaterial);
+}
+
+
+void RecordingRendererT::BeginFrame(double Time)
+{
+    m_Target.BeginFrame(Time);
+}
+
+
+void RecordingRendererT::EndFrame()
+{
+    m_Target.EndFrame();
+}
+
+
+void RecordingRendererT::PreCache()
+{
+    m_Target.PreCache();
+}
+
+
+void RecordingRendererT::SetCurrentRenderAction(RenderActionT RA)
+{
+    m_Target.SetCurrentRenderAction(RA);
+    m_List.RecordRenderAction(RA);
+}
+
+
+RendererI::RenderActionT RecordingRendererT::GetCurrentRenderAction() const
+{
+    return m_Target.GetCurrentRenderAction();
+}
+
+
+void RecordingRendererT::SetGenPurposeRenderingParam(unsigned long Index, float Value)
+{
+    m_Target.SetGenPurposeRenderingParam(Index, Value);
+}
+
+
+void RecordingRendererT::SetGenPurposeRenderingParam(unsigned long Index, int Value)
+{
+    m_Target.SetGenPurposeRenderingParam(Index, Value);
+}
+
+
+float RecordingRendererT::GetGenPurposeRenderingParamF(unsigned long Index) const
+{
+    return m_Target.GetGenPurposeRenderingParamF(Index);
+}
+
+
+int RecordingRendererT::GetGenPurposeRenderingParamI(unsigned long Index) const
+{
+    return m_Target.GetGenPurposeRenderingParamI(Index);
+}
+
+
+void RecordingRendererT::SetCurrentAmbientLightColor(float r, float g, float b)
+{
+    m_Target.SetCurrentAmbientLightColor(r, g, b);
+}
+
+
+float* RecordingRendererT::GetCurrentAmbientLightColor()
+{
+    return m_Target.GetCurrentAmbientLightColor();
+}
+
+
+const float* RecordingRendererT::GetCurrentAmbientLightColor() const
+{
+    return static_cast<const RendererI&>(m_Target).GetCurrentAmbientLightColor();
+}
+
+
+void RecordingRendererT::SetCurrentLightSourcePosition(float x, float y, float z)
+{
+    m_Target.SetCurrentLightSourcePosition(x, y, z);
+}
+
+
+float* RecordingRendererT::GetCurrentLightSourcePosition()
+{
+    return m_Target.GetCurrentLightSourcePosition();
+}
+
+
+const float* RecordingRendererT::GetCurrentLightSourcePosition() const
+{
+    return static_cast<const RendererI&>(m_Target).GetCurrentLightSourcePosition();
+}
+
+
+void RecordingRendererT::SetCurrentLightSourceRadius(float r)
+{
+    m_Target.SetCurrentLightSourceRadius(r);
+}
+
+
+float& RecordingRendererT::GetCurrentLightSourceRadius()
+{
+    return m_Target.GetCurrentLightSourceRadius();
+}
+
+
+const float& RecordingRendererT::GetCurrentLightSourceRadius() const
+{
+    return static_cast<const RendererI&>(m_Target).GetCurrentLightSourceRadius();
+}
+
+
+void RecordingRendererT::SetCurrentLightSourceDiffuseColor(float r, float g, float b)
+{
+    m_Target.SetCurrentLightSourceDiffuseColor(r, g, b);
+}
+
+
+float* RecordingRendererT::GetCurrentLightSourceDiffuseColor()
+{
+    return m_Target.GetCurrentLightSourceDiffuseColor();
+}
+
+
+const float* RecordingRendererT::GetCurrentLightSourceDiffuseColor() const
+{
+    return static_cast<const RendererI&>(m_Target).GetCurrentLightSourceDiffuseColor();
+}
+
+
+void RecordingRendererT::SetCurrentLightSourceSpecularColor(float r, float g, float b)
+{
+    m_Target.SetCurrentLightSourceSpecularColor(r, g, b);
+}
+
+
+float* RecordingRendererT::GetCurrentLightSourceSpecularColor()
+{
+    return m_Target.GetCurrentLightSourceSpecularColor();
+}
+
+
+const float* RecordingRendererT::GetCurrentLightSourceSpecularColor() const
+{
+    return static_cast<const RendererI&>(m_Target).GetCurrentLightSourceSpecularColor();
+}
+
+
+void RecordingRendererT::SetCurrentEyePosition(float x, float y, float z)
+{
+    m_Target.SetCurrentEyePosition(x, y, z);
+}
+
+
+float* RecordingRendererT::GetCurrentEyePosition()
+{
+    return m_Target.GetCurrentEyePosition();
+}
+
+
+const float* RecordingRendererT::GetCurrentEyePosition() const
+{
+    return static_cast<const RendererI&>(m_Target).GetCurrentEyePosition();
+}
+
+
+void RecordingRendererT::PushLightingParameters()
+{
+    m_Target.PushLightingParameters();
+}
+
+
+void RecordingRendererT::PopLightingParameters()
+{
+    m_Target.PopLightingParameters();
+}
+
+
+void RecordingRendererT::ClearColor(float r, float g, float b, float a)
+{
+    m_Target.ClearColor(r, g, b, a);
+}
+
+
+void RecordingRendererT::Flush()
+{
+    m_Target.Flush();
+}
+
+
+const Matrix4x4fT& RecordingRendererT::GetMatrix(MatrixNameT MN) const
+{
+    return m_Target.GetMatrix(MN);
+}
+
+
+const Matrix4x4fT& RecordingRendererT::GetMatrixInv(MatrixNameT MN) const
+{
+    return m_Target.GetMatrixInv(MN);
+}
+
+
+const Matrix4x4fT& RecordingRendererT::GetMatrixModelView() const
+{
+    return m_Target.GetMatrixModelView();
+}
+
+
+void RecordingRendererT::SetMatrix(MatrixNameT MN, const Matrix4x4fT& Matrix)
+{
+    m_Target.SetMatrix(MN, Matrix);
+}
+
+
+void RecordingRendererT::Translate(MatrixNameT MN, float x, float y, float z)
+{
+    m_Target.Translate(MN, x, y, z);
+}
+
+
+void RecordingRendererT::Scale(MatrixNameT MN, float scale)
+{
+    m_Target.Scale(MN, scale);
+}
+
+
+void RecordingRendererT::RotateX(MatrixNameT MN, float angle)
+{
+    m_Target.RotateX(MN, angle);
+}
+
+
+void RecordingRendererT::RotateY(MatrixNameT MN, float angle)
+{
+    m_Target.RotateY(MN, angle);
+}
+
+
+void RecordingRendererT::RotateZ(MatrixNameT MN, float angle)
+{
+    m_Target.RotateZ(MN, angle);
+}
+
+
+void RecordingRendererT::PushMatrix(MatrixNameT MN)
+{
+    m_Target.PushMatrix(MN);
+}
+
+
+void RecordingRendererT::PopMatrix(MatrixNameT MN)
+{
+    m_Target.PopMatrix(MN);
+}
+
+
+void RecordingRendererT::SetViewport(int x, int y, int width, int height)
+{
+    m_Target.SetViewport(x, y, width, height);
+}
+
+
+void RecordingRendererT::GetViewport(int viewport[4])
+{
+    m_Target.GetViewport(viewport);
+}
+
+
+void RecordingRendererT::SetSelectionBuffer(unsigned long Size, unsigned int* Buffer)
+{
+    m_Target.SetSelectionBuffer(Size, Buffer);
+}
+
+
+unsigned long RecordingRendererT::SetPickingRenderMode(PickingRenderModeT PRM)
+{
+    return m_Target.SetPickingRenderMode(PRM);
+}
+
+
+void RecordingRendererT::InitNameStack()
+{
+    m_Target.InitNameStack();
+}
+
+
+void RecordingRendererT::LoadName(unsigned long Name)
+{
+    m_Target.LoadName(Name);
+}
+
+
+void RecordingRendererT::PushName(unsigned long Name)
+{
+    m_Target.PushName(Name);
+}
+
+
+void RecordingRendererT::PopName()
+{
+    m_Target.PopName();
+}
+
+
+void RecordingRendererT::SetCurrentMaterial(RenderMaterialT* RenderMaterial)
+{
+    m_Target.SetCurrentMaterial(RenderMaterial);
+}
+
+
+RenderMaterialT* RecordingRendererT::GetCurrentMaterial() const
+{
+    return m_Target.GetCurrentMaterial();
+}
+
+
+void RecordingRendererT::LockCurrentMaterial(bool LockCM_)
+{
+    m_Target.LockCurrentMaterial(LockCM_);
+}
+
+
+void RecordingRendererT::SetCurrentLightMap(TextureMapI* LightMap)
+{
+    m_Target.SetCurrentLightMap(LightMap);
+    m_Textures.LightMap=LightMap;
+}
+
+
+void RecordingRendererT::SetCurrentLightDirMap(TextureMapI* LightDirMap)
+{
+    m_Target.SetCurrentLightDirMap(LightDirMap);
+    m_Textures.LightDirMap=LightDirMap;
+}
+
+
+void RecordingRendererT::SetCurrentSHLMaps(const ArrayT<TextureMapI*>& SHLMaps)
+{
+    m_Target.SetCurrentSHLMaps(SHLMaps);
+    m_Textures.SHLMaps.Overwrite();
+    m_Textures.SHLMaps.PushBack(SHLMaps);
+}
+
+
+void RecordingRendererT::SetCurrentSHLLookupMap(TextureMapI* SHLLookupMap)
+{
+    m_Target.SetCurrentSHLLookupMap(SHLLookupMap);
+    m_Textures.SHLLookupMap=SHLLookupMap;
+}
+
+
+void RecordingRendererT::RenderMesh(const MeshT& Mesh)
+{
+    m_List.Record(m_Target, m_Textures, Mesh);
+}
+
+
+RendererI::StatsT RecordingRendererT::GetStats() const
+{
+    return m_Target.GetStats();
+}
@@ -0,0 +1,122 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/**************************/
+/*** Recording Renderer ***/
+/**************************/
+
+#ifndef CAFU_MATSYS_RECORDING_RENDERER_HPP_INCLUDED
+#define CAFU_MATSYS_RECORDING_RENDERER_HPP_INCLUDED
+
+#include "RenderCommandList.hpp"
+
+
+namespace MatSys
+{
+    /// A renderer that records the meshes into a RenderCommandListT instead of rendering them.
+    ///
+    /// All other calls are forwarded to the target renderer, so that the state of the target renderer is always as if the
+    /// calls had been made to it directly. This lets code that renders via the global MatSys::Renderer pointer record its
+    /// meshes without any changes: temporarily set MatSys::Renderer to an instance of this class, then restore it and
+    /// replay the command list with the target renderer.
+    ///
+    /// As RendererI has no methods for getting the current lightmaps and SHL maps, the meshes are recorded with the maps
+    /// that have been set via this renderer, or NULL if they have not been set since its construction.
+    class RecordingRendererT : public RendererI
+    {
+        public:
+
+        /// The constructor.
+        /// @param Target   The renderer that all calls except for RenderMesh() are forwarded to.
+        /// @param List     The list that RenderMesh() records the meshes into.
+        RecordingRendererT(RendererI& Target, RenderCommandListT& List);
+
+        // RendererI implementation.
+        bool IsSupported() const;
+        bool DoesSupportCompressedSHL() const;
+        bool DoesSupportUncompressedSHL() const;
+        int GetPreferenceNr() const;
+        void Initialize();
+        void Release();
+        const char* GetDescription() const;
+        RenderMaterialT* RegisterMaterial(const MaterialT* Material) const;
+        const MaterialT* GetMaterialFromRM(RenderMaterialT* RenderMaterial) const;
+        unsigned long GetAmbientShaderIDFromRM(RenderMaterialT* RenderMaterial) const;
+        unsigned long GetLightShaderIDFromRM(RenderMaterialT* RenderMaterial) const;
+        void FreeMaterial(RenderMaterialT* RenderMaterial);
+        void BeginFrame(double Time);
+        void EndFrame();
+        void PreCache();
+        void SetCurrentRenderAction(RenderActionT RA);
+        RenderActionT GetCurrentRenderAction() const;
+        void  SetGenPurposeRenderingParam (unsigned long Index, float Value);
+        void  SetGenPurposeRenderingParam (unsigned long Index, int   Value);
+        float GetGenPurposeRenderingParamF(unsigned long Index) const;
+        int   GetGenPurposeRenderingParamI(unsigned long Index) const;
+        void         SetCurrentAmbientLightColor(float r, float g, float b);
+        float*       GetCurrentAmbientLightColor();
+        const float* GetCurrentAmbientLightColor() const;
+        void         SetCurrentLightSourcePosition(float x, float y, float z);
+        float*       GetCurrentLightSourcePosition();
+        const float* GetCurrentLightSourcePosition() const;
+        void         SetCurrentLightSourceRadius(float r);
+        float&       GetCurrentLightSourceRadius();
+        const float& GetCurrentLightSourceRadius() const;
+        void         SetCurrentLightSourceDiffuseColor (float r, float g, float b);
+        float*       GetCurrentLightSourceDiffuseColor();
+        const float* GetCurrentLightSourceDiffuseColor() const;
+        void         SetCurrentLightSourceSpecularColor(float r, float g, float b);
+        float*       GetCurrentLightSourceSpecularColor();
+        const float* GetCurrentLightSourceSpecularColor() const;
+        void         SetCurrentEyePosition(float x, float y, float z);
+        float*       GetCurrentEyePosition();
+        const float* GetCurrentEyePosition() const;
+        void PushLightingParameters();
+        void PopLightingParameters();
+        void ClearColor(float r, float g, float b, float a);
+        void Flush();
+        const Matrix4x4fT& GetMatrix(MatrixNameT MN) const;
+        const Matrix4x4fT& GetMatrixInv(MatrixNameT MN) const;
+        const Matrix4x4fT& GetMatrixModelView() const;
+        void SetMatrix(MatrixNameT MN, const Matrix4x4fT& Matrix);
+        void Translate(MatrixNameT MN, float x, float y, float z);
+        void Scale    (MatrixNameT MN, float scale);
+        void RotateX  (MatrixNameT MN, float angle);
+        void RotateY  (MatrixNameT MN, float angle);
+        void RotateZ  (MatrixNameT MN, float angle);
+        void PushMatrix(MatrixNameT MN);
+        void PopMatrix (MatrixNameT MN);
+        void SetViewport(int x, int y, int width, int height);
+        void GetViewport(int viewport[4]);
+        void SetSelectionBuffer(unsigned long Size, unsigned int* Buffer);
+        unsigned long SetPickingRenderMode(PickingRenderModeT PRM);
+        void InitNameStack();
+        void LoadName(unsigned long Name);
+        void PushName(unsigned long Name);
+        void PopName();
+        void SetCurrentMaterial(RenderMaterialT* RenderMaterial);
+        RenderMaterialT* GetCurrentMaterial() const;
+        void LockCurrentMaterial(bool LockCM_);
+        void SetCurrentLightMap(TextureMapI* LightMap);
+        void SetCurrentLightDirMap(TextureMapI* LightDirMap);
+        void SetCurrentSHLMaps(const ArrayT<TextureMapI*>& SHLMaps);
+        void SetCurrentSHLLookupMap(TextureMapI* SHLLookupMap);
+        void RenderMesh(const MeshT& Mesh);
+        StatsT GetStats() const;
+
+
+        private:
+
+        RecordingRendererT(const RecordingRendererT&);  ///< Use of the Copy Constructor    is not allowed.
+        void operator = (const RecordingRendererT&);    ///< Use of the Assignment Operator is not allowed.
+
+        RendererI&                    m_Target;     ///< The renderer that all calls except for RenderMesh() are forwarded to.
+        RenderCommandListT&           m_List;       ///< The list that RenderMesh() records the meshes into.
+        RenderCommandListT::TexturesT m_Textures;   ///< The textures that have been set, which cannot be queried from m_Target.
+    };
+}
+
+#endif
@@ -0,0 +1,507 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/***************************/
+/*** Render Command List ***/
+/***************************/
+
+#include "RenderCommandList.hpp"
+#include "Material.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+
+using namespace MatSys;
+
+
+namespace
+{
+    // Returns in ListType the type of the list of primitives that meshes of the given type can be represented as,
+    // e.g. Triangles for triangle strips and fans. Returns false if there is no such list type (for line strips and loops).
+    bool GetListType(MeshT::TypeT Type, MeshT::TypeT& ListType)
+    {
+        switch (Type)
+        {
+            case MeshT::Points:
+                ListType=MeshT::Points;
+                return true;
+
+            case MeshT::Lines:
+                ListType=MeshT::Lines;
+                return true;
+
+            case MeshT::Triangles:
+            case MeshT::TriangleStrip:
+            case MeshT::TriangleFan:
+            case MeshT::Quads:
+            case MeshT::QuadStrip:
+            case MeshT::Polygon:
+                ListType=MeshT::Triangles;
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+
+    void AddTriangle(ArrayT<MeshT::VertexT>& Vertices, const ArrayT<MeshT::VertexT>& Src, unsigned long i0, unsigned long i1, unsigned long i2)
+    {
+        Vertices.PushBack(Src[i0]);
+        Vertices.PushBack(Src[i1]);
+        Vertices.PushBack(Src[i2]);
+    }
+
+
+    void Copy3(float* Dest, const float* Src)
+    {
+        Dest[0]=Src[0];
+        Dest[1]=Src[1];
+        Dest[2]=Src[2];
+    }
+
+
+    // Compares commands first by their segment (that they must never leave), then by their state, and finally by
+    // their mesh number, which is the order of recording, so that equal states keep their relative order.
+    struct CommandLessT
+    {
+        template<class CommandT> bool operator () (const CommandT& A, const CommandT& B) const
+        {
+            const std::less<const void*> PtrLess;
+
+            if (A.SegmentNr   != B.SegmentNr  ) return A.SegmentNr < B.SegmentNr;
+            if (A.ShaderID    != B.ShaderID   ) return A.ShaderID  < B.ShaderID;
+            if (A.Material    != B.Material   ) return PtrLess(A.Material,    B.Material);
+            if (A.LightMap    != B.LightMap   ) return PtrLess(A.LightMap,    B.LightMap);
+            if (A.LightDirMap != B.LightDirMap) return PtrLess(A.LightDirMap, B.LightDirMap);
+            if (A.ParamsNr    != B.ParamsNr   ) return A.ParamsNr  < B.ParamsNr;
+
+            return A.MeshNr < B.MeshNr;
+        }
+    };
+}
+
+
+bool RenderCommandListT::ParamsT::IsEqual(const ParamsT& Other) const
+{
+    if (memcmp(Matrices, Other.Matrices, sizeof(Matrices))!=0) return false;
+
+    if (memcmp(AmbientLightColor,        Other.AmbientLightColor,        sizeof(AmbientLightColor       ))!=0) return false;
+    if (memcmp(LightSourcePosition,      Other.LightSourcePosition,      sizeof(LightSourcePosition     ))!=0) return false;
+    if (LightSourceRadius != Other.LightSourceRadius) return false;
+    if (memcmp(LightSourceDiffuseColor,  Other.LightSourceDiffuseColor,  sizeof(LightSourceDiffuseColor ))!=0) return false;
+    if (memcmp(LightSourceSpecularColor, Other.LightSourceSpecularColor, sizeof(LightSourceSpecularColor))!=0) return false;
+    if (memcmp(EyePosition,              Other.EyePosition,              sizeof(EyePosition             ))!=0) return false;
+    if (memcmp(GenPurposeF,              Other.GenPurposeF,              sizeof(GenPurposeF             ))!=0) return false;
+    if (memcmp(GenPurposeI,              Other.GenPurposeI,              sizeof(GenPurposeI             ))!=0) return false;
+
+    if (SHLMaps.Size() != Other.SHLMaps.Size()) return false;
+
+    for (unsigned long MapNr=0; MapNr<SHLMaps.Size(); MapNr++)
+        if (SHLMaps[MapNr] != Other.SHLMaps[MapNr]) return false;
+
+    return SHLLookupMap == Other.SHLLookupMap;
+}
+
+
+RenderCommandListT::RenderCommandListT()
+    : m_Segments(),
+      m_NewSegment(true),
+      m_Params(),
+      m_Meshes(),
+      m_Commands(),
+      m_MergedMeshes(),
+      m_Batches()
+{
+}
+
+
+void RenderCommandListT::Clear()
+{
+    m_Segments.Overwrite();
+    m_NewSegment=true;
+    m_Params.Overwrite();
+    m_Meshes.Overwrite();
+    m_Commands.Overwrite();
+    m_MergedMeshes.Overwrite();
+    m_Batches.Overwrite();
+}
+
+
+void RenderCommandListT::RecordRenderAction(RendererI::RenderActionT RenderAction)
+{
+    SegmentT Segment;
+
+    Segment.RenderAction    =RenderAction;
+    Segment.SetsRenderAction=true;
+    Segment.IsBarrier       =false;
+
+    m_Segments.PushBack(Segment);
+    m_NewSegment=false;
+}
+
+
+void RenderCommandListT::Record(const RendererI& Renderer, const TexturesT& Textures, const MeshT& Mesh)
+{
+    const RendererI::RenderActionT RenderAction=Renderer.GetCurrentRenderAction();
+    RenderMaterialT*               RenderMat   =Renderer.GetCurrentMaterial();
+    const MaterialT*               Material    =Renderer.GetMaterialFromRM(RenderMat);
+
+    // Translucent meshes must be rendered in the order of recording, e.g. back-to-front.
+    const bool IsBarrier=(RenderAction==RendererI::AMBIENT && Material!=NULL && !Material->HasDefaultBlendFunc());
+
+    if (m_NewSegment || IsBarrier || m_Segments[m_Segments.Size()-1].RenderAction!=RenderAction)
+    {
+        SegmentT Segment;
+
+        Segment.RenderAction    =RenderAction;
+        Segment.SetsRenderAction=false;
+        Segment.IsBarrier       =IsBarrier;
+
+        m_Segments.PushBack(Segment);
+    }
+
+    // No other meshes must be moved across a barrier.
+    m_NewSegment=IsBarrier;
+
+
+    // Record the parameters, sharing them with the previous command if they are equal.
+    m_Params.PushBackEmpty();
+    ParamsT& Params=m_Params[m_Params.Size()-1];
+
+    for (unsigned int MatrixNr=0; MatrixNr<RendererI::END_MARKER; MatrixNr++)
+        Params.Matrices[MatrixNr]=Renderer.GetMatrix(RendererI::MatrixNameT(MatrixNr));
+
+    Copy3(Params.AmbientLightColor,        Renderer.GetCurrentAmbientLightColor());
+    Copy3(Params.LightSourcePosition,      Renderer.GetCurrentLightSourcePosition());
+    Params.LightSourceRadius=Renderer.GetCurrentLightSourceRadius();
+    Copy3(Params.LightSourceDiffuseColor,  Renderer.GetCurrentLightSourceDiffuseColor());
+    Copy3(Params.LightSourceSpecularColor, Renderer.GetCurrentLightSourceSpecularColor());
+    Copy3(Params.EyePosition,              Renderer.GetCurrentEyePosition());
+
+    for (unsigned int ParamNr=0; ParamNr<NUM_GEN_PURPOSE_PARAMS; ParamNr++)
+    {
+        Params.GenPurposeF[ParamNr]=Renderer.GetGenPurposeRenderingParamF(ParamNr);
+        Params.GenPurposeI[ParamNr]=Renderer.GetGenPurposeRenderingParamI(ParamNr);
+    }
+
+    Params.SHLMaps.Overwrite();
+    Params.SHLMaps.PushBack(Textures.SHLMaps);
+    Params.SHLLookupMap=Textures.SHLLookupMap;
+
+    if (m_Params.Size()>1 && m_Params[m_Params.Size()-2].IsEqual(Params))
+        m_Params.DeleteBack();
+
+
+    // Record the mesh, re-using the memory of the meshes of previous recordings.
+    m_Meshes.PushBackEmpty();
+    MeshT& RecMesh=m_Meshes[m_Meshes.Size()-1];
+
+    RecMesh.Type   =Mesh.Type;
+    RecMesh.Winding=Mesh.Winding;
+    RecMesh.Vertices.Overwrite();
+    RecMesh.Vertices.PushBack(Mesh.Vertices);
+
+
+    CommandT Command;
+
+    Command.SegmentNr  =m_Segments.Size()-1;
+    Command.ShaderID   =0;
+    Command.Material   =RenderMat;
+    Command.LightMap   =Textures.LightMap;
+    Command.LightDirMap=Textures.LightDirMap;
+    Command.ParamsNr   =m_Params.Size()-1;
+    Command.MeshNr     =m_Meshes.Size()-1;
+
+    m_Commands.PushBack(Command);
+
+
+    // Without a call to Optimize(), each command is rendered as recorded.
+    BatchT Batch;
+
+    Batch.CommandNr=m_Commands.Size()-1;
+    Batch.MergedNr =-1;
+
+    m_Batches.PushBack(Batch);
+}
+
+
+bool RenderCommandListT::CanMerge(const MeshT& A, const MeshT& B)
+{
+    MeshT::TypeT ListTypeA;
+    MeshT::TypeT ListTypeB;
+
+    if (A.Winding!=B.Winding) return false;
+    if (!GetListType(A.Type, ListTypeA)) return false;
+    if (!GetListType(B.Type, ListTypeB)) return false;
+
+    return ListTypeA==ListTypeB;
+}
+
+
+void RenderCommandListT::AppendMesh(MeshT& Dest, const MeshT& Src)
+{
+    const ArrayT<MeshT::VertexT>& V=Src.Vertices;
+    const unsigned long           n=V.Size();
+
+    if (Dest.Vertices.Size()==0)
+    {
+        GetListType(Src.Type, Dest.Type);
+        Dest.Winding=Src.Winding;
+    }
+
+    switch (Src.Type)
+    {
+        case MeshT::Points:
+            Dest.Vertices.PushBack(V);
+            break;
+
+        case MeshT::Lines:
+            // Ignore an incomplete last primitive, as it would otherwise be completed with the vertices of the next mesh.
+            for (unsigned long i=0; i+1<n; i+=2)
+            {
+                Dest.Vertices.PushBack(V[i]);
+                Dest.Vertices.PushBack(V[i+1]);
+            }
+            break;
+
+        case MeshT::Triangles:
+            for (unsigned long i=0; i+2<n; i+=3)
+                AddTriangle(Dest.Vertices, V, i, i+1, i+2);
+            break;
+
+        case MeshT::TriangleStrip:
+            // Every other triangle of a strip has its first two vertices swapped, so that all triangles have the same winding.
+            for (unsigned long i=0; i+2<n; i++)
+            {
+                if (i % 2==0) AddTriangle(Dest.Vertices, V, i,   i+1, i+2);
+                         else AddTriangle(Dest.Vertices, V, i+1, i,   i+2);
+            }
+            break;
+
+        case MeshT::TriangleFan:
+        case MeshT::Polygon:
+            for (unsigned long i=1; i+1<n; i++)
+                AddTriangle(Dest.Vertices, V, 0, i, i+1);
+            break;
+
+        case MeshT::Quads:
+            for (unsigned long i=0; i+3<n; i+=4)
+            {
+                AddTriangle(Dest.Vertices, V, i, i+1, i+2);
+                AddTriangle(Dest.Vertices, V, i, i+2, i+3);
+            }
+            break;
+
+        case MeshT::QuadStrip:
+            // The vertices of quad k are 2k, 2k+1, 2k+3, 2k+2.
+            for (unsigned long i=0; i+3<n; i+=2)
+            {
+                AddTriangle(Dest.Vertices, V, i, i+1, i+3);
+                AddTriangle(Dest.Vertices, V, i, i+3, i+2);
+            }
+            break;
+
+        default:
+            // CanMerge() never lets us get here.
+            break;
+    }
+}
+
+
+bool RenderCommandListT::IsEqualState(const CommandT& A, const CommandT& B) const
+{
+    return A.SegmentNr  ==B.SegmentNr   &&
+           A.Material   ==B.Material    &&
+           A.LightMap   ==B.LightMap    &&
+           A.LightDirMap==B.LightDirMap &&
+           (A.ParamsNr==B.ParamsNr || m_Params[A.ParamsNr].IsEqual(m_Params[B.ParamsNr]));
+}
+
+
+void RenderCommandListT::Optimize(const RendererI& Renderer)
+{
+    if (m_Commands.Size()==0) return;
+
+    // Determine the shader IDs, re-using the result of the previous command if possible.
+    for (unsigned long CommandNr=0; CommandNr<m_Commands.Size(); CommandNr++)
+    {
+        CommandT&       Command=m_Commands[CommandNr];
+        const CommandT* Prev   =CommandNr>0 ? &m_Commands[CommandNr-1] : NULL;
+        const bool      IsLight=(m_Segments[Command.SegmentNr].RenderAction==RendererI::LIGHTING);
+
+        if (Prev && Prev->Material==Command.Material && (m_Segments[Prev->SegmentNr].RenderAction==RendererI::LIGHTING)==IsLight)
+        {
+            Command.ShaderID=Prev->ShaderID;
+            continue;
+        }
+
+        Command.ShaderID=IsLight ? Renderer.GetLightShaderIDFromRM(Command.Material) : Renderer.GetAmbientShaderIDFromRM(Command.Material);
+    }
+
+    std::sort(&m_Commands[0], &m_Commands[0]+m_Commands.Size(), CommandLessT());
+
+
+    // Merge the meshes of subsequent commands with the same state.
+    m_MergedMeshes.Overwrite();
+    m_Batches.Overwrite();
+
+    for (unsigned long CommandNr=0; CommandNr<m_Commands.Size(); CommandNr++)
+    {
+        const CommandT&  Command =m_Commands[CommandNr];
+        const MaterialT* Material=Renderer.GetMaterialFromRM(Command.Material);
+
+        // Merging would turn e.g. the outlines of polygons into the outlines of triangles.
+        const bool CanMergeMat=(Material==NULL || Material->PolygonMode==MaterialT::Filled);
+
+        if (m_Batches.Size()>0 && CanMergeMat)
+        {
+            BatchT&         Batch     =m_Batches[m_Batches.Size()-1];
+            const CommandT& First     =m_Commands[Batch.CommandNr];
+            const MeshT&    BatchMesh =Batch.MergedNr>=0 ? m_MergedMeshes[Batch.MergedNr] : m_Meshes[First.MeshNr];
+
+            if (IsEqualState(First, Command) && CanMerge(BatchMesh, m_Meshes[Command.MeshNr]))
+            {
+                if (Batch.MergedNr<0)
+                {
+                    m_MergedMeshes.PushBackEmpty();
+                    Batch.MergedNr=m_MergedMeshes.Size()-1;
+
+                    MeshT& Merged=m_MergedMeshes[Batch.MergedNr];
+
+                    Merged.Vertices.Overwrite();
+                    AppendMesh(Merged, m_Meshes[First.MeshNr]);
+                }
+
+                AppendMesh(m_MergedMeshes[Batch.MergedNr], m_Meshes[Command.MeshNr]);
+                continue;
+            }
+        }
+
+        BatchT Batch;
+
+        Batch.CommandNr=CommandNr;
+        Batch.MergedNr =-1;
+
+        m_Batches.PushBack(Batch);
+    }
+}
+
+
+void RenderCommandListT::ApplyParams(RendererI& Renderer, const ParamsT& Params) const
+{
+    for (unsigned int MatrixNr=0; MatrixNr<RendererI::END_MARKER; MatrixNr++)
+    {
+        const RendererI::MatrixNameT MN=RendererI::MatrixNameT(MatrixNr);
+
+        // Only set the matrices that actually change, as each change can be expensive in the renderer.
+        if (memcmp(&Renderer.GetMatrix(MN), &Params.Matrices[MatrixNr], sizeof(Matrix4x4fT))!=0)
+            Renderer.SetMatrix(MN, Params.Matrices[MatrixNr]);
+    }
+
+    const float* c=Params.AmbientLightColor;
+    Renderer.SetCurrentAmbientLightColor(c[0], c[1], c[2]);
+
+    c=Params.LightSourcePosition;
+    Renderer.SetCurrentLightSourcePosition(c[0], c[1], c[2]);
+    Renderer.SetCurrentLightSourceRadius(Params.LightSourceRadius);
+
+    c=Params.LightSourceDiffuseColor;
+    Renderer.SetCurrentLightSourceDiffuseColor(c[0], c[1], c[2]);
+
+    c=Params.LightSourceSpecularColor;
+    Renderer.SetCurrentLightSourceSpecularColor(c[0], c[1], c[2]);
+
+    c=Params.EyePosition;
+    Renderer.SetCurrentEyePosition(c[0], c[1], c[2]);
+
+    for (unsigned int ParamNr=0; ParamNr<NUM_GEN_PURPOSE_PARAMS; ParamNr++)
+    {
+        Renderer.SetGenPurposeRenderingParam(ParamNr, Params.GenPurposeF[ParamNr]);
+        Renderer.SetGenPurposeRenderingParam(ParamNr, Params.GenPurposeI[ParamNr]);
+    }
+
+    Renderer.SetCurrentSHLMaps(Params.SHLMaps);
+    Renderer.SetCurrentSHLLookupMap(Params.SHLLookupMap);
+}
+
+
+void RenderCommandListT::Replay(RendererI& Renderer) const
+{
+    // Save the state of the renderer that is modified below.
+    const RendererI::RenderActionT OldRenderAction=Renderer.GetCurrentRenderAction();
+    RenderMaterialT* const         OldMaterial    =Renderer.GetCurrentMaterial();
+    float                          OldAmbientLightColor[3];
+    float                          OldGenPurposeF[NUM_GEN_PURPOSE_PARAMS];
+    int                            OldGenPurposeI[NUM_GEN_PURPOSE_PARAMS];
+
+    Copy3(OldAmbientLightColor, Renderer.GetCurrentAmbientLightColor());
+
+    for (unsigned int ParamNr=0; ParamNr<NUM_GEN_PURPOSE_PARAMS; ParamNr++)
+    {
+        OldGenPurposeF[ParamNr]=Renderer.GetGenPurposeRenderingParamF(ParamNr);
+        OldGenPurposeI[ParamNr]=Renderer.GetGenPurposeRenderingParamI(ParamNr);
+    }
+
+    for (unsigned int MatrixNr=0; MatrixNr<RendererI::END_MARKER; MatrixNr++)
+        Renderer.PushMatrix(RendererI::MatrixNameT(MatrixNr));
+
+    Renderer.PushLightingParameters();
+
+
+    unsigned long   NextSegmentNr=0;
+    const CommandT* Prev         =NULL;
+
+    for (unsigned long BatchNr=0; BatchNr<m_Batches.Size(); BatchNr++)
+    {
+        const BatchT&   Batch  =m_Batches[BatchNr];
+        const CommandT& Command=m_Commands[Batch.CommandNr];
+
+        // Make the calls to SetCurrentRenderAction() that were recorded before this command.
+        for (; NextSegmentNr<=Command.SegmentNr; NextSegmentNr++)
+        {
+            const SegmentT& Segment=m_Segments[NextSegmentNr];
+
+            if (Segment.SetsRenderAction || Renderer.GetCurrentRenderAction()!=Segment.RenderAction)
+                Renderer.SetCurrentRenderAction(Segment.RenderAction);
+        }
+
+        if (!Prev || Prev->Material   !=Command.Material   ) Renderer.SetCurrentMaterial   (Command.Material);
+        if (!Prev || Prev->LightMap   !=Command.LightMap   ) Renderer.SetCurrentLightMap   (Command.LightMap);
+        if (!Prev || Prev->LightDirMap!=Command.LightDirMap) Renderer.SetCurrentLightDirMap(Command.LightDirMap);
+        if (!Prev || Prev->ParamsNr   !=Command.ParamsNr   ) ApplyParams(Renderer, m_Params[Command.ParamsNr]);
+
+        Renderer.RenderMesh(Batch.MergedNr>=0 ? m_MergedMeshes[Batch.MergedNr] : m_Meshes[Command.MeshNr]);
+        Prev=&Command;
+    }
+
+    // Make the calls to SetCurrentRenderAction() that were recorded after the last command.
+    for (; NextSegmentNr<m_Segments.Size(); NextSegmentNr++)
+        if (m_Segments[NextSegmentNr].SetsRenderAction)
+            Renderer.SetCurrentRenderAction(m_Segments[NextSegmentNr].RenderAction);
+
+
+    // Restore the state of the renderer.
+    // The render action is only set if it differs, because setting it can have side effects.
+    Renderer.PopLightingParameters();
+
+    for (unsigned int MatrixNr=RendererI::END_MARKER; MatrixNr>0; MatrixNr--)
+        Renderer.PopMatrix(RendererI::MatrixNameT(MatrixNr-1));
+
+    for (unsigned int ParamNr=0; ParamNr<NUM_GEN_PURPOSE_PARAMS; ParamNr++)
+    {
+        Renderer.SetGenPurposeRenderingParam(ParamNr, OldGenPurposeF[ParamNr]);
+        Renderer.SetGenPurposeRenderingParam(ParamNr, OldGenPurposeI[ParamNr]);
+    }
+
+    Renderer.SetCurrentAmbientLightColor(OldAmbientLightColor[0], OldAmbientLightColor[1], OldAmbientLightColor[2]);
+    Renderer.SetCurrentMaterial(OldMaterial);
+
+    if (Renderer.GetCurrentRenderAction()!=OldRenderAction)
+        Renderer.SetCurrentRenderAction(OldRenderAction);
+}
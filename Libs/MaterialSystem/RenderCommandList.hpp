@@ -0,0 +1,149 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/***************************/
+/*** Render Command List ***/
+/***************************/
+
+#ifndef CAFU_MATSYS_RENDER_COMMAND_LIST_HPP_INCLUDED
+#define CAFU_MATSYS_RENDER_COMMAND_LIST_HPP_INCLUDED
+
+#include "Mesh.hpp"
+#include "Renderer.hpp"
+#include "Math3D/Matrix.hpp"
+
+
+namespace MatSys
+{
+    /// A list of render commands: meshes that are recorded together with the renderer state that they are to be rendered with.
+    ///
+    /// RendererI::RenderMesh() is immediate mode: each mesh is rendered right away, with material and state changes
+    /// wherever the calling code happens to visit them. A render command list instead records the meshes (normally via a
+    /// RecordingRendererT), then sorts them by shader and material and merges compatible meshes in Optimize(), and
+    /// finally hands them to the renderer in Replay().
+    ///
+    /// The order of the meshes is only changed where it cannot matter:
+    ///   - Meshes are never moved across calls to RendererI::SetCurrentRenderAction(), because the calls have side effects
+    ///     (e.g. clearing the stencil buffer for the STENCILSHADOW action), and the passes of different light sources must
+    ///     stay separate.
+    ///   - In the AMBIENT action, meshes with translucent materials (see MaterialT::HasDefaultBlendFunc()) are never
+    ///     moved, and no other meshes are moved across them.
+    /// Meshes are only merged if they are rendered with exactly the same state, the same winding and a mesh type that can
+    /// be represented as a list of the same primitive (e.g. triangle fans, strips, quads and polygons as triangles).
+    class RenderCommandListT
+    {
+        public:
+
+        /// The textures that are set in addition to the material.
+        /// As RendererI has no methods for getting them, they must be provided by the caller of Record().
+        struct TexturesT
+        {
+            TexturesT() : LightMap(NULL), LightDirMap(NULL), SHLLookupMap(NULL) { }
+
+            TextureMapI*         LightMap;
+            TextureMapI*         LightDirMap;
+            ArrayT<TextureMapI*> SHLMaps;
+            TextureMapI*         SHLLookupMap;
+        };
+
+
+        /// The constructor.
+        RenderCommandListT();
+
+        /// Removes all commands from the list. The memory of the list is kept for re-use.
+        void Clear();
+
+        /// Records a call to RendererI::SetCurrentRenderAction().
+        void RecordRenderAction(RendererI::RenderActionT RenderAction);
+
+        /// Records the given mesh with the current state of the given renderer and the given textures.
+        /// The mesh is copied, so that the caller is free to modify it after the call.
+        void Record(const RendererI& Renderer, const TexturesT& Textures, const MeshT& Mesh);
+
+        /// Sorts the recorded commands by shader and material and merges compatible meshes.
+        /// @param Renderer   The renderer that the commands are to be replayed with, for determining the shaders of the materials.
+        void Optimize(const RendererI& Renderer);
+
+        /// Renders the commands with the given renderer, setting only the state that changes between subsequent commands.
+        /// The matrices, the lighting parameters, the ambient light color, the general-purpose rendering parameters, the
+        /// current material and the render action of the renderer are restored afterwards.
+        void Replay(RendererI& Renderer) const;
+
+        /// Returns the number of meshes that have been recorded.
+        unsigned long GetNumCommands() const { return m_Commands.Size(); }
+
+        /// Returns the number of meshes that Replay() renders.
+        unsigned long GetNumBatches() const { return m_Batches.Size(); }
+
+
+        private:
+
+        RenderCommandListT(const RenderCommandListT&);  ///< Use of the Copy Constructor    is not allowed.
+        void operator = (const RenderCommandListT&);    ///< Use of the Assignment Operator is not allowed.
+
+        enum { NUM_GEN_PURPOSE_PARAMS=32 };
+
+        /// A sequence of commands that Optimize() may reorder.
+        struct SegmentT
+        {
+            RendererI::RenderActionT RenderAction;      ///< The render action of the commands in this segment.
+            bool                     SetsRenderAction;  ///< Does this segment begin with a call to RendererI::SetCurrentRenderAction()?
+            bool                     IsBarrier;         ///< Does this segment hold a command that no other commands must be moved across?
+        };
+
+        /// The parameters of the renderer that change less often than the material and textures.
+        struct ParamsT
+        {
+            bool IsEqual(const ParamsT& Other) const;
+
+            Matrix4x4fT          Matrices[RendererI::END_MARKER];
+            float                AmbientLightColor[3];
+            float                LightSourcePosition[3];
+            float                LightSourceRadius;
+            float                LightSourceDiffuseColor[3];
+            float                LightSourceSpecularColor[3];
+            float                EyePosition[3];
+            float                GenPurposeF[NUM_GEN_PURPOSE_PARAMS];
+            int                  GenPurposeI[NUM_GEN_PURPOSE_PARAMS];
+            ArrayT<TextureMapI*> SHLMaps;
+            TextureMapI*         SHLLookupMap;
+        };
+
+        struct CommandT
+        {
+            unsigned long    SegmentNr;     ///< The segment of this command in m_Segments.
+            unsigned long    ShaderID;      ///< The ID of the shader of Material for the render action of the segment, set in Optimize().
+            RenderMaterialT* Material;
+            TextureMapI*     LightMap;
+            TextureMapI*     LightDirMap;
+            unsigned long    ParamsNr;      ///< The parameters of this command in m_Params.
+            unsigned long    MeshNr;        ///< The mesh of this command in m_Meshes.
+        };
+
+        /// A mesh that Replay() renders: the mesh of a command, or several meshes of commands with the same state merged into one.
+        struct BatchT
+        {
+            unsigned long CommandNr;        ///< The (first) command of this batch, whose state the mesh is rendered with.
+            long          MergedNr;         ///< The merged mesh in m_MergedMeshes, or -1 if the mesh of the command is rendered.
+        };
+
+        static bool CanMerge(const MeshT& A, const MeshT& B);
+        static void AppendMesh(MeshT& Dest, const MeshT& Src);
+
+        bool IsEqualState(const CommandT& A, const CommandT& B) const;
+        void ApplyParams(RendererI& Renderer, const ParamsT& Params) const;
+
+        ArrayT<SegmentT> m_Segments;        ///< The segments of the recorded commands.
+        bool             m_NewSegment;      ///< Must the next recorded command begin a new segment?
+        ArrayT<ParamsT>  m_Params;          ///< The distinct parameters of the commands. Subsequent commands with equal parameters share an element.
+        ArrayT<MeshT>    m_Meshes;          ///< The recorded meshes. Elements beyond the size are kept for re-use, see Clear().
+        ArrayT<CommandT> m_Commands;        ///< The recorded commands, in the order of recording, sorted in Optimize().
+        ArrayT<MeshT>    m_MergedMeshes;    ///< The meshes that Optimize() has merged from the recorded meshes.
+        ArrayT<BatchT>   m_Batches;         ///< The meshes that Replay() renders, as determined by Optimize().
+    };
+}
+
+#endif
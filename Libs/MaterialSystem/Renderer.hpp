@@ -34,6 +34,16 @@ namespace MatSys
 
         enum RenderActionT { AMBIENT, STENCILSHADOW, LIGHTING };
 
+        /// Statistics about the meshes and state changes that a renderer has processed, see GetStats().
+        struct StatsT
+        {
+            StatsT() : NumDrawCalls(0), NumStateChanges(0), NumVertices(0) { }
+
+            unsigned long NumDrawCalls;     ///< The number of calls to RenderMesh().
+            unsigned long NumStateChanges;  ///< The number of calls that changed the render action, the current material or a lightmap, or that set, transformed, pushed or popped a matrix.
+            unsigned long NumVertices;      ///< The total number of vertices of the meshes that were rendered.
+        };
+
 
         /// Returns true if this renderer is supported on this system (e.g. required OpenGL extensions are present,
         /// version of DirectX matches, ...), and returns false otherwise.
@@ -250,6 +260,11 @@ namespace MatSys
 
         virtual void RenderMesh(const MatSys::MeshT& Mesh)=0;
 
+        /// Returns the statistics about the meshes and state changes that this renderer has processed since the last call
+        /// to BeginFrame(). This is mostly useful for measuring the effect of batching, e.g. with the RenderCommandListT,
+        /// also without a GPU by using the Null renderer. Renderers that don't keep statistics return all zeros.
+        virtual StatsT GetStats() const { return StatsT(); }
+
         /// This ABC does neither have nor need a destructor, because no implementation will ever be deleted via a pointer to a RendererI.
         /// (The implementations are singletons after all.)  See the Singleton pattern and the C++ FAQ 21.05 (the "precise rule") for more information.
         /// g++ however issues a warning with no such destructor, so I provide one anyway and am safe.
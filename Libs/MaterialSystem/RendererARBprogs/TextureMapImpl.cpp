@@ -18,7 +18,9 @@ This project is licensed under the terms of the MIT license.
 
 #include "TextureMapImpl.hpp"
 #include "RendererImpl.hpp"
+#include "../Common/TextureCache.hpp"
 #include "Bitmap/Bitmap.hpp"
+#include "ConsoleCommands/Console.hpp"
 #include "../Common/OpenGLEx.hpp"      // for glext.h
 
 
@@ -28,6 +30,122 @@ inline bool isPowerOf2(unsigned long i)
 }
 
 
+// Returns whether the minification filter of the given map composition requires mipmaps.
+static bool HasMipMaps(const MapCompositionT& MapComp)
+{
+    return MapComp.GetMinFilter()!=MapCompositionT::Nearest && MapComp.GetMinFilter()!=MapCompositionT::Linear;
+}
+
+
+// Uploads the given mipmap chain into the given target of the currently bound texture object.
+static void UploadMipMaps(GLenum Target, GLint InternalFormat, const ArrayT<BitmapT*>& MipMaps)
+{
+    for (unsigned long Level=0; Level<MipMaps.Size(); Level++)
+        glTexImage2D(Target, Level, InternalFormat, MipMaps[Level]->SizeX, MipMaps[Level]->SizeY, 0, GL_RGBA, GL_UNSIGNED_BYTE, &MipMaps[Level]->Data[0]);
+}
+
+
+// Uploads the given mipmap chain of the given texture cache into the given target of the currently bound texture object.
+// Block-compressed levels are uploaded as they are, uncompressed levels with the given internal format.
+static void UploadMipMaps(GLenum Target, GLint InternalFormat, const TextureCacheT& Cache, unsigned long ImageNr)
+{
+    const ArrayT<TextureCacheT::LevelT>& MipMaps=Cache.GetMipMaps(ImageNr);
+
+    for (unsigned long Level=0; Level<MipMaps.Size(); Level++)
+    {
+        const TextureCacheT::LevelT& L=MipMaps[Level];
+
+        switch (Cache.GetFormat())
+        {
+            case TextureCacheT::RGBA: glTexImage2D(Target, Level, InternalFormat, L.SizeX, L.SizeY, 0, GL_RGBA, GL_UNSIGNED_BYTE, &L.Data[0]); break;
+            case TextureCacheT::DXT1: cf::glCompressedTexImage2DARB(Target, Level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,  L.SizeX, L.SizeY, 0, L.Data.Size(), &L.Data[0]); break;
+            case TextureCacheT::DXT5: cf::glCompressedTexImage2DARB(Target, Level, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, L.SizeX, L.SizeY, 0, L.Data.Size(), &L.Data[0]); break;
+        }
+    }
+}
+
+
+// Sets the filters and the wrapping modes of the currently bound texture object as specified in the given map composition.
+static void SetFiltersAndWrapping(GLenum Target, const MapCompositionT& MapComp)
+{
+    switch (MapComp.GetMinFilter())
+    {
+        case MapCompositionT::Nearest:                glTexParameteri(Target, GL_TEXTURE_MIN_FILTER, GL_NEAREST               ); break;
+        case MapCompositionT::Linear:                 glTexParameteri(Target, GL_TEXTURE_MIN_FILTER, GL_LINEAR                ); break;
+        case MapCompositionT::Nearest_MipMap_Nearest: glTexParameteri(Target, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST); break;
+        case MapCompositionT::Nearest_MipMap_Linear:  glTexParameteri(Target, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR ); break;
+        case MapCompositionT::Linear_MipMap_Nearest:  glTexParameteri(Target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST ); break;
+        case MapCompositionT::Linear_MipMap_Linear:   glTexParameteri(Target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR  ); break;
+    }
+
+    switch (MapComp.GetMagFilter())
+    {
+        case MapCompositionT::Nearest: glTexParameteri(Target, GL_TEXTURE_MAG_FILTER, GL_NEAREST); break;
+        default:                       glTexParameteri(Target, GL_TEXTURE_MAG_FILTER, GL_LINEAR ); break;
+    }
+
+    switch (MapComp.GetWrapModeS())
+    {
+        case MapCompositionT::Repeat:      glTexParameteri(Target, GL_TEXTURE_WRAP_S, GL_REPEAT       ); break;
+        case MapCompositionT::Clamp:       glTexParameteri(Target, GL_TEXTURE_WRAP_S, GL_CLAMP        ); break;
+        case MapCompositionT::ClampToEdge: glTexParameteri(Target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); break;
+    }
+
+    switch (MapComp.GetWrapModeT())
+    {
+        case MapCompositionT::Repeat:      glTexParameteri(Target, GL_TEXTURE_WRAP_T, GL_REPEAT       ); break;
+        case MapCompositionT::Clamp:       glTexParameteri(Target, GL_TEXTURE_WRAP_T, GL_CLAMP        ); break;
+        case MapCompositionT::ClampToEdge: glTexParameteri(Target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); break;
+    }
+}
+
+
+// Returns the OpenGL object of a tiny texture that is rendered in place of a texture whose images are still being loaded.
+// The placeholder for normal-maps is a flat normal, the placeholder for all other textures is a neutral grey.
+static GLuint GetPlaceholderObject(bool IsCubeMap, const MapCompositionT& MapComp)
+{
+    static GLuint        Objects[3]={ 0, 0, 0 };
+    static unsigned long ObjectsInitCounter=0;
+
+    if (ObjectsInitCounter!=RendererImplT::GetInstance().GetInitCounter())
+    {
+        // The objects of the previous rendering context are gone with it.
+        for (unsigned long Nr=0; Nr<3; Nr++) Objects[Nr]=0;
+
+        ObjectsInitCounter=RendererImplT::GetInstance().GetInitCounter();
+    }
+
+    const MapCompositionT::TypeT Type=MapComp.GetType();
+    const bool IsNormalMap=!IsCubeMap && (Type==MapCompositionT::CombineNormals || Type==MapCompositionT::HeightMapToNormalMap ||
+                                          Type==MapCompositionT::FlipNormalMapYAxis || Type==MapCompositionT::ReNormalize);
+    const unsigned long Nr=IsCubeMap ? 2 : (IsNormalMap ? 1 : 0);
+
+    if (Objects[Nr]==0)
+    {
+        const GLenum  Target  =IsCubeMap ? GL_TEXTURE_CUBE_MAP_ARB : GL_TEXTURE_2D;
+        const GLubyte Texel[4]={ 128, 128, GLubyte(IsNormalMap ? 255 : 128), 255 };
+
+        glGenTextures(1, &Objects[Nr]);
+        glBindTexture(Target, Objects[Nr]);
+
+        if (IsCubeMap)
+        {
+            for (unsigned long SideNr=0; SideNr<6; SideNr++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X_ARB+SideNr, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, Texel);
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, Texel);
+        }
+
+        glTexParameteri(Target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(Target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+
+    return Objects[Nr];
+}
+
+
 /*********************/
 /*** TextureMap2DT ***/
 /*********************/
@@ -35,6 +153,7 @@ inline bool isPowerOf2(unsigned long i)
 TextureMap2DT::TextureMap2DT(const MapCompositionT& MapComp_)
     : Source(MC),
       MapComp(MapComp_),
+      LoadJob(NULL),
       Bitmap(NULL),
       Data(NULL),
       SizeX(0),
@@ -49,6 +168,7 @@ TextureMap2DT::TextureMap2DT(const MapCompositionT& MapComp_)
 TextureMap2DT::TextureMap2DT(char* Data_, unsigned long SizeX_, unsigned long SizeY_, char BytesPerPixel_, bool MakePrivateCopy, const MapCompositionT& McForFiltersAndWrapping)
     : Source(MakePrivateCopy ? RawPtrOwn : RawPtrExt),
       MapComp(McForFiltersAndWrapping),
+      LoadJob(NULL),
       Bitmap(NULL),
       // Assume that all rows are aligned on 4-byte boundaries! See OpenGL Programming Guide (Red Book), p. 311.
       Data(MakePrivateCopy ? new char[((SizeX_*BytesPerPixel_+3) & 0xFFFFFFFC)*SizeY_] : Data_),
@@ -68,6 +188,7 @@ TextureMap2DT::TextureMap2DT(char* Data_, unsigned long SizeX_, unsigned long Si
 TextureMap2DT::TextureMap2DT(BitmapT* Bitmap_, bool MakePrivateCopy, const MapCompositionT& McForFiltersAndWrapping)
     : Source(MakePrivateCopy ? BitmapPtrOwn : BitmapPtrExt),
       MapComp(McForFiltersAndWrapping),
+      LoadJob(NULL),
       Bitmap(MakePrivateCopy ? new BitmapT(*Bitmap_) : Bitmap_),
       Data(NULL),
       SizeX(0),
@@ -87,9 +208,16 @@ bool TextureMap2DT::IsCreatedFromMapComp(const MapCompositionT& MC_)
 
 TextureMap2DT::~TextureMap2DT()
 {
+    if (LoadJob!=NULL)
+    {
+        // Make sure that no worker thread is still working on the job.
+        TextureMapManagerImplT::Get().GetLoader().Cancel(LoadJob);
+        delete LoadJob;
+    }
+
     switch (Source)
     {
-        case MC:           delete Bitmap; break;
+        case MC:                          break;
         case RawPtrExt:                   break;
         case RawPtrOwn:    delete[] Data; break;
         case BitmapPtrExt:                break;
@@ -108,8 +236,7 @@ unsigned int TextureMap2DT::GetSizeX()
     switch (Source)
     {
         case MC:
-            if (!Bitmap) Bitmap=MapComp.GetBitmap();
-            return Bitmap->SizeX;
+            return GetLoadJob(true)->GetSizeX();
 
         case RawPtrExt:
         case RawPtrOwn:
@@ -129,8 +256,7 @@ unsigned int TextureMap2DT::GetSizeY()
     switch (Source)
     {
         case MC:
-            if (!Bitmap) Bitmap=MapComp.GetBitmap();
-            return Bitmap->SizeY;
+            return GetLoadJob(true)->GetSizeY();
 
         case RawPtrExt:
         case RawPtrOwn:
@@ -145,6 +271,35 @@ unsigned int TextureMap2DT::GetSizeY()
 }
 
 
+TextureLoadJobT* TextureMap2DT::GetLoadJob(bool WaitForCompletion)
+{
+    TextureMapManagerImplT& TexMapMan=TextureMapManagerImplT::Get();
+    TextureLoaderT&         Loader   =TexMapMan.GetLoader();
+
+    if (LoadJob!=NULL && LoadJob->GetMaxSize()!=TexMapMan.GetMaxTextureSize())
+    {
+        // The max. texture size has changed since the job was created, so the image must be prepared anew.
+        Loader.Cancel(LoadJob);
+        delete LoadJob;
+        LoadJob=NULL;
+    }
+
+    if (LoadJob==NULL)
+    {
+        ArrayT<MapCompositionT> Images;
+
+        Images.PushBack(MapComp);
+        LoadJob=new TextureLoadJobT(Images, TexMapMan.GetMaxTextureSize(), MapComp.GetNoScaleDown(), HasMipMaps(MapComp),
+                                    cf::GL_EXT_texture_compression_s3tc_AVAIL && !MapComp.GetNoCompression());
+
+        if (TexMapMan.GetBackgroundLoading()) Loader.Add(LoadJob);
+    }
+
+    if (WaitForCompletion || !TexMapMan.GetBackgroundLoading()) Loader.Finish(LoadJob);
+    return LoadJob;
+}
+
+
 GLuint TextureMap2DT::GetOpenGLObject()
 {
     if (InitCounter<RendererImplT::GetInstance().GetInitCounter())
@@ -154,94 +309,43 @@ GLuint TextureMap2DT::GetOpenGLObject()
         switch (Source)
         {
             case MC:
-            case BitmapPtrExt:
-            case BitmapPtrOwn:
             {
-                if (Source==MC && !Bitmap) Bitmap=MapComp.GetBitmap();
-
-                BitmapT* ScaledBitmap=NULL;
-                const unsigned long MaxSize=TextureMapManagerImplT::Get().GetMaxTextureSize();
-
-                // Scale to next smaller power of 2 and to or below the max. texture size.
-                if (isPowerOf2(Bitmap->SizeX) && isPowerOf2(Bitmap->SizeY) && Bitmap->SizeX<=MaxSize && Bitmap->SizeY<=MaxSize)
-                {
-                    // The side lengths of Bitmap are already powers of 2 and at or below MaxSize - no need to scale.
-                    ScaledBitmap=Bitmap;
-                }
-                else
-                {
-                    ScaledBitmap=new BitmapT(*Bitmap);
+                TextureLoadJobT* Job=GetLoadJob(false);
 
-                    unsigned long NewX=1; while (2*NewX<=Bitmap->SizeX) NewX*=2;
-                    unsigned long NewY=1; while (2*NewY<=Bitmap->SizeY) NewY*=2;
+                // Render with a placeholder until the image has been loaded in the background.
+                if (!Job->IsDone()) return GetPlaceholderObject(false, MapComp);
 
-                    if (!MapComp.GetNoScaleDown())
-                    {
-                        // Note that NewX and NewY are now NOT treated independently of each other.
-                        while (NewX>1 && NewY>1 && NewX>MaxSize && NewY>MaxSize)
-                        {
-                            NewX/=2;
-                            NewY/=2;
-                        }
-                    }
-
-                    ScaledBitmap->Scale(NewX, NewY);
-                }
+                const std::string Warnings=Job->TakeWarnings();
+                if (Warnings!="") Console->Warning(Warnings);
 
                 glGenTextures(1, &OpenGLObject);
                 glBindTexture(GL_TEXTURE_2D, OpenGLObject);
 
-                if (MapComp.GetMinFilter()==MapCompositionT::Nearest || MapComp.GetMinFilter()==MapCompositionT::Linear)
-                {
-                    glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat, ScaledBitmap->SizeX, ScaledBitmap->SizeY, 0, GL_RGBA, GL_UNSIGNED_BYTE, &ScaledBitmap->Data[0]);
-                }
+                if (Job->GetCache()!=NULL)
+                    UploadMipMaps(GL_TEXTURE_2D, InternalFormat, *Job->GetCache(), 0);
                 else
-                {
-                    // Note that the gluBuild2DMipmaps() function can fail, but we ignore any errors.
-                    gluBuild2DMipmaps(GL_TEXTURE_2D, InternalFormat, ScaledBitmap->SizeX, ScaledBitmap->SizeY, GL_RGBA, GL_UNSIGNED_BYTE, &ScaledBitmap->Data[0]);
-                }
+                    UploadMipMaps(GL_TEXTURE_2D, InternalFormat, Job->GetMipMaps(0));
 
-                switch (MapComp.GetMinFilter())
-                {
-                    case MapCompositionT::Nearest:                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST               ); break;
-                    case MapCompositionT::Linear:                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR                ); break;
-                    case MapCompositionT::Nearest_MipMap_Nearest: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST); break;
-                    case MapCompositionT::Nearest_MipMap_Linear:  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR ); break;
-                    case MapCompositionT::Linear_MipMap_Nearest:  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST ); break;
-                    case MapCompositionT::Linear_MipMap_Linear:   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR  ); break;
-                }
+                SetFiltersAndWrapping(GL_TEXTURE_2D, MapComp);
+                break;
+            }
 
-                switch (MapComp.GetMagFilter())
-                {
-                    case MapCompositionT::Nearest: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); break;
-                    default:                       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR ); break;
-                }
+            case BitmapPtrExt:
+            case BitmapPtrOwn:
+            {
+                ArrayT<BitmapT*> MipMaps;
 
-                switch (MapComp.GetWrapModeS())
-                {
-                    case MapCompositionT::Repeat:      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT       ); break;
-                    case MapCompositionT::Clamp:       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP        ); break;
-                    case MapCompositionT::ClampToEdge: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); break;
-                }
+                TextureLoadJobT::MakeMipMaps(new BitmapT(*Bitmap), TextureMapManagerImplT::Get().GetMaxTextureSize(), MapComp.GetNoScaleDown(), HasMipMaps(MapComp), MipMaps);
 
-                switch (MapComp.GetWrapModeT())
-                {
-                    case MapCompositionT::Repeat:      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT       ); break;
-                    case MapCompositionT::Clamp:       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP        ); break;
-                    case MapCompositionT::ClampToEdge: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); break;
-                }
+                glGenTextures(1, &OpenGLObject);
+                glBindTexture(GL_TEXTURE_2D, OpenGLObject);
 
-                if (ScaledBitmap!=Bitmap)
-                {
-                    delete ScaledBitmap;
-                    ScaledBitmap=NULL;
-                }
+                UploadMipMaps(GL_TEXTURE_2D, InternalFormat, MipMaps);
+                SetFiltersAndWrapping(GL_TEXTURE_2D, MapComp);
 
-                // if (Source==MC && WantToUnloadBitmapAfterOpenGLObjGen)
-                // {
-                //     delete Bitmap;
-                //     Bitmap=NULL;
-                // }
+                for (unsigned long Level=0; Level<MipMaps.Size(); Level++)
+                    delete MipMaps[Level];
+                break;
             }
 
             case RawPtrExt:
@@ -252,7 +356,7 @@ GLuint TextureMap2DT::GetOpenGLObject()
                     glGenTextures(1, &OpenGLObject);
                     glBindTexture(GL_TEXTURE_2D, OpenGLObject);
 
-                    if (MapComp.GetMinFilter()==MapCompositionT::Nearest || MapComp.GetMinFilter()==MapCompositionT::Linear)
+                    if (!HasMipMaps(MapComp))
                     {
                         glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat, SizeX, SizeY, 0, BytesPerPixel==3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, Data);
                     }
@@ -262,36 +366,9 @@ GLuint TextureMap2DT::GetOpenGLObject()
                         gluBuild2DMipmaps(GL_TEXTURE_2D, InternalFormat, SizeX, SizeY, BytesPerPixel==3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, Data);
                     }
 
-                    switch (MapComp.GetMinFilter())
-                    {
-                        case MapCompositionT::Nearest:                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST               ); break;
-                        case MapCompositionT::Linear:                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR                ); break;
-                        case MapCompositionT::Nearest_MipMap_Nearest: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST); break;
-                        case MapCompositionT::Nearest_MipMap_Linear:  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR ); break;
-                        case MapCompositionT::Linear_MipMap_Nearest:  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST ); break;
-                        case MapCompositionT::Linear_MipMap_Linear:   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR  ); break;
-                    }
-
-                    switch (MapComp.GetMagFilter())
-                    {
-                        case MapCompositionT::Nearest: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); break;
-                        default:                       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR ); break;
-                    }
-
-                    switch (MapComp.GetWrapModeS())
-                    {
-                        case MapCompositionT::Repeat:      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT       ); break;
-                        case MapCompositionT::Clamp:       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP        ); break;
-                        case MapCompositionT::ClampToEdge: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); break;
-                    }
-
-                    switch (MapComp.GetWrapModeT())
-                    {
-                        case MapCompositionT::Repeat:      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT       ); break;
-                        case MapCompositionT::Clamp:       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP        ); break;
-                        case MapCompositionT::ClampToEdge: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); break;
-                    }
+                    SetFiltersAndWrapping(GL_TEXTURE_2D, MapComp);
                 }
+                break;
             }
         }
 
@@ -341,6 +418,7 @@ std::string TextureMapCubeT::GetFullCubeMapString(std::string BaseString, unsign
 TextureMapCubeT::TextureMapCubeT(const MapCompositionT& MapComp_)
     : Source(Files),
       MapComp(MapComp_),
+      LoadJob(NULL),
       SizeX(0),
       SizeY(0),
       BytesPerPixel(0),
@@ -355,6 +433,7 @@ TextureMapCubeT::TextureMapCubeT(const MapCompositionT& MapComp_)
 TextureMapCubeT::TextureMapCubeT(char* Data_[6], unsigned long SizeX_, unsigned long SizeY_, char BytesPerPixel_, bool MakePrivateCopy, const MapCompositionT& McForFiltersAndWrapping)
     : Source(MakePrivateCopy ? RawPtrOwn : RawPtrExt),
       MapComp(McForFiltersAndWrapping),
+      LoadJob(NULL),
       SizeX(SizeX_),
       SizeY(SizeY_),
       BytesPerPixel(BytesPerPixel_),
@@ -377,6 +456,7 @@ TextureMapCubeT::TextureMapCubeT(char* Data_[6], unsigned long SizeX_, unsigned
 TextureMapCubeT::TextureMapCubeT(BitmapT* Bitmap_[6], bool MakePrivateCopy, const MapCompositionT& McForFiltersAndWrapping)
     : Source(MakePrivateCopy ? BitmapPtrOwn : BitmapPtrExt),
       MapComp(McForFiltersAndWrapping),
+      LoadJob(NULL),
       SizeX(0),
       SizeY(0),
       BytesPerPixel(0),
@@ -396,9 +476,16 @@ bool TextureMapCubeT::IsCreatedFromMapComp(const MapCompositionT& MC_)
 
 TextureMapCubeT::~TextureMapCubeT()
 {
+    if (LoadJob!=NULL)
+    {
+        // Make sure that no worker thread is still working on the job.
+        TextureMapManagerImplT::Get().GetLoader().Cancel(LoadJob);
+        delete LoadJob;
+    }
+
     switch (Source)
     {
-        case Files:        for (int i=0; i<6; i++) delete Bitmap[i]; break;
+        case Files:                                                  break;
         case RawPtrExt:                                              break;
         case RawPtrOwn:    for (int i=0; i<6; i++) delete[] Data[i]; break;
         case BitmapPtrExt:                                           break;
@@ -417,12 +504,7 @@ unsigned int TextureMapCubeT::GetSizeX()
     switch (Source)
     {
         case Files:
-            if (!Bitmap[0])
-            {
-                TextParserT TP(GetFullCubeMapString(MapComp.GetString(), 0).c_str(), "({[]}),", false);
-                Bitmap[0]=MapCompositionT(TP, MapComp.GetBaseDir()).GetBitmap();
-            }
-            return Bitmap[0]->SizeX;
+            return GetLoadJob(true)->GetSizeX();
 
         case RawPtrExt:
         case RawPtrOwn:
@@ -442,12 +524,7 @@ unsigned int TextureMapCubeT::GetSizeY()
     switch (Source)
     {
         case Files:
-            if (!Bitmap[0])
-            {
-                TextParserT TP(GetFullCubeMapString(MapComp.GetString(), 0).c_str(), "({[]}),", false);
-                Bitmap[0]=MapCompositionT(TP, MapComp.GetBaseDir()).GetBitmap();
-            }
-            return Bitmap[0]->SizeY;
+            return GetLoadJob(true)->GetSizeY();
 
         case RawPtrExt:
         case RawPtrOwn:
@@ -462,6 +539,41 @@ unsigned int TextureMapCubeT::GetSizeY()
 }
 
 
+TextureLoadJobT* TextureMapCubeT::GetLoadJob(bool WaitForCompletion)
+{
+    TextureMapManagerImplT& TexMapMan=TextureMapManagerImplT::Get();
+    TextureLoaderT&         Loader   =TexMapMan.GetLoader();
+
+    if (LoadJob!=NULL && LoadJob->GetMaxSize()!=TexMapMan.GetMaxTextureSize())
+    {
+        // The max. texture size has changed since the job was created, so the images must be prepared anew.
+        Loader.Cancel(LoadJob);
+        delete LoadJob;
+        LoadJob=NULL;
+    }
+
+    if (LoadJob==NULL)
+    {
+        ArrayT<MapCompositionT> Images;
+
+        for (unsigned long SideNr=0; SideNr<6; SideNr++)
+        {
+            TextParserT TP(GetFullCubeMapString(MapComp.GetString(), SideNr).c_str(), "({[]}),", false);
+            Images.PushBack(MapCompositionT(TP, MapComp.GetBaseDir()));
+        }
+
+        LoadJob=new TextureLoadJobT(Images, TexMapMan.GetMaxTextureSize(), MapComp.GetNoScaleDown(), HasMipMaps(MapComp),
+                                    cf::GL_EXT_texture_compression_s3tc_AVAIL && !MapComp.GetNoCompression());
+
+        if (TexMapMan.GetBackgroundLoading()) Loader.Add(LoadJob);
+    }
+
+    if (WaitForCompletion || !TexMapMan.GetBackgroundLoading()) Loader.Finish(LoadJob);
+    return LoadJob;
+}
+
+
+
 GLuint TextureMapCubeT::GetOpenGLObject()
 {
     // The GL_ARB_texture_cube_map_AVAIL query in the next line is only because the OpenGL 1.2 renderer
@@ -476,101 +588,49 @@ GLuint TextureMapCubeT::GetOpenGLObject()
         switch (Source)
         {
             case Files:
-            case BitmapPtrExt:
-            case BitmapPtrOwn:
             {
+                TextureLoadJobT* Job=GetLoadJob(false);
+
+                // Render with a placeholder until the images have been loaded in the background.
+                if (!Job->IsDone()) return GetPlaceholderObject(true, MapComp);
+
+                const std::string Warnings=Job->TakeWarnings();
+                if (Warnings!="") Console->Warning(Warnings);
+
                 glGenTextures(1, &OpenGLObject);
                 glBindTexture(GL_TEXTURE_CUBE_MAP_ARB, OpenGLObject);
 
                 for (unsigned long SideNr=0; SideNr<6; SideNr++)
                 {
-                    if (Source==Files && !Bitmap[SideNr])
-                    {
-                        TextParserT TP(GetFullCubeMapString(MapComp.GetString(), SideNr).c_str(), "({[]}),", false);
-                        Bitmap[SideNr]=MapCompositionT(TP, MapComp.GetBaseDir()).GetBitmap();
-                    }
-
-                    BitmapT* ScaledBitmap=NULL;
-                    const unsigned long MaxSize=TextureMapManagerImplT::Get().GetMaxTextureSize();
-
-                    // Scale to next smaller power of 2 and to or below the max. texture size.
-                    if (isPowerOf2(Bitmap[SideNr]->SizeX) && isPowerOf2(Bitmap[SideNr]->SizeY) && Bitmap[SideNr]->SizeX<=MaxSize && Bitmap[SideNr]->SizeY<=MaxSize)
-                    {
-                        // The side lengths of Bitmap are already powers of 2 and at or below MaxSize - no need to scale.
-                        ScaledBitmap=Bitmap[SideNr];
-                    }
+                    if (Job->GetCache()!=NULL)
+                        UploadMipMaps(CubeTargets[SideNr], InternalFormat, *Job->GetCache(), SideNr);
                     else
-                    {
-                        ScaledBitmap=new BitmapT(*Bitmap[SideNr]);
-
-                        unsigned long NewX=1; while (2*NewX<=Bitmap[SideNr]->SizeX) NewX*=2;
-                        unsigned long NewY=1; while (2*NewY<=Bitmap[SideNr]->SizeY) NewY*=2;
-
-                        if (!MapComp.GetNoScaleDown())
-                        {
-                            // Note that NewX and NewY are now NOT treated independently of each other.
-                            while (NewX>1 && NewY>1 && NewX>MaxSize && NewY>MaxSize)
-                            {
-                                NewX/=2;
-                                NewY/=2;
-                            }
-                        }
-
-                        ScaledBitmap->Scale(NewX, NewY);
-                    }
-
-                    if (MapComp.GetMinFilter()==MapCompositionT::Nearest || MapComp.GetMinFilter()==MapCompositionT::Linear)
-                    {
-                        glTexImage2D(CubeTargets[SideNr], 0, InternalFormat, ScaledBitmap->SizeX, ScaledBitmap->SizeY, 0, GL_RGBA, GL_UNSIGNED_BYTE, &ScaledBitmap->Data[0]);
-                    }
-                    else
-                    {
-                        // Note that the gluBuild2DMipmaps() function can fail, but we ignore any errors.
-                        gluBuild2DMipmaps(CubeTargets[SideNr], InternalFormat, ScaledBitmap->SizeX, ScaledBitmap->SizeY, GL_RGBA, GL_UNSIGNED_BYTE, &ScaledBitmap->Data[0]);
-                    }
+                        UploadMipMaps(CubeTargets[SideNr], InternalFormat, Job->GetMipMaps(SideNr));
+                }
 
-                    if (ScaledBitmap!=Bitmap[SideNr])
-                    {
-                        delete ScaledBitmap;
-                        ScaledBitmap=NULL;
-                    }
+                SetFiltersAndWrapping(GL_TEXTURE_CUBE_MAP_ARB, MapComp);
+                break;
+            }
 
-                    // if (Source==Files && WantToUnloadBitmapAfterOpenGLObjGen)
-                    // {
-                    //     delete Bitmap[SideNr];
-                    //     Bitmap[SideNr]=NULL;
-                    // }
-                }
+            case BitmapPtrExt:
+            case BitmapPtrOwn:
+            {
+                glGenTextures(1, &OpenGLObject);
+                glBindTexture(GL_TEXTURE_CUBE_MAP_ARB, OpenGLObject);
 
-                switch (MapComp.GetMinFilter())
+                for (unsigned long SideNr=0; SideNr<6; SideNr++)
                 {
-                    case MapCompositionT::Nearest:                glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MIN_FILTER, GL_NEAREST               ); break;
-                    case MapCompositionT::Linear:                 glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MIN_FILTER, GL_LINEAR                ); break;
-                    case MapCompositionT::Nearest_MipMap_Nearest: glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST); break;
-                    case MapCompositionT::Nearest_MipMap_Linear:  glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR ); break;
-                    case MapCompositionT::Linear_MipMap_Nearest:  glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST ); break;
-                    case MapCompositionT::Linear_MipMap_Linear:   glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR  ); break;
-                }
+                    ArrayT<BitmapT*> MipMaps;
 
-                switch (MapComp.GetMagFilter())
-                {
-                    case MapCompositionT::Nearest: glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MAG_FILTER, GL_NEAREST); break;
-                    default:                       glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MAG_FILTER, GL_LINEAR ); break;
-                }
+                    TextureLoadJobT::MakeMipMaps(new BitmapT(*Bitmap[SideNr]), TextureMapManagerImplT::Get().GetMaxTextureSize(), MapComp.GetNoScaleDown(), HasMipMaps(MapComp), MipMaps);
+                    UploadMipMaps(CubeTargets[SideNr], InternalFormat, MipMaps);
 
-                switch (MapComp.GetWrapModeS())
-                {
-                    case MapCompositionT::Repeat:      glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_WRAP_S, GL_REPEAT       ); break;
-                    case MapCompositionT::Clamp:       glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_WRAP_S, GL_CLAMP        ); break;
-                    case MapCompositionT::ClampToEdge: glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); break;
+                    for (unsigned long Level=0; Level<MipMaps.Size(); Level++)
+                        delete MipMaps[Level];
                 }
 
-                switch (MapComp.GetWrapModeT())
-                {
-                    case MapCompositionT::Repeat:      glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_WRAP_T, GL_REPEAT       ); break;
-                    case MapCompositionT::Clamp:       glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_WRAP_T, GL_CLAMP        ); break;
-                    case MapCompositionT::ClampToEdge: glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); break;
-                }
+                SetFiltersAndWrapping(GL_TEXTURE_CUBE_MAP_ARB, MapComp);
+                break;
             }
 
             case RawPtrExt:
@@ -583,7 +643,7 @@ GLuint TextureMapCubeT::GetOpenGLObject()
 
                     for (unsigned long SideNr=0; SideNr<6; SideNr++)
                     {
-                        if (MapComp.GetMinFilter()==MapCompositionT::Nearest || MapComp.GetMinFilter()==MapCompositionT::Linear)
+                        if (!HasMipMaps(MapComp))
                         {
                             glTexImage2D(CubeTargets[SideNr], 0, InternalFormat, SizeX, SizeY, 0, BytesPerPixel==3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, Data[SideNr]);
                         }
@@ -594,36 +654,9 @@ GLuint TextureMapCubeT::GetOpenGLObject()
                         }
                     }
 
-                    switch (MapComp.GetMinFilter())
-                    {
-                        case MapCompositionT::Nearest:                glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MIN_FILTER, GL_NEAREST               ); break;
-                        case MapCompositionT::Linear:                 glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MIN_FILTER, GL_LINEAR                ); break;
-                        case MapCompositionT::Nearest_MipMap_Nearest: glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST); break;
-                        case MapCompositionT::Nearest_MipMap_Linear:  glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR ); break;
-                        case MapCompositionT::Linear_MipMap_Nearest:  glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST ); break;
-                        case MapCompositionT::Linear_MipMap_Linear:   glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR  ); break;
-                    }
-
-                    switch (MapComp.GetMagFilter())
-                    {
-                        case MapCompositionT::Nearest: glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MAG_FILTER, GL_NEAREST); break;
-                        default:              glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_MAG_FILTER, GL_LINEAR ); break;
-                    }
-
-                    switch (MapComp.GetWrapModeS())
-                    {
-                        case MapCompositionT::Repeat:      glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_WRAP_S, GL_REPEAT       ); break;
-                        case MapCompositionT::Clamp:       glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_WRAP_S, GL_CLAMP        ); break;
-                        case MapCompositionT::ClampToEdge: glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); break;
-                    }
-
-                    switch (MapComp.GetWrapModeT())
-                    {
-                        case MapCompositionT::Repeat:      glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_WRAP_T, GL_REPEAT       ); break;
-                        case MapCompositionT::Clamp:       glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_WRAP_T, GL_CLAMP        ); break;
-                        case MapCompositionT::ClampToEdge: glTexParameteri(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); break;
-                    }
+                    SetFiltersAndWrapping(GL_TEXTURE_CUBE_MAP_ARB, MapComp);
                 }
+                break;
             }
         }
 
@@ -662,6 +695,12 @@ unsigned long TextureMapManagerImplT::GetMaxTextureSize() const
 }
 
 
+void TextureMapManagerImplT::SetBackgroundLoading(bool Enable)
+{
+    BackgroundLoading=Enable;
+}
+
+
 MatSys::TextureMapI* TextureMapManagerImplT::GetTextureMap2D(const MapCompositionT& MC)
 {
     return GetTextureMap2DInternal(MC);
@@ -21,6 +21,7 @@ This project is licensed under the terms of the MIT license.
 
 #include "../MapComposition.hpp"
 #include "../TextureMap.hpp"
+#include "../Common/TextureLoader.hpp"
 
 
 /// This class represents a texture-map.
@@ -55,7 +56,8 @@ class TextureMap2DT : public TextureMapImplT
     SourceT         Source;
 
     MapCompositionT MapComp;        ///< Used for Source==MC (and for *ALL* source types for the min/mag filters and wrapping mode).
-    BitmapT*        Bitmap;         ///< Used for Source==MC or Source==BitmapPtr*
+    TextureLoadJobT* LoadJob;       ///< Used for Source==MC: Loads the bitmap and computes its mipmaps, normally in the background.
+    BitmapT*        Bitmap;         ///< Used for Source==BitmapPtr*
 
     char*           Data;           ///< Used for Source==RawPtr*
     unsigned long   SizeX;          ///< Used for Source==RawPtr*
@@ -65,6 +67,10 @@ class TextureMap2DT : public TextureMapImplT
     GLuint          OpenGLObject;
     unsigned long   InitCounter;    ///< Do we have to re-upload the Bitmap?
 
+    /// Returns the load job for the images of this texture, creating it if necessary.
+    /// The job is complete on return if WaitForCompletion is true or if background loading is disabled.
+    TextureLoadJobT* GetLoadJob(bool WaitForCompletion);
+
 
     public:
 
@@ -106,7 +112,8 @@ class TextureMapCubeT : public TextureMapImplT
     SourceT         Source;
 
     MapCompositionT MapComp;        ///< Used for all source types for the min/mag filters and wrapping modes. If Source==Files, MapComp.GetString() is used as the cube map base name (with '#' placeholders).
-    BitmapT*        Bitmap[6];      ///< Used for Source==Files or Source==BitmapPtr*
+    TextureLoadJobT* LoadJob;       ///< Used for Source==Files: Loads the six bitmaps and computes their mipmaps, normally in the background.
+    BitmapT*        Bitmap[6];      ///< Used for Source==BitmapPtr*
 
     char*           Data[6];        ///< Used for Source==RawPtr*
     unsigned long   SizeX;          ///< Used for Source==RawPtr*
@@ -116,6 +123,10 @@ class TextureMapCubeT : public TextureMapImplT
     GLuint          OpenGLObject;
     unsigned long   InitCounter;    ///< Do we have to re-upload the Bitmap?
 
+    /// Returns the load job for the images of this texture, creating it if necessary.
+    /// The job is complete on return if WaitForCompletion is true or if background loading is disabled.
+    TextureLoadJobT* GetLoadJob(bool WaitForCompletion);
+
 
     public:
 
@@ -146,6 +157,7 @@ class TextureMapManagerImplT : public MatSys::TextureMapManagerI
     // TextureMapManagerI implementation.
     void SetMaxTextureSize(unsigned long MaxSize);
     unsigned long GetMaxTextureSize() const;
+    void SetBackgroundLoading(bool Enable);
     MatSys::TextureMapI* GetTextureMap2D(const MapCompositionT& MapComp);
     MatSys::TextureMapI* GetTextureMap2D(char* Data, unsigned long SizeX, unsigned long SizeY, char BytesPerPixel, bool MakePrivateCopy, const MapCompositionT& McForFiltersAndWrapping);
     MatSys::TextureMapI* GetTextureMap2D(BitmapT* Bitmap, bool MakePrivateCopy, const MapCompositionT& McForFiltersAndWrapping);
@@ -194,6 +206,12 @@ class TextureMapManagerImplT : public MatSys::TextureMapManagerI
     /// Returns a reference to the texture-map repository.
     const ArrayT<TextureMapImplT*>& GetTexMapRepository() const { return TexMapRepository; }
 
+    /// Returns whether texture maps that are created from map compositions load their images in the background.
+    bool GetBackgroundLoading() const { return BackgroundLoading; }
+
+    /// Returns the loader that runs the load jobs of the texture maps in the background.
+    TextureLoaderT& GetLoader() { return Loader; }
+
 
     /// Get a pointer/reference to the texture-map manager singleton.
     static TextureMapManagerImplT& Get();
@@ -201,7 +219,7 @@ class TextureMapManagerImplT : public MatSys::TextureMapManagerI
 
     private:
 
-    TextureMapManagerImplT() : MaxTextureMapSize(4096) { }
+    TextureMapManagerImplT() : MaxTextureMapSize(4096), BackgroundLoading(false) { }
 
     TextureMapManagerImplT(const TextureMapManagerImplT&);      // Use of the Copy    Constructor is not allowed.
     void operator = (const TextureMapManagerImplT&);            // Use of the Assignment Operator is not allowed.
@@ -209,6 +227,8 @@ class TextureMapManagerImplT : public MatSys::TextureMapManagerI
     ArrayT<TextureMapImplT*> TexMapRepository;
     ArrayT<unsigned long>    TexMapRepositoryCount;
     unsigned long            MaxTextureMapSize;
+    bool                     BackgroundLoading;
+    TextureLoaderT           Loader;
 };
 
 #endif
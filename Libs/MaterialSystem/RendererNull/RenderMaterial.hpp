@@ -0,0 +1,38 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/**********************/
+/*** RenderMaterial ***/
+/**********************/
+
+#ifndef CAFU_MATSYS_RENDERMATERIAL_HPP_INCLUDED
+#define CAFU_MATSYS_RENDERMATERIAL_HPP_INCLUDED
+
+
+class MaterialT;
+
+
+namespace MatSys
+{
+    /// This class represents a surface render material.
+    /// The Null renderer only keeps the material, so that materials can be told apart and are returned by GetMaterialFromRM().
+    class RenderMaterialT
+    {
+        private:
+
+        RenderMaterialT(const RenderMaterialT&);    // Use of the Copy    Constructor is not allowed.
+        void operator = (const RenderMaterialT&);   // Use of the Assignment Operator is not allowed.
+
+
+        public:
+
+        RenderMaterialT(const MaterialT* Material_) : Material(Material_) { }
+
+        const MaterialT* Material;
+    };
+}
+
+#endif
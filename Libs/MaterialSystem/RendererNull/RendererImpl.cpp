@@ -11,6 +11,8 @@ This project is licensed under the terms of the MIT license.
 #include <stdlib.h>
 
 #include "RendererImpl.hpp"
+#include "RenderMaterial.hpp"
+#include "../Mesh.hpp"
 
 
 using namespace MatSys;
@@ -25,7 +27,12 @@ RendererImplT& RendererImplT::GetInstance()
 
 
 RendererImplT::RendererImplT()
-    : CurrentRenderAction(AMBIENT)
+    : CurrentRenderAction(AMBIENT),
+      CurrentRenderMaterial(NULL),
+      LockCurrentRM(false),
+      CurrentLightMap(NULL),
+      CurrentLightDirMap(NULL),
+      Stats()
 {
     ExpressionSymbols.GenFloat.PushBackEmpty(32);
     ExpressionSymbols.GenInt  .PushBackEmpty(32);
@@ -74,13 +81,17 @@ const char* RendererImplT::GetDescription() const
 
 RenderMaterialT* RendererImplT::RegisterMaterial(const MaterialT* Material) const
 {
-    return NULL;
+    if (Material==NULL) return NULL;
+
+    return new RenderMaterialT(Material);
 }
 
 
 const MaterialT* RendererImplT::GetMaterialFromRM(MatSys::RenderMaterialT* RenderMaterial) const
 {
-    return NULL;
+    if (RenderMaterial==NULL) return NULL;
+
+    return RenderMaterial->Material;
 }
 
 
@@ -98,11 +109,20 @@ unsigned long RendererImplT::GetLightShaderIDFromRM(MatSys::RenderMaterialT* Ren
 
 void RendererImplT::FreeMaterial(RenderMaterialT* RenderMaterial)
 {
+    // Trying to delete the currently active material? Deactivate it first.
+    if (RenderMaterial==CurrentRenderMaterial)
+    {
+        LockCurrentMaterial(false);
+        SetCurrentMaterial(NULL);
+    }
+
+    delete RenderMaterial;
 }
 
 
 void RendererImplT::BeginFrame(double Time)
 {
+    Stats=StatsT();
 }
 
 
@@ -119,6 +139,7 @@ void RendererImplT::PreCache()
 void RendererImplT::SetCurrentRenderAction(RenderActionT RA)
 {
     CurrentRenderAction=RA;
+    Stats.NumStateChanges++;
 }
 
 
@@ -330,41 +351,49 @@ const MatrixT& RendererImplT::GetMatrixModelView() const
 
 void RendererImplT::SetMatrix(MatrixNameT MN, const MatrixT& Matrix_)
 {
+    Stats.NumStateChanges++;
 }
 
 
 void RendererImplT::Translate(MatrixNameT MN, float x, float y, float z)
 {
+    Stats.NumStateChanges++;
 }
 
 
 void RendererImplT::Scale(MatrixNameT MN, float scale)
 {
+    Stats.NumStateChanges++;
 }
 
 
 void RendererImplT::RotateX(MatrixNameT MN, float angle)
 {
+    Stats.NumStateChanges++;
 }
 
 
 void RendererImplT::RotateY(MatrixNameT MN, float angle)
 {
+    Stats.NumStateChanges++;
 }
 
 
 void RendererImplT::RotateZ(MatrixNameT MN, float angle)
 {
+    Stats.NumStateChanges++;
 }
 
 
 void RendererImplT::PushMatrix(MatrixNameT MN)
 {
+    Stats.NumStateChanges++;
 }
 
 
 void RendererImplT::PopMatrix(MatrixNameT MN)
 {
+    Stats.NumStateChanges++;
 }
 
 /************************************************************************************************************/
@@ -419,6 +448,11 @@ void RendererImplT::PopName()
 
 void RendererImplT::SetCurrentMaterial(RenderMaterialT* RenderMaterial)
 {
+    if (LockCurrentRM) return;
+    if (RenderMaterial==CurrentRenderMaterial) return;
+
+    CurrentRenderMaterial=RenderMaterial;
+    Stats.NumStateChanges++;
 }
 
 
@@ -430,16 +464,25 @@ MatSys::RenderMaterialT* RendererImplT::GetCurrentMaterial() const
 
 void RendererImplT::LockCurrentMaterial(bool LockCM)
 {
+    LockCurrentRM=LockCM;
 }
 
 
 void RendererImplT::SetCurrentLightMap(TextureMapI* LightMap)
 {
+    if (LightMap==CurrentLightMap) return;
+
+    CurrentLightMap=LightMap;
+    Stats.NumStateChanges++;
 }
 
 
 void RendererImplT::SetCurrentLightDirMap(TextureMapI* LightDirMap)
 {
+    if (LightDirMap==CurrentLightDirMap) return;
+
+    CurrentLightDirMap=LightDirMap;
+    Stats.NumStateChanges++;
 }
 
 
@@ -455,10 +498,18 @@ void RendererImplT::SetCurrentSHLLookupMap(TextureMapI* SHLLookupMap)
 
 void RendererImplT::RenderMesh(const MeshT& Mesh)
 {
+    Stats.NumDrawCalls++;
+    Stats.NumVertices+=Mesh.Vertices.Size();
+}
+
+
+RendererImplT::StatsT RendererImplT::GetStats() const
+{
+    return Stats;
 }
 
 
 RenderMaterialT* RendererImplT::GetCurrentRenderMaterial() const
 {
-    return NULL;
+    return CurrentRenderMaterial;
 }
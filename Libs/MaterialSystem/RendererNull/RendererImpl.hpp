@@ -106,6 +106,7 @@ class RendererImplT : public MatSys::RendererI
     void SetCurrentSHLMaps(const ArrayT<MatSys::TextureMapI*>& SHLMaps);
     void SetCurrentSHLLookupMap(MatSys::TextureMapI* SHLLookupMap);
     void RenderMesh(const MatSys::MeshT& Mesh);
+    StatsT GetStats() const;
 
 
     // Internal interface.
@@ -130,6 +131,14 @@ class RendererImplT : public MatSys::RendererI
     LightingParamsT          CurrentLightingParams;
     ArrayT<LightingParamsT>  LightingParamsStack;
 
+    MatSys::RenderMaterialT* CurrentRenderMaterial;
+    bool                     LockCurrentRM;
+    MatSys::TextureMapI*     CurrentLightMap;
+    MatSys::TextureMapI*     CurrentLightDirMap;
+
+    /// The statistics since the last call to BeginFrame().
+    StatsT                   Stats;
+
     /// This is where the symbol values for material expressions are stored.
     ExpressionT::SymbolsT ExpressionSymbols;
 
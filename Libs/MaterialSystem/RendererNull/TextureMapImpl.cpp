@@ -40,6 +40,11 @@ unsigned long TextureMapManagerImplT::GetMaxTextureSize() const
 }
 
 
+void TextureMapManagerImplT::SetBackgroundLoading(bool Enable)
+{
+}
+
+
 MatSys::TextureMapI* TextureMapManagerImplT::GetTextureMap2D(const MapCompositionT& MC)
 {
     return NULL;
@@ -21,6 +21,7 @@ class TextureMapManagerImplT : public MatSys::TextureMapManagerI
     // TextureMapManagerI implementation.
     void SetMaxTextureSize(unsigned long MaxSize);
     unsigned long GetMaxTextureSize() const;
+    void SetBackgroundLoading(bool Enable);
     MatSys::TextureMapI* GetTextureMap2D(const MapCompositionT& MapComp);
     MatSys::TextureMapI* GetTextureMap2D(char* Data, unsigned long SizeX, unsigned long SizeY, char BytesPerPixel, bool MakePrivateCopy, const MapCompositionT& McForFiltersAndWrapping);
     MatSys::TextureMapI* GetTextureMap2D(BitmapT* Bitmap, bool MakePrivateCopy, const MapCompositionT& McForFiltersAndWrapping);
@@ -139,6 +139,7 @@ void RendererImplT::Initialize()
     cf::Init_GL_ARB_multitexture();
     cf::Init_GL_ARB_texture_cube_map();
     cf::Init_GL_ARB_texture_compression();
+    cf::Init_GL_EXT_texture_compression_s3tc();
     cf::Init_GL_EXT_stencil_wrap();
     cf::Init_GL_EXT_stencil_two_side();
 
@@ -48,6 +48,12 @@ namespace MatSys
         /// Returns the currently set maximum texture size.
         virtual unsigned long GetMaxTextureSize() const=0;
 
+        /// Sets whether texture-maps that are created from map compositions load their images in the background.
+        /// If enabled, loading, compositing, scaling and mipmapping the images happens in worker threads,
+        /// and a neutral placeholder texture is used for rendering until the images are ready for upload.
+        /// If disabled (the default), all this happens synchronously when the texture-map is first rendered.
+        virtual void SetBackgroundLoading(bool Enable)=0;
+
         /// Creates a 2D texture-map by a texture-map composition. The function never fails.
         /// Calling this multiple times with the same MapComp will return identical pointers.
         /// The maximum texture size value is respected, unless the "NoScaleDown" property is set in the MapComp.
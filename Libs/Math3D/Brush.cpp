@@ -42,7 +42,7 @@ template<class T> Brush3T<T>::Brush3T(const Vector3T<T>& A, const Vector3T<T>& B
 
 template<class T> void Brush3T<T>::TraceBoundingBox(const BoundingBox3T<T>& BB, const Vector3T<T>& Origin, const Vector3T<T>& Dir, VB_Trace3T<T>& Trace) const
 {
-    static ArrayT<T> BloatDistanceOffsets;
+    static thread_local ArrayT<T> BloatDistanceOffsets;
     const T Epsilon = T(0.0625);
 
     // Bloat-Distance-Offsets für alle Planes dieses Brushs bestimmen.
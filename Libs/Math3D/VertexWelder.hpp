@@ -0,0 +1,126 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/*********************/
+/*** Vertex Welder ***/
+/*********************/
+
+#ifndef CAFU_MATH_VERTEX_WELDER_HPP_INCLUDED
+#define CAFU_MATH_VERTEX_WELDER_HPP_INCLUDED
+
+#include "Vector3.hpp"
+#include "Templates/Array.hpp"
+
+#include <cmath>
+#include <stdint.h>
+#include <unordered_map>
+
+
+/// This class welds vertices that are closer to each other than an epsilon, so that an array of unique vertices is obtained.
+///
+/// It yields exactly the same results as the plain linear search
+///     for (i=0; i<Vertices.Size(); i++) if (Vertices[i].IsEqual(A, Epsilon)) break;
+///     if (i==Vertices.Size()) Vertices.PushBack(A);
+/// but finds the vertices in constant rather than linear time, by keeping them in a hash table of grid cells
+/// whose side length is twice the epsilon: a vertex that is equal to A within the epsilon can only be in one of
+/// the 3*3*3 cells around A. (A cell size of only one epsilon would work in theory, but the above guarantee would
+/// then depend on the rounding of the cell coordinates.)
+template<class T>
+class VertexWelderT
+{
+    public:
+
+    /// The constructor.
+    /// @param Vertices   The array of vertices that is searched and that new vertices are appended to.
+    ///                   Any vertices that it already contains are added to the welder.
+    ///                   The caller must not modify the array other than through this welder while the welder is in use.
+    /// @param Epsilon    Two vertices are considered equal if their distance is at most Epsilon, see Vector3T<T>::IsEqual().
+    VertexWelderT(ArrayT< Vector3T<T> >& Vertices, const T Epsilon)
+        : m_Vertices(Vertices),
+          m_Epsilon(Epsilon),
+          m_CellSize(Epsilon>0 ? Epsilon*2 : 1)
+    {
+        for (unsigned long VertexNr=0; VertexNr<m_Vertices.Size(); VertexNr++)
+            Link(VertexNr);
+    }
+
+    /// Returns the index of the first vertex in the array that is equal to A within the epsilon,
+    /// or -1 if there is no such vertex.
+    long Find(const Vector3T<T>& A) const
+    {
+        const int64_t CX=GetCell(A.x);
+        const int64_t CY=GetCell(A.y);
+        const int64_t CZ=GetCell(A.z);
+        unsigned long Best=NONE;
+
+        for (int64_t x=CX-1; x<=CX+1; x++)
+            for (int64_t y=CY-1; y<=CY+1; y++)
+                for (int64_t z=CZ-1; z<=CZ+1; z++)
+                {
+                    typename std::unordered_map<uint64_t, unsigned long>::const_iterator It=m_Heads.find(GetKey(x, y, z));
+
+                    if (It==m_Heads.end()) continue;
+
+                    // Note that the chain may also contain vertices of other cells whose key collides with this one.
+                    // This is harmless, because all vertices are checked individually anyway.
+                    for (unsigned long VertexNr=It->second; VertexNr!=NONE; VertexNr=m_Next[VertexNr])
+                        if (VertexNr<Best && m_Vertices[VertexNr].IsEqual(A, m_Epsilon))
+                            Best=VertexNr;
+                }
+
+        return Best==NONE ? -1 : long(Best);
+    }
+
+    /// Returns the index of the first vertex in the array that is equal to A within the epsilon.
+    /// If there is no such vertex, A is appended to the array and its index is returned.
+    unsigned long FindOrInsert(const Vector3T<T>& A)
+    {
+        const long VertexNr=Find(A);
+
+        if (VertexNr>=0) return VertexNr;
+
+        m_Vertices.PushBack(A);
+        Link(m_Vertices.Size()-1);
+        return m_Vertices.Size()-1;
+    }
+
+
+    private:
+
+    enum { NONE=~0ul };     ///< Marks the end of a chain of vertices.
+
+    VertexWelderT(const VertexWelderT<T>&);         ///< Use of the Copy Constructor    is not allowed.
+    void operator = (const VertexWelderT<T>&);      ///< Use of the Assignment Operator is not allowed.
+
+    int64_t GetCell(const T c) const
+    {
+        return int64_t(std::floor(c/m_CellSize));
+    }
+
+    static uint64_t GetKey(const int64_t x, const int64_t y, const int64_t z)
+    {
+        return uint64_t(x)*0x9E3779B97F4A7C15ull ^ uint64_t(y)*0xC2B2AE3D27D4EB4Full ^ uint64_t(z)*0x165667B19E3779F9ull;
+    }
+
+    /// Adds the vertex with the given index to the hash table. Vertices must be linked in the order of their indices.
+    void Link(const unsigned long VertexNr)
+    {
+        const Vector3T<T>& V=m_Vertices[VertexNr];
+        const std::pair<typename std::unordered_map<uint64_t, unsigned long>::iterator, bool> Result=
+            m_Heads.insert(std::make_pair(GetKey(GetCell(V.x), GetCell(V.y), GetCell(V.z)), VertexNr));
+
+        m_Next.PushBack(Result.second ? (unsigned long)NONE : Result.first->second);
+        Result.first->second=VertexNr;
+    }
+
+    ArrayT< Vector3T<T> >&                      m_Vertices;   ///< The array of the welded vertices.
+    const T                                     m_Epsilon;    ///< The epsilon within which vertices are considered equal.
+    const T                                     m_CellSize;   ///< The side length of the grid cells.
+    std::unordered_map<uint64_t, unsigned long> m_Heads;      ///< For each (hashed) grid cell, the index of the last vertex that was added to it.
+    ArrayT<unsigned long>                       m_Next;       ///< For each vertex, the index of the previous vertex in the same (hashed) grid cell, or NONE.
+};
+
+#endif
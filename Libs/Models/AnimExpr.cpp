@@ -8,6 +8,17 @@ This project is licensed under the terms of the MIT license.
 #include "Model_cmdl.hpp"
 
 
+void AnimExpressionT::JointsDataT::SetSize(unsigned long NumJoints)
+{
+    if (Weights.Size()==NumJoints) return;
+
+    Weights.Overwrite(); Weights.PushBackEmpty(NumJoints);
+    Pos    .Overwrite(); Pos    .PushBackEmpty(NumJoints);
+    Quats  .Overwrite(); Quats  .PushBackEmpty(NumJoints);
+    Scales .Overwrite(); Scales .PushBackEmpty(NumJoints);
+}
+
+
 AnimExpressionT::AnimExpressionT(const CafuModelT& Model)
     : m_Model(Model),
       m_RefCount(0)
@@ -15,6 +26,83 @@ AnimExpressionT::AnimExpressionT(const CafuModelT& Model)
 }
 
 
+void AnimExpressionT::GetAllData(JointsDataT& Data) const
+{
+    Data.SetSize(m_Model.GetJoints().Size());
+
+    for (unsigned int JointNr=0; JointNr<Data.Weights.Size(); JointNr++)
+    {
+        // GetData() leaves some of its out-parameters unchanged for joints that are filtered out,
+        // so make sure that they are always taken from the same, default-constructed values.
+        float                  Weight;
+        Vector3fT              Pos;
+        cf::math::QuaternionfT Quat;
+        Vector3fT              Scale;
+
+        GetData(JointNr, Weight, Pos, Quat, Scale);
+
+        Data.Weights[JointNr]=Weight;
+        Data.Pos    [JointNr]=Pos;
+        Data.Quats  [JointNr]=Quat;
+        Data.Scales [JointNr]=Scale;
+    }
+}
+
+
+namespace
+{
+    // Sets the weights of all joints that are not members of the given channel to 0.
+    // As with AnimExprFilterT::GetData(), the other data of these joints is the default-constructed data
+    // (not the data of the sub-expression), which is relevant if the filter is at the top of the expression.
+    void FilterJoints(const CafuModelT& Model, unsigned int ChannelNr, AnimExpressionT::JointsDataT& Data)
+    {
+        if (ChannelNr >= Model.GetChannels().Size()) return;
+
+        const CafuModelT::ChannelT& Channel=Model.GetChannels()[ChannelNr];
+
+        for (unsigned int JointNr=0; JointNr<Data.Weights.Size(); JointNr++)
+            if (!Channel.IsMember(JointNr))
+            {
+                Data.Weights[JointNr]=0.0f;
+                Data.Pos    [JointNr]=Vector3fT();
+                Data.Quats  [JointNr]=cf::math::QuaternionfT();
+                Data.Scales [JointNr]=Vector3fT();
+            }
+    }
+
+
+    // For each joint, keeps the data of A or B, whichever has the larger weight.
+    void CombineJoints(AnimExpressionT::JointsDataT& A, const AnimExpressionT::JointsDataT& B)
+    {
+        for (unsigned int JointNr=0; JointNr<A.Weights.Size(); JointNr++)
+        {
+            if (B.Weights[JointNr] > A.Weights[JointNr])
+            {
+                A.Weights[JointNr]=B.Weights[JointNr];
+                A.Pos    [JointNr]=B.Pos    [JointNr];
+                A.Quats  [JointNr]=B.Quats  [JointNr];
+                A.Scales [JointNr]=B.Scales [JointNr];
+            }
+        }
+    }
+
+
+    // For each joint, blends the data of A towards the data of B by the fraction f1.
+    void BlendJoints(AnimExpressionT::JointsDataT& A, const AnimExpressionT::JointsDataT& B, float f1)
+    {
+        const float f0 = 1.0f - f1;
+
+        for (unsigned int JointNr=0; JointNr<A.Weights.Size(); JointNr++)
+        {
+            A.Weights[JointNr] = A.Weights[JointNr]*f0 + B.Weights[JointNr]*f1;
+            A.Pos    [JointNr] = A.Pos    [JointNr]*f0 + B.Pos    [JointNr]*f1;
+            A.Quats  [JointNr] = slerp(A.Quats[JointNr], B.Quats[JointNr], f1);
+            A.Scales [JointNr] = A.Scales [JointNr]*f0 + B.Scales [JointNr]*f1;
+        }
+    }
+}
+
+
 /*************************/
 /*** AnimExprStandardT ***/
 /*************************/
@@ -29,7 +117,29 @@ AnimExprStandardT::AnimExprStandardT(const CafuModelT& Model, int SequNr, float
 }
 
 
-void AnimExprStandardT::GetData(unsigned int JointNr, float& Weight, Vector3fT& Pos, cf::math::QuaternionfT& Quat, Vector3fT& Scale) const
+AnimExprStandardT::FramesT AnimExprStandardT::GetFrames() const
+{
+    FramesT Frames;
+
+    Frames.Frame_0=0;
+    Frames.Frame_1=0;
+    Frames.Frame_f=0.0f;
+
+    if (m_SequNr!=-1)
+    {
+        // m_SequNr is a valid index into the anims -- use it.
+        const CafuModelT::AnimT& Anim=GetModel().GetAnims()[m_SequNr];
+
+        Frames.Frame_0=int(m_FrameNr);                                  // If m_FrameNr == 17.83, then Frame_0 == 17
+        Frames.Frame_f=m_FrameNr-Frames.Frame_0;                        //                             Frame_f ==  0.83
+        Frames.Frame_1=(Frames.Frame_0+1) % int(Anim.Frames.Size());    //                             Frame_1 == 18
+    }
+
+    return Frames;
+}
+
+
+void AnimExprStandardT::GetJointData(const FramesT& Frames, unsigned int JointNr, float& Weight, Vector3fT& Pos, cf::math::QuaternionfT& Quat, Vector3fT& Scale) const
 {
     typedef CafuModelT::JointT JointT;
     typedef CafuModelT::AnimT  AnimT;
@@ -49,11 +159,10 @@ void AnimExprStandardT::GetData(unsigned int JointNr, float& Weight, Vector3fT&
     }
     else
     {
-        // m_SequNr is a valid index into Anims -- use it.
-        const AnimT& Anim=Anims[m_SequNr];
-        const int    Frame_0=int(m_FrameNr);                        // If m_FrameNr == 17.83, then Frame_0 == 17
-        const float  Frame_f=m_FrameNr-Frame_0;                     //                             Frame_f ==  0.83
-        const int    Frame_1=(Frame_0+1) % int(Anim.Frames.Size()); //                             Frame_1 == 18
+        const AnimT& Anim   =Anims[m_SequNr];
+        const int    Frame_0=Frames.Frame_0;
+        const float  Frame_f=Frames.Frame_f;
+        const int    Frame_1=Frames.Frame_1;
 
         const AnimT::AnimJointT& AJ=Anim.AnimJoints[JointNr];
 
@@ -94,6 +203,23 @@ void AnimExprStandardT::GetData(unsigned int JointNr, float& Weight, Vector3fT&
 }
 
 
+void AnimExprStandardT::GetData(unsigned int JointNr, float& Weight, Vector3fT& Pos, cf::math::QuaternionfT& Quat, Vector3fT& Scale) const
+{
+    GetJointData(GetFrames(), JointNr, Weight, Pos, Quat, Scale);
+}
+
+
+void AnimExprStandardT::GetAllData(JointsDataT& Data) const
+{
+    const FramesT Frames=GetFrames();
+
+    Data.SetSize(GetModel().GetJoints().Size());
+
+    for (unsigned int JointNr=0; JointNr<Data.Weights.Size(); JointNr++)
+        GetJointData(Frames, JointNr, Data.Weights[JointNr], Data.Pos[JointNr], Data.Quats[JointNr], Data.Scales[JointNr]);
+}
+
+
 bool AnimExprStandardT::AdvanceTime(float Time)
 {
     const ArrayT<CafuModelT::AnimT>& Anims = GetModel().GetAnims();
@@ -250,6 +376,13 @@ void AnimExprFilterT::GetData(unsigned int JointNr, float& Weight, Vector3fT& Po
 }
 
 
+void AnimExprFilterT::GetAllData(JointsDataT& Data) const
+{
+    m_SubExpr->GetAllData(Data);
+    FilterJoints(GetModel(), m_ChannelNr, Data);
+}
+
+
 AnimExpressionPtrT AnimExprFilterT::Clone() const
 {
     return GetModel().GetAnimExprPool().GetFilter(m_SubExpr->Clone(), m_ChannelNr);
@@ -308,6 +441,18 @@ void AnimExprCombineT::GetData(unsigned int JointNr, float& Weight, Vector3fT& P
 }
 
 
+void AnimExprCombineT::GetAllData(JointsDataT& Data) const
+{
+    JointsDataT DataB;
+
+    m_A->GetAllData(Data);
+    m_B->GetAllData(DataB);
+
+    // Pick the expression with the largest weight.
+    CombineJoints(Data, DataB);
+}
+
+
 bool AnimExprCombineT::AdvanceTime(float Time)
 {
     const bool WrapA = m_A->AdvanceTime(Time);
@@ -387,6 +532,29 @@ void AnimExprBlendT::GetData(unsigned int JointNr, float& Weight, Vector3fT& Pos
 }
 
 
+void AnimExprBlendT::GetAllData(JointsDataT& Data) const
+{
+    if (m_Frac <= 0.0f)
+    {
+        m_A->GetAllData(Data);
+        return;
+    }
+
+    if (m_Frac >= 1.0f)
+    {
+        m_B->GetAllData(Data);
+        return;
+    }
+
+    JointsDataT DataB;
+
+    m_A->GetAllData(Data);
+    m_B->GetAllData(DataB);
+
+    BlendJoints(Data, DataB, m_Frac);
+}
+
+
 bool AnimExprBlendT::AdvanceTime(float Time)
 {
     // Advance the blend fraction.
@@ -437,6 +605,114 @@ bool AnimExprBlendT::IsEqual(const AnimExpressionPtrT& AE) const
 }
 
 
+/************************/
+/*** AnimExprProgramT ***/
+/************************/
+
+AnimExprProgramT::AnimExprProgramT()
+    : m_Model(NULL)
+{
+}
+
+
+void AnimExprProgramT::Compile(const AnimExpressionT& AE)
+{
+    m_Model=&AE.GetModel();
+    m_Instrs.Overwrite();
+
+    Emit(AE, 0);
+}
+
+
+void AnimExprProgramT::Emit(const AnimExpressionT& AE, unsigned int Dest)
+{
+    InstrT Instr;
+
+    Instr.Dest     =Dest;
+    Instr.Expr     =&AE;
+    Instr.ChannelNr=0;
+    Instr.Frac     =0.0f;
+
+    if (dynamic_cast<const AnimExprStandardT*>(&AE))
+    {
+        Instr.OpCode=OP_STANDARD;
+    }
+    else if (const AnimExprFilterT* Filter=dynamic_cast<const AnimExprFilterT*>(&AE))
+    {
+        Emit(*Filter->m_SubExpr, Dest);
+
+        Instr.OpCode   =OP_FILTER;
+        Instr.ChannelNr=Filter->m_ChannelNr;
+    }
+    else if (const AnimExprCombineT* Combine=dynamic_cast<const AnimExprCombineT*>(&AE))
+    {
+        Emit(*Combine->m_A, Dest);
+        Emit(*Combine->m_B, Dest+1);
+
+        Instr.OpCode=OP_COMBINE;
+    }
+    else if (const AnimExprBlendT* Blend=dynamic_cast<const AnimExprBlendT*>(&AE))
+    {
+        // As in AnimExprBlendT::GetData(), only one of the sub-expressions is needed at the ends of the blend.
+        if (Blend->GetFrac() <= 0.0f) { Emit(*Blend->GetA(), Dest); return; }
+        if (Blend->GetFrac() >= 1.0f) { Emit(*Blend->GetB(), Dest); return; }
+
+        Emit(*Blend->GetA(), Dest);
+        Emit(*Blend->GetB(), Dest+1);
+
+        Instr.OpCode=OP_BLEND;
+        Instr.Frac  =Blend->GetFrac();
+    }
+    else
+    {
+        Instr.OpCode=OP_GENERIC;
+    }
+
+    while (m_Registers.Size() <= Dest+1)
+        m_Registers.PushBackEmpty();
+
+    m_Instrs.PushBack(Instr);
+}
+
+
+const AnimExpressionT::JointsDataT& AnimExprProgramT::Run()
+{
+    for (unsigned long InstrNr=0; InstrNr<m_Instrs.Size(); InstrNr++)
+    {
+        const InstrT&                 Instr=m_Instrs[InstrNr];
+        AnimExpressionT::JointsDataT& Data =m_Registers[Instr.Dest];
+
+        switch (Instr.OpCode)
+        {
+            case OP_STANDARD:
+                // Call the method non-virtually, we know the exact type of the expression.
+                static_cast<const AnimExprStandardT*>(Instr.Expr)->AnimExprStandardT::GetAllData(Data);
+                break;
+
+            case OP_FILTER:
+                FilterJoints(*m_Model, Instr.ChannelNr, Data);
+                break;
+
+            case OP_COMBINE:
+                CombineJoints(Data, m_Registers[Instr.Dest+1]);
+                break;
+
+            case OP_BLEND:
+                BlendJoints(Data, m_Registers[Instr.Dest+1], Instr.Frac);
+                break;
+
+            case OP_GENERIC:
+                Instr.Expr->GetAllData(Data);
+                break;
+        }
+    }
+
+    if (m_Registers.Size()==0) m_Registers.PushBackEmpty();
+
+    return m_Registers[0];
+}
+
+
 /*********************/
 /*** AnimExprPoolT ***/
 /*********************/
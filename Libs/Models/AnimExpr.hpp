@@ -13,6 +13,7 @@ This project is licensed under the terms of the MIT license.
 
 
 class AnimExpressionT;
+class AnimExprProgramT;
 class CafuModelT;
 
 typedef IntrusivePtrT<AnimExpressionT> AnimExpressionPtrT;
@@ -34,6 +35,20 @@ class AnimExpressionT
 {
     public:
 
+    /// The data of all joints of the skeleton, as obtained from an anim expression.
+    /// The data is kept in contiguous arrays that have one element for each joint of the model.
+    struct JointsDataT
+    {
+        /// Sets the number of joints. The memory that is already allocated is re-used.
+        void SetSize(unsigned long NumJoints);
+
+        ArrayT<float>                  Weights;     ///< The weights of the joints.
+        ArrayT<Vector3fT>              Pos;         ///< The positions of the joints.
+        ArrayT<cf::math::QuaternionfT> Quats;       ///< The quaternions of the joints.
+        ArrayT<Vector3fT>              Scales;      ///< The scale values of the joints.
+    };
+
+
     /// The constructor.
     /// (It's ok to have this in "public" instead of "protected": we have pure virtual methods as well.)
     AnimExpressionT(const CafuModelT& Model);
@@ -54,6 +69,13 @@ class AnimExpressionT
     ///   - the joints position, quaternion and scale values.
     virtual void GetData(unsigned int JointNr, float& Weight, Vector3fT& Pos, cf::math::QuaternionfT& Quat, Vector3fT& Scale) const=0;
 
+    /// Returns the data of all joints at once. The result is the same as if GetData() was called for each joint,
+    /// but each node of the expression tree processes all joints before it passes them on to its parent node,
+    /// rather than recursing into its sub-expressions once per joint.
+    /// The base class implementation calls GetData() for each joint.
+    /// See AnimExprProgramT for evaluating an expression tree entirely without virtual calls and temporary arrays.
+    virtual void GetAllData(JointsDataT& Data) const;
+
     /// Advances the time for this anim expression, that is, frame numbers of
     /// underlying animation sequences, cross-fades, etc.
     /// Returns `true` if the end of an underlying animation sequence was reached
@@ -101,6 +123,7 @@ class AnimExprStandardT : public AnimExpressionT
 
     // Implementations and overrides for base class methods.
     virtual void GetData(unsigned int JointNr, float& Weight, Vector3fT& Pos, cf::math::QuaternionfT& Quat, Vector3fT& Scale) const;
+    virtual void GetAllData(JointsDataT& Data) const;
     virtual bool AdvanceTime(float Time);
     virtual AnimExpressionPtrT Clone() const;   // Unfortunately, the proper covariant return type cannot be used with smart pointers.
     virtual bool IsEqual(const AnimExpressionPtrT& AE) const;
@@ -129,7 +152,17 @@ class AnimExprStandardT : public AnimExpressionT
 
     private:
 
+    /// The frames of the animation sequence that the data of the joints is interpolated from.
+    struct FramesT
+    {
+        int   Frame_0;  ///< The frame before m_FrameNr.
+        int   Frame_1;  ///< The frame after m_FrameNr.
+        float Frame_f;  ///< The fraction between the two frames.
+    };
+
     void NormalizeInput();
+    FramesT GetFrames() const;
+    void GetJointData(const FramesT& Frames, unsigned int JointNr, float& Weight, Vector3fT& Pos, cf::math::QuaternionfT& Quat, Vector3fT& Scale) const;
 
     int   m_SequNr;     ///< The animation sequence number.
     float m_FrameNr;    ///< The frame number in the sequence.
@@ -147,6 +180,7 @@ class AnimExprFilterT : public AnimExpressionT
 
     // Implementations and overrides for base class methods.
     virtual void GetData(unsigned int JointNr, float& Weight, Vector3fT& Pos, cf::math::QuaternionfT& Quat, Vector3fT& Scale) const;
+    virtual void GetAllData(JointsDataT& Data) const;
     virtual bool AdvanceTime(float Time) { return m_SubExpr->AdvanceTime(Time); }
     virtual AnimExpressionPtrT Clone() const;   // Unfortunately, the proper covariant return type cannot be used with smart pointers.
     virtual bool IsEqual(const AnimExpressionPtrT& AE) const;
@@ -157,6 +191,8 @@ class AnimExprFilterT : public AnimExpressionT
 
     private:
 
+    friend class AnimExprProgramT;
+
     AnimExpressionPtrT m_SubExpr;
     unsigned int       m_ChannelNr;
 };
@@ -170,6 +206,7 @@ class AnimExprCombineT : public AnimExpressionT
 
     // Implementations and overrides for base class methods.
     virtual void GetData(unsigned int JointNr, float& Weight, Vector3fT& Pos, cf::math::QuaternionfT& Quat, Vector3fT& Scale) const;
+    virtual void GetAllData(JointsDataT& Data) const;
     virtual bool AdvanceTime(float Time);
     virtual AnimExpressionPtrT Clone() const;   // Unfortunately, the proper covariant return type cannot be used with smart pointers.
     virtual bool IsEqual(const AnimExpressionPtrT& AE) const;
@@ -180,6 +217,8 @@ class AnimExprCombineT : public AnimExpressionT
 
     private:
 
+    friend class AnimExprProgramT;
+
     AnimExpressionPtrT m_A;
     AnimExpressionPtrT m_B;
 };
@@ -193,6 +232,7 @@ class AnimExprBlendT : public AnimExpressionT
 
     // Implementations and overrides for base class methods.
     virtual void GetData(unsigned int JointNr, float& Weight, Vector3fT& Pos, cf::math::QuaternionfT& Quat, Vector3fT& Scale) const;
+    virtual void GetAllData(JointsDataT& Data) const;
     virtual bool AdvanceTime(float Time);
     virtual AnimExpressionPtrT Clone() const;   // Unfortunately, the proper covariant return type cannot be used with smart pointers.
     virtual bool IsEqual(const AnimExpressionPtrT& AE) const;
@@ -221,6 +261,62 @@ class AnimExprBlendT : public AnimExpressionT
 };
 
 
+/// This class "compiles" an anim expression tree into a linear program that evaluates the data of all joints
+/// of the skeleton without any virtual calls or recursion.
+///
+/// Each instruction of the program processes the arrays of all joints at once, and keeps its result in one of
+/// the registers of the program. The registers are re-used whenever the program is compiled and run again, so
+/// that no memory is allocated in the long run.
+/// The program refers to the nodes of the expression tree that it was compiled from and takes the current
+/// parameters of these nodes (such as frame numbers and blend fractions) at compile time. Compiling is cheap
+/// (a single step per node of the tree), and thus a program is normally compiled anew whenever it is run.
+class AnimExprProgramT
+{
+    public:
+
+    /// The constructor.
+    AnimExprProgramT();
+
+    /// Compiles the given anim expression tree into this program.
+    /// The expression must not be modified or destroyed until the program has been run.
+    void Compile(const AnimExpressionT& AE);
+
+    /// Runs the program and returns the data of all joints.
+    /// The returned data is valid until the program is compiled or run again.
+    const AnimExpressionT::JointsDataT& Run();
+
+
+    private:
+
+    AnimExprProgramT(const AnimExprProgramT&);      ///< Use of the Copy Constructor    is not allowed.
+    void operator = (const AnimExprProgramT&);      ///< Use of the Assignment Operator is not allowed.
+
+    enum OpCodeT
+    {
+        OP_STANDARD,    ///< Registers[Dest] = the data of the AnimExprStandardT Expr.
+        OP_FILTER,      ///< Registers[Dest] = Registers[Dest], filtered by channel ChannelNr.
+        OP_COMBINE,     ///< Registers[Dest] = the joints with the larger weight of Registers[Dest] and Registers[Dest+1].
+        OP_BLEND,       ///< Registers[Dest] = Registers[Dest] blended towards Registers[Dest+1] by Frac.
+        OP_GENERIC      ///< Registers[Dest] = the data of the (unknown kind of) anim expression Expr, obtained by its GetAllData() method.
+    };
+
+    struct InstrT
+    {
+        OpCodeT                OpCode;
+        unsigned int           Dest;        ///< The register that receives the result (and holds the first operand, if any).
+        const AnimExpressionT* Expr;        ///< The anim expression for OP_STANDARD and OP_GENERIC.
+        unsigned int           ChannelNr;   ///< The channel for OP_FILTER.
+        float                  Frac;        ///< The blend fraction for OP_BLEND.
+    };
+
+    void Emit(const AnimExpressionT& AE, unsigned int Dest);
+
+    const CafuModelT*                    m_Model;       ///< The model of the expression that this program was compiled from.
+    ArrayT<InstrT>                       m_Instrs;      ///< The instructions of the program.
+    ArrayT<AnimExpressionT::JointsDataT> m_Registers;   ///< The registers that keep the intermediate results.
+};
+
+
 class AnimExprPoolT
 {
     public:
@@ -7,18 +7,29 @@ This project is licensed under the terms of the MIT license.
 #include "AnimPose.hpp"
 #include "AnimExpr.hpp"
 #include "Model_cmdl.hpp"
+#include "PoseCache.hpp"
 
 #include "MaterialSystem/Material.hpp"
 #include "MaterialSystem/Renderer.hpp"
 #include "Math3D/Pluecker.hpp"
 #include "Math3D/Quaternion.hpp"
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=1)
+#include <xmmintrin.h>
+#define CAFU_ANIMPOSE_SSE 1
+#else
+#define CAFU_ANIMPOSE_SSE 0
+#endif
+
 
 AnimPoseT::AnimPoseT(const CafuModelT& Model, IntrusivePtrT<AnimExpressionT> AnimExpr)
     : m_Model(Model),
       m_AnimExpr(AnimExpr),
       m_SuperPose(NULL),
       m_DlodPose(NULL),
+      m_PoseCache(NULL),
+      m_SharedPose(NULL),
+      m_SharedFrameNr(0),
       m_CachedAE(NULL),
       m_BoundingBox()
 {
@@ -100,6 +111,81 @@ void AnimPoseT::SyncDimensions() const
             m_Draw_Meshes[MeshNr].Vertices.PushBackEmptyExact(NumDrawTris*3);
         }
     }
+
+    if (m_SkinMatrices.Size()!=m_Model.GetJoints().Size()*16)
+    {
+        m_SkinMatrices.Overwrite();
+        m_SkinMatrices.PushBackEmptyExact(m_Model.GetJoints().Size()*16);
+    }
+
+    if (m_SkinMeshes.Size()!=m_Model.GetMeshes().Size())
+        InitSkinMeshes();
+}
+
+
+void AnimPoseT::InitSkinMeshes() const
+{
+    typedef CafuModelT::MeshT MeshT;
+
+    const ArrayT<MeshT>& Meshes=m_Model.GetMeshes();
+
+    m_SkinMeshes.Overwrite();
+    m_SkinMeshes.PushBackEmptyExact(Meshes.Size());
+
+    for (unsigned long MeshNr=0; MeshNr<Meshes.Size(); MeshNr++)
+    {
+        const MeshT& Mesh=Meshes[MeshNr];
+        SkinMeshT&   Skin=m_SkinMeshes[MeshNr];
+
+        // Overwrite() and PushBackEmptyExact() keep the previous contents of the elements, so start afresh.
+        Skin=SkinMeshT();
+
+        for (unsigned int VertexNr=0; VertexNr<Mesh.Vertices.Size(); VertexNr++)
+        {
+            const MeshT::VertexT& Vertex=Mesh.Vertices[VertexNr];
+
+            if (Vertex.GeoDups.Size()>0 && Vertex.GeoDups[0]<VertexNr)
+            {
+                // This vertex has a geometrically identical duplicate that is computed before it.
+                Skin.DupNrs.PushBack(VertexNr);
+                Skin.DupSrcNrs.PushBack(Vertex.GeoDups[0]);
+                continue;
+            }
+
+            Skin.VertexNrs.PushBack(VertexNr);
+            Skin.NumWeights.PushBack(Vertex.NumWeights);
+
+            for (unsigned int WeightNr=0; WeightNr<Vertex.NumWeights; WeightNr++)
+            {
+                const MeshT::WeightT& Weight=Mesh.Weights[Vertex.FirstWeightIdx+WeightNr];
+                const float           w     =(Vertex.NumWeights==1) ? 1.0f : Weight.Weight;
+
+                Skin.JointNrs.PushBack(Weight.JointIdx);
+                Skin.WeightedPos.PushBack(Weight.Pos.x*w);
+                Skin.WeightedPos.PushBack(Weight.Pos.y*w);
+                Skin.WeightedPos.PushBack(Weight.Pos.z*w);
+                Skin.WeightedPos.PushBack(w);
+            }
+        }
+
+        for (unsigned long TriNr=0; TriNr<Mesh.Triangles.Size(); TriNr++)
+        {
+            const MeshT::TriangleT& Tri=Mesh.Triangles[TriNr];
+            const MeshT::VertexT&   V_0=Mesh.Vertices[Tri.VertexIdx[0]];
+            const MeshT::VertexT&   V_1=Mesh.Vertices[Tri.VertexIdx[1]];
+            const MeshT::VertexT&   V_2=Mesh.Vertices[Tri.VertexIdx[2]];
+
+            // See UpdateTangentSpaceHard() for how the tangent and binormal vectors are obtained from these factors.
+            const Vector3fT uv01=Vector3fT(V_1.u, V_1.v, 0.0f)-Vector3fT(V_0.u, V_0.v, 0.0f);
+            const Vector3fT uv02=Vector3fT(V_2.u, V_2.v, 0.0f)-Vector3fT(V_0.u, V_0.v, 0.0f);
+            const float     f   =uv01.x*uv02.y-uv01.y*uv02.x>0.0 ? 1.0f : -1.0f;
+
+            Skin.TriUVs.PushBack(-uv01.y*f);
+            Skin.TriUVs.PushBack( uv02.y*f);
+            Skin.TriUVs.PushBack( uv01.x*f);
+            Skin.TriUVs.PushBack( uv02.x*f);
+        }
+    }
 }
 
 
@@ -111,6 +197,50 @@ namespace
 
         return (Length>0.000001f) ? A.GetScaled(1.0f/Length) : Vector3fT();
     }
+
+
+    // Computes the sum of the (column-major) joint matrices applied to the weighted positions, for the given weights of a vertex.
+    // The results of both implementations are identical, and for vertices with a single weight, they are identical to MatrixT::Mul_xyz1().
+#if CAFU_ANIMPOSE_SSE
+    inline Vector3fT SkinVertex(const float* Matrices, const unsigned int* JointNrs, const float* WeightedPos, unsigned int NumWeights)
+    {
+        __m128 Sum=_mm_setzero_ps();
+
+        for (unsigned int WeightNr=0; WeightNr<NumWeights; WeightNr++)
+        {
+            const float* M=Matrices+JointNrs[WeightNr]*16;
+            const float* P=WeightedPos+WeightNr*4;
+
+            __m128 v=_mm_mul_ps(_mm_loadu_ps(M+0), _mm_set1_ps(P[0]));
+            v=_mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(M+ 4), _mm_set1_ps(P[1])));
+            v=_mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(M+ 8), _mm_set1_ps(P[2])));
+            v=_mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(M+12), _mm_set1_ps(P[3])));
+
+            Sum=_mm_add_ps(Sum, v);
+        }
+
+        float Result[4];
+        _mm_storeu_ps(Result, Sum);
+
+        return Vector3fT(Result[0], Result[1], Result[2]);
+    }
+#else
+    inline Vector3fT SkinVertex(const float* Matrices, const unsigned int* JointNrs, const float* WeightedPos, unsigned int NumWeights)
+    {
+        float Sum[3]={ 0.0f, 0.0f, 0.0f };
+
+        for (unsigned int WeightNr=0; WeightNr<NumWeights; WeightNr++)
+        {
+            const float* M=Matrices+JointNrs[WeightNr]*16;
+            const float* P=WeightedPos+WeightNr*4;
+
+            for (unsigned int i=0; i<3; i++)
+                Sum[i]+=M[i]*P[0] + M[4+i]*P[1] + M[8+i]*P[2] + M[12+i]*P[3];
+        }
+
+        return Vector3fT(Sum[0], Sum[1], Sum[2]);
+    }
+#endif
 }
 
 
@@ -122,6 +252,10 @@ void AnimPoseT::UpdateJointMatrices() const
 
     const ArrayT<JointT>& Joints=m_Model.GetJoints();
 
+    // Compute the data of all joints at once, rather than walking the expression tree for each joint.
+    m_AnimProgram.Compile(*m_AnimExpr);
+    const AnimExpressionT::JointsDataT& Data=m_AnimProgram.Run();
+
     for (unsigned long JointNr=0; JointNr<Joints.Size(); JointNr++)
     {
         if (m_SuperPose)
@@ -135,18 +269,11 @@ void AnimPoseT::UpdateJointMatrices() const
             }
         }
 
-        float                  Weight;
-        Vector3fT              Pos;
-        cf::math::QuaternionfT Quat;
-        Vector3fT              Scale;
-
-        m_AnimExpr->GetData(JointNr, Weight, Pos, Quat, Scale);
-
         // Compute the matrix that is relative to the parent bone, and finally obtain the absolute matrix for that bone!
-        const MatrixT RelMatrix(Pos, Quat, Scale);
+        const MatrixT RelMatrix(Data.Pos[JointNr], Data.Quats[JointNr], Data.Scales[JointNr]);
         const JointT& J=Joints[JointNr];
 
-        // assert(Weight==1.0f);
+        // assert(Data.Weights[JointNr]==1.0f);
         m_JointMatrices[JointNr]=(J.Parent==-1) ? RelMatrix : m_JointMatrices[J.Parent]*RelMatrix;
     }
 }
@@ -156,49 +283,48 @@ void AnimPoseT::UpdateJointMatrices() const
 /// For all meshes do now compute the vertices according to their weights.
 void AnimPoseT::UpdateVertexPositions() const
 {
-    typedef CafuModelT::MeshT MeshT;
-
-    const ArrayT<MeshT>& Meshes=m_Model.GetMeshes();
-    m_BoundingBox=BoundingBox3fT();
-
-    for (unsigned long MeshNr=0; MeshNr<Meshes.Size(); MeshNr++)
+    // Transpose the joint matrices for the skinning kernel, which wants to scale their columns.
+    for (unsigned long JointNr=0; JointNr<m_JointMatrices.Size(); JointNr++)
     {
-        const MeshT& Mesh    =Meshes[MeshNr];
-        MeshInfoT&   MeshInfo=m_MeshInfos[MeshNr];
+        const MatrixT& Mat=m_JointMatrices[JointNr];
+        float*         Col=&m_SkinMatrices[JointNr*16];
 
-        for (unsigned long VertexNr=0; VertexNr<Mesh.Vertices.Size(); VertexNr++)
+        for (unsigned int c=0; c<4; c++)
         {
-            const MeshT::VertexT& Vertex    =Mesh.Vertices[VertexNr];
-            MeshInfoT::VertexT&   VertexInfo=MeshInfo.Vertices[VertexNr];
+            Col[c*4+0]=Mat.m[0][c];
+            Col[c*4+1]=Mat.m[1][c];
+            Col[c*4+2]=Mat.m[2][c];
+            Col[c*4+3]=0.0f;
+        }
+    }
 
-            if (Vertex.GeoDups.Size()>0 && Vertex.GeoDups[0]<VertexNr)
-            {
-                // This vertex has a geometrically identical duplicate that has already been computed.
-                // Therefore, don't bother to recompute the same position again, just copy it from the duplicate.
-                VertexInfo.Pos=MeshInfo.Vertices[Vertex.GeoDups[0]].Pos;
-                continue;
-            }
+    const float* Matrices=m_SkinMatrices.Size()>0 ? &m_SkinMatrices[0] : NULL;
 
-            if (Vertex.NumWeights==1)
-            {
-                const MeshT::WeightT& Weight=Mesh.Weights[Vertex.FirstWeightIdx];
+    m_BoundingBox=BoundingBox3fT();
 
-                VertexInfo.Pos=m_JointMatrices[Weight.JointIdx].Mul_xyz1(Weight.Pos);
-            }
-            else
-            {
-                VertexInfo.Pos=Vector3fT(0.0f, 0.0f, 0.0f);
+    for (unsigned long MeshNr=0; MeshNr<m_SkinMeshes.Size(); MeshNr++)
+    {
+        const SkinMeshT&    Skin       =m_SkinMeshes[MeshNr];
+        MeshInfoT&          MeshInfo   =m_MeshInfos[MeshNr];
+        const unsigned int* JointNrs   =Skin.JointNrs.Size()>0 ? &Skin.JointNrs[0] : NULL;
+        const float*        WeightedPos=Skin.WeightedPos.Size()>0 ? &Skin.WeightedPos[0] : NULL;
 
-                for (unsigned int WeightNr=0; WeightNr<Vertex.NumWeights; WeightNr++)
-                {
-                    const MeshT::WeightT& Weight=Mesh.Weights[Vertex.FirstWeightIdx+WeightNr];
+        for (unsigned long i=0; i<Skin.VertexNrs.Size(); i++)
+        {
+            const unsigned int NumWeights=Skin.NumWeights[i];
+            Vector3fT&         Pos       =MeshInfo.Vertices[Skin.VertexNrs[i]].Pos;
 
-                    VertexInfo.Pos+=m_JointMatrices[Weight.JointIdx].Mul_xyz1(Weight.Pos) * Weight.Weight;
-                }
-            }
+            Pos=SkinVertex(Matrices, JointNrs, WeightedPos, NumWeights);
+
+            JointNrs   +=NumWeights;
+            WeightedPos+=NumWeights*4;
 
-            m_BoundingBox+=MeshInfo.Vertices[VertexNr].Pos;
+            m_BoundingBox+=Pos;
         }
+
+        // The GeoDups of the skinned vertices have the same positions, so just copy them.
+        for (unsigned long i=0; i<Skin.DupNrs.Size(); i++)
+            MeshInfo.Vertices[Skin.DupNrs[i]].Pos=MeshInfo.Vertices[Skin.DupSrcNrs[i]].Pos;
     }
 }
 
@@ -207,6 +333,7 @@ void AnimPoseT::UpdateTangentSpaceHard(unsigned long MeshNr) const
 {
     const CafuModelT::MeshT& Mesh     =m_Model.GetMeshes()[MeshNr];
     MeshInfoT&               MeshInfo =m_MeshInfos[MeshNr];
+    const ArrayT<float>&     TriUVs   =m_SkinMeshes[MeshNr].TriUVs;
     unsigned long            DrawTriNr=0;
 
 
@@ -254,12 +381,11 @@ void AnimPoseT::UpdateTangentSpaceHard(unsigned long MeshNr) const
         // "The tangent vector is parallel to the direction of increasing S on a parametric surface."
         // First, there is a short explanation in "The Cg Tutorial", chapter 8.
         // Second, I have drawn a simple figure that leads to a simple 2x2 system of Gaussian equations, see my TechArchive.
-        const Vector3fT uv01=Vector3fT(V_1.u, V_1.v, 0.0f)-Vector3fT(V_0.u, V_0.v, 0.0f);
-        const Vector3fT uv02=Vector3fT(V_2.u, V_2.v, 0.0f)-Vector3fT(V_0.u, V_0.v, 0.0f);
-        const float     f   =uv01.x*uv02.y-uv01.y*uv02.x>0.0 ? 1.0f : -1.0f;
+        // The texture-space factors of this triangle are precomputed in InitSkinMeshes().
+        const float*    uv  =&TriUVs[TriangleNr*4];
 
-        const Vector3fT TriInfo_Tangent =myNormalize(Edge02.GetScaled(-uv01.y*f) + Edge01.GetScaled(uv02.y*f));
-        const Vector3fT TriInfo_BiNormal=myNormalize(Edge02.GetScaled( uv01.x*f) - Edge01.GetScaled(uv02.x*f));
+        const Vector3fT TriInfo_Tangent =myNormalize(Edge02.GetScaled(uv[0]) + Edge01.GetScaled(uv[1]));
+        const Vector3fT TriInfo_BiNormal=myNormalize(Edge02.GetScaled(uv[2]) - Edge01.GetScaled(uv[3]));
 
         m_Draw_Meshes[MeshNr].Vertices[DrawTriNr*3+0].SetOrigin(V_0Info.Pos.x, V_0Info.Pos.y, V_0Info.Pos.z);
         m_Draw_Meshes[MeshNr].Vertices[DrawTriNr*3+0].SetTextureCoord(V_0.u, V_0.v);
@@ -284,6 +410,7 @@ void AnimPoseT::UpdateTangentSpaceGlobal(unsigned long MeshNr) const
 {
     const CafuModelT::MeshT& Mesh    =m_Model.GetMeshes()[MeshNr];
     MeshInfoT&               MeshInfo=m_MeshInfos[MeshNr];
+    const ArrayT<float>&     TriUVs  =m_SkinMeshes[MeshNr].TriUVs;
 
 
     // *******************************************************************************************
@@ -307,9 +434,6 @@ void AnimPoseT::UpdateTangentSpaceGlobal(unsigned long MeshNr) const
     for (unsigned long TriangleNr=0; TriangleNr<Mesh.Triangles.Size(); TriangleNr++)
     {
         const CafuModelT::MeshT::TriangleT& Tri=Mesh.Triangles[TriangleNr];
-        const CafuModelT::MeshT::VertexT&   V_0=Mesh.Vertices[Tri.VertexIdx[0]];
-        const CafuModelT::MeshT::VertexT&   V_1=Mesh.Vertices[Tri.VertexIdx[1]];
-        const CafuModelT::MeshT::VertexT&   V_2=Mesh.Vertices[Tri.VertexIdx[2]];
 
         MeshInfoT::TriangleT& TriInfo=MeshInfo.Triangles[TriangleNr];
         MeshInfoT::VertexT&   V_0Info=MeshInfo.Vertices[Tri.VertexIdx[0]];
@@ -327,12 +451,11 @@ void AnimPoseT::UpdateTangentSpaceGlobal(unsigned long MeshNr) const
         // "The tangent vector is parallel to the direction of increasing S on a parametric surface."
         // First, there is a short explanation in "The Cg Tutorial", chapter 8.
         // Second, I have drawn a simple figure that leads to a simple 2x2 system of Gaussian equations, see my TechArchive.
-        const Vector3fT uv01=Vector3fT(V_1.u, V_1.v, 0.0f)-Vector3fT(V_0.u, V_0.v, 0.0f);
-        const Vector3fT uv02=Vector3fT(V_2.u, V_2.v, 0.0f)-Vector3fT(V_0.u, V_0.v, 0.0f);
-        const float     f   =uv01.x*uv02.y-uv01.y*uv02.x>0.0 ? 1.0f : -1.0f;
+        // The texture-space factors of this triangle are precomputed in InitSkinMeshes().
+        const float*    uv  =&TriUVs[TriangleNr*4];
 
-        const Vector3fT TriInfo_Tangent =myNormalize(Edge02.GetScaled(-uv01.y*f) + Edge01.GetScaled(uv02.y*f));
-        const Vector3fT TriInfo_BiNormal=myNormalize(Edge02.GetScaled( uv01.x*f) - Edge01.GetScaled(uv02.x*f));
+        const Vector3fT TriInfo_Tangent =myNormalize(Edge02.GetScaled(uv[0]) + Edge01.GetScaled(uv[1]));
+        const Vector3fT TriInfo_BiNormal=myNormalize(Edge02.GetScaled(uv[2]) - Edge01.GetScaled(uv[3]));
 
 
         // Distribute the per-triangle tangent-space over the affected vertices.
@@ -450,8 +573,8 @@ void AnimPoseT::UpdateTangentSpaceSgLocal(unsigned long MeshNr) const
         VertexInfo.BiNormal=Vector3fT(0, 0, 0);
     }
 
-    static ArrayT<Vector3fT> TriInfo_Tangents;
-    static ArrayT<Vector3fT> TriInfo_BiNormals;
+    static thread_local ArrayT<Vector3fT> TriInfo_Tangents;
+    static thread_local ArrayT<Vector3fT> TriInfo_BiNormals;
 
     TriInfo_Tangents.Overwrite();
     TriInfo_Tangents.PushBackEmpty(Mesh.Triangles.Size());
@@ -563,10 +686,54 @@ void AnimPoseT::UpdateTangentSpaceSmGroups(unsigned long MeshNr) const
 }
 
 
-void AnimPoseT::Recache() const
+const AnimPoseT* AnimPoseT::GetPoseToRecache() const
 {
-    if (!m_SuperPose && m_AnimExpr->IsEqual(m_CachedAE)) return;
+    if (m_PoseCache && m_PoseCache->IsEnabled() && !m_SuperPose)
+    {
+        if (!m_SharedPose || m_SharedFrameNr!=m_PoseCache->GetFrameNr() || !m_AnimExpr->IsEqual(m_CachedAE))
+        {
+            m_SharedPose   =m_PoseCache->GetPose(m_Model, m_AnimExpr);
+            m_SharedFrameNr=m_PoseCache->GetFrameNr();
+            m_CachedAE     =m_AnimExpr->Clone();
+        }
+
+        // The data of the shared pose is computed when it is first used.
+        return m_SharedPose->GetPoseToRecache();
+    }
+
+    if (m_SharedPose)
+    {
+        // Our own data is out of date, because the shared data has been used up to now.
+        m_SharedPose=NULL;
+        m_CachedAE  =NULL;
+    }
+
+    if (m_SuperPose)
+    {
+        // The data must be recomputed whenever the super pose is used.
+        assert(m_CachedAE==NULL);
+        return this;
+    }
+
+    if (m_AnimExpr->IsEqual(m_CachedAE)) return NULL;
 
+    // Cloning the anim expression accesses the pool of the model, and is thus done here rather than in ComputeCache().
+    m_CachedAE=m_AnimExpr->Clone();
+    return this;
+}
+
+
+const AnimPoseT* AnimPoseT::PrepareRecache(float LodDist) const
+{
+    if (m_Model.GetDlodModel() && LodDist >= m_Model.GetDlodDist())
+        return m_DlodPose->PrepareRecache(LodDist);
+
+    return GetPoseToRecache();
+}
+
+
+void AnimPoseT::ComputeCache() const
+{
     SyncDimensions();
     UpdateJointMatrices();
     UpdateVertexPositions();
@@ -589,15 +756,14 @@ void AnimPoseT::Recache() const
                 break;
         }
     }
+}
 
-    if (m_SuperPose)
-    {
-        assert(m_CachedAE==NULL);
-    }
-    else
-    {
-        m_CachedAE=m_AnimExpr->Clone();
-    }
+
+void AnimPoseT::Recache() const
+{
+    const AnimPoseT* Pose=GetPoseToRecache();
+
+    if (Pose) Pose->ComputeCache();
 }
 
 
@@ -613,6 +779,17 @@ void AnimPoseT::SetSuperPose(const AnimPoseT* SuperPose)
 }
 
 
+void AnimPoseT::SetPoseCache(PoseCacheT* PoseCache)
+{
+    for (AnimPoseT* Pose=this; Pose; Pose=Pose->m_DlodPose)
+    {
+        Pose->m_PoseCache =PoseCache;
+        Pose->m_SharedPose=NULL;
+        Pose->m_CachedAE  =NULL;
+    }
+}
+
+
 void AnimPoseT::Draw(int SkinNr, float LodDist) const
 {
     if (m_Model.GetDlodModel() && LodDist >= m_Model.GetDlodDist())
@@ -623,6 +800,12 @@ void AnimPoseT::Draw(int SkinNr, float LodDist) const
 
     Recache();
 
+    if (m_SharedPose)
+    {
+        m_SharedPose->Draw(SkinNr, LodDist);
+        return;
+    }
+
     // Do an early check whether the light and the sequence BBs intersect.
     switch (MatSys::Renderer->GetCurrentRenderAction())
     {
@@ -786,6 +969,7 @@ bool AnimPoseT::GetGuiPlane(unsigned int GFNr, Vector3fT& Origin, Vector3fT& Axi
 
     Recache();
 
+    if (m_SharedPose) return m_SharedPose->GetGuiPlane(GFNr, Origin, AxisX, AxisY);
     if (GFNr >= m_Model.GetGuiFixtures().Size()) return false;
 
     const CafuModelT::GuiFixtureT& GF=m_Model.GetGuiFixtures()[GFNr];
@@ -822,6 +1006,8 @@ bool AnimPoseT::TraceRay(int SkinNr, const Vector3fT& RayOrigin, const Vector3fT
 
     Recache();
 
+    if (m_SharedPose) return m_SharedPose->TraceRay(SkinNr, RayOrigin, RayDir, Result);
+
     // If we miss the bounding-box, then we miss all the triangles as well.
     float Fraction=0.0f;
     if (!GetBB()/*.GetEpsilonBox(...)*/.Contains(RayOrigin) && !GetBB().TraceRay(RayOrigin, RayDir, Fraction)) return false;
@@ -908,6 +1094,8 @@ unsigned int AnimPoseT::FindClosestVertex(unsigned int MeshNr, unsigned int TriN
 
     Recache();
 
+    if (m_SharedPose) return m_SharedPose->FindClosestVertex(MeshNr, TriNr, P);
+
     for (unsigned int i=0; i<3; i++)
     {
         const unsigned int VertexNr=m_Model.GetMeshes()[MeshNr].Triangles[TriNr].VertexIdx[i];
@@ -929,7 +1117,7 @@ const ArrayT<MatrixT>& AnimPoseT::GetJointMatrices() const
 {
     Recache();
 
-    return m_JointMatrices;
+    return m_SharedPose ? m_SharedPose->GetJointMatrices() : m_JointMatrices;
 }
 
 
@@ -937,6 +1125,8 @@ const MatrixT* AnimPoseT::GetJointMatrix(const std::string& JointName) const
 {
     Recache();
 
+    if (m_SharedPose) return m_SharedPose->GetJointMatrix(JointName);
+
     for (unsigned int JointNr=0; JointNr<m_Model.GetJoints().Size(); JointNr++)
         if (m_Model.GetJoints()[JointNr].Name == JointName)
             return &m_JointMatrices[JointNr];
@@ -949,7 +1139,7 @@ const ArrayT<AnimPoseT::MeshInfoT>& AnimPoseT::GetMeshInfos() const
 {
     Recache();
 
-    return m_MeshInfos;
+    return m_SharedPose ? m_SharedPose->GetMeshInfos() : m_MeshInfos;
 }
 
 
@@ -957,7 +1147,7 @@ const ArrayT<MatSys::MeshT>& AnimPoseT::GetDrawMeshes() const
 {
     Recache();
 
-    return m_Draw_Meshes;
+    return m_SharedPose ? m_SharedPose->GetDrawMeshes() : m_Draw_Meshes;
 }
 
 
@@ -965,5 +1155,5 @@ const BoundingBox3fT& AnimPoseT::GetBB() const
 {
     Recache();
 
-    return m_BoundingBox;
+    return m_SharedPose ? m_SharedPose->GetBB() : m_BoundingBox;
 }
@@ -15,6 +15,7 @@ This project is licensed under the terms of the MIT license.
 
 class CafuModelT;
 class MaterialT;
+class PoseCacheT;
 
 
 /// This class describes a specific pose of an associated model.
@@ -93,8 +94,30 @@ class AnimPoseT
     /// @param SuperPose   The super model pose that should be used when rendering this model.
     void SetSuperPose(const AnimPoseT* SuperPose);
 
+    /// Assigns the cache that this pose shares its data with other poses through, or \c NULL for keeping its own data.
+    /// Poses that have a super pose always keep their own data.
+    /// @param PoseCache   The pose cache to use. It must outlive this pose.
+    void SetPoseCache(PoseCacheT* PoseCache);
+
+    /// Makes sure that the data of this pose is computed before it is drawn at the given LOD distance.
+    ///
+    /// All other methods of this class recache the data of the pose implicitly when needed. This method and
+    /// ComputeCache() split this work in two steps, so that the expensive second step can run in a worker thread:
+    /// This method must be called in the main thread, as it accesses the anim expression pool of the model and
+    /// the pose cache. It returns the pose whose data must be computed by a call to ComputeCache(), or \c NULL if
+    /// the data is up-to-date. (The returned pose is a dlod pose or a pose in the pose cache if the data of
+    /// this pose is taken from there.)
+    ///
+    /// @param LodDist   The distance to the camera for reducing the level-of-detail, as for Draw().
+    const AnimPoseT* PrepareRecache(float LodDist) const;
+
+    /// Computes the data of a pose that has been returned by PrepareRecache().
+    /// The data of different poses can be computed in parallel, as long as nothing else accesses these poses
+    /// or their anim expressions in the meantime.
+    void ComputeCache() const;
+
     /// Call this if something in the related model has changed.
-    void SetNeedsRecache() { m_CachedAE=NULL; }
+    void SetNeedsRecache() { m_CachedAE=NULL; m_SkinMeshes.Overwrite(); }
 
     /// This method renders the model in this pose.
     /// The current MatSys model-view matrix determines the position and orientation.
@@ -141,24 +164,47 @@ class AnimPoseT
 
     private:
 
+    /// The data of a mesh that is needed to skin its vertices, in a structure-of-arrays layout that the
+    /// SIMD kernel in UpdateVertexPositions() can stream through without looking at the CafuModelT::MeshT.
+    /// This data only depends on the model, not on the pose, and is thus only computed in InitSkinMeshes().
+    struct SkinMeshT
+    {
+        ArrayT<unsigned int> VertexNrs;     ///< The vertices that are skinned: all vertices that are not a GeoDup of a vertex with a lower number.
+        ArrayT<unsigned int> NumWeights;    ///< For each skinned vertex, the number of its weights.
+        ArrayT<unsigned int> JointNrs;      ///< For each weight of the skinned vertices, the number of its joint.
+        ArrayT<float>        WeightedPos;   ///< For each weight of the skinned vertices, the four values (Pos*Weight, Weight). A single weight of a vertex counts as 1.0.
+        ArrayT<unsigned int> DupNrs;        ///< The vertices that are not skinned, but copied from the lower-numbered GeoDup in DupSrcNrs.
+        ArrayT<unsigned int> DupSrcNrs;     ///< For each vertex in DupNrs, the vertex that its position is copied from.
+        ArrayT<float>        TriUVs;        ///< For each triangle, the four texture-space factors that the edges are scaled with to obtain the tangent and binormal vectors.
+    };
+
     AnimPoseT(const AnimPoseT&);                    ///< Use of the Copy    Constructor is not allowed.
     void operator = (const AnimPoseT&);             ///< Use of the Assignment Operator is not allowed.
 
     void SyncDimensions() const;
+    void InitSkinMeshes() const;
     void UpdateJointMatrices() const;
     void UpdateVertexPositions() const;
     void UpdateTangentSpaceHard(unsigned long MeshNr) const;
     void UpdateTangentSpaceGlobal(unsigned long MeshNr) const;
     void UpdateTangentSpaceSmGroups(unsigned long MeshNr) const;
+    const AnimPoseT* GetPoseToRecache() const;
     void Recache() const;
 
     const CafuModelT&             m_Model;          ///< The related model that this is a pose for.
     AnimExpressionPtrT            m_AnimExpr;       ///< The expression that describes the skeleton pose for which we have computed the cache data.
     const AnimPoseT*              m_SuperPose;
     AnimPoseT*                    m_DlodPose;       ///< The next pose in the chain of dlod poses matching the chain of dlod models.
+    PoseCacheT*                   m_PoseCache;      ///< The cache that this pose shares its data with other poses through, if any.
+
+    mutable const AnimPoseT*      m_SharedPose;     ///< If non-NULL, the pose in m_PoseCache whose data is used instead of our own.
+    mutable unsigned long         m_SharedFrameNr;  ///< The frame number of m_PoseCache in which m_SharedPose was obtained.
 
     mutable AnimExpressionPtrT    m_CachedAE;       ///< Used to detect if the m_AnimExpr has changed, so that our matrices, meshes etc. can be recached.
+    mutable AnimExprProgramT      m_AnimProgram;    ///< The flattened form of m_AnimExpr that is used to compute the joint data of all joints at once.
     mutable ArrayT<MatrixT>       m_JointMatrices;  ///< The transformation matrices that represent the pose of the skeleton at the given animation sequence and frame number.
+    mutable ArrayT<float>         m_SkinMatrices;   ///< The m_JointMatrices in column-major order (16 floats per joint), as input for the skinning kernel.
+    mutable ArrayT<SkinMeshT>     m_SkinMeshes;     ///< The skinning data for each mesh in m_Model.
     mutable ArrayT<MeshInfoT>     m_MeshInfos;      ///< Additional data for each mesh in m_Model.
     mutable ArrayT<MatSys::MeshT> m_Draw_Meshes;    ///< The draw meshes resulting from the m_JointMatrices.
     mutable BoundingBox3fT        m_BoundingBox;    ///< The bounding-box for the model in this pose.
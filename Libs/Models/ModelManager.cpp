@@ -23,6 +23,9 @@ ModelManagerT::ModelManagerT()
 
 ModelManagerT::~ModelManagerT()
 {
+    // The cached poses refer to the models, so clear the cache first.
+    m_PoseCache.Clear();
+
     for (std::map<std::string, CafuModelT*>::const_iterator Model=m_Models.begin(); Model!=m_Models.end(); Model++)
         delete Model->second;
 
@@ -7,6 +7,8 @@ This project is licensed under the terms of the MIT license.
 #ifndef CAFU_MODEL_MANAGER_HPP_INCLUDED
 #define CAFU_MODEL_MANAGER_HPP_INCLUDED
 
+#include "PoseCache.hpp"
+
 #include <map>
 #include <string>
 
@@ -48,6 +50,10 @@ class ModelManagerT
     ///                   or the empty string \c "" when the model was successfully loaded.
     const CafuModelT* GetModel(const std::string& FileName, std::string* ErrorMsg=NULL) const;
 
+    /// Returns the cache through which the poses of the models of this manager can share their data.
+    /// The cache is disabled by default and must be enabled and advanced once per frame by its user.
+    PoseCacheT& GetPoseCache() const { return m_PoseCache; }
+
 
     private:
 
@@ -55,6 +61,7 @@ class ModelManagerT
     void operator = (const ModelManagerT&);     ///< Use of the Assignment Operator is not allowed.
 
     mutable std::map<std::string, CafuModelT*> m_Models;
+    mutable PoseCacheT                         m_PoseCache;     ///< The cache for sharing the data of equal poses of our models.
 };
 
 #endif
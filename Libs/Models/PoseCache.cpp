@@ -0,0 +1,152 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+#include "PoseCache.hpp"
+#include "AnimPose.hpp"
+#include "Model_cmdl.hpp"
+
+#include <cmath>
+
+
+PoseCacheT::PoseCacheT()
+    : m_IsEnabled(false),
+      m_FrameStep(0.0f),
+      m_FrameNr(0),
+      m_Mutex(),
+      m_Entries(),
+      m_NumHits(0),
+      m_NumMisses(0)
+{
+}
+
+
+PoseCacheT::~PoseCacheT()
+{
+    Clear();
+}
+
+
+void PoseCacheT::SetEnabled(bool IsEnabled)
+{
+    if (m_IsEnabled == IsEnabled) return;
+
+    m_IsEnabled = IsEnabled;
+    Clear();
+}
+
+
+void PoseCacheT::AdvanceFrame()
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+
+    for (std::map<const CafuModelT*, ArrayT<EntryT> >::iterator It = m_Entries.begin(); It != m_Entries.end(); )
+    {
+        ArrayT<EntryT>& Entries = It->second;
+
+        for (unsigned long EntryNr = 0; EntryNr < Entries.Size(); EntryNr++)
+        {
+            if (Entries[EntryNr].LastFrameNr < m_FrameNr)
+            {
+                delete Entries[EntryNr].Pose;
+                Entries.RemoveAt(EntryNr);
+                EntryNr--;
+            }
+        }
+
+        if (Entries.Size() == 0)
+            m_Entries.erase(It++);
+        else
+            ++It;
+    }
+
+    m_FrameNr++;
+}
+
+
+void PoseCacheT::Clear()
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+
+    for (std::map<const CafuModelT*, ArrayT<EntryT> >::iterator It = m_Entries.begin(); It != m_Entries.end(); ++It)
+        for (unsigned long EntryNr = 0; EntryNr < It->second.Size(); EntryNr++)
+            delete It->second[EntryNr].Pose;
+
+    m_Entries.clear();
+
+    // Make sure that the poses that still refer to the deleted entries look them up again.
+    m_FrameNr++;
+}
+
+
+const AnimPoseT* PoseCacheT::GetPose(const CafuModelT& Model, AnimExpressionPtrT AnimExpr)
+{
+    // Round the frame number of standard expressions, so that expressions with nearly the same frame number share their data.
+    if (m_FrameStep > 0.0f)
+    {
+        IntrusivePtrT<AnimExprStandardT> StdAE = dynamic_pointer_cast<AnimExprStandardT>(AnimExpr);
+
+        if (!StdAE.IsNull())
+        {
+            const float FrameNr = std::floor(StdAE->GetFrameNr() / m_FrameStep + 0.5f) * m_FrameStep;
+
+            if (FrameNr != StdAE->GetFrameNr())
+            {
+                IntrusivePtrT<AnimExprStandardT> RoundedAE = Model.GetAnimExprPool().GetStandard(StdAE->GetSequNr(), FrameNr);
+
+                RoundedAE->SetForceLoop(StdAE->GetForceLoop());
+                AnimExpr = RoundedAE;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    ArrayT<EntryT>& Entries = m_Entries[&Model];
+
+    for (unsigned long EntryNr = 0; EntryNr < Entries.Size(); EntryNr++)
+    {
+        EntryT& Entry = Entries[EntryNr];
+
+        if (AnimExpr->IsEqual(Entry.Pose->GetAnimExpr()))
+        {
+            Entry.LastFrameNr = m_FrameNr;
+            m_NumHits++;
+            return Entry.Pose;
+        }
+    }
+
+    // The entry needs its own copy of the anim expression, because the caller's expression keeps changing.
+    EntryT Entry;
+
+    // The data of the new entry is computed when it is first used, see AnimPoseT::PrepareRecache().
+    // As its anim expression never changes, the data is never recomputed after that.
+    Entry.Pose        = new AnimPoseT(Model, AnimExpr->Clone());
+    Entry.LastFrameNr = m_FrameNr;
+
+    Entries.PushBack(Entry);
+    m_NumMisses++;
+    return Entry.Pose;
+}
+
+
+unsigned long PoseCacheT::GetNumEntries() const
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    unsigned long NumEntries = 0;
+
+    for (std::map<const CafuModelT*, ArrayT<EntryT> >::const_iterator It = m_Entries.begin(); It != m_Entries.end(); ++It)
+        NumEntries += It->second.Size();
+
+    return NumEntries;
+}
+
+
+void PoseCacheT::ResetCounters()
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+
+    m_NumHits   = 0;
+    m_NumMisses = 0;
+}
@@ -0,0 +1,103 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+#ifndef CAFU_MODEL_POSE_CACHE_HPP_INCLUDED
+#define CAFU_MODEL_POSE_CACHE_HPP_INCLUDED
+
+#include "AnimExpr.hpp"
+
+#include <map>
+#include <mutex>
+
+
+class AnimPoseT;
+class CafuModelT;
+
+
+/// This class lets AnimPoseT instances share their cached data (joint matrices, skinned meshes, etc.)
+/// when they show the same model in the same skeleton pose.
+///
+/// If many entities show the same model with the same animation state (e.g. a crowd of idle NPCs),
+/// each AnimPoseT would otherwise compute exactly the same data.
+/// A pose that has been assigned a cache (see AnimPoseT::SetPoseCache()) looks up the data of its model
+/// and anim expression in the cache instead, which computes it only once for all poses that are
+/// equal in the sense of AnimExpressionT::IsEqual().
+///
+/// In order to increase the number of hits, the frame numbers of AnimExprStandardT expressions
+/// can be quantized, see SetFrameStep().
+///
+/// The cache is frame-scoped: entries that have not been used in the previous frame are removed
+/// in AdvanceFrame(), which the owner of the cache must call once per frame.
+/// The cache is disabled by default, see SetEnabled().
+class PoseCacheT
+{
+    public:
+
+    /// The constructor.
+    PoseCacheT();
+
+    /// The destructor.
+    ~PoseCacheT();
+
+    /// Returns whether the cache is enabled.
+    bool IsEnabled() const { return m_IsEnabled; }
+
+    /// Enables or disables the cache. Poses don't use the cache while it is disabled.
+    void SetEnabled(bool IsEnabled);
+
+    /// Sets the step that the frame numbers of AnimExprStandardT expressions are rounded to
+    /// before they are looked up, or 0.0 for looking up all anim expressions exactly.
+    void SetFrameStep(float FrameStep) { m_FrameStep = FrameStep; }
+
+    /// Returns the number of the current frame.
+    unsigned long GetFrameNr() const { return m_FrameNr; }
+
+    /// Begins the next frame, removing all entries that have not been used in the previous frame.
+    /// Poses that refer to the data of an entry look it up again when they are next used.
+    void AdvanceFrame();
+
+    /// Removes all entries from the cache.
+    void Clear();
+
+    /// Returns the pose whose data is shared by all poses of the given model with anim expressions that are
+    /// equal to the given anim expression. The returned pose is only valid until the next call to AdvanceFrame().
+    /// This method is thread-safe.
+    const AnimPoseT* GetPose(const CafuModelT& Model, AnimExpressionPtrT AnimExpr);
+
+    /// Returns the number of lookups that have been answered from the cache since the last call to ResetCounters().
+    unsigned long GetNumHits() const { return m_NumHits; }
+
+    /// Returns the number of lookups that required new data to be computed since the last call to ResetCounters().
+    unsigned long GetNumMisses() const { return m_NumMisses; }
+
+    /// Returns the number of entries that are currently in the cache.
+    unsigned long GetNumEntries() const;
+
+    /// Resets the hit and miss counters.
+    void ResetCounters();
+
+
+    private:
+
+    PoseCacheT(const PoseCacheT&);          ///< Use of the Copy Constructor    is not allowed.
+    void operator = (const PoseCacheT&);    ///< Use of the Assignment Operator is not allowed.
+
+    struct EntryT
+    {
+        AnimPoseT*    Pose;         ///< The pose whose data is shared. Its anim expression is the key of this entry.
+        unsigned long LastFrameNr;  ///< The number of the frame in which this entry was last used.
+    };
+
+    bool                                          m_IsEnabled;  ///< Is the cache enabled?
+    float                                         m_FrameStep;  ///< The step that the frame numbers of AnimExprStandardT expressions are rounded to.
+    unsigned long                                 m_FrameNr;    ///< The number of the current frame.
+    mutable std::mutex                            m_Mutex;      ///< Protects m_Entries and the counters.
+    std::map<const CafuModelT*, ArrayT<EntryT> >  m_Entries;    ///< The entries of the cache, per model.
+    unsigned long                                 m_NumHits;    ///< The number of cache hits since the last call to ResetCounters().
+    unsigned long                                 m_NumMisses;  ///< The number of cache misses since the last call to ResetCounters().
+};
+
+#endif
@@ -6,6 +6,7 @@ This project is licensed under the terms of the MIT license.
 
 #include "Network.hpp"
 
+#include <algorithm>
 #include <stdio.h>
 #ifndef _WIN32
 #include <sys/types.h>
@@ -16,6 +17,10 @@ This project is licensed under the terms of the MIT license.
 #include <errno.h>
 #endif
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
 
 /***************/
 /*** WinSock ***/
@@ -279,6 +284,258 @@ NetAddressT NetDataT::Receive(SOCKET Socket) /*throw (WinSockAPIError)*/
 }
 
 
+/***********************/
+/*** Network Batches ***/
+/***********************/
+
+namespace
+{
+    // The maximum number of packets that are received with a single system call, and the buffer size for each packet.
+    // Packets of our protocols are never larger than GameProtocol1T::MAX_MSG_SIZE plus the header.
+    const unsigned long BATCH_MAX_PACKETS  = 32;
+    const unsigned long BATCH_PACKET_SIZE  = 16384;
+}
+
+NetBatchT::NetBatchT(SOCKET Socket)
+    : m_Socket(Socket),
+      m_EpollFD(-1),
+      m_ReceiveBuffer(),
+      m_SendDatas(),
+      m_SendAddresses(),
+      m_NumQueued(0)
+{
+#ifdef __linux__
+    m_EpollFD=epoll_create1(0);
+
+    if (m_EpollFD!=-1)
+    {
+        epoll_event Event;
+
+        memset(&Event, 0, sizeof(Event));
+        Event.events =EPOLLIN;
+        Event.data.fd=m_Socket;
+
+        if (epoll_ctl(m_EpollFD, EPOLL_CTL_ADD, m_Socket, &Event)==-1)
+        {
+            // Fall back to select().
+            close(m_EpollFD);
+            m_EpollFD=-1;
+        }
+    }
+
+    m_ReceiveBuffer.PushBackEmptyExact(BATCH_MAX_PACKETS*BATCH_PACKET_SIZE);
+#endif
+}
+
+NetBatchT::~NetBatchT()
+{
+#ifdef __linux__
+    if (m_EpollFD!=-1) close(m_EpollFD);
+#endif
+}
+
+bool NetBatchT::WaitForPackets(unsigned int TimeOutMS) /*throw (WinSockAPIError)*/
+{
+#ifdef __linux__
+    if (m_EpollFD!=-1)
+    {
+        epoll_event Event;
+        const int   Result=epoll_wait(m_EpollFD, &Event, 1, int(TimeOutMS));
+
+        if (Result==-1 && errno!=EINTR) throw NetDataT::WinSockAPIError(errno);
+        return Result>0;
+    }
+#endif
+
+    fd_set  ReadabilitySocketSet;
+    timeval TimeOut;
+
+    TimeOut.tv_sec =TimeOutMS/1000;
+    TimeOut.tv_usec=(TimeOutMS % 1000)*1000;
+
+    FD_ZERO(&ReadabilitySocketSet);
+    FD_SET(m_Socket, &ReadabilitySocketSet);
+
+    // select() bricht mit der Anzahl der lesbar gewordenen Sockets ab, 0 bei TimeOut oder SOCKET_ERROR im Fehlerfall.
+    const int Result=select(int(m_Socket+1), &ReadabilitySocketSet, NULL, NULL, &TimeOut);
+
+    if (Result==SOCKET_ERROR) throw NetDataT::WinSockAPIError(WSAGetLastError());
+    return Result>0;
+}
+
+unsigned long NetBatchT::Receive(ArrayT<NetDataT>& InDatas, ArrayT<NetAddressT>& SenderAddresses, unsigned long MaxPackets) /*throw (WinSockAPIError)*/
+{
+    SenderAddresses.Overwrite();
+    if (MaxPackets==0) return 0;
+
+#ifdef __linux__
+    if (MaxPackets>BATCH_MAX_PACKETS) MaxPackets=BATCH_MAX_PACKETS;
+
+    mmsghdr     Msgs[BATCH_MAX_PACKETS];
+    iovec       IOVecs[BATCH_MAX_PACKETS];
+    sockaddr_in Addrs[BATCH_MAX_PACKETS];
+
+    memset(Msgs, 0, sizeof(Msgs));
+
+    for (unsigned long Nr=0; Nr<MaxPackets; Nr++)
+    {
+        IOVecs[Nr].iov_base=&m_ReceiveBuffer[Nr*BATCH_PACKET_SIZE];
+        IOVecs[Nr].iov_len =BATCH_PACKET_SIZE;
+
+        Msgs[Nr].msg_hdr.msg_name   =&Addrs[Nr];
+        Msgs[Nr].msg_hdr.msg_namelen=sizeof(Addrs[Nr]);
+        Msgs[Nr].msg_hdr.msg_iov    =&IOVecs[Nr];
+        Msgs[Nr].msg_hdr.msg_iovlen =1;
+    }
+
+    const int Result=recvmmsg(m_Socket, Msgs, (unsigned int)MaxPackets, 0, NULL);
+
+    if (Result==-1)
+    {
+        if (errno==EAGAIN || errno==EWOULDBLOCK || errno==EINTR) return 0;
+        throw NetDataT::WinSockAPIError(errno);
+    }
+
+    if (InDatas.Size()<(unsigned long)Result) InDatas.PushBackEmpty(Result-InDatas.Size());
+
+    unsigned long NumPackets=0;
+
+    for (int Nr=0; Nr<Result; Nr++)
+    {
+        // Drop truncated packets, they cannot be valid.
+        if (Msgs[Nr].msg_hdr.msg_flags & MSG_TRUNC) continue;
+
+        NetDataT& InData=InDatas[NumPackets];
+
+        InData.ReadBegin();
+        InData.Data.Overwrite();
+        InData.Data.PushBackEmpty(Msgs[Nr].msg_len);
+        if (Msgs[Nr].msg_len>0) memcpy(&InData.Data[0], IOVecs[Nr].iov_base, Msgs[Nr].msg_len);
+
+        SenderAddresses.PushBack(NetAddressT(Addrs[Nr]));
+        NumPackets++;
+    }
+
+    return NumPackets;
+#else
+    // Receive a single packet in the traditional way, so that the caller sees all errors just as before.
+    if (InDatas.Size()<1) InDatas.PushBackEmpty();
+
+    try
+    {
+        SenderAddresses.PushBack(InDatas[0].Receive(m_Socket));
+    }
+    catch (const NetDataT::WinSockAPIError& E)
+    {
+#ifdef _WIN32
+        if (E.Error==WSAEWOULDBLOCK) return 0;
+#else
+        if (E.Error==EWOULDBLOCK) return 0;
+#endif
+        throw;
+    }
+
+    return 1;
+#endif
+}
+
+void NetBatchT::QueueSend(const NetDataT& Data, const NetAddressT& ReceiverAddress)
+{
+    if (m_NumQueued<m_SendDatas.Size())
+    {
+        m_SendDatas[m_NumQueued].Overwrite();
+        m_SendDatas[m_NumQueued].PushBack(Data.Data);
+        m_SendAddresses[m_NumQueued]=ReceiverAddress;
+    }
+    else
+    {
+        m_SendDatas.PushBack(Data.Data);
+        m_SendAddresses.PushBack(ReceiverAddress);
+    }
+
+    m_NumQueued++;
+}
+
+void NetBatchT::Flush() /*throw (WinSockAPIError, MessageLength)*/
+{
+    const unsigned long NumQueued=m_NumQueued;
+
+    // Clear the queue now, so that the next frame starts over even if we throw below.
+    m_NumQueued=0;
+
+    unsigned long FailedNr   =NumQueued;    // The number of the first packet that could not be sent.
+    unsigned long FailedError=0;            // Its error, 0 if it was only partially sent.
+    unsigned long FailedSent =0;            // The number of bytes that were sent of it.
+
+#ifdef __linux__
+    unsigned long Start=0;
+
+    while (Start<NumQueued)
+    {
+        const unsigned long Count=std::min(NumQueued-Start, BATCH_MAX_PACKETS);
+        mmsghdr             Msgs[BATCH_MAX_PACKETS];
+        iovec               IOVecs[BATCH_MAX_PACKETS];
+        sockaddr_in         Addrs[BATCH_MAX_PACKETS];
+
+        memset(Msgs, 0, sizeof(Msgs));
+
+        for (unsigned long Nr=0; Nr<Count; Nr++)
+        {
+            ArrayT<char>& Data=m_SendDatas[Start+Nr];
+
+            Addrs[Nr]=m_SendAddresses[Start+Nr].ToSockAddrIn();
+
+            IOVecs[Nr].iov_base=Data.Size()>0 ? &Data[0] : NULL;
+            IOVecs[Nr].iov_len =Data.Size();
+
+            Msgs[Nr].msg_hdr.msg_name   =&Addrs[Nr];
+            Msgs[Nr].msg_hdr.msg_namelen=sizeof(Addrs[Nr]);
+            Msgs[Nr].msg_hdr.msg_iov    =&IOVecs[Nr];
+            Msgs[Nr].msg_hdr.msg_iovlen =1;
+        }
+
+        const int Result=sendmmsg(m_Socket, Msgs, (unsigned int)Count, 0);
+
+        if (Result==-1)
+        {
+            if (errno==EINTR) continue;
+
+            // The packet at Start could not be sent: record the error, skip the packet and continue with the next.
+            if (FailedNr==NumQueued) { FailedNr=Start; FailedError=errno; }
+            Start++;
+            continue;
+        }
+
+        for (int Nr=0; Nr<Result; Nr++)
+            if (Msgs[Nr].msg_len<IOVecs[Nr].iov_len && FailedNr==NumQueued)
+            {
+                FailedNr  =Start+Nr;
+                FailedSent=Msgs[Nr].msg_len;
+            }
+
+        Start+=Result;
+    }
+#else
+    for (unsigned long Nr=0; Nr<NumQueued; Nr++)
+    {
+        const ArrayT<char>& Data  =m_SendDatas[Nr];
+        const sockaddr_in   RA    =m_SendAddresses[Nr].ToSockAddrIn();
+        const int           Result=sendto(m_Socket, &Data[0], Data.Size(), 0, (const sockaddr*)&RA, sizeof(RA));
+
+        if (FailedNr<NumQueued) continue;
+
+        if (Result==SOCKET_ERROR) { FailedNr=Nr; FailedError=WSAGetLastError(); }
+        else if ((unsigned long)Result<Data.Size()) { FailedNr=Nr; FailedSent=Result; }
+    }
+#endif
+
+    if (FailedNr==NumQueued) return;
+    if (FailedError!=0) throw NetDataT::WinSockAPIError(FailedError, m_SendAddresses[FailedNr]);
+
+    throw NetDataT::MessageLength(m_SendDatas[FailedNr].Size(), FailedSent);
+}
+
+
 /*******************************/
 /*** Game Network Protocol 1 ***/
 /*******************************/
@@ -441,3 +698,230 @@ bool GameProtocol1T::IsIncomingMessageOutOfBand(NetDataT& InData)
     InData.ReadBegin();
     return false;
 }
+
+
+/*******************************/
+/*** Game Network Protocol 2 ***/
+/*******************************/
+
+const unsigned long GameProtocol2T::MAX_MSG_SIZE      = 8192;   // The same as GameProtocol1T::MAX_MSG_SIZE.
+const unsigned long GameProtocol2T::MAX_FRAGMENT_SIZE = 1024;   // Must be less than 0x8000, see the fragment header below.
+const unsigned long GameProtocol2T::WINDOW_SIZE       = 33;     // The first fragment that we don't have plus the 32 bits of the selective acknowledgement.
+
+GameProtocol2T::GameProtocol2T()
+    : NextOutgoingSequenceNr(1),
+      LastIncomingSequenceNr(0),
+      NextOutFragmentNr(0),
+      OutFragments(),
+      NextInFragmentNr(0),
+      InFragments(),
+      InMessage()
+{
+}
+
+void GameProtocol2T::QueueReliableMessage(const ArrayT<char>& Message)
+{
+    unsigned long Pos=0;
+
+    // If the last fragment has never been sent and the whole message still fits, append the message to it.
+    // This way, many small messages (like the entity baselines) share a fragment, just like they share a packet with GameProtocol1T.
+    if (OutFragments.Size()>0)
+    {
+        OutFragmentT& Last=OutFragments[OutFragments.Size()-1];
+
+        if (Last.SentSequenceNr==0 && Last.Data.Size()+Message.Size()<=MAX_FRAGMENT_SIZE)
+        {
+            for (unsigned long c=0; c<Message.Size(); c++)
+                Last.Data.PushBack(Message[c]);
+
+            return;
+        }
+    }
+
+    // Otherwise split the message into as many new fragments as needed.
+    do
+    {
+        const unsigned long Size=std::min(MAX_FRAGMENT_SIZE, Message.Size()-Pos);
+
+        OutFragments.PushBackEmpty();
+        OutFragmentT& Frag=OutFragments[OutFragments.Size()-1];
+
+        Frag.FragmentNr    =NextOutFragmentNr++;
+        Frag.Data.Overwrite();
+        Frag.EndsMessage   =(Pos+Size==Message.Size());
+        Frag.SentSequenceNr=0;
+        Frag.Resend        =false;
+
+        for (unsigned long c=0; c<Size; c++)
+            Frag.Data.PushBack(Message[Pos+c]);
+
+        Pos+=Size;
+    } while (Pos<Message.Size());
+}
+
+const NetDataT& GameProtocol2T::GetTransmitData(const ArrayT< ArrayT<char> >& ReliableDatas, const ArrayT<char>& UnreliableData)
+{
+    for (unsigned long Nr=0; Nr<ReliableDatas.Size(); Nr++)
+        if (ReliableDatas[Nr].Size()>0)
+            QueueReliableMessage(ReliableDatas[Nr]);
+
+    // A packet of this protocol consists of:
+    //   - the sequence number of this packet,
+    //   - the sequence number of the last packet that we have seen from the remote party,
+    //   - the number of the next fragment that we expect from the remote party (all fragments before it have been received),
+    //   - 32 bits that selectively acknowledge the 32 fragments after the expected one,
+    //   - the number of reliable fragments in this packet, each with its number, size, "ends message" flag and payload,
+    //   - the unreliable data.
+    // OutData is overwritten rather than re-assigned, so that its memory is reused for each packet.
+    static NetDataT OutData;
+    OutData.Data.Overwrite();
+    OutData.ReadBegin();
+
+    uint32_t AckBits=0;
+
+    for (unsigned long Nr=0; Nr<InFragments.Size(); Nr++)
+        AckBits|=uint32_t(1) << (InFragments[Nr].FragmentNr-NextInFragmentNr-1);
+
+    OutData.WriteLong(NextOutgoingSequenceNr);
+    OutData.WriteLong(LastIncomingSequenceNr);
+    OutData.WriteLong(NextInFragmentNr);
+    OutData.WriteLong(AckBits);
+
+    const unsigned long NumFragmentsPos=OutData.Data.Size();
+    uint8_t             NumFragments   =0;
+
+    OutData.WriteByte(0);   // Placeholder for NumFragments.
+
+    // Send the fragments in the window that are new or have been lost, as many as fit into the packet.
+    // Room for the unreliable data is kept, because with many fragments in flight, the packets would
+    // otherwise often be filled with reliable data only (e.g. while the client receives the baselines).
+    const unsigned long ReservedSize=(OutData.Data.Size()+UnreliableData.Size()<=MAX_MSG_SIZE) ? UnreliableData.Size() : 0;
+
+    for (unsigned long Nr=0; Nr<OutFragments.Size() && NumFragments<255; Nr++)
+    {
+        OutFragmentT& Frag=OutFragments[Nr];
+
+        if (Frag.FragmentNr>=OutFragments[0].FragmentNr+WINDOW_SIZE) break;
+        if (Frag.SentSequenceNr!=0 && !Frag.Resend) continue;
+        if (OutData.Data.Size()+6+Frag.Data.Size()+ReservedSize>MAX_MSG_SIZE) break;
+
+        OutData.WriteLong(Frag.FragmentNr);
+        OutData.WriteWord((unsigned short)(Frag.Data.Size() | (Frag.EndsMessage ? 0x8000 : 0)));
+        OutData.WriteArrayOfBytes(Frag.Data);
+
+        Frag.SentSequenceNr=NextOutgoingSequenceNr;
+        Frag.Resend        =false;
+        NumFragments++;
+    }
+
+    OutData.Data[NumFragmentsPos]=NumFragments;
+
+    // Falls noch genug Platz übrig ist, hänge die UnreliableData an.
+    if (OutData.Data.Size()+UnreliableData.Size()<=MAX_MSG_SIZE) OutData.WriteArrayOfBytes(UnreliableData);
+
+    NextOutgoingSequenceNr++;
+    return OutData;
+}
+
+unsigned long GameProtocol2T::ProcessIncomingMessage(NetDataT& InData, void (*ProcessPayload)(NetDataT& /*Payload*/, unsigned long /*LastIncomingSequenceNr*/))
+{
+    const unsigned long RemoteThisOutgoingSequenceNr=InData.ReadLong();
+    const unsigned long RemoteLastIncomingSequenceNr=InData.ReadLong();
+    const unsigned long RemoteNextInFragmentNr      =InData.ReadLong();
+    const uint32_t      RemoteAckBits               =InData.ReadLong();
+    const unsigned long NumFragments                =(uint8_t)InData.ReadByte();
+
+    if (InData.ReadOfl) return 0;
+
+    // Remove the fragments that the remote party has acknowledged.
+    // Acknowledgements remain true even if they arrive late, so we can evaluate them even for out-of-order packets.
+    for (unsigned long Nr=0; Nr<OutFragments.Size(); Nr++)
+    {
+        const unsigned long FragNr=OutFragments[Nr].FragmentNr;
+
+        if (FragNr<RemoteNextInFragmentNr || (FragNr>RemoteNextInFragmentNr && FragNr<=RemoteNextInFragmentNr+32 && (RemoteAckBits & (uint32_t(1) << (FragNr-RemoteNextInFragmentNr-1)))))
+        {
+            OutFragments.RemoveAtAndKeepOrder(Nr);
+            Nr--;
+        }
+    }
+
+    // If the remote party has seen a packet that carried a fragment, but not acknowledged the fragment, it was lost.
+    // As with GameProtocol1T, a retransmit is only triggered here, when we learn that the fragment should have arrived already.
+    for (unsigned long Nr=0; Nr<OutFragments.Size(); Nr++)
+    {
+        OutFragmentT& Frag=OutFragments[Nr];
+
+        if (Frag.SentSequenceNr!=0 && Frag.SentSequenceNr<=RemoteLastIncomingSequenceNr)
+            Frag.Resend=true;
+    }
+
+    // Read the reliable fragments.
+    // Fragments that arrive out of order are kept in InFragments until the missing fragments before them have arrived.
+    for (unsigned long Nr=0; Nr<NumFragments; Nr++)
+    {
+        const unsigned long  FragNr   =InData.ReadLong();
+        const unsigned short SizeFlags=InData.ReadWord();
+        const unsigned long  Size     =SizeFlags & 0x7FFF;
+
+        if (InData.ReadOfl || InData.ReadPos+Size>InData.Data.Size()) return 0;
+
+        const unsigned long Start=InData.ReadPos;
+        InData.ReadPos+=Size;
+
+        // Ignore duplicates and fragments outside of the window.
+        if (FragNr<NextInFragmentNr || FragNr>=NextInFragmentNr+WINDOW_SIZE) continue;
+
+        unsigned long i;
+
+        for (i=0; i<InFragments.Size(); i++)
+            if (InFragments[i].FragmentNr==FragNr) break;
+
+        if (i<InFragments.Size()) continue;
+
+        InFragments.PushBackEmpty();
+        InFragmentT& Frag=InFragments[InFragments.Size()-1];
+
+        Frag.FragmentNr =FragNr;
+        Frag.EndsMessage=(SizeFlags & 0x8000)!=0;
+        Frag.Data.Overwrite();
+        Frag.Data.PushBackEmptyExact(Size);
+        if (Size>0) memcpy(&Frag.Data[0], &InData.Data[Start], Size);
+    }
+
+    // Move all fragments that are now in order into the current message, and collect all completed messages.
+    NetDataT Payload;
+
+    for (unsigned long i=0; i<InFragments.Size(); i++)
+    {
+        if (InFragments[i].FragmentNr!=NextInFragmentNr) continue;
+
+        InMessage.PushBack(InFragments[i].Data);
+
+        if (InFragments[i].EndsMessage)
+        {
+            Payload.WriteArrayOfBytes(InMessage);
+            InMessage.Overwrite();
+        }
+
+        InFragments.RemoveAt(i);
+        NextInFragmentNr++;
+        i=(unsigned long)-1;    // Start over, the next fragment may be anywhere in InFragments.
+    }
+
+    // The unreliable data of packets that are older than one that we have already seen is ignored, as with GameProtocol1T.
+    const bool IsObsolete=RemoteThisOutgoingSequenceNr<=LastIncomingSequenceNr;
+
+    if (!IsObsolete)
+    {
+        LastIncomingSequenceNr=RemoteThisOutgoingSequenceNr;
+
+        for (unsigned long c=InData.ReadPos; c<InData.Data.Size(); c++)
+            Payload.Data.PushBack(InData.Data[c]);
+    }
+
+    if (ProcessPayload && (!IsObsolete || Payload.Data.Size()>0)) ProcessPayload(Payload, LastIncomingSequenceNr);
+
+    return IsObsolete ? 0 : RemoteLastIncomingSequenceNr;
+}
+
@@ -102,6 +102,9 @@ class NetAddressT
     /// Exception that is thrown on name look-up failure
     struct BadHostName : public NetworkError { };
 
+    /// Constructor for the address 0.0.0.0:0.
+    NetAddressT() : Port(0) { IP[0]=IP[1]=IP[2]=IP[3]=0; }
+
     /// Constructor.
     /// @param IP0 The first byte of the IP address.
     /// @param IP1 The second byte of the IP address.
@@ -299,12 +302,27 @@ class NetDataT
     {
         ArrayT<uint8_t> DMsg;
 
-        DMsg.PushBackEmptyExact(ReadLong());
-        for (unsigned long i=0; i<DMsg.Size(); i++) DMsg[i]=ReadByte();
-
+        ReadDMsg(DMsg);
         return DMsg;
     }
 
+    /// Reads a delta message for cf::Network::StateT from the data buffer into the given array.
+    /// The memory of DMsg is reused, so that reading many delta messages into the same array doesn't allocate memory.
+    /// @param DMsg   Receives the delta message. It is empty if the data buffer doesn't hold the entire message.
+    void ReadDMsg(ArrayT<uint8_t>& DMsg)
+    {
+        const uint32_t Size=ReadLong();
+
+        DMsg.Overwrite();
+
+        if (Size>Data.Size()-ReadPos) { ReadOfl=true; return; }
+        if (Size==0) return;
+
+        DMsg.PushBackEmpty(Size);
+        memcpy(&DMsg[0], &Data[ReadPos], Size);
+        ReadPos+=Size;
+    }
+
     /// Writes one Byte (8 Bit) into the data buffer.
     /// @param b Byte to write.
     void WriteByte(char b)
@@ -359,7 +377,20 @@ class NetDataT
     /// @param AoB Byte array to write.
     void WriteArrayOfBytes(const ArrayT<char>& AoB)
     {
-        for (unsigned long i=0; i<AoB.Size(); i++) Data.PushBack(AoB[i]);
+        Data.PushBack(AoB);
+    }
+
+    /// Writes a block of bytes into the data buffer.
+    /// @param Bytes   The bytes to write.
+    /// @param Count   The number of bytes to write.
+    void WriteBytes(const void* Bytes, unsigned long Count)
+    {
+        if (Count==0) return;
+
+        const unsigned long Start=Data.Size();
+
+        Data.PushBackEmpty(Count);
+        memcpy(&Data[Start], Bytes, Count);
     }
 
     /// Writes a delta message as created by cf::Network::StateT into the data buffer.
@@ -367,7 +398,7 @@ class NetDataT
     void WriteDMsg(const ArrayT<uint8_t>& DMsg)
     {
         WriteLong(DMsg.Size());
-        for (unsigned long i=0; i<DMsg.Size(); i++) Data.PushBack(DMsg[i]);
+        if (DMsg.Size()>0) WriteBytes(&DMsg[0], DMsg.Size());
     }
 
 
@@ -386,6 +417,62 @@ class NetDataT
 };
 
 
+/// This class receives and sends many UDP packets over a (non-blocking) socket at once.
+/// On Linux, it waits for incoming packets with epoll, receives all available packets with a single call
+/// to recvmmsg() and sends all queued packets with a single call to sendmmsg(). On other platforms, it
+/// falls back to select(), recvfrom() and sendto(), so that it can be used in portable code.
+class NetBatchT
+{
+    public:
+
+    /// Constructor.
+    /// @param Socket   The non-blocking UDP socket to receive and send the packets with. It is not owned by this NetBatchT.
+    NetBatchT(SOCKET Socket);
+
+    /// Destructor.
+    ~NetBatchT();
+
+    /// Waits until a packet can be received or the timeout has expired.
+    /// @param TimeOutMS   The timeout in milliseconds.
+    /// @return Whether a packet can be received.
+    /// @throw NetDataT::WinSockAPIError if the underlying system call failed.
+    bool WaitForPackets(unsigned int TimeOutMS);
+
+    /// Receives up to MaxPackets packets that are available at the socket, without blocking.
+    /// On failure, an exception is thrown just like NetDataT::Receive() does.
+    /// @param InDatas           Receives the packets, resized as required.
+    /// @param SenderAddresses   Receives the addresses of the senders of the packets.
+    /// @param MaxPackets        The maximum number of packets to receive.
+    /// @return The number of received packets, 0 if no packet is available.
+    /// @throw NetDataT::WinSockAPIError if receiving failed.
+    unsigned long Receive(ArrayT<NetDataT>& InDatas, ArrayT<NetAddressT>& SenderAddresses, unsigned long MaxPackets);
+
+    /// Queues the given packet for sending with the next call to Flush().
+    /// The data is copied, so that the caller can re-use Data immediately.
+    void QueueSend(const NetDataT& Data, const NetAddressT& ReceiverAddress);
+
+    /// Sends all queued packets.
+    /// If a packet cannot be sent, the remaining packets are still sent, and the error of the first packet
+    /// that failed is thrown afterwards, just like NetDataT::Send() does.
+    /// @throw NetDataT::WinSockAPIError if sending a packet failed.
+    /// @throw NetDataT::MessageLength if a packet was not completely sent.
+    void Flush();
+
+
+    private:
+
+    NetBatchT(const NetBatchT&);            ///< Use of the Copy Constructor    is not allowed.
+    void operator = (const NetBatchT&);     ///< Use of the Assignment Operator is not allowed.
+
+    SOCKET                 m_Socket;            ///< The socket that we receive and send the packets with.
+    int                    m_EpollFD;           ///< The epoll instance that the socket is registered with (Linux only, -1 otherwise).
+    ArrayT<char>           m_ReceiveBuffer;     ///< The buffers that recvmmsg() receives the packets into.
+    ArrayT< ArrayT<char> > m_SendDatas;         ///< The queued packets. Elements beyond m_NumQueued are kept for re-use.
+    ArrayT<NetAddressT>    m_SendAddresses;     ///< The receiver addresses of the queued packets.
+    unsigned long          m_NumQueued;         ///< The number of queued packets.
+};
+
+
 /// This class implements a mixture of a reliable and unreliable, bi-directional network protocol for Cafu.
 /// Focus is on delivering unreliable messages fast and reliable messages reliable (excatly once and in order).
 class GameProtocol1T
@@ -472,4 +559,95 @@ class GameProtocol1T
     static bool IsIncomingMessageOutOfBand(NetDataT& InData);
 };
 
+
+/// This class implements version 2 of the bi-directional network protocol for Cafu.
+/// Its interface and the way in which reliable and unreliable data is delivered are the same as with GameProtocol1T,
+/// but the reliable data is sent as a sliding window of numbered fragments:
+///   - Many reliable fragments can be in flight at a time, so queued reliable messages don't wait a full round trip each.
+///   - Each packet acknowledges the received fragments selectively, and only lost fragments are sent again.
+///   - Reliable messages that are larger than a fragment are split over several fragments (and thus packets).
+class GameProtocol2T
+{
+    public:
+
+    /// Create a connection over the GameProtocol2T.
+    GameProtocol2T();
+
+    /// Returns a NetDataT with the given 'UnreliableData' and as many of the reliable fragments as fit into a network packet,
+    /// ready to be sent to the protocol remote client.
+    /// The 'ReliableDatas' are appended to the queue of reliable data. As with GameProtocol1T, each 'ReliableDatas[i]'
+    /// should be a self-contained "reliable message": the remote client always gets complete messages.
+    /// Unlike with GameProtocol1T, there is no limit on the size of the 'ReliableDatas[i]'.
+    /// @param ReliableDatas Reliable data parts from which the NetDataT is build.
+    /// @param UnreliableData Unreliable data from which the NetDataT is build.
+    /// @return NetDataT object ready to send over the network.
+    const NetDataT& GetTransmitData(const ArrayT< ArrayT<char> >& ReliableDatas, const ArrayT<char>& UnreliableData);
+
+    /// Passes the data that has been received from our protocol remote client to ProcessPayload() for evaluation.
+    /// The payload consists of all reliable messages that have become complete with this packet (in order),
+    /// followed by the unreliable data of the packet, unless the packet is older than a previously received one.
+    /// If an error occurs (e.g. InData not usable because obsolete) 0 is returned.
+    /// Otherwise the return value is the last SequenceNr that the remote client has seen from us (RemoteLastIncomingSequenceNr).
+    /// @param InData The data received from a remote client.
+    /// @param ProcessPayload The function used to process the payload.
+    /// @return The last SequenceNr that the remote client has seen from us (RemoteLastIncomingSequenceNr)
+    unsigned long ProcessIncomingMessage(NetDataT& InData, void (*ProcessPayload)(NetDataT& /*Payload*/, unsigned long /*LastIncomingSequenceNr*/));
+
+    /// Returns the sequence number of the next packet sent to the remote client that is not-out-of-band.
+    /// @return The sequence number of the next packet sent to the remote client that is not-out-of-band.
+    unsigned long GetNextOutgoingSequenceNr() { return NextOutgoingSequenceNr; }
+
+    /// Returns the number of reliable fragments that have not yet been acknowledged by the remote client.
+    unsigned long GetNumUnackedFragments() const { return OutFragments.Size(); }
+
+    /// Returns NetDataT with 'UnreliableData' as 'out-of-band' message. NetData can then be sent to the protocol remote client.
+    /// This is the same as GameProtocol1T::GetTransmitOutOfBandData().
+    static const NetDataT& GetTransmitOutOfBandData(const ArrayT<char>& UnreliableData) { return GameProtocol1T::GetTransmitOutOfBandData(UnreliableData); }
+
+    /// Returns true if 'InData' is a 'out-of-band' message, 'false' otherwise.
+    /// This is the same as GameProtocol1T::IsIncomingMessageOutOfBand().
+    static bool IsIncomingMessageOutOfBand(NetDataT& InData) { return GameProtocol1T::IsIncomingMessageOutOfBand(InData); }
+
+
+    private:
+
+    /// Maximum message size that can be sent over the network.
+    static const unsigned long MAX_MSG_SIZE;
+
+    /// Maximum size of the payload of a reliable fragment.
+    static const unsigned long MAX_FRAGMENT_SIZE;
+
+    /// The number of reliable fragments that can be in flight at a time (also the range of the selective acknowledgements).
+    static const unsigned long WINDOW_SIZE;
+
+    /// A fragment of the reliable data that we send to the remote party.
+    struct OutFragmentT
+    {
+        unsigned long FragmentNr;       ///< The number of this fragment.
+        ArrayT<char>  Data;             ///< The payload of this fragment.
+        bool          EndsMessage;      ///< Whether this fragment completes a reliable message (i.e. whether a message boundary is at the end of Data).
+        unsigned long SentSequenceNr;   ///< The sequence number of the last packet that carried this fragment, 0 if it has not been sent yet.
+        bool          Resend;           ///< Whether this fragment has been lost and must be sent again.
+    };
+
+    /// A fragment of the reliable data that we have received from the remote party, but that cannot be delivered yet.
+    struct InFragmentT
+    {
+        unsigned long FragmentNr;   ///< The number of this fragment.
+        ArrayT<char>  Data;         ///< The payload of this fragment.
+        bool          EndsMessage;  ///< Whether this fragment completes a reliable message.
+    };
+
+    /// Appends the given reliable message to the OutFragments.
+    void QueueReliableMessage(const ArrayT<char>& Message);
+
+    unsigned long        NextOutgoingSequenceNr;    ///< Number of the next packet to be sent to the remote party.
+    unsigned long        LastIncomingSequenceNr;    ///< Number of the last (most recent) packet we got from the remote party.
+    unsigned long        NextOutFragmentNr;         ///< Number of the next fragment that is added to OutFragments.
+    ArrayT<OutFragmentT> OutFragments;              ///< The fragments that we send and that the remote party has not yet acknowledged, in order.
+    unsigned long        NextInFragmentNr;          ///< Number of the next fragment that we expect: we have received all fragments before this one.
+    ArrayT<InFragmentT>  InFragments;               ///< The fragments that we have received after a fragment that is still missing.
+    ArrayT<char>         InMessage;                 ///< The fragments of the incomplete reliable message that we are currently receiving.
+};
+
 #endif
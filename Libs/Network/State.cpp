@@ -89,6 +89,81 @@ namespace
             }
         }
     }
+
+
+    // The tag of the record in a DELTA_FIELDS delta message that carries the rest of the state,
+    // next to the tags StateT::FIELD_UINT8 to StateT::FIELD_STRING of the records for single fields.
+    const unsigned int TAG_REST = 7;
+
+    void WriteVarInt(ArrayT<uint8_t>& Dest, uint64_t Value)
+    {
+        while (Value >= 0x80)
+        {
+            Dest.PushBack(uint8_t(Value | 0x80));
+            Value >>= 7;
+        }
+
+        Dest.PushBack(uint8_t(Value));
+    }
+
+    uint64_t ReadVarInt(const ArrayT<uint8_t>& Source, unsigned int& Pos)
+    {
+        uint64_t Value = 0;
+
+        for (unsigned int Shift = 0; Pos < Source.Size() && Shift < 64; Shift += 7)
+        {
+            const uint8_t b = Source[Pos++];
+
+            Value |= uint64_t(b & 0x7F) << Shift;
+            if ((b & 0x80) == 0) break;
+        }
+
+        return Value;
+    }
+
+    // Reads an unsigned integer of the given size in network byte order.
+    uint64_t ReadBigEndian(const uint8_t* Source, unsigned int Size)
+    {
+        uint64_t Value = 0;
+
+        for (unsigned int i = 0; i < Size; i++)
+            Value = (Value << 8) | Source[i];
+
+        return Value;
+    }
+
+    // Writes an unsigned integer of the given size in network byte order.
+    void WriteBigEndian(ArrayT<uint8_t>& Dest, uint64_t Value, unsigned int Size)
+    {
+        for (unsigned int i = Size; i > 0; i--)
+            Dest.PushBack(uint8_t(Value >> (8*(i-1))));
+    }
+
+    // Returns the size in bytes of a field of the given type that starts at Data[Pos].
+    unsigned int GetFieldSize(unsigned int Type, const ArrayT<uint8_t>& Data, unsigned int Pos)
+    {
+        static const unsigned int Sizes[] = { 1, 2, 4, 8, 4, 8 };
+
+        if (Type < sizeof(Sizes)/sizeof(Sizes[0])) return Sizes[Type];
+
+        // It's a string: also account for the trailing 0 character.
+        const unsigned int Start = Pos;
+
+        while (Pos < Data.Size() && Data[Pos] != 0)
+            Pos++;
+
+        return Pos - Start + 1;
+    }
+
+    unsigned int CountTrailingZeros(uint32_t Value)
+    {
+        unsigned int Count = 0;
+
+        while (Count < 32 && (Value & (uint32_t(1) << Count)) == 0)
+            Count++;
+
+        return Count;
+    }
 }
 
 
@@ -124,7 +199,88 @@ uint64_t cf::Network::ntohll(uint64_t value)
 
 StateT::StateT(const StateT& Other, const ArrayT<uint8_t>& DeltaMessage)
 {
-    if (DeltaMessage[0] == 1)
+    // An empty delta message is malformed (e.g. truncated by NetDataT::ReadDMsg()), keep the Other state.
+    if (DeltaMessage.Size() == 0)
+    {
+        m_Data = Other.m_Data;
+        return;
+    }
+
+    if (DeltaMessage[0] == DELTA_FIELDS)
+    {
+        // The message is a list of records, each starting with the number of unchanged bytes that are
+        // to be copied from the Other state and the tag of the record, followed by the record's payload.
+        const ArrayT<uint8_t>& OtherData = Other.m_Data;
+        const unsigned int     FloatDropBits = DeltaMessage.Size() > 1 ? DeltaMessage[1] : 0;
+        unsigned int           Pos      = 2;
+        unsigned int           OtherPos = 0;
+
+        while (Pos < DeltaMessage.Size())
+        {
+            const uint64_t     Header = ReadVarInt(DeltaMessage, Pos);
+            const uint64_t     Gap    = Header >> 3;
+            const unsigned int Tag    = (unsigned int)(Header & 7);
+
+            // Never trust the network: stop at malformed input rather than reading beyond the buffers.
+            if (Gap > OtherData.Size() - OtherPos) break;
+
+            if (Gap > 0)
+            {
+                m_Data.PushBack(&OtherData[OtherPos], (unsigned long)Gap);
+                OtherPos += (unsigned int)Gap;
+            }
+
+            if (Tag == TAG_REST)
+            {
+                const uint64_t PackedLen = ReadVarInt(DeltaMessage, Pos);
+
+                if (PackedLen > DeltaMessage.Size() - Pos) break;
+
+                UnpackBits(m_Data, &DeltaMessage[0] + Pos, (unsigned int)PackedLen);
+                Pos      = DeltaMessage.Size();
+                OtherPos = OtherData.Size();
+                break;
+            }
+
+            const unsigned int OtherSize = GetFieldSize(Tag, OtherData, OtherPos);
+
+            if (OtherSize > OtherData.Size() - OtherPos) break;
+
+            switch (Tag)
+            {
+                case FIELD_UINT8:
+                    if (Pos >= DeltaMessage.Size()) break;
+                    m_Data.PushBack(OtherData[OtherPos] ^ DeltaMessage[Pos++]);
+                    break;
+
+                case FIELD_STRING:
+                    while (Pos < DeltaMessage.Size() && DeltaMessage[Pos] != 0)
+                        m_Data.PushBack(DeltaMessage[Pos++]);
+
+                    m_Data.PushBack(0);
+                    Pos++;
+                    break;
+
+                default:
+                {
+                    const uint64_t XorValue = ReadVarInt(DeltaMessage, Pos) << (Tag == FIELD_FLOAT ? FloatDropBits : 0);
+
+                    WriteBigEndian(m_Data, ReadBigEndian(&OtherData[OtherPos], OtherSize) ^ XorValue, OtherSize);
+                    break;
+                }
+            }
+
+            OtherPos += OtherSize;
+        }
+
+        // Copy the unchanged bytes after the last record.
+        if (OtherPos < OtherData.Size())
+            m_Data.PushBack(&OtherData[OtherPos], OtherData.Size() - OtherPos);
+
+        return;
+    }
+
+    if (DeltaMessage[0] == DELTA_XOR_RLE)
     {
         // Run the RLE-decompression.
         UnpackBits(m_Data, &DeltaMessage[1], DeltaMessage.Size()-1);
@@ -143,23 +299,50 @@ StateT::StateT(const StateT& Other, const ArrayT<uint8_t>& DeltaMessage)
 }
 
 
-ArrayT<uint8_t> StateT::GetDeltaMessage(const StateT& Other, bool Compress) const
+ArrayT<uint8_t> StateT::GetDeltaMessage(const StateT& Other, DeltaFormatT Format) const
+{
+    ArrayT<uint8_t> DeltaMessage;
+
+    GetDeltaMessage(Other, DeltaMessage, Format);
+    return DeltaMessage;
+}
+
+
+void StateT::GetDeltaMessage(const StateT& Other, ArrayT<uint8_t>& DeltaMessage, DeltaFormatT Format) const
 {
+    DeltaMessage.Overwrite();
+
+    if (Format == DELTA_FIELDS)
+    {
+        // If we don't know the fields of both states, or if they have no leading fields in common
+        // (e.g. because Other is the empty state that is used with baselines), the delta message
+        // would have to carry all of this state anyway, which DELTA_XOR_RLE does more compactly.
+        if (m_Fields.Size() > 0 && Other.m_Fields.Size() > 0 && m_Fields[0] == Other.m_Fields[0] && HasValidFields() && Other.HasValidFields())
+        {
+            GetFieldsDeltaMessage(Other, DeltaMessage);
+            return;
+        }
+
+        Format = DELTA_XOR_RLE;
+    }
+
     // Delta-compress the data.
-    static ArrayT<uint8_t> DeltaData;
+    // Note that DeltaData is a per-thread buffer, so that delta messages can be created in several
+    // threads concurrently, and that it keeps its memory from one call to the next.
+    static thread_local ArrayT<uint8_t> DeltaData;
 
     DeltaData.Overwrite();
+    DeltaData.PushBackEmpty(m_Data.Size());
 
     for (unsigned int i = 0; i < m_Data.Size(); i++)
-        DeltaData.PushBack(m_Data[i] ^ (i < Other.m_Data.Size() ? Other.m_Data[i] : 0));
+        DeltaData[i] = m_Data[i] ^ (i < Other.m_Data.Size() ? Other.m_Data[i] : 0);
 
     // Optionally RLE-compress the data, then write the delta message.
-    ArrayT<uint8_t> DeltaMessage;
-
-    if (Compress)
+    if (Format == DELTA_XOR_RLE)
     {
-        DeltaMessage.PushBack(1);
-        PackBits(DeltaMessage, &DeltaData[0], DeltaData.Size());
+        DeltaMessage.PushBack(DELTA_XOR_RLE);
+        if (DeltaData.Size() > 0)
+            PackBits(DeltaMessage, &DeltaData[0], DeltaData.Size());
 
 #ifdef DEBUG
         // Make sure that unpacking yields the original data.
@@ -170,7 +353,7 @@ ArrayT<uint8_t> StateT::GetDeltaMessage(const StateT& Other, bool Compress) cons
     }
     else
     {
-        DeltaMessage.PushBack(0);
+        DeltaMessage.PushBack(DELTA_XOR);
         DeltaMessage.PushBack(DeltaData);
     }
 
@@ -203,14 +386,18 @@ ArrayT<uint8_t> StateT::GetDeltaMessage(const StateT& Other, bool Compress) cons
         assert(DestRLE_CHECK == DeltaData);
     }
 #endif
-
-    return DeltaMessage;
 }
 
 
 /*static*/ bool StateT::IsDeltaMessageEmpty(const ArrayT<uint8_t>& DeltaMessage)
 {
-    if (DeltaMessage[0] == 1)
+    if (DeltaMessage[0] == DELTA_FIELDS)
+    {
+        // GetFieldsDeltaMessage() writes records only for fields that have changed.
+        return DeltaMessage.Size() <= 2;
+    }
+
+    if (DeltaMessage[0] == DELTA_XOR_RLE)
     {
         // Check the RLE-compressed delta message.
         unsigned int i = 1;
@@ -243,3 +430,121 @@ ArrayT<uint8_t> StateT::GetDeltaMessage(const StateT& Other, bool Compress) cons
 
     return true;
 }
+
+
+bool StateT::HasValidFields() const
+{
+    unsigned int Pos = 0;
+
+    for (unsigned int FieldNr = 0; FieldNr < m_Fields.Size(); FieldNr++)
+    {
+        Pos += GetFieldSize(m_Fields[FieldNr], m_Data, Pos);
+
+        if (Pos > m_Data.Size()) return false;
+    }
+
+    return Pos == m_Data.Size();
+}
+
+
+void StateT::GetFieldsDeltaMessage(const StateT& Other, ArrayT<uint8_t>& DeltaMessage) const
+{
+    // Walk the fields of both states in parallel for as long as they have the same types.
+    // If the field types differ at some point (e.g. because a component has been added to or removed
+    // from the entity), the rest of this state is sent in a single, RLE-compressed TAG_REST record.
+    const unsigned int NumCommon = std::min(m_Fields.Size(), Other.m_Fields.Size());
+    unsigned int       NumSame   = 0;
+
+    while (NumSame < NumCommon && m_Fields[NumSame] == Other.m_Fields[NumSame])
+        NumSame++;
+
+    // Determine how many trailing bits are zero in the XOR-ed values of all changed floats.
+    // With floats that have been written with reduced precision (see OutStreamT::SetFloatPrecision()),
+    // these bits are always zero and thus not written into the delta message.
+    uint32_t     FloatXors = 0;
+    unsigned int Pos       = 0;
+    unsigned int OtherPos  = 0;
+
+    for (unsigned int FieldNr = 0; FieldNr < NumSame; FieldNr++)
+    {
+        const unsigned int Size      = GetFieldSize(m_Fields[FieldNr], m_Data, Pos);
+        const unsigned int OtherSize = GetFieldSize(m_Fields[FieldNr], Other.m_Data, OtherPos);
+
+        if (m_Fields[FieldNr] == FIELD_FLOAT)
+            FloatXors |= uint32_t(ReadBigEndian(&m_Data[Pos], 4) ^ ReadBigEndian(&Other.m_Data[OtherPos], 4));
+
+        Pos      += Size;
+        OtherPos += OtherSize;
+    }
+
+    const unsigned int FloatDropBits = FloatXors ? CountTrailingZeros(FloatXors) : 0;
+
+    DeltaMessage.PushBack(DELTA_FIELDS);
+    DeltaMessage.PushBack(uint8_t(FloatDropBits));
+
+    uint64_t Gap = 0;   // The number of unchanged bytes in Other since the last record.
+
+    Pos      = 0;
+    OtherPos = 0;
+
+    for (unsigned int FieldNr = 0; FieldNr < NumSame; FieldNr++)
+    {
+        const unsigned int Type      = m_Fields[FieldNr];
+        const unsigned int Size      = GetFieldSize(Type, m_Data, Pos);
+        const unsigned int OtherSize = GetFieldSize(Type, Other.m_Data, OtherPos);
+
+        if (Size == OtherSize && memcmp(&m_Data[Pos], &Other.m_Data[OtherPos], Size) == 0)
+        {
+            Gap      += OtherSize;
+            Pos      += Size;
+            OtherPos += OtherSize;
+            continue;
+        }
+
+        WriteVarInt(DeltaMessage, (Gap << 3) | Type);
+        Gap = 0;
+
+        switch (Type)
+        {
+            case FIELD_UINT8:
+                DeltaMessage.PushBack(m_Data[Pos] ^ Other.m_Data[OtherPos]);
+                break;
+
+            case FIELD_STRING:
+                DeltaMessage.PushBack(&m_Data[Pos], Size);
+                break;
+
+            default:
+            {
+                const uint64_t XorValue = ReadBigEndian(&m_Data[Pos], Size) ^ ReadBigEndian(&Other.m_Data[OtherPos], Size);
+
+                WriteVarInt(DeltaMessage, XorValue >> (Type == FIELD_FLOAT ? FloatDropBits : 0));
+                break;
+            }
+        }
+
+        Pos      += Size;
+        OtherPos += OtherSize;
+    }
+
+    if (NumSame < m_Fields.Size() || NumSame < Other.m_Fields.Size())
+    {
+        // A per-thread buffer that keeps its memory, just like DeltaData in GetDeltaMessage().
+        static thread_local ArrayT<uint8_t> Packed;
+
+        Packed.Overwrite();
+
+        if (Pos < m_Data.Size())
+            PackBits(Packed, &m_Data[Pos], m_Data.Size() - Pos);
+
+        WriteVarInt(DeltaMessage, (Gap << 3) | TAG_REST);
+        WriteVarInt(DeltaMessage, Packed.Size());
+        DeltaMessage.PushBack(Packed);
+    }
+
+#ifdef DEBUG
+    // Make sure that decoding yields the original data.
+    const StateT Check(Other, DeltaMessage);
+    assert(Check.m_Data == m_Data);
+#endif
+}
@@ -43,10 +43,23 @@ uint64_t ntohll(uint64_t value);
 /// disk storage, etc.
 /// Internally, the encapsulated state is kept as an array of raw bytes, and as such it
 /// is "opaque" -- we don't have any idea of the meaning of the contained data.
+/// However, a state that has been written by an OutStreamT also knows the types of the
+/// fields (the individual data items) in the raw bytes, which the DELTA_FIELDS format
+/// uses in order to encode only the changed fields.
 class StateT
 {
     public:
 
+    /// The formats of the delta messages that are created by GetDeltaMessage().
+    /// The format is recorded in the delta message, so that the receiver can decode each
+    /// delta message without knowing in advance which format has been used.
+    enum DeltaFormatT
+    {
+        DELTA_XOR     = 0,  ///< The XOR of the raw bytes of the two states, uncompressed.
+        DELTA_XOR_RLE = 1,  ///< The XOR of the raw bytes of the two states, RLE-compressed.
+        DELTA_FIELDS  = 2   ///< A list of the changed fields, each XOR-ed with its previous value and variable-length encoded.
+    };
+
     /// Constructor for creating an empty StateT instance.
     /// The constructed instance is typically used with an OutStreamT,
     /// filled indirectly in a call to e.g. BaseEntityT::Serialize(OutStreamT& Stream).
@@ -59,9 +72,19 @@ class StateT
 
     /// Creates a delta message from this state.
     /// The delta message expresses how this state is different from another.
-    /// @param Other      The other state that the generated delta message is relative to.
-    /// @param Compress   Whether the delta message should be RLE-compressed.
-    ArrayT<uint8_t> GetDeltaMessage(const StateT& Other, bool Compress=true) const;
+    /// @param Other    The other state that the generated delta message is relative to.
+    /// @param Format   The format of the delta message. If `DELTA_FIELDS` is requested but the
+    ///     field types of this or the Other state are unknown (e.g. because Other is empty),
+    ///     the delta message is created in the `DELTA_XOR_RLE` format instead.
+    ArrayT<uint8_t> GetDeltaMessage(const StateT& Other, DeltaFormatT Format=DELTA_XOR_RLE) const;
+
+    /// Like GetDeltaMessage() above, but writes the delta message into the given array.
+    /// The memory of DeltaMessage is reused, so that if the same array is used for the delta
+    /// messages of several frames, no memory is allocated once the array is large enough.
+    /// @param Other          The other state that the generated delta message is relative to.
+    /// @param DeltaMessage   Receives the delta message.
+    /// @param Format         The format of the delta message, see GetDeltaMessage() above.
+    void GetDeltaMessage(const StateT& Other, ArrayT<uint8_t>& DeltaMessage, DeltaFormatT Format=DELTA_XOR_RLE) const;
 
     /// Returns whether a delta message created by GetDeltaMessage() is empty (no change to the state).
     static bool IsDeltaMessageEmpty(const ArrayT<uint8_t>& DeltaMessage);
@@ -72,7 +95,27 @@ class StateT
     friend class InStreamT;
     friend class OutStreamT;
 
-    ArrayT<uint8_t> m_Data;
+    /// The types of the fields in m_Data.
+    /// The values are also used as the field tags in `DELTA_FIELDS` delta messages.
+    enum FieldTypeT
+    {
+        FIELD_UINT8  = 0,   ///< A `char`, `uint8_t` or `bool`.
+        FIELD_UINT16 = 1,   ///< An `unsigned short`.
+        FIELD_UINT32 = 2,   ///< An `int32_t` or `uint32_t`.
+        FIELD_UINT64 = 3,   ///< A `uint64_t`.
+        FIELD_FLOAT  = 4,   ///< A `float`.
+        FIELD_DOUBLE = 5,   ///< A `double`.
+        FIELD_STRING = 6    ///< A null-terminated string.
+    };
+
+    /// Returns whether m_Fields describes exactly the bytes in m_Data.
+    bool HasValidFields() const;
+
+    /// Implements GetDeltaMessage() for the `DELTA_FIELDS` format.
+    void GetFieldsDeltaMessage(const StateT& Other, ArrayT<uint8_t>& DeltaMessage) const;
+
+    ArrayT<uint8_t> m_Data;     ///< The serialized state.
+    ArrayT<uint8_t> m_Fields;   ///< The FieldTypeT of each field in m_Data as written by an OutStreamT, empty if unknown (e.g. if this state has been created from a delta message).
 };
 
 
@@ -84,10 +127,24 @@ class OutStreamT
 
     /// Creates a stream for writing data into the given state.
     OutStreamT(StateT& State, bool Overwrite=true)
-        : m_Data(State.m_Data)
+        : m_Data(State.m_Data),
+          m_Fields(State.m_Fields),
+          m_FloatDropBits(0)
     {
         if (Overwrite)
+        {
             m_Data.Overwrite();
+            m_Fields.Overwrite();
+        }
+    }
+
+    /// Sets the precision of the `float` values that are subsequently written into the stream.
+    /// Reducing the precision makes the delta messages of the state smaller, especially in the
+    /// `StateT::DELTA_FIELDS` format, at the expense of the accuracy of the written values.
+    /// @param MantissaBits   The number of mantissa bits to keep, 23 (the default) keeps the full precision.
+    void SetFloatPrecision(unsigned int MantissaBits)
+    {
+        m_FloatDropBits = MantissaBits < 23 ? 23 - MantissaBits : 0;
     }
 
     //@{
@@ -95,6 +152,7 @@ class OutStreamT
     OutStreamT& operator << (char b)
     {
         m_Data.PushBack(b);
+        m_Fields.PushBack(StateT::FIELD_UINT8);
 
         return *this;
     }
@@ -102,6 +160,7 @@ class OutStreamT
     OutStreamT& operator << (uint8_t b)
     {
         m_Data.PushBack(b);
+        m_Fields.PushBack(StateT::FIELD_UINT8);
 
         return *this;
     }
@@ -110,6 +169,7 @@ class OutStreamT
     {
         m_Data.PushBackEmpty(2);
         *(unsigned short*)&m_Data[m_Data.Size()-2]=htons(w);
+        m_Fields.PushBack(StateT::FIELD_UINT16);
 
         return *this;
     }
@@ -118,6 +178,7 @@ class OutStreamT
     {
         m_Data.PushBackEmpty(4);
         *(int32_t*)&m_Data[m_Data.Size()-4]=htonl(i);
+        m_Fields.PushBack(StateT::FIELD_UINT32);
 
         return *this;
     }
@@ -126,6 +187,7 @@ class OutStreamT
     {
         m_Data.PushBackEmpty(4);
         *(uint32_t*)&m_Data[m_Data.Size()-4]=htonl(ui);
+        m_Fields.PushBack(StateT::FIELD_UINT32);
 
         return *this;
     }
@@ -137,6 +199,7 @@ class OutStreamT
 
         m_Data.PushBackEmpty(8);
         *(uint64_t*)&m_Data[m_Data.Size()-8]=htonll(ui);
+        m_Fields.PushBack(StateT::FIELD_UINT64);
 
         return *this;
     }
@@ -144,7 +207,19 @@ class OutStreamT
     OutStreamT& operator << (float f)
     {
         assert(sizeof(f) == sizeof(uint32_t));
-        *this << *(uint32_t*)&f;
+        uint32_t ui=*(uint32_t*)&f;
+
+        // Round to the nearest value with m_FloatDropBits zero bits at the end of the mantissa.
+        // A carry into the exponent is fine, but infinities and NaNs are kept as they are.
+        if (m_FloatDropBits > 0 && (ui & 0x7F800000) != 0x7F800000)
+        {
+            ui+=uint32_t(1) << (m_FloatDropBits-1);
+            ui&=~((uint32_t(1) << m_FloatDropBits)-1);
+        }
+
+        m_Data.PushBackEmpty(4);
+        *(uint32_t*)&m_Data[m_Data.Size()-4]=htonl(ui);
+        m_Fields.PushBack(StateT::FIELD_FLOAT);
 
         return *this;
     }
@@ -152,7 +227,9 @@ class OutStreamT
     OutStreamT& operator << (double d)
     {
         assert(sizeof(d) == sizeof(uint64_t));
-        *this << *(uint64_t*)&d;
+        m_Data.PushBackEmpty(8);
+        *(uint64_t*)&m_Data[m_Data.Size()-8]=htonll(*(uint64_t*)&d);
+        m_Fields.PushBack(StateT::FIELD_DOUBLE);
 
         return *this;
     }
@@ -160,6 +237,7 @@ class OutStreamT
     OutStreamT& operator << (bool b)
     {
         m_Data.PushBack(b ? 1 : 0);
+        m_Fields.PushBack(StateT::FIELD_UINT8);
 
         return *this;
     }
@@ -173,6 +251,7 @@ class OutStreamT
 
         m_Data.PushBackEmpty(Length);
         memcpy(&m_Data[Start], s, Length);
+        m_Fields.PushBack(StateT::FIELD_STRING);
 
         return *this;
     }
@@ -198,7 +277,9 @@ class OutStreamT
 
     private:
 
-    ArrayT<uint8_t>& m_Data;    ///< The buffer that this stream is writing to.
+    ArrayT<uint8_t>& m_Data;            ///< The buffer that this stream is writing to.
+    ArrayT<uint8_t>& m_Fields;          ///< The types of the fields in m_Data.
+    unsigned int     m_FloatDropBits;   ///< The number of trailing mantissa bits that are rounded off the written `float` values.
 };
 
 
@@ -113,51 +113,16 @@ BezierPatchNodeT* BezierPatchNodeT::CreateFromFile_cw(std::istream& InFile, aux:
     }
 
     // LightMaps
+    // Only the position of the lightmap in the larger bitmaps of the LightMapMan is stored with the patch,
+    // the texels are kept in a separate section of the world file (see LightMapManT::ReadBitmaps()).
     {
         LightMapInfoT& LMI=BP->LightMapInfo;
 
-        InFile.read((char*)&LMI.SizeS, sizeof(LMI.SizeS));
-        InFile.read((char*)&LMI.SizeT, sizeof(LMI.SizeT));
-
-        unsigned long LmNr;
-        unsigned int  LmPosS;
-        unsigned int  LmPosT;
-
-        if (!BP->LightMapMan.Allocate(LMI.SizeS, LMI.SizeT, LmNr, LmPosS, LmPosT))
-        {
-            printf("Could not allocate LightMap.\n");
-            delete BP;
-            return NULL;
-        }
-
-        LMI.LightMapNr=(unsigned short)LmNr;
-        LMI.PosS      =(unsigned short)LmPosS;
-        LMI.PosT      =(unsigned short)LmPosT;
-
-        for (unsigned int t=0; t<LMI.SizeT; t++)
-            for (unsigned int s=0; s<LMI.SizeS; s++)
-            {
-                char Red, Green, Blue;
-
-                InFile.read(&Red  , sizeof(Red  ));
-                InFile.read(&Green, sizeof(Green));
-                InFile.read(&Blue , sizeof(Blue ));
-
-                BP->LightMapMan.Bitmaps[LMI.LightMapNr]->SetPixel(LMI.PosS+s, LMI.PosT+t, Red, Green, Blue);
-            }
-
-        for (unsigned int t=0; t<LMI.SizeT; t++)
-            for (unsigned int s=0; s<LMI.SizeS; s++)
-            {
-                char Red, Green, Blue, Alpha;
-
-                InFile.read(&Red  , sizeof(Red  ));
-                InFile.read(&Green, sizeof(Green));
-                InFile.read(&Blue , sizeof(Blue ));
-                InFile.read(&Alpha, sizeof(Alpha));
-
-                BP->LightMapMan.Bitmaps2[LMI.LightMapNr]->SetPixel(LMI.PosS+s, LMI.PosT+t, Red, Green, Blue, Alpha);
-            }
+        InFile.read((char*)&LMI.SizeS,      sizeof(LMI.SizeS));
+        InFile.read((char*)&LMI.SizeT,      sizeof(LMI.SizeT));
+        InFile.read((char*)&LMI.LightMapNr, sizeof(LMI.LightMapNr));
+        InFile.read((char*)&LMI.PosS,       sizeof(LMI.PosS));
+        InFile.read((char*)&LMI.PosT,       sizeof(LMI.PosT));
     }
 
     BP->Init();
@@ -193,35 +158,11 @@ void BezierPatchNodeT::WriteTo(std::ostream& OutFile, aux::PoolT& Pool) const
     {
         const LightMapInfoT& LMI=LightMapInfo;
 
-        OutFile.write((char*)&LMI.SizeS, sizeof(LMI.SizeS));
-        OutFile.write((char*)&LMI.SizeT, sizeof(LMI.SizeT));
-
-        for (unsigned long t=0; t<LMI.SizeT; t++)
-            for (unsigned long s=0; s<LMI.SizeS; s++)
-            {
-                int  Red, Green, Blue;
-                char v;
-
-                LightMapMan.Bitmaps[LMI.LightMapNr]->GetPixel(LMI.PosS+s, LMI.PosT+t, Red, Green, Blue);
-
-                v=Red;   OutFile.write(&v, sizeof(v));
-                v=Green; OutFile.write(&v, sizeof(v));
-                v=Blue;  OutFile.write(&v, sizeof(v));
-            }
-
-        for (unsigned long t=0; t<LMI.SizeT; t++)
-            for (unsigned long s=0; s<LMI.SizeS; s++)
-            {
-                int  Red, Green, Blue, Alpha;
-                char v;
-
-                LightMapMan.Bitmaps2[LMI.LightMapNr]->GetPixel(LMI.PosS+s, LMI.PosT+t, Red, Green, Blue, Alpha);
-
-                v=Red;   OutFile.write(&v, sizeof(v));
-                v=Green; OutFile.write(&v, sizeof(v));
-                v=Blue;  OutFile.write(&v, sizeof(v));
-                v=Alpha; OutFile.write(&v, sizeof(v));
-            }
+        OutFile.write((char*)&LMI.SizeS,      sizeof(LMI.SizeS));
+        OutFile.write((char*)&LMI.SizeT,      sizeof(LMI.SizeT));
+        OutFile.write((char*)&LMI.LightMapNr, sizeof(LMI.LightMapNr));
+        OutFile.write((char*)&LMI.PosS,       sizeof(LMI.PosS));
+        OutFile.write((char*)&LMI.PosT,       sizeof(LMI.PosT));
     }
 }
 
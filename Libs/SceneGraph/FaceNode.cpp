@@ -103,94 +103,28 @@ FaceNodeT* FaceNodeT::CreateFromFile_cw(std::istream& InFile, aux::PoolT& Pool,
     InFile.read((char*)&FN->TI.OffsetV, sizeof(FN->TI.OffsetV));
 
     // LightMaps
+    // Only the position of the lightmap in the larger bitmaps of the LightMapMan is stored with the face,
+    // the texels are kept in a separate section of the world file (see LightMapManT::ReadBitmaps()).
     {
         LightMapInfoT& LMI=FN->LightMapInfo;
 
-        InFile.read((char*)&LMI.SizeS, sizeof(LMI.SizeS));
-        InFile.read((char*)&LMI.SizeT, sizeof(LMI.SizeT));
-
-        unsigned long LmNr;
-        unsigned int  LmPosS;
-        unsigned int  LmPosT;
-
-        if (!FN->LightMapMan.Allocate(LMI.SizeS, LMI.SizeT, LmNr, LmPosS, LmPosT))
-        {
-            printf("Could not allocate LightMap.\n");
-            delete FN;
-            return NULL;
-        }
-
-        LMI.LightMapNr=(unsigned short)LmNr;
-        LMI.PosS      =(unsigned short)LmPosS;
-        LMI.PosT      =(unsigned short)LmPosT;
-
-        for (unsigned int t=0; t<LMI.SizeT; t++)
-            for (unsigned int s=0; s<LMI.SizeS; s++)
-            {
-                char Red, Green, Blue;
-
-                InFile.read(&Red  , sizeof(Red  ));
-                InFile.read(&Green, sizeof(Green));
-                InFile.read(&Blue , sizeof(Blue ));
-
-                FN->LightMapMan.Bitmaps[LMI.LightMapNr]->SetPixel(LMI.PosS+s, LMI.PosT+t, Red, Green, Blue);
-            }
-
-        for (unsigned int t=0; t<LMI.SizeT; t++)
-            for (unsigned int s=0; s<LMI.SizeS; s++)
-            {
-                char Red, Green, Blue, Alpha;
-
-                InFile.read(&Red  , sizeof(Red  ));
-                InFile.read(&Green, sizeof(Green));
-                InFile.read(&Blue , sizeof(Blue ));
-                InFile.read(&Alpha, sizeof(Alpha));
-
-                FN->LightMapMan.Bitmaps2[LMI.LightMapNr]->SetPixel(LMI.PosS+s, LMI.PosT+t, Red, Green, Blue, Alpha);
-            }
+        InFile.read((char*)&LMI.SizeS,      sizeof(LMI.SizeS));
+        InFile.read((char*)&LMI.SizeT,      sizeof(LMI.SizeT));
+        InFile.read((char*)&LMI.LightMapNr, sizeof(LMI.LightMapNr));
+        InFile.read((char*)&LMI.PosS,       sizeof(LMI.PosS));
+        InFile.read((char*)&LMI.PosT,       sizeof(LMI.PosT));
     }
 
     // SHLMaps
+    // As with the lightmaps, the SHL coefficients are kept in a separate section of the world file (see SHLMapManT::ReadSHLMaps()).
     {
         SHLMapInfoT& SMI=FN->SHLMapInfo;
 
-        InFile.read((char*)&SMI.SizeS, sizeof(SMI.SizeS));
-        InFile.read((char*)&SMI.SizeT, sizeof(SMI.SizeT));
-
-        unsigned long shlNr;
-        unsigned long shlPosS;
-        unsigned long shlPosT;
-
-        if (!FN->SHLMapMan.Allocate(SMI.SizeS, SMI.SizeT, shlNr, shlPosS, shlPosT))
-        {
-            printf("Could not allocate SHLMap.\n");
-            delete FN;
-            return NULL;
-        }
-
-        SMI.SHLMapNr=(unsigned short)shlNr;
-        SMI.PosS    =(unsigned short)shlPosS;
-        SMI.PosT    =(unsigned short)shlPosT;
-
-        const unsigned long NR_OF_SH_COEFFS=cf::SceneGraph::SHLMapManT::NrOfBands * cf::SceneGraph::SHLMapManT::NrOfBands;
-
-        for (unsigned long t=0; t<SMI.SizeT; t++)
-            for (unsigned long s=0; s<SMI.SizeS; s++)
-                if (cf::SceneGraph::SHLMapManT::NrOfRepres>0)
-                {
-                    // Compressed, read the indices.
-                    InFile.read((char*)&FN->SHLMapMan.SHLMaps[SMI.SHLMapNr]->Indices[(SMI.PosT+t)*cf::SceneGraph::SHLMapManT::SIZE_S+SMI.PosS+s], sizeof(unsigned short));
-                }
-                else
-                {
-                    // Not compressed, read NR_OF_SH_COEFFS coefficients for each element.
-                    for (unsigned long CoeffNr=0; CoeffNr<NR_OF_SH_COEFFS; CoeffNr++)
-                    {
-                        float ReadCoeff; InFile.read((char*)&ReadCoeff, sizeof(ReadCoeff));
-
-                        FN->SHLMapMan.SHLMaps[SMI.SHLMapNr]->Coeffs[((SMI.PosT+t)*cf::SceneGraph::SHLMapManT::SIZE_S+SMI.PosS+s)*NR_OF_SH_COEFFS+CoeffNr]=ReadCoeff;
-                    }
-                }
+        InFile.read((char*)&SMI.SizeS,    sizeof(SMI.SizeS));
+        InFile.read((char*)&SMI.SizeT,    sizeof(SMI.SizeT));
+        InFile.read((char*)&SMI.SHLMapNr, sizeof(SMI.SHLMapNr));
+        InFile.read((char*)&SMI.PosS,     sizeof(SMI.PosS));
+        InFile.read((char*)&SMI.PosT,     sizeof(SMI.PosT));
     }
 
     // FacesDrawIndices
@@ -490,58 +424,22 @@ void FaceNodeT::WriteTo(std::ostream& OutFile, aux::PoolT& Pool) const
     {
         const LightMapInfoT& LMI=LightMapInfo;
 
-        OutFile.write((char*)&LMI.SizeS, sizeof(LMI.SizeS));
-        OutFile.write((char*)&LMI.SizeT, sizeof(LMI.SizeT));
-
-        for (unsigned long t=0; t<LMI.SizeT; t++)
-            for (unsigned long s=0; s<LMI.SizeS; s++)
-            {
-                int  Red, Green, Blue;
-                char v;
-
-                LightMapMan.Bitmaps[LMI.LightMapNr]->GetPixel(LMI.PosS+s, LMI.PosT+t, Red, Green, Blue);
-
-                v=Red;   OutFile.write(&v, sizeof(v));
-                v=Green; OutFile.write(&v, sizeof(v));
-                v=Blue;  OutFile.write(&v, sizeof(v));
-            }
-
-        for (unsigned long t=0; t<LMI.SizeT; t++)
-            for (unsigned long s=0; s<LMI.SizeS; s++)
-            {
-                int  Red, Green, Blue, Alpha;
-                char v;
-
-                LightMapMan.Bitmaps2[LMI.LightMapNr]->GetPixel(LMI.PosS+s, LMI.PosT+t, Red, Green, Blue, Alpha);
-
-                v=Red;   OutFile.write(&v, sizeof(v));
-                v=Green; OutFile.write(&v, sizeof(v));
-                v=Blue;  OutFile.write(&v, sizeof(v));
-                v=Alpha; OutFile.write(&v, sizeof(v));
-            }
+        OutFile.write((char*)&LMI.SizeS,      sizeof(LMI.SizeS));
+        OutFile.write((char*)&LMI.SizeT,      sizeof(LMI.SizeT));
+        OutFile.write((char*)&LMI.LightMapNr, sizeof(LMI.LightMapNr));
+        OutFile.write((char*)&LMI.PosS,       sizeof(LMI.PosS));
+        OutFile.write((char*)&LMI.PosT,       sizeof(LMI.PosT));
     }
 
     // SHLMaps
     {
-        const SHLMapInfoT&  SMI            =SHLMapInfo;
-        const unsigned long NR_OF_SH_COEFFS=cf::SceneGraph::SHLMapManT::NrOfBands * cf::SceneGraph::SHLMapManT::NrOfBands;
-
-        OutFile.write((char*)&SMI.SizeS, sizeof(SMI.SizeS));
-        OutFile.write((char*)&SMI.SizeT, sizeof(SMI.SizeT));
+        const SHLMapInfoT& SMI=SHLMapInfo;
 
-        for (unsigned long t=0; t<SMI.SizeT; t++)
-            for (unsigned long s=0; s<SMI.SizeS; s++)
-                if (cf::SceneGraph::SHLMapManT::NrOfRepres>0)
-                {
-                    // Compressed, only write the indices.
-                    OutFile.write((char*)&SHLMapMan.SHLMaps[SMI.SHLMapNr]->Indices[(SMI.PosT+t)*cf::SceneGraph::SHLMapManT::SIZE_S+SMI.PosS+s], sizeof(unsigned short));
-                }
-                else
-                {
-                    // Not compressed, write NR_OF_SH_COEFFS coefficients for each element.
-                    for (unsigned long CoeffNr=0; CoeffNr<NR_OF_SH_COEFFS; CoeffNr++)
-                        OutFile.write((char*)&SHLMapMan.SHLMaps[SMI.SHLMapNr]->Coeffs[((SMI.PosT+t)*cf::SceneGraph::SHLMapManT::SIZE_S+SMI.PosS+s)*NR_OF_SH_COEFFS+CoeffNr], sizeof(float));
-                }
+        OutFile.write((char*)&SMI.SizeS,    sizeof(SMI.SizeS));
+        OutFile.write((char*)&SMI.SizeT,    sizeof(SMI.SizeT));
+        OutFile.write((char*)&SMI.SHLMapNr, sizeof(SMI.SHLMapNr));
+        OutFile.write((char*)&SMI.PosS,     sizeof(SMI.PosS));
+        OutFile.write((char*)&SMI.PosT,     sizeof(SMI.PosT));
     }
 
     // DrawIndices
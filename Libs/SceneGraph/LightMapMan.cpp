@@ -9,6 +9,8 @@ This project is licensed under the terms of the MIT license.
 #include "MaterialSystem/MapComposition.hpp"
 #include "MaterialSystem/TextureMap.hpp"
 
+#include <cstring>
+
 using namespace cf::SceneGraph;
 
 
@@ -76,6 +78,74 @@ bool LightMapManT::Allocate(unsigned int SizeS, unsigned int SizeT, unsigned lon
 }
 
 
+void LightMapManT::WriteBitmaps(std::ostream& OutFile) const
+{
+    const uint32_t Header[4] = { uint32_t(Bitmaps.Size()), SIZE_S, SIZE_T, 0 };
+
+    OutFile.write((const char*)Header, sizeof(Header));
+
+    for (unsigned int s=0; s<SIZE_S; s++)
+    {
+        const uint32_t Allocated=BitmapAllocated[s];
+
+        OutFile.write((const char*)&Allocated, sizeof(Allocated));
+    }
+
+    for (unsigned long BitmapNr=0; BitmapNr<Bitmaps.Size(); BitmapNr++)
+        OutFile.write((const char*)&Bitmaps[BitmapNr]->Data[0], SIZE_S*SIZE_T*sizeof(uint32_t));
+
+    for (unsigned long BitmapNr=0; BitmapNr<Bitmaps2.Size(); BitmapNr++)
+        OutFile.write((const char*)&Bitmaps2[BitmapNr]->Data[0], SIZE_S*SIZE_T*sizeof(uint32_t));
+}
+
+
+bool LightMapManT::ReadBitmaps(const char* Data, size_t Size)
+{
+    assert(Bitmaps.Size()==0);
+
+    uint32_t Header[4];
+
+    if (Size<sizeof(Header)) return false;
+    memcpy(Header, Data, sizeof(Header));
+
+    const size_t BitmapSize=SIZE_S*SIZE_T*sizeof(uint32_t);
+
+    if (Header[1]!=SIZE_S || Header[2]!=SIZE_T) return false;
+    if (Size!=sizeof(Header) + SIZE_S*sizeof(uint32_t) + 2*Header[0]*BitmapSize) return false;
+
+    Data+=sizeof(Header);
+
+    for (unsigned int s=0; s<SIZE_S; s++)
+    {
+        uint32_t Allocated;
+
+        memcpy(&Allocated, Data, sizeof(Allocated));
+        Data+=sizeof(Allocated);
+
+        BitmapAllocated[s]=Allocated;
+    }
+
+    for (unsigned long BitmapNr=0; BitmapNr<Header[0]; BitmapNr++)
+    {
+        Bitmaps.PushBack(new BitmapT(SIZE_S, SIZE_T));
+        memcpy(&Bitmaps[BitmapNr]->Data[0], Data, BitmapSize);
+        Data+=BitmapSize;
+    }
+
+    for (unsigned long BitmapNr=0; BitmapNr<Header[0]; BitmapNr++)
+    {
+        Bitmaps2.PushBack(new BitmapT(SIZE_S, SIZE_T));
+        memcpy(&Bitmaps2[BitmapNr]->Data[0], Data, BitmapSize);
+        Data+=BitmapSize;
+
+        Textures .PushBack(NULL);
+        Textures2.PushBack(NULL);
+    }
+
+    return true;
+}
+
+
 void LightMapManT::InitTextures(const float Gamma, const int AmbientR, const int AmbientG, const int AmbientB)
 {
     for (unsigned long LightMapNr=0; LightMapNr<Bitmaps.Size(); LightMapNr++)
@@ -9,6 +9,9 @@ This project is licensed under the terms of the MIT license.
 
 #include "Templates/Array.hpp"
 
+#include <cstddef>
+#include <ostream>
+
 struct BitmapT;
 
 namespace MatSys
@@ -42,6 +45,16 @@ namespace cf
             /// Returns true on success, false on failure (i.e. if SizeS>MAX_SIZE_S || SizeT>MAX_SIZE_T).
             bool Allocate(unsigned int SizeS, unsigned int SizeT, unsigned long& BitmapNr, unsigned int& PosS, unsigned int& PosT);
 
+            /// Writes the Bitmaps and Bitmaps2 and the allocation state as a section of a `.cw` world file.
+            /// The bitmaps are written as aligned arrays of 32-bit texels, so that ReadBitmaps() can take them
+            /// directly from a memory-mapped file.
+            void WriteBitmaps(std::ostream& OutFile) const;
+
+            /// Reads the Bitmaps and Bitmaps2 and the allocation state from a section of a `.cw` world file
+            /// that was written by WriteBitmaps(). This must be called on an empty lightmap manager.
+            /// Returns false if the section is malformed.
+            bool ReadBitmaps(const char* Data, size_t Size);
+
             /// Initializes the MatSys textures in the Textures and Textures2 arrays.
             /// Gamma correction by value Gamma is applied to the textures in Textures, but not in Textures2.
             void InitTextures(const float Gamma, const int AmbientR, const int AmbientG, const int AmbientB);
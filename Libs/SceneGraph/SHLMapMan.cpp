@@ -8,6 +8,8 @@ This project is licensed under the terms of the MIT license.
 #include "MaterialSystem/MapComposition.hpp"
 #include "MaterialSystem/TextureMap.hpp"
 
+#include <cstring>
+
 using namespace cf::SceneGraph;
 
 
@@ -87,6 +89,108 @@ void SHLMapManT::WriteSHLCoeffsTable(std::ostream& OutFile) const
 }
 
 
+void SHLMapManT::WriteSHLMaps(std::ostream& OutFile) const
+{
+    const uint32_t Header[4] = { uint32_t(NrOfBands), uint32_t(NrOfRepres), uint32_t(SHLMaps.Size()), uint32_t(SHLCoeffsTable.Size()) };
+    const char     Padding[4] = { 0, 0, 0, 0 };
+
+    OutFile.write((const char*)Header, sizeof(Header));
+
+    if (SHLCoeffsTable.Size()>0)
+        OutFile.write((const char*)&SHLCoeffsTable[0], SHLCoeffsTable.Size()*sizeof(float));
+
+    for (unsigned long s=0; s<SIZE_S; s++)
+    {
+        const uint32_t Allocated=uint32_t(BitmapAllocated[s]);
+
+        OutFile.write((const char*)&Allocated, sizeof(Allocated));
+    }
+
+    for (unsigned long SHLMapNr=0; SHLMapNr<SHLMaps.Size(); SHLMapNr++)
+    {
+        const SHLMapT& SHLMap=*SHLMaps[SHLMapNr];
+        const uint32_t Sizes[2] = { uint32_t(SHLMap.Coeffs.Size()), uint32_t(SHLMap.Indices.Size()) };
+
+        OutFile.write((const char*)Sizes, sizeof(Sizes));
+
+        if (SHLMap.Coeffs.Size()>0)
+            OutFile.write((const char*)&SHLMap.Coeffs[0], SHLMap.Coeffs.Size()*sizeof(float));
+
+        if (SHLMap.Indices.Size()>0)
+            OutFile.write((const char*)&SHLMap.Indices[0], SHLMap.Indices.Size()*sizeof(unsigned short));
+
+        // Keep the next SHL map aligned.
+        OutFile.write(Padding, (SHLMap.Indices.Size() % 2)*sizeof(unsigned short));
+    }
+}
+
+
+bool SHLMapManT::ReadSHLMaps(const char* Data, size_t Size)
+{
+    assert(SHLMaps.Size()==0);
+
+    const char* End=Data+Size;
+    uint32_t    Header[4];
+
+    if (Size<sizeof(Header)) return false;
+    memcpy(Header, Data, sizeof(Header));
+    Data+=sizeof(Header);
+
+    NrOfBands =char(Header[0]);
+    NrOfRepres=Header[1];
+
+    if (size_t(End-Data)<Header[3]*sizeof(float) + SIZE_S*sizeof(uint32_t)) return false;
+
+    SHLCoeffsTable.Overwrite();
+    SHLCoeffsTable.PushBackEmptyExact(Header[3]);
+
+    if (Header[3]>0)
+        memcpy(&SHLCoeffsTable[0], Data, Header[3]*sizeof(float));
+
+    Data+=Header[3]*sizeof(float);
+
+    for (unsigned long s=0; s<SIZE_S; s++)
+    {
+        uint32_t Allocated;
+
+        memcpy(&Allocated, Data, sizeof(Allocated));
+        Data+=sizeof(Allocated);
+
+        BitmapAllocated[s]=Allocated;
+    }
+
+    for (unsigned long SHLMapNr=0; SHLMapNr<Header[2]; SHLMapNr++)
+    {
+        uint32_t Sizes[2];
+
+        if (size_t(End-Data)<sizeof(Sizes)) return false;
+        memcpy(Sizes, Data, sizeof(Sizes));
+        Data+=sizeof(Sizes);
+
+        const size_t IndicesSize=(Sizes[1] + Sizes[1] % 2)*sizeof(unsigned short);
+
+        if (size_t(End-Data)<Sizes[0]*sizeof(float) + IndicesSize) return false;
+
+        SHLMapT* SHLMap=new SHLMapT;
+
+        SHLMaps.PushBack(SHLMap);
+        SHLMapTextures.PushBackEmpty();
+
+        SHLMap->Coeffs.Clear();
+        SHLMap->Coeffs.PushBackEmptyExact(Sizes[0]);
+        if (Sizes[0]>0) memcpy(&SHLMap->Coeffs[0], Data, Sizes[0]*sizeof(float));
+        Data+=Sizes[0]*sizeof(float);
+
+        SHLMap->Indices.Clear();
+        SHLMap->Indices.PushBackEmptyExact(Sizes[1]);
+        if (Sizes[1]>0) memcpy(&SHLMap->Indices[0], Data, Sizes[1]*sizeof(unsigned short));
+        Data+=IndicesSize;
+    }
+
+    return Data==End;
+}
+
+
 bool SHLMapManT::Allocate(unsigned long SizeS, unsigned long SizeT, unsigned long& BitmapNr, unsigned long& PosS, unsigned long& PosT)
 {
     if (SizeS>SIZE_S) return false;
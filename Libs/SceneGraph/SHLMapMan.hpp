@@ -9,6 +9,7 @@ This project is licensed under the terms of the MIT license.
 
 #include "Templates/Array.hpp"
 
+#include <cstddef>
 #include <fstream>
 
 namespace MatSys
@@ -61,6 +62,15 @@ namespace cf
             /// This writes a total of NrOfRepres*NR_OF_SH_COEFFS coefficients.
             void WriteSHLCoeffsTable(std::ostream& OutFile) const;
 
+            /// Writes NrOfBands, NrOfRepres, the SHLCoeffsTable, the SHLMaps and the allocation state as a section of a `.cw` world file.
+            /// All arrays are written aligned to four bytes, so that ReadSHLMaps() can take them directly from a memory-mapped file.
+            void WriteSHLMaps(std::ostream& OutFile) const;
+
+            /// Reads everything that WriteSHLMaps() wrote from a section of a `.cw` world file.
+            /// Note that this also sets the global NrOfBands and NrOfRepres. This must be called on an empty SHL map manager.
+            /// Returns false if the section is malformed.
+            bool ReadSHLMaps(const char* Data, size_t Size);
+
             /// Finds a position for a rectangular SHLMap within SHLMaps[SHLMaps.Size()-1].Coeff.
             /// If no such position exists, a new, empty SHLMapT is created and appended to the SHLMaps.
             /// Returns true on success, false on failure (i.e. if SizeS>MAX_SIZE_S || SizeT>MAX_SIZE_T).
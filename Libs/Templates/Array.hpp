@@ -66,6 +66,7 @@ template<class T> class ArrayT
     void          DeleteBack(unsigned long Amount=1);
 
     // "Convenience" methods.
+    void          PushBack(const T* Source, unsigned long Count);   ///< Appends Count elements at once. Source must not point into this array.
     void          PushBack(const ArrayT<T>& Other);
     void          InsertAt(unsigned long Index, const T Element);   // TODO: Rename to InsertAtAndKeepOrder()
     void          RemoveAt(unsigned long Index);
@@ -251,10 +252,26 @@ template<class T> inline void ArrayT<T>::DeleteBack(unsigned long Amount)
 }
 
 
+template<class T> inline void ArrayT<T>::PushBack(const T* Source, unsigned long Count)
+{
+    const unsigned long Start=NrOfElements;
+
+    // Grow the array at most once, rather than once per element.
+    PushBackEmpty(Count);
+
+    for (unsigned long Nr=0; Nr<Count; Nr++) Elements[Start+Nr]=Source[Nr];
+}
+
+
 template<class T> inline void ArrayT<T>::PushBack(const ArrayT<T>& Other)
 {
-    for (unsigned long Nr=0; Nr<Other.Size(); Nr++)
-        PushBack(Other[Nr]);
+    const unsigned long Start=NrOfElements;
+    const unsigned long Count=Other.NrOfElements;
+
+    // Other may be this array, so only access its elements after it has been grown.
+    PushBackEmpty(Count);
+
+    for (unsigned long Nr=0; Nr<Count; Nr++) Elements[Start+Nr]=Other.Elements[Nr];
 }
 
 
@@ -1268,7 +1268,7 @@ void TerrainT::QuadTreeT::TraceBoundingBox(const TerrainT& Terrain, double BBMin
 {
     if (Child00Index==0xFFFFFFFF /*IsLeaf*/)
     {
-        static Brush3T<double> CaseBrushes[3];
+        static thread_local Brush3T<double> CaseBrushes[3];
 
         if (CaseBrushes[0].Planes.Size()==0)
         {
@@ -1507,7 +1507,7 @@ void TerrainT::QuadTreeT::TraceBoundingBox(const TerrainT& Terrain, double BBMin
     {
         // It's not a leaf. It's a node.
         // First, figure out if our bounding box brush "BBB" is intersected by BB at all, that is, if there is a *potential* hit.
-        static Brush3T<double> BBB;
+        static thread_local Brush3T<double> BBB;
 
         if (BBB.Planes.Size()==0)
         {
@@ -1523,7 +1523,7 @@ void TerrainT::QuadTreeT::TraceBoundingBox(const TerrainT& Terrain, double BBMin
         BBB.Planes[1].Dist= BBMaxX;
         BBB.Planes[2].Dist=-BBMinY;
         BBB.Planes[3].Dist= BBMaxY;
-        BBB.Planes[4].Dist=-HeightMin;
+        BBB.Planes[4].Dist=-HeightMin+100.0;    // The brushes of the cells in the leaves reach 100 units below their lowest vertex, too.
         BBB.Planes[5].Dist= HeightMax;
 
         VB_Trace3T<double> PotentialHitTrace(Trace);
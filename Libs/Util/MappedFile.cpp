@@ -0,0 +1,162 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+#include "MappedFile.hpp"
+
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace cf;
+
+
+MappedFileT::MappedFileT(const std::string& FileName)
+    : m_Data(NULL),
+      m_Size(0),
+      m_IsMapped(false),
+      m_Buffer()
+#ifdef _WIN32
+      , m_FileHandle(INVALID_HANDLE_VALUE),
+      m_MappingHandle(NULL)
+#endif
+{
+#ifdef _WIN32
+    HANDLE File = CreateFileA(FileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (File != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER FileSize;
+
+        if (GetFileSizeEx(File, &FileSize) && FileSize.QuadPart > 0)
+        {
+            HANDLE Mapping = CreateFileMappingA(File, NULL, PAGE_READONLY, 0, 0, NULL);
+
+            if (Mapping != NULL)
+            {
+                const void* View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+
+                if (View != NULL)
+                {
+                    m_Data          = static_cast<const char*>(View);
+                    m_Size          = size_t(FileSize.QuadPart);
+                    m_IsMapped      = true;
+                    m_FileHandle    = File;
+                    m_MappingHandle = Mapping;
+                    return;
+                }
+
+                CloseHandle(Mapping);
+            }
+        }
+
+        CloseHandle(File);
+    }
+#else
+    const int File = open(FileName.c_str(), O_RDONLY);
+
+    if (File != -1)
+    {
+        struct stat FileStat;
+
+        if (fstat(File, &FileStat) == 0 && FileStat.st_size > 0)
+        {
+            void* View = mmap(NULL, size_t(FileStat.st_size), PROT_READ, MAP_PRIVATE, File, 0);
+
+            if (View != MAP_FAILED)
+            {
+                m_Data     = static_cast<const char*>(View);
+                m_Size     = size_t(FileStat.st_size);
+                m_IsMapped = true;
+            }
+        }
+
+        // The mapping stays valid after the file has been closed.
+        close(File);
+
+        if (m_IsMapped) return;
+    }
+#endif
+
+    // The file could not be mapped, so try to read it into memory.
+    std::ifstream InFile(FileName.c_str(), std::ios::in | std::ios::binary);
+    if (!InFile.is_open()) return;
+
+    InFile.seekg(0, std::ios::end);
+    m_Size = size_t(InFile.tellg());
+    InFile.seekg(0, std::ios::beg);
+
+    if (m_Size == 0) return;
+
+    m_Buffer.resize(m_Size);
+    InFile.read(&m_Buffer[0], m_Size);
+
+    if (!InFile.good())
+    {
+        m_Buffer.clear();
+        m_Size = 0;
+        return;
+    }
+
+    m_Data = &m_Buffer[0];
+}
+
+
+MappedFileT::~MappedFileT()
+{
+    if (!m_IsMapped) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_Data);
+    CloseHandle(m_MappingHandle);
+    CloseHandle(m_FileHandle);
+#else
+    munmap(const_cast<char*>(m_Data), m_Size);
+#endif
+}
+
+
+MemoryStreamBufT::MemoryStreamBufT(const char* Data, size_t Size)
+{
+    char* Begin = const_cast<char*>(Data);
+
+    setg(Begin, Begin, Begin + Size);
+}
+
+
+std::streampos MemoryStreamBufT::seekoff(std::streamoff Offset, std::ios_base::seekdir Dir, std::ios_base::openmode Which)
+{
+    if ((Which & std::ios_base::in) == 0) return std::streampos(std::streamoff(-1));
+
+    char* Pos = Dir == std::ios_base::beg ? eback() + Offset :
+                Dir == std::ios_base::cur ? gptr()  + Offset : egptr() + Offset;
+
+    if (Pos < eback() || Pos > egptr()) return std::streampos(std::streamoff(-1));
+
+    setg(eback(), Pos, egptr());
+    return std::streampos(std::streamoff(Pos - eback()));
+}
+
+
+std::streampos MemoryStreamBufT::seekpos(std::streampos Pos, std::ios_base::openmode Which)
+{
+    return seekoff(std::streamoff(Pos), std::ios_base::beg, Which);
+}
+
+
+MemoryInStreamT::MemoryInStreamT(const char* Data, size_t Size)
+    : std::istream(NULL),
+      m_StreamBuf(Data, Size)
+{
+    rdbuf(&m_StreamBuf);
+}
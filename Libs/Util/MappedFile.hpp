@@ -0,0 +1,92 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+#ifndef CAFU_UTIL_MAPPED_FILE_HPP_INCLUDED
+#define CAFU_UTIL_MAPPED_FILE_HPP_INCLUDED
+
+#include <cstddef>
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+
+namespace cf
+{
+    /// A read-only view of the contents of a file that is mapped into memory.
+    ///
+    /// The operating system reads the pages of the file only when they are first accessed,
+    /// so that parts of the file that are never looked at don't cost any I/O or memory.
+    /// If the file cannot be mapped, its contents are read into a memory buffer instead.
+    class MappedFileT
+    {
+        public:
+
+        /// The constructor. Use IsOpen() in order to learn if the file could be opened.
+        MappedFileT(const std::string& FileName);
+
+        /// The destructor. Unmaps the file.
+        ~MappedFileT();
+
+        /// Returns whether the file could be opened. Empty files are treated as if they could not be opened.
+        bool IsOpen() const { return m_Data != NULL; }
+
+        /// Returns the contents of the file.
+        const char* GetData() const { return m_Data; }
+
+        /// Returns the size of the file in bytes.
+        size_t GetSize() const { return m_Size; }
+
+
+        private:
+
+        MappedFileT(const MappedFileT&);            ///< Use of the Copy Constructor    is not allowed.
+        void operator = (const MappedFileT&);       ///< Use of the Assignment Operator is not allowed.
+
+        const char*       m_Data;       ///< The contents of the file, NULL if the file could not be opened.
+        size_t            m_Size;       ///< The size of the file in bytes.
+        bool              m_IsMapped;   ///< Whether m_Data points into a mapping of the file or into m_Buffer.
+        std::vector<char> m_Buffer;     ///< The contents of the file if it could not be mapped.
+#ifdef _WIN32
+        void*             m_FileHandle;
+        void*             m_MappingHandle;
+#endif
+    };
+
+
+    /// A stream buffer that reads from a block of memory. The memory is not copied.
+    class MemoryStreamBufT : public std::streambuf
+    {
+        public:
+
+        /// The constructor.
+        MemoryStreamBufT(const char* Data, size_t Size);
+
+
+        protected:
+
+        std::streampos seekoff(std::streamoff Offset, std::ios_base::seekdir Dir, std::ios_base::openmode Which) override;
+        std::streampos seekpos(std::streampos Pos, std::ios_base::openmode Which) override;
+    };
+
+
+    /// An input stream that reads from a block of memory, e.g. a section of a MappedFileT.
+    /// The memory is not copied and must remain valid for the lifetime of the stream.
+    class MemoryInStreamT : public std::istream
+    {
+        public:
+
+        /// The constructor.
+        MemoryInStreamT(const char* Data, size_t Size);
+
+
+        private:
+
+        MemoryStreamBufT m_StreamBuf;
+    };
+}
+
+#endif
@@ -7,6 +7,8 @@ This project is licensed under the terms of the MIT license.
 #include "Variables.hpp"
 #include "Network/State.hpp"
 
+#include <atomic>
+
 
 /****************/
 /*** VarBaseT ***/
@@ -221,6 +223,7 @@ void cf::TypeSys::VarArrayT<T>::Deserialize(cf::Network::InStreamT& Stream)
     // side-effects resulting from derived classes that have provided an override for `VarT::Set()`,
     // any such side-effects are not supported and not accounted for here.
     Stream >> m_Array;
+    MarkChanged();
 }
 
 
@@ -246,6 +249,9 @@ void cf::TypeSys::VarManT::Add(VarBaseT* Var)
 {
     m_VarsArray.PushBack(Var);
     m_VarsMap[Var->GetName()] = Var;
+
+    Var->m_VarMan = this;
+    MarkChanged();
 }
 
 
@@ -255,6 +261,15 @@ void cf::TypeSys::VarManT::AddAlias(const char* Alias, VarBaseT* Var)
 }
 
 
+/*static*/ uint64_t cf::TypeSys::VarManT::GetNextChangeNr()
+{
+    // VarManTs are used in the client, the server and the GUIs, which may run in different threads.
+    static std::atomic<uint64_t> s_ChangeNr(0);
+
+    return ++s_ChangeNr;
+}
+
+
 /*******************************/
 /*** Template Instantiations ***/
 /*******************************/
@@ -100,6 +100,7 @@ namespace cf
 
     namespace TypeSys
     {
+        class VarManT;
         class VisitorT;
         class VisitorConstT;
 
@@ -115,7 +116,16 @@ namespace cf
             public:
 
             VarBaseT(const char* Name, const char* Flags[])
-                : m_Name(Name), m_Flags(Flags) { }
+                : m_Name(Name), m_Flags(Flags), m_VarMan(NULL) { }
+
+            /// The copy constructor.
+            /// The new variable is not a member of any VarManT, even if the source variable is.
+            VarBaseT(const VarBaseT& Var)
+                : m_Name(Var.m_Name), m_Flags(Var.m_Flags), m_VarMan(NULL) { }
+
+            /// The assignment operator.
+            /// This variable remains a member of its own VarManT (if any).
+            VarBaseT& operator = (const VarBaseT& Var) { m_Name = Var.m_Name; m_Flags = Var.m_Flags; return *this; }
 
             const char* GetName() const { return m_Name; }
 
@@ -149,10 +159,20 @@ namespace cf
             virtual void accept(VisitorConstT& Visitor) const = 0;
 
 
+            protected:
+
+            /// Lets the VarManT that this variable is a member of know that the value of this variable has changed.
+            /// See VarManT::GetChangeNr() for details.
+            void MarkChanged();
+
+
             private:
 
+            friend class VarManT;
+
             const char*  m_Name;    ///< The name of the variable.
             const char** m_Flags;   ///< An optional list of context-dependent flags.
+            VarManT*     m_VarMan;  ///< The VarManT that this variable is a member of, `NULL` if none.
         };
 
 
@@ -186,7 +206,7 @@ namespace cf
             /// In some cases, side-effects can even affect *other* variables (siblings). For example, setting a new
             /// model name in ComponentModelT not only updates the internal (private) model resource, but it can also
             /// imply updates (resets or clamps) to the animation and skin number variables.
-            virtual void Set(const T& v) { m_Value = v; }
+            virtual void Set(const T& v) { m_Value = v; MarkChanged(); }
 
             /// This method returns a list of acceptable input values for this variable, along with a string
             /// representation of each.
@@ -237,12 +257,12 @@ namespace cf
 
             const ArrayT<T>& Get() const   { return m_Array; }
             unsigned int Size() const      { return m_Array.Size(); }
-            void Clear()                   { m_Array.Clear(); }
-            void Overwrite()               { m_Array.Overwrite(); }
-            void PushBack(const T Element) { m_Array.PushBack(Element); }
+            void Clear()                   { m_Array.Clear(); MarkChanged(); }
+            void Overwrite()               { m_Array.Overwrite(); MarkChanged(); }
+            void PushBack(const T Element) { m_Array.PushBack(Element); MarkChanged(); }
 
             const T& operator [] (unsigned int i) const { return m_Array[i]; }
-            T& operator [] (unsigned int i) { return m_Array[i]; }
+            T& operator [] (unsigned int i) { MarkChanged(); return m_Array[i]; }   // The element may be modified via the returned reference.
 
             void Serialize(Network::OutStreamT& Stream) const /*override*/;
             void Deserialize(Network::InStreamT& Stream) /*override*/;
@@ -337,6 +357,9 @@ namespace cf
             typedef std::map<const char*, VarBaseT*, CompareCStr> MapVarBaseT;
 
 
+            /// The constructor.
+            VarManT() : m_ChangeNr(GetNextChangeNr()) { }
+
             void Add(VarBaseT* Var);
 
             /// Adds an alias name for the given variable so that a call to Find() will also find the variable
@@ -354,12 +377,34 @@ namespace cf
                 return It != m_VarsMap.end() ? It->second : NULL;
             }
 
+            /// Returns the change number of this VarManT.
+            /// It is renewed whenever the value of one of the variables is set (even if set to the same value),
+            /// or when the owner of this VarManT calls MarkChanged() because other data that it serializes along
+            /// with the variables has changed.
+            /// Change numbers are unique and increasing across all VarManT instances. Thus, the largest change
+            /// number of a group of VarManTs (e.g. of all components of an entity) can be used to learn if
+            /// anything in the group has changed, even if VarManTs have been added to or removed from the group.
+            uint64_t GetChangeNr() const { return m_ChangeNr; }
+
+            /// Renews the change number of this VarManT, see GetChangeNr() for details.
+            void MarkChanged() { m_ChangeNr = GetNextChangeNr(); }
+
+            /// Returns a new change number that is larger than all change numbers that have been returned before.
+            static uint64_t GetNextChangeNr();
+
 
             private:
 
             ArrayT<VarBaseT*> m_VarsArray;  ///< Keeps the variables in the order they were added.
             MapVarBaseT       m_VarsMap;    ///< Keeps the variables by name (for find by name and lexicographical traversal).
+            uint64_t          m_ChangeNr;   ///< The change number of this VarManT, see GetChangeNr() for details.
         };
+
+
+        inline void VarBaseT::MarkChanged()
+        {
+            if (m_VarMan) m_VarMan->MarkChanged();
+        }
     }
 }
 
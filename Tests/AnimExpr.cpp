@@ -0,0 +1,317 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/************************************/
+/*** Anim Expression Program Test ***/
+/************************************/
+
+// This program checks that AnimExprProgramT computes exactly the same joint data as the GetData() methods of the
+// anim expression trees that it is compiled from. GetData() is called for each joint with default-constructed
+// out-parameters, as AnimPoseT::UpdateJointMatrices() did before it used AnimExprProgramT, and the results of the
+// program and of AnimExpressionT::GetAllData() must match these bit for bit.
+// The expression trees are built from the animation sequences of the player models of the DeathMatch game and of
+// channels that this program adds to the models, and comprise standard expressions, filters (also at the top of
+// the tree and of invalid channels), combinations, blends (also of blends) and an expression of a kind that is
+// unknown to AnimExprProgramT. All expressions of a model are run with the same program, so that its registers
+// keep the data of the previous expressions.
+//
+// Usage: AnimExpr [ModelFile ...]
+// Run it from the Cafu top-level directory. Without model files, the player models of the DeathMatch game are used.
+// The exit code is 0 if all results matched, 1 otherwise.
+
+#include "ConsoleCommands/Console.hpp"
+#include "ConsoleCommands/ConsoleStdout.hpp"
+#include "FileSys/FileManImpl.hpp"
+#include "MaterialSystem/MaterialManager.hpp"
+#include "Models/AnimExpr.hpp"
+#include "Models/Loader_cmdl.hpp"
+#include "Models/Model_cmdl.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+
+static cf::ConsoleStdoutT ConsoleStdout;
+cf::ConsoleI* Console=&ConsoleStdout;
+
+static cf::FileSys::FileManImplT FileManImpl;
+cf::FileSys::FileManI* cf::FileSys::FileMan=&FileManImpl;
+
+MaterialManagerI* MaterialManager=NULL;
+
+
+namespace
+{
+    const char* PlayerModels[]=
+    {
+        "Games/DeathMatch/Models/Players/Alien/Alien.cmdl",
+        "Games/DeathMatch/Models/Players/James/James.cmdl",
+        "Games/DeathMatch/Models/Players/Punisher/Punisher.cmdl",
+        "Games/DeathMatch/Models/Players/Sentinel/Sentinel.cmdl",
+        "Games/DeathMatch/Models/Players/Skeleton/Skeleton.cmdl",
+        "Games/DeathMatch/Models/Players/T801/T801.cmdl",
+        "Games/DeathMatch/Models/Players/Trinity/Trinity.cmdl"
+    };
+
+    const unsigned int NUM_PLAYER_MODELS=sizeof(PlayerModels)/sizeof(PlayerModels[0]);
+
+    // The channels that ChannelLoaderT adds to the models.
+    enum { CHANNEL_EVEN, CHANNEL_UPPER, CHANNEL_FIRST, CHANNEL_NONE, NUM_CHANNELS };
+
+    /// The channel number of a channel that does not exist, which lets the filters pass all joints.
+    const unsigned int CHANNEL_INVALID=1000;
+
+
+    /// The player models have no channels, so this loader adds some.
+    class ChannelLoaderT : public LoaderCafuT
+    {
+        public:
+
+        ChannelLoaderT(const std::string& FileName) : LoaderCafuT(FileName), m_NumJoints(0) { }
+
+        void Load(ArrayT<CafuModelT::JointT>& Joints, ArrayT<CafuModelT::MeshT>& Meshes, ArrayT<CafuModelT::AnimT>& Anims, MaterialManagerImplT& MaterialMan)
+        {
+            LoaderCafuT::Load(Joints, Meshes, Anims, MaterialMan);
+            m_NumJoints=Joints.Size();
+        }
+
+        void Load(ArrayT<CafuModelT::ChannelT>& Channels)
+        {
+            LoaderCafuT::Load(Channels);
+            Channels.Overwrite();
+            Channels.PushBackEmptyExact(NUM_CHANNELS);
+
+            Channels[CHANNEL_EVEN ].Name="even joints";
+            Channels[CHANNEL_UPPER].Name="upper half";
+            Channels[CHANNEL_FIRST].Name="first joint";
+            Channels[CHANNEL_NONE ].Name="no joints";
+
+            for (unsigned int JointNr=0; JointNr<m_NumJoints; JointNr++)
+            {
+                if (JointNr % 2 == 0) Channels[CHANNEL_EVEN].SetMember(JointNr);
+                if (JointNr >= m_NumJoints/2) Channels[CHANNEL_UPPER].SetMember(JointNr);
+            }
+
+            Channels[CHANNEL_FIRST].SetMember(0);
+        }
+
+
+        private:
+
+        unsigned int m_NumJoints;
+    };
+
+
+    /// An anim expression of a kind that AnimExprProgramT does not know, so that it is run with OP_GENERIC.
+    /// It passes the data of its sub-expression through.
+    class AnimExprPassT : public AnimExpressionT
+    {
+        public:
+
+        AnimExprPassT(AnimExpressionPtrT SubExpr) : AnimExpressionT(SubExpr->GetModel()), m_SubExpr(SubExpr) { }
+
+        void GetData(unsigned int JointNr, float& Weight, Vector3fT& Pos, cf::math::QuaternionfT& Quat, Vector3fT& Scale) const
+        {
+            m_SubExpr->GetData(JointNr, Weight, Pos, Quat, Scale);
+        }
+
+        bool AdvanceTime(float Time) { return m_SubExpr->AdvanceTime(Time); }
+        AnimExpressionPtrT Clone() const { return new AnimExprPassT(m_SubExpr->Clone()); }
+        bool IsEqual(const AnimExpressionPtrT& AE) const { return false; }
+
+
+        private:
+
+        AnimExpressionPtrT m_SubExpr;
+    };
+
+
+    bool IsSame(float a, float b)
+    {
+        // Compare the bits, so that NaNs in both results count as equal as well.
+        return memcmp(&a, &b, sizeof(float))==0;
+    }
+
+
+    bool IsSame(const AnimExpressionT::JointsDataT& Data, unsigned int JointNr, float Weight, const Vector3fT& Pos, const cf::math::QuaternionfT& Quat, const Vector3fT& Scale)
+    {
+        const Vector3fT&              P=Data.Pos   [JointNr];
+        const cf::math::QuaternionfT& Q=Data.Quats [JointNr];
+        const Vector3fT&              S=Data.Scales[JointNr];
+
+        return IsSame(Data.Weights[JointNr], Weight) &&
+               IsSame(P.x, Pos.x) && IsSame(P.y, Pos.y) && IsSame(P.z, Pos.z) &&
+               IsSame(Q.x, Quat.x) && IsSame(Q.y, Quat.y) && IsSame(Q.z, Quat.z) && IsSame(Q.w, Quat.w) &&
+               IsSame(S.x, Scale.x) && IsSame(S.y, Scale.y) && IsSame(S.z, Scale.z);
+    }
+
+
+    /// Runs the given expression with the given program and with GetAllData(), and compares the results with GetData().
+    /// Returns the number of mismatches.
+    unsigned long Compare(const char* Name, const AnimExpressionPtrT& AE, AnimExprProgramT& Program)
+    {
+        const unsigned int NumJoints=AE->GetModel().GetJoints().Size();
+        unsigned long      NumMismatches=0;
+
+        Program.Compile(*AE);
+
+        const AnimExpressionT::JointsDataT& ProgData=Program.Run();
+        AnimExpressionT::JointsDataT        AllData;
+
+        AE->GetAllData(AllData);
+
+        if (ProgData.Weights.Size()!=NumJoints || AllData.Weights.Size()!=NumJoints)
+        {
+            printf("FAIL  %-40s %u joints, program %lu, GetAllData() %lu\n", Name, NumJoints, ProgData.Weights.Size(), AllData.Weights.Size());
+            return 1;
+        }
+
+        for (unsigned int JointNr=0; JointNr<NumJoints; JointNr++)
+        {
+            float                  Weight;
+            Vector3fT              Pos;
+            cf::math::QuaternionfT Quat;
+            Vector3fT              Scale;
+
+            AE->GetData(JointNr, Weight, Pos, Quat, Scale);
+
+            if (!IsSame(ProgData, JointNr, Weight, Pos, Quat, Scale))
+            {
+                if (NumMismatches==0)
+                    printf("  joint %u: program w %g pos (%g %g %g), GetData() w %g pos (%g %g %g)\n", JointNr,
+                        ProgData.Weights[JointNr], ProgData.Pos[JointNr].x, ProgData.Pos[JointNr].y, ProgData.Pos[JointNr].z,
+                        Weight, Pos.x, Pos.y, Pos.z);
+
+                NumMismatches++;
+            }
+
+            if (!IsSame(AllData, JointNr, Weight, Pos, Quat, Scale)) NumMismatches++;
+        }
+
+        if (NumMismatches>0)
+            printf("FAIL  %-40s %lu mismatches\n", Name, NumMismatches);
+
+        return NumMismatches;
+    }
+
+
+    /// Returns a blend from A to B that has advanced by the given fraction.
+    AnimExpressionPtrT GetBlend(AnimExpressionPtrT A, AnimExpressionPtrT B, float Frac)
+    {
+        IntrusivePtrT<AnimExprBlendT> Blend=A->GetModel().GetAnimExprPool().GetBlend(A, B, 2.0f);
+
+        Blend->AdvanceTime(2.0f*Frac);
+        return Blend;
+    }
+
+
+    /// Compares the results of the program with GetData() for many expression trees of the given model.
+    /// Returns the number of expressions whose results did not match.
+    unsigned long CompareModel(const CafuModelT& Model)
+    {
+        AnimExprPoolT&   Pool=Model.GetAnimExprPool();
+        const int        NumSequs=Model.GetAnims().Size();
+        AnimExprProgramT Program;
+        unsigned long    NumExprs=0;
+        unsigned long    NumErrors=0;
+
+        for (int SequNr=-1; SequNr<NumSequs; SequNr++)
+        {
+            // The frame numbers are fractional, so that the standard expressions interpolate between frames.
+            const float        FrameNr=SequNr<0 ? 0.0f : Model.GetAnims()[SequNr].Frames.Size()*0.37f;
+            const int          OtherNr=NumSequs>0 ? (SequNr+3) % NumSequs : -1;
+            AnimExpressionPtrT A=Pool.GetStandard(SequNr, FrameNr);
+            AnimExpressionPtrT B=Pool.GetStandard(OtherNr, FrameNr*0.5f+0.25f);
+
+            struct { const char* Name; AnimExpressionPtrT AE; } Exprs[]=
+            {
+                { "standard",                    A },
+                { "filter",                      Pool.GetFilter(A, CHANNEL_UPPER) },
+                { "filter, no joints",           Pool.GetFilter(A, CHANNEL_NONE) },
+                { "filter, invalid channel",     Pool.GetFilter(A, CHANNEL_INVALID) },
+                { "filter of filter",            Pool.GetFilter(Pool.GetFilter(A, CHANNEL_EVEN), CHANNEL_UPPER) },
+                { "combine",                     Pool.GetCombine(A, B) },
+                { "combine of filters",          Pool.GetCombine(Pool.GetFilter(A, CHANNEL_UPPER), Pool.GetFilter(B, CHANNEL_EVEN)) },
+                { "combine of filtered A",       Pool.GetCombine(Pool.GetFilter(A, CHANNEL_FIRST), B) },
+                { "combine of filtered B",       Pool.GetCombine(A, Pool.GetFilter(B, CHANNEL_NONE)) },
+                { "filter of combine",           Pool.GetFilter(Pool.GetCombine(Pool.GetFilter(A, CHANNEL_FIRST), Pool.GetFilter(B, CHANNEL_EVEN)), CHANNEL_UPPER) },
+                { "blend, start",                GetBlend(A, B, 0.0f) },
+                { "blend",                       GetBlend(A, B, 0.3f) },
+                { "blend, end",                  GetBlend(A, B, 1.0f) },
+                { "blend of filters",            GetBlend(Pool.GetFilter(A, CHANNEL_EVEN), Pool.GetFilter(B, CHANNEL_UPPER), 0.6f) },
+                { "blend of blends",             GetBlend(GetBlend(A, B, 0.25f), GetBlend(B, Pool.GetFilter(A, CHANNEL_FIRST), 0.5f), 0.75f) },
+                { "filter of blend",             Pool.GetFilter(GetBlend(A, Pool.GetFilter(B, CHANNEL_EVEN), 0.4f), CHANNEL_UPPER) },
+                { "filter of blend, start",      Pool.GetFilter(GetBlend(Pool.GetFilter(A, CHANNEL_EVEN), B, 0.0f), CHANNEL_UPPER) },
+                { "generic",                     new AnimExprPassT(A) },
+                { "generic of filter",           new AnimExprPassT(Pool.GetFilter(A, CHANNEL_EVEN)) },
+                { "filter of generic",           Pool.GetFilter(new AnimExprPassT(A), CHANNEL_UPPER) },
+                { "combine of generic filters",  Pool.GetCombine(new AnimExprPassT(Pool.GetFilter(A, CHANNEL_UPPER)), new AnimExprPassT(Pool.GetFilter(B, CHANNEL_EVEN))) },
+                { "blend of generic filter",     GetBlend(new AnimExprPassT(Pool.GetFilter(B, CHANNEL_FIRST)), A, 0.5f) },
+            };
+
+            const unsigned int NUM_EXPRS=sizeof(Exprs)/sizeof(Exprs[0]);
+
+            // Run the expressions in both directions, so that each leaves different data in the registers of the program for the next.
+            for (unsigned int ExprNr=0; ExprNr<2*NUM_EXPRS; ExprNr++)
+            {
+                const unsigned int Nr=ExprNr<NUM_EXPRS ? ExprNr : 2*NUM_EXPRS-1-ExprNr;
+
+                if (Compare(Exprs[Nr].Name, Exprs[Nr].AE, Program)>0) NumErrors++;
+                NumExprs++;
+            }
+        }
+
+        printf("%s  %-56s %3lu joints, %4lu expressions, %lu failed\n", NumErrors==0 ? "PASS" : "FAIL", Model.GetFileName().c_str(),
+            Model.GetJoints().Size(), NumExprs, NumErrors);
+
+        return NumErrors;
+    }
+}
+
+
+int main(int ArgC, const char* ArgV[])
+{
+    ArrayT<std::string> FileNames;
+
+    for (int ArgNr=1; ArgNr<ArgC; ArgNr++)
+        FileNames.PushBack(ArgV[ArgNr]);
+
+    if (FileNames.Size()==0)
+        for (unsigned int ModelNr=0; ModelNr<NUM_PLAYER_MODELS; ModelNr++)
+            FileNames.PushBack(PlayerModels[ModelNr]);
+
+    unsigned long NumErrors=0;
+
+    for (unsigned long FileNr=0; FileNr<FileNames.Size(); FileNr++)
+    {
+        CafuModelT* Model=NULL;
+
+        try
+        {
+            ChannelLoaderT Loader(FileNames[FileNr]);
+
+            Model=new CafuModelT(Loader);
+        }
+        catch (const ModelLoaderT::LoadErrorT& LE)
+        {
+            printf("FAIL  %s: %s\n", FileNames[FileNr].c_str(), LE.what());
+            NumErrors++;
+            continue;
+        }
+
+        if (Model->GetChannels().Size()!=NUM_CHANNELS)
+        {
+            printf("FAIL  %s: the model has %lu channels, expected %u\n", FileNames[FileNr].c_str(), Model->GetChannels().Size(), NUM_CHANNELS);
+            NumErrors++;
+        }
+
+        NumErrors+=CompareModel(*Model);
+
+        delete Model;
+    }
+
+    return NumErrors==0 ? 0 : 1;
+}
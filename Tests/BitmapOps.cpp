@@ -0,0 +1,538 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/************************************/
+/*** BitmapT Operations Benchmark ***/
+/************************************/
+
+// This program checks the results of the scaling, halving and compositing methods of BitmapT against golden
+// reference implementations, and measures how fast each method is compared to its reference.
+// The reference implementations are the straightforward per-pixel versions with GetPixel() and SetPixel() that
+// the map compositions used before these operations became BitmapT methods. The BitmapT methods must reproduce
+// their results bit for bit, for images of all sizes (including odd ones) and for all channel values.
+//
+// Usage: BitmapOps [SizeXY [NumRuns]]
+// SizeXY is the side length of the images of the benchmark (default 1024), NumRuns the number of runs per method (default 10).
+// The exit code is 0 if all results matched their references, 1 otherwise.
+
+#include "Bitmap/Bitmap.hpp"
+#include "ConsoleCommands/Console.hpp"
+#include "ConsoleCommands/ConsoleStdout.hpp"
+#include "FileSys/FileManImpl.hpp"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+namespace
+{
+    // A simple deterministic random number generator, so that runs are reproducible across platforms.
+    struct RandomT
+    {
+        RandomT(unsigned long Seed) : State((Seed*2654435761u+1) & 0xFFFFFFFF) { }
+
+        uint32_t Get()
+        {
+            State=(State*1103515245u+12345u) & 0xFFFFFFFF;
+            const uint32_t Hi=(State >> 8) & 0xFFFF;
+            State=(State*1103515245u+12345u) & 0xFFFFFFFF;
+            return (Hi << 16) | ((State >> 8) & 0xFFFF);
+        }
+
+        unsigned long State;
+    };
+
+
+    /// The kinds of random images.
+    enum ImageKindT
+    {
+        Noise,          ///< All channels are random.
+        NormalMap,      ///< Random x and y components, positive z component, random alpha.
+        FlatZ           ///< Random x component, zero y component (to test zero-length vectors along with the extremes below).
+    };
+
+
+    /// Returns an image of the given size with random contents.
+    /// The first pixels hold the extreme channel values, as far as the image is large enough.
+    BitmapT MakeImage(RandomT& Random, unsigned int SizeX, unsigned int SizeY, ImageKindT Kind)
+    {
+        BitmapT Image(SizeX, SizeY);
+
+        for (unsigned long i=0; i<Image.Data.Size(); i++)
+        {
+            uint32_t RGBA=Random.Get();
+
+            if (Kind==NormalMap) RGBA=(RGBA & 0xFF00FFFF) | 0x00800000 | ((RGBA >> 1) & 0x007F0000);
+            if (Kind==FlatZ    ) RGBA&=0xFFFF00FF;
+
+            Image.Data[i]=RGBA;
+        }
+
+        const uint32_t Extremes[]={ 0x00000000, 0xFFFFFFFF, 0x80808080, 0x7F7F7F7F, 0x00FF00FF, 0xFF00FF00 };
+
+        for (unsigned long i=0; i<Image.Data.Size() && i<sizeof(Extremes)/sizeof(Extremes[0]); i++)
+            Image.Data[i]=Extremes[i];
+
+        return Image;
+    }
+
+
+    /*************************************/
+    /*** The reference implementations ***/
+    /*************************************/
+
+    void RefScale(BitmapT& B, unsigned int NewSizeX, unsigned int NewSizeY)
+    {
+        if (NewSizeX>=1 && NewSizeX!=B.SizeX)
+        {
+            BitmapT NewBitmap(NewSizeX, B.SizeY);
+
+            for (unsigned int nx=0; nx<NewSizeX; nx++)
+            {
+                const double       Ratio    =double(B.SizeX)/double(NewSizeX);
+                const double       ox1      =double(nx  )*Ratio;
+                const double       ox2      =double(nx+1)*Ratio;
+                const unsigned int ox1_floor=  nx   *B.SizeX              /NewSizeX;
+                const unsigned int ox2_ceil =((nx+1)*B.SizeX+(NewSizeX-1))/NewSizeX;
+                const double       ox1_frac =ox1-ox1_floor;
+                const double       ox2_frac =ox2-(ox2_ceil-1);
+
+                for (unsigned int oy=0; oy<B.SizeY; oy++)
+                {
+                    double TotalR=0.0, TotalG=0.0, TotalB=0.0, TotalA=0.0;
+
+                    for (unsigned int ox=ox1_floor; ox<ox2_ceil; ox++)
+                    {
+                        double Weight=1.0;
+
+                        if (ox1_floor!=ox2_ceil-1)
+                        {
+                                 if (ox==ox1_floor ) Weight=(1.0-ox1_frac)/Ratio;
+                            else if (ox==ox2_ceil-1) Weight=ox2_frac/Ratio;
+                            else                     Weight=1.0/Ratio;
+                        }
+
+                        int r, g, b, a;
+                        B.GetPixel(ox, oy, r, g, b, a);
+
+                        TotalR+=r*Weight;
+                        TotalG+=g*Weight;
+                        TotalB+=b*Weight;
+                        TotalA+=a*Weight;
+                    }
+
+                    NewBitmap.SetPixel(nx, oy, int(TotalR+0.49), int(TotalG+0.49), int(TotalB+0.49), int(TotalA+0.49));
+                }
+            }
+
+            B=NewBitmap;
+        }
+
+        if (NewSizeY>=1 && NewSizeY!=B.SizeY)
+        {
+            BitmapT NewBitmap(B.SizeX, NewSizeY);
+
+            for (unsigned int ny=0; ny<NewSizeY; ny++)
+            {
+                const double       Ratio    =double(B.SizeY)/double(NewSizeY);
+                const double       oy1      =double(ny  )*Ratio;
+                const double       oy2      =double(ny+1)*Ratio;
+                const unsigned int oy1_floor=  ny   *B.SizeY              /NewSizeY;
+                const unsigned int oy2_ceil =((ny+1)*B.SizeY+(NewSizeY-1))/NewSizeY;
+                const double       oy1_frac =oy1-oy1_floor;
+                const double       oy2_frac =oy2-(oy2_ceil-1);
+
+                for (unsigned int ox=0; ox<B.SizeX; ox++)
+                {
+                    double TotalR=0.0, TotalG=0.0, TotalB=0.0, TotalA=0.0;
+
+                    for (unsigned int oy=oy1_floor; oy<oy2_ceil; oy++)
+                    {
+                        double Weight=1.0;
+
+                        if (oy1_floor!=oy2_ceil-1)
+                        {
+                                 if (oy==oy1_floor ) Weight=(1.0-oy1_frac)/Ratio;
+                            else if (oy==oy2_ceil-1) Weight=oy2_frac/Ratio;
+                            else                     Weight=1.0/Ratio;
+                        }
+
+                        int r, g, b, a;
+                        B.GetPixel(ox, oy, r, g, b, a);
+
+                        TotalR+=r*Weight;
+                        TotalG+=g*Weight;
+                        TotalB+=b*Weight;
+                        TotalA+=a*Weight;
+                    }
+
+                    NewBitmap.SetPixel(ox, ny, int(TotalR+0.49), int(TotalG+0.49), int(TotalB+0.49), int(TotalA+0.49));
+                }
+            }
+
+            B=NewBitmap;
+        }
+    }
+
+
+    void RefHalveSize(BitmapT& B)
+    {
+        if (B.SizeX<=1 && B.SizeY<=1) return;
+
+        BitmapT NewBitmap(B.SizeX>1 ? B.SizeX/2 : 1, B.SizeY>1 ? B.SizeY/2 : 1);
+
+        for (unsigned int ny=0; ny<NewBitmap.SizeY; ny++)
+            for (unsigned int nx=0; nx<NewBitmap.SizeX; nx++)
+            {
+                const unsigned int ox1=2*nx;
+                const unsigned int ox2=B.SizeX>1 ? ox1+1 : ox1;
+                const unsigned int oy1=2*ny;
+                const unsigned int oy2=B.SizeY>1 ? oy1+1 : oy1;
+                int                Sum[4]={ 2, 2, 2, 2 };   // Initialized with 2 for rounding to the nearest value.
+                int                c[4];
+
+                B.GetPixel(ox1, oy1, c[0], c[1], c[2], c[3]); for (int i=0; i<4; i++) Sum[i]+=c[i];
+                B.GetPixel(ox2, oy1, c[0], c[1], c[2], c[3]); for (int i=0; i<4; i++) Sum[i]+=c[i];
+                B.GetPixel(ox1, oy2, c[0], c[1], c[2], c[3]); for (int i=0; i<4; i++) Sum[i]+=c[i];
+                B.GetPixel(ox2, oy2, c[0], c[1], c[2], c[3]); for (int i=0; i<4; i++) Sum[i]+=c[i];
+
+                NewBitmap.SetPixel(nx, ny, Sum[0]/4, Sum[1]/4, Sum[2]/4, Sum[3]/4);
+            }
+
+        B=NewBitmap;
+    }
+
+
+    void RefAdd(BitmapT& B1, const BitmapT& B2)
+    {
+        for (unsigned int y=0; y<B1.SizeY; y++)
+            for (unsigned int x=0; x<B1.SizeX; x++)
+            {
+                int r1, g1, b1, a1;
+                int r2, g2, b2, a2;
+
+                B1.GetPixel(x, y, r1, g1, b1, a1);
+                B2.GetPixel(x, y, r2, g2, b2, a2);
+
+                B1.SetPixel(x, y, r1+r2, g1+g2, b1+b2, a1+a2);
+            }
+    }
+
+
+    void RefMul(BitmapT& B1, const BitmapT& B2)
+    {
+        for (unsigned int y=0; y<B1.SizeY; y++)
+            for (unsigned int x=0; x<B1.SizeX; x++)
+            {
+                float r1, g1, b1, a1;
+                float r2, g2, b2, a2;
+
+                B1.GetPixel(x, y, r1, g1, b1, a1);
+                B2.GetPixel(x, y, r2, g2, b2, a2);
+
+                B1.SetPixel(x, y, r1*r2, g1*g2, b1*b2, a1*a2);
+            }
+    }
+
+
+    void RefCombineNormals(BitmapT& NormalMap1, const BitmapT& NormalMap2)
+    {
+        const BitmapT Orig(NormalMap1);
+
+        for (unsigned int y=0; y<Orig.SizeY; y++)
+            for (unsigned int x=0; x<Orig.SizeX; x++)
+            {
+                float x1, y1, z1;
+                float x2, y2, z2;
+
+                Orig      .GetPixel(x, y, x1, y1, z1);
+                NormalMap2.GetPixel(x, y, x2, y2, z2);
+
+                x1=x1*2.0f-1.0f; y1=y1*2.0f-1.0f; z1=z1*2.0f-1.0f;
+                x2=x2*2.0f-1.0f; y2=y2*2.0f-1.0f; z2=z2*2.0f-1.0f;
+
+                float x_=x1*z2+x2*z1;
+                float y_=y1*z2+y2*z1;
+                float z_=z1*z2;
+
+                const float Length=float(sqrt(x_*x_ + y_*y_ + z_*z_));
+
+                if (Length!=0.0)
+                {
+                    x_/=Length;
+                    y_/=Length;
+                    z_/=Length;
+                }
+
+                NormalMap1.SetPixel(x, y, (x_+1.0f)/2.0f, (y_+1.0f)/2.0f, (z_+1.0f)/2.0f);
+            }
+    }
+
+
+    void RefHeightMapToNormalMap(BitmapT& B, float HeightScale)
+    {
+        const BitmapT HeightMap(B);
+
+        for (unsigned int y=0; y<HeightMap.SizeY; y++)
+            for (unsigned int x=0; x<HeightMap.SizeX; x++)
+            {
+                float h00, h01, h10, g, b, a;
+
+                HeightMap.GetPixel( x                     ,  y                     , h00, g, b, a);
+                HeightMap.GetPixel( x                     , (y+1) % HeightMap.SizeY, h01, g, b, a);
+                HeightMap.GetPixel((x+1) % HeightMap.SizeX,  y                     , h10, g, b, a);
+
+                const float VecX[3]={ 1.0f, 0.0f, (h10-h00)*HeightScale };
+                const float VecY[3]={ 0.0f, 1.0f, (h01-h00)*HeightScale };
+
+                float Normal[3]={ VecX[1]*VecY[2]-VecX[2]*VecY[1], VecX[2]*VecY[0]-VecX[0]*VecY[2], VecX[0]*VecY[1]-VecX[1]*VecY[0] };
+                float Length=float(sqrt(Normal[0]*Normal[0] + Normal[1]*Normal[1] + Normal[2]*Normal[2]));
+
+                if (Length!=0.0)
+                {
+                    Normal[0]/=Length;
+                    Normal[1]/=Length;
+                    Normal[2]/=Length;
+                }
+
+                B.SetPixel(x, y, (Normal[0]+1.0f)/2.0f, (Normal[1]+1.0f)/2.0f, (Normal[2]+1.0f)/2.0f);
+            }
+    }
+
+
+    void RefFlipNormalMapYAxis(BitmapT& NormalMap)
+    {
+        for (unsigned int y=0; y<NormalMap.SizeY; y++)
+            for (unsigned int x=0; x<NormalMap.SizeX; x++)
+            {
+                int nx, ny, nz;
+
+                NormalMap.GetPixel(x, y, nx,     ny, nz);
+                NormalMap.SetPixel(x, y, nx, 255-ny, nz);
+            }
+    }
+
+
+    void RefReNormalize(BitmapT& NormalMap)
+    {
+        for (unsigned int y=0; y<NormalMap.SizeY; y++)
+            for (unsigned int x=0; x<NormalMap.SizeX; x++)
+            {
+                float nx, ny, nz;
+
+                NormalMap.GetPixel(x, y, nx, ny, nz);
+
+                nx=nx*2.0f-1.0f;
+                ny=ny*2.0f-1.0f;
+                nz=nz*2.0f-1.0f;
+
+                const float Length=float(sqrt(nx*nx + ny*ny + nz*nz));
+
+                if (Length!=0.0)
+                {
+                    nx/=Length;
+                    ny/=Length;
+                    nz/=Length;
+                }
+
+                NormalMap.SetPixel(x, y, (nx+1.0f)/2.0f, (ny+1.0f)/2.0f, (nz+1.0f)/2.0f);
+            }
+    }
+
+
+    void RefApplyGamma(BitmapT& B, float Gamma)
+    {
+        for (unsigned int y=0; y<B.SizeY; y++)
+            for (unsigned int x=0; x<B.SizeX; x++)
+            {
+                int c[4];
+
+                B.GetPixel(x, y, c[0], c[1], c[2], c[3]);
+
+                for (int i=0; i<3; i++)
+                {
+                    float Value=pow(float(c[i])/255.0f, 1.0f/Gamma)*255.0f;
+
+                    if (Value<  0.0f) Value=  0.0f;
+                    if (Value>255.0f) Value=255.0f;
+
+                    c[i]=int(Value+0.49f);
+                }
+
+                B.SetPixel(x, y, c[0], c[1], c[2], c[3]);
+            }
+    }
+
+
+    /******************************/
+    /*** The test and benchmark ***/
+    /******************************/
+
+    /// Returns the number of pixels in which the two bitmaps differ, or the number of pixels of A if their sizes differ.
+    unsigned long CountMismatches(const BitmapT& A, const BitmapT& B)
+    {
+        if (A.SizeX!=B.SizeX || A.SizeY!=B.SizeY) return A.Data.Size() > 0 ? A.Data.Size() : 1;
+
+        unsigned long Count=0;
+
+        for (unsigned long i=0; i<A.Data.Size(); i++)
+            if (A.Data[i]!=B.Data[i]) Count++;
+
+        return Count;
+    }
+
+
+    /// An operation of the test: its name, how it is applied with a BitmapT method and with its reference implementation,
+    /// and the kind of images that it works on.
+    struct OperationT
+    {
+        const char* Name;
+        ImageKindT  Kind;
+        void      (*Apply)(BitmapT& B, const BitmapT& Other, unsigned int Param);
+        void      (*ApplyRef)(BitmapT& B, const BitmapT& Other, unsigned int Param);
+        unsigned int NumParams;     ///< The number of different parameters that are tested.
+    };
+
+
+    const unsigned int ScaleSizes[][2]={ { 1, 1 }, { 2, 3 }, { 8, 8 }, { 13, 40 }, { 128, 64 }, { 300, 7 }, { 0, 5 }, { 5, 0 } };
+    const unsigned int NUM_SCALE_SIZES=sizeof(ScaleSizes)/sizeof(ScaleSizes[0]);
+    const float        HeightScales[]={ 0.0f, 1.0f, 3.5f, -2.0f };
+    const float        Gammas[]      ={ 1.0f, 0.6f, 2.2f };
+
+    /// Returns the new size of B for the Scale operation with the given parameter:
+    /// one of the ScaleSizes, or, for the last parameter, two thirds of the size of B, which is a typical non-power-of-two case.
+    void GetNewSize(const BitmapT& B, unsigned int Param, unsigned int& NewSizeX, unsigned int& NewSizeY)
+    {
+        NewSizeX=(Param<NUM_SCALE_SIZES) ? ScaleSizes[Param][0] : (B.SizeX*2+2)/3;
+        NewSizeY=(Param<NUM_SCALE_SIZES) ? ScaleSizes[Param][1] : (B.SizeY*2+2)/3;
+    }
+
+    void Scale    (BitmapT& B, const BitmapT&  , unsigned int Param) { unsigned int x, y; GetNewSize(B, Param, x, y); B.Scale(x, y); }
+    void ScaleRef (BitmapT& B, const BitmapT&  , unsigned int Param) { unsigned int x, y; GetNewSize(B, Param, x, y); RefScale(B, x, y); }
+    void Halve    (BitmapT& B, const BitmapT&  , unsigned int      ) { B.HalveSize(); }
+    void HalveRef (BitmapT& B, const BitmapT&  , unsigned int      ) { RefHalveSize(B); }
+    void Add      (BitmapT& B, const BitmapT& O, unsigned int      ) { B.Add(O); }
+    void AddRef   (BitmapT& B, const BitmapT& O, unsigned int      ) { RefAdd(B, O); }
+    void Mul      (BitmapT& B, const BitmapT& O, unsigned int      ) { B.Mul(O); }
+    void MulRef   (BitmapT& B, const BitmapT& O, unsigned int      ) { RefMul(B, O); }
+    void Combine  (BitmapT& B, const BitmapT& O, unsigned int      ) { B.CombineNormals(O); }
+    void CombRef  (BitmapT& B, const BitmapT& O, unsigned int      ) { RefCombineNormals(B, O); }
+    void Height   (BitmapT& B, const BitmapT&  , unsigned int Param) { B.HeightMapToNormalMap(HeightScales[Param]); }
+    void HeightRef(BitmapT& B, const BitmapT&  , unsigned int Param) { RefHeightMapToNormalMap(B, HeightScales[Param]); }
+    void Flip     (BitmapT& B, const BitmapT&  , unsigned int      ) { B.FlipNormalMapYAxis(); }
+    void FlipRef  (BitmapT& B, const BitmapT&  , unsigned int      ) { RefFlipNormalMapYAxis(B); }
+    void ReNorm   (BitmapT& B, const BitmapT&  , unsigned int      ) { B.ReNormalize(); }
+    void ReNormRef(BitmapT& B, const BitmapT&  , unsigned int      ) { RefReNormalize(B); }
+    void Gamma    (BitmapT& B, const BitmapT&  , unsigned int Param) { B.ApplyGamma(Gammas[Param]); }
+    void GammaRef (BitmapT& B, const BitmapT&  , unsigned int Param) { RefApplyGamma(B, Gammas[Param]); }
+
+    const OperationT Operations[]=
+    {
+        { "Scale",                Noise,     Scale,   ScaleRef,  NUM_SCALE_SIZES+1 },
+        { "HalveSize",            Noise,     Halve,   HalveRef,  1 },
+        { "Add",                  Noise,     Add,     AddRef,    1 },
+        { "Mul",                  Noise,     Mul,     MulRef,    1 },
+        { "CombineNormals",       NormalMap, Combine, CombRef,   1 },
+        { "CombineNormals",       FlatZ,     Combine, CombRef,   1 },
+        { "HeightMapToNormalMap", Noise,     Height,  HeightRef, sizeof(HeightScales)/sizeof(HeightScales[0]) },
+        { "FlipNormalMapYAxis",   NormalMap, Flip,    FlipRef,   1 },
+        { "ReNormalize",          Noise,     ReNorm,  ReNormRef, 1 },
+        { "ReNormalize",          FlatZ,     ReNorm,  ReNormRef, 1 },
+        { "ApplyGamma",           Noise,     Gamma,   GammaRef,  sizeof(Gammas)/sizeof(Gammas[0]) },
+    };
+
+    const unsigned int NUM_OPERATIONS=sizeof(Operations)/sizeof(Operations[0]);
+
+
+    /// Returns the seconds that NumRuns applications of the given function to a copy of Image take.
+    double Measure(void (*Apply)(BitmapT&, const BitmapT&, unsigned int), const BitmapT& Image, const BitmapT& Other, unsigned int Param, unsigned int NumRuns)
+    {
+        double Seconds=0.0;
+
+        for (unsigned int RunNr=0; RunNr<NumRuns; RunNr++)
+        {
+            BitmapT B(Image);
+
+            const std::chrono::steady_clock::time_point Start=std::chrono::steady_clock::now();
+            Apply(B, Other, Param);
+            Seconds+=std::chrono::duration<double>(std::chrono::steady_clock::now()-Start).count();
+        }
+
+        return Seconds;
+    }
+}
+
+
+static cf::ConsoleStdoutT ConsoleStdout;
+cf::ConsoleI* Console=&ConsoleStdout;
+
+static cf::FileSys::FileManImplT FileManImpl;
+cf::FileSys::FileManI* cf::FileSys::FileMan=&FileManImpl;
+
+
+int main(int ArgC, const char* ArgV[])
+{
+    const unsigned int BenchSize=(ArgC>1) ? (unsigned int)strtoul(ArgV[1], NULL, 10) : 1024;
+    const unsigned int NumRuns  =(ArgC>2) ? (unsigned int)strtoul(ArgV[2], NULL, 10) : 10;
+    const unsigned int Sizes[][2]={ { 1, 1 }, { 1, 7 }, { 7, 1 }, { 2, 2 }, { 3, 5 }, { 16, 16 }, { 17, 9 }, { 64, 33 }, { 100, 75 }, { 256, 256 }, { 5, 300 } };
+    unsigned long      NumErrors=0;
+    RandomT            Random(1);
+
+    // Compare the results of each operation with its reference, for images of all sizes.
+    for (unsigned int OpNr=0; OpNr<NUM_OPERATIONS; OpNr++)
+    {
+        const OperationT& Op=Operations[OpNr];
+        unsigned long     NumTests=0;
+        unsigned long     NumMismatches=0;
+
+        for (unsigned int SizeNr=0; SizeNr<sizeof(Sizes)/sizeof(Sizes[0]); SizeNr++)
+            for (unsigned int Param=0; Param<Op.NumParams; Param++)
+            {
+                const BitmapT Image=MakeImage(Random, Sizes[SizeNr][0], Sizes[SizeNr][1], Op.Kind);
+                const BitmapT Other=MakeImage(Random, Sizes[SizeNr][0], Sizes[SizeNr][1], Op.Kind);
+                BitmapT       Result(Image);
+                BitmapT       Golden(Image);
+
+                Op.Apply   (Result, Other, Param);
+                Op.ApplyRef(Golden, Other, Param);
+
+                const unsigned long Count=CountMismatches(Golden, Result);
+
+                if (Count>0 && NumMismatches==0)
+                    printf("  %s: %lu mismatches for %ux%u, parameter %u\n", Op.Name, Count, Sizes[SizeNr][0], Sizes[SizeNr][1], Param);
+
+                NumMismatches+=Count;
+                NumTests++;
+            }
+
+        printf("%s  %-22s %3lu images, %lu mismatches\n", NumMismatches==0 ? "PASS" : "FAIL", Op.Name, NumTests, NumMismatches);
+        if (NumMismatches>0) NumErrors++;
+    }
+
+    // Measure each operation and its reference with images of the benchmark size.
+    printf("\n%ux%u images, %u runs:\n", BenchSize, BenchSize, NumRuns);
+
+    for (unsigned int OpNr=0; OpNr<NUM_OPERATIONS; OpNr++)
+    {
+        const OperationT& Op=Operations[OpNr];
+
+        // The second variants of CombineNormals and ReNormalize only differ in their images.
+        if (OpNr>0 && Op.Apply==Operations[OpNr-1].Apply) continue;
+
+        // Each operation is measured with its last parameter.
+        const unsigned int Param=Op.NumParams-1;
+        const BitmapT      Image=MakeImage(Random, BenchSize, BenchSize, Op.Kind);
+        const BitmapT      Other=MakeImage(Random, BenchSize, BenchSize, Op.Kind);
+        const double       New  =Measure(Op.Apply,    Image, Other, Param, NumRuns);
+        const double       Ref  =Measure(Op.ApplyRef, Image, Other, Param, NumRuns);
+
+        printf("      %-22s %8.2f ms, reference %8.2f ms, speed-up %5.1fx\n", Op.Name, New*1000.0/NumRuns, Ref*1000.0/NumRuns, Ref/New);
+    }
+
+    return NumErrors==0 ? 0 : 1;
+}
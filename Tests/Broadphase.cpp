@@ -0,0 +1,554 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/************************************/
+/*** ClipSys Broadphase Benchmark ***/
+/************************************/
+
+// This program loads the brushes of cmap files and inserts the bounding box of each brush as a clip model into a
+// SectorGridBroadphaseT and an AabbTreeBroadphaseT. It then moves a number of player-sized clip models around and
+// runs queries with player-sized boxes and with the boxes of random traces, measures the time that each broadphase
+// takes for them, and checks that both broadphases find the same clip models.
+// Then it builds a ClipWorldT with each broadphase from the collision models of the world and the other entities of the
+// map and the players, traces points and player-sized boxes through it, measures the time that the traces take with each
+// broadphase, and checks that the traces have the same results.
+//
+// Usage: Broadphase [NumQueries [MapFile ...]]
+// Run it from the Cafu top-level directory. Without map files, the maps of the DeathMatch game are used.
+// The exit code is 0 if both broadphases found the same clip models in all queries and the traces through the clip
+// worlds had the same results, 1 otherwise.
+
+#include "ClipSys/Broadphase.hpp"
+#include "ClipSys/ClipModel.hpp"
+#include "ClipSys/ClipWorld.hpp"
+#include "ClipSys/CollisionModel_static.hpp"
+#include "ClipSys/TraceResult.hpp"
+#include "ClipSys/TraceSolid.hpp"
+#include "ConsoleCommands/Console.hpp"
+#include "ConsoleCommands/ConsoleInterpreterImpl.hpp"
+#include "ConsoleCommands/ConsoleStdout.hpp"
+#include "ConsoleCommands/ConVar.hpp"
+#include "FileSys/FileManImpl.hpp"
+#include "MaterialSystem/Material.hpp"
+#include "MaterialSystem/MaterialManager.hpp"
+#include "MaterialSystem/MaterialManagerImpl.hpp"
+#include "Math3D/Polygon.hpp"
+#include "TextParser/TextParser.hpp"
+#include "Util/Util.hpp"
+#include "MapFile.hpp"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+
+static cf::ConsoleStdoutT ConsoleStdout;
+cf::ConsoleI* Console=&ConsoleStdout;
+
+static cf::FileSys::FileManImplT FileManImpl;
+cf::FileSys::FileManI* cf::FileSys::FileMan=&FileManImpl;
+
+ConsoleInterpreterI* ConsoleInterpreter=NULL;
+MaterialManagerI*    MaterialManager   =NULL;
+
+
+using namespace cf::ClipSys;
+
+
+namespace
+{
+    const unsigned long NUM_PLAYERS=64;     ///< The number of player-sized clip models that move around in the world.
+
+    // A simple deterministic random number generator, so that runs are reproducible across platforms.
+    struct RandomT
+    {
+        RandomT(unsigned long Seed) : State((Seed*2654435761u+1) & 0xFFFFFFFF) { }
+
+        unsigned long Get(unsigned long Max)
+        {
+            State=(State*1103515245u+12345u) & 0xFFFFFFFF;
+            return ((State >> 8) & 0xFFFFFF) % Max;
+        }
+
+        double Get(double Min, double Max)
+        {
+            return Min + (Max-Min)*double(Get(0x1000000ul))/double(0x1000000ul);
+        }
+
+        Vector3dT Get(const BoundingBox3dT& BB)
+        {
+            return Vector3dT(Get(BB.Min.x, BB.Max.x), Get(BB.Min.y, BB.Max.y), Get(BB.Min.z, BB.Max.z));
+        }
+
+        unsigned long State;
+    };
+
+    /// A clip model as seen by the broadphases.
+    struct ModelT
+    {
+        BoundingBox3dT BB;
+        unsigned long  Contents;
+        unsigned long  GridProxy;
+        unsigned long  TreeProxy;
+    };
+
+
+    // Returns the point in BB that is closest to V.
+    Vector3dT Clamp(const Vector3dT& V, const BoundingBox3dT& BB)
+    {
+        return Vector3dT(std::min(std::max(V.x, BB.Min.x), BB.Max.x),
+                         std::min(std::max(V.y, BB.Min.y), BB.Max.y),
+                         std::min(std::max(V.z, BB.Min.z), BB.Max.z));
+    }
+
+
+    // Loads the entities of the given cmap file and the bounding boxes and contents of all their brushes.
+    bool LoadBrushes(const char* FileName, ArrayT<cf::MapFileEntityT>& Entities, ArrayT<ModelT>& Models)
+    {
+        try
+        {
+            TextParserT TP(FileName, "({})");
+
+            if (TP.IsAtEOF()) return false;
+
+            cf::MapFileReadHeader(TP);
+
+            while (!TP.IsAtEOF())
+                Entities.PushBack(cf::MapFileEntityT(Entities.Size(), TP));
+        }
+        catch (const TextParserT::ParseError&)
+        {
+            return false;
+        }
+
+        for (unsigned long EntNr=0; EntNr<Entities.Size(); EntNr++)
+            for (unsigned long BrushNr=0; BrushNr<Entities[EntNr].MFBrushes.Size(); BrushNr++)
+            {
+                const cf::MapFileBrushT&    MFBrush=Entities[EntNr].MFBrushes[BrushNr];
+                ArrayT< Polygon3T<double> > Polys;
+                ModelT                      Model;
+
+                Model.Contents =0;
+                Model.GridProxy=BroadphaseT::NO_PROXY;
+                Model.TreeProxy=BroadphaseT::NO_PROXY;
+
+                for (unsigned long PlaneNr=0; PlaneNr<MFBrush.MFPlanes.Size(); PlaneNr++)
+                {
+                    const MaterialT* Material=MFBrush.MFPlanes[PlaneNr].Material;
+
+                    Polys.PushBackEmpty();
+                    Polys[Polys.Size()-1].Plane=MFBrush.MFPlanes[PlaneNr].Plane;
+
+                    Model.Contents|=Material ? Material->ClipFlags : (unsigned long)MaterialT::Clip_AllBlocking;
+                }
+
+                Polygon3T<double>::Complete(Polys, 0.1);
+
+                for (unsigned long PolyNr=0; PolyNr<Polys.Size(); PolyNr++)
+                    for (unsigned long VertexNr=0; VertexNr<Polys[PolyNr].Vertices.Size(); VertexNr++)
+                        Model.BB+=Polys[PolyNr].Vertices[VertexNr];
+
+                if (Model.BB.IsInited() && Model.Contents!=0) Models.PushBack(Model);
+            }
+
+        return Models.Size()>0;
+    }
+
+
+    // Returns the numbers of the models among the candidates that actually intersect BB and match ContentMask, in ascending order.
+    std::vector<unsigned long> GetExact(const ArrayT<ClipModelT*>& Candidates, const ArrayT<ModelT>& Models,
+                                        const char* Handles, const BoundingBox3dT& BB, unsigned long ContentMask)
+    {
+        std::vector<unsigned long> Result;
+
+        for (unsigned long CandNr=0; CandNr<Candidates.Size(); CandNr++)
+        {
+            const unsigned long ModelNr=(unsigned long)((const char*)Candidates[CandNr] - Handles);
+
+            if ((Models[ModelNr].Contents & ContentMask)==0) continue;
+            if (!Models[ModelNr].BB.IntersectsOrTouches(BB)) continue;
+
+            Result.push_back(ModelNr);
+        }
+
+        std::sort(Result.begin(), Result.end());
+        return Result;
+    }
+
+
+    // Returns an entity with a single box brush of the given material.
+    cf::MapFileEntityT GetBoxEntity(const BoundingBox3dT& BB, MaterialT* Material)
+    {
+        static const Vector3dT Normals[6]={ Vector3dT(1, 0, 0), Vector3dT(-1, 0, 0), Vector3dT(0, 1, 0), Vector3dT(0, -1, 0), Vector3dT(0, 0, 1), Vector3dT(0, 0, -1) };
+
+        cf::MapFileEntityT Entity;
+        cf::MapFileBrushT  Brush;
+
+        for (unsigned long SideNr=0; SideNr<6; SideNr++)
+        {
+            cf::MapFilePlaneT MFPlane;
+
+            MFPlane.Plane   =Plane3dT(Normals[SideNr], dot(Normals[SideNr], (SideNr & 1) ? BB.Min : BB.Max));
+            MFPlane.Material=Material;
+            MFPlane.U       =Vector3dT(Normals[SideNr].z, Normals[SideNr].x, Normals[SideNr].y);
+            MFPlane.V       =cross(Normals[SideNr], MFPlane.U);
+            MFPlane.ShiftU  =0.0;
+            MFPlane.ShiftV  =0.0;
+
+            Brush.MFPlanes.PushBack(MFPlane);
+        }
+
+        Entity.MFBrushes.PushBack(Brush);
+        return Entity;
+    }
+
+
+    /// A trace through the clip worlds, preceded by the move of a player.
+    struct TraceT
+    {
+        unsigned long PlayerNr;         ///< The number of the player that moves before the trace.
+        Vector3dT     PlayerPos;        ///< The new position of the player.
+        bool          IsBox;            ///< Whether a player-sized box or a point is traced.
+        Vector3dT     Start;            ///< The start point of the trace.
+        Vector3dT     Ray;              ///< The ray of the trace.
+        unsigned long ClipMask;         ///< The clip mask of the trace.
+        TraceResultT  Results[2];       ///< The results of the trace with the grid and the tree broadphase.
+        unsigned long HitModels[2];     ///< The numbers of the clip models that were hit with the grid and the tree broadphase, NUM_NONE if none.
+    };
+
+    const unsigned long NUM_NONE=0xFFFFFFFF;
+
+
+    // Traces points and player-sized boxes through a ClipWorldT with the collision models of the entities of the map and the
+    // players, once with each broadphase, measures the time that the traces take and checks that their results are the same.
+    bool RunClipWorld(const char* FileName, const ArrayT<cf::MapFileEntityT>& Entities, unsigned long NumTraces)
+    {
+        // The terrains are not relevant for comparing the broadphases and thus omitted.
+        // The other parameters are those that CaBSP uses for the collision models.
+        const ArrayT<CollisionModelStaticT::TerrainRefT> NoTerrains;
+        const CollisionModelStaticT                      WorldModel(Entities[0], NoTerrains, false, 0.08, 0.4, 24.0, -1.0, 40.0);
+        ArrayT<const CollisionModelStaticT*>             EntityModels;
+
+        for (unsigned long EntNr=1; EntNr<Entities.Size(); EntNr++)
+            if (Entities[EntNr].MFBrushes.Size()>0 || Entities[EntNr].MFPatches.Size()>0)
+                EntityModels.PushBack(new CollisionModelStaticT(Entities[EntNr], NoTerrains, true, 0.08, 0.4, 24.0, -1.0, 40.0));
+
+        MaterialT PlayerMaterial;
+        PlayerMaterial.ClipFlags=MaterialT::Clip_Players;
+
+        const BoundingBox3dT        PlayerBB(Vector3dT(-16, -16, -36), Vector3dT(16, 16, 36));
+        const CollisionModelStaticT PlayerModel(GetBoxEntity(PlayerBB, &PlayerMaterial), NoTerrains, true, 0.08, 0.4, 24.0, -1.0, 40.0);
+        const TracePointT           Point;
+        const TraceBoxT             PlayerBox(PlayerBB);
+
+        // Prepare the positions of the players and the traces, which are the same with both broadphases.
+        const BoundingBox3dT WorldBB=WorldModel.GetBoundingBox();
+        const BoundingBox3dT InnerBB(WorldBB.Min-PlayerBB.Min+Vector3dT(2, 2, 2), WorldBB.Max-PlayerBB.Max-Vector3dT(2, 2, 2));
+        RandomT              Random(2);
+        ArrayT<Vector3dT>    PlayerPositions;
+        ArrayT<TraceT>       Traces;
+
+        for (unsigned long PlayerNr=0; PlayerNr<NUM_PLAYERS; PlayerNr++)
+            PlayerPositions.PushBack(Random.Get(InnerBB));
+
+        for (unsigned long TraceNr=0; TraceNr<NumTraces; TraceNr++)
+        {
+            Traces.PushBackEmpty();
+
+            TraceT&         Trace=Traces[Traces.Size()-1];
+            Vector3dT&      Pos  =PlayerPositions[TraceNr % NUM_PLAYERS];
+            const Vector3dT Move(Random.Get(-10.0, 10.0), Random.Get(-10.0, 10.0), Random.Get(-10.0, 10.0));
+
+            Pos=Clamp(Pos+Move, InnerBB);
+
+            Trace.PlayerNr =TraceNr % NUM_PLAYERS;
+            Trace.PlayerPos=Pos;
+            Trace.IsBox    =(TraceNr & 1)!=0;
+            Trace.Start    =Random.Get(InnerBB);
+            Trace.Ray      =Clamp(Trace.Start+Vector3dT(Random.Get(-500.0, 500.0), Random.Get(-500.0, 500.0), Random.Get(-200.0, 200.0)), InnerBB)-Trace.Start;
+            Trace.ClipMask =(TraceNr % 4==0) ? (unsigned long)MaterialT::Clip_Projectiles : (unsigned long)MaterialT::Clip_Players;
+        }
+
+        static const char* BroadphaseNames[2]={ "grid", "tree" };
+        double             UpdateTimes[2];
+        double             TraceTimes[2];
+        TimerT             Timer;
+
+        for (unsigned long BpNr=0; BpNr<2; BpNr++)
+        {
+            ConsoleInterpreter->FindVar("clip_broadphase")->SetValue(BroadphaseNames[BpNr]);
+
+            ClipWorldT          ClipWorld(&WorldModel);
+            ArrayT<ClipModelT*> ClipModels;     // The clip models of the entities, followed by those of the players.
+
+            for (unsigned long ModelNr=0; ModelNr<EntityModels.Size()+NUM_PLAYERS; ModelNr++)
+            {
+                const bool  IsPlayer =(ModelNr>=EntityModels.Size());
+                ClipModelT* ClipModel=new ClipModelT(ClipWorld, IsPlayer ? &PlayerModel : EntityModels[ModelNr]);
+
+                // The entity brushes are in world space, so the entity clip models are at the origin.
+                if (IsPlayer) ClipModel->SetOrigin(PlayerPositions[ModelNr-EntityModels.Size()]);
+
+                ClipModel->Register();
+                ClipModels.PushBack(ClipModel);
+            }
+
+            UpdateTimes[BpNr]=0.0;
+            TraceTimes [BpNr]=0.0;
+
+            ArrayT<ClipModelT*> HitClipModels;
+
+            HitClipModels.PushBackEmptyExact(Traces.Size());
+            Timer.GetSecondsSinceLastCall();
+
+            for (unsigned long TraceNr=0; TraceNr<Traces.Size(); TraceNr++)
+            {
+                TraceT&     Trace =Traces[TraceNr];
+                ClipModelT* Player=ClipModels[EntityModels.Size()+Trace.PlayerNr];
+
+                Player->SetOrigin(Trace.PlayerPos);
+                Player->Register();
+
+                UpdateTimes[BpNr]+=Timer.GetSecondsSinceLastCall();
+
+                Trace.Results[BpNr]=TraceResultT(1.0);
+                HitClipModels[TraceNr]=NULL;
+
+                ClipWorld.TraceConvexSolid(Trace.IsBox ? (const TraceSolidT&)PlayerBox : (const TraceSolidT&)Point,
+                    Trace.Start, Trace.Ray, Trace.ClipMask, NULL, Trace.Results[BpNr], &HitClipModels[TraceNr]);
+
+                TraceTimes[BpNr]+=Timer.GetSecondsSinceLastCall();
+            }
+
+            for (unsigned long TraceNr=0; TraceNr<Traces.Size(); TraceNr++)
+            {
+                Traces[TraceNr].HitModels[BpNr]=NUM_NONE;
+
+                for (unsigned long ModelNr=0; ModelNr<ClipModels.Size(); ModelNr++)
+                    if (HitClipModels[TraceNr]==ClipModels[ModelNr]) Traces[TraceNr].HitModels[BpNr]=ModelNr;
+            }
+
+            for (unsigned long ModelNr=0; ModelNr<ClipModels.Size(); ModelNr++)
+                delete ClipModels[ModelNr];
+        }
+
+        unsigned long NumHits      =0;
+        unsigned long NumTies      =0;
+        unsigned long NumMismatches=0;
+
+        for (unsigned long TraceNr=0; TraceNr<Traces.Size(); TraceNr++)
+        {
+            const TraceT& Trace=Traces[TraceNr];
+
+            if (Trace.Results[0].Fraction<1.0) NumHits++;
+
+            // The impact normal of a trace that started in solid depends on the clip model that it started in.
+            if (Trace.Results[0].Fraction  !=Trace.Results[1].Fraction   ||
+                Trace.Results[0].StartSolid!=Trace.Results[1].StartSolid ||
+                (!Trace.Results[0].StartSolid && Trace.Results[0].ImpactNormal!=Trace.Results[1].ImpactNormal)) NumMismatches++;
+            else if (Trace.HitModels[0]!=Trace.HitModels[1])
+            {
+                // A trace can start in several clip models, or hit several clip models (e.g. adjacent ones) at the same
+                // fraction. The broadphases report the clip models in different order, and which of them is reported
+                // depends on that order, so such ties are not mismatches.
+                NumTies++;
+            }
+        }
+
+        printf("%s  %s: clip world with %lu entities, %lu players, %lu traces (%lu hits, %lu ties), %lu mismatches\n",
+            NumMismatches==0 ? "PASS" : "FAIL", FileName, EntityModels.Size(), NUM_PLAYERS, NumTraces, NumHits, NumTies, NumMismatches);
+
+        for (unsigned long BpNr=0; BpNr<2; BpNr++)
+            printf("      %-4s  update %7.3f us, trace %7.3f us\n",
+                BroadphaseNames[BpNr], UpdateTimes[BpNr]*1000000.0/NumTraces, TraceTimes[BpNr]*1000000.0/NumTraces);
+
+        for (unsigned long ModelNr=0; ModelNr<EntityModels.Size(); ModelNr++)
+            delete EntityModels[ModelNr];
+
+        return NumMismatches==0;
+    }
+
+
+    bool Run(const char* FileName, unsigned long NumQueries)
+    {
+        ArrayT<cf::MapFileEntityT> Entities;
+        ArrayT<ModelT>             Models;
+
+        if (!LoadBrushes(FileName, Entities, Models))
+        {
+            printf("SKIP  %s: could not load the map file.\n", FileName);
+            return true;
+        }
+
+        const unsigned long NumBrushes=Models.Size();
+        BoundingBox3dT      WorldBB;
+
+        for (unsigned long ModelNr=0; ModelNr<NumBrushes; ModelNr++)
+            WorldBB+=Models[ModelNr].BB;
+
+        // Add the players, which are moved around below.
+        // All boxes are kept inside the world, where the grid has its sectors.
+        const BoundingBox3dT PlayerBB(Vector3dT(-16, -16, -36), Vector3dT(16, 16, 36));
+        const BoundingBox3dT InnerBB(WorldBB.Min-PlayerBB.Min, WorldBB.Max-PlayerBB.Max);
+        RandomT              Random(1);
+
+        for (unsigned long PlayerNr=0; PlayerNr<NUM_PLAYERS; PlayerNr++)
+        {
+            const Vector3dT P=Random.Get(InnerBB);
+            ModelT          Model;
+
+            Model.BB       =BoundingBox3dT(P+PlayerBB.Min, P+PlayerBB.Max);
+            Model.Contents =MaterialT::Clip_Players;
+            Model.GridProxy=BroadphaseT::NO_PROXY;
+            Model.TreeProxy=BroadphaseT::NO_PROXY;
+
+            Models.PushBack(Model);
+        }
+
+        // The broadphases never dereference the clip model pointers,
+        // so we use the addresses of the elements of this array as the handles of the models.
+        std::vector<char>     Handles(Models.Size());
+        SectorGridBroadphaseT Grid(WorldBB.GetEpsilonBox(1.0), 64);
+        AabbTreeBroadphaseT   Tree;
+        BroadphaseT*          Broadphases[2]={ &Grid, &Tree };
+        double                InsertTimes[2];
+        double                UpdateTimes[2];
+        double                QueryTimes[2];
+        unsigned long         NumFound[2];
+        TimerT                Timer;
+
+        for (unsigned long BpNr=0; BpNr<2; BpNr++)
+        {
+            Timer.GetSecondsSinceLastCall();
+
+            for (unsigned long ModelNr=0; ModelNr<Models.Size(); ModelNr++)
+            {
+                ModelT&             Model=Models[ModelNr];
+                const unsigned long Proxy=Broadphases[BpNr]->Insert((ClipModelT*)&Handles[ModelNr], Model.BB, Model.Contents);
+
+                if (BpNr==0) Model.GridProxy=Proxy; else Model.TreeProxy=Proxy;
+            }
+
+            InsertTimes[BpNr]=Timer.GetSecondsSinceLastCall();
+            UpdateTimes[BpNr]=0.0;
+            QueryTimes [BpNr]=0.0;
+            NumFound   [BpNr]=0;
+        }
+
+        // Each query is preceded by a small move of one of the players, as in a running game.
+        ArrayT<ClipModelT*> Candidates;
+        unsigned long       NumMismatches=0;
+
+        for (unsigned long QueryNr=0; QueryNr<NumQueries; QueryNr++)
+        {
+            ModelT&         Player=Models[NumBrushes + QueryNr % NUM_PLAYERS];
+            const Vector3dT Move(Random.Get(-10.0, 10.0), Random.Get(-10.0, 10.0), Random.Get(-10.0, 10.0));
+            const Vector3dT P=Clamp(Player.BB.Min-PlayerBB.Min+Move, InnerBB);
+
+            Player.BB=BoundingBox3dT(P+PlayerBB.Min, P+PlayerBB.Max);
+
+            // Half of the queries are for player-sized boxes, the other half for the boxes of traces.
+            const Vector3dT      Start=Random.Get(InnerBB);
+            const Vector3dT      End  =Clamp(Start+Vector3dT(Random.Get(-500.0, 500.0), Random.Get(-500.0, 500.0), Random.Get(-200.0, 200.0)), WorldBB);
+            const BoundingBox3dT QueryBB=(QueryNr & 1) ? BoundingBox3dT(Start+PlayerBB.Min, Start+PlayerBB.Max) : BoundingBox3dT(Start, End);
+            const unsigned long  ContentMask=(QueryNr % 4==0) ? (unsigned long)MaterialT::Clip_Projectiles : (unsigned long)MaterialT::Clip_Players;
+            std::vector<unsigned long> Found[2];
+
+            for (unsigned long BpNr=0; BpNr<2; BpNr++)
+            {
+                Timer.GetSecondsSinceLastCall();
+
+                if (BpNr==0) Player.GridProxy=Grid.Update(Player.GridProxy, Player.BB, Player.Contents);
+                        else Player.TreeProxy=Tree.Update(Player.TreeProxy, Player.BB, Player.Contents);
+
+                UpdateTimes[BpNr]+=Timer.GetSecondsSinceLastCall();
+
+                Candidates.Overwrite();
+                Broadphases[BpNr]->Query(QueryBB, ContentMask, Candidates);
+
+                QueryTimes[BpNr]+=Timer.GetSecondsSinceLastCall();
+                NumFound  [BpNr]+=Candidates.Size();
+
+                Found[BpNr]=GetExact(Candidates, Models, &Handles[0], QueryBB, ContentMask);
+            }
+
+            if (Found[0]!=Found[1]) NumMismatches++;
+        }
+
+        printf("%s  %s: %lu brushes, %lu players, %lu queries, %lu mismatches\n",
+            NumMismatches==0 ? "PASS" : "FAIL", FileName, NumBrushes, NUM_PLAYERS, NumQueries, NumMismatches);
+
+        for (unsigned long BpNr=0; BpNr<2; BpNr++)
+            printf("      %-4s  insert %8.3f ms, update %7.3f us, query %7.3f us, %7.1f candidates per query\n",
+                Broadphases[BpNr]->GetName(), InsertTimes[BpNr]*1000.0, UpdateTimes[BpNr]*1000000.0/NumQueries,
+                QueryTimes[BpNr]*1000000.0/NumQueries, double(NumFound[BpNr])/NumQueries);
+
+        for (unsigned long ModelNr=0; ModelNr<Models.Size(); ModelNr++)
+        {
+            Grid.Remove(Models[ModelNr].GridProxy);
+            Tree.Remove(Models[ModelNr].TreeProxy);
+        }
+
+        // The traces through the clip worlds are much more expensive than the broadphase queries, so there are fewer of them.
+        const bool ClipWorldPassed=RunClipWorld(FileName, Entities, std::max(NumQueries/10, 1ul));
+
+        return NumMismatches==0 && ClipWorldPassed;
+    }
+}
+
+
+int main(int ArgC, const char* ArgV[])
+{
+    const unsigned long NumQueries=ArgC>1 ? strtoul(ArgV[1], NULL, 10) : 100000;
+
+    if (NumQueries<1)
+    {
+        printf("The number of queries must be at least 1.\n");
+        return 1;
+    }
+
+    // The console interpreter is needed for setting the clip_broadphase console variable.
+    ConsoleInterpreterImplT ConInterpreterImpl;
+
+    ConsoleInterpreter=&ConInterpreterImpl;
+    ConVarT::RegisterStaticList();
+
+    cf::FileSys::FileMan->MountFileSystem(cf::FileSys::FS_TYPE_LOCAL_PATH, "./", "");
+
+    static MaterialManagerImplT MatManImpl;
+
+    MaterialManager=&MatManImpl;
+    MaterialManager->RegisterMaterialScriptsInDir("Games/DeathMatch/Materials", "Games/DeathMatch/");
+
+    static const char* DefaultMaps[]=
+    {
+        "Games/DeathMatch/Maps/AEonsCanyonTower.cmap",
+        "Games/DeathMatch/Maps/BPWxBeta.cmap",
+        "Games/DeathMatch/Maps/Gotham.cmap",
+        "Games/DeathMatch/Maps/JrBaseHQ.cmap",
+        "Games/DeathMatch/Maps/Kidney.cmap",
+        "Games/DeathMatch/Maps/ReNoElixir.cmap",
+    };
+
+    bool Passed=true;
+
+    if (ArgC>2)
+    {
+        for (int ArgNr=2; ArgNr<ArgC; ArgNr++)
+            if (!Run(ArgV[ArgNr], NumQueries)) Passed=false;
+    }
+    else
+    {
+        for (unsigned long MapNr=0; MapNr<sizeof(DefaultMaps)/sizeof(DefaultMaps[0]); MapNr++)
+            if (!Run(DefaultMaps[MapNr], NumQueries)) Passed=false;
+    }
+
+    // Make sure that no ConVarT dtor accesses the console interpreter after it has been destroyed.
+    ConsoleInterpreter=NULL;
+
+    return Passed ? 0 : 1;
+}
@@ -0,0 +1,360 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/************************/
+/*** Job System Tests ***/
+/************************/
+
+// This program checks the cf::Jobs::JobSystemT class with several numbers of threads:
+//   - that ParallelFor() calls its function exactly once for each index, also when the loops are nested,
+//     and that the ParallelFor() over an ArrayT passes the right elements,
+//   - that ParallelReduce() yields the same result as the serial reduction, bit for bit, for any number of threads,
+//   - that jobs never run before the jobs that they depend on are done,
+//   - that exceptions in jobs and in loop iterations are re-thrown in the waiting thread,
+//   - that the scratch arenas of concurrent jobs do not overlap, and that they are reset when a job has run.
+// The tests also pass on machines with a single CPU core, where the threads still run concurrently by time-slicing.
+//
+// Usage: JobSystem
+// The exit code is 0 if all checks passed, 1 otherwise.
+
+#include "Jobs/JobSystem.hpp"
+#include "Templates/Array.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+
+using namespace cf::Jobs;
+
+
+namespace
+{
+    // A simple deterministic random number generator, so that runs are reproducible across platforms.
+    struct RandomT
+    {
+        RandomT(unsigned long Seed) : State((Seed*2654435761u+1) & 0xFFFFFFFF) { }
+
+        unsigned long Get(unsigned long Max)
+        {
+            State=(State*1103515245u+12345u) & 0xFFFFFFFF;
+            return ((State >> 8) & 0xFFFFFF) % Max;
+        }
+
+        unsigned long State;
+    };
+
+
+    /// Keeps the calling thread busy for a moment, so that other threads get a chance to run concurrently.
+    unsigned long Spin(unsigned long Count)
+    {
+        volatile unsigned long x=0;
+
+        for (unsigned long i=0; i<Count; i++) x+=i;
+
+        return x;
+    }
+
+
+    unsigned long TestParallelFor(JobSystemT& Jobs)
+    {
+        const unsigned int Counts[]={ 0, 1, 2, 3, 7, 64, 1000, 100000 };
+        unsigned long      NumErrors=0;
+
+        for (unsigned int CountNr=0; CountNr<sizeof(Counts)/sizeof(Counts[0]); CountNr++)
+        {
+            const unsigned int                       Count=Counts[CountNr];
+            std::vector< std::atomic<unsigned int> > Calls(Count);
+
+            for (unsigned int i=0; i<Count; i++) Calls[i]=0;
+
+            Jobs.ParallelFor(Count, [&Calls](unsigned int i) { Calls[i]++; });
+
+            for (unsigned int i=0; i<Count; i++)
+                if (Calls[i]!=1) NumErrors++;
+        }
+
+        // Nested loops, whose inner iterations are spread over all threads as well.
+        std::atomic<unsigned long> Sum(0);
+
+        Jobs.ParallelFor(50, [&Jobs, &Sum](unsigned int i)
+        {
+            Jobs.ParallelFor(i, [&Sum](unsigned int j) { Sum+=j+1; Spin(100); }, "Inner");
+        }, "Outer");
+
+        // The sum of 1+2+...+i for i in [0, 50).
+        unsigned long Expected=0;
+        for (unsigned long i=0; i<50; i++) Expected+=i*(i+1)/2;
+        if (Sum!=Expected) NumErrors++;
+
+        // The ParallelFor() over an ArrayT.
+        ArrayT<unsigned long> Array;
+
+        for (unsigned long i=0; i<5000; i++) Array.PushBack(0);
+
+        ParallelFor(Jobs, Array, [](unsigned long& Elem, unsigned int i) { Elem=3*i+1; });
+
+        for (unsigned long i=0; i<Array.Size(); i++)
+            if (Array[i]!=3*i+1) NumErrors++;
+
+        return NumErrors;
+    }
+
+
+    unsigned long TestParallelReduce(JobSystemT& Jobs)
+    {
+        const unsigned long GrainSizes[]={ 1, 7, 256, 100000 };
+        RandomT             Random(1);
+        ArrayT<double>      Values;
+        unsigned long       NumErrors=0;
+
+        // Values of very different magnitudes, so that the sum depends on the order of the additions.
+        for (unsigned long i=0; i<20000; i++)
+            Values.PushBack(double(Random.Get(1000000)) * (Random.Get(4)==0 ? 1.0e12 : 1.0e-3) * (Random.Get(2) ? 1.0 : -1.0));
+
+        const auto Map    =[](double v) { return v*1.5; };
+        const auto Combine=[](double a, double b) { return a+b; };
+
+        for (unsigned int GrainNr=0; GrainNr<sizeof(GrainSizes)/sizeof(GrainSizes[0]); GrainNr++)
+        {
+            const unsigned long GrainSize=GrainSizes[GrainNr];
+
+            // The serial reduction: the chunks are summed in order, and then their sums.
+            double Expected=0.0;
+
+            for (unsigned long First=0; First<Values.Size(); First+=GrainSize)
+            {
+                double ChunkSum=0.0;
+
+                for (unsigned long i=First; i<Values.Size() && i<First+GrainSize; i++)
+                    ChunkSum=Combine(ChunkSum, Map(Values[i]));
+
+                Expected=Combine(Expected, ChunkSum);
+            }
+
+            if (ParallelReduce(Jobs, Values, 0.0, Map, Combine, GrainSize)!=Expected) NumErrors++;
+        }
+
+        // An exact reduction of integers, and the reduction of an empty array.
+        ArrayT<unsigned long> Numbers;
+
+        for (unsigned long i=1; i<=10000; i++) Numbers.PushBack(i);
+
+        if (ParallelReduce(Jobs, Numbers, 0ul, [](unsigned long n) { return n*n; }, [](unsigned long a, unsigned long b) { return a+b; }, 100)!=10000ul*10001ul*20001ul/6) NumErrors++;
+        if (ParallelReduce(Jobs, ArrayT<unsigned long>(), 7ul, [](unsigned long n) { return n; }, [](unsigned long a, unsigned long b) { return a+b; })!=7) NumErrors++;
+
+        return NumErrors;
+    }
+
+
+    unsigned long TestDependencies(JobSystemT& Jobs)
+    {
+        const unsigned long             NUM_JOBS=500;
+        RandomT                         Random(2);
+        std::atomic<unsigned long>      NextSeqNr(0);
+        std::atomic<unsigned long>      NumViolations(0);
+        std::vector<unsigned long>      SeqNrs(NUM_JOBS, 0);
+        ArrayT<JobPtrT>                 AllJobs;
+        ArrayT< ArrayT<unsigned long> > AllDeps;
+
+        // A random graph of jobs, each depending on up to four earlier jobs, including a long chain through all jobs.
+        for (unsigned long JobNr=0; JobNr<NUM_JOBS; JobNr++)
+        {
+            ArrayT<JobPtrT>       Deps;
+            ArrayT<unsigned long> DepNrs;
+
+            if (JobNr>0)
+            {
+                Deps.PushBack(AllJobs[JobNr-1]);
+                DepNrs.PushBack(JobNr-1);
+
+                for (unsigned long k=Random.Get(4); k>0; k--)
+                {
+                    const unsigned long DepNr=Random.Get(JobNr);
+
+                    Deps.PushBack(AllJobs[DepNr]);
+                    DepNrs.PushBack(DepNr);
+                }
+            }
+
+            AllJobs.PushBack(Jobs.Submit("Dependent", [Deps, JobNr, &SeqNrs, &NextSeqNr, &NumViolations]()
+            {
+                for (unsigned long DepNr=0; DepNr<Deps.Size(); DepNr++)
+                    if (!Deps[DepNr]->IsDone()) NumViolations++;
+
+                Spin(1000);
+                SeqNrs[JobNr]=NextSeqNr++;
+            }, Deps));
+
+            AllDeps.PushBack(DepNrs);
+        }
+
+        Jobs.Wait(AllJobs[NUM_JOBS-1]);
+
+        unsigned long NumErrors=NumViolations;
+
+        for (unsigned long JobNr=0; JobNr<NUM_JOBS; JobNr++)
+        {
+            if (!AllJobs[JobNr]->IsDone()) NumErrors++;
+
+            for (unsigned long DepNr=0; DepNr<AllDeps[JobNr].Size(); DepNr++)
+                if (SeqNrs[AllDeps[JobNr][DepNr]]>=SeqNrs[JobNr]) NumErrors++;
+        }
+
+        // A job that depends on a job that is already done, and jobs that submit and wait for other jobs.
+        ArrayT<JobPtrT> Done;
+        Done.PushBack(AllJobs[0]);
+
+        std::atomic<unsigned int> NumChildren(0);
+
+        JobPtrT Parent=Jobs.Submit("Parent", [&Jobs, &NumChildren]()
+        {
+            ArrayT<JobPtrT> Children;
+
+            for (unsigned int i=0; i<8; i++)
+                Children.PushBack(Jobs.Submit("Child", [&NumChildren]() { Spin(1000); NumChildren++; }));
+
+            ArrayT<JobPtrT> Last;
+            Last.PushBack(Jobs.Submit("Last", [&NumChildren]() { if (NumChildren!=8) throw std::runtime_error("child not done"); }, Children));
+
+            Jobs.Wait(Last[0]);
+        }, Done);
+
+        try
+        {
+            Jobs.Wait(Parent);
+        }
+        catch (const std::exception&)
+        {
+            NumErrors++;
+        }
+
+        return NumErrors;
+    }
+
+
+    unsigned long TestExceptions(JobSystemT& Jobs)
+    {
+        unsigned long NumErrors=0;
+
+        // The exception of a job is re-thrown by Wait().
+        try
+        {
+            Jobs.Wait(Jobs.Submit("Throw", []() { throw std::runtime_error("job"); }));
+            NumErrors++;
+        }
+        catch (const std::runtime_error&) { }
+
+        // An exception in an iteration of a loop is re-thrown after all other iterations have been made.
+        std::atomic<unsigned int> NumCalls(0);
+
+        try
+        {
+            Jobs.ParallelFor(1000, [&NumCalls](unsigned int i)
+            {
+                NumCalls++;
+                if (i==37) throw std::runtime_error("iteration");
+            });
+
+            NumErrors++;
+        }
+        catch (const std::runtime_error&) { }
+
+        if (NumCalls!=1000) NumErrors++;
+
+        return NumErrors;
+    }
+
+
+    unsigned long TestScratch(JobSystemT& Jobs)
+    {
+        std::atomic<unsigned long> NumErrors(0);
+
+        // The memory that concurrent jobs and loop iterations allocate must not overlap.
+        Jobs.ParallelFor(2000, [&Jobs, &NumErrors](unsigned int i)
+        {
+            const unsigned long Count=1+(i*7919) % 5000;
+            uint32_t*           Data =GetScratch().AllocArray<uint32_t>(Count);
+
+            if (uintptr_t(Data) % alignof(uint32_t)!=0) NumErrors++;
+
+            for (unsigned long k=0; k<Count; k++) Data[k]=i;
+
+            // A nested loop, whose iterations allocate from the arena of this thread as well
+            // (if they run in this thread), and may release their memory when they are done.
+            Jobs.ParallelFor(4, [&NumErrors](unsigned int j)
+            {
+                unsigned char* Bytes=static_cast<unsigned char*>(GetScratch().Alloc(1000+j, 64));
+
+                if (uintptr_t(Bytes) % 64!=0) NumErrors++;
+                for (unsigned int k=0; k<1000+j; k++) Bytes[k]=0xAB;
+                Spin(500);
+            }, "InnerScratch");
+
+            Spin(1000);
+
+            for (unsigned long k=0; k<Count; k++)
+                if (Data[k]!=i) { NumErrors++; break; }
+        }, "Scratch");
+
+        // The arena of the calling thread is reset after each job that runs in it.
+        const ScratchArenaT::MarkT Before=GetScratch().GetMark();
+
+        Jobs.Wait(Jobs.Submit("Alloc", []() { GetScratch().Alloc(100000); }));
+
+        const ScratchArenaT::MarkT After=GetScratch().GetMark();
+
+        if (Before.BlockNr!=After.BlockNr || Before.Used!=After.Used) NumErrors++;
+
+        // Release() makes the memory available again.
+        ScratchArenaT              Arena;
+        const ScratchArenaT::MarkT Mark=Arena.GetMark();
+        void*                      First=Arena.Alloc(1000, 32);
+
+        Arena.Alloc(200000);
+        Arena.Release(Mark);
+
+        if (Arena.Alloc(1000, 32)!=First) NumErrors++;
+
+        return NumErrors;
+    }
+}
+
+
+int main(int ArgC, const char* ArgV[])
+{
+    const unsigned int ThreadCounts[]={ 1, 2, 4, 8 };
+    unsigned long      NumErrors=0;
+    JobSystemT         Jobs;
+
+    for (unsigned int CountNr=0; CountNr<sizeof(ThreadCounts)/sizeof(ThreadCounts[0]); CountNr++)
+    {
+        Jobs.SetNumThreads(ThreadCounts[CountNr]);
+
+        if (Jobs.GetNumThreads()!=ThreadCounts[CountNr]) NumErrors++;
+
+        const unsigned long Results[]=
+        {
+            TestParallelFor(Jobs),
+            TestParallelReduce(Jobs),
+            TestDependencies(Jobs),
+            TestExceptions(Jobs),
+            TestScratch(Jobs)
+        };
+
+        const char* Names[]={ "ParallelFor", "ParallelReduce", "Dependencies", "Exceptions", "Scratch" };
+
+        for (unsigned int TestNr=0; TestNr<sizeof(Results)/sizeof(Results[0]); TestNr++)
+        {
+            printf("%s  %-16s %u thread(s), %lu errors\n", Results[TestNr]==0 ? "PASS" : "FAIL", Names[TestNr], ThreadCounts[CountNr], Results[TestNr]);
+            NumErrors+=Results[TestNr];
+        }
+    }
+
+    return NumErrors==0 ? 0 : 1;
+}
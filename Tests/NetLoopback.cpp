@@ -0,0 +1,251 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/********************************************/
+/*** GameProtocol2T Loopback Test Harness ***/
+/********************************************/
+
+// This program connects two GameProtocol2T instances through a simulated network link that drops, delays and
+// reorders packets, sends bursts of small and large reliable messages in both directions, and checks that each
+// side receives exactly the messages that the other side has sent, each exactly once and in order.
+//
+// Usage: NetLoopback [LossPercent [Latency [Seed]]]
+// Without arguments, a set of standard configurations is run.
+// The exit code is 0 if all runs passed, 1 otherwise.
+
+#include "Network/Network.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    const unsigned long NUM_TICKS      =20000;  ///< The number of ticks (packets per side) of each run.
+    const unsigned long NUM_SEND_TICKS = 1500;  ///< The number of ticks in which new reliable messages are queued.
+
+    // A simple deterministic random number generator, so that runs are reproducible across platforms.
+    struct RandomT
+    {
+        RandomT(unsigned long Seed) : State((Seed*2654435761u+1) & 0xFFFFFFFF) { }
+
+        unsigned long Get(unsigned long Max)
+        {
+            State=(State*1103515245u+12345u) & 0xFFFFFFFF;
+            return ((State >> 8) & 0xFFFFFF) % Max;
+        }
+
+        unsigned long State;
+    };
+
+    /// A packet on the simulated link.
+    struct PacketT
+    {
+        unsigned long Due;  ///< The tick at which the packet arrives.
+        ArrayT<char>  Data; ///< The contents of the packet.
+    };
+
+    /// One side of the connection.
+    struct PeerT
+    {
+        GameProtocol2T           Protocol;
+        std::vector<std::string> Sent;      ///< The reliable messages that this side has sent.
+        std::vector<std::string> Received;  ///< The reliable messages that this side has received.
+        ArrayT<PacketT>          Wire;      ///< The packets that this side has sent and that have not yet arrived.
+        unsigned long            NumUnreliable;
+        bool                     IsCorrupt;
+    };
+
+    PeerT* CurrentReceiver=NULL;
+
+
+    void ProcessPayload(NetDataT& Payload, unsigned long /*LastIncomingSequenceNr*/)
+    {
+        while (Payload.ReadPos < Payload.Data.Size())
+        {
+            const char Type=Payload.ReadByte();
+
+            if (Type=='R')
+            {
+                const unsigned long Length=Payload.ReadLong();
+                std::string         Message;
+
+                for (unsigned long i=0; i<Length; i++)
+                    Message+=Payload.ReadByte();
+
+                CurrentReceiver->Received.push_back(Message);
+            }
+            else if (Type=='U')
+            {
+                Payload.ReadLong();
+                CurrentReceiver->NumUnreliable++;
+            }
+            else
+            {
+                CurrentReceiver->IsCorrupt=true;
+                return;
+            }
+        }
+    }
+
+
+    bool Run(unsigned long LossPercent, unsigned long Latency, unsigned long Seed)
+    {
+        RandomT Random(Seed);
+        PeerT   Peers[2];
+
+        for (unsigned long PeerNr=0; PeerNr<2; PeerNr++)
+        {
+            Peers[PeerNr].NumUnreliable=0;
+            Peers[PeerNr].IsCorrupt    =false;
+        }
+
+        for (unsigned long Tick=0; Tick<NUM_TICKS; Tick++)
+        {
+            // Have each side send a packet.
+            for (unsigned long PeerNr=0; PeerNr<2; PeerNr++)
+            {
+                PeerT&                 Peer=Peers[PeerNr];
+                ArrayT< ArrayT<char> > ReliableDatas;
+
+                if (Tick<NUM_SEND_TICKS && Random.Get(3)==0)
+                {
+                    const unsigned long NumMsgs=Random.Get(5);
+
+                    for (unsigned long MsgNr=0; MsgNr<NumMsgs; MsgNr++)
+                    {
+                        // Most messages are small, but some span many fragments.
+                        const unsigned long Length=(Random.Get(10)==0) ? Random.Get(20000) : Random.Get(300);
+                        std::string         Message;
+                        NetDataT            Data;
+
+                        for (unsigned long i=0; i<Length; i++)
+                            Message+=char('a'+Random.Get(26));
+
+                        Data.WriteByte('R');
+                        Data.WriteLong(Length);
+
+                        for (unsigned long i=0; i<Length; i++)
+                            Data.WriteByte(Message[i]);
+
+                        Peer.Sent.push_back(Message);
+                        ReliableDatas.PushBack(Data.Data);
+                    }
+                }
+
+                NetDataT Unreliable;
+
+                Unreliable.WriteByte('U');
+                Unreliable.WriteLong(Tick);
+
+                const NetDataT& OutData=Peer.Protocol.GetTransmitData(ReliableDatas, Unreliable.Data);
+
+                if (Random.Get(100) >= LossPercent)
+                {
+                    PacketT Packet;
+
+                    // The random delay reorders the packets.
+                    Packet.Due =Tick + Latency + Random.Get(Latency+1);
+                    Packet.Data=OutData.Data;
+
+                    Peer.Wire.PushBack(Packet);
+                }
+            }
+
+            // Deliver the packets that are due.
+            for (unsigned long PeerNr=0; PeerNr<2; PeerNr++)
+            {
+                PeerT& Peer=Peers[PeerNr];
+
+                for (unsigned long PacketNr=0; PacketNr<Peer.Wire.Size(); PacketNr++)
+                {
+                    if (Peer.Wire[PacketNr].Due > Tick) continue;
+
+                    NetDataT InData;
+
+                    InData.Data=Peer.Wire[PacketNr].Data;
+                    CurrentReceiver=&Peers[1-PeerNr];
+                    CurrentReceiver->Protocol.ProcessIncomingMessage(InData, ProcessPayload);
+
+                    Peer.Wire.RemoveAt(PacketNr);
+                    PacketNr--;
+                }
+            }
+        }
+
+        bool Passed=true;
+
+        for (unsigned long PeerNr=0; PeerNr<2; PeerNr++)
+        {
+            const PeerT& Sender  =Peers[PeerNr];
+            const PeerT& Receiver=Peers[1-PeerNr];
+
+            if (Receiver.IsCorrupt)
+            {
+                printf("    peer %lu: received a corrupt payload\n", 1-PeerNr);
+                Passed=false;
+            }
+
+            if (Receiver.Received!=Sender.Sent)
+            {
+                printf("    peer %lu: sent %lu reliable messages, peer %lu received %lu (or in a different order)\n",
+                    PeerNr, (unsigned long)Sender.Sent.size(), 1-PeerNr, (unsigned long)Receiver.Received.size());
+                Passed=false;
+            }
+
+            if (Sender.Protocol.GetNumUnackedFragments()!=0)
+            {
+                printf("    peer %lu: %lu fragments still unacknowledged\n", PeerNr, Sender.Protocol.GetNumUnackedFragments());
+                Passed=false;
+            }
+        }
+
+        printf("%s  loss %2lu%%, latency %2lu..%2lu ticks, seed %lu: %lu and %lu reliable messages, %lu and %lu unreliable parts received\n",
+            Passed ? "PASS" : "FAIL", LossPercent, Latency, 2*Latency, Seed,
+            (unsigned long)Peers[1].Received.size(), (unsigned long)Peers[0].Received.size(),
+            Peers[1].NumUnreliable, Peers[0].NumUnreliable);
+
+        return Passed;
+    }
+}
+
+
+int main(int ArgC, const char* ArgV[])
+{
+    if (ArgC>1)
+    {
+        const unsigned long LossPercent=strtoul(ArgV[1], NULL, 10);
+        const unsigned long Latency    =ArgC>2 ? strtoul(ArgV[2], NULL, 10) : 10;
+        const unsigned long Seed       =ArgC>3 ? strtoul(ArgV[3], NULL, 10) : 1;
+
+        if (LossPercent>=100)
+        {
+            printf("The loss rate must be less than 100 percent.\n");
+            return 1;
+        }
+
+        return Run(LossPercent, Latency, Seed) ? 0 : 1;
+    }
+
+    static const unsigned long Configs[][3]=
+    {
+        // Loss, latency, seed.
+        {  0,  0, 1 },
+        {  0, 10, 2 },
+        { 20, 10, 3 },
+        { 50,  5, 4 },
+        { 70, 20, 5 },
+    };
+
+    bool Passed=true;
+
+    for (unsigned long ConfigNr=0; ConfigNr<sizeof(Configs)/sizeof(Configs[0]); ConfigNr++)
+        if (!Run(Configs[ConfigNr][0], Configs[ConfigNr][1], Configs[ConfigNr][2])) Passed=false;
+
+    return Passed ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/**************************/
+/*** CaPVS Threads Test ***/
+/**************************/
+
+// This program checks that CaPVS computes a PVS with several threads that is as conservative as the one that it computes
+// with a single thread: It runs the given CaPVS program on two copies of a world, once with one thread and once with
+// several, loads both worlds and compares the PVS of their BSP trees.
+// With several threads, CaPVS may find a few more pairs of leaves mutually visible than with one: The portal flow test
+// from one SuperLeaf to another doesn't always agree with the test in the opposite direction, and with several threads,
+// both directions can be tested when neither SuperLeaf has been completed yet. Such extra pairs are harmless and only
+// reported, but a pair of leaves that is visible with one thread and not with several is an error, because the engine
+// would cull visible geometry.
+//
+// Usage: PVSThreads CaPVS Path/WorldName.cw [NumThreads [CaPVSOptions ...]]
+// CaPVS is the path of the CaPVS program, and the world must have been compiled with CaBSP (but not necessarily with
+// CaPVS) and be in the "Worlds" directory of its game. Run it from the Cafu top-level directory. NumThreads is the
+// number of threads for the second run (default 4). The CaPVSOptions are passed to both runs, e.g. "-minAreaSL 1e7"
+// for fewer SuperLeaves and thus quicker runs.
+// The exit code is 0 if all pairs of leaves that are visible with one thread are visible with several, 1 otherwise.
+
+#include "ConsoleCommands/Console.hpp"
+#include "ConsoleCommands/ConsoleInterpreter.hpp"
+#include "ConsoleCommands/ConsoleStdout.hpp"
+#include "FileSys/FileManImpl.hpp"
+#include "GuiSys/GuiResources.hpp"
+#include "MaterialSystem/MaterialManager.hpp"
+#include "MaterialSystem/MaterialManagerImpl.hpp"
+#include "Models/ModelManager.hpp"
+#include "SceneGraph/BspTreeNode.hpp"
+#include "ClipSys/CollisionModelMan_impl.hpp"
+
+#include "../Common/World.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+
+static cf::ConsoleStdoutT ConsoleStdout;
+cf::ConsoleI* Console=&ConsoleStdout;
+
+static cf::FileSys::FileManImplT FileManImpl;
+cf::FileSys::FileManI* cf::FileSys::FileMan=&FileManImpl;
+
+static cf::ClipSys::CollModelManImplT CCM;
+cf::ClipSys::CollModelManI* cf::ClipSys::CollModelMan=&CCM;
+
+ConsoleInterpreterI* ConsoleInterpreter=NULL;
+MaterialManagerI*    MaterialManager   =NULL;
+
+
+namespace
+{
+    // Copies the file Src to Dest.
+    bool CopyFile(const std::string& Src, const std::string& Dest)
+    {
+        FILE* In =fopen(Src.c_str(), "rb");
+        FILE* Out=In ? fopen(Dest.c_str(), "wb") : NULL;
+        bool  Ok =(Out!=NULL);
+        char  Buffer[64*1024];
+
+        while (Ok)
+        {
+            const size_t Count=fread(Buffer, 1, sizeof(Buffer), In);
+
+            if (Count==0) break;
+            Ok=fwrite(Buffer, 1, Count, Out)==Count;
+        }
+
+        if (In ) fclose(In);
+        if (Out) Ok=(fclose(Out)==0) && Ok;
+
+        return Ok;
+    }
+
+
+    // Runs CaPVS with the given number of threads on a copy of WorldName and returns the file name of the copy, or "" on failure.
+    std::string RunCaPVS(const std::string& CaPVS, const std::string& WorldName, unsigned long NumThreads, const std::string& Options)
+    {
+        char Suffix[32];
+        sprintf(Suffix, "_pvs_t%lu.cw", NumThreads);
+
+        const std::string CopyName=WorldName.substr(0, WorldName.length()-3)+Suffix;
+
+        if (!CopyFile(WorldName, CopyName))
+        {
+            printf("Could not copy \"%s\" to \"%s\".\n", WorldName.c_str(), CopyName.c_str());
+            return "";
+        }
+
+        char ThreadsOption[32];
+        sprintf(ThreadsOption, " -threads %lu -checkpoint 0", NumThreads);
+
+        const std::string Command="\""+CaPVS+"\" \""+CopyName+"\""+ThreadsOption+Options;
+
+        printf("%s\n", Command.c_str());
+        fflush(stdout);
+
+        if (system(Command.c_str())!=0)
+        {
+            printf("CaPVS failed.\n");
+            remove(CopyName.c_str());
+            return "";
+        }
+
+        return CopyName;
+    }
+
+
+    // Returns whether leaf L2 is in the PVS of leaf L1.
+    bool IsVisible(const cf::SceneGraph::BspTreeNodeT& BspTree, unsigned long L1, unsigned long L2)
+    {
+        const unsigned long PVSTotalBitNr=L1*BspTree.Leaves.Size()+L2;
+
+        return ((BspTree.PVS[PVSTotalBitNr >> 5] >> (PVSTotalBitNr & 31)) & 1)!=0;
+    }
+}
+
+
+int main(int ArgC, const char* ArgV[])
+{
+    if (ArgC<3)
+    {
+        printf("Usage: PVSThreads CaPVS Path/WorldName.cw [NumThreads [CaPVSOptions ...]]\n");
+        return 1;
+    }
+
+    const std::string   CaPVS     =ArgV[1];
+    const std::string   WorldName =ArgV[2];
+    const unsigned long NumThreads=ArgC>3 ? strtoul(ArgV[3], NULL, 10) : 4;
+    std::string         Options;
+
+    for (int ArgNr=4; ArgNr<ArgC; ArgNr++)
+        Options+=std::string(" ")+ArgV[ArgNr];
+
+    if (NumThreads<2)
+    {
+        printf("The number of threads must be at least 2.\n");
+        return 1;
+    }
+
+    cf::FileSys::FileMan->MountFileSystem(cf::FileSys::FS_TYPE_LOCAL_PATH, "./", "");
+
+    // Determine the game directory like CaPVS does, assuming that the world file is in "Worlds".
+    const size_t      i            =WorldName.find_last_of("/\\");
+    const std::string GameDirectory=WorldName.substr(0, i==std::string::npos ? 0 : i)+"/..";
+
+    static MaterialManagerImplT MatManImpl;
+
+    MaterialManager=&MatManImpl;
+    MaterialManager->RegisterMaterialScriptsInDir(GameDirectory+"/Materials", GameDirectory+"/");
+
+    // Compute the PVS of two copies of the world, first with one thread, then with several.
+    const std::string Name1=RunCaPVS(CaPVS, WorldName, 1, Options);
+    const std::string NameN=Name1.empty() ? "" : RunCaPVS(CaPVS, WorldName, NumThreads, Options);
+
+    if (NameN.empty())
+    {
+        if (!Name1.empty()) remove(Name1.c_str());
+        return 1;
+    }
+
+    unsigned long NumLeaves =0;
+    unsigned long NumVisible=0;     // The number of ordered pairs of leaves that are visible with one thread.
+    unsigned long NumMissing=0;     // The number of those that are not visible with several threads.
+    unsigned long NumExtra  =0;     // The number of ordered pairs of leaves that are only visible with several threads.
+
+    try
+    {
+        ModelManagerT             ModelMan;
+        cf::GuiSys::GuiResourcesT GuiRes(ModelMan);
+        WorldT                    World1(Name1.c_str(), ModelMan, GuiRes, NULL, false);
+        WorldT                    WorldN(NameN.c_str(), ModelMan, GuiRes, NULL, false);
+
+        const cf::SceneGraph::BspTreeNodeT& BspTree1=*World1.m_StaticEntityData[0]->m_BspTree;
+        const cf::SceneGraph::BspTreeNodeT& BspTreeN=*WorldN.m_StaticEntityData[0]->m_BspTree;
+
+        if (BspTree1.Leaves.Size()!=BspTreeN.Leaves.Size())
+        {
+            printf("FAIL  The BSP trees have %lu and %lu leaves.\n", BspTree1.Leaves.Size(), BspTreeN.Leaves.Size());
+            NumMissing++;
+        }
+        else
+        {
+            NumLeaves=BspTree1.Leaves.Size();
+
+            for (unsigned long L1=0; L1<NumLeaves; L1++)
+                for (unsigned long L2=0; L2<NumLeaves; L2++)
+                {
+                    const bool Visible1=IsVisible(BspTree1, L1, L2);
+                    const bool VisibleN=IsVisible(BspTreeN, L1, L2);
+
+                    if (Visible1) NumVisible++;
+                    if (Visible1 && !VisibleN) NumMissing++;
+                    if (!Visible1 && VisibleN) NumExtra++;
+                }
+        }
+    }
+    catch (const WorldT::LoadErrorT& E)
+    {
+        printf("FAIL  Could not load the worlds: %s\n", E.Msg);
+        NumMissing++;
+    }
+
+    remove(Name1.c_str());
+    remove(NameN.c_str());
+
+    printf("%s  %s: %lu leaves, %lu visible pairs with 1 thread, with %lu threads %lu missing and %lu extra\n",
+        NumMissing==0 ? "PASS" : "FAIL", WorldName.c_str(), NumLeaves, NumVisible, NumThreads, NumMissing, NumExtra);
+
+    return NumMissing==0 ? 0 : 1;
+}
@@ -0,0 +1,381 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/*****************************/
+/*** Render Commands Tests ***/
+/*****************************/
+
+// This program checks the MatSys::RenderCommandListT without a GPU: it renders a number of scenes with the Null
+// renderer, once directly and once recorded via a MatSys::RecordingRendererT and replayed from the optimized list.
+// For each scene, it checks the number of batches that the meshes are merged into, the draw calls and vertices that
+// the Null renderer counts for the replay, and that the replay restores the state of the renderer. It also checks
+// that a replay without Optimize() renders the meshes as recorded, and that a list that is cleared and recorded
+// again yields the same results.
+//
+// Usage: RenderCommands
+// The exit code is 0 if all checks passed, 1 otherwise.
+
+#include "ConsoleCommands/Console.hpp"
+#include "ConsoleCommands/ConsoleStdout.hpp"
+#include "FileSys/FileManImpl.hpp"
+#include "MaterialSystem/Material.hpp"
+#include "MaterialSystem/Mesh.hpp"
+#include "MaterialSystem/RecordingRenderer.hpp"
+#include "MaterialSystem/RenderCommandList.hpp"
+#include "MaterialSystem/RendererNull/RendererImpl.hpp"
+#include "MaterialSystem/TextureMap.hpp"
+
+#include <stdio.h>
+
+
+static cf::ConsoleStdoutT ConsoleStdout;
+cf::ConsoleI* Console=&ConsoleStdout;
+
+static cf::FileSys::FileManImplT FileManImpl;
+cf::FileSys::FileManI* cf::FileSys::FileMan=&FileManImpl;
+
+
+using namespace MatSys;
+
+
+namespace
+{
+    /// A lightmap. The Null renderer and the render command list only compare the pointers to lightmaps.
+    class LightMapT : public TextureMapI
+    {
+        public:
+
+        unsigned int GetSizeX() { return 16; }
+        unsigned int GetSizeY() { return 16; }
+    };
+
+
+    /// The materials and lightmaps that the scenes are rendered with.
+    struct SceneDataT
+    {
+        RenderMaterialT* Opaque[3];
+        RenderMaterialT* Translucent;
+        RenderMaterialT* Wireframe;
+        LightMapT        LightMaps[2];
+    };
+
+
+    /// A scene that is rendered with the given renderer, and the results that the render command list is expected to have for it.
+    struct SceneT
+    {
+        const char*   Name;
+        void          (*Render)(RendererI& Renderer, SceneDataT& Data);
+        unsigned long NumBatches;       ///< The expected number of batches after Optimize().
+        unsigned long NumVertices;      ///< The expected number of vertices in the batches after Optimize().
+    };
+
+
+    // Returns a mesh of the given type with the given number of vertices.
+    MeshT MakeMesh(MeshT::TypeT Type, unsigned long NumVertices)
+    {
+        MeshT Mesh(Type);
+
+        for (unsigned long VertexNr=0; VertexNr<NumVertices; VertexNr++)
+        {
+            Mesh.Vertices.PushBackEmpty();
+            Mesh.Vertices[VertexNr].SetOrigin(double(VertexNr), double(VertexNr % 3), 0.0);
+        }
+
+        return Mesh;
+    }
+
+
+    // 60 triangle meshes with three opaque materials and two lightmaps, in an order that changes the state with every mesh.
+    void RenderOpaque(RendererI& Renderer, SceneDataT& Data)
+    {
+        Renderer.SetCurrentRenderAction(RendererI::AMBIENT);
+
+        for (unsigned int MeshNr=0; MeshNr<60; MeshNr++)
+        {
+            Renderer.SetCurrentMaterial(Data.Opaque[MeshNr % 3]);
+            Renderer.SetCurrentLightMap(&Data.LightMaps[MeshNr % 2]);
+            Renderer.RenderMesh(MakeMesh(MeshT::Triangles, 6));
+        }
+    }
+
+
+    // Three groups of opaque meshes, separated by translucent meshes that no other mesh must be moved across.
+    void RenderTranslucent(RendererI& Renderer, SceneDataT& Data)
+    {
+        Renderer.SetCurrentRenderAction(RendererI::AMBIENT);
+
+        for (unsigned int GroupNr=0; GroupNr<3; GroupNr++)
+        {
+            if (GroupNr>0)
+            {
+                Renderer.SetCurrentMaterial(Data.Translucent);
+                Renderer.RenderMesh(MakeMesh(MeshT::Triangles, 3));
+            }
+
+            for (unsigned int MeshNr=0; MeshNr<10; MeshNr++)
+            {
+                Renderer.SetCurrentMaterial(Data.Opaque[MeshNr % 3]);
+                Renderer.RenderMesh(MakeMesh(MeshT::Triangles, 3));
+            }
+        }
+    }
+
+
+    // Meshes in the ambient, stencil shadow and lighting actions, which must not be moved across the calls to SetCurrentRenderAction().
+    void RenderActions(RendererI& Renderer, SceneDataT& Data)
+    {
+        Renderer.SetCurrentRenderAction(RendererI::AMBIENT);
+
+        for (unsigned int MeshNr=0; MeshNr<12; MeshNr++)
+        {
+            Renderer.SetCurrentMaterial(Data.Opaque[MeshNr % 3]);
+            Renderer.RenderMesh(MakeMesh(MeshT::Triangles, 3));
+        }
+
+        Renderer.SetCurrentRenderAction(RendererI::STENCILSHADOW);
+
+        for (unsigned int MeshNr=0; MeshNr<4; MeshNr++)
+        {
+            Renderer.SetCurrentMaterial(Data.Opaque[0]);
+            Renderer.RenderMesh(MakeMesh(MeshT::Triangles, 3));
+        }
+
+        Renderer.SetCurrentRenderAction(RendererI::LIGHTING);
+
+        for (unsigned int MeshNr=0; MeshNr<12; MeshNr++)
+        {
+            Renderer.SetCurrentMaterial(Data.Opaque[MeshNr % 3]);
+            Renderer.RenderMesh(MakeMesh(MeshT::Triangles, 3));
+        }
+
+        Renderer.SetCurrentRenderAction(RendererI::AMBIENT);
+    }
+
+
+    // Meshes of all types with the same material: the triangle types are merged into a list of triangles,
+    // the lines and the points into lists of their own, and the line strip is rendered as it is.
+    void RenderPrimitives(RendererI& Renderer, SceneDataT& Data)
+    {
+        Renderer.SetCurrentRenderAction(RendererI::AMBIENT);
+        Renderer.SetCurrentMaterial(Data.Opaque[0]);
+
+        Renderer.RenderMesh(MakeMesh(MeshT::Triangles,     6));     // 2 triangles
+        Renderer.RenderMesh(MakeMesh(MeshT::TriangleStrip, 5));     // 3 triangles
+        Renderer.RenderMesh(MakeMesh(MeshT::TriangleFan,   5));     // 3 triangles
+        Renderer.RenderMesh(MakeMesh(MeshT::Quads,         8));     // 4 triangles
+        Renderer.RenderMesh(MakeMesh(MeshT::QuadStrip,     6));     // 4 triangles
+        Renderer.RenderMesh(MakeMesh(MeshT::Polygon,       5));     // 3 triangles
+        Renderer.RenderMesh(MakeMesh(MeshT::Lines,         4));
+        Renderer.RenderMesh(MakeMesh(MeshT::Lines,         4));
+        Renderer.RenderMesh(MakeMesh(MeshT::Points,        3));
+        Renderer.RenderMesh(MakeMesh(MeshT::LineStrip,     4));
+    }
+
+
+    // Meshes with a wire-frame material, which are never merged.
+    void RenderWireframe(RendererI& Renderer, SceneDataT& Data)
+    {
+        Renderer.SetCurrentRenderAction(RendererI::AMBIENT);
+        Renderer.SetCurrentMaterial(Data.Wireframe);
+
+        for (unsigned int MeshNr=0; MeshNr<5; MeshNr++)
+            Renderer.RenderMesh(MakeMesh(MeshT::Triangles, 3));
+    }
+
+
+    // Two blocks of meshes with different rendering parameters, each with two materials.
+    void RenderParams(RendererI& Renderer, SceneDataT& Data)
+    {
+        Renderer.SetCurrentRenderAction(RendererI::AMBIENT);
+
+        for (unsigned int BlockNr=0; BlockNr<2; BlockNr++)
+        {
+            Renderer.SetCurrentAmbientLightColor(1.0f, 0.5f*BlockNr, 0.0f);
+            Renderer.SetGenPurposeRenderingParam(0, int(BlockNr));
+
+            for (unsigned int MeshNr=0; MeshNr<8; MeshNr++)
+            {
+                Renderer.SetCurrentMaterial(Data.Opaque[MeshNr % 2]);
+                Renderer.RenderMesh(MakeMesh(MeshT::Triangles, 3));
+            }
+        }
+    }
+
+
+    const SceneT Scenes[]=
+    {
+        { "Opaque",      RenderOpaque,       6, 360 },
+        { "Translucent", RenderTranslucent, 11,  96 },
+        { "Actions",     RenderActions,      7,  84 },
+        { "Primitives",  RenderPrimitives,   4,  72 },
+        { "Wireframe",   RenderWireframe,    5,  15 },
+        { "Params",      RenderParams,       4,  48 }
+    };
+
+    const unsigned int NUM_SCENES=sizeof(Scenes)/sizeof(Scenes[0]);
+
+
+    /// The state of the renderer that RenderCommandListT::Replay() must restore.
+    struct StateT
+    {
+        StateT(const RendererI& Renderer)
+            : RenderAction(Renderer.GetCurrentRenderAction()),
+              Material(Renderer.GetCurrentMaterial()),
+              GenPurposeI(Renderer.GetGenPurposeRenderingParamI(0)),
+              GenPurposeF(Renderer.GetGenPurposeRenderingParamF(0))
+        {
+            const float* c=Renderer.GetCurrentAmbientLightColor();
+
+            AmbientLightColor[0]=c[0];
+            AmbientLightColor[1]=c[1];
+            AmbientLightColor[2]=c[2];
+        }
+
+        bool operator == (const StateT& Other) const
+        {
+            return RenderAction        ==Other.RenderAction         &&
+                   Material            ==Other.Material             &&
+                   GenPurposeI         ==Other.GenPurposeI          &&
+                   GenPurposeF         ==Other.GenPurposeF          &&
+                   AmbientLightColor[0]==Other.AmbientLightColor[0] &&
+                   AmbientLightColor[1]==Other.AmbientLightColor[1] &&
+                   AmbientLightColor[2]==Other.AmbientLightColor[2];
+        }
+
+        RendererI::RenderActionT RenderAction;
+        RenderMaterialT*         Material;
+        int                      GenPurposeI;
+        float                    GenPurposeF;
+        float                    AmbientLightColor[3];
+    };
+
+
+    // Puts the renderer into a state that differs from the state that the scenes leave it in.
+    void ResetState(RendererI& Renderer, SceneDataT& Data)
+    {
+        Renderer.SetCurrentRenderAction(RendererI::LIGHTING);
+        Renderer.SetCurrentMaterial(Data.Opaque[2]);
+        Renderer.SetCurrentAmbientLightColor(0.25f, 0.25f, 0.25f);
+        Renderer.SetGenPurposeRenderingParam(0, 7);
+        Renderer.SetGenPurposeRenderingParam(0, 7.0f);
+    }
+
+
+    // Records the given scene into List, optimizes the list if Optimize is true, and replays it.
+    // Returns the number of failed checks.
+    unsigned long RecordAndReplay(RendererI& Null, SceneDataT& Data, const SceneT& Scene, RenderCommandListT& List, bool Optimize,
+                                  const RendererI::StatsT& Direct, RendererI::StatsT& Replayed)
+    {
+        unsigned long NumFailed=0;
+
+        ResetState(Null, Data);
+        List.Clear();
+
+        {
+            RecordingRendererT Recorder(Null, List);
+
+            Scene.Render(Recorder, Data);
+        }
+
+        if (Optimize) List.Optimize(Null);
+
+        ResetState(Null, Data);
+
+        const StateT Before(Null);
+
+        Null.BeginFrame(0.0);
+        List.Replay(Null);
+        Replayed=Null.GetStats();
+
+        if (!(StateT(Null)==Before))
+        {
+            printf("  %s: the replay did not restore the state of the renderer\n", Scene.Name);
+            NumFailed++;
+        }
+
+        const unsigned long NumBatches =Optimize ? Scene.NumBatches  : Direct.NumDrawCalls;
+        const unsigned long NumVertices=Optimize ? Scene.NumVertices : Direct.NumVertices;
+
+        if (List.GetNumCommands()!=Direct.NumDrawCalls || List.GetNumBatches()!=NumBatches)
+        {
+            printf("  %s: %lu commands and %lu batches, expected %lu and %lu\n", Scene.Name, List.GetNumCommands(), List.GetNumBatches(), Direct.NumDrawCalls, NumBatches);
+            NumFailed++;
+        }
+
+        if (Replayed.NumDrawCalls!=NumBatches || Replayed.NumVertices!=NumVertices)
+        {
+            printf("  %s: replayed %lu draw calls with %lu vertices, expected %lu and %lu\n", Scene.Name, Replayed.NumDrawCalls, Replayed.NumVertices, NumBatches, NumVertices);
+            NumFailed++;
+        }
+
+        return NumFailed;
+    }
+}
+
+
+int main()
+{
+    RendererImplT& Null=RendererImplT::GetInstance();
+    MaterialT      OpaqueMats[3];
+    MaterialT      TranslucentMat;
+    MaterialT      WireframeMat;
+    SceneDataT     Data;
+
+    TranslucentMat.BlendFactorSrc=MaterialT::SrcAlpha;
+    TranslucentMat.BlendFactorDst=MaterialT::OneMinusSrcAlpha;
+    WireframeMat.PolygonMode     =MaterialT::Wireframe;
+
+    for (unsigned int MatNr=0; MatNr<3; MatNr++)
+        Data.Opaque[MatNr]=Null.RegisterMaterial(&OpaqueMats[MatNr]);
+
+    Data.Translucent=Null.RegisterMaterial(&TranslucentMat);
+    Data.Wireframe  =Null.RegisterMaterial(&WireframeMat);
+
+    RenderCommandListT List;
+    unsigned long      NumErrors=0;
+
+    for (unsigned int SceneNr=0; SceneNr<NUM_SCENES; SceneNr++)
+    {
+        const SceneT& Scene=Scenes[SceneNr];
+
+        // Render the scene directly.
+        ResetState(Null, Data);
+        Null.BeginFrame(0.0);
+        Scene.Render(Null, Data);
+
+        const RendererI::StatsT Direct=Null.GetStats();
+
+        // Record and replay it as recorded, optimized, and optimized again after List.Clear().
+        RendererI::StatsT Unoptimized;
+        RendererI::StatsT Optimized;
+        RendererI::StatsT Again;
+        unsigned long     NumFailed=0;
+
+        NumFailed+=RecordAndReplay(Null, Data, Scene, List, false, Direct, Unoptimized);
+        NumFailed+=RecordAndReplay(Null, Data, Scene, List, true,  Direct, Optimized);
+        NumFailed+=RecordAndReplay(Null, Data, Scene, List, true,  Direct, Again);
+
+        if (Again.NumDrawCalls!=Optimized.NumDrawCalls || Again.NumStateChanges!=Optimized.NumStateChanges || Again.NumVertices!=Optimized.NumVertices)
+        {
+            printf("  %s: the results changed after clearing the list\n", Scene.Name);
+            NumFailed++;
+        }
+
+        printf("%s  %-12s direct %3lu draw calls, %3lu state changes; replayed %3lu draw calls, %3lu state changes\n", NumFailed==0 ? "PASS" : "FAIL",
+            Scene.Name, Direct.NumDrawCalls, Direct.NumStateChanges, Optimized.NumDrawCalls, Optimized.NumStateChanges);
+
+        NumErrors+=NumFailed;
+    }
+
+    for (unsigned int MatNr=0; MatNr<3; MatNr++)
+        Null.FreeMaterial(Data.Opaque[MatNr]);
+
+    Null.FreeMaterial(Data.Translucent);
+    Null.FreeMaterial(Data.Wireframe);
+
+    printf("%s\n", NumErrors==0 ? "PASS" : "FAIL");
+    return NumErrors==0 ? 0 : 1;
+}
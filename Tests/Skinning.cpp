@@ -0,0 +1,294 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/**************************/
+/*** Skinning Benchmark ***/
+/**************************/
+
+// This program loads the player models of the DeathMatch game and computes an AnimPoseT for every frame of every
+// animation sequence. It checks the skinned vertex positions against a reference implementation, which is the
+// straightforward per-vertex loop over the weights with MatrixT::Mul_xyz1() that AnimPoseT used before its
+// skinning kernel, and measures how long AnimPoseT::ComputeCache() and the reference take for the poses.
+// It also checks that a pose that is told to recache with SetNeedsRecache() computes the same results again.
+//
+// Usage: Skinning [NumRuns [ModelFile ...]]
+// Run it from the Cafu top-level directory. NumRuns is the number of runs over all poses (default 10).
+// Without model files, the player models of the DeathMatch game are used.
+// The exit code is 0 if all positions matched their references, 1 otherwise.
+
+#include "ConsoleCommands/Console.hpp"
+#include "ConsoleCommands/ConsoleStdout.hpp"
+#include "FileSys/FileManImpl.hpp"
+#include "MaterialSystem/MaterialManager.hpp"
+#include "Models/AnimExpr.hpp"
+#include "Models/AnimPose.hpp"
+#include "Models/Loader_cmdl.hpp"
+#include "Models/Model_cmdl.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static cf::ConsoleStdoutT ConsoleStdout;
+cf::ConsoleI* Console=&ConsoleStdout;
+
+static cf::FileSys::FileManImplT FileManImpl;
+cf::FileSys::FileManI* cf::FileSys::FileMan=&FileManImpl;
+
+MaterialManagerI* MaterialManager=NULL;
+
+
+namespace
+{
+    const char* PlayerModels[]=
+    {
+        "Games/DeathMatch/Models/Players/Alien/Alien.cmdl",
+        "Games/DeathMatch/Models/Players/James/James.cmdl",
+        "Games/DeathMatch/Models/Players/Punisher/Punisher.cmdl",
+        "Games/DeathMatch/Models/Players/Sentinel/Sentinel.cmdl",
+        "Games/DeathMatch/Models/Players/Skeleton/Skeleton.cmdl",
+        "Games/DeathMatch/Models/Players/T801/T801.cmdl",
+        "Games/DeathMatch/Models/Players/Trinity/Trinity.cmdl"
+    };
+
+    const unsigned int NUM_PLAYER_MODELS=sizeof(PlayerModels)/sizeof(PlayerModels[0]);
+
+    /// The largest acceptable difference between a skinned position and its reference, relative to the size of the position.
+    /// The positions of vertices with several weights differ by float rounding in the order of the summation.
+    const float MAX_REL_ERROR=1.0e-5f;
+
+
+    // The reference implementation: computes the positions of all vertices of all meshes of Model for the given joint matrices.
+    void RefSkin(const CafuModelT& Model, const ArrayT<MatrixT>& JointMatrices, ArrayT< ArrayT<Vector3fT> >& Positions)
+    {
+        typedef CafuModelT::MeshT MeshT;
+
+        const ArrayT<MeshT>& Meshes=Model.GetMeshes();
+
+        if (Positions.Size()!=Meshes.Size())
+        {
+            Positions.Overwrite();
+            Positions.PushBackEmptyExact(Meshes.Size());
+        }
+
+        for (unsigned long MeshNr=0; MeshNr<Meshes.Size(); MeshNr++)
+        {
+            const MeshT&       Mesh=Meshes[MeshNr];
+            ArrayT<Vector3fT>& Pos =Positions[MeshNr];
+
+            if (Pos.Size()!=Mesh.Vertices.Size())
+            {
+                Pos.Overwrite();
+                Pos.PushBackEmptyExact(Mesh.Vertices.Size());
+            }
+
+            for (unsigned long VertexNr=0; VertexNr<Mesh.Vertices.Size(); VertexNr++)
+            {
+                const MeshT::VertexT& Vertex=Mesh.Vertices[VertexNr];
+
+                if (Vertex.GeoDups.Size()>0 && Vertex.GeoDups[0]<VertexNr)
+                {
+                    Pos[VertexNr]=Pos[Vertex.GeoDups[0]];
+                    continue;
+                }
+
+                if (Vertex.NumWeights==1)
+                {
+                    const MeshT::WeightT& Weight=Mesh.Weights[Vertex.FirstWeightIdx];
+
+                    Pos[VertexNr]=JointMatrices[Weight.JointIdx].Mul_xyz1(Weight.Pos);
+                }
+                else
+                {
+                    Pos[VertexNr]=Vector3fT(0.0f, 0.0f, 0.0f);
+
+                    for (unsigned int WeightNr=0; WeightNr<Vertex.NumWeights; WeightNr++)
+                    {
+                        const MeshT::WeightT& Weight=Mesh.Weights[Vertex.FirstWeightIdx+WeightNr];
+
+                        Pos[VertexNr]+=JointMatrices[Weight.JointIdx].Mul_xyz1(Weight.Pos) * Weight.Weight;
+                    }
+                }
+            }
+        }
+    }
+
+
+    // Returns the number of vertex positions of the given mesh infos that differ from Positions by more than MAX_REL_ERROR.
+    // If Exact is true, the positions must match bit for bit.
+    unsigned long CountMismatches(const ArrayT<AnimPoseT::MeshInfoT>& MeshInfos, const ArrayT< ArrayT<Vector3fT> >& Positions, bool Exact, double& MaxRelError)
+    {
+        unsigned long Count=0;
+
+        for (unsigned long MeshNr=0; MeshNr<MeshInfos.Size(); MeshNr++)
+            for (unsigned long VertexNr=0; VertexNr<MeshInfos[MeshNr].Vertices.Size(); VertexNr++)
+            {
+                const Vector3fT& A=MeshInfos[MeshNr].Vertices[VertexNr].Pos;
+                const Vector3fT& B=Positions[MeshNr][VertexNr];
+
+                if (Exact)
+                {
+                    if (A.x!=B.x || A.y!=B.y || A.z!=B.z) Count++;
+                    continue;
+                }
+
+                const double RelError=length(A-B)/std::max(1.0f, length(B));
+
+                if (RelError>MaxRelError) MaxRelError=RelError;
+                if (RelError>MAX_REL_ERROR) Count++;
+            }
+
+        return Count;
+    }
+
+
+    // Copies the vertex positions of the given mesh infos into Positions.
+    void GetPositions(const ArrayT<AnimPoseT::MeshInfoT>& MeshInfos, ArrayT< ArrayT<Vector3fT> >& Positions)
+    {
+        Positions.Overwrite();
+        Positions.PushBackEmptyExact(MeshInfos.Size());
+
+        for (unsigned long MeshNr=0; MeshNr<MeshInfos.Size(); MeshNr++)
+        {
+            Positions[MeshNr].Overwrite();
+
+            for (unsigned long VertexNr=0; VertexNr<MeshInfos[MeshNr].Vertices.Size(); VertexNr++)
+                Positions[MeshNr].PushBack(MeshInfos[MeshNr].Vertices[VertexNr].Pos);
+        }
+    }
+}
+
+
+int main(int ArgC, const char* ArgV[])
+{
+    const unsigned int NumRuns=(ArgC>1) ? (unsigned int)strtoul(ArgV[1], NULL, 10) : 10;
+
+    ArrayT<std::string> FileNames;
+
+    for (int ArgNr=2; ArgNr<ArgC; ArgNr++)
+        FileNames.PushBack(ArgV[ArgNr]);
+
+    if (FileNames.Size()==0)
+        for (unsigned int ModelNr=0; ModelNr<NUM_PLAYER_MODELS; ModelNr++)
+            FileNames.PushBack(PlayerModels[ModelNr]);
+
+    unsigned long NumErrors=0;
+    double        TotalNew  =0.0;
+    double        TotalRef  =0.0;
+
+    for (unsigned long FileNr=0; FileNr<FileNames.Size(); FileNr++)
+    {
+        CafuModelT* Model=NULL;
+
+        try
+        {
+            LoaderCafuT Loader(FileNames[FileNr]);
+
+            Model=new CafuModelT(Loader);
+        }
+        catch (const ModelLoaderT::LoadErrorT& LE)
+        {
+            printf("FAIL  %s: %s\n", FileNames[FileNr].c_str(), LE.what());
+            NumErrors++;
+            continue;
+        }
+
+        // The poses are the bind pose and every frame of every animation sequence.
+        ArrayT< IntrusivePtrT<AnimExprStandardT> > AnimExprs;
+
+        AnimExprs.PushBack(Model->GetAnimExprPool().GetStandard(-1, 0.0f));
+
+        for (unsigned long SequNr=0; SequNr<Model->GetAnims().Size(); SequNr++)
+            for (unsigned long FrameNr=0; FrameNr<Model->GetAnims()[SequNr].Frames.Size(); FrameNr++)
+                AnimExprs.PushBack(Model->GetAnimExprPool().GetStandard(SequNr, float(FrameNr)));
+
+        unsigned long NumVertices=0;
+        unsigned long NumWeights =0;
+
+        for (unsigned long MeshNr=0; MeshNr<Model->GetMeshes().Size(); MeshNr++)
+        {
+            NumVertices+=Model->GetMeshes()[MeshNr].Vertices.Size();
+            NumWeights +=Model->GetMeshes()[MeshNr].Weights.Size();
+        }
+
+        // The pose must be destroyed before the model.
+        {
+            // Check the results of the poses against the reference.
+            AnimPoseT                      Pose(*Model, AnimExprs[0]);
+            ArrayT< ArrayT<Vector3fT> >    RefPositions;
+            ArrayT< ArrayT<Vector3fT> >    Positions;
+            unsigned long                  NumMismatches=0;
+            unsigned long                  NumRecacheMismatches=0;
+            double                         MaxRelError=0.0;
+
+            for (unsigned long ExprNr=0; ExprNr<AnimExprs.Size(); ExprNr++)
+            {
+                Pose.SetAnimExpr(AnimExprs[ExprNr]);
+
+                RefSkin(*Model, Pose.GetJointMatrices(), RefPositions);
+                NumMismatches+=CountMismatches(Pose.GetMeshInfos(), RefPositions, false, MaxRelError);
+
+                GetPositions(Pose.GetMeshInfos(), Positions);
+                Pose.SetNeedsRecache();
+                NumRecacheMismatches+=CountMismatches(Pose.GetMeshInfos(), Positions, true, MaxRelError);
+            }
+
+            const bool IsOK=(NumMismatches==0 && NumRecacheMismatches==0);
+
+            printf("%s  %s: %lu meshes, %lu vertices, %lu weights, %lu joints, %lu poses\n", IsOK ? "PASS" : "FAIL", FileNames[FileNr].c_str(),
+                Model->GetMeshes().Size(), NumVertices, NumWeights, Model->GetJoints().Size(), AnimExprs.Size());
+            printf("      %lu mismatches, %lu mismatches after SetNeedsRecache(), max. relative error %g\n", NumMismatches, NumRecacheMismatches, MaxRelError);
+
+            if (!IsOK) NumErrors++;
+
+            // Measure the time for all poses.
+            double New=0.0;
+            double Ref=0.0;
+
+            for (unsigned int RunNr=0; RunNr<NumRuns; RunNr++)
+            {
+                for (unsigned long ExprNr=0; ExprNr<AnimExprs.Size(); ExprNr++)
+                {
+                    Pose.SetAnimExpr(AnimExprs[ExprNr]);
+
+                    const std::chrono::steady_clock::time_point Start=std::chrono::steady_clock::now();
+                    Pose.ComputeCache();
+                    New+=std::chrono::duration<double>(std::chrono::steady_clock::now()-Start).count();
+                }
+
+                for (unsigned long ExprNr=0; ExprNr<AnimExprs.Size(); ExprNr++)
+                {
+                    Pose.SetAnimExpr(AnimExprs[ExprNr]);
+
+                    // Note that GetJointMatrices() recaches the pose, so it must be called outside of the timing.
+                    const ArrayT<MatrixT>& JointMatrices=Pose.GetJointMatrices();
+
+                    const std::chrono::steady_clock::time_point Start=std::chrono::steady_clock::now();
+                    RefSkin(*Model, JointMatrices, RefPositions);
+                    Ref+=std::chrono::duration<double>(std::chrono::steady_clock::now()-Start).count();
+                }
+            }
+
+            const double NumPoses=double(NumRuns)*AnimExprs.Size();
+
+            if (NumRuns>0)
+                printf("      ComputeCache() %7.1f us per pose, reference skinning (positions only) %7.1f us per pose\n", New*1.0e6/NumPoses, Ref*1.0e6/NumPoses);
+
+            TotalNew+=New;
+            TotalRef+=Ref;
+        }
+
+        AnimExprs.Clear();
+        delete Model;
+    }
+
+    printf("\n%lu models, %u runs: ComputeCache() %.1f ms, reference skinning %.1f ms\n", FileNames.Size(), NumRuns, TotalNew*1000.0, TotalRef*1000.0);
+    printf("%s\n", NumErrors==0 ? "PASS" : "FAIL");
+    return NumErrors==0 ? 0 : 1;
+}
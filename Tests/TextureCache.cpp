@@ -0,0 +1,478 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/**************************/
+/*** Texture Cache Test ***/
+/**************************/
+
+// This program checks the TextureCacheT class that the MakeTexCache tool and the texture loader use:
+//   - the DXT1 and DXT5 block encoder against golden blocks, and the decoded blocks against their pixels,
+//   - that building the mipmap chains of a texture yields golden results in all formats,
+//   - that saving and loading a cache file reproduces the levels, also when levels are skipped on loading,
+//   - that a cache file is no longer used as soon as one of its source images changes.
+// The golden results are those of the encoder of cache file version 2. They must only change along with the cache file
+// version, because otherwise, cache files that were baked before would silently disagree with new ones.
+//
+// Usage: TextureCache
+// The source images and cache files are written to and removed from the "TexCacheTest" subdirectory of the current directory.
+// The exit code is 0 if all checks passed, 1 otherwise.
+
+#include "Bitmap/Bitmap.hpp"
+#include "ConsoleCommands/Console.hpp"
+#include "ConsoleCommands/ConsoleStdout.hpp"
+#include "FileSys/FileManImpl.hpp"
+#include "MaterialSystem/Common/TextureCache.hpp"
+#include "MaterialSystem/MapComposition.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <direct.h>
+    #define rmdir _rmdir
+#else
+    #include <sys/stat.h>
+    #include <sys/types.h>
+    #include <unistd.h>
+#endif
+
+
+static cf::ConsoleStdoutT ConsoleStdout;
+cf::ConsoleI* Console=&ConsoleStdout;
+
+static cf::FileSys::FileManImplT FileManImpl;
+cf::FileSys::FileManI* cf::FileSys::FileMan=&FileManImpl;
+
+
+namespace
+{
+    const std::string BASE_DIR="TexCacheTest/";
+
+
+    // A simple deterministic random number generator, so that runs are reproducible across platforms.
+    struct RandomT
+    {
+        RandomT(unsigned long Seed) : State((Seed*2654435761u+1) & 0xFFFFFFFF) { }
+
+        unsigned int Get(unsigned int Max)
+        {
+            State=(State*1103515245u+12345u) & 0xFFFFFFFF;
+            return ((State >> 8) & 0xFFFFFF) % Max;
+        }
+
+        unsigned long State;
+    };
+
+
+    // The 32-bit FNV-1a hash of the given bytes, continuing from the given hash.
+    uint32_t GetHash(const unsigned char* Data, unsigned long Size, uint32_t Hash=2166136261u)
+    {
+        for (unsigned long i=0; i<Size; i++)
+        {
+            Hash^=Data[i];
+            Hash*=16777619u;
+        }
+
+        return Hash;
+    }
+
+
+    // Returns the hash of all levels of all images of the given cache, including their sizes.
+    uint32_t GetHash(const TextureCacheT& Cache)
+    {
+        uint32_t Hash=2166136261u;
+
+        for (unsigned long ImageNr=0; ImageNr<Cache.GetNumImages(); ImageNr++)
+            for (unsigned long LevelNr=0; LevelNr<Cache.GetMipMaps(ImageNr).Size(); LevelNr++)
+            {
+                const TextureCacheT::LevelT& Level=Cache.GetMipMaps(ImageNr)[LevelNr];
+                const unsigned int           Sizes[2]={ Level.SizeX, Level.SizeY };
+
+                Hash=GetHash((const unsigned char*)Sizes, sizeof(Sizes), Hash);
+                Hash=GetHash(&Level.Data[0], Level.Data.Size(), Hash);
+            }
+
+        return Hash;
+    }
+
+
+    // Decodes a DXT1 or DXT5 block to 4x4 RGBA pixels, as the graphics hardware does.
+    void DecodeBlock(const unsigned char* Block, TextureCacheT::FormatT Format, unsigned char Pixels[16*4])
+    {
+        for (unsigned int i=0; i<16; i++) Pixels[i*4+3]=255;
+
+        if (Format==TextureCacheT::DXT5)
+        {
+            int Alphas[8]={ Block[0], Block[1] };
+
+            for (int Index=2; Index<8; Index++)
+                Alphas[Index]=(Block[0]>Block[1]) ? ((8-Index)*Block[0] + (Index-1)*Block[1])/7
+                                                  : (Index<6 ? ((6-Index)*Block[0] + (Index-1)*Block[1])/5 : (Index==6 ? 0 : 255));
+
+            uint64_t Indices=0;
+
+            for (unsigned int i=0; i<6; i++)
+                Indices|=uint64_t(Block[2+i]) << (8*i);
+
+            for (unsigned int i=0; i<16; i++)
+                Pixels[i*4+3]=(unsigned char)Alphas[(Indices >> (3*i)) & 7];
+
+            Block+=8;
+        }
+
+        const unsigned int c565[2]={ Block[0] | (uint32_t(Block[1]) << 8), Block[2] | (uint32_t(Block[3]) << 8) };
+        int                Colors[4][3];
+
+        for (unsigned int ColorNr=0; ColorNr<2; ColorNr++)
+        {
+            const int r=(c565[ColorNr] >> 11) & 0x1F;
+            const int g=(c565[ColorNr] >>  5) & 0x3F;
+            const int b= c565[ColorNr]        & 0x1F;
+
+            Colors[ColorNr][0]=(r << 3) | (r >> 2);
+            Colors[ColorNr][1]=(g << 2) | (g >> 4);
+            Colors[ColorNr][2]=(b << 3) | (b >> 2);
+        }
+
+        for (unsigned int c=0; c<3; c++)
+        {
+            Colors[2][c]=(c565[0]>c565[1]) ? (2*Colors[0][c] + Colors[1][c])/3 : (Colors[0][c] + Colors[1][c])/2;
+            Colors[3][c]=(c565[0]>c565[1]) ? (Colors[0][c] + 2*Colors[1][c])/3 : 0;
+        }
+
+        const uint32_t Indices=Block[4] | (Block[5] << 8) | (Block[6] << 16) | (uint32_t(Block[7]) << 24);
+
+        for (unsigned int i=0; i<16; i++)
+            for (unsigned int c=0; c<3; c++)
+                Pixels[i*4+c]=(unsigned char)Colors[(Indices >> (2*i)) & 3][c];
+    }
+
+
+    /// A block of 4x4 pixels with its golden DXT1 and DXT5 encodings.
+    struct GoldenBlockT
+    {
+        const char*   Name;
+        unsigned char Pixels[16*4];
+        unsigned char DXT1[8];
+        unsigned char DXT5[16];
+        int           MaxError;     ///< The max. difference of a channel of the decoded block to the pixels.
+    };
+
+
+    // Returns the golden blocks.
+    ArrayT<GoldenBlockT> GetGoldenBlocks()
+    {
+        ArrayT<GoldenBlockT> Blocks;
+
+        for (unsigned int BlockNr=0; BlockNr<4; BlockNr++)
+        {
+            Blocks.PushBackEmpty();
+            GoldenBlockT& B=Blocks[BlockNr];
+
+            for (unsigned int i=0; i<16; i++)
+            {
+                unsigned char* P=&B.Pixels[i*4];
+                const unsigned int x=i % 4;
+                const unsigned int y=i / 4;
+
+                switch (BlockNr)
+                {
+                    case 0: B.Name="solid color";    P[0]=200; P[1]=100; P[2]=50; P[3]=255; break;
+                    case 1: B.Name="checkerboard";   P[0]=P[1]=P[2]=((x+y) & 1) ? 0 : 255; P[3]=((x+y) & 1) ? 255 : 0; break;
+                    case 2: B.Name="color gradient"; P[0]=(unsigned char)((x+y)*40); P[1]=(unsigned char)(255-(x+y)*40); P[2]=(unsigned char)(64+(x+y)*20); P[3]=(unsigned char)(255-i*17); break;
+                    case 3: B.Name="alpha gradient"; P[0]=10; P[1]=20; P[2]=30; P[3]=(unsigned char)(i*17); break;
+                }
+            }
+        }
+
+        static const unsigned char Golden[4][24]=
+        {
+            { 0x26, 0xCB, 0x26, 0xCB, 0x00, 0x00, 0x00, 0x00,   0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   0x26, 0xCB, 0x26, 0xCB, 0x00, 0x00, 0x00, 0x00 },
+            { 0x9E, 0xF7, 0x61, 0x08, 0x44, 0x11, 0x44, 0x11,   0xFF, 0x00, 0x41, 0x80, 0x20, 0x41, 0x80, 0x20,   0x9E, 0xF7, 0x61, 0x08, 0x44, 0x11, 0x44, 0x11 },
+            { 0xF6, 0xE0, 0x88, 0x0F, 0xB5, 0xAD, 0x2B, 0x0A,   0xFF, 0x00, 0x80, 0xB4, 0x91, 0xAD, 0xFD, 0x27,   0xF6, 0xE0, 0x88, 0x0F, 0xB5, 0xAD, 0x2B, 0x0A },
+            { 0xA3, 0x08, 0xA3, 0x08, 0x00, 0x00, 0x00, 0x00,   0xFF, 0x00, 0xC9, 0x6F, 0xB7, 0xE4, 0x26, 0x01,   0xA3, 0x08, 0xA3, 0x08, 0x00, 0x00, 0x00, 0x00 },
+        };
+
+        static const int MaxErrors[4]={ 8, 12, 40, 18 };
+
+        for (unsigned int BlockNr=0; BlockNr<4; BlockNr++)
+        {
+            memcpy(Blocks[BlockNr].DXT1, &Golden[BlockNr][0],  8);
+            memcpy(Blocks[BlockNr].DXT5, &Golden[BlockNr][8], 16);
+            Blocks[BlockNr].MaxError=MaxErrors[BlockNr];
+        }
+
+        return Blocks;
+    }
+
+
+    // Returns the max. difference of the color channels (and the alpha channel if WithAlpha is true) of the given pixels.
+    int GetMaxError(const unsigned char* Pixels1, const unsigned char* Pixels2, bool WithAlpha)
+    {
+        int MaxError=0;
+
+        for (unsigned int i=0; i<16; i++)
+            for (unsigned int c=0; c<(WithAlpha ? 4u : 3u); c++)
+                MaxError=std::max(MaxError, abs(int(Pixels1[i*4+c]) - int(Pixels2[i*4+c])));
+
+        return MaxError;
+    }
+
+
+    // Checks the block encoder against the golden blocks and returns the number of errors.
+    unsigned long CheckBlocks()
+    {
+        const ArrayT<GoldenBlockT> Blocks=GetGoldenBlocks();
+        unsigned long              NumErrors=0;
+
+        for (unsigned long BlockNr=0; BlockNr<Blocks.Size(); BlockNr++)
+        {
+            const GoldenBlockT& B=Blocks[BlockNr];
+            unsigned char       DXT1[8];
+            unsigned char       DXT5[16];
+            unsigned char       Decoded1[16*4];
+            unsigned char       Decoded5[16*4];
+
+            TextureCacheT::CompressBlock(B.Pixels, TextureCacheT::DXT1, DXT1);
+            TextureCacheT::CompressBlock(B.Pixels, TextureCacheT::DXT5, DXT5);
+
+            DecodeBlock(DXT1, TextureCacheT::DXT1, Decoded1);
+            DecodeBlock(DXT5, TextureCacheT::DXT5, Decoded5);
+
+            const bool Golden1=memcmp(DXT1, B.DXT1, 8)==0;
+            const bool Golden5=memcmp(DXT5, B.DXT5, 16)==0;
+            const int  Error1 =GetMaxError(B.Pixels, Decoded1, false);
+            const int  Error5 =GetMaxError(B.Pixels, Decoded5, true);
+            const bool Passed =Golden1 && Golden5 && Error1<=B.MaxError && Error5<=B.MaxError;
+
+            printf("%s  block %-15s DXT1 %s, max. error %2i; DXT5 %s, max. error %2i\n", Passed ? "PASS" : "FAIL",
+                B.Name, Golden1 ? "golden" : "differs", Error1, Golden5 ? "golden" : "differs", Error5);
+
+            if (!Passed)
+            {
+                printf("      DXT1");
+                for (unsigned int i=0; i<8; i++) printf(" 0x%02X,", DXT1[i]);
+                printf("\n      DXT5");
+                for (unsigned int i=0; i<16; i++) printf(" 0x%02X,", DXT5[i]);
+                printf("\n");
+
+                NumErrors++;
+            }
+        }
+
+        // Many random blocks, whose encodings are only checked by their combined hash.
+        RandomT  Random(1);
+        uint32_t Hash=2166136261u;
+
+        for (unsigned long BlockNr=0; BlockNr<10000; BlockNr++)
+        {
+            unsigned char Pixels[16*4];
+            unsigned char Block[16];
+
+            // Every other block is made of few colors, as is typical for textures.
+            for (unsigned int i=0; i<16*4; i++)
+                Pixels[i]=(unsigned char)((BlockNr & 1) ? Random.Get(256) : Random.Get(3)*127);
+
+            TextureCacheT::CompressBlock(Pixels, (BlockNr % 3==0) ? TextureCacheT::DXT1 : TextureCacheT::DXT5, Block);
+            Hash=GetHash(Block, (BlockNr % 3==0) ? 8 : 16, Hash);
+        }
+
+        const uint32_t GOLDEN_HASH=0x825ADF4F;
+
+        printf("%s  10000 random blocks, hash 0x%08X\n", Hash==GOLDEN_HASH ? "PASS" : "FAIL", Hash);
+        if (Hash!=GOLDEN_HASH) NumErrors++;
+
+        return NumErrors;
+    }
+
+
+    bool MakeDirectory(const std::string& DirName)
+    {
+#ifdef _WIN32
+        return _mkdir(DirName.c_str())==0 || errno==EEXIST;
+#else
+        return mkdir(DirName.c_str(), 0755)==0 || errno==EEXIST;
+#endif
+    }
+
+
+    // Writes an opaque BMP source image of the given size with a pattern that depends on Seed.
+    bool WriteSourceImage(const std::string& FileName, unsigned int SizeX, unsigned int SizeY, unsigned long Seed)
+    {
+        RandomT Random(Seed);
+        BitmapT Image(SizeX, SizeY);
+
+        // Smooth gradients with some noise, so that the blocks are neither trivial nor random.
+        // Some pixels are pure blue, which the "blue2alpha" map composition makes transparent.
+        for (unsigned int y=0; y<SizeY; y++)
+            for (unsigned int x=0; x<SizeX; x++)
+                if ((x*7 + y*3) % 11==0)
+                    Image.SetPixel(x, y, 0, 0, 255);
+                else
+                    Image.SetPixel(x, y, int((x*255)/SizeX), int((y*255)/SizeY), int(((x+y)*4 + Random.Get(32)) & 0xFF));
+
+        return Image.SaveToDisk(FileName.c_str());
+    }
+
+
+    // Returns whether the levels of the two caches are equal.
+    bool AreEqual(const TextureCacheT& Cache1, const TextureCacheT& Cache2)
+    {
+        if (Cache1.GetFormat()!=Cache2.GetFormat()) return false;
+        if (Cache1.GetNumImages()!=Cache2.GetNumImages()) return false;
+
+        for (unsigned long ImageNr=0; ImageNr<Cache1.GetNumImages(); ImageNr++)
+        {
+            if (Cache1.GetMipMaps(ImageNr).Size()!=Cache2.GetMipMaps(ImageNr).Size()) return false;
+
+            for (unsigned long LevelNr=0; LevelNr<Cache1.GetMipMaps(ImageNr).Size(); LevelNr++)
+            {
+                const TextureCacheT::LevelT& L1=Cache1.GetMipMaps(ImageNr)[LevelNr];
+                const TextureCacheT::LevelT& L2=Cache2.GetMipMaps(ImageNr)[LevelNr];
+
+                if (L1.SizeX!=L2.SizeX || L1.SizeY!=L2.SizeY || L1.Data.Size()!=L2.Data.Size()) return false;
+                if (memcmp(&L1.Data[0], &L2.Data[0], L1.Data.Size())!=0) return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    // Prints a PASS or FAIL line and returns 1 for a failed check, 0 otherwise.
+    unsigned long Check(bool Passed, const std::string& What)
+    {
+        printf("%s  %s\n", Passed ? "PASS" : "FAIL", What.c_str());
+        return Passed ? 0 : 1;
+    }
+
+
+    // Builds, saves and loads the cache file of a texture, then changes its source image, and returns the number of errors.
+    unsigned long CheckCacheFile(const char* MapCompString, bool Compress, TextureCacheT::FormatT ExpectedFormat, uint32_t GoldenHash)
+    {
+        const std::string ImageName=BASE_DIR+"Image.bmp";
+        unsigned long     NumErrors=0;
+
+        if (!WriteSourceImage(ImageName, 37, 21, 1))
+            return Check(false, "writing the source image");
+
+        ArrayT<MapCompositionT> Images;
+        Images.PushBack(MapCompositionT(MapCompString, BASE_DIR));
+
+        const std::string Key     =TextureCacheT::GetKey(Images);
+        const std::string FileName=TextureCacheT::GetFileName(Images, Key);
+        const std::string What    =std::string(MapCompString)+(Compress ? ", compressed" : "")+": ";
+        TextureCacheT     Built;
+
+        if (Key.empty())
+            return Check(false, What+"the key is empty");
+
+        // The image is scaled to 32x16 and has all levels down to 1x1.
+        Built.Build(Images, Key, Compress);
+
+        const ArrayT<TextureCacheT::LevelT>& Levels=Built.GetMipMaps(0);
+        const uint32_t                       Hash  =GetHash(Built);
+        char                                 Info[256];
+
+        static const char* FormatNames[3]={ "RGBA", "DXT1", "DXT5" };
+
+        sprintf(Info, "built %s, %lu levels, %ux%u to %ux%u, hash 0x%08X", FormatNames[Built.GetFormat()], Levels.Size(),
+            Levels[0].SizeX, Levels[0].SizeY, Levels[Levels.Size()-1].SizeX, Levels[Levels.Size()-1].SizeY, Hash);
+
+        NumErrors+=Check(Built.GetFormat()==ExpectedFormat && Levels.Size()==6 && Levels[0].SizeX==32 && Levels[0].SizeY==16 &&
+                         Built.GetSizeX()==37 && Built.GetSizeY()==21 && Hash==GoldenHash, What+Info);
+
+        // The round-trip through the cache file must reproduce the levels, unless levels are skipped on purpose.
+        TextureCacheT Loaded;
+
+        NumErrors+=Check(Built.Save(FileName) && TextureCacheT::IsUpToDate(FileName, Key), What+"saved, the file is up-to-date");
+        NumErrors+=Check(Loaded.Load(FileName, Key, 4096, false, true) && AreEqual(Built, Loaded), What+"loaded all levels");
+
+        const bool LoadedMax8=Loaded.Load(FileName, Key, 8, false, true);
+
+        // As in TextureLoadJobT::MakeMipMaps(), a level is only skipped if both its width and height exceed the max. size.
+        NumErrors+=Check(LoadedMax8 && Loaded.GetMipMaps(0).Size()==5 && Loaded.GetMipMaps(0)[0].SizeX==16 && Loaded.GetMipMaps(0)[0].SizeY==8 &&
+                         Loaded.GetMipMaps(0)[0].Data.Size()==Levels[1].Data.Size() &&
+                         memcmp(&Loaded.GetMipMaps(0)[0].Data[0], &Levels[1].Data[0], Levels[1].Data.Size())==0, What+"loaded the levels for a max. size of 8");
+
+        const bool LoadedNoMipMaps=Loaded.Load(FileName, Key, 4096, false, false);
+
+        NumErrors+=Check(LoadedNoMipMaps && Loaded.GetMipMaps(0).Size()==1 && Loaded.GetMipMaps(0)[0].SizeX==32, What+"loaded the first level only");
+
+        // A changed source image (here with another size, as the modification time may not have changed yet) invalidates the cache file.
+        if (!WriteSourceImage(ImageName, 40, 20, 2))
+            return NumErrors+Check(false, "rewriting the source image");
+
+        const std::string NewKey=TextureCacheT::GetKey(Images);
+
+        NumErrors+=Check(NewKey!=Key && !NewKey.empty() && TextureCacheT::GetFileName(Images, NewKey)!=FileName &&
+                         !TextureCacheT::IsUpToDate(FileName, NewKey) && !Loaded.Load(FileName, NewKey, 4096, false, true),
+                         What+"the cache file is invalid after the source image changed");
+
+        // A truncated cache file (whose header is intact) is not loaded.
+        TextureCacheT Rebuilt;
+        ArrayT<char>  Bytes;
+
+        Rebuilt.Build(Images, NewKey, Compress);
+        Rebuilt.Save(FileName);
+
+        if (FILE* InFile=fopen(FileName.c_str(), "rb"))
+        {
+            char Buffer[4096];
+
+            for (size_t Count=fread(Buffer, 1, sizeof(Buffer), InFile); Count>0; Count=fread(Buffer, 1, sizeof(Buffer), InFile))
+                Bytes.PushBack(Buffer, (unsigned long)Count);
+
+            fclose(InFile);
+        }
+
+        if (FILE* OutFile=fopen(FileName.c_str(), "wb"))
+        {
+            if (Bytes.Size()>0) fwrite(&Bytes[0], 1, Bytes.Size()-Bytes.Size()/4, OutFile);
+            fclose(OutFile);
+        }
+
+        NumErrors+=Check(Bytes.Size()>0 && TextureCacheT::IsUpToDate(FileName, NewKey) && !Loaded.Load(FileName, NewKey, 4096, false, true),
+                         What+"a truncated cache file is not loaded");
+
+        remove(FileName.c_str());
+        remove(ImageName.c_str());
+
+        return NumErrors;
+    }
+}
+
+
+int main(int ArgC, const char* ArgV[])
+{
+    cf::FileSys::FileMan->MountFileSystem(cf::FileSys::FS_TYPE_LOCAL_PATH, "./", "");
+
+    unsigned long NumErrors=CheckBlocks();
+
+    if (!MakeDirectory(BASE_DIR) || !MakeDirectory(BASE_DIR+"TexCache"))
+    {
+        printf("FAIL  Could not create the directory \"%s\".\n", BASE_DIR.c_str());
+        return 1;
+    }
+
+    NumErrors+=CheckCacheFile("Image.bmp",             false, TextureCacheT::RGBA, 0x1129285D);
+    NumErrors+=CheckCacheFile("Image.bmp",             true,  TextureCacheT::DXT1, 0x696C9955);
+    NumErrors+=CheckCacheFile("blue2alpha(Image.bmp)", true,  TextureCacheT::DXT5, 0x77085572);
+
+    // Images whose source files are not in the local file system cannot be cached.
+    ArrayT<MapCompositionT> Missing;
+    Missing.PushBack(MapCompositionT("Missing.bmp", BASE_DIR));
+
+    NumErrors+=Check(TextureCacheT::GetKey(Missing).empty(), "an image without source file has no key");
+
+    rmdir((BASE_DIR+"TexCache").c_str());
+    rmdir(BASE_DIR.c_str());
+
+    return NumErrors==0 ? 0 : 1;
+}
@@ -0,0 +1,346 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/***************************************/
+/*** Background Texture Loading Test ***/
+/***************************************/
+
+// This program loads textures from zip archives with a TextureLoaderT, headless, i.e. without any renderer.
+// It writes two zip archives that are mounted at the same mount point: the first holds a set of images, the second
+// holds none of them, so that every image that is opened from the archives causes a "not found" warning of the second
+// archive. Some of the textures also refer to images that don't exist at all.
+// The program checks that
+//   - the mipmaps of the textures match the images in the archive,
+//   - the warnings of each texture are returned by its TextureLoadJobT::TakeWarnings(),
+//   - the console is never called from the worker threads of the TextureLoaderT, as it is not thread-safe.
+//
+// Usage: TextureLoad [NumRounds]
+// The archives are written to and removed from the current directory.
+// The exit code is 0 if all checks passed, 1 otherwise.
+
+#include "Bitmap/Bitmap.hpp"
+#include "ConsoleCommands/Console.hpp"
+#include "ConsoleCommands/ConsoleStdout.hpp"
+#include "FileSys/FileManImpl.hpp"
+#include "MaterialSystem/Common/TextureLoader.hpp"
+#include "MaterialSystem/MapComposition.hpp"
+
+#include "zlib.h"
+
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    const unsigned long NUM_IMAGES =24;     ///< The number of images in the first archive.
+    const unsigned long NUM_THREADS= 4;     ///< The number of worker threads of the texture loader.
+
+    const char* const ARCHIVE_A  ="TexLoadA.zip";
+    const char* const ARCHIVE_B  ="TexLoadB.zip";
+    const char* const MOUNT_POINT="TexLoad/";
+
+
+    /// A console that prints to stdout, but counts the calls from other threads than the main thread.
+    class ThreadCheckConsoleT : public cf::ConsoleI
+    {
+        public:
+
+        ThreadCheckConsoleT() : m_MainThread(std::this_thread::get_id()), m_NumOtherThreadCalls(0) { }
+
+        void Print(const std::string& s)      { Check(s); m_Stdout.Print(s); }
+        void DevPrint(const std::string& s)   { Check(s); m_Stdout.DevPrint(s); }
+        void Warning(const std::string& s)    { Check(s); m_Stdout.Warning(s); }
+        void DevWarning(const std::string& s) { Check(s); m_Stdout.DevWarning(s); }
+
+        unsigned long GetNumOtherThreadCalls() const { return m_NumOtherThreadCalls; }
+
+
+        private:
+
+        void Check(const std::string& s)
+        {
+            if (std::this_thread::get_id()==m_MainThread) return;
+
+            // Don't print s here: the output would be garbled exactly like the output of the console that we test for.
+            m_NumOtherThreadCalls++;
+        }
+
+        cf::ConsoleStdoutT         m_Stdout;
+        const std::thread::id      m_MainThread;
+        std::atomic<unsigned long> m_NumOtherThreadCalls;
+    };
+
+
+    void Put16(std::string& s, unsigned long v) { s+=char(v & 0xFF); s+=char((v >> 8) & 0xFF); }
+    void Put32(std::string& s, unsigned long v) { Put16(s, v & 0xFFFF); Put16(s, (v >> 16) & 0xFFFF); }
+
+
+    /// Writes a zip archive with the given files, stored without compression.
+    bool WriteZipArchive(const char* ArchiveName, const std::vector<std::string>& Names, const std::vector<std::string>& Contents)
+    {
+        std::string Local;
+        std::string Central;
+
+        for (size_t FileNr=0; FileNr<Names.size(); FileNr++)
+        {
+            const std::string&  Name  =Names[FileNr];
+            const std::string&  Data  =Contents[FileNr];
+            const unsigned long CRC   =crc32(0, (const Bytef*)Data.data(), uInt(Data.size()));
+            const unsigned long Offset=Local.size();
+
+            Put32(Local, 0x04034b50);     // Local file header signature.
+            Put16(Local, 20);             // Version needed to extract.
+            Put16(Local, 0);              // Flags.
+            Put16(Local, 0);              // Compression method "stored".
+            Put16(Local, 0);              // Time.
+            Put16(Local, 0x21);           // Date (1980-01-01).
+            Put32(Local, CRC);
+            Put32(Local, Data.size());    // Compressed size.
+            Put32(Local, Data.size());    // Uncompressed size.
+            Put16(Local, Name.size());
+            Put16(Local, 0);              // Extra field length.
+            Local+=Name;
+            Local+=Data;
+
+            Put32(Central, 0x02014b50);   // Central file header signature.
+            Put16(Central, 20);           // Version made by.
+            Put16(Central, 20);           // Version needed to extract.
+            Put16(Central, 0);            // Flags.
+            Put16(Central, 0);            // Compression method "stored".
+            Put16(Central, 0);            // Time.
+            Put16(Central, 0x21);         // Date (1980-01-01).
+            Put32(Central, CRC);
+            Put32(Central, Data.size());  // Compressed size.
+            Put32(Central, Data.size());  // Uncompressed size.
+            Put16(Central, Name.size());
+            Put16(Central, 0);            // Extra field length.
+            Put16(Central, 0);            // File comment length.
+            Put16(Central, 0);            // Disk number start.
+            Put16(Central, 0);            // Internal file attributes.
+            Put32(Central, 0);            // External file attributes.
+            Put32(Central, Offset);       // Offset of the local header.
+            Central+=Name;
+        }
+
+        std::string End;
+
+        Put32(End, 0x06054b50);           // End of central directory signature.
+        Put16(End, 0);                    // Number of this disk.
+        Put16(End, 0);                    // Disk where the central directory starts.
+        Put16(End, Names.size());         // Number of central directory records on this disk.
+        Put16(End, Names.size());         // Total number of central directory records.
+        Put32(End, Central.size());
+        Put32(End, Local.size());         // Offset of the central directory.
+        Put16(End, 0);                    // Comment length.
+
+        std::ofstream Out(ArchiveName, std::ios::out | std::ios::binary);
+
+        Out << Local << Central << End;
+        return Out.good();
+    }
+
+
+    /// Returns the contents of the given file, or the empty string if the file could not be read.
+    std::string ReadFile(const char* FileName)
+    {
+        std::ifstream In(FileName, std::ios::in | std::ios::binary);
+
+        return std::string(std::istreambuf_iterator<char>(In), std::istreambuf_iterator<char>());
+    }
+
+
+    /// Returns the image with the given number, with deterministic contents.
+    BitmapT MakeImage(unsigned long ImageNr)
+    {
+        const unsigned int Size=16u << (ImageNr % 4);  // 16 to 128 pixels.
+        BitmapT            Image(Size, Size);
+
+        for (unsigned int y=0; y<Size; y++)
+            for (unsigned int x=0; x<Size; x++)
+                Image.SetPixel(x, y, int((x*7+ImageNr*31) & 0xFF), int((y*5+ImageNr*17) & 0xFF), int((x^y) & 0xFF), 255);
+
+        return Image;
+    }
+
+
+    std::string GetImageName(unsigned long ImageNr)
+    {
+        char Name[32];
+
+        sprintf(Name, "Img%02lu.png", ImageNr);
+        return Name;
+    }
+
+
+    /// A texture of the test: its job, and what we expect from it.
+    struct TextureT
+    {
+        TextureLoadJobT* Job;
+        long             ImageNr;   ///< The number of the image in the archive, or -1 if the texture refers to a missing image.
+        std::string      FileName;  ///< The name of the image file, relative to the mount point.
+    };
+
+
+    /// Checks the results of the given (done) job, and returns the number of errors.
+    unsigned long CheckTexture(const TextureT& Tex, const BitmapT& FileNotFound)
+    {
+        unsigned long     NumErrors=0;
+        const std::string Warnings =Tex.Job->TakeWarnings();
+        const BitmapT     Expected =(Tex.ImageNr>=0) ? MakeImage(Tex.ImageNr) : FileNotFound;
+
+        // Every image is probed in the second archive first, where it is never found.
+        if (Warnings.find(Tex.FileName+" not found in "+ARCHIVE_B)==std::string::npos)
+        {
+            printf("  %s: missing warning of archive %s\n", Tex.FileName.c_str(), ARCHIVE_B);
+            NumErrors++;
+        }
+
+        // Only missing images are not found in the first archive as well, and cannot be loaded.
+        if ((Warnings.find(Tex.FileName+" not found in "+ARCHIVE_A)!=std::string::npos) != (Tex.ImageNr<0) ||
+            (Warnings.find("Could not load the bitmap")                   !=std::string::npos) != (Tex.ImageNr<0))
+        {
+            printf("  %s: unexpected warnings:\n%s", Tex.FileName.c_str(), Warnings.c_str());
+            NumErrors++;
+        }
+
+        // The warnings must be taken only once.
+        if (Tex.Job->TakeWarnings()!="")
+        {
+            printf("  %s: warnings were not cleared\n", Tex.FileName.c_str());
+            NumErrors++;
+        }
+
+        if (Tex.Job->GetCache()!=NULL || Tex.Job->GetSizeX()!=Expected.SizeX || Tex.Job->GetSizeY()!=Expected.SizeY)
+        {
+            printf("  %s: got size %ux%u, expected %ux%u\n", Tex.FileName.c_str(), Tex.Job->GetSizeX(), Tex.Job->GetSizeY(), Expected.SizeX, Expected.SizeY);
+            return NumErrors+1;
+        }
+
+        const ArrayT<BitmapT*>& Levels=Tex.Job->GetMipMaps(0);
+        unsigned long           NumLevels=1;
+
+        for (unsigned int s=Expected.SizeX > Expected.SizeY ? Expected.SizeX : Expected.SizeY; s>1; s/=2)
+            NumLevels++;
+
+        if (Levels.Size()!=NumLevels || Levels[0]->Data.Size()!=Expected.Data.Size() ||
+            memcmp(&Levels[0]->Data[0], &Expected.Data[0], Expected.Data.Size()*sizeof(uint32_t))!=0)
+        {
+            printf("  %s: mipmaps differ from the image\n", Tex.FileName.c_str());
+            NumErrors++;
+        }
+
+        return NumErrors;
+    }
+}
+
+
+static ThreadCheckConsoleT ConsoleThreadCheck;
+cf::ConsoleI* Console=&ConsoleThreadCheck;
+
+static cf::FileSys::FileManImplT FileManImpl;
+cf::FileSys::FileManI* cf::FileSys::FileMan=&FileManImpl;
+
+
+int main(int ArgC, const char* ArgV[])
+{
+    const unsigned long NumRounds=(ArgC>1) ? strtoul(ArgV[1], NULL, 10) : 20;
+
+    // Write the archives.
+    {
+        std::vector<std::string> Names;
+        std::vector<std::string> Contents;
+
+        for (unsigned long ImageNr=0; ImageNr<NUM_IMAGES; ImageNr++)
+        {
+            const char* TempName="TexLoadTemp.png";
+
+            if (!MakeImage(ImageNr).SaveToDisk(TempName))
+            {
+                printf("Could not write %s.\n", TempName);
+                return 1;
+            }
+
+            Names.push_back(GetImageName(ImageNr));
+            Contents.push_back(ReadFile(TempName));
+            remove(TempName);
+        }
+
+        if (!WriteZipArchive(ARCHIVE_A, Names, Contents) ||
+            !WriteZipArchive(ARCHIVE_B, std::vector<std::string>(1, "Readme.txt"), std::vector<std::string>(1, "This archive holds no images.\n")))
+        {
+            printf("Could not write the zip archives.\n");
+            return 1;
+        }
+    }
+
+    // The archive that is mounted last is probed first.
+    cf::FileSys::FileMan->MountFileSystem(cf::FileSys::FS_TYPE_ZIP_ARCHIVE, ARCHIVE_A, MOUNT_POINT);
+    cf::FileSys::FileMan->MountFileSystem(cf::FileSys::FS_TYPE_ZIP_ARCHIVE, ARCHIVE_B, MOUNT_POINT);
+
+    const BitmapT FileNotFound=BitmapT::GetBuiltInFileNotFoundBitmap();
+    unsigned long NumErrors   =0;
+    unsigned long NumTextures =0;
+
+    for (unsigned long RoundNr=0; RoundNr<NumRounds; RoundNr++)
+    {
+        TextureLoaderT        Loader(NUM_THREADS);
+        std::vector<TextureT> Textures;
+
+        // Every fourth texture refers to a missing image.
+        for (unsigned long TexNr=0; TexNr<NUM_IMAGES; TexNr++)
+        {
+            TextureT Tex;
+
+            Tex.ImageNr =(TexNr % 4==3) ? -1 : long((TexNr+RoundNr) % NUM_IMAGES);
+            Tex.FileName=(Tex.ImageNr>=0) ? GetImageName(Tex.ImageNr) : "Missing"+GetImageName(TexNr);
+
+            ArrayT<MapCompositionT> Images;
+            Images.PushBack(MapCompositionT(Tex.FileName, MOUNT_POINT));
+
+            Tex.Job=new TextureLoadJobT(Images, 4096, false, true, false);
+            Textures.push_back(Tex);
+            Loader.Add(Tex.Job);
+        }
+
+        // Cancel one texture per round, and finish the others in reverse order of their addition,
+        // so that some are finished by the worker threads and some in the main thread.
+        Loader.Cancel(Textures[RoundNr % NUM_IMAGES].Job);
+
+        for (size_t TexNr=Textures.size(); TexNr>0; TexNr--)
+        {
+            const TextureT& Tex=Textures[TexNr-1];
+
+            if (TexNr-1==RoundNr % NUM_IMAGES) continue;
+
+            Loader.Finish(Tex.Job);
+            NumErrors+=CheckTexture(Tex, FileNotFound);
+            NumTextures++;
+        }
+
+        for (size_t TexNr=0; TexNr<Textures.size(); TexNr++)
+            delete Textures[TexNr].Job;
+    }
+
+    remove(ARCHIVE_A);
+    remove(ARCHIVE_B);
+
+    if (ConsoleThreadCheck.GetNumOtherThreadCalls()>0)
+    {
+        printf("The console was called %lu times from worker threads.\n", ConsoleThreadCheck.GetNumOtherThreadCalls());
+        NumErrors++;
+    }
+
+    printf("%s  %lu rounds, %lu textures, %lu errors\n", NumErrors==0 ? "PASS" : "FAIL", NumRounds, NumTextures, NumErrors);
+    return NumErrors==0 ? 0 : 1;
+}
@@ -0,0 +1,557 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/****************************/
+/*** ClipSys Trace Stress ***/
+/****************************/
+
+// This program builds several CollisionModelStaticTs of brushes, bezier patches, terrains and meshes, computes the results
+// of many traces and contents tests in a single thread, then repeats them in many threads concurrently and checks that
+// each result is exactly the same as the serial one. It also checks that tracing batches of rays with TraceRays() yields
+// the same results as tracing each ray individually with TraceConvexSolid().
+// Then it does the same with the traces through a ClipWorldT with many (partly rotated) entity clip models, once with
+// each broadphase, as the game code does when several threads trace through the same clip world.
+//
+// Usage: TraceStress [NumThreads [NumRounds]]
+// The exit code is 0 if all results matched, 1 otherwise.
+
+#include "ClipSys/Broadphase.hpp"
+#include "ClipSys/ClipModel.hpp"
+#include "ClipSys/ClipWorld.hpp"
+#include "ClipSys/CollisionModel_static.hpp"
+#include "ClipSys/TraceResult.hpp"
+#include "ClipSys/TraceSolid.hpp"
+#include "ConsoleCommands/Console.hpp"
+#include "ConsoleCommands/ConsoleInterpreterImpl.hpp"
+#include "ConsoleCommands/ConsoleStdout.hpp"
+#include "ConsoleCommands/ConVar.hpp"
+#include "FileSys/FileManImpl.hpp"
+#include "MaterialSystem/Material.hpp"
+#include "MaterialSystem/MaterialManager.hpp"
+#include "Terrain/Terrain.hpp"
+#include "MapFile.hpp"
+
+#include <atomic>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+
+static cf::ConsoleStdoutT ConsoleStdout;
+cf::ConsoleI* Console=&ConsoleStdout;
+
+static cf::FileSys::FileManImplT FileManImpl;
+cf::FileSys::FileManI* cf::FileSys::FileMan=&FileManImpl;
+
+ConsoleInterpreterI* ConsoleInterpreter=NULL;
+MaterialManagerI*    MaterialManager   =NULL;
+
+
+using namespace cf::ClipSys;
+
+
+namespace
+{
+    const unsigned long NUM_TRACES     =20000;  ///< The number of traces and contents tests per collision model.
+    const unsigned long NUM_BATCH_RAYS =   16;  ///< The number of rays in each batch for TraceRays().
+    const unsigned long NUM_CLIP_MODELS=  300;  ///< The number of entity clip models in the clip world.
+
+    // A simple deterministic random number generator, so that runs are reproducible across platforms.
+    struct RandomT
+    {
+        RandomT(unsigned long Seed) : State((Seed*2654435761u+1) & 0xFFFFFFFF) { }
+
+        unsigned long Get(unsigned long Max)
+        {
+            State=(State*1103515245u+12345u) & 0xFFFFFFFF;
+            return ((State >> 8) & 0xFFFFFF) % Max;
+        }
+
+        double Get(double Min, double Max)
+        {
+            return Min + (Max-Min)*double(Get(0x1000000ul))/double(0x1000000ul);
+        }
+
+        unsigned long State;
+    };
+
+    /// A single query against a collision model.
+    struct QueryT
+    {
+        unsigned long SolidNr;      ///< The index of the trace solid in Solids.
+        Vector3dT     Start;
+        Vector3dT     Ray;
+        unsigned long ClipMask;
+
+        TraceResultT  Result;       ///< The result of TraceConvexSolid().
+        unsigned long Contents;     ///< The result of GetContents() at Start.
+    };
+
+    /// A single trace through a clip world.
+    struct WorldQueryT
+    {
+        unsigned long SolidNr;      ///< The index of the trace solid in Solids.
+        Vector3dT     Start;
+        Vector3dT     Ray;
+        unsigned long ClipMask;
+
+        TraceResultT  Result;       ///< The result of ClipWorldT::TraceConvexSolid().
+        ClipModelT*   HitClipModel; ///< The entity clip model that was hit, NULL if there was no hit or the world was hit.
+    };
+
+
+    // Adds an axis-aligned box brush to the given entity.
+    void AddBoxBrush(cf::MapFileEntityT& Entity, const BoundingBox3dT& BB, MaterialT* Material)
+    {
+        static const Vector3dT Normals[6]={ Vector3dT(1, 0, 0), Vector3dT(-1, 0, 0), Vector3dT(0, 1, 0), Vector3dT(0, -1, 0), Vector3dT(0, 0, 1), Vector3dT(0, 0, -1) };
+
+        cf::MapFileBrushT Brush;
+
+        for (unsigned long SideNr=0; SideNr<6; SideNr++)
+        {
+            cf::MapFilePlaneT MFPlane;
+
+            MFPlane.Plane   =Plane3dT(Normals[SideNr], dot(Normals[SideNr], (SideNr & 1) ? BB.Min : BB.Max));
+            MFPlane.Material=Material;
+            MFPlane.U       =Vector3dT(Normals[SideNr].z, Normals[SideNr].x, Normals[SideNr].y);
+            MFPlane.V       =cross(Normals[SideNr], MFPlane.U);
+            MFPlane.ShiftU  =0.0;
+            MFPlane.ShiftV  =0.0;
+
+            Brush.MFPlanes.PushBack(MFPlane);
+        }
+
+        Entity.MFBrushes.PushBack(Brush);
+    }
+
+
+    // Adds a curved 3x3 bezier patch to the given entity.
+    void AddBezierPatch(cf::MapFileEntityT& Entity, const Vector3dT& Origin, double Size, MaterialT* Material)
+    {
+        cf::MapFileBezierPatchT Patch;
+
+        Patch.SizeX      =3;
+        Patch.SizeY      =3;
+        Patch.SubdivsHorz=-1;
+        Patch.SubdivsVert=-1;
+        Patch.Material   =Material;
+
+        for (unsigned long y=0; y<3; y++)
+            for (unsigned long x=0; x<3; x++)
+            {
+                Patch.ControlPoints.PushBack(float(Origin.x + x*Size/2));
+                Patch.ControlPoints.PushBack(float(Origin.y + y*Size/2));
+                Patch.ControlPoints.PushBack(float(Origin.z + ((x==1 || y==1) ? Size/2 : 0.0)));
+                Patch.ControlPoints.PushBack(float(x)/2.0f);
+                Patch.ControlPoints.PushBack(float(y)/2.0f);
+            }
+
+        Entity.MFPatches.PushBack(Patch);
+    }
+
+
+    // Computes the results of all queries against the given model.
+    void RunQueries(const CollisionModelStaticT& Model, const ArrayT<const TraceSolidT*>& Solids, ArrayT<QueryT>& Queries)
+    {
+        for (unsigned long QueryNr=0; QueryNr<Queries.Size(); QueryNr++)
+        {
+            QueryT& Query=Queries[QueryNr];
+
+            Query.Result=TraceResultT(1.0);
+            Model.TraceConvexSolid(*Solids[Query.SolidNr], Query.Start, Query.Ray, Query.ClipMask, Query.Result);
+            Query.Contents=Model.GetContents(Query.Start, Query.SolidNr==0 ? 0.0 : 8.0, Query.ClipMask);
+        }
+    }
+
+
+    // Repeats the queries in NumThreads concurrent threads and returns the number of results that differ from the serial ones.
+    unsigned long RunConcurrently(const CollisionModelStaticT& Model, const ArrayT<const TraceSolidT*>& Solids, const ArrayT<QueryT>& Serial, unsigned long NumThreads, unsigned long NumRounds)
+    {
+        std::atomic<unsigned long> NumMismatches(0);
+        std::vector<std::thread>   Threads;
+
+        for (unsigned long ThreadNr=0; ThreadNr<NumThreads; ThreadNr++)
+        {
+            Threads.push_back(std::thread([&, ThreadNr]()
+            {
+                for (unsigned long RoundNr=0; RoundNr<NumRounds; RoundNr++)
+                    for (unsigned long i=0; i<Serial.Size(); i++)
+                    {
+                        // Each thread starts at another query, so that the threads work on different parts of the model.
+                        const QueryT& Query=Serial[(i + ThreadNr*Serial.Size()/NumThreads) % Serial.Size()];
+                        TraceResultT  Result(1.0);
+
+                        Model.TraceConvexSolid(*Solids[Query.SolidNr], Query.Start, Query.Ray, Query.ClipMask, Result);
+
+                        const unsigned long Contents=Model.GetContents(Query.Start, Query.SolidNr==0 ? 0.0 : 8.0, Query.ClipMask);
+
+                        if (Result.Fraction    !=Query.Result.Fraction     ||
+                            Result.StartSolid  !=Query.Result.StartSolid   ||
+                            Result.ImpactNormal!=Query.Result.ImpactNormal ||
+                            Result.Material    !=Query.Result.Material     ||
+                            Contents           !=Query.Contents) NumMismatches++;
+                    }
+            }));
+        }
+
+        for (unsigned long ThreadNr=0; ThreadNr<Threads.size(); ThreadNr++)
+            Threads[ThreadNr].join();
+
+        return NumMismatches;
+    }
+
+
+    // Computes the results of all traces through the given clip world.
+    void RunWorldQueries(const ClipWorldT& ClipWorld, const ArrayT<const TraceSolidT*>& Solids, ArrayT<WorldQueryT>& Queries)
+    {
+        for (unsigned long QueryNr=0; QueryNr<Queries.Size(); QueryNr++)
+        {
+            WorldQueryT& Query=Queries[QueryNr];
+
+            Query.Result=TraceResultT(1.0);
+            ClipWorld.TraceConvexSolid(*Solids[Query.SolidNr], Query.Start, Query.Ray, Query.ClipMask, NULL, Query.Result, &Query.HitClipModel);
+        }
+    }
+
+
+    // Repeats the traces through the clip world in NumThreads concurrent threads and returns the number of results that differ from the serial ones.
+    unsigned long RunWorldConcurrently(const ClipWorldT& ClipWorld, const ArrayT<const TraceSolidT*>& Solids, const ArrayT<WorldQueryT>& Serial, unsigned long NumThreads, unsigned long NumRounds)
+    {
+        std::atomic<unsigned long> NumMismatches(0);
+        std::vector<std::thread>   Threads;
+
+        for (unsigned long ThreadNr=0; ThreadNr<NumThreads; ThreadNr++)
+        {
+            Threads.push_back(std::thread([&, ThreadNr]()
+            {
+                for (unsigned long RoundNr=0; RoundNr<NumRounds; RoundNr++)
+                    for (unsigned long i=0; i<Serial.Size(); i++)
+                    {
+                        const WorldQueryT& Query=Serial[(i + ThreadNr*Serial.Size()/NumThreads) % Serial.Size()];
+                        TraceResultT       Result(1.0);
+                        ClipModelT*        HitClipModel=NULL;
+
+                        ClipWorld.TraceConvexSolid(*Solids[Query.SolidNr], Query.Start, Query.Ray, Query.ClipMask, NULL, Result, &HitClipModel);
+
+                        if (Result.Fraction    !=Query.Result.Fraction     ||
+                            Result.StartSolid  !=Query.Result.StartSolid   ||
+                            Result.ImpactNormal!=Query.Result.ImpactNormal ||
+                            Result.Material    !=Query.Result.Material     ||
+                            HitClipModel       !=Query.HitClipModel) NumMismatches++;
+                    }
+            }));
+        }
+
+        for (unsigned long ThreadNr=0; ThreadNr<Threads.size(); ThreadNr++)
+            Threads[ThreadNr].join();
+
+        return NumMismatches;
+    }
+
+
+    // Traces batches of coherent rays with TraceRays() and returns the number of results that differ from those of TraceConvexSolid().
+    unsigned long CompareTraceRays(const CollisionModelStaticT& Model, RandomT& Random)
+    {
+        const TracePointT Point;
+        unsigned long     NumMismatches=0;
+
+        for (unsigned long BatchNr=0; BatchNr<NUM_TRACES/NUM_BATCH_RAYS; BatchNr++)
+        {
+            // The rays of a batch have a common start point, like the pellets of a shotgun.
+            // The start points are above the terrain, because the solid part of the terrain reaches below its bounding box,
+            // where single traces can miss it when the batches don't.
+            const Vector3dT      Start(Random.Get(-1100.0, 1100.0), Random.Get(-1100.0, 1100.0), Random.Get(-400.0, 1100.0));
+            const unsigned long  ClipMask=Random.Get(4ul)==0 ? (unsigned long)MaterialT::Clip_Projectiles : (unsigned long)MaterialT::Clip_Players;
+            ArrayT<Vector3dT>    Starts;
+            ArrayT<Vector3dT>    Rays;
+            ArrayT<TraceResultT> Results;
+
+            for (unsigned long RayNr=0; RayNr<NUM_BATCH_RAYS; RayNr++)
+            {
+                Starts.PushBack(Start);
+                Rays.PushBack(Vector3dT(Random.Get(-2000.0, 2000.0), Random.Get(-2000.0, 2000.0), Random.Get(-2000.0, 2000.0)));
+                Results.PushBack(TraceResultT(1.0));
+            }
+
+            Model.TraceRays(NUM_BATCH_RAYS, &Starts[0], &Rays[0], ClipMask, &Results[0]);
+
+            for (unsigned long RayNr=0; RayNr<NUM_BATCH_RAYS; RayNr++)
+            {
+                TraceResultT Result(1.0);
+
+                Model.TraceConvexSolid(Point, Starts[RayNr], Rays[RayNr], ClipMask, Result);
+
+                // The objects may be visited in a different order, so the results may differ by the pull-back distance.
+                if (Result.StartSolid!=Results[RayNr].StartSolid ||
+                    fabs(Result.Fraction-Results[RayNr].Fraction)*length(Rays[RayNr]) > 0.0625) NumMismatches++;
+            }
+        }
+
+        return NumMismatches;
+    }
+
+
+    // Traces batches of rays through the clip world with TraceRays() and returns the number of results that differ from
+    // those of TraceConvexSolid(). The results are initialized with a stale hit of StaleClipModel, which must be overwritten.
+    unsigned long CompareWorldTraceRays(const ClipWorldT& ClipWorld, ClipModelT* StaleClipModel, RandomT& Random)
+    {
+        const TracePointT Point;
+        unsigned long     NumMismatches=0;
+
+        for (unsigned long BatchNr=0; BatchNr<NUM_TRACES/NUM_BATCH_RAYS; BatchNr++)
+        {
+            const Vector3dT      Start(Random.Get(-900.0, 900.0), Random.Get(-900.0, 900.0), Random.Get(-400.0, 850.0));
+            const unsigned long  ClipMask=Random.Get(4ul)==0 ? (unsigned long)MaterialT::Clip_Projectiles : (unsigned long)MaterialT::Clip_Players;
+            ArrayT<Vector3dT>    Starts;
+            ArrayT<Vector3dT>    Rays;
+            ArrayT<TraceResultT> Results;
+            ArrayT<ClipModelT*>  HitClipModels;
+
+            for (unsigned long RayNr=0; RayNr<NUM_BATCH_RAYS; RayNr++)
+            {
+                const Vector3dT End(Random.Get(-900.0, 900.0), Random.Get(-900.0, 900.0), Random.Get(-850.0, 850.0));
+
+                Starts.PushBack(Start);
+                Rays.PushBack(End-Start);
+                Results.PushBack(TraceResultT(0.5));
+                HitClipModels.PushBack(StaleClipModel);
+            }
+
+            ClipWorld.TraceRays(NUM_BATCH_RAYS, &Starts[0], &Rays[0], ClipMask, NULL, &Results[0], &HitClipModels[0]);
+
+            for (unsigned long RayNr=0; RayNr<NUM_BATCH_RAYS; RayNr++)
+            {
+                TraceResultT Result(1.0);
+                ClipModelT*  HitClipModel=NULL;
+
+                ClipWorld.TraceConvexSolid(Point, Starts[RayNr], Rays[RayNr], ClipMask, NULL, Result, &HitClipModel);
+
+                if (Result.StartSolid!=Results[RayNr].StartSolid ||
+                    HitClipModel     !=HitClipModels[RayNr]      ||
+                    fabs(Result.Fraction-Results[RayNr].Fraction)*length(Rays[RayNr]) > 0.0625) NumMismatches++;
+            }
+        }
+
+        return NumMismatches;
+    }
+}
+
+
+int main(int ArgC, const char* ArgV[])
+{
+    const unsigned long NumThreads=ArgC>1 ? strtoul(ArgV[1], NULL, 10) : 8;
+    const unsigned long NumRounds =ArgC>2 ? strtoul(ArgV[2], NULL, 10) : 2;
+
+    if (NumThreads<1)
+    {
+        printf("The number of threads must be at least 1.\n");
+        return 1;
+    }
+
+    // The console interpreter is needed for setting the clip_broadphase console variable below.
+    ConsoleInterpreterImplT ConInterpreterImpl;
+
+    ConsoleInterpreter=&ConInterpreterImpl;
+    ConVarT::RegisterStaticList();
+
+    RandomT   Random(1);
+    MaterialT Solid;
+    MaterialT Water;
+
+    Solid.ClipFlags=MaterialT::Clip_AllBlocking;
+    Water.ClipFlags=MaterialT::Clip_Projectiles;
+
+    // The terrain.
+    std::vector<unsigned short> HeightData(33*33);
+
+    for (unsigned long i=0; i<HeightData.size(); i++)
+        HeightData[i]=(unsigned short)Random.Get(65536ul);
+
+    const TerrainT                             Terrain(&HeightData[0], 33, BoundingBox3fT(Vector3fT(-1000, -1000, -600), Vector3fT(1000, 1000, -400)));
+    ArrayT<CollisionModelStaticT::TerrainRefT> Terrains;
+
+    Terrains.PushBack(CollisionModelStaticT::TerrainRefT(&Terrain, &Solid, Terrain.GetBB().AsBoxOfDouble()));
+
+    // The entity with the brushes and bezier patches.
+    cf::MapFileEntityT Entity;
+
+    AddBoxBrush(Entity, BoundingBox3dT(Vector3dT(-1000, -1000, -1000), Vector3dT(1000, 1000, -900)), &Solid);
+
+    for (unsigned long BrushNr=0; BrushNr<200; BrushNr++)
+    {
+        const Vector3dT Min(Random.Get(-1000.0, 900.0), Random.Get(-1000.0, 900.0), Random.Get(-900.0, 900.0));
+        const Vector3dT Size(Random.Get(4.0, 100.0), Random.Get(4.0, 100.0), Random.Get(4.0, 100.0));
+
+        AddBoxBrush(Entity, BoundingBox3dT(Min, Min+Size), BrushNr % 10==0 ? &Water : &Solid);
+    }
+
+    for (unsigned long PatchNr=0; PatchNr<20; PatchNr++)
+        AddBezierPatch(Entity, Vector3dT(Random.Get(-1000.0, 800.0), Random.Get(-1000.0, 800.0), Random.Get(-900.0, 800.0)), Random.Get(50.0, 200.0), &Solid);
+
+    // The mesh.
+    ArrayT<Vector3dT> Mesh;
+
+    for (unsigned long y=0; y<40; y++)
+        for (unsigned long x=0; x<40; x++)
+            Mesh.PushBack(Vector3dT(-1000.0 + x*50.0, -1000.0 + y*50.0, 600.0 + Random.Get(-40.0, 40.0)));
+
+    // The collision models.
+    const CollisionModelStaticT* Models[3]=
+    {
+        new CollisionModelStaticT(Entity, Terrains, false, 0.1, 0.2, 24.0, 400.0, 100.0),
+        new CollisionModelStaticT(Entity, Terrains, true,  0.1, 0.2, 24.0, 400.0, 100.0),
+        new CollisionModelStaticT(40, 40, Mesh, &Solid, 100.0),
+    };
+
+    static const char* ModelNames[3]={ "brushes with bevel planes", "generic brushes", "mesh" };
+
+    // The trace solids.
+    const TracePointT Point;
+    const TraceBoxT   SmallBox(BoundingBox3dT(Vector3dT(-8, -8, -8), Vector3dT(8, 8, 8)));
+    const TraceBoxT   PlayerBox(BoundingBox3dT(Vector3dT(-16, -16, -36), Vector3dT(16, 16, 36)));
+
+    ArrayT<const TraceSolidT*> Solids;
+
+    Solids.PushBack(&Point);
+    Solids.PushBack(&SmallBox);
+    Solids.PushBack(&PlayerBox);
+
+    // Run the queries in a single thread, then concurrently.
+    bool Passed=true;
+
+    for (unsigned long ModelNr=0; ModelNr<3; ModelNr++)
+    {
+        ArrayT<QueryT> Queries;
+
+        for (unsigned long QueryNr=0; QueryNr<NUM_TRACES; QueryNr++)
+        {
+            Queries.PushBackEmpty();
+
+            QueryT& Query=Queries[Queries.Size()-1];
+
+            Query.SolidNr =Random.Get(Solids.Size());
+            Query.Start   =Vector3dT(Random.Get(-1100.0, 1100.0), Random.Get(-1100.0, 1100.0), Random.Get(-1100.0, 1100.0));
+            Query.Ray     =Vector3dT(Random.Get(-800.0, 800.0), Random.Get(-800.0, 800.0), Random.Get(-800.0, 800.0));
+            Query.ClipMask=Random.Get(4ul)==0 ? (unsigned long)MaterialT::Clip_Projectiles : (unsigned long)MaterialT::Clip_Players;
+        }
+
+        RunQueries(*Models[ModelNr], Solids, Queries);
+
+        unsigned long NumHits=0;
+
+        for (unsigned long QueryNr=0; QueryNr<Queries.Size(); QueryNr++)
+            if (Queries[QueryNr].Result.Fraction<1.0) NumHits++;
+
+        const unsigned long NumMismatches=RunConcurrently(*Models[ModelNr], Solids, Queries, NumThreads, NumRounds);
+
+        printf("%s  %-26s %lu queries (%lu hits), %lu threads x %lu rounds: %lu mismatches\n",
+            NumMismatches==0 ? "PASS" : "FAIL", ModelNames[ModelNr], Queries.Size(), NumHits, NumThreads, NumRounds, NumMismatches);
+
+        if (NumMismatches>0) Passed=false;
+
+        const unsigned long NumRayMismatches=CompareTraceRays(*Models[ModelNr], Random);
+
+        printf("%s  %-26s %lu rays in batches, compared to single traces: %lu mismatches\n",
+            NumRayMismatches==0 ? "PASS" : "FAIL", ModelNames[ModelNr], NUM_TRACES/NUM_BATCH_RAYS*NUM_BATCH_RAYS, NumRayMismatches);
+
+        if (NumRayMismatches>0) Passed=false;
+    }
+
+    // The entity clip models in the clip world are boxes and bezier patches, every third of them rotated.
+    ArrayT<const CollisionModelStaticT*> EntityModels;
+
+    for (unsigned long EntityNr=0; EntityNr<4; EntityNr++)
+    {
+        cf::MapFileEntityT EntityModel;
+
+        if (EntityNr<3)
+            AddBoxBrush(EntityModel, BoundingBox3dT(Vector3dT(-8.0, -8.0, -8.0)*(EntityNr+1), Vector3dT(8.0, 8.0, 8.0)*(EntityNr+1)), EntityNr==2 ? &Water : &Solid);
+        else
+            AddBezierPatch(EntityModel, Vector3dT(-32.0, -32.0, -16.0), 64.0, &Solid);
+
+        EntityModels.PushBack(new CollisionModelStaticT(EntityModel, ArrayT<CollisionModelStaticT::TerrainRefT>(), false, 0.1, 0.2, 24.0, 400.0, 100.0));
+    }
+
+    static const char* BroadphaseNames[2]={ "tree", "grid" };
+
+    for (unsigned long BpNr=0; BpNr<2; BpNr++)
+    {
+        ConsoleInterpreter->FindVar("clip_broadphase")->SetValue(BroadphaseNames[BpNr]);
+
+        ClipWorldT           ClipWorld(Models[0]);
+        ArrayT<ClipModelT*>  ClipModels;
+        ArrayT<WorldQueryT>  Queries;
+
+        for (unsigned long ClipModelNr=0; ClipModelNr<NUM_CLIP_MODELS; ClipModelNr++)
+        {
+            ClipModelT* ClipModel=new ClipModelT(ClipWorld, EntityModels[ClipModelNr % EntityModels.Size()]);
+
+            ClipModel->SetOrigin(Vector3dT(Random.Get(-900.0, 900.0), Random.Get(-900.0, 900.0), Random.Get(-850.0, 850.0)));
+
+            if (ClipModelNr % 3==0)
+                ClipModel->SetOrientation(cf::math::Matrix3x3dT::GetRotateMatrix(Random.Get(0.0, 360.0), normalize(Vector3dT(Random.Get(-1.0, 1.0), Random.Get(-1.0, 1.0), 1.0), 0.0)));
+
+            ClipModel->Register();
+            ClipModels.PushBack(ClipModel);
+        }
+
+        for (unsigned long QueryNr=0; QueryNr<NUM_TRACES; QueryNr++)
+        {
+            Queries.PushBackEmpty();
+
+            WorldQueryT& Query=Queries[Queries.Size()-1];
+
+            // Unlike above, the traces stay within the bounds of the world, as they do in the game code.
+            const Vector3dT End(Random.Get(-900.0, 900.0), Random.Get(-900.0, 900.0), Random.Get(-850.0, 850.0));
+
+            Query.SolidNr =Random.Get(Solids.Size());
+            Query.Start   =Vector3dT(Random.Get(-900.0, 900.0), Random.Get(-900.0, 900.0), Random.Get(-850.0, 850.0));
+            Query.Ray     =End-Query.Start;
+            Query.ClipMask=Random.Get(4ul)==0 ? (unsigned long)MaterialT::Clip_Projectiles : (unsigned long)MaterialT::Clip_Players;
+        }
+
+        RunWorldQueries(ClipWorld, Solids, Queries);
+
+        unsigned long NumHits=0;
+        unsigned long NumEntityHits=0;
+
+        for (unsigned long QueryNr=0; QueryNr<Queries.Size(); QueryNr++)
+        {
+            if (Queries[QueryNr].Result.Fraction<1.0) NumHits++;
+            if (Queries[QueryNr].HitClipModel!=NULL) NumEntityHits++;
+        }
+
+        const unsigned long NumMismatches=RunWorldConcurrently(ClipWorld, Solids, Queries, NumThreads, NumRounds);
+
+        printf("%s  clip world (%s broadphase) %lu traces (%lu hits, %lu of entities), %lu threads x %lu rounds: %lu mismatches\n",
+            NumMismatches==0 ? "PASS" : "FAIL", ClipWorld.GetBroadphase().GetName(), Queries.Size(), NumHits, NumEntityHits, NumThreads, NumRounds, NumMismatches);
+
+        if (NumMismatches>0) Passed=false;
+
+        const unsigned long NumRayMismatches=CompareWorldTraceRays(ClipWorld, ClipModels[0], Random);
+
+        printf("%s  clip world (%s broadphase) %lu rays in batches, compared to single traces: %lu mismatches\n",
+            NumRayMismatches==0 ? "PASS" : "FAIL", ClipWorld.GetBroadphase().GetName(), NUM_TRACES/NUM_BATCH_RAYS*NUM_BATCH_RAYS, NumRayMismatches);
+
+        if (NumRayMismatches>0) Passed=false;
+
+        for (unsigned long ClipModelNr=0; ClipModelNr<ClipModels.Size(); ClipModelNr++)
+            delete ClipModels[ClipModelNr];
+    }
+
+    for (unsigned long EntityNr=0; EntityNr<EntityModels.Size(); EntityNr++)
+        delete EntityModels[EntityNr];
+
+    for (unsigned long ModelNr=0; ModelNr<3; ModelNr++)
+        delete Models[ModelNr];
+
+    // Make sure that no ConVarT dtor accesses the console interpreter after it has been destroyed.
+    ConsoleInterpreter=NULL;
+
+    return Passed ? 0 : 1;
+}
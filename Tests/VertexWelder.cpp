@@ -0,0 +1,226 @@
+/*
+Cafu Engine, http://www.cafu.de/
+Copyright (c) Carsten Fuchs and other contributors.
+This project is licensed under the terms of the MIT license.
+*/
+
+/**************************/
+/*** Vertex Welder Test ***/
+/**************************/
+
+// This program checks that the VertexWelderT class yields exactly the same vertex indices as the linear search that
+// CaBSP used to weld its draw vertices before, see FindVertexIndex() in older versions of ComputeDrawStructures.cpp.
+// Each input is a sequence of vertices that is fed both into a VertexWelderT and into the linear search. The resulting
+// indices and vertex arrays must be identical, and so must be the results of Find() for vertices that are not inserted.
+// Besides random and map-like vertices, the inputs contain vertices that are on or near the boundaries of the grid cells
+// of the welder and that are exactly, or just more or less than, epsilon apart from each other across these boundaries.
+//
+// Usage: VertexWelder
+// The exit code is 0 if all results matched the linear search, 1 otherwise.
+
+#include "Math3D/VertexWelder.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+
+namespace
+{
+    // A simple deterministic random number generator, so that runs are reproducible across platforms.
+    struct RandomT
+    {
+        RandomT(unsigned long Seed) : State((Seed*2654435761u+1) & 0xFFFFFFFF) { }
+
+        unsigned long Get(unsigned long Max)
+        {
+            State=(State*1103515245u+12345u) & 0xFFFFFFFF;
+            return ((State >> 8) & 0xFFFFFF) % Max;
+        }
+
+        double Get(double Min, double Max)
+        {
+            return Min + (Max-Min)*double(Get(0x1000000ul))/double(0x1000000ul);
+        }
+
+        Vector3dT Get(const Vector3dT& Center, double Radius)
+        {
+            return Center+Vector3dT(Get(-Radius, Radius), Get(-Radius, Radius), Get(-Radius, Radius));
+        }
+
+        unsigned long State;
+    };
+
+
+    // This is the linear search that VertexWelderT replaces.
+    long FindLinear(const ArrayT<Vector3dT>& Vertices, const Vector3dT& A, double Epsilon)
+    {
+        for (unsigned long VertexNr=0; VertexNr<Vertices.Size(); VertexNr++)
+            if (Vertices[VertexNr].IsEqual(A, Epsilon)) return VertexNr;
+
+        return -1;
+    }
+
+
+    unsigned long FindOrInsertLinear(ArrayT<Vector3dT>& Vertices, const Vector3dT& A, double Epsilon)
+    {
+        const long VertexNr=FindLinear(Vertices, A, Epsilon);
+
+        if (VertexNr>=0) return VertexNr;
+
+        Vertices.PushBack(A);
+        return Vertices.Size()-1;
+    }
+
+
+    /// Shuffles the given vertices, so that the vertices near a cell boundary are not all inserted in the same order.
+    void Shuffle(ArrayT<Vector3dT>& Vertices, RandomT& Random)
+    {
+        for (unsigned long i=Vertices.Size(); i>1; i--)
+            std::swap(Vertices[i-1], Vertices[Random.Get(i)]);
+    }
+
+
+    /// Returns vertices that are on and near the boundaries of the grid cells of a welder with the given epsilon,
+    /// along with vertices that are exactly, or just more or less than, epsilon apart from them.
+    ArrayT<Vector3dT> GetBoundaryVertices(double Epsilon, const Vector3dT& Origin, RandomT& Random)
+    {
+        const double      CellSize=Epsilon*2.0;
+        const double      Deltas[]={ 0.0, 1.0e-12, 1.0e-9, Epsilon*1.0e-3, Epsilon*0.5 };
+        const double      Dists[] ={ Epsilon, Epsilon*(1.0-1.0e-9), Epsilon*(1.0+1.0e-9), Epsilon*0.5 };
+        ArrayT<Vector3dT> Vertices;
+
+        for (int k=-2; k<=2; k++)
+            for (unsigned int DeltaNr=0; DeltaNr<sizeof(Deltas)/sizeof(Deltas[0]); DeltaNr++)
+                for (int Sign=-1; Sign<=1; Sign+=2)
+                    for (unsigned int Axis=0; Axis<3; Axis++)
+                    {
+                        // A vertex whose coordinate along Axis is on or near the boundary of the cells k-1 and k.
+                        Vector3dT V=Origin + Random.Get(Vector3dT(), Epsilon*0.25);
+
+                        V[Axis]=Origin[Axis] + k*CellSize + Sign*Deltas[DeltaNr];
+                        Vertices.PushBack(V);
+
+                        // Vertices at (about) the given distances from V, across the boundary and diagonally.
+                        for (unsigned int DistNr=0; DistNr<sizeof(Dists)/sizeof(Dists[0]); DistNr++)
+                        {
+                            const double Diag=Dists[DistNr]/sqrt(3.0);
+                            Vector3dT    W=V;
+
+                            W[Axis]-=Sign*Dists[DistNr];
+                            Vertices.PushBack(W);
+                            Vertices.PushBack(V+Vector3dT(Diag, Diag, Diag));
+                            Vertices.PushBack(V-Vector3dT(Diag, Diag, Diag));
+                        }
+                    }
+
+        Shuffle(Vertices, Random);
+        return Vertices;
+    }
+
+
+    /// Returns vertices like those of brushes in map files: coordinates on a grid, with some rounding noise.
+    ArrayT<Vector3dT> GetMapVertices(double Epsilon, RandomT& Random)
+    {
+        ArrayT<Vector3dT> Vertices;
+
+        for (unsigned long VertexNr=0; VertexNr<6000; VertexNr++)
+        {
+            const Vector3dT Grid(8.0*(long(Random.Get(40))-20), 8.0*(long(Random.Get(40))-20), 8.0*(long(Random.Get(20))-10));
+
+            Vertices.PushBack(Random.Get(Grid, Epsilon*1.5));
+        }
+
+        return Vertices;
+    }
+
+
+    /// Feeds the given vertices into a VertexWelderT and into the linear search and compares the results.
+    /// The first NumPrefilled vertices are put into the array before the welder is constructed.
+    /// Returns the number of mismatches.
+    unsigned long Compare(const char* Name, const ArrayT<Vector3dT>& Input, double Epsilon, unsigned long NumPrefilled, RandomT& Random)
+    {
+        ArrayT<Vector3dT> WeldedVertices;
+        ArrayT<Vector3dT> LinearVertices;
+        unsigned long     NumMismatches=0;
+
+        for (unsigned long VertexNr=0; VertexNr<NumPrefilled; VertexNr++)
+        {
+            WeldedVertices.PushBack(Input[VertexNr]);
+            LinearVertices.PushBack(Input[VertexNr]);
+        }
+
+        VertexWelderT<double> Welder(WeldedVertices, Epsilon);
+
+        for (unsigned long VertexNr=NumPrefilled; VertexNr<Input.Size(); VertexNr++)
+        {
+            const Vector3dT& A=Input[VertexNr];
+
+            // Find() must also agree for vertices that are not inserted, which are mostly not found.
+            const Vector3dT Probe=Random.Get(A, Epsilon*4.0);
+
+            if (Welder.Find(Probe)!=FindLinear(LinearVertices, Probe, Epsilon)) NumMismatches++;
+
+            const unsigned long WeldedNr=Welder.FindOrInsert(A);
+            const unsigned long LinearNr=FindOrInsertLinear(LinearVertices, A, Epsilon);
+
+            if (WeldedNr!=LinearNr)
+            {
+                if (NumMismatches==0)
+                    printf("  vertex %lu (%.17g %.17g %.17g): index %lu, linear search %lu\n", VertexNr, A.x, A.y, A.z, WeldedNr, LinearNr);
+
+                NumMismatches++;
+            }
+        }
+
+        if (WeldedVertices.Size()!=LinearVertices.Size()) NumMismatches++;
+
+        for (unsigned long VertexNr=0; VertexNr<WeldedVertices.Size() && VertexNr<LinearVertices.Size(); VertexNr++)
+            if (WeldedVertices[VertexNr]!=LinearVertices[VertexNr]) NumMismatches++;
+
+        printf("%s  %-30s eps %-6g %6lu vertices, %6lu unique, %lu mismatches\n", NumMismatches==0 ? "PASS" : "FAIL", Name, Epsilon,
+            Input.Size(), LinearVertices.Size(), NumMismatches);
+
+        return NumMismatches;
+    }
+}
+
+
+int main(int ArgC, const char* ArgV[])
+{
+    // 0.08 is MapT::RoundEpsilon, with which CaBSP welds its draw vertices.
+    const double  Epsilons[]={ 0.08, 1.0, 0.001, 0.0 };
+    RandomT       Random(1);
+    unsigned long NumErrors=0;
+
+    for (unsigned int EpsNr=0; EpsNr<sizeof(Epsilons)/sizeof(Epsilons[0]); EpsNr++)
+    {
+        const double Epsilon=Epsilons[EpsNr];
+        const double Scale  =Epsilon>0.0 ? Epsilon : 0.5;
+
+        // Random vertices that are so densely clustered that many of them are welded.
+        ArrayT<Vector3dT> Clustered;
+
+        for (unsigned long VertexNr=0; VertexNr<4000; VertexNr++)
+            Clustered.PushBack(Random.Get(Vector3dT(), Scale*12.0));
+
+        // Exact duplicates are only welded with an epsilon of 0.
+        for (unsigned long VertexNr=0; VertexNr<1000; VertexNr++)
+            Clustered.PushBack(Clustered[Random.Get(Clustered.Size())]);
+
+        Shuffle(Clustered, Random);
+
+        if (Compare("clustered", Clustered, Epsilon, 0, Random)>0) NumErrors++;
+        if (Compare("clustered, prefilled", Clustered, Epsilon, 2000, Random)>0) NumErrors++;
+
+        if (Epsilon==0.0) continue;
+
+        // The boundary vertices near the origin are also near the boundaries of the cells with negative coordinates.
+        if (Compare("cell boundaries", GetBoundaryVertices(Epsilon, Vector3dT(), Random), Epsilon, 0, Random)>0) NumErrors++;
+        if (Compare("cell boundaries, negative", GetBoundaryVertices(Epsilon, Vector3dT(-5000.0, -37.0, -1.0)*(Epsilon*2.0), Random), Epsilon, 0, Random)>0) NumErrors++;
+        if (Compare("cell boundaries, far out", GetBoundaryVertices(Epsilon, Vector3dT(32768.0, -65536.0, 8192.0), Random), Epsilon, 0, Random)>0) NumErrors++;
+        if (Compare("map vertices", GetMapVertices(Epsilon, Random), Epsilon, 0, Random)>0) NumErrors++;
+    }
+
+    return NumErrors==0 ? 0 : 1;
+}